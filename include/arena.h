@@ -0,0 +1,120 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+/**
+ * @file arena.h
+ * @brief Request-scoped bump allocator, released in one piece.
+ *
+ * A request used to make dozens of small calloc()/free() pairs -- the JSON
+ * builder and every growth of its buffer, the record buffers of the data
+ * set read, hash and write paths, the submit read buffer, the console log's
+ * time table -- each one a separate piece of the heap, freed in whatever
+ * order the handler unwound. Issue #287 measured how this address space
+ * dies: of fragmentation, not exhaustion. Short-lived pieces of every size,
+ * interleaved with the long-lived ones other workers hold, leave holes that
+ * fit nothing.
+ *
+ * The arena asks for storage in chunks of ARENA_CHUNK_SIZE bytes, hands it out
+ * by bumping an offset, and gives it all back at once when the request ends
+ * -- handle_request() releases it after the handler returns, and
+ * session_cleanup() after an abend, so an ESTAE recovery frees the request's
+ * storage as surely as a normal return. One chunk serves a typical request;
+ * 64 K is the size the stack was cut to for #290, so a chunk fits the same
+ * holes a LINK does.
+ *
+ * What the arena is not: a heap. There is no free() of one allocation.
+ * arena_realloc() extends the most recent allocation in place when the
+ * chunk has room, which is the one pattern that matters -- a growing JSON
+ * buffer -- and otherwise copies. A request larger than a quarter chunk gets
+ * a chunk of its own, sized to fit, so one big record buffer does not strand
+ * the rest of a shared chunk; growing such an allocation hands its old chunk
+ * back at once.
+ *
+ * Storage from the arena is never to be passed to free(), and a pointer
+ * into it must not outlive the request.
+ *
+ * ====================================================================
+ * This TU is portable C: no httpd headers, no MVS services, no statics.
+ * Where chunks come from is ARENA_OPS -- GETMAIN/FREEMAIN in router.c,
+ * malloc/free in test/host/tstarena.c, which drives the real allocator.
+ * ====================================================================
+ */
+
+#include <stddef.h>
+
+/** @brief Bytes per shared chunk, header included. */
+#define ARENA_CHUNK_SIZE (64 * 1024)
+
+/** @brief Larger requests get a chunk of their own. */
+#define ARENA_LARGE     (ARENA_CHUNK_SIZE / 4)
+
+/** @brief Alignment of every allocation: a doubleword. */
+#define ARENA_ALIGN     8
+
+/** @brief Where the chunks come from. */
+typedef struct arena_ops {
+    /** Get `size` bytes, or NULL. Need not be zeroed. */
+    void *(*get)(void *ctx, unsigned size);
+    /** Give back a block get() returned, with its size. */
+    void  (*put)(void *ctx, void *block, unsigned size);
+} ARENA_OPS;
+
+typedef struct arena_chunk ARENA_CHUNK;
+
+/** @brief Chunk header, at the start of every chunk; the first allocation
+ *         follows it at the next ARENA_ALIGN boundary. */
+struct arena_chunk {
+    ARENA_CHUNK    *next;
+    unsigned        size;           /**< bytes, header included */
+    unsigned        used;           /**< bytes, header included */
+    unsigned        large;          /**< holds one large allocation */
+};
+
+/** @brief The arena in the Session. */
+typedef struct arena {
+    const ARENA_OPS *ops;
+    void           *ctx;            /**< for ops */
+    ARENA_CHUNK    *head;           /**< the chunk being bumped; large
+                                         chunks are linked behind it */
+    char           *last;           /**< most recent allocation in head */
+    unsigned        allocs;         /**< allocations handed out */
+    unsigned        gets;           /**< chunks obtained from ops */
+    unsigned        held;           /**< chunk bytes held now */
+    unsigned        high;           /**< most chunk bytes held at once */
+} ARENA;
+
+/**
+ * @brief Bind an empty arena to its chunk source. Takes no storage.
+ */
+void arena_init(ARENA *a, const ARENA_OPS *ops, void *ctx) asm("ARN0001");
+
+/**
+ * @brief Allocate `size` bytes, ARENA_ALIGN-aligned, not zeroed.
+ * @return NULL when the chunk source fails, or for a size over 16 MB.
+ */
+void *arena_alloc(ARENA *a, size_t size) asm("ARN0002");
+
+/**
+ * @brief arena_alloc() and zero it: the drop-in for calloc(1, size).
+ */
+void *arena_calloc(ARENA *a, size_t size) asm("ARN0003");
+
+/**
+ * @brief Resize an allocation.
+ *
+ * In place when `p` is the most recent allocation and its chunk has the
+ * room; otherwise a new allocation and a copy. On failure `p` is untouched
+ * and still valid, as with realloc(). NULL `p` is arena_alloc().
+ *
+ * @param old_size  What `p` was allocated or last resized with.
+ */
+void *arena_realloc(ARENA *a, void *p, size_t old_size, size_t new_size)
+    asm("ARN0004");
+
+/**
+ * @brief Give every chunk back. The arena is empty and usable again;
+ *        releasing an empty arena does nothing.
+ */
+void arena_release(ARENA *a) asm("ARN0005");
+
+#endif /* ARENA_H */
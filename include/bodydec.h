@@ -0,0 +1,138 @@
+#ifndef BODYDEC_H
+#define BODYDEC_H
+
+/**
+ * @file bodydec.h
+ * @brief The request body, decoded from its framing as it arrives and
+ *        pushed to a sink a span at a time.
+ *
+ * A body comes either as Content-Length bytes or chunked: a hex size line,
+ * that many bytes and a CRLF, over and over, until a size of zero, then
+ * optional trailer lines and an empty line. Every handler that took a body
+ * used to decode this itself -- read_request_content(), the data set create
+ * reader, the four PUT loops -- each with its own idea of what a size line
+ * may hold and what follows the last chunk.
+ *
+ * bodydec is that decoding, once. It is a state machine fed raw bytes in
+ * whatever runs they arrive. It hands each run of body bytes to a sink,
+ * and the sink decides what a body is for: bytes in memory (BODYMEM, below),
+ * records for a data set, a UFS file, an internal reader.
+ *
+ * What the decoder accepts:
+ *  - a size line of hex digits, optional blanks, and an optional ";"
+ *    extension, which is ignored. The line ends in CRLF or a bare LF.
+ *  - trailer lines after the last chunk, which are read and ignored.
+ *  - a chunk-size or trailer line of up to BODY_LINE_MAX bytes.
+ *    Anything else in a size line, a size that does not fit in size_t, or a
+ *    chunk without its CRLF, is BODY_EFRAME.
+ *
+ * bodydec_want() tells how much the caller may read next without reading
+ * past the body. Past the body is the next request on the connection, or a
+ * read that never completes. In a size line, a CRLF or a trailer, that is
+ * one byte; in a chunk or a Content-Length body, the rest of it.
+ *
+ * The bytes come from a transport (BODY_RECV). That is the caller's:
+ * receive_body() in common.c offers one that reads a byte per recv() --
+ * the MVS 3.8j TCP/IP ring-buffer workaround -- and one that reads in bulk
+ * for the paths that always did. body_pump() joins a transport, a decoder
+ * and a sink.
+ *
+ * A sink that fails does not stop the reading. The decoder stops calling
+ * it and reads the body to its end, so that no unread byte is left in the
+ * socket to reset the connection. body_pump() then answers BODY_ESINK.
+ *
+ * ====================================================================
+ * This TU is portable C: no httpd headers, no MVS services, no statics.
+ * test/host/tstbody.c drives it in random runs against a reference.
+ * ====================================================================
+ */
+
+#include <stddef.h>
+
+/* body_pump() answers, besides 0 */
+#define BODY_ERECV      (-1)    /* the transport failed, or the peer closed */
+#define BODY_EFRAME     (-2)    /* not a chunked body */
+#define BODY_ESINK      (-3)    /* the sink failed; the body was drained */
+#define BODY_ECODING    (-4)    /* receive_body(): a Content-Encoding not
+                                   taken, or a body that does not inflate */
+
+/* chunk-size or trailer line length, extensions included */
+#define BODY_LINE_MAX   1024
+
+/* Take `len` body bytes; 0, or -1 to be called no more. The span is the
+   sink's to change in place (a translation) but not to keep. */
+typedef int (*BODY_SINK)(void *ctx, char *data, size_t len);
+
+/* Read up to `len` bytes into `buf`: the count read, which may be short,
+   0 when the peer has closed, negative on an error. */
+typedef int (*BODY_RECV)(void *ctx, char *buf, int len);
+
+typedef struct bodydec  BODYDEC;
+
+struct bodydec {
+	int             state;          /* BDS_*, in bodydec.c */
+	size_t          remaining;      /* of the Content-Length body or chunk */
+	size_t          size;           /* the chunk size being read */
+	unsigned        digits;         /* hex digits in it so far */
+	unsigned        line_len;       /* bytes of the current line */
+	int             failed;         /* the sink failed: drain only */
+	size_t          total;          /* body bytes decoded */
+	unsigned long   chunks;
+};
+
+/**
+ * @brief Start a body: `chunked`, or `length` bytes of it.
+ */
+void bodydec_init(BODYDEC *bd, int chunked, size_t length) asm("BDC0001");
+
+/**
+ * @brief Decode `len` raw bytes, and hand the body bytes among them to
+ *        `sink`. Bytes after the end of the body are not consumed.
+ *
+ * @return the raw bytes consumed, or BODY_EFRAME.
+ */
+long bodydec_feed(BODYDEC *bd, char *buf, size_t len, BODY_SINK sink,
+    void *ctx) asm("BDC0002");
+
+/**
+ * @brief How many raw bytes the body still has for certain: 0 once it
+ *        has ended.
+ */
+size_t bodydec_want(const BODYDEC *bd) asm("BDC0003");
+
+/**
+ * @brief 1 once the whole body, trailers included, has been decoded.
+ */
+int bodydec_done(const BODYDEC *bd) asm("BDC0004");
+
+/**
+ * @brief Read a whole body from `recv` through `buf` (`size` bytes) and
+ *        push it to `sink`.
+ *
+ * @return 0, BODY_ERECV, BODY_EFRAME or BODY_ESINK.
+ */
+int body_pump(BODYDEC *bd, BODY_RECV recv, void *rctx, char *buf,
+    size_t size, BODY_SINK sink, void *sctx) asm("BDC0005");
+
+/*
+ * A sink that keeps the body in memory, always with room for a NUL after
+ * it. With `grow` set it extends the buffer with realloc() as needed and
+ * fails only when realloc() does. Without it, bytes past the buffer are
+ * counted in `dropped` and the rest is still drained.
+ */
+typedef struct bodymem  BODYMEM;
+
+struct bodymem {
+	char            *buf;
+	size_t          len;
+	size_t          cap;            /* bytes at buf, the NUL's included */
+	int             grow;           /* buf is malloc()ed and may move */
+	size_t          dropped;
+};
+
+/**
+ * @brief A BODY_SINK over a BODYMEM (`ctx`).
+ */
+int bodymem_sink(void *ctx, char *data, size_t len) asm("BDC0006");
+
+#endif /* BODYDEC_H */
@@ -9,6 +9,7 @@
  * parameter extraction, and error responses in z/OSMF compatible format.
  */
 
+#include "bodydec.h"
 #include "json.h"
 #include "router.h"
 #include <stddef.h>
@@ -121,7 +122,9 @@
  * @brief Gets a query parameter from the request URL
  *
  * Extracts and returns the value of a named query parameter.
- * Returns NULL if parameter is not found.
+ * Returns NULL if parameter is not found. A name the request context has a
+ * slot for (RQQ_* in reqctx.h) is answered from session->req without a
+ * search; handlers on a real route read that field directly.
  *
  * @param session Current session context
  * @param name Name of the query parameter
@@ -130,10 +133,11 @@
 char *getQueryParam(Session *session, const char *name) asm("CMN0001");
 
 /**
- * @brief Gets a path parameter from HTTP headers
+ * @brief Gets a path parameter by name
  *
- * Extracts and returns the value of a named path parameter.
- * Path parameters are extracted from URL patterns like /jobs/{jobname}.
+ * Returns the value of a named path parameter, as captured by the route
+ * match from URL patterns like /jobs/{jobname}. Prefer getPathVar(); this
+ * form compares the name against each capture.
  *
  * @param session Current session context
  * @param name Name of the path parameter
@@ -141,10 +145,27 @@ char *getQueryParam(Session *session, const char *name) asm("CMN0001");
  */
 char *getPathParam(Session *session, const char *name) asm("CMN0002");
 
+/**
+ * @brief Gets a path parameter by id
+ *
+ * Returns the value the route match captured for a path variable
+ * (PATH_DATASET_NAME, PATH_JOBID, ... in routes.h). The value is not a copy
+ * and not an environment variable: it points into the request's decoded
+ * path, where the router terminated each capture in place, and stays valid
+ * for the whole handler call. Trailing blanks are already trimmed.
+ *
+ * @param session Current session context
+ * @param var Path variable id
+ * @return Value of parameter or NULL if the route has no such variable
+ */
+char *getPathVar(Session *session, int var) asm("CMN0023");
+
 /**
  * @brief Gets a header parameter from HTTP request
  *
- * Extracts and returns the value of a named HTTP header.
+ * Extracts and returns the value of a named HTTP header. Known headers
+ * (RQH_* in reqctx.h) are answered from session->req, others from the
+ * environment.
  *
  * @param session Current session context
  * @param name Name of the header parameter
@@ -221,10 +242,45 @@ int send_common_headers(Session *session) asm("CMN0016");
 int sendDefaultHeaders(Session *session, int status, const char *content_type,
                       size_t content_length) asm("CMN0010");
 
+/** @brief createJsonResponse(): stream the document as it is built */
+#define JSON_STREAMED 1
+
+/**
+ * @brief Creates the JsonBuilder for a handler's response
+ *
+ * From the request arena, as createJsonBuilderIn(). With JSON_STREAMED the
+ * builder streams (streamJsonBuilder()): a document that outgrows its
+ * window goes out while it is built, as a chunked 200 whose headers are
+ * sent with the first window, and the request holds JSON_STREAM_WINDOW
+ * bytes instead of the whole document. For the long lists -- jobs, the
+ * console log -- whose buffers used to reach hundreds of KB (#287).
+ *
+ * A streamed response commits to 200 at the first flush, so a handler that
+ * fails later can no longer answer with an error: freeing the unfinished
+ * builder drops the connection instead, and the client sees the body cut
+ * short. Handlers whose errors come after their first item stay buffered.
+ * A document that fits its window is sent by sendJSONResponse() like any
+ * other, with a Content-Length and the status it is given.
+ *
+ * Without JSON_STREAMED the buffer is sized up front for what the route's
+ * documents have needed lately (metrics_presize()), so a typical response
+ * is built without a single reallocation.
+ *
+ * @param session Current session context
+ * @param flags 0 or JSON_STREAMED
+ * @return Pointer to new JsonBuilder or NULL on allocation failure
+ */
+JsonBuilder *createJsonResponse(Session *session, int flags) asm("CMN0026");
+
 /**
  * @brief Sends a JSON response
  *
  * Sends HTTP response with JSON content type and body from JsonBuilder.
+ * For a streamed builder that has already flushed, the status and headers
+ * are out and this sends the rest of the document.
+ *
+ * Otherwise the builder's buffer is translated in place and sent as it is,
+ * with no copy: the builder is empty afterwards and is not to be added to.
  *
  * @param session Current session context
  * @param status HTTP status code
@@ -255,7 +311,8 @@ int sendErrorResponse(Session *session, int status, int category, int rc,
                      int details_count) asm("CMN0012");
 
 /**
- * @brief Answers a conditional read whose If-None-Match still holds
+ * @brief Answers a conditional read whose If-None-Match, or
+ *        If-Modified-Since, still holds
  *
  * No body and no Content-Type: the client keeps the representation it already
  * has, and a 304 that described a payload it is not sending would only invite
@@ -273,10 +330,13 @@ int sendErrorResponse(Session *session, int status, int category, int rc,
  * caller, not here.
  *
  * @param session Current session context
- * @param etag The stamp the request's If-None-Match matched
+ * @param etag The stamp the request's If-None-Match matched, or NULL for a
+ *        304 settled on the date alone when the 200 would carry no ETag
+ * @param lastmod The Last-Modified date (lastmod.h), or NULL for none
  * @return 0 on success, negative value on error
  */
-int send_not_modified(Session *session, const char *etag) asm("CMN0013");
+int send_not_modified(Session *session, const char *etag,
+                      const char *lastmod) asm("CMN0013");
 
 /**
  * @brief Sends a whole buffer to the client, or fails
@@ -294,6 +354,14 @@ int send_not_modified(Session *session, const char *etag) asm("CMN0013");
  * The buffer must already carry the bytes the client is to receive; no
  * translation happens here.
  *
+ * Writes are coalesced in the session's SEND_BUF (sendall.h): a write that
+ * fits is copied behind what is pending and returns without sending, and
+ * the bytes go out SEND_BUF_SIZE at a time, as the buffer fills, when the
+ * next response starts (session_resp()) and when the handler returns. A 0
+ * return therefore means "accepted", and a failed send surfaces on the write
+ * or flush that made it. The caller's buffer may be reused at once either
+ * way.
+ *
  * A failure leaves the client at CSTATE_DONE, which stops the handler's
  * remaining output rather than letting each later call wait out its own
  * budget for a peer that is gone, and clears keepalive so the connection is
@@ -308,6 +376,103 @@ int send_not_modified(Session *session, const char *etag) asm("CMN0013");
  */
 int send_all(Session *session, const UCHAR *buf, int len) asm("CMN0014");
 
+/**
+ * @brief Sends whatever send_all() and send_printf() hold pending
+ *
+ * The router calls it when the handler returns and before every status
+ * line, so a handler only needs it to push bytes out ahead of a long wait.
+ *
+ * @param session Current session context
+ * @return 0 when nothing is left pending, -1 when a send failed
+ */
+int send_flush(Session *session) asm("CMN0024");
+
+/**
+ * @brief Ends the response body: what is pending, and the gzip trailer
+ *        when the body was compressed
+ *
+ * The router calls it when the handler returns. A handler does not.
+ *
+ * @param session Current session context
+ * @return 0 when the body is complete, -1 when a send failed
+ */
+int send_finish(Session *session) asm("CMN0034");
+
+/**
+ * @brief Compresses the body that follows these headers with gzip, when the
+ *        client and the route want it
+ *
+ * Called between the status line and the blank line that ends the headers,
+ * by a response whose body has no Content-Length. It compresses only when
+ * MVSMF_GZIP is set in the server environment (its value is the search
+ * budget, deflate.h), the client sent Accept-Encoding: gzip, and the body
+ * is worth it: at least the route's minimum, judged by `expect` when the
+ * size is known and by what the route has averaged when it is not. Then it
+ * writes Content-Encoding and Vary, and everything send_all() and
+ * send_printf() send from here is compressed on its way to the socket.
+ *
+ * @param session Current session context
+ * @param expect The body's size, 0 when it is not known yet
+ * @return 1 when the body will be compressed, 0 when not, negative when a
+ *         header could not be written
+ */
+int send_gzip_offer(Session *session, size_t expect) asm("CMN0033");
+
+/**
+ * @brief Would send_gzip_offer() compress this body? The same judgement,
+ *        with nothing written and nothing armed
+ *
+ * For a 304, which has no body but carries the ETag the 200 would: weak
+ * when the 200 is gzip.
+ *
+ * @return 1 when the body would be compressed, 0 when not
+ */
+int send_gzip_wanted(Session *session, size_t expect) asm("CMN0036");
+
+/**
+ * @brief http_printf() for response body text, through send_all()'s buffer
+ *
+ * Formats EBCDIC text and translates it to the client's code page, as
+ * http_printf() does, but appends it to the pending output instead of
+ * sending it. Body writers use this, never http_printf(): bytes that bypass
+ * the buffer would overtake the ones waiting in it. Headers keep using
+ * http_printf() -- they are written after session_resp() has flushed.
+ *
+ * @param session Current session context
+ * @param fmt printf() format
+ * @return 0 when accepted, -1 when a send failed
+ */
+int send_printf(Session *session, const char *fmt, ...) asm("CMN0025");
+
+/**
+ * @brief send_printf() for one list item rendered from its template
+ *
+ * Renders the item (jsontmpl.h) straight into the pending output and
+ * translates it there: no format string, no intermediate copy. An item that
+ * does not fit what is left of the buffer flushes it first; one larger
+ * than the whole buffer is rendered in the arena and sent from there.
+ *
+ * @param session Current session context
+ * @param t Template, normally list_template()
+ * @param v Its slot values
+ * @return 0 when accepted, -1 when a send failed
+ */
+int send_item(Session *session, const JT_OP *t, const JT_VAL *v)
+    asm("CMN0027");
+
+/**
+ * @brief Whether a worker wait should end now rather than wait on
+ *
+ * True when the client is finished or dead, or the server is quiescing or
+ * shutting down. The test send_all() makes on every stalled turn, for any
+ * other wait on the worker's side -- the read-ahead in dsread.c -- to make
+ * the same way. Never cache the answer: it is polled.
+ *
+ * @param session Current session context
+ * @return 1 to stop waiting, 0 to go on
+ */
+int session_aborted(Session *session) asm("CMN0028");
+
 /**
  * @brief Answers a request refused by an authorization check (issue #228)
  *
@@ -333,7 +498,8 @@ int send_not_authorized(Session *session, const char *detail) asm("CMN0015");
  *
  * Supports both Content-Length and Transfer-Encoding: chunked.
  * Uses single-byte recv() to work around the MVS 3.8j TCP/IP
- * ring buffer bug. Caller must free the returned buffer.
+ * ring buffer bug. Caller must free the returned buffer. A gzip or
+ * deflate body is inflated, to at most 4 MB.
  *
  * @param session Current session context
  * @param content Output pointer to allocated buffer (caller frees)
@@ -372,4 +538,78 @@ int receive_raw_data(HTTPC *httpc, char *buf, int len) asm("CMN0021");
  */
 int receive_raw_some(HTTPC *httpc, char *buf, int len) asm("CMN0022");
 
+/**
+ * @brief Reads the request body, Content-Length or chunked, and pushes it
+ *        to @p sink a span at a time (bodydec.h)
+ *
+ * The body is read to its end even after the sink fails, so no unread byte
+ * is left to reset the connection.
+ *
+ * A body sent with Content-Encoding: gzip or deflate reaches @p sink
+ * inflated (inflate.h); any other coding is read and refused.
+ *
+ * @param session Current session context
+ * @param recv body_recv_bytes(), or body_recv_some() on the paths that
+ *        have always read in bulk
+ * @param sink Receives the decoded body
+ * @param ctx The sink's context
+ * @return 0, or BODY_ERECV, BODY_EFRAME (also: no framing at all),
+ *         BODY_ESINK or BODY_ECODING
+ */
+int receive_body(Session *session, BODY_RECV recv, BODY_SINK sink,
+                 void *ctx) asm("CMN0029");
+
+/**
+ * @brief receive_raw_data() as a BODY_RECV; @p httpc is the HTTPC
+ */
+int body_recv_bytes(void *httpc, char *buf, int len) asm("CMN0030");
+
+/**
+ * @brief receive_raw_some() as a BODY_RECV; @p httpc is the HTTPC
+ */
+int body_recv_some(void *httpc, char *buf, int len) asm("CMN0031");
+
+/**
+ * @brief Reads the request body to its end and throws it away, for a
+ *        request answered without it
+ *
+ * @param session Current session context
+ */
+void drain_body(Session *session) asm("CMN0032");
+
+/** @brief The most a GET keeps from its ETag pass to send from storage */
+#define KEEP_MAX (256 * 1024)
+
+/**
+ * @brief A small object read once, for its ETag and for its body
+ *
+ * A conditional GET, or one asking for X-IBM-Return-Etag, reads the whole
+ * object for the stamp and used to read it all again for the body. Most
+ * members and files are a few KB: the stamp pass keeps what it reads here,
+ * and the body is sent from it. An object larger than KEEP_MAX is not kept,
+ * and is read again as before.
+ *
+ * The storage is the request arena's, grown by doubling.
+ */
+typedef struct keepbuf {
+    unsigned char *buf;
+    size_t size;                    /**< of buf */
+    size_t used;
+    size_t pos;                     /**< the sender's place in buf */
+    int    whole;                   /**< the pass kept all of the object */
+} KEEPBUF;
+
+/**
+ * @brief Add bytes to what the stamp pass keeps
+ *
+ * @param session Current session context, for its arena
+ * @param keep The buffer; all zeros to start
+ * @param data Bytes to add
+ * @param len Their length
+ * @return 0, or -1 when they would take it past KEEP_MAX or there is no
+ *         storage -- the object is then read again for the body
+ */
+int keep_append(Session *session, KEEPBUF *keep, const void *data,
+                size_t len) asm("CMN0035");
+
 #endif // COMMON_H
@@ -0,0 +1,87 @@
+#ifndef DEBLOCK_H
+#define DEBLOCK_H
+
+/**
+ * @file deblock.h
+ * @brief Logical records out of physical blocks: F/FB, V/VB and U.
+ *
+ * The read paths used to take a data set one logical record at a time --
+ * fgets() in text mode, fread(lrecl) in binary -- and a sequential FB data
+ * set read that way does not end where its data ends: fread() runs on into
+ * the residue of the last block, which is why get_fb_record_count() counted
+ * the records from the VTOC so the reader knew when to stop.
+ *
+ * A physical block knows its own length, and the records in it follow from
+ * the format alone:
+ *
+ *   F/FB  the block is a whole number of LRECL-byte records; a short last
+ *         block is simply fewer of them.
+ *   V/VB  a block descriptor word (LL, 00) gives the bytes in use, and each
+ *         record starts with a record descriptor word (LL, SS) whose length
+ *         includes itself. SS is the segment code; anything but a complete
+ *         record is a spanned segment, which is not deblocked here.
+ *   U     the block is the record.
+ *
+ * So with the block and the length actually read, the records -- and the
+ * true end of the data -- need nothing else. deblock_next() hands out each
+ * record as a span inside the caller's block, without copying; the span is
+ * valid until the next deblock_block().
+ *
+ * ====================================================================
+ * This TU is portable C: no httpd headers, no MVS services, no statics.
+ * test/host/tstdblk.c drives it over synthetic blocks.
+ * ====================================================================
+ */
+
+#include <stddef.h>
+
+/* the record formats, by how their blocks are cut */
+#define DBK_F           0       /* F, FB, FBS */
+#define DBK_V           1       /* V, VB (not spanned) */
+#define DBK_U           2       /* U */
+
+/* deblock_block() and deblock_next() errors: the block does not hold what
+   its format says it holds */
+#define DBK_EBDW        (-1)    /* BDW length below 4 or past the block */
+#define DBK_ERDW        (-2)    /* RDW length below 4 or past the BDW */
+#define DBK_ESPAN       (-3)    /* a spanned segment */
+#define DBK_ELEN        (-4)    /* F block not a multiple of LRECL */
+
+typedef struct deblock  DEBLOCK;
+
+struct deblock {
+	const unsigned char *blk;       /* the block being deblocked */
+	size_t          len;            /* bytes of it that hold records */
+	size_t          pos;            /* offset of the next record */
+	size_t          lrecl;          /* F: the record length */
+	int             format;         /* DBK_F, DBK_V or DBK_U */
+	int             error;          /* 0, or the DBK_E* that stopped it */
+};
+
+/**
+ * @brief Start a deblocker for one data set.
+ *
+ * @param lrecl The record length for DBK_F; ignored otherwise.
+ */
+void deblock_init(DEBLOCK *db, int format, size_t lrecl) asm("DBK0001");
+
+/**
+ * @brief Hand the deblocker the next block, `len` bytes as read.
+ *
+ * A block of length 0 holds no records.
+ *
+ * @return 0, or a DBK_E* error; an error stays until deblock_init().
+ */
+int deblock_block(DEBLOCK *db, const unsigned char *blk, size_t len)
+    asm("DBK0002");
+
+/**
+ * @brief The next record of the current block.
+ *
+ * @return 1 with *rec and *len set, 0 when the block is used up, or a DBK_E*
+ *         error.
+ */
+int deblock_next(DEBLOCK *db, const unsigned char **rec, size_t *len)
+    asm("DBK0003");
+
+#endif /* DEBLOCK_H */
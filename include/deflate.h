@@ -0,0 +1,100 @@
+#ifndef DEFLATE_H
+#define DEFLATE_H
+
+/**
+ * @file deflate.h
+ * @brief A response body, gzipped as it is sent.
+ *
+ * A text download, a spool data set or a long listing crosses the network
+ * as plain text, and a Hercules link is slow enough that the client waits
+ * on those bytes. A client that sends Accept-Encoding: gzip can have them
+ * compressed. send_all() (common.c) then passes what it has coalesced
+ * through this encoder before send_bytes().
+ *
+ * The encoder is built for an emulated CPU and a request arena, not for
+ * the best ratio:
+ *  - Fixed Huffman blocks only. No code is built per block and no symbol
+ *    is counted, so a symbol costs one table load and a shift.
+ *  - Greedy LZ77 over an 8 KB history, with a hash of three bytes chained
+ *    to earlier positions. `chain` is how many earlier positions a match
+ *    search may try. It is the CPU budget: 1 finds most of what a listing
+ *    repeats, and each step up costs more CPU for a little more ratio.
+ *  - A body that does not compress stops being compressed. After the
+ *    first DEFL_PROBE bytes, output above 7/8 of the input switches the
+ *    rest to stored blocks, which cost a copy.
+ *
+ * The storage is fixed, about 45 KB in one DEFLATE: the history, its hash
+ * chains and a staging buffer the sink is called from.
+ *
+ * ====================================================================
+ * This TU is portable C: no httpd headers, no MVS services, no statics.
+ * test/host/tstdefl.c inflates what it makes with src/inflate.c, and
+ * measures ratio against CPU per byte on JCL and listing samples.
+ * ====================================================================
+ */
+
+#include <stddef.h>
+
+#include "etag.h"
+
+#define DEFL_WBITS      13
+#define DEFL_WSIZE      (1U << DEFL_WBITS)  /* the history a match may reach */
+#define DEFL_HBITS      12
+#define DEFL_HSIZE      (1U << DEFL_HBITS)  /* hash chains */
+#define DEFL_OUTSIZE    4096    /* compressed bytes per sink call, at most */
+#define DEFL_CHAIN_MAX  64      /* the most positions one search tries */
+#define DEFL_PROBE      16384   /* bytes in before the ratio is judged */
+
+/* Take `len` compressed bytes; 0, or negative to fail the stream. */
+typedef int (*DEFL_SINK)(void *ctx, const unsigned char *data, size_t len);
+
+typedef struct deflate  DEFLATE;
+
+struct deflate {
+	int             chain;          /* positions a search tries */
+	int             started;        /* the gzip header is out */
+	int             stored;         /* gave up: stored blocks from here */
+	int             probed;         /* the ratio was judged */
+	int             err;            /* the sink failed; sticks */
+	unsigned long   bits;           /* output bits not yet a byte, LSB first */
+	unsigned        nbits;
+	unsigned        strstart;       /* next window byte to encode */
+	unsigned        lookahead;      /* window bytes from there not encoded */
+	ETAGCTX         crc;            /* the CRC32 of the body */
+	size_t          total_in;
+	size_t          total_out;
+	unsigned        olen;
+
+	unsigned short  lcode[288];     /* fixed literal/length codes, reversed */
+	unsigned char   lsym[256];      /* match length - 3 -> length symbol - 257 */
+	unsigned char   dsym[512];      /* distance -> distance symbol, see below */
+	unsigned short  head[DEFL_HSIZE];
+	unsigned short  prev[DEFL_WSIZE];
+	unsigned char   window[2 * DEFL_WSIZE];
+	unsigned char   out[DEFL_OUTSIZE];
+};
+
+/**
+ * @brief Start a gzip stream that searches `chain` positions per match
+ *        (clamped to 1..DEFL_CHAIN_MAX).
+ */
+void defl_init(DEFLATE *d, int chain) asm("DFL0001");
+
+/**
+ * @brief Compress `len` bytes. Compressed bytes reach `sink` as the
+ *        staging buffer fills; some stay behind until defl_end().
+ *
+ * @return 0, or -1 once the sink has failed.
+ */
+int defl_feed(DEFLATE *d, const void *buf, size_t len, DEFL_SINK sink,
+    void *ctx) asm("DFL0002");
+
+/**
+ * @brief End the stream: the rest of the body, the last block and the
+ *        gzip trailer, all handed to `sink`.
+ *
+ * @return 0, or -1 when the sink failed now or before.
+ */
+int defl_end(DEFLATE *d, DEFL_SINK sink, void *ctx) asm("DFL0003");
+
+#endif /* DEFLATE_H */
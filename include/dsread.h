@@ -0,0 +1,126 @@
+#ifndef DSREAD_H
+#define DSREAD_H
+
+/**
+ * @file dsread.h
+ * @brief Reading a data set or member record by record, a block at a time.
+ *
+ * The one reader behind a data set or member GET, its ETag, and a job
+ * submitted from a data set. It opens the data set for physical blocks and
+ * deblocks them in storage (deblock.h), so a record costs no I/O call of its
+ * own and the end of the data is the end of the last block read -- no VTOC
+ * record count needed to stop before the residue of a short FB block.
+ *
+ * Where a block read cannot be had -- the data set's DSCB cannot be read, it
+ * is spanned (VBS), or the open does not take the RECFM=U override -- the
+ * reader falls back to what the handlers did before: fgets() per line in
+ * text mode, fread(lrecl) per record in binary, stopping an FB data set at
+ * the record count the VTOC gives. Either way the caller
+ * sees the same thing: one record at a time, as a span it must not keep.
+ *
+ * A block read can also run ahead of the caller (dsread_ahead()): a
+ * subtask reads the next block into a second buffer while the worker
+ * deblocks and sends this one (rdahead.h). What the subtask touches is in
+ * the arena, not in the DSREAD on the handler's stack, and the session
+ * knows it (Session.rd): a handler that abends leaves its frame behind, and
+ * session_cleanup() still has to stop the reader before it closes the DCB
+ * the reader is in and releases the buffers it fills.
+ */
+
+#include <stdio.h>
+#include <clibthrd.h>
+
+#include "deblock.h"
+#include "rdahead.h"
+#include "router.h"
+
+/* "DSN(MEMBER)" and its NUL */
+#define DSREAD_NAMESZ   55
+
+typedef struct dsread   DSREAD;
+typedef struct dsahead  DSAHEAD;
+
+/* The read-ahead: the worker's and the subtask's, in the arena. */
+struct dsahead {
+	RDAHEAD         ra;
+	FILE            *fp;            /* the worker's DCB, read by the subtask */
+	char            name[DSREAD_NAMESZ];    /* for the messages */
+	CTHDTASK        *task;          /* the reader subtask */
+	unsigned        ecb_full;       /* posted by the reader: a block */
+	unsigned        ecb_free;       /* posted by the worker: a buffer */
+	unsigned        ecb_done;       /* posted by the reader as it ends */
+};
+
+struct dsread {
+	const char      *name;          /* as opened, for MVSMF106W */
+	FILE            *fp;
+	unsigned char   *block;         /* the block, or the record or line */
+	size_t          size;           /* of block */
+	DEBLOCK         db;
+	long            left;           /* records still to read, -1 no limit */
+	int             blocked;        /* 1: physical blocks, deblocked */
+	int             text;           /* record fallback: fgets() lines */
+	int             format;         /* DBK_F, DBK_V or DBK_U */
+
+	/* read-ahead (dsread_ahead()); NULL when the reads are in line */
+	Session         *session;       /* whose abort checks the waits make */
+	DSAHEAD         *ahead;
+};
+
+/**
+ * @brief Open a data set or member ("DSN" or "DSN(MEMBER)") for reading.
+ *
+ * The handle is registered with the session, as every handler's fopen() is.
+ *
+ * @param text Lines rather than records where the fallback has to choose:
+ *             the line without its '\n', as fgets() read it.
+ * @return 0; -1 when the open failed, with nothing sent -- the caller's
+ *         diagnosis is the one that knows what was asked for; -2 when there
+ *         was no storage for the block.
+ */
+int dsread_open(Session *session, DSREAD *r, const char *name, int text)
+    asm("DSR0001");
+
+/**
+ * @brief Read ahead: a subtask reads the next block while the caller works
+ *        on this one. Before the first dsread_next().
+ *
+ * Only when the server environment sets MVSMF_READAHEAD=1 and the reader
+ * is reading blocks. The subtask only reads; the open and the close stay
+ * with the worker, whose TCB owns the DCB.
+ *
+ * @return 0 when the subtask runs; -1 when the reads stay in line, which
+ *         is not an error.
+ */
+int dsread_ahead(Session *session, DSREAD *r) asm("DSR0004");
+
+/**
+ * @brief The next record, valid until the next call.
+ *
+ * @return 1 with *rec and *len set, 0 at the end of the data, -1 when a
+ *         block does not hold what its format says -- which has been
+ *         reported (MVSMF106W) by the time it returns -- or when the worker
+ *         stopped waiting on the read-ahead because the client went away or
+ *         the server is stopping (session_aborted()).
+ */
+int dsread_next(DSREAD *r, const unsigned char **rec, size_t *len)
+    asm("DSR0002");
+
+/**
+ * @brief Close and deregister the handle; safe on one that never opened.
+ *        A read-ahead subtask is stopped and waited for first.
+ */
+void dsread_close(Session *session, DSREAD *r) asm("DSR0003");
+
+/**
+ * @brief Stop a read-ahead subtask and let it go.
+ *
+ * The wait for it is bounded, and ends early when session_aborted() says
+ * so: a reader that is not out by then is detached where it is. Either way
+ * it is gone when this returns, and the DCB it read may be closed.
+ * dsread_close() stops its own; session_cleanup() stops an abended
+ * handler's, before the files are closed and the arena released.
+ */
+void dsread_stop(Session *session, DSAHEAD *a) asm("DSR0005");
+
+#endif /* DSREAD_H */
@@ -0,0 +1,100 @@
+#ifndef DSWRITE_H
+#define DSWRITE_H
+
+/**
+ * @file dswrite.h
+ * @brief The target of a data set or member PUT, written in line or by a
+ *        writer subtask.
+ *
+ * Everything a PUT writes goes through dswrite_put(): the blocks recwrite
+ * gathered, and the records that only a flush can end. In line, that is
+ * fwrite() and fflush() on the worker, as it always was.
+ *
+ * With MVSMF_WRITEBEHIND=1 in the server environment, dswrite_open() starts
+ * a writer subtask instead, and the subtask owns the DCB. It opens the
+ * target, writes what the worker puts in the ring (wbring.h), and closes the
+ * target when the worker is done. The worker copies each block into a free
+ * slot and goes back to receiving the body. It waits only when every slot
+ * is full.
+ *
+ * Nothing moves earlier. dswrite_open() is still called from
+ * open_write_target(), on the first record proven readable, and it does not
+ * return until the subtask's open has succeeded or failed. A failed open is
+ * reported exactly as before. A failed write fails the worker's next put,
+ * or the close, and the PUT answers it as a failed write.
+ *
+ * The subtask runs under try(): an abend in its open, a write or the close
+ * -- an x37 is the one to expect -- is a failed open or a failed write like
+ * any other. No wait of the worker's is open-ended. Each gives the subtask
+ * a bounded time and ends early when session_aborted() says so, and a
+ * subtask that is still running then is detached. The DSWRITE is in the
+ * arena and is the session's (Session.wr), so session_cleanup() stops the
+ * subtask, too, before that storage is released.
+ */
+
+#include <stdio.h>
+#include <clibthrd.h>
+
+#include "router.h"
+#include "wbring.h"
+
+/* a target name write-behind takes: "DSN(MEMBER)" and its NUL, and more */
+#define DSWRITE_NAMESZ  64
+
+typedef struct dswrite  DSWRITE;
+
+struct dswrite {
+	FILE            *fp;            /* DCB attributes: read, never closed */
+	char            name[DSWRITE_NAMESZ];   /* the caller's may not outlive
+	                                           an abend */
+	const char      *mode;
+
+	/* write-behind; wb is NULL when the writes are in line */
+	Session         *session;       /* whose abort checks the waits make */
+	WBRING          *wb;
+	CTHDTASK        *task;          /* the writer subtask */
+	volatile int    opened;         /* by the writer: 1 open, -1 failed */
+	volatile int    stop;           /* by the worker: write no more, close */
+	int             open_errno;
+	unsigned        ecb_ready;      /* by the writer: the open, a slot free */
+	unsigned        ecb_work;       /* by the worker: a slot, the close */
+	unsigned        ecb_done;       /* by the writer as it ends */
+};
+
+/**
+ * @brief Open `name` with fopen() `mode` for output, in line or through a
+ *        writer subtask.
+ *
+ * @return 0 with w->fp set; -1 when the open failed, reported as
+ *         MVSMF101E, with nothing left open.
+ */
+int dswrite_open(Session *session, DSWRITE *w, const char *name,
+    const char *mode) asm("DSW0001");
+
+/**
+ * @brief Write `len` bytes, then fflush() when `flush` is set.
+ *
+ * @return 0, or -1 when this or an earlier write failed.
+ */
+int dswrite_put(DSWRITE *w, const void *data, size_t len, int flush)
+    asm("DSW0002");
+
+/**
+ * @brief Close the target. Write-behind: the ring is drained and the
+ *        subtask has ended by the time this returns.
+ *
+ * @return 0, or -1 when a write behind the worker failed.
+ */
+int dswrite_close(Session *session, DSWRITE *w) asm("DSW0003");
+
+/**
+ * @brief Stop a writer subtask without writing what is still in the ring,
+ *        and let it go; nothing when the writes are in line.
+ *
+ * session_cleanup() calls it for an abended handler's PUT. The wait is
+ * bounded as every other one is; the target is closed, by the subtask or
+ * with it, when this returns.
+ */
+void dswrite_stop(DSWRITE *w) asm("DSW0004");
+
+#endif /* DSWRITE_H */
@@ -32,9 +32,14 @@
  * Both accumulate ctx->len, which etag_final() folds into the value, so the
  * "a line was added or removed" case is caught either way.
  *
- * The CRC is computed table-free. A 1 KB lookup table would be read-only and
- * therefore RENT-safe, but at member sizes the bitwise loop costs nothing and
- * the question does not need asking.
+ * The CRC is computed eight bytes at a time from a const 8 KB table
+ * (slicing-by-8), which lives in the module's read-only text and so is
+ * RENT-safe. A stamp is a pass over the whole resource -- on every
+ * If-None-Match poll of a multi-MB data set or file, and twice on a PUT --
+ * and the bitwise loop spent eight shift-and-test steps a byte on it, which
+ * is sixty-four for each eight bytes the table folds in eight lookups. That
+ * loop stays as the reference: building with ETAG_CRC_BITWISE defined selects it, and
+ * the stamps do not change.
  *
  * Nothing here touches MVS services or the FILE control block, so the module
  * compiles and unit-tests natively (test/host/tstetag.c). The reading itself
@@ -81,6 +86,23 @@ void etag_init(ETAGCTX *ctx) asm("ETG0001");
  */
 void etag_update(ETAGCTX *ctx, const void *buf, size_t len) asm("ETG0002");
 
+/**
+ * @brief Folds one record that is stored longer than the caller holds it
+ *
+ * The same as etag_update() over `reclen` bytes: the `len` at buf, then
+ * `fill` up to `reclen`. This is a fixed-length record as the access method
+ * writes it out from a short one, which lets a writer stamp what it writes
+ * without building the padded copy (see recwrite.h).
+ *
+ * @param ctx Computation state
+ * @param buf Record data
+ * @param len Bytes at buf
+ * @param reclen Record length as stored; no padding when not above len
+ * @param fill The padding byte
+ */
+void etag_update_padded(ETAGCTX *ctx, const void *buf, size_t len,
+	size_t reclen, int fill) asm("ETG0007");
+
 /**
  * @brief Folds a run of bytes into a running ETag computation
  *
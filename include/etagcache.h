@@ -0,0 +1,117 @@
+#ifndef ETAGCACHE_H
+#define ETAGCACHE_H
+
+/**
+ * @file etagcache.h
+ * @brief ETags kept across requests, checked against cheap metadata.
+ *
+ * An ETag costs a read of the whole resource (dataset_etag() in dsapi.c,
+ * uss_etag() in ussapi.c). A client polling with If-None-Match, and every
+ * PUT with If-Match, pays that read for a stamp that has usually not
+ * changed since the last time it was computed.
+ *
+ * This cache keeps the stamp, keyed by the resource's name, together with
+ * metadata that changes whenever the content does and costs no data read:
+ *
+ *   - a member: its directory entry, i.e. TTR and user data (the ISPF
+ *     statistics). A member that is rewritten is written at a new TTR.
+ *   - a USS file: the mtime, size and inode from ufs_stat().
+ *
+ * A member also records the volume and DS1CREDT, so a data set that is
+ * deleted and allocated again does not match. A sequential data set is not
+ * cached: DS1LSTAR and DS1REFD stay as they were when it is rewritten to the
+ * same last block on a day it was already read, and If-Match would then let
+ * a PUT overwrite the change.
+ *
+ * A lookup hands back the stamp only when the metadata read now is the
+ * metadata stored with it. Otherwise the entry is dropped, and the caller
+ * computes the stamp and stores it with the metadata it read *before* the
+ * data. If the content changes while it is being read, the entry then
+ * carries the old metadata and never matches again. It never carries the new
+ * metadata with a stamp of the old content.
+ *
+ * What the metadata does not catch, the cache does not catch either, which
+ * is why it is opt-in (MVSMF_ETAG_CACHE). mvsMF's own writes drop the entry
+ * before they write.
+ *
+ * The storage is fixed: ETC_SLOTS entries in one block. When the block is
+ * full, a store replaces the entry used least recently. A key or metadata
+ * too long for an entry is not cached.
+ *
+ * ====================================================================
+ * This TU is portable C: no httpd headers, no MVS services, no statics.
+ * The anchor and the latch are the caller's (mvsmfctx.c), as for the
+ * metrics. test/host/tstetcc.c drives the real lookups and evictions.
+ * ====================================================================
+ */
+
+#include <stddef.h>
+
+#include "etag.h"
+
+#define ETC_EYE         "MVSMFETC"  /* 8 bytes, no NUL in the block */
+#define ETC_VERSION     1
+
+#define ETC_SLOTS       128     /* entries in the block */
+#define ETC_KEYMAX      128     /* key bytes, its NUL included */
+#define ETC_METAMAX     96      /* metadata bytes */
+
+/** @brief One resource's stamp and what it was stamped at. */
+typedef struct etc_entry {
+    unsigned        hash;               /**< of the key; 0 for a free slot */
+    unsigned        used;               /**< the block's tick when last used */
+    unsigned char   mlen;               /**< bytes of meta */
+    char            etag[ETAG_SIZE];    /**< the stamp */
+    char            key[ETC_KEYMAX];    /**< the name, NUL-terminated */
+    unsigned char   meta[ETC_METAMAX];  /**< the metadata it was stamped at */
+} ETC_ENTRY;
+
+/** @brief The block anchored in MVSMF_CTX, about 30 KB. */
+typedef struct etag_cache {
+    char            eye[8];             /**< ETC_EYE */
+    unsigned short  len;                /**< sizeof(ETAG_CACHE) */
+    unsigned short  ver;                /**< ETC_VERSION */
+    unsigned        tick;               /**< counts lookups that hit and stores */
+    ETC_ENTRY       entry[ETC_SLOTS];
+} ETAG_CACHE;
+
+/**
+ * @brief Stamp an empty block.
+ */
+void etc_init(ETAG_CACHE *c) asm("ETC0001");
+
+/**
+ * @brief Is this a block of this layout?
+ */
+int etc_valid(const ETAG_CACHE *c) asm("ETC0002");
+
+/**
+ * @brief The stamp of `key`, if it was stored with this metadata.
+ *
+ * An entry stored with other metadata is dropped. The caller holds the
+ * latch.
+ *
+ * @param etag Receives the stamp on a hit, ETAG_SIZE bytes.
+ * @return 1 on a hit, 0 otherwise.
+ */
+int etc_lookup(ETAG_CACHE *c, const char *key, const void *meta,
+    size_t mlen, char *etag) asm("ETC0003");
+
+/**
+ * @brief Keep the stamp of `key`, computed from content read after `meta`.
+ *
+ * Replaces the key's entry, or takes a free slot, or the one used least
+ * recently. The caller holds the latch.
+ *
+ * @return 0, or -1 when the key or the metadata does not fit an entry
+ *         (any entry the key had is dropped then).
+ */
+int etc_store(ETAG_CACHE *c, const char *key, const void *meta,
+    size_t mlen, const char *etag) asm("ETC0004");
+
+/**
+ * @brief Drop the entry of `key`, if it has one. The caller holds the latch.
+ */
+void etc_forget(ETAG_CACHE *c, const char *key) asm("ETC0005");
+
+#endif /* ETAGCACHE_H */
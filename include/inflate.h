@@ -0,0 +1,128 @@
+#ifndef INFLATE_H
+#define INFLATE_H
+
+/**
+ * @file inflate.h
+ * @brief A gzip or deflate request body, inflated as it arrives.
+ *
+ * A text body arrives a byte per recv() (the MVS 3.8j TCP/IP ring-buffer
+ * workaround, docs/httpd-notes.md), so an upload takes as long as it has
+ * bytes. JCL and source compress four to eight times. A client that sends
+ * Content-Encoding: gzip or deflate pays that many fewer recv() calls, and
+ * receive_body() (common.c) puts this stage between the framing decoder
+ * (bodydec.h) and the handler's sink. The handler still sees plain bytes.
+ *
+ * What is accepted:
+ *  - gzip (RFC 1952), with its optional header fields and the CRC32 and
+ *    length of its trailer checked. Members may follow one another.
+ *  - deflate as HTTP names it: a zlib stream (RFC 1950), with its Adler-32
+ *    checked. Some clients send a bare RFC 1951 stream under that name, and
+ *    that is taken too. A header that does not check as zlib is read as
+ *    deflate data. A zlib stream that wants a preset dictionary is refused.
+ *  - stored, fixed and dynamic Huffman blocks.
+ *
+ * The storage is fixed: one INFLATE, about 38 KB, holds the 32 KB history
+ * every deflate stream may refer back to, the codes and the staging buffer
+ * the sink is called from. Nothing is allocated while inflating. Output is
+ * bounded too: with a `limit`, a stream that inflates past it is refused
+ * (INFL_ELIMIT). A body kept in memory needs that. A body streamed to a
+ * data set or file does not, because its storage does not grow with it.
+ *
+ * The sink gets the inflated bytes from the staging buffer, never from the
+ * history, so it may translate them in place like any BODY_SINK. Whatever
+ * a feed inflates reaches the sink before the feed returns.
+ *
+ * ====================================================================
+ * This TU is portable C: no httpd headers, no MVS services, no statics.
+ * test/host/tstinfl.c inflates a corpus deflated by the test's own encoder
+ * and by zlib, and reports the recv() calls saved.
+ * ====================================================================
+ */
+
+#include <stddef.h>
+
+#include "bodydec.h"
+#include "etag.h"
+
+/* infl_init() wrappers, by Content-Encoding */
+#define INFL_GZIP       1       /* gzip, x-gzip */
+#define INFL_DEFLATE    2       /* deflate: zlib, or a bare deflate stream */
+
+/* infl_feed() and infl_end() answers, besides 0 */
+#define INFL_EDATA      (-1)    /* not a valid stream, or a bad check value */
+#define INFL_ESINK      (-2)    /* the sink failed */
+#define INFL_ELIMIT     (-3)    /* it inflates past the limit */
+#define INFL_ETRUNC     (-4)    /* infl_end(): the stream stopped short */
+
+#define INFL_WSIZE      32768   /* the history a distance may reach into */
+#define INFL_OUTSIZE    4096    /* inflated bytes per sink call, at most */
+
+/* A canonical Huffman code: codes per length, symbols in code order */
+typedef struct infl_huff {
+	short           count[16];
+	short           symbol[288];
+} INFL_HUFF;
+
+typedef struct inflate  INFLATE;
+
+struct inflate {
+	int             state;          /* IFS_*, in inflate.c */
+	int             wrap;           /* INFL_GZIP, or the deflate kind */
+	unsigned long   bits;           /* input bits not yet used, LSB first */
+	unsigned        nbits;
+	int             last;           /* in the stream's last block */
+	int             err;            /* the first failure; sticks */
+
+	unsigned char   hdr[10];        /* a fixed-size header being read */
+	unsigned        have;           /* its bytes so far; a count otherwise */
+	unsigned        need;           /* bytes to skip or copy */
+	unsigned        flags;          /* the gzip FLG byte */
+
+	unsigned        nlen;           /* a dynamic block's code counts */
+	unsigned        ndist;
+	unsigned        ncode;
+	short           lens[320];
+	int             sym;            /* a length or distance symbol, pending */
+	unsigned        length;         /* the match being decoded */
+	INFL_HUFF       lencode;
+	INFL_HUFF       distcode;
+
+	ETAGCTX         crc;            /* gzip: the member's CRC32 */
+	unsigned long   adler;          /* zlib: the stream's Adler-32 */
+	unsigned long   member_out;     /* gzip: the member's length */
+	size_t          limit;          /* inflated bytes allowed, 0 for any */
+	size_t          total_in;
+	size_t          total_out;
+	unsigned        members;        /* gzip members completed */
+
+	unsigned        wpos;           /* next history slot */
+	unsigned        whave;          /* history bytes valid, to INFL_WSIZE */
+	unsigned        olen;
+	/* last, so that infl_init() need not clear them */
+	unsigned char   window[INFL_WSIZE];
+	unsigned char   out[INFL_OUTSIZE];
+};
+
+/**
+ * @brief Start a stream of kind `wrap`, inflating to at most `limit` bytes
+ *        (0: no limit).
+ */
+void infl_init(INFLATE *z, int wrap, size_t limit) asm("INF0001");
+
+/**
+ * @brief Inflate `len` bytes of the stream and hand the result to `sink`.
+ *
+ * @return 0, or INFL_EDATA, INFL_ESINK or INFL_ELIMIT, which every later
+ *         call answers too.
+ */
+int infl_feed(INFLATE *z, const char *buf, size_t len, BODY_SINK sink,
+    void *ctx) asm("INF0002");
+
+/**
+ * @brief The body has ended: 0 if the stream ended with it.
+ *
+ * @return 0, INFL_ETRUNC, or the failure infl_feed() answered.
+ */
+int infl_end(INFLATE *z) asm("INF0003");
+
+#endif /* INFLATE_H */
@@ -0,0 +1,69 @@
+#ifndef JCLCARD_H
+#define JCLCARD_H
+
+/**
+ * @file jclcard.h
+ * @brief A submitted JCL body cut into card images as it arrives.
+ *
+ * The inline submit path used to hold the whole body, translate it, and cut
+ * it into cards with tokenize() into the line table (jclines.h). The JCL
+ * streaming submitter takes the body a receive at a time instead. This
+ * framer gives it the cards that cutting gave, one by one, exactly as
+ * before:
+ *
+ *  - A card ends at the delimiter, which is the EBCDIC NEL the translated LF
+ *    becomes. An empty line is no card at all, because tokenize() skipped
+ *    runs of delimiters. A line of only a CR is an empty card.
+ *  - One trailing CR is dropped, and the card is then cut to 80 columns.
+ *  - The body ends at a NUL. The old copy was a C string, and nothing after
+ *    its first NUL was ever read.
+ *
+ * A card may span any number of feeds.
+ *
+ * ====================================================================
+ * This TU is portable C: no httpd headers, no MVS services, no statics.
+ * test/host/tstjcrd.c cross-checks it against the old tokenize() cutting.
+ * ====================================================================
+ */
+
+#include <stddef.h>
+
+#define JCLCARD_COLS    80
+
+/* Take one card: NUL-terminated, at most JCLCARD_COLS long, possibly
+   empty. 0, or negative to stop the framing; the framer hands that back. */
+typedef int (*JCLCARD_EMIT)(void *ctx, char *card);
+
+typedef struct jclcard  JCLCARD;
+
+struct jclcard {
+	char            card[JCLCARD_COLS + 1];
+	size_t          kept;           /* bytes in card */
+	size_t          full;           /* bytes in the line, past column 80 too */
+	int             last;           /* the line's last byte */
+	int             ended;          /* a NUL was seen: the body is over */
+	unsigned long   cards;
+};
+
+/**
+ * @brief Start a body.
+ */
+void jclcard_init(JCLCARD *jc) asm("JCC0001");
+
+/**
+ * @brief Frame `len` bytes, ending cards at `delim`.
+ *
+ * @return 0, or the first negative answer from `emit`.
+ */
+int jclcard_feed(JCLCARD *jc, const char *buf, size_t len, int delim,
+    JCLCARD_EMIT emit, void *ctx) asm("JCC0002");
+
+/**
+ * @brief The end of the body: the last line is a card even without a
+ *        delimiter after it.
+ *
+ * @return 0, or the negative answer from `emit`.
+ */
+int jclcard_end(JCLCARD *jc, JCLCARD_EMIT emit, void *ctx) asm("JCC0003");
+
+#endif /* JCLCARD_H */
@@ -11,6 +11,9 @@
 
 #include <stddef.h>
 
+#include "arena.h"
+#include "jsontmpl.h"
+
 /** @brief Initial size of JSON buffer in bytes */
 #define JSON_INITIAL_BUFFER_SIZE 	1024
 
@@ -23,11 +26,29 @@
 /** @brief Memory alignment for JSON builder structure */
 #define JSON_BUILDER_ALIGNMENT 		32
 
+/** @brief Window of a streaming builder: twice SEND_BUF_SIZE, so a window
+ *         that is flushed full passes send_all() without a second copy */
+#define JSON_STREAM_WINDOW 			(32 * 1024)
+
+/**
+ * @brief Where a streaming builder's window goes when it is full
+ *
+ * Called with the window's bytes, which the callee may modify in place
+ * (translate them), and which the builder reuses when it returns. Called
+ * once with a NULL buffer when a builder that has already flushed is freed
+ * without finishJsonBuilder(): the document the client has been receiving
+ * will not be completed.
+ *
+ * @return 0 when the bytes are sent, negative on error
+ */
+typedef int (*JsonFlush)(void *ctx, char *buf, size_t len);
+
 /**
  * @brief JSON builder structure for constructing JSON strings
  *
  * Maintains state and buffer for incrementally building JSON content.
- * Uses dynamic memory allocation with automatic growth when needed.
+ * Uses dynamic memory allocation with automatic growth when needed: from
+ * the heap, or from the request's arena when built with createJsonBuilderIn().
  */
 typedef struct json_builder JsonBuilder;
 struct __attribute__((aligned(JSON_BUILDER_ALIGNMENT))) json_builder {
@@ -35,6 +56,11 @@ struct __attribute__((aligned(JSON_BUILDER_ALIGNMENT))) json_builder {
 	char *buffer;
 	size_t size;
 	size_t capacity;
+	ARENA *arena;		/* NULL: builder and buffer are on the heap */
+	JsonFlush flush;	/* NULL: the whole document stays in buffer */
+	void *flush_ctx;
+	size_t flushed;		/* bytes handed to flush so far */
+	int finished;		/* finishJsonBuilder() has run */
 };
 
 /**
@@ -46,6 +72,36 @@ struct __attribute__((aligned(JSON_BUILDER_ALIGNMENT))) json_builder {
  */
 JsonBuilder *createJsonBuilder(void)										asm("JSON000");
 
+/**
+ * @brief Creates a JSON builder whose storage comes from an arena
+ *
+ * The builder and its buffer are allocated from `arena` and grow in place
+ * there while the buffer is the arena's most recent allocation, which it is
+ * for as long as the handler builds nothing else in between. They go back
+ * with the arena; freeJsonBuilder() on such a builder is a no-op and may
+ * still be called, so the cleanup paths do not have to know which kind they
+ * hold. NULL `arena` is createJsonBuilder().
+ *
+ * @param arena Arena to allocate from, normally &session->arena
+ * @return Pointer to new JsonBuilder or NULL on allocation failure
+ */
+JsonBuilder *createJsonBuilderIn(ARENA *arena)								asm("JSON00F");
+
+/**
+ * @brief Grows an empty builder's buffer to `capacity` up front
+ *
+ * For a caller that knows roughly how large the document will be, so the
+ * buffer is allocated once instead of doubling its way there. Called on a
+ * builder fresh from createJsonBuilderIn(), the arena extends the buffer
+ * in place. A smaller `capacity` than the buffer has is a no-op.
+ *
+ * @param builder Pointer to JsonBuilder
+ * @param capacity Bytes, terminator included
+ * @return 0 on success, -1 when the storage is not there; the builder is
+ *         then unchanged and still usable
+ */
+int reserveJsonBuilder(JsonBuilder *builder, size_t capacity)				asm("JSON012");
+
 /**
  * @brief Frees a JSON builder instance
  *
@@ -125,6 +181,22 @@ int startJsonArrayKey(JsonBuilder *builder, const char *key)				asm("JSON00D");
  */
 int addJsonArrayString(JsonBuilder *builder, const char *value)				asm("JSON00E");
 
+/**
+ * @brief Adds one item rendered from a template (jsontmpl.h)
+ *
+ * The item goes in as an element, with a comma before it unless it is the
+ * first: for an array of objects, the template holds the whole object,
+ * braces included. It is rendered straight into the buffer -- in a
+ * streaming builder, into the window -- which grows, or flushes, only when
+ * the item does not fit.
+ *
+ * @param builder Pointer to JsonBuilder
+ * @param t Template
+ * @param v Its slot values
+ * @return 0 on success, negative value on error
+ */
+int addJsonTemplate(JsonBuilder *builder, const JT_OP *t, const JT_VAL *v)	asm("JSON013");
+
 /**
  * @brief Starts a new JSON object
  *
@@ -176,4 +248,35 @@ int startArray(JsonBuilder *builder)										asm("JSON008");
  */
 int endArray(JsonBuilder *builder)											asm("JSON009");
 
+/**
+ * @brief Switches a builder to streaming
+ *
+ * The buffer becomes a window of JSON_STREAM_WINDOW bytes: when the next
+ * piece does not fit, the window's contents go to `flush` and the window
+ * starts over, so the builder holds a window however large the document
+ * grows. A document that never fills the window is never flushed and is
+ * still all in the buffer when it is done -- `flushed` stays 0 -- so the
+ * caller can send it the buffered way, with a Content-Length.
+ *
+ * Every add function then returns -1 when a flush fails, as for a failed
+ * allocation. getJsonString() on a builder that has flushed returns only
+ * the tail.
+ *
+ * @param builder Pointer to JsonBuilder, normally still empty
+ * @param flush Sink for the full window
+ * @param ctx Handed to flush
+ * @return 0 on success, -1 when the window cannot be allocated
+ */
+int streamJsonBuilder(JsonBuilder *builder, JsonFlush flush, void *ctx)	asm("JSON010");
+
+/**
+ * @brief Flushes the rest of a streaming builder and marks it complete
+ *
+ * No-op on a builder that is not streaming.
+ *
+ * @param builder Pointer to JsonBuilder
+ * @return 0 on success, -1 when the flush fails
+ */
+int finishJsonBuilder(JsonBuilder *builder)									asm("JSON011");
+
 #endif // JSON_H
@@ -0,0 +1,103 @@
+#ifndef JSONTMPL_H
+#define JSONTMPL_H
+
+/**
+ * @file jsontmpl.h
+ * @brief Compile-time templates for the JSON of one list item.
+ *
+ * The list endpoints wrote every item as a run of http_printf() or addJson*
+ * calls: the dataset list twenty-two of them per data set, each parsing its
+ * format string again and converting its number through snprintf(), each
+ * with its own trip into the send path. For 10 000 data sets that is the
+ * listing's CPU, not the catalog walk.
+ *
+ * A template is a `static const` table of JT_OPs: literal fragments, whose
+ * lengths the compiler counts, and typed slots that take their value from
+ * the item's JT_VAL array. jt_render() walks the table once and writes the
+ * item where it will be sent from -- the send buffer, the JSON builder --
+ * with the numbers formatted by hand. Nothing is parsed at run time.
+ *
+ * Slots, all reading v[n]:
+ *
+ *   JT_STR    "s" quoted, as is; NULL is null
+ *   JT_ESC    "s" quoted, with " \ CR LF TAB escaped as addJsonStringEsc()
+ *             does; NULL is null
+ *   JT_FIX    "s" quoted, at most `w` bytes -- a fixed-width field that
+ *             need not be terminated, as %.<w>s
+ *   JT_RAW    s as is, no quotes: a separator, part of a URL
+ *   JT_UINT   u in decimal, zero-padded to `w` digits (0: none)
+ *   JT_DATE   u as yyyymmdd (JT_YMD) written y<sep>mm<sep>dd
+ *   JT_TIME   u as hhmmss (JT_HMS) written hh:mm:ss
+ *   JT_IF     the next `k` ops only when u is not 0
+ *
+ * The templates themselves live with the data they describe -- see
+ * listitem.h for the four list items.
+ *
+ * ====================================================================
+ * This TU is portable C: no httpd headers, no MVS services, no statics.
+ * Where the bytes go is the caller's -- send_item() in common.c,
+ * addJsonTemplate() in json.c; test/host/tstjtmp.c drives the real
+ * renderer against the printf path it replaces.
+ * ====================================================================
+ */
+
+#include <stddef.h>
+
+/** @brief Op codes; see the JT_ macros. */
+enum {
+    JTO_END = 0,
+    JTO_LIT,
+    JTO_STR,
+    JTO_ESC,
+    JTO_FIX,
+    JTO_RAW,
+    JTO_UINT,
+    JTO_DATE,
+    JTO_TIME,
+    JTO_IF
+};
+
+/** @brief One step of a template. */
+typedef struct jt_op {
+    unsigned char   op;             /**< JTO_ */
+    unsigned char   arg;            /**< width, separator or ops to skip */
+    unsigned short  n;              /**< JTO_LIT: length; else the slot */
+    const char     *lit;            /**< JTO_LIT: the text */
+} JT_OP;
+
+/** @brief One slot's value. */
+typedef struct jt_val {
+    const char     *s;
+    unsigned        u;
+} JT_VAL;
+
+#define JT_LIT(text)    { JTO_LIT, 0, sizeof(text) - 1, text }
+#define JT_STR(i)       { JTO_STR, 0, (i), NULL }
+#define JT_ESC(i)       { JTO_ESC, 0, (i), NULL }
+#define JT_FIX(i, w)    { JTO_FIX, (w), (i), NULL }
+#define JT_RAW(i)       { JTO_RAW, 0, (i), NULL }
+#define JT_UINT(i, w)   { JTO_UINT, (w), (i), NULL }
+#define JT_DATE(i, sep) { JTO_DATE, (sep), (i), NULL }
+#define JT_TIME(i)      { JTO_TIME, 0, (i), NULL }
+#define JT_IF(i, k)     { JTO_IF, (k), (i), NULL }
+#define JT_END          { JTO_END, 0, 0, NULL }
+
+/** @brief A date for JT_DATE, a time for JT_TIME. */
+#define JT_YMD(y, m, d) ((unsigned) (y) * 10000u + (unsigned) (m) * 100u + \
+                         (unsigned) (d))
+#define JT_HMS(h, m, s) ((unsigned) (h) * 10000u + (unsigned) (m) * 100u + \
+                         (unsigned) (s))
+
+/**
+ * @brief Render one item.
+ *
+ * @param out   Where the item goes; it is not terminated.
+ * @param size  Bytes at out.
+ * @return Bytes written, or -1 when the item does not fit in `size` --
+ *         `out` then holds part of it, and the caller tries again with
+ *         more room.
+ */
+int jt_render(const JT_OP *t, const JT_VAL *v, char *out, size_t size)
+    asm("JTM0001");
+
+#endif /* JSONTMPL_H */
@@ -0,0 +1,104 @@
+#ifndef LASTMOD_H
+#define LASTMOD_H
+
+/**
+ * @file lastmod.h
+ * @brief Last-Modified and If-Modified-Since from MVS and UFS metadata.
+ *
+ * An ETag costs a read of the whole resource. A date validator costs what the
+ * date costs to find: a directory entry, a ufs_stat(). The dates are
+ *
+ *   - a member: the ISPF statistics in its directory entry, changed date and
+ *     time. A member without them -- written by a utility, or by mvsMF's own
+ *     PUT, whose STOW carries no user data -- gets no date.
+ *   - a USS file: its mtime.
+ *
+ * A sequential data set gets no date. The format-1 DSCB's DS1REFD is when
+ * the data set was last referenced, not changed: a read moves it, and a
+ * write on a day it was already read leaves it alone.
+ *
+ * The ISPF dates are local time and coarse: a minute, a second. Each is read
+ * as the *last* second it can stand for, in UTC, and a date whose span is not
+ * over yet is no date at all: a member saved this minute could still change
+ * within the span and keep the date it has, and a 304 against that would
+ * hand back content that is gone. The next request after the span gets the
+ * date. No validator is better than one that does not move when the content
+ * does.
+ *
+ * Times are seconds since 1970 in an unsigned long: 32 bits on MVS, which
+ * carries them to 2106.
+ *
+ * ====================================================================
+ * This TU is portable C: no httpd headers, no MVS services, no statics.
+ * Reading the directory and the stat is the caller's (dsapi.c, ussapi.c).
+ * test/host/tstlmod.c drives the real conversions.
+ * ====================================================================
+ */
+
+#include <stddef.h>
+
+/** @brief "Sun, 06 Nov 1994 08:49:37 GMT" and its NUL */
+#define LASTMOD_SIZE    30
+
+/**
+ * @brief Day of the year, 1 to 366, of a calendar date.
+ *
+ * @return The day, or 0 for a date that does not exist.
+ */
+int lm_yday(int year, int mon, int mday) asm("LMD0001");
+
+/**
+ * @brief Seconds since 1970 of a UTC date and time.
+ *
+ * @param yday Day of the year, from 1.
+ * @return The time, or 0 for a date before 1970 or after 2105, or fields
+ *         out of range.
+ */
+unsigned long lm_time(int year, int yday, int hour, int min, int sec)
+    asm("LMD0002");
+
+/**
+ * @brief The end of the second, or minute, the ISPF statistics name.
+ *
+ * `udata` is a member's directory user data. The statistics are 30 bytes or
+ * more of it: the changed date packed as 0cyydddF at +8, hours and minutes
+ * packed at +12 and +13, and seconds at +3 where the editor kept them. With
+ * no seconds the stamp is read as the end of its minute.
+ *
+ * @return 0 with *t set; -1 when there are no statistics, they do not
+ *         decode, or their span is not over.
+ */
+int lm_ispf(const unsigned char *udata, size_t len, long tzadjust,
+    unsigned long now, unsigned long *t) asm("LMD0004");
+
+/**
+ * @brief Render a time as an HTTP date (IMF-fixdate).
+ *
+ * @param out At least LASTMOD_SIZE bytes.
+ * @return 0, or -1 if out is too small.
+ */
+int lm_format(unsigned long t, char *out, size_t outlen) asm("LMD0005");
+
+/**
+ * @brief Parse an HTTP date.
+ *
+ * The IMF-fixdate a server sends, and the two obsolete forms RFC 9110 asks
+ * a recipient to accept: RFC 850 ("Sunday, 06-Nov-94 08:49:37 GMT") and
+ * asctime ("Sun Nov  6 08:49:37 1994").
+ *
+ * @return 0 with *t set, -1 for anything else.
+ */
+int lm_parse(const char *s, unsigned long *t) asm("LMD0006");
+
+/**
+ * @brief Does If-Modified-Since hold for a resource last modified at `t`?
+ *
+ * An absent or unparseable value, or a date later than `now`, is ignored --
+ * a client's future date would otherwise turn every change into a 304.
+ *
+ * @return 1 when the 304 may be answered, 0 otherwise.
+ */
+int lm_unmodified(unsigned long t, const char *since, unsigned long now)
+    asm("LMD0007");
+
+#endif /* LASTMOD_H */
@@ -0,0 +1,103 @@
+#ifndef LISTITEM_H
+#define LISTITEM_H
+
+/**
+ * @file listitem.h
+ * @brief The JSON templates of the four list items (jsontmpl.h).
+ *
+ * One template per list, each with the slots its handler fills in before
+ * every item:
+ *
+ *   LIST_DATASET  datasetListHandler()  dsapi.c
+ *   LIST_MEMBER   member_scan()         dsapi.c
+ *   LIST_USS      ussListHandler()      ussapi.c
+ *   LIST_JOB      process_job()         jobsapi.c
+ *
+ * The bytes are the ones the printf and addJson* calls they replace wrote,
+ * layout included: a client that diffs a listing sees nothing change.
+ * The three files-service items carry their separator as a slot
+ * (`"    "` before the first item, `"   ,"` before the others); the job
+ * item goes into a JsonBuilder, which adds its own comma.
+ *
+ * ====================================================================
+ * Portable C, compile-time data: test/host/tstjtmp.c #includes
+ * src/listitem.c and checks every template against the printf path.
+ * ====================================================================
+ */
+
+#include "jsontmpl.h"
+
+/** @brief Template ids for list_template(). */
+enum {
+    LIST_DATASET = 0,
+    LIST_MEMBER,
+    LIST_USS,
+    LIST_JOB,
+    LIST_COUNT
+};
+
+/** @brief LIST_DATASET slots. */
+enum {
+    DSI_SEP = 0,        /**< raw: separator */
+    DSI_DSNAME,         /**< fix 44 */
+    DSI_BLKSZ,          /**< uint */
+    DSI_CDATE,          /**< date, JT_YMD */
+    DSI_DEV,            /**< fix 4 */
+    DSI_DSNTP,          /**< str */
+    DSI_DSORG,          /**< fix 4 */
+    DSI_EXTX,           /**< uint */
+    DSI_LRECL,          /**< uint */
+    DSI_RDATE,          /**< date, JT_YMD */
+    DSI_RECFM,          /**< fix 4 */
+    DSI_SIZEX,          /**< uint */
+    DSI_SPACU,          /**< str */
+    DSI_USED,           /**< uint, percent */
+    DSI_VOL,            /**< fix 6, written as vol and vols */
+    DSI_COUNT
+};
+
+/** @brief LIST_MEMBER slots. */
+enum {
+    MBI_SEP = 0,        /**< raw: separator */
+    MBI_MEMBER,         /**< str, escaped by the caller */
+    MBI_COUNT
+};
+
+/** @brief LIST_USS slots. */
+enum {
+    USI_SEP = 0,        /**< raw: separator */
+    USI_NAME,           /**< str */
+    USI_MODE,           /**< str */
+    USI_SIZE,           /**< uint */
+    USI_USER,           /**< str */
+    USI_GROUP,          /**< str */
+    USI_LINKS,          /**< uint */
+    USI_MDATE,          /**< date, JT_YMD, UTC */
+    USI_MTIME,          /**< time, JT_HMS, UTC */
+    USI_INODE,          /**< uint */
+    USI_COUNT
+};
+
+/** @brief LIST_JOB slots. */
+enum {
+    JBI_JOBNAME = 0,    /**< str, and raw in the URLs */
+    JBI_JOBID,          /**< str, raw in the URLs, fix 3 as the type */
+    JBI_OWNER,          /**< str */
+    JBI_CLASS,          /**< fix 3 */
+    JBI_SCHEME,         /**< raw */
+    JBI_HOST,           /**< raw */
+    JBI_STATUS,         /**< str */
+    JBI_RETCODE,        /**< str, NULL is null */
+    JBI_EXEC,           /**< if: exec-started and exec-ended follow */
+    JBI_STARTED,        /**< str, NULL is null */
+    JBI_ENDED,          /**< str, NULL is null */
+    JBI_COUNT
+};
+
+/**
+ * @brief The template of a list item.
+ * @return NULL for an id out of range.
+ */
+const JT_OP *list_template(int list) asm("LIT0001");
+
+#endif /* LISTITEM_H */
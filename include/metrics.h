@@ -0,0 +1,168 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+/**
+ * @file metrics.h
+ * @brief Per-route request metrics, kept across requests in MVSMF_CTX.
+ *
+ * There was no way to see how long a route takes. logging_middleware is
+ * compiled out, and all it did was WTO the environment. What is needed under
+ * Zowe Explorer load is per-endpoint p50/p99, and that needs numbers that
+ * outlive the request -- httpd re-LINKs MVSMF for every one, so nothing in
+ * the module's own storage survives.
+ *
+ * The block therefore hangs off MVSMF_CTX (mvsmfctx.h), like the cursor
+ * store: GETMAINed once in subpool 0, for the life of the address space.
+ * Each route id has one MET_ROUTE slot, plus one for requests no route
+ * accepted:
+ *
+ *   - requests answered, and by status class (1xx..5xx);
+ *   - body bytes received (the declared Content-Length, or POST_STRING when
+ *     httpd read the body) and body bytes sent through send_all();
+ *   - latency, from STCK at the top of handle_request() to the return, in
+ *     microseconds: a sum, a maximum and a histogram with one bucket per
+ *     power of two -- log-bucketed, so 28 counters span 1 us to minutes
+ *     and any quantile is known to within a factor of two.
+ *
+ * The router updates a slot under the block's latch (lock()/unlock() on the
+ * block, LOCK_EXC) -- a few dozen stores, no I/O, no SVC. Readers render
+ * without the latch: a torn read shows one request half-counted, which a
+ * monitoring scrape can live with, and it keeps /zosmf/test?fn=metrics from
+ * ever making a worker wait.
+ *
+ * Sums are doubles. libc370's printf has no %llu and 32-bit counters of
+ * bytes would wrap within hours; a double holds an exact integer to 2^53.
+ *
+ * ====================================================================
+ * This TU is portable C: no httpd headers, no MVS services, no statics.
+ * Timing, latching and the anchor are the caller's (router.c,
+ * mvsmfctx.c); test/host/tstmetr.c drives the real recorder and
+ * renderers.
+ * ====================================================================
+ */
+
+#include <stddef.h>
+
+#include "routetab.h"
+
+#define MET_EYE         "MVSMFMET"  /* 8 bytes, no NUL in the block */
+#define MET_VERSION     2           /* 2: json_hint */
+
+/** @brief Slots: one per route id, the last for "no route". Ample room over
+ *         ROUTE_COUNT, so adding an endpoint does not change the layout. */
+#define MET_SLOTS       64
+#define MET_UNMATCHED   (MET_SLOTS - 1)
+
+/** @brief Latency buckets. Bucket i counts [2^i, 2^(i+1)) us -- bucket 0
+ *         also takes 0 -- and the last one everything from 2^27 us (134 s). */
+#define MET_BUCKETS     28
+
+/** @brief Largest JSON buffer metrics_presize() will ask for. A route
+ *         whose documents are larger streams them (json.h), or grows as
+ *         before. */
+#define MET_PRESIZE_MAX (256 * 1024)
+
+/** @brief One route's counters. */
+typedef struct met_route {
+    unsigned    count;              /**< requests answered */
+    unsigned    status[5];          /**< by class: [0] 1xx .. [4] 5xx */
+    unsigned    usec_max;           /**< slowest request */
+    unsigned    json_hint;          /**< buffered JSON body size, learned */
+    unsigned    hist[MET_BUCKETS];  /**< latency histogram, log2 us */
+    double      usec_sum;           /**< total latency */
+    double      bytes_in;           /**< body bytes received */
+    double      bytes_out;          /**< body bytes sent */
+} MET_ROUTE;
+
+/** @brief The block anchored in MVSMF_CTX. */
+typedef struct mvsmf_metrics {
+    char            eye[8];         /**< MET_EYE */
+    unsigned short  len;            /**< sizeof(MVSMF_METRICS) */
+    unsigned short  ver;            /**< MET_VERSION */
+    unsigned        since;          /**< time() the counting started */
+    MET_ROUTE       route[MET_SLOTS];
+} MVSMF_METRICS;
+
+/** @brief Output sink for the renderers: text, NUL-terminated. Returns
+ *         negative to stop. */
+typedef int (*MET_EMIT)(void *ctx, const char *text);
+
+/**
+ * @brief Stamp an empty block.
+ */
+void metrics_init(MVSMF_METRICS *m, unsigned since) asm("MET0001");
+
+/**
+ * @brief Is this a block of this layout?
+ *
+ * A module of a different layout may have anchored the block first -- the
+ * address space outlives any one MVSMF -- and is then not to be written.
+ */
+int metrics_valid(const MVSMF_METRICS *m) asm("MET0002");
+
+/**
+ * @brief The slot of a route id; MET_UNMATCHED for -1 or out of range.
+ */
+int metrics_slot(int route) asm("MET0003");
+
+/**
+ * @brief The histogram bucket of a latency.
+ */
+int metrics_bucket(unsigned usec) asm("MET0004");
+
+/**
+ * @brief Count one request. The caller holds the latch.
+ *
+ * @param status     HTTP status sent, 0 if none was.
+ */
+void metrics_record(MVSMF_METRICS *m, int slot, int status, double bytes_in,
+    double bytes_out, unsigned usec) asm("MET0005");
+
+/**
+ * @brief Learn the size of a buffered JSON body the route produced.
+ *
+ * The hint follows a larger body at once and a smaller one by a 32nd of
+ * the difference, so it sits near the route's large documents rather than
+ * its average: pre-sizing for the average still reallocates for half of
+ * them. The caller holds the latch.
+ */
+void metrics_size(MET_ROUTE *r, unsigned size) asm("MET0009");
+
+/**
+ * @brief The capacity to give a route's next JSON builder.
+ *
+ * The hint and an eighth over it, at most MET_PRESIZE_MAX; 0 while the
+ * route has produced no buffered JSON. Read without the latch -- a torn
+ * hint only sizes one buffer wrong, and the builder still grows.
+ */
+unsigned metrics_presize(const MET_ROUTE *r) asm("MET000A");
+
+/**
+ * @brief Latency quantile from the histogram.
+ *
+ * @param permille  500 for p50, 990 for p99.
+ * @return The upper bound, in us, of the bucket holding the quantile --
+ *         never below it, at most twice it. 0 for an empty slot.
+ */
+unsigned metrics_quantile(const MET_ROUTE *r, unsigned permille)
+    asm("MET0006");
+
+/**
+ * @brief Render every slot with requests as one JSON document.
+ *
+ * @param tab  Route table, for the route labels.
+ * @return 0, or the first negative emit() return.
+ */
+int metrics_render_json(const MVSMF_METRICS *m, const ROUTETAB *tab,
+    MET_EMIT emit, void *ctx) asm("MET0007");
+
+/**
+ * @brief Render every slot with requests in the Prometheus text format
+ *        (version 0.0.4).
+ *
+ * @return 0, or the first negative emit() return.
+ */
+int metrics_render_prom(const MVSMF_METRICS *m, const ROUTETAB *tab,
+    MET_EMIT emit, void *ctx) asm("MET0008");
+
+#endif /* METRICS_H */
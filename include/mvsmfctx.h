@@ -6,11 +6,14 @@
  * @brief Per-CGI persistent mvsMF context block + cursor store accessor.
  *
  * httpd's cgictx service hands each CGI one persistent context block, keyed by
- * an 8-byte eyecatcher. mvsMF hangs request-spanning globals (currently the
- * console cursor store) off MVSMF_CTX. See issue #143.
+ * an 8-byte eyecatcher. mvsMF hangs request-spanning globals (the console
+ * cursor store, the per-route metrics, the ETag cache) off MVSMF_CTX. See
+ * issue #143.
  */
 
 #include "ntstore.h"
+#include "metrics.h"
+#include "etagcache.h"
 
 #define MVSMF_CTX_EYE  "MVSMFCTX"        /* 8 bytes, stamped by http_cgictx_get */
 
@@ -19,7 +22,9 @@ typedef struct mvsmf_ctx {
     unsigned short  len;         /* 08 sizeof(MVSMF_CTX)                        */
     unsigned short  ver;         /* 0A layout version (>= 1)                    */
     void           *kvstore;     /* 0C NT_STORE *, lazily created               */
-    void           *rsvd[4];     /* 10 room for future request-spanning globals */
+    void           *metrics;     /* 10 MVSMF_METRICS *, lazily created          */
+    void           *etags;       /* 14 ETAG_CACHE *, lazily created             */
+    void           *rsvd[2];     /* 18 room for future request-spanning globals */
 } MVSMF_CTX;
 
 /** The per-CGI persistent context from httpd's cgictx. NULL if the cgictx
@@ -29,4 +34,22 @@ MVSMF_CTX *mvsmf_ctx_get(void *httpd)                                  asm("MVCT
 /** The cursor store anchored in the context, lazily created. NULL on failure. */
 NT_STORE *mvsmf_kvstore(void *httpd)                                   asm("MVKVSGET");
 
+/** The per-route metrics block (metrics.h) anchored in the context, lazily
+ *  created. NULL when there is no context or no storage: requests are then
+ *  simply not counted. */
+MVSMF_METRICS *mvsmf_metrics(void *httpd)                              asm("MVMETGET");
+
+/** The ETag cache (etagcache.h) anchored in the context, lazily created.
+ *  NULL unless MVSMF_ETAG_CACHE is set in the server environment, and when
+ *  there is no context or no storage: every stamp is then read. */
+ETAG_CACHE *mvsmf_etags(void *httpd)                                   asm("MVETCGET");
+
+/** etc_lookup() under the cache's latch. */
+int mvsmf_etag_get(ETAG_CACHE *c, const char *key, const void *meta,
+                   size_t mlen, char *etag)                            asm("MVETCLKP");
+
+/** etc_store() under the cache's latch; etag NULL is etc_forget(). */
+void mvsmf_etag_put(ETAG_CACHE *c, const char *key, const void *meta,
+                    size_t mlen, const char *etag)                     asm("MVETCPUT");
+
 #endif /* MVSMFCTX_H */
@@ -45,11 +45,11 @@
  * MVSMF0xx -- router, CGI entry, shared request handling
  */
 
-/** MVSMF001E route table is full; routes after this one are not registered */
-#define MSG_ROUTES_FULL		"MVSMF001E ROUTE TABLE FULL, LIMIT %d REACHED"
-
-/** MVSMF002E add_route() called without a pattern or without a handler */
-#define MSG_ROUTE_INVALID	"MVSMF002E INVALID ROUTE DEFINITION, PATTERN OR HANDLER MISSING"
+/* MVSMF001E and MVSMF002E retired with add_route(). The route table is const
+ * data now (routes.c), so there is no run-time registration that can overflow
+ * a fixed table or be handed a missing pattern or handler -- both were build
+ * problems, and test/host/tstrout.c catches the table ones before a build
+ * ships. The ids are burned, not reusable. */
 
 /** MVSMF003E middleware table is full; later middlewares do not run */
 #define MSG_MIDDLEWARES_FULL	"MVSMF003E MIDDLEWARE TABLE FULL, LIMIT %d REACHED"
@@ -69,6 +69,13 @@
 /** MVSMF008W the client stopped reading mid-response and the send gave up */
 #define MSG_SEND_TIMEOUT	"MVSMF008W SEND TIMED OUT AFTER %d RETRIES"
 
+/** MVSMF009W a request ran past MVSMF_TRACE_MS; method, path, ms, status.
+ *  The path is cut at 64 so the line stays inside one WTO. */
+#define MSG_SLOW_REQUEST	"MVSMF009W SLOW REQUEST %s %.64s %u MS STATUS %d"
+
+/** MVSMF010I the phases of the request in the MVSMF009W before it */
+#define MSG_SLOW_PHASES		"MVSMF010I PHASES %s"
+
 /*
  * MVSMF1xx -- data sets (restfiles/ds)
  */
@@ -93,6 +100,18 @@
 /** MVSMF105E member rename failed after the target was found free */
 #define MSG_MBR_RENAME_FAILED	"MVSMF105E RENAME %s(%s) TO (%s) FAILED RC=%d"
 
+/** MVSMF106W a block read did not hold what the data set's RECFM says; %d is
+ *  the DBK_E* code from deblock.h */
+#define MSG_DS_DEBLOCK		"MVSMF106W READ OF %s STOPPED, BLOCK DOES NOT MATCH ITS RECFM (%d)"
+
+/** MVSMF107E a read-ahead or write-behind subtask abended; the first %s is
+ *  READ-AHEAD or WRITE-BEHIND, the second the data set */
+#define MSG_DS_SUBTASK_ABEND	"MVSMF107E %s SUBTASK FOR %s ABENDED S%03X U%04d"
+
+/** MVSMF108W such a subtask was still running when the worker had to stop
+ *  waiting for it, and was detached */
+#define MSG_DS_SUBTASK_DETACH	"MVSMF108W %s SUBTASK FOR %s DID NOT END, DETACHED"
+
 /*
  * MVSMF2xx -- jobs (restjobs)
  */
@@ -118,6 +137,9 @@
 /** MVSMF207E JESCANJ returned a code this build does not know */
 #define MSG_JESCANJ_RC		"MVSMF207E JESCANJ RETURNED RC=%d"
 
+/** MVSMF208W a submission failed part-way; the job read so far was deleted */
+#define MSG_INTRDR_CANCEL	"MVSMF208W JOB %s DELETED, ITS JCL DID NOT ARRIVE WHOLE"
+
 /*
  * MVSMF9xx -- abend recovery and diagnostics
  */
@@ -152,13 +174,27 @@
 /** MVSMF910W a second JES handle was opened while one was still held */
 #define MSG_JES_TRACKED		"MVSMF910W SESSION ALREADY HOLDS A JES HANDLE, THIS ONE NOT TRACKED"
 
+/** MVSMF911W recovery's arena release abended; %u bytes are written off */
+#define MSG_RECOVERY_ARENA	"MVSMF911W RECOVERY ARENA RELEASE ABENDED, %u BYTES STAY HELD"
+
+/** MVSMF912W recovery's stop of a data set subtask abended in turn; %s is
+ *  READ-AHEAD or WRITE-BEHIND */
+#define MSG_RECOVERY_SUBTASK	"MVSMF912W RECOVERY STOP OF THE %s SUBTASK ABENDED"
+
+/** MVSMF913I recovery is deleting the job in an internal reader a submission
+ *  left open, and closing it */
+#define MSG_RECOVERY_INTRDR	"MVSMF913I RECOVERY DELETING THE JOB IN THE INTERNAL READER"
+
+/** MVSMF914W the recovery cancel or close of the internal reader abended */
+#define MSG_RECOVERY_INTRDR_ABEND	"MVSMF914W RECOVERY CLOSE OF THE INTERNAL READER ABENDED, CHECK THE JES2 QUEUE"
+
 /*
  * Arguments for MSG_STORAGE_FAILED -- uppercase, since they are substituted
  * into an uppercase literal.
  */
 #define ALLOC_REQUEST_BODY	"THE REQUEST BODY"
-#define ALLOC_JCL_TEXT		"THE JCL TEXT"
 #define ALLOC_JCL_LINES		"THE JCL LINE TABLE"
 #define ALLOC_SPOOL_BLOCK	"A SPOOL BLOCK"
+#define ALLOC_BODY_INFLATER	"THE BODY INFLATER"
 
 #endif /* MVSMFMSG_H */
@@ -0,0 +1,115 @@
+#ifndef RDAHEAD_H
+#define RDAHEAD_H
+
+/**
+ * @file rdahead.h
+ * @brief Read-ahead: two block buffers between a reader and a sender.
+ *
+ * A data set GET reads a block, sends its records, reads the next block.
+ * While the block is read the socket is idle, and while it is sent the
+ * volume is. For a data set of a few MB the time is the sum of the two.
+ *
+ * With two buffers the reads and the sends can overlap. A reader subtask
+ * fills buffer N+1 while the worker deblocks and sends buffer N. The time
+ * comes down towards the larger of the two, disk or network, plus one
+ * block of the other.
+ *
+ * This is the schedule only. Neither side blocks in here. A call that
+ * cannot go ahead returns RDA_WAIT, and the caller waits for the other
+ * side's post and calls again. On MVS that is an ECB and the
+ * cthread_timed_wait() loop in dsread.c, with its abort checks. The host
+ * test runs both sides on a simulated clock. The slots are handed over
+ * strictly in turn:
+ *
+ *   reader   rdahead_slot()  -> a free buffer to fill
+ *            rdahead_filled() with the bytes read, 0 at end, <0 on error
+ *   sender   rdahead_take()  -> the next full buffer, or the end
+ *            rdahead_release() when it is done with it
+ *
+ * The state of a slot is written after its contents and read before them.
+ * The reader changes only FREE slots and the sender only FULL ones, so the
+ * two sides never write the same field at once.
+ *
+ * ====================================================================
+ * This TU is portable C: no httpd headers, no MVS services, no statics.
+ * test/host/tstrdah.c drives it with simulated disk and network latencies.
+ * ====================================================================
+ */
+
+#include <stddef.h>
+
+#define RDAHEAD_NBUF    2
+
+/* the return when a call has to wait for the other side */
+#define RDA_WAIT        2
+
+/* slot states */
+#define RDA_FREE        0       /* the reader's to fill */
+#define RDA_FULL        1       /* a block, the sender's to take */
+#define RDA_END         2       /* no more blocks: the end of the data */
+#define RDA_FAIL        3       /* no more blocks: the read failed */
+
+typedef struct rdahead  RDAHEAD;
+
+struct rdahead {
+	struct {
+		unsigned char   *buf;
+		size_t          len;
+		volatile int    state;
+	} slot[RDAHEAD_NBUF];
+	size_t          size;           /* of each buffer */
+	unsigned        fill;           /* the slot the reader fills next */
+	unsigned        take;           /* the slot the sender takes next */
+	int             held;           /* the sender has slot[take] */
+	volatile int    stop;           /* the sender wants no more */
+	unsigned long   blocks;         /* filled */
+	unsigned long   reader_waits;   /* RDA_WAIT answers, each side */
+	unsigned long   sender_waits;
+};
+
+/**
+ * @brief Start over two buffers of `size` bytes each, both free.
+ */
+void rdahead_init(RDAHEAD *ra, unsigned char *buf0, unsigned char *buf1,
+    size_t size) asm("RDA0001");
+
+/**
+ * @brief The reader's next buffer.
+ *
+ * @return 1 with *buf set (`size` bytes); RDA_WAIT when the sender still
+ *         has it; 0 when the sender stopped or the end was already given.
+ */
+int rdahead_slot(RDAHEAD *ra, unsigned char **buf) asm("RDA0002");
+
+/**
+ * @brief The reader filled the buffer rdahead_slot() gave it: `n` bytes,
+ *        0 for the end of the data, negative for a failed read. After the
+ *        end or a failure the reader is done.
+ */
+void rdahead_filled(RDAHEAD *ra, long n) asm("RDA0003");
+
+/**
+ * @brief The sender's next block, in the order read.
+ *
+ * @return 1 with *buf and *len set; RDA_WAIT when it is not read yet; 0 at
+ *         the end of the data; -1 when the read failed. The block is the
+ *         sender's until rdahead_release().
+ */
+int rdahead_take(RDAHEAD *ra, const unsigned char **buf, size_t *len)
+    asm("RDA0004");
+
+/**
+ * @brief Hand the block rdahead_take() gave back to the reader.
+ *
+ * @return 1 when a block went back -- the reader may be waiting for it --
+ *         0 when the sender held none.
+ */
+int rdahead_release(RDAHEAD *ra) asm("RDA0005");
+
+/**
+ * @brief The sender is done, early: the reader's next rdahead_slot()
+ *        returns 0.
+ */
+void rdahead_stop(RDAHEAD *ra) asm("RDA0006");
+
+#endif /* RDAHEAD_H */
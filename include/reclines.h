@@ -79,6 +79,29 @@ void recline_init(RECLINE *rl, char *buf, size_t content_max)	asm("MFRECINI");
 int recline_put(RECLINE *rl, char c, char **rec, size_t *rec_len)
 														asm("MFRECPUT");
 
+/* recline_feed()'s record sink: 0 to go on, negative to stop the feed. The
+   record is in the RECLINE's buffer and may be changed in place (write_record()
+   translates it); it is only valid for the call. */
+typedef int (*RECLINE_EMIT)(void *ctx, char *rec, size_t rec_len);
+
+/**
+ * Feed `len` bytes at once: recline_put() over every one of them, without
+ * a call per byte.
+ *
+ * Each run of content up to the next CR or LF is found with memchr() and
+ * copied into the record buffer in one piece, and `emit` is called once per
+ * record the bytes complete. Every rule above holds exactly as for
+ * recline_put(), and the two may be mixed on one RECLINE: a CRLF split
+ * across two feeds, a blank line, a truncated record and the sticky flag
+ * are all the same. What is left of the last line stays pending for the
+ * next feed or recline_flush().
+ *
+ * Returns 0, or the first negative value `emit` returned -- the rest of the
+ * bytes are then not framed, as the caller is abandoning the body.
+ */
+int recline_feed(RECLINE *rl, const char *buf, size_t len,
+	RECLINE_EMIT emit, void *ctx)				asm("MFRECFED");
+
 /**
  * Take the trailing record of a body that did not end in a terminator.
  *
@@ -0,0 +1,115 @@
+#ifndef RECWRITE_H
+#define RECWRITE_H
+
+/**
+ * @file recwrite.h
+ * @brief Records gathered into a block-sized buffer before they are written.
+ *
+ * write_record() used to fwrite() each record and fflush() it at once. The
+ * flush is what told libc370 the record had ended, and it is also a write of
+ * whatever block the access method was building: a 5 000-line member upload
+ * became 5 000 physical writes, and the member 5 000 short blocks.
+ *
+ * A record can be ended without a flush. In text mode the record delimiter
+ * is '\n' in the stream, and a binary F record of exactly LRECL bytes ends
+ * itself. recwrite collects such records -- each followed by the newline
+ * where there is one -- in a buffer of BLKSIZE bytes and hands the buffer to
+ * the sink when the next record does not fit, and once more at the end. The
+ * access method then sees a stream with no flush in it until the close, and
+ * fills every block.
+ *
+ * Order is the caller's to keep: a record that has to go out on its own
+ * (a short binary record, which only a flush can end) must be preceded by
+ * recwrite_flush().
+ *
+ * The writer can also stamp what it writes (recwrite_stamp()), so that a PUT
+ * answering X-IBM-Return-Etag does not read the target back to get the
+ * stamp. The fold is dataset_etag()'s, etag_update() per record, over the
+ * record as the data set will hold it: a fixed record shorter than LRECL is
+ * folded padded, as the access method pads it. Records that go out past the
+ * writer are folded with recwrite_note(). Where the padding is not known -- a
+ * short fixed record outside text mode -- the stamp is given up, and the
+ * caller reads the target back as before.
+ *
+ * ====================================================================
+ * This TU is portable C: no httpd headers, no MVS services, no statics.
+ * test/host/tstrecw.c drives it against a model of the access method.
+ * ====================================================================
+ */
+
+#include <stddef.h>
+
+#include "etag.h"
+
+/* recwrite_init() `nl` for records that carry no delimiter */
+#define RECWRITE_NONL   (-1)
+
+/* recwrite_stamp() `fill` when what pads a short fixed record is not known */
+#define RECWRITE_NOFILL (-1)
+
+/* Write `len` bytes; 0, or -1 when they could not be written. */
+typedef int (*RECWRITE_SINK)(void *ctx, const void *data, size_t len);
+
+typedef struct recwrite RECWRITE;
+
+struct recwrite {
+	unsigned char   *buf;
+	size_t          size;
+	size_t          used;
+	int             nl;             /* appended to every record, or NONL */
+	RECWRITE_SINK   sink;
+	void            *ctx;
+	unsigned long   records;
+	unsigned long   writes;         /* sink calls */
+	int             stamping;       /* 1 folding, 0 not asked, -1 given up */
+	size_t          fixlen;         /* records are stored this long, or 0 */
+	int             fill;           /* ...padded with this, or NOFILL */
+	ETAGCTX         stamp;
+};
+
+/**
+ * @brief Start a writer over `buf` of `size` bytes, normally the BLKSIZE.
+ */
+void recwrite_init(RECWRITE *rw, unsigned char *buf, size_t size, int nl,
+    RECWRITE_SINK sink, void *ctx) asm("RCW0001");
+
+/**
+ * @brief Add one record. A zero-length record is still a record: with a
+ *        delimiter it is one on its own.
+ *
+ * @return 0, or -1 when the sink failed; the records not yet written are
+ *         then lost with the request.
+ */
+int recwrite_put(RECWRITE *rw, const void *rec, size_t len) asm("RCW0002");
+
+/**
+ * @brief Write what is buffered. Before the close, and before anything
+ *        written past the writer.
+ */
+int recwrite_flush(RECWRITE *rw) asm("RCW0003");
+
+/**
+ * @brief Stamp the records from here on. After recwrite_init(), before the
+ *        first record.
+ *
+ * @param fixlen LRECL for a fixed-length target, 0 for V and U.
+ * @param fill   What the access method pads a short fixed record with, or
+ *               RECWRITE_NOFILL.
+ */
+void recwrite_stamp(RECWRITE *rw, size_t fixlen, int fill) asm("RCW0004");
+
+/**
+ * @brief Fold a record written past the writer into the stamp.
+ */
+void recwrite_note(RECWRITE *rw, const void *rec, size_t len) asm("RCW0005");
+
+/**
+ * @brief The stamp of every record so far.
+ *
+ * @return 0 with out filled, -1 when the writer was not stamping or gave
+ *         up; the caller then reads the target back.
+ */
+int recwrite_etag(const RECWRITE *rw, char *out, size_t outlen)
+    asm("RCW0006");
+
+#endif /* RECWRITE_H */
@@ -0,0 +1,194 @@
+#ifndef REQCTX_H
+#define REQCTX_H
+
+/**
+ * @file reqctx.h
+ * @brief The parsed request context: one walk over the CGI environment.
+ *
+ * httpd hands a CGI its request as an environment -- an array of name/value
+ * pairs, HTTP_<header>, QUERY_<param> and the CGI variables -- and
+ * http_get_env() answers each question by walking that array from the top.
+ * getHeaderParam() and getQueryParam() put a snprintf() in front of every
+ * walk, and the handlers ask a lot: a data set PUT read Content-Type,
+ * X-IBM-Data-Type, Transfer-Encoding, Content-Length, If-Match and
+ * X-IBM-Return-Etag, read_request_content() then asked for the framing
+ * headers again, and getRequestScheme()/is_browser_fetch() repeat theirs on
+ * every response that builds a URL or a 401.
+ *
+ * The router now walks the environment once, before the middlewares run,
+ * and files every variable mvsMF knows into a RequestCtx on the Session:
+ *
+ *   - the known headers and query parameters, by id (RQH_*, RQQ_*), as
+ *     pointers to httpd's own value strings -- nothing is copied;
+ *   - the values a handler would otherwise parse itself, parsed once:
+ *     Content-Length, chunked framing, Content-Encoding, X-IBM-Data-Type,
+ *     X-IBM-Max-Items, max-jobs and X-IBM-Return-Etag;
+ *   - the route match and its path captures (routetab.h), filled by the
+ *     dispatch walk.
+ *
+ * Names are compared ignoring case, as http_get_env() does, so the context
+ * neither depends on how a client spelled a header nor on whether httpd
+ * upper-cases the query names it files (consapi.c used to try both). The
+ * first occurrence of a name wins, again as with http_get_env().
+ *
+ * A name with no id here is still answered -- getHeaderParam() and
+ * getQueryParam() fall back to the environment for it -- so a new parameter
+ * works before it is given a slot. It gets one when a handler on a real
+ * route starts reading it.
+ *
+ * ====================================================================
+ * This TU is portable C: no httpd headers, no MVS services, no statics.
+ * The environment walk itself is in router.c; this module only files what
+ * it is given, so test/host/tstrctx.c drives the real filing with a
+ * scripted environment.
+ * ====================================================================
+ */
+
+#include <stddef.h>
+
+#include "routetab.h"
+
+/** @brief X-IBM-Data-Type, parsed. Text is the default and the fallback. */
+#define DATA_TYPE_TEXT     1
+#define DATA_TYPE_BINARY   2
+#define DATA_TYPE_RECORD   3
+
+/** @brief Content-Encoding, parsed. receive_body() inflates gzip and
+ *  deflate (inflate.h) and refuses any other coding. */
+#define CODING_IDENTITY    0
+#define CODING_GZIP        1
+#define CODING_DEFLATE     2
+#define CODING_UNKNOWN     3
+
+/** @brief The CGI variables mvsMF reads, by id. */
+enum {
+    RQE_REQUEST_METHOD,
+    RQE_REQUEST_PATH,
+    RQE_POST_STRING,
+
+    RQE_COUNT
+};
+
+/** @brief The request headers mvsMF reads, by id (HTTP_<name>). */
+enum {
+    RQH_ACCEPT_ENCODING,
+    RQH_AUTHORIZATION,
+    RQH_CONTENT_ENCODING,
+    RQH_CONTENT_LENGTH,
+    RQH_CONTENT_TYPE,
+    RQH_HOST,
+    RQH_IF_MATCH,
+    RQH_IF_MODIFIED_SINCE,
+    RQH_IF_NONE_MATCH,
+    RQH_SEC_FETCH_MODE,
+    RQH_TRANSFER_ENCODING,
+    RQH_X_FORWARDED_PORT,
+    RQH_X_FORWARDED_PROTO,
+    RQH_X_IBM_DATA_TYPE,
+    RQH_X_IBM_INTRDR_LRECL,
+    RQH_X_IBM_INTRDR_MODE,
+    RQH_X_IBM_INTRDR_RECFM,
+    RQH_X_IBM_MAX_ITEMS,
+    RQH_X_IBM_OPTION,
+    RQH_X_IBM_RETURN_ETAG,
+    RQH_X_MVSMF_CLIENT,
+
+    RQH_COUNT
+};
+
+/** @brief The query parameters mvsMF's routes read, by id (QUERY_<name>). */
+enum {
+    RQQ_DIRECTION,
+    RQQ_DSLEVEL,
+    RQQ_EXEC_DATA,
+    RQQ_HARDCOPY,
+    RQQ_JOBID,
+    RQQ_MAX_JOBS,
+    RQQ_OWNER,
+    RQQ_PATH,
+    RQQ_PATTERN,
+    RQQ_PREFIX,
+    RQQ_START,
+    RQQ_STATUS,
+    RQQ_SYSNAME,
+    RQQ_TIME,
+    RQQ_TIMERANGE,
+    RQQ_TIMESTAMP,
+    RQQ_VOLSER,
+
+    RQQ_COUNT
+};
+
+/**
+ * @brief The request, as mvsMF reads it.
+ *
+ * Lives in the Session and is valid from the start of handle_request() to
+ * the end of the handler call. Every pointer is into storage httpd owns for
+ * the request (the environment) or into the router's decoded path.
+ */
+typedef struct request_ctx {
+    const char *env[RQE_COUNT];     /**< CGI variables, NULL if absent */
+    const char *hdr[RQH_COUNT];     /**< request headers, NULL if absent */
+    const char *qry[RQQ_COUNT];     /**< query parameters, NULL if absent */
+
+    size_t content_length;          /**< Content-Length, if has_length */
+    int max_items;                  /**< X-IBM-Max-Items, if has_max_items */
+    long max_jobs;                  /**< max-jobs, 0 if absent or not a
+                                         positive decimal number */
+    unsigned char has_length;       /**< Content-Length was sent */
+    unsigned char chunked;          /**< Transfer-Encoding names chunked */
+    unsigned char has_max_items;    /**< X-IBM-Max-Items was sent */
+    unsigned char content_coding;   /**< CODING_* of the body */
+    unsigned char accept_gzip;      /**< Accept-Encoding takes gzip */
+    unsigned char data_type;        /**< DATA_TYPE_TEXT/_BINARY/_RECORD */
+    unsigned char return_etag;      /**< X-IBM-Return-Etag: true */
+    unsigned char filled;           /**< reqctx_finish() has run */
+
+    /* The route match: route id and capture spans, filled by the one walk
+       that found the handler. `path` is the decoded request path, on the
+       router's stack for the length of the handler call; each capture is
+       NUL-terminated in place there (rt_split), so getPathVar() hands out a
+       pointer into it rather than a copy. */
+    RTMATCH match;                  /**< matched route and path captures */
+    char *path;                     /**< decoded path holding the captures */
+} RequestCtx;
+
+/**
+ * @brief Empty a context before a walk.
+ */
+void reqctx_init(RequestCtx *ctx) asm("RQC0001");
+
+/**
+ * @brief File one environment variable.
+ *
+ * Names without an id here are ignored; so is a name already filed.
+ *
+ * @param ctx    Context being filled.
+ * @param name   Variable name as httpd stored it ("HTTP_Content-Type").
+ * @param value  Its value; kept by reference.
+ */
+void reqctx_add(RequestCtx *ctx, const char *name, const char *value)
+    asm("RQC0002");
+
+/**
+ * @brief Parse the typed fields once every variable is filed.
+ */
+void reqctx_finish(RequestCtx *ctx) asm("RQC0003");
+
+/**
+ * @brief The id of a header name, for getHeaderParam().
+ *
+ * @param name  Header name without the HTTP_ prefix, any case.
+ * @return RQH_* id, or -1 if the context has no slot for it.
+ */
+int reqctx_header_id(const char *name) asm("RQC0004");
+
+/**
+ * @brief The id of a query parameter name, for getQueryParam().
+ *
+ * @param name  Parameter name without the QUERY_ prefix, any case.
+ * @return RQQ_* id, or -1 if the context has no slot for it.
+ */
+int reqctx_query_id(const char *name) asm("RQC0005");
+
+#endif /* REQCTX_H */
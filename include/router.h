@@ -10,8 +10,15 @@
  */
 
 #include <stddef.h>
+#include <clibvsam.h>
 #include "acee.h"
 #include "httpcgi.h"
+#include "routetab.h"
+#include "reqctx.h"
+#include "trace.h"
+#include "arena.h"
+#include "sendall.h"
+#include "recwrite.h"
 
 /** @brief Memory alignment for half word */
 #define HALF_WORD_ALIGNMENT 16
@@ -19,47 +26,27 @@
 /** @brief Memory alignment for full word */
 #define FULL_WORD_ALIGNMENT 32
 
-/** @brief Maximum number of routes that can be registered */
-#define MAX_ROUTES 100
-
 /** @brief Maximum number of middlewares that can be registered */
 #define MAX_MIDDLEWARES 10
 
 /** @brief Maximum number of tracked open files per session (ESTAE recovery) */
 #define MAX_SESSION_FILES 4
 
+/** @brief The JES2 internal reader control statement that deletes the job
+ *         being read: written before a close that must not queue it */
+#define JCL_CANCEL_CARD "/*DEL"
+
 #define httpx http_get_httpx(session->httpd)
 
 // Forward declarations
-typedef struct route Route;
 typedef struct router Router;
 typedef struct middleware Middleware;
 typedef struct session Session;
+struct dsahead;
+struct dswrite;
 typedef int (*RouteHandler)(Session *session);
 typedef int (*MiddlewareHandler)(Session *session);
 
-/**
- * @brief HTTP method enumeration
- */
-typedef enum {
-    GET,
-    POST,
-    PUT,
-    DELETE,
-    HEAD,
-    OPTIONS,
-    PATCH
-} HttpMethod;
-
-/**
- * @brief Route definition structure
- */
-struct route {
-    HttpMethod method;      /**< HTTP method for this route */
-    const char *pattern;    /**< URL pattern with optional parameters */
-    RouteHandler handler;   /**< Handler function for this route */
-} __attribute__((aligned(FULL_WORD_ALIGNMENT)));
-
 /**
  * @brief Middleware definition structure
  */
@@ -72,8 +59,8 @@ struct middleware {
  * @brief Router configuration structure
  */
 struct router {
-    size_t route_count;                    /**< Number of registered routes */
-    Route routes[MAX_ROUTES];              /**< Array of registered routes */
+    const ROUTETAB *routes;                /**< Compile-time route table (routetab.h) */
+    const RouteHandler *handlers;          /**< Handler per route id */
     size_t middleware_count;               /**< Number of registered middlewares */
     Middleware middlewares[MAX_MIDDLEWARES]; /**< Array of registered middlewares */
 } __attribute__((aligned(FULL_WORD_ALIGNMENT)));
@@ -101,17 +88,72 @@ struct session {
        held is therefore a bug, and session_register_jes() says so rather than
        overwriting the slot and leaking what was in it (issue #286). */
     struct jes *open_jes;                 /**< Tracked JES spool handle */
+    /* The internal reader of a submission, from its open to its close
+       (jobsapi.c). One slot, for the same reason as open_jes. It holds a
+       job JES2 is reading: closed as it is, the cards so far would be
+       queued and run, so session_cleanup() writes JCL_CANCEL_CARD before
+       it closes it. */
+    VSFILE *open_intrdr;                  /**< Tracked internal reader */
+    /* The request as parsed once by handle_request(): the known headers,
+       query parameters and CGI variables, their typed values, and the route
+       match with its path captures (reqctx.h). Handlers read its fields;
+       getHeaderParam()/getQueryParam() answer from it for the names it
+       knows. */
+    RequestCtx req;                       /**< Parsed request context */
+    /* What the response was, for the per-route metrics (metrics.h):
+       the status as handed to session_resp(), and the body bytes that went
+       through send_all(). */
+    int status;                           /**< HTTP status sent, 0 if none */
+    unsigned long bytes_sent;             /**< Body bytes sent */
+    /* Where the time went (trace.h): one span per named phase, begun and
+       ended by the handlers through session_span_begin()/_end(), rendered
+       into Server-Timing with the headers and into the slow-request WTO. */
+    TRC_TRACE trace;                      /**< Phase spans of this request */
+    /* Storage that lives exactly as long as the request (arena.h): handed
+       out by bumping, given back in one piece by handle_request() when the
+       handler returns and by session_cleanup() when it abends. */
+    ARENA arena;                          /**< Request-scoped storage */
+    /* Body bytes not sent yet (sendall.h): send_all() and send_printf()
+       append, the router flushes at every status line and when the
+       handler returns. The storage is in the arena. */
+    SEND_BUF out;                         /**< Pending response output */
+    /* The gzip stage between out and the socket (deflate.h), when the
+       client takes gzip and the headers offered it (send_gzip_offer()).
+       In the arena; NULL for a plain body. */
+    struct deflate *gz;                   /**< Response body encoder */
+    /* The size of the buffered JSON body sendJSONResponse() sent, learned
+       into the route's size hint (metrics.h) so the next request's builder
+       starts large enough. 0 when the response was not buffered JSON. */
+    unsigned json_size;                   /**< Buffered JSON body bytes */
+    /* Records of a data set or member PUT not written yet (recwrite.h):
+       set up by open_write_target() with a BLKSIZE buffer in the arena,
+       written when it fills and before the target is closed. */
+    RECWRITE put;                         /**< Pending output records */
+    /* Where put's blocks go (dswrite.h): the PUT target, written in line
+       or by a writer subtask. In the arena; NULL until open_write_target().
+       session_cleanup() stops a writer subtask before the arena goes. */
+    struct dswrite *wr;                   /**< The PUT target */
+    /* The read-ahead subtask of a data set GET (dsread.h), while it runs:
+       set by dsread_ahead(), cleared when dsread_stop() lets it go. In the
+       arena. session_cleanup() stops it before it closes the DCB it reads
+       and releases the buffers it fills. */
+    struct dsahead *rd;                   /**< The running read-ahead */
 } __attribute__((aligned(FULL_WORD_ALIGNMENT)));
 
 /**
  * @brief Initializes a new router instance
  *
- * Sets up a router with default middleware for route matching
- * and path variable extraction.
+ * Sets up a router over a compile-time route table, with default middleware
+ * for route matching and path variable extraction. Nothing is copied: the
+ * table and the handler array are `static const` in the caller and are
+ * referenced, which is what keeps the per-request setup cost flat.
  *
  * @param router Pointer to Router structure to initialize
+ * @param routes Route table to dispatch on
+ * @param handlers Handler for each route id, routes->count entries
  */
-void init_router(Router *router) asm("RTR0001");
+void init_router(Router *router, const ROUTETAB *routes,
+    const RouteHandler *handlers) asm("RTR0001");
 
 /**
  * @brief Initializes a new session context
@@ -125,18 +167,6 @@ void init_router(Router *router) asm("RTR0001");
  */
 void init_session(Session *session, Router *router, HTTPD *httpd, HTTPC *httpc) asm("RTR0002");
 
-/**
- * @brief Adds a new route to the router
- *
- * Registers a handler for a specific HTTP method and URL pattern.
- *
- * @param router Router to add route to
- * @param method HTTP method for the route
- * @param pattern URL pattern with optional parameters
- * @param handler Handler function for the route
- */
-void add_route(Router *router, HttpMethod method, const char *pattern, RouteHandler handler) asm("RTR0003");
-
 /**
  * @brief Adds a new middleware to the router
  *
@@ -189,11 +219,46 @@ int session_register_jes(Session *session, struct jes *jes) asm("RTR0010");
  */
 void session_jesclose(Session *session, struct jes **jes) asm("RTR0011");
 
+/**
+ * @brief Register an open internal reader for ESTAE recovery cleanup
+ */
+void session_register_intrdr(Session *session, VSFILE *intrdr) asm("RTR0015");
+
+/**
+ * @brief Unregister the internal reader, before the caller closes it
+ */
+void session_unregister_intrdr(Session *session, VSFILE *intrdr)
+    asm("RTR0016");
+
+/**
+ * @brief Send the HTTP status line, and remember the status
+ *
+ * http_resp() with the status recorded in the session, so the router can
+ * count the request by status class. Every status line mvsMF sends goes
+ * through here.
+ */
+int session_resp(Session *session, int status) asm("RTR0012");
+
+/**
+ * @brief Open a phase span (trace.h), timed with STCK
+ *
+ * @param name Phase token, a string literal: "access", "etag", "read" ...
+ * @return The span to pass to session_span_end(); TRC_NONE is fine to pass
+ */
+int session_span_begin(Session *session, const char *name) asm("RTR0013");
+
+/**
+ * @brief Close a phase span opened by session_span_begin()
+ */
+void session_span_end(Session *session, int span) asm("RTR0014");
+
 /**
  * @brief Close all tracked resources (ESTAE recovery)
  *
- * Closes all registered FILE handles, the JES spool handle, UFS file handles
- * and UFS sessions. Called by the router after catching a handler abend.
+ * Stops a running read-ahead or write-behind subtask, deletes the job in an
+ * open internal reader and closes it, closes all registered FILE handles,
+ * the JES spool handle, UFS file handles and UFS sessions, and releases the
+ * request arena. Called by the router after catching a handler abend.
  */
 void session_cleanup(Session *session) asm("RTR0009");
 
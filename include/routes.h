@@ -0,0 +1,96 @@
+#ifndef ROUTES_H
+#define ROUTES_H
+
+/**
+ * @file routes.h
+ * @brief mvsMF's route table: the endpoints, by route id.
+ *
+ * The table itself -- definitions and trie -- is `static const` data in
+ * src/routes.c (see routetab.h for the layout). The handler for each id is
+ * bound in mvsmf.c, the one TU that sees every API header.
+ *
+ * Adding an endpoint means three edits, all checked by test/host/tstrout.c:
+ * an id here, its definition and trie edge in routes.c, and its handler in
+ * mvsmf.c. Ids keep the order the routes were registered in, which is the
+ * precedence the old linear matcher gave them.
+ */
+
+#include "routetab.h"
+
+enum {
+    ROUTE_INFO,
+    ROUTE_TEST,
+    ROUTE_TEST_WILDCARD,
+
+    ROUTE_AUTH_LOGIN,
+    ROUTE_AUTH_LOGOUT,
+
+    ROUTE_JOB_LIST,
+    ROUTE_JOB_FILES,
+    ROUTE_JOB_RECORDS,
+    ROUTE_JOB_SUBMIT,
+    ROUTE_JOB_STATUS,
+    ROUTE_JOB_PURGE,
+
+    ROUTE_DS_LIST,
+    ROUTE_DS_GET,
+    ROUTE_DS_GET_VOL,
+    ROUTE_DS_PUT,
+    ROUTE_DS_PUT_VOL,
+    ROUTE_DS_CREATE,
+    ROUTE_DS_DELETE,
+    ROUTE_DS_DELETE_VOL,
+    ROUTE_MBR_LIST,
+    ROUTE_MBR_LIST_VOL,
+    ROUTE_MBR_GET,
+    ROUTE_MBR_GET_VOL,
+    ROUTE_MBR_PUT,
+    ROUTE_MBR_PUT_VOL,
+    ROUTE_MBR_DELETE,
+    ROUTE_MBR_DELETE_VOL,
+
+    ROUTE_USS_LIST,
+    ROUTE_CONS_ISSUE,
+    ROUTE_CONS_COLLECT,
+    ROUTE_CONS_DETECT,
+    ROUTE_CONS_LOG,
+
+    ROUTE_USS_GET,
+    ROUTE_USS_PUT,
+    ROUTE_USS_CREATE,
+    ROUTE_USS_DELETE,
+
+    ROUTE_COUNT
+};
+
+/**
+ * @brief Path variables, by id: what getPathVar() takes.
+ *
+ * One id per variable name, whichever routes capture it -- a handler shared
+ * by the plain and the volume-qualified route asks for PATH_DATASET_NAME
+ * and gets it from either.
+ */
+enum {
+    PATH_DATASET_NAME,
+    PATH_MEMBER_NAME,
+    PATH_VOLUME_SERIAL,
+    PATH_JOB_NAME,
+    PATH_JOBID,
+    PATH_DDID,
+    PATH_CONSOLE_NAME,
+    PATH_CMD_RESPONSE_KEY,
+    PATH_DETECTION_KEY,
+    PATH_FILEPATH,
+
+    PATH_VAR_COUNT
+};
+
+/**
+ * @brief The mvsMF route table.
+ *
+ * A function, not an exported object: the table stays `static const` inside
+ * routes.c, which is what keeps it in the RENT module's read-only storage.
+ */
+const ROUTETAB *mvsmf_routes(void) asm("RTE0001");
+
+#endif /* ROUTES_H */
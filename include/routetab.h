@@ -0,0 +1,177 @@
+#ifndef ROUTETAB_H
+#define ROUTETAB_H
+
+/**
+ * @file routetab.h
+ * @brief The compile-time route table and its trie dispatcher.
+ *
+ * httpd re-LINKs MVSMF for every request, so nothing built at run time
+ * survives to the next one. The router used to be rebuilt in main() by one
+ * add_route() call per endpoint, and dispatch then tried every pattern in
+ * turn -- O(routes x path) to find a handler, paid on each request before any
+ * real work started, with a 100-slot Route array on the 64 K stack (#290).
+ *
+ * The table is now data: a `static const` trie laid down by the compiler,
+ * shared read-only by every request and legal in a RENT module. Each node
+ * consumes one edge of the path -- a literal run of characters or one
+ * capture -- and lists the routes that end there, by method. Dispatch walks
+ * the path once, so it costs O(path length) whatever the route count.
+ *
+ * Capture edges keep the semantics the old pattern matcher had, exactly:
+ *
+ *   RT_VAR   {name}   runs up to the next '/', '(' or ')', so
+ *                     {dataset-name}({member-name}) and -({volume-serial})
+ *                     split where the pattern says. It may be empty
+ *                     mid-path, but never at the very end of the path.
+ *   RT_REST  {*name}  takes everything left, slashes included, and also
+ *                     matches empty.
+ *
+ * Literal edges are tried before capture edges of the same parent. With the
+ * route set mvsMF has, no path is accepted by two routes of one method, so
+ * that order only decides how soon a miss is known; test/host/tstrout.c
+ * checks every route against the old first-registered-wins matcher.
+ *
+ * ====================================================================
+ * This TU is portable C: no httpd headers, no MVS services, no statics.
+ * The engine is rt_match() in src/routetab.c; mvsMF's own table is in
+ * src/routes.c, and the handlers it dispatches to are bound by route id
+ * in mvsmf.c.
+ * ====================================================================
+ */
+
+/**
+ * @brief HTTP method enumeration
+ */
+typedef enum {
+    GET,
+    POST,
+    PUT,
+    DELETE,
+    HEAD,
+    OPTIONS,
+    PATCH
+} HttpMethod;
+
+/** @brief Edge kinds of a trie node. */
+#define RT_LIT   0      /**< literal text, compared byte for byte */
+#define RT_VAR   1      /**< {name}: up to '/', '(' or ')' */
+#define RT_REST  2      /**< {*name}: the rest of the path */
+
+/** @brief Most captures one route can have. Three is the deepest today
+ *         ({job-name}/{jobid}/.../{ddid}, and the volume-qualified member). */
+#define RT_MAX_CAPS 4
+
+/**
+ * @brief One route as registered: the documentation of a trie leaf.
+ *
+ * The dispatcher never reads these. They are what a route id means and what
+ * the host test checks the trie against.
+ */
+typedef struct rt_def {
+    HttpMethod method;      /**< HTTP method for this route */
+    const char *pattern;    /**< URL pattern with optional parameters */
+} RTDEF;
+
+/** @brief A route ending at a node. */
+typedef struct rt_leaf {
+    unsigned char method;   /**< HttpMethod */
+    unsigned char route;    /**< route id, index into the RTDEF table */
+} RTLEAF;
+
+typedef struct rt_node RTNODE;
+
+/**
+ * @brief A trie node. Written by hand in a `static const` table; see the
+ *        RT_* initializer macros below.
+ */
+struct rt_node {
+    unsigned char kind;     /**< RT_LIT, RT_VAR or RT_REST */
+    unsigned char var;      /**< captures: the variable's id in the table */
+    const char *text;       /**< RT_LIT: the literal; else the capture name */
+    unsigned char nkids;    /**< entries in kids */
+    unsigned char nleaves;  /**< entries in leaves */
+    const RTNODE *kids;     /**< edges out of this node, literals first */
+    const RTLEAF *leaves;   /**< routes that end here, by method */
+};
+
+/**
+ * @brief A complete route table: the trie and the definitions its leaves
+ *        refer to.
+ */
+typedef struct rt_tab {
+    const RTNODE *root;     /**< trie root; its edge is the common prefix */
+    const RTDEF *defs;      /**< route definitions, by route id */
+    int count;              /**< number of route ids */
+} ROUTETAB;
+
+/**
+ * @brief One path capture: a span of the decoded path, not a copy.
+ *
+ * Trailing blanks are already off the length -- clients like Zowe Explorer
+ * pad member names to 8 characters.
+ */
+typedef struct rt_cap {
+    const char *name;       /**< variable name, as in the pattern */
+    unsigned char var;      /**< variable id */
+    unsigned short off;     /**< offset into the path */
+    unsigned short len;     /**< length, trailing blanks excluded */
+} RTCAP;
+
+/**
+ * @brief The outcome of a dispatch: the route and its captures.
+ *
+ * Filled in the same walk that finds the route -- there is no second pass
+ * over the pattern to pull the variables out afterwards.
+ */
+typedef struct rt_match {
+    int route;              /**< route id, -1 if none */
+    int ncaps;              /**< entries in caps */
+    RTCAP caps[RT_MAX_CAPS];
+} RTMATCH;
+
+/* Initializer helpers for trie tables. An edge is one of
+ *
+ *   RT_TEXT("literal")   RT_CAPTURE(id, "name")   RT_WILDCARD(id, "name")
+ *
+ * and `kids` and `leaves` are arrays, so their counts come from sizeof and
+ * cannot drift from the contents. */
+#define RT_N(a)         ((unsigned char) (sizeof(a) / sizeof((a)[0])))
+
+#define RT_TEXT(s)              RT_LIT, 0, s
+#define RT_CAPTURE(id, name)    RT_VAR, id, name
+#define RT_WILDCARD(id, name)   RT_REST, id, name
+
+#define RT_LEAFNODE(edge, ends) \
+    { edge, 0, RT_N(ends), NULL, ends }
+#define RT_INNER(edge, kids) \
+    { edge, RT_N(kids), 0, kids, NULL }
+#define RT_NODE(edge, kids, ends) \
+    { edge, RT_N(kids), RT_N(ends), kids, ends }
+
+/**
+ * @brief Dispatch a request path.
+ *
+ * @param tab     Route table.
+ * @param method  Request method.
+ * @param path    Percent-decoded request path, NUL-terminated.
+ * @param match   Receives the route and the capture spans; may be NULL.
+ * @return The route id, or -1 when no route of this method accepts the path.
+ */
+int rt_match(const ROUTETAB *tab, HttpMethod method, const char *path,
+    RTMATCH *match) asm("RTT0001");
+
+/**
+ * @brief Terminate every capture in place.
+ *
+ * Writes a NUL behind each span, over the delimiter (or first trailing blank)
+ * that follows it, so a capture can be handed out as a plain string pointing
+ * into the path. Captures never share a delimiter -- a literal always
+ * separates two -- so none is cut short. The path is no longer the request
+ * path afterwards; take any copy for messages before.
+ *
+ * @param path   The path rt_match() was given, in writable storage.
+ * @param match  Its match.
+ */
+void rt_split(char *path, const RTMATCH *match) asm("RTT0002");
+
+#endif /* ROUTETAB_H */
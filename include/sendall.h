@@ -95,4 +95,68 @@ typedef struct send_ops {
 int send_bytes(void *ctx, const SEND_OPS *ops,
 	const unsigned char *buf, int len) asm("SND0001");
 
+/*
+ * ====================================================================
+ * The coalescing buffer in front of send_bytes().
+ *
+ * Response bodies are written in small pieces: one 80-byte record per call
+ * for an FB80 download, a line or two per http_printf() for a data set or
+ * directory list, one spool line per call for job output. Each was a trip
+ * through httpd's send path -- and, in chunked mode, a chunk header and
+ * trailer of its own -- and a small TCP segment.
+ *
+ * SEND_BUF collects them and hands send_bytes() SEND_BUF_SIZE at a time,
+ * when it is full and once at the end of the response. A write that does
+ * not fit by itself goes straight through, after what is pending, without
+ * a copy. The #298 policy is send_bytes()'s and is unchanged: the buffer
+ * only changes how many bytes each call carries. What it adds is that a
+ * failed flush is final -- `failed` is set, the pending bytes are dropped,
+ * and every later write and flush fails at once, the same way a client at
+ * CSTATE_DONE refuses output after a failed send_all().
+ *
+ * The storage is the caller's (the request arena in common.c), so this
+ * stays portable and the host test drives it with scripted SEND_OPS.
+ * ====================================================================
+ */
+
+/** @brief Bytes coalesced per send: eleven 1460-byte segments and change. */
+#define SEND_BUF_SIZE       (16 * 1024)
+
+/** @brief The buffer in the Session. */
+typedef struct send_buf {
+	unsigned char  *buf;        /**< storage, NULL before the first write */
+	int             size;       /**< bytes of storage */
+	int             len;        /**< bytes pending */
+	int             failed;     /**< a send failed; nothing more goes out */
+	unsigned long   sent;       /**< bytes handed to send_bytes() and sent */
+	unsigned        flushes;    /**< send_bytes() calls made */
+} SEND_BUF;
+
+/** @brief Non-zero when `n` bytes can be appended without a send. */
+#define SENDBUF_FITS(sb, n) ((n) <= (sb)->size - (sb)->len)
+
+/**
+ * @brief Attach storage to an empty buffer; NULL storage detaches it.
+ */
+void sendbuf_init(SEND_BUF *sb, unsigned char *storage, int size)
+	asm("SND0002");
+
+/**
+ * @brief Append bytes, sending through send_bytes() as the buffer fills.
+ *
+ * @return 0 when the bytes are pending or sent, -1 when a send failed now
+ *         or earlier.
+ */
+int sendbuf_write(SEND_BUF *sb, void *ctx, const SEND_OPS *ops,
+	const unsigned char *buf, int len) asm("SND0003");
+
+/**
+ * @brief Send whatever is pending.
+ *
+ * @return 0 when nothing is left pending, -1 when a send failed now or
+ *         earlier.
+ */
+int sendbuf_flush(SEND_BUF *sb, void *ctx, const SEND_OPS *ops)
+	asm("SND0004");
+
 #endif /* SENDALL_H */
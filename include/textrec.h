@@ -0,0 +1,68 @@
+#ifndef TEXTREC_H
+#define TEXTREC_H
+
+/**
+ * @file textrec.h
+ * @brief Fixed-length records to text lines, in one pass.
+ *
+ * A text download of an F/FB data set turned every record into a line in
+ * four passes over the same bytes: strlen() for the length fgets() had just
+ * read, a backwards scan over the blank padding, the newline, and then
+ * http_xlate() over the lot -- with a send_all() per record on top. An FB80
+ * data set of 10 000 records is 40 000 passes of 80 bytes.
+ *
+ * textrec_fixed() does the record in one: it finds the last byte that is not
+ * padding a word at a time from the end, then translates what is left
+ * through the table straight into the output and appends the newline,
+ * translated the same way. textrec_block() runs it over a block of packed
+ * records, writing the lines back to back. The output is byte for byte what
+ * the four passes produced.
+ *
+ * The pad and newline are parameters, not literals: on MVS they are the
+ * EBCDIC blank and '\n' the records and the table are in, and the host test
+ * runs the same code over ASCII.
+ *
+ * ====================================================================
+ * This TU is portable C: no httpd headers, no MVS services, no statics.
+ * test/host/tsttrec.c drives the real kernel against the four-pass path.
+ * ====================================================================
+ */
+
+#include <stddef.h>
+
+/**
+ * @brief One fixed-length record as one text line.
+ *
+ * @param out   At least lrecl + 1 bytes.
+ * @param rec   The record, lrecl bytes; need not be terminated.
+ * @param pad   The padding stripped from the end (the blank).
+ * @param nl    The newline appended, before translation.
+ * @param xlate 256-byte translate table.
+ * @return Bytes written: the record less its padding, and the newline.
+ */
+size_t textrec_fixed(unsigned char *out, const unsigned char *rec,
+    size_t lrecl, unsigned char pad, unsigned char nl,
+    const unsigned char *xlate) asm("TXR0001");
+
+/**
+ * @brief textrec_fixed() over `nrec` packed records.
+ *
+ * @param out   At least nrec * (lrecl + 1) bytes.
+ * @return Bytes written.
+ */
+size_t textrec_block(unsigned char *out, const unsigned char *recs,
+    size_t nrec, size_t lrecl, unsigned char pad, unsigned char nl,
+    const unsigned char *xlate) asm("TXR0002");
+
+/**
+ * @brief A variable-length or undefined record as one text line: the record
+ *        as it is, translated, and the newline. Nothing is stripped.
+ *
+ * @param out   At least len + 1 bytes.
+ * @return len + 1.
+ */
+size_t textrec_line(unsigned char *out, const unsigned char *rec,
+    size_t len, unsigned char nl, const unsigned char *xlate)
+    asm("TXR0003");
+
+#endif /* TEXTREC_H */
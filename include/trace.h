@@ -0,0 +1,119 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/**
+ * @file trace.h
+ * @brief Per-request phase spans, for Server-Timing and the slow-request WTO.
+ *
+ * The per-route metrics (metrics.h) say that a data set GET took 400 ms; they
+ * do not say where. The candidates are a handful of named phases --
+ * require_access(), the __locate and DSCB reads of dsread_open(), the
+ * dataset_etag() hash pass, the fopen, the record loop, and the
+ * time send_all() spends waiting on a full socket -- and this is the
+ * recorder for them.
+ *
+ * A span is a name and the TOD clock around one phase. The table is fixed
+ * and lives in the Session, so recording allocates nothing. Spans are keyed
+ * by name: beginning a name that already has a slot adds to it, so a phase
+ * entered once per record (the read, the send) is one entry with a total and
+ * a count rather than thousands. A begin that finds its name still open is
+ * nested inside itself and is not counted twice -- it returns TRC_NONE, and
+ * ending TRC_NONE does nothing, so the caller never has to check.
+ *
+ * Two renderings:
+ *
+ *   - the Server-Timing header value (`access;dur=0.412, etag;dur=31.870,
+ *     total;dur=35.102`), written with the response headers, so it carries
+ *     the phases that finished before the first body byte -- the send and
+ *     most of the read come after it and are only in
+ *   - the summary line of the slow-request WTO, written by the router at the
+ *     end of a request that ran past MVSMF_TRACE_MS.
+ *
+ * Durations are in milliseconds, as the Server-Timing spec has them.
+ *
+ * ====================================================================
+ * This TU is portable C: no httpd headers, no MVS services, no statics.
+ * The clock is the caller's -- every entry point takes the STCK value --
+ * which is what lets test/host/tsttrace.c drive the real recorder with a
+ * clock of its own.
+ * ====================================================================
+ */
+
+#include <stddef.h>
+
+/** @brief Distinct phase names per request. The busiest handler records six;
+ *         a begin past the limit is counted in `dropped` and otherwise
+ *         ignored. */
+#define TRC_SPANS       12
+
+/** @brief "No span": what a begin that was not recorded returns. */
+#define TRC_NONE        (-1)
+
+/** @brief One phase. */
+typedef struct trc_span {
+    const char         *name;       /**< token, a string literal */
+    unsigned long long  start;      /**< TOD of the open begin, 0 if closed */
+    unsigned long long  total;      /**< TOD units spent in the phase */
+    unsigned            count;      /**< begin/end pairs completed */
+} TRC_SPAN;
+
+/** @brief The table in the Session. */
+typedef struct trc_trace {
+    unsigned long long  t0;         /**< TOD at the start of the request */
+    unsigned short      nspans;     /**< slots in use */
+    unsigned short      dropped;    /**< begins that found the table full */
+    TRC_SPAN            span[TRC_SPANS];
+} TRC_TRACE;
+
+/**
+ * @brief Empty the table and start the request clock.
+ */
+void trace_init(TRC_TRACE *t, unsigned long long now) asm("TRC0001");
+
+/**
+ * @brief Open a phase.
+ *
+ * @param name  A token (letters, digits, '-', '_'); the pointer is kept, so
+ *              it must outlive the request -- a literal.
+ * @return The slot to pass to trace_end(), or TRC_NONE.
+ */
+int trace_begin(TRC_TRACE *t, const char *name, unsigned long long now)
+    asm("TRC0002");
+
+/**
+ * @brief Close a phase opened by trace_begin(). TRC_NONE is a no-op.
+ */
+void trace_end(TRC_TRACE *t, int slot, unsigned long long now)
+    asm("TRC0003");
+
+/**
+ * @brief TOD units to whole microseconds (bit 51 is one microsecond).
+ */
+unsigned long trace_usec(unsigned long long tod) asm("TRC0004");
+
+/**
+ * @brief Render the Server-Timing header value.
+ *
+ * Every closed phase, then `total` -- the time since trace_init() up to
+ * `now`. The phases are cut, whole, at the first that does not fit;
+ * `total` is kept last and always has room reserved.
+ *
+ * @return Length written, excluding the NUL.
+ */
+int trace_server_timing(const TRC_TRACE *t, unsigned long long now,
+    char *buf, size_t size) asm("TRC0005");
+
+/**
+ * @brief Render the phase summary for the slow-request WTO.
+ *
+ * `access=0.4 etag=31.9 read=40.2/4096 ...`, milliseconds, with the count
+ * after a slash where a phase ran more than once. Phases still open at
+ * `now` are included up to `now` and marked with a `+`; `+N` at the end
+ * says N begins were dropped.
+ *
+ * @return Length written, excluding the NUL.
+ */
+int trace_summary(const TRC_TRACE *t, unsigned long long now,
+    char *buf, size_t size) asm("TRC0006");
+
+#endif /* TRACE_H */
@@ -0,0 +1,107 @@
+#ifndef WBRING_H
+#define WBRING_H
+
+/**
+ * @file wbring.h
+ * @brief Write-behind: a ring of finished blocks between a PUT's worker and
+ *        the writer subtask that owns the DCB.
+ *
+ * A data set or member PUT receives the body, cuts it into records, gathers
+ * them into blocks (recwrite.h) and writes each block, one step after the
+ * other on one task. While a block is written no byte is received, and the
+ * receive is the slow side already.
+ *
+ * With the ring, the worker only copies a finished block into a free slot
+ * and goes back to the socket. A writer subtask takes the slots in order,
+ * writes them and frees them. The worker waits only when every slot is
+ * full, and the writer only when every slot is empty.
+ *
+ * A slot may carry a flush: the record before it is one that only a flush
+ * can end (recwrite.h), and the writer flushes after the slot's bytes, as
+ * the worker did in line.
+ *
+ * A failed write stops the writing, not the draining. The writer frees the
+ * slots after it without writing them, so the worker never waits on a
+ * writer that gave up. The worker's next wbring_put() is -1, and the PUT
+ * fails as a failed write always has.
+ *
+ * Nothing in here blocks. A call that cannot go ahead returns WBR_WAIT, and
+ * the caller waits for the other side's post and calls again -- ECBs in
+ * dswrite.c, a simulated clock in the host test.
+ *
+ * ====================================================================
+ * This TU is portable C: no httpd headers, no MVS services, no statics.
+ * test/host/tstwbr.c drives it with stalls injected on either side.
+ * ====================================================================
+ */
+
+#include <stddef.h>
+
+#define WBRING_MAX      8       /* slots at most */
+
+/* the return when a call has to wait for the other side */
+#define WBR_WAIT        2
+
+typedef struct wbring   WBRING;
+
+struct wbring {
+	struct {
+		unsigned char   *buf;
+		size_t          len;
+		int             flush;          /* fflush() after the bytes */
+		volatile int    full;           /* the writer's to take */
+	} slot[WBRING_MAX];
+	unsigned        nslot;
+	size_t          size;           /* of each slot */
+	unsigned        put;            /* the slot the worker fills next */
+	unsigned        take;           /* the slot the writer takes next */
+	int             held;           /* the writer has slot[take] */
+	volatile int    closed;         /* the worker put the last slot */
+	volatile int    failed;         /* a write failed: no more writes */
+	unsigned long   blocks;         /* slots put */
+	unsigned long   put_waits;      /* WBR_WAIT answers, each side */
+	unsigned long   take_waits;
+};
+
+/**
+ * @brief Start a ring over `nslot` (up to WBRING_MAX) buffers of `size`
+ *        bytes each; bufs[i] is slot i.
+ */
+void wbring_init(WBRING *wb, unsigned char **bufs, unsigned nslot,
+    size_t size) asm("WBR0001");
+
+/**
+ * @brief Copy `len` bytes (at most `size`) into the next free slot.
+ *
+ * @return 1 when taken; WBR_WAIT when every slot is full; -1 when a write
+ *         has failed or `len` is over the slot size.
+ */
+int wbring_put(WBRING *wb, const void *data, size_t len, int flush)
+    asm("WBR0002");
+
+/**
+ * @brief The worker put its last slot: the writer ends when it has
+ *        drained the ring.
+ */
+void wbring_close(WBRING *wb) asm("WBR0003");
+
+/**
+ * @brief The writer's next slot, in the order put.
+ *
+ * @return 1 with *buf, *len and *flush set -- the slot is the writer's
+ *         until wbring_done() -- WBR_WAIT when the ring is empty, 0 when it
+ *         is empty and closed.
+ */
+int wbring_take(WBRING *wb, const unsigned char **buf, size_t *len,
+    int *flush) asm("WBR0004");
+
+/**
+ * @brief The writer is done with the slot it took: `rc` 0 when it was
+ *        written, negative when the write failed.
+ *
+ * @return 1 when a slot went back -- the worker may be waiting for it --
+ *         0 when the writer held none.
+ */
+int wbring_done(WBRING *wb, int rc) asm("WBR0005");
+
+#endif /* WBRING_H */
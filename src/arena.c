@@ -0,0 +1,212 @@
+/*
+ * arena.c - request-scoped bump allocator.
+ *
+ * See include/arena.h for why the request allocates from one and what it
+ * does and does not promise.
+ *
+ * Portable C on purpose: no httpd headers, no MVS services, no statics. The
+ * host test #includes it (test/host/tstarena.c) so the allocator it drives
+ * is the one that runs on MVS, not a copy of it.
+ */
+
+#include <string.h>
+
+#include "arena.h"
+
+/* The header, rounded up so the first allocation is aligned: a chunk header
+   is 16 bytes on MVS and 24 on a 64-bit host. */
+#define ARN_HDR \
+	((unsigned) ((sizeof(ARENA_CHUNK) + ARENA_ALIGN - 1) & \
+		~(size_t) (ARENA_ALIGN - 1)))
+
+#define ARN_ROUND(n) \
+	(((n) + ARENA_ALIGN - 1) & ~(unsigned) (ARENA_ALIGN - 1))
+
+/* 16 MB less a page: nothing larger can be GETMAINed below the line, and
+   it keeps every size in an unsigned with room to round. */
+#define ARN_MAX     0x00FFF000u
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'arena_init'");
+#endif
+void
+arena_init(ARENA *a, const ARENA_OPS *ops, void *ctx)
+{
+	memset(a, 0, sizeof(*a));
+	a->ops = ops;
+	a->ctx = ctx;
+}
+
+/* One chunk from the source, stamped and counted; NULL if it has none. */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'arn_get'");
+#endif
+static ARENA_CHUNK *
+arn_get(ARENA *a, unsigned size, unsigned large)
+{
+	ARENA_CHUNK *c = (ARENA_CHUNK *) a->ops->get(a->ctx, size);
+
+	if (!c) {
+		return NULL;
+	}
+	c->next = NULL;
+	c->size = size;
+	c->used = ARN_HDR;
+	c->large = large;
+
+	a->gets++;
+	a->held += size;
+	if (a->held > a->high) {
+		a->high = a->held;
+	}
+	return c;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'arn_put'");
+#endif
+static void
+arn_put(ARENA *a, ARENA_CHUNK *c)
+{
+	a->held -= c->size;
+	a->ops->put(a->ctx, c, c->size);
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'arena_alloc'");
+#endif
+void *
+arena_alloc(ARENA *a, size_t size)
+{
+	ARENA_CHUNK *c;
+	unsigned n;
+	char *p;
+
+	if (!a || !a->ops || size > ARN_MAX) {
+		return NULL;
+	}
+	n = size ? ARN_ROUND((unsigned) size) : ARENA_ALIGN;
+
+	if (n > ARENA_LARGE) {
+		/* A chunk of its own, linked behind the head: the shared chunk
+		   keeps its free space for the small allocations still to come. */
+		c = arn_get(a, ARN_HDR + n, 1);
+		if (!c) {
+			return NULL;
+		}
+		c->used = c->size;
+		if (a->head) {
+			c->next = a->head->next;
+			a->head->next = c;
+		} else {
+			a->head = c;
+		}
+		a->allocs++;
+		return (char *) c + ARN_HDR;
+	}
+
+	c = a->head;
+	if (!c || c->large || c->size - c->used < n) {
+		/* What is left of the old head is given up: at most a quarter
+		   chunk, since anything larger would not have come here. */
+		c = arn_get(a, ARENA_CHUNK_SIZE, 0);
+		if (!c) {
+			return NULL;
+		}
+		c->next = a->head;
+		a->head = c;
+		a->last = NULL;
+	}
+
+	p = (char *) c + c->used;
+	c->used += n;
+	a->last = p;
+	a->allocs++;
+	return p;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'arena_calloc'");
+#endif
+void *
+arena_calloc(ARENA *a, size_t size)
+{
+	void *p = arena_alloc(a, size);
+
+	if (p) {
+		memset(p, 0, size);
+	}
+	return p;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'arena_realloc'");
+#endif
+void *
+arena_realloc(ARENA *a, void *p, size_t old_size, size_t new_size)
+{
+	ARENA_CHUNK *c;
+	ARENA_CHUNK **link;
+	unsigned off;
+	unsigned n;
+	void *q;
+
+	if (!p) {
+		return arena_alloc(a, new_size);
+	}
+	if (!a || new_size > ARN_MAX) {
+		return NULL;
+	}
+
+	/* the top of the head chunk: move the bump pointer, copy nothing */
+	c = a->head;
+	if (c && !c->large && (char *) p == a->last) {
+		off = (unsigned) ((char *) p - (char *) c);
+		n = new_size ? ARN_ROUND((unsigned) new_size) : ARENA_ALIGN;
+		if (n <= c->size - off) {
+			c->used = off + n;
+			return p;
+		}
+	}
+
+	q = arena_alloc(a, new_size);
+	if (!q) {
+		return NULL;
+	}
+	memcpy(q, p, old_size < new_size ? old_size : new_size);
+
+	/* A large allocation owns its chunk, so the chunk can go back now
+	   rather than at release -- a buffer doubling its way past ARENA_LARGE
+	   then holds one copy, not every size it went through. */
+	for (link = &a->head; *link; link = &(*link)->next) {
+		c = *link;
+		if (c->large && (char *) c + ARN_HDR == (char *) p) {
+			*link = c->next;
+			arn_put(a, c);
+			break;
+		}
+	}
+
+	return q;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'arena_release'");
+#endif
+void
+arena_release(ARENA *a)
+{
+	ARENA_CHUNK *c;
+	ARENA_CHUNK *next;
+
+	if (!a) {
+		return;
+	}
+
+	for (c = a->head; c; c = next) {
+		next = c->next;
+		arn_put(a, c);
+	}
+	a->head = NULL;
+	a->last = NULL;
+}
@@ -92,7 +92,7 @@ auth_send(Session *session, int status, const char *set_cookie, const char *json
 
 	session->headers_sent = 1;
 
-	rc = http_resp(httpc, status);
+	rc = session_resp(session, status);
 	if (rc < 0) {
 		return rc;
 	}
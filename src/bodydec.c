@@ -0,0 +1,303 @@
+/*
+ * bodydec.c - the request body, decoded from Content-Length or chunked
+ * framing as it arrives.
+ *
+ * See include/bodydec.h for what a size line may hold and why a failed sink
+ * still drains the body.
+ *
+ * Portable C on purpose: no httpd headers, no MVS services, no statics. The
+ * host test #includes it (test/host/tstbody.c) so the decoder it drives is
+ * the one that runs on MVS, not a copy of it.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bodydec.h"
+
+/* The framing is ASCII on the wire whatever the host's code page, so it is
+   matched by value: neither the literal '\r' nor '0' is the wire's byte on
+   MVS. */
+#define A_HT            0x09
+#define A_LF            0x0A
+#define A_CR            0x0D
+#define A_SP            0x20
+#define A_SEMI          0x3B
+
+enum {
+	BDS_LENGTH,                     /* in a Content-Length body */
+	BDS_SIZE,                       /* in a chunk size's hex digits */
+	BDS_SIZE_WS,                    /* blanks after the digits */
+	BDS_EXT,                        /* a chunk extension, to the LF */
+	BDS_SIZE_LF,                    /* the size line's CR seen */
+	BDS_DATA,                       /* in a chunk */
+	BDS_DATA_CR,                    /* the CRLF after a chunk */
+	BDS_DATA_LF,                    /* its CR seen */
+	BDS_TRAILER,                    /* a trailer line, or the empty one */
+	BDS_TRAILER_LF,                 /* its CR seen */
+	BDS_DONE
+};
+
+/* 0..15 for an ASCII hex digit, -1 for anything else */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'bodydec_hex'");
+#endif
+static int
+bodydec_hex(int c)
+{
+	if (c >= 0x30 && c <= 0x39) {
+		return c - 0x30;
+	}
+	if (c >= 0x41 && c <= 0x46) {
+		return c - 0x41 + 10;
+	}
+	if (c >= 0x61 && c <= 0x66) {
+		return c - 0x61 + 10;
+	}
+	return -1;
+}
+
+/* The end of a size line: a chunk follows, or the trailers. */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'bodydec_sized'");
+#endif
+static int
+bodydec_sized(BODYDEC *bd)
+{
+	if (bd->digits == 0) {
+		return BODY_EFRAME;
+	}
+	bd->line_len = 0;
+	if (bd->size == 0) {
+		bd->state = BDS_TRAILER;
+		return 0;
+	}
+	bd->remaining = bd->size;
+	bd->chunks++;
+	bd->state = BDS_DATA;
+	return 0;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'bodydec_init'");
+#endif
+void
+bodydec_init(BODYDEC *bd, int chunked, size_t length)
+{
+	memset(bd, 0, sizeof(*bd));
+	if (chunked) {
+		bd->state = BDS_SIZE;
+	} else {
+		bd->remaining = length;
+		bd->state = length ? BDS_LENGTH : BDS_DONE;
+	}
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'bodydec_feed'");
+#endif
+long
+bodydec_feed(BODYDEC *bd, char *buf, size_t len, BODY_SINK sink, void *ctx)
+{
+	size_t i = 0;
+	size_t n;
+	int c;
+	int h;
+
+	while (i < len && bd->state != BDS_DONE) {
+		if (bd->state == BDS_LENGTH || bd->state == BDS_DATA) {
+			n = len - i;
+			if (n > bd->remaining) {
+				n = bd->remaining;
+			}
+			if (!bd->failed && sink(ctx, buf + i, n) < 0) {
+				bd->failed = 1;
+			}
+			bd->total += n;
+			bd->remaining -= n;
+			i += n;
+			if (bd->remaining == 0) {
+				bd->state = bd->state == BDS_LENGTH ? BDS_DONE : BDS_DATA_CR;
+			}
+			continue;
+		}
+
+		c = (unsigned char) buf[i++];
+		if ((bd->state <= BDS_EXT || bd->state == BDS_TRAILER)
+		    && c != A_CR && c != A_LF) {
+			if (++bd->line_len > BODY_LINE_MAX) {
+				return BODY_EFRAME;
+			}
+		}
+
+		switch (bd->state) {
+		case BDS_SIZE:
+			h = bodydec_hex(c);
+			if (h >= 0) {
+				if (bd->size > ((size_t) -1 >> 4)) {
+					return BODY_EFRAME;
+				}
+				bd->size = (bd->size << 4) | (size_t) h;
+				bd->digits++;
+				break;
+			}
+			/* FALLTHROUGH */
+		case BDS_SIZE_WS:
+			if (c == A_SP || c == A_HT) {
+				bd->state = BDS_SIZE_WS;
+			} else if (c == A_SEMI) {
+				bd->state = BDS_EXT;
+			} else if (c == A_CR) {
+				bd->state = BDS_SIZE_LF;
+			} else if (c == A_LF) {
+				if (bodydec_sized(bd) < 0) {
+					return BODY_EFRAME;
+				}
+			} else {
+				return BODY_EFRAME;
+			}
+			break;
+
+		case BDS_EXT:
+			if (c == A_LF && bodydec_sized(bd) < 0) {
+				return BODY_EFRAME;
+			}
+			break;
+
+		case BDS_SIZE_LF:
+			if (c != A_LF || bodydec_sized(bd) < 0) {
+				return BODY_EFRAME;
+			}
+			break;
+
+		case BDS_DATA_CR:
+			if (c == A_CR) {
+				bd->state = BDS_DATA_LF;
+				break;
+			}
+			/* FALLTHROUGH */
+		case BDS_DATA_LF:
+			if (c != A_LF) {
+				return BODY_EFRAME;
+			}
+			bd->size = 0;
+			bd->digits = 0;
+			bd->line_len = 0;
+			bd->state = BDS_SIZE;
+			break;
+
+		case BDS_TRAILER:
+			if (c == A_CR) {
+				bd->state = BDS_TRAILER_LF;
+				break;
+			}
+			/* FALLTHROUGH */
+		case BDS_TRAILER_LF:
+			if (c == A_LF) {
+				/* the empty line ends the body; any other ends a trailer */
+				bd->state = bd->line_len == 0 ? BDS_DONE : BDS_TRAILER;
+				bd->line_len = 0;
+			} else if (bd->state == BDS_TRAILER_LF) {
+				return BODY_EFRAME;
+			}
+			break;
+		}
+	}
+
+	return (long) i;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'bodydec_want'");
+#endif
+size_t
+bodydec_want(const BODYDEC *bd)
+{
+	switch (bd->state) {
+	case BDS_LENGTH:
+	case BDS_DATA:
+		return bd->remaining;
+	case BDS_DONE:
+		return 0;
+	default:
+		return 1;
+	}
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'bodydec_done'");
+#endif
+int
+bodydec_done(const BODYDEC *bd)
+{
+	return bd->state == BDS_DONE;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'body_pump'");
+#endif
+int
+body_pump(BODYDEC *bd, BODY_RECV recv, void *rctx, char *buf, size_t size,
+    BODY_SINK sink, void *sctx)
+{
+	size_t want;
+	long used;
+	int n;
+
+	while (!bodydec_done(bd)) {
+		want = bodydec_want(bd);
+		if (want > size) {
+			want = size;
+		}
+		n = recv(rctx, buf, (int) want);
+		if (n <= 0) {
+			return BODY_ERECV;
+		}
+		used = bodydec_feed(bd, buf, (size_t) n, sink, sctx);
+		if (used < 0) {
+			return (int) used;
+		}
+	}
+
+	return bd->failed ? BODY_ESINK : 0;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'bodymem_sink'");
+#endif
+int
+bodymem_sink(void *ctx, char *data, size_t len)
+{
+	BODYMEM *m = ctx;
+	size_t need = m->len + len + 1;
+	size_t cap;
+	char *p;
+
+	if (need > m->cap) {
+		if (m->grow) {
+			cap = m->cap ? m->cap : 1024;
+			while (cap < need) {
+				cap *= 2;
+			}
+			p = realloc(m->buf, cap);
+			if (!p) {
+				return -1;
+			}
+			m->buf = p;
+			m->cap = cap;
+		} else {
+			cap = m->cap > m->len + 1 ? m->cap - m->len - 1 : 0;
+			m->dropped += len - cap;
+			len = cap;
+		}
+	}
+
+	if (len) {
+		memcpy(m->buf + m->len, data, len);
+		m->len += len;
+	}
+	if (m->cap) {
+		m->buf[m->len] = '\0';
+	}
+	return 0;
+}
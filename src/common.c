@@ -4,14 +4,21 @@
 #include <clibthrd.h>
 #include <clibwto.h>
 #include <errno.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "bodydec.h"
 #include "common.h"
+#include "deflate.h"
 #include "httpcgi.h"
+#include "inflate.h"
 #include "json.h"
+#include "mvsmfctx.h"	/* mvsmf_metrics */
 #include "mvsmfmsg.h"
+#include "mvssupa.h"	/* __getclk */
+#include "routes.h"
 #include "sendall.h"
 
 #define INITIAL_BUFFER_SIZE 4096
@@ -20,7 +27,7 @@
 // private function prototypes
 //
 
-static int send_data(Session *session, char *buf);
+static int send_data(Session *session, char *buf, size_t len);
 static char *get_env_param(Session *session, const char *prefix, const char *name);
 
 //
@@ -30,25 +37,68 @@ static char *get_env_param(Session *session, const char *prefix, const char *nam
 char *
 getQueryParam(Session *session, const char *name)
 {
+	int id;
+
+	/* a name the context has a slot for is answered from it, present or
+	   not: the walk saw every variable, so NULL there is final */
+	if (session && session->req.filled &&
+			(id = reqctx_query_id(name)) >= 0) {
+		return (char *)session->req.qry[id];
+	}
 	return get_env_param(session, "QUERY_", name);
 }
 
 char *
 getPathParam(Session *session, const char *name)
 {
-	return get_env_param(session, "HTTP_", name);
+	int i;
+
+	if (!session || !session->req.path || !name) {
+		return NULL;
+	}
+
+	for (i = 0; i < session->req.match.ncaps; i++) {
+		if (strcmp(session->req.match.caps[i].name, name) == 0) {
+			return session->req.path + session->req.match.caps[i].off;
+		}
+	}
+	return NULL;
+}
+
+char *
+getPathVar(Session *session, int var)
+{
+	int i;
+
+	if (!session || !session->req.path) {
+		return NULL;
+	}
+
+	/* at most RT_MAX_CAPS entries, so a scan beats any index */
+	for (i = 0; i < session->req.match.ncaps; i++) {
+		if (session->req.match.caps[i].var == var) {
+			return session->req.path + session->req.match.caps[i].off;
+		}
+	}
+	return NULL;
 }
 
 char *
 getHeaderParam(Session *session, const char *name)
 {
+	int id;
+
+	if (session && session->req.filled &&
+			(id = reqctx_header_id(name)) >= 0) {
+		return (char *)session->req.hdr[id];
+	}
 	return get_env_param(session, "HTTP_", name);
 }
 
 const char *
 getRequestScheme(Session *session)
 {
-	const char *proto = getHeaderParam(session, "X-Forwarded-Proto");
+	const char *proto = session->req.hdr[RQH_X_FORWARDED_PROTO];
 
 	if (!proto) {
 		return "http";
@@ -110,11 +160,11 @@ int is_browser_fetch(Session *session)
 {
 	const char *mode;
 
-	if (getHeaderParam(session, "X-MVSMF-Client")) {
+	if (session->req.hdr[RQH_X_MVSMF_CLIENT]) {
 		return 1;
 	}
 
-	mode = getHeaderParam(session, "Sec-Fetch-Mode");
+	mode = session->req.hdr[RQH_SEC_FETCH_MODE];
 	if (mode && strcmp(mode, "navigate") != 0) {
 		return 1;
 	}
@@ -213,7 +263,7 @@ send_session_cookie(Session *session)
 	int toklen;
 	int rc = 0;
 
-	if (!getHeaderParam(session, "Authorization")) {
+	if (!session->req.hdr[RQH_AUTHORIZATION]) {
 		return 0;
 	}
 
@@ -240,6 +290,8 @@ __asm__("\n&FUNC	SETC 'send_common_headers'");
 int
 send_common_headers(Session *session)
 {
+	unsigned long long now;
+	char timing[256];
 	int rc;
 
 	if ((rc = http_printf(session->httpc,
@@ -257,6 +309,17 @@ send_common_headers(Session *session)
 	   a JSON reply and withhold it from a data set read in the same session. */
 	if ((rc = send_session_cookie(session)) < 0) return rc;
 
+	/* The phases that finished before the first body byte (trace.h) -- the
+	   access check, the count, the ETag pass, the open. The record loop and
+	   the sends come after this line and are only in the slow-request WTO.
+	   Same reason as the cookie for being here: every response with headers
+	   passes through this function. */
+	__getclk(&now);
+	if (trace_server_timing(&session->trace, now, timing, sizeof(timing)) > 0) {
+		if ((rc = http_printf(session->httpc,
+				"Server-Timing: %s\r\n", timing)) < 0) return rc;
+	}
+
 	return rc;
 }
 
@@ -265,10 +328,11 @@ sendDefaultHeaders(Session *session, int status, const char *content_type,
 					   size_t content_length)
 {
 	int irc = 0;
+	int gzip = 0;
 
 	session->headers_sent = 1;
 
-	irc = http_resp(session->httpc, status);
+	irc = session_resp(session, status);
 	if (irc < 0) {
 		goto quit;
 	}
@@ -278,9 +342,19 @@ sendDefaultHeaders(Session *session, int status, const char *content_type,
 		if (irc < 0) {
 			goto quit;
 		}
+
+		/* A compressed body's length is known only once it has been
+		   compressed, so it goes out chunked like a streamed one. */
+		if (status == HTTP_STATUS_OK) {
+			gzip = send_gzip_offer(session, content_length);
+			if (gzip < 0) {
+				irc = gzip;
+				goto quit;
+			}
+		}
 	}
 
-	if (content_length > 0) {
+	if (content_length > 0 && !gzip) {
 		irc = http_printf(session->httpc, "Content-Length: %d\r\n", content_length);
 		if (irc < 0) {
 			goto quit;
@@ -321,36 +395,111 @@ quit:
 	return irc;
 }
 
+// JsonFlush for a streamed response: the 200 and its headers with the
+// first window -- no Content-Length, so httpd frames the body chunked --
+// then each window translated where it lies and sent.
+__asm__("\n&FUNC	SETC 'json_stream_flush'");
+static int
+json_stream_flush(void *ctx, char *buf, size_t len)
+{
+	Session *session = (Session *)ctx;
+
+	if (!buf) {
+		// Abandoned: the client has part of a document that will not be
+		// completed. Nothing more may go out on this response, and the
+		// connection must not be reused -- the same cut send_all() makes
+		// when a send fails, and for the same reason.
+		wtof(MSG_HEADERS_SENT);
+		if (session->httpc->state < CSTATE_DONE) {
+			session->httpc->state = CSTATE_DONE;
+		}
+		session->httpc->keepalive = 0;
+		return 0;
+	}
+
+	if (!session->headers_sent) {
+		if (sendDefaultHeaders(session, HTTP_STATUS_OK,
+							   HTTP_CONTENT_TYPE_JSON, 0) < 0) {
+			return -1;
+		}
+	}
+
+	http_etoa((unsigned char *)buf, len);
+
+	return send_all(session, (const UCHAR *)buf, (int)len);
+}
+
+// The capacity this route's JSON documents have needed lately (metrics.h):
+// 0 when the route has no history, or there is no metrics block to ask.
+__asm__("\n&FUNC	SETC 'json_presize'");
+static size_t
+json_presize(Session *session)
+{
+	MVSMF_METRICS *m = mvsmf_metrics(session->httpd);
+
+	if (!m) {
+		return 0;
+	}
+
+	return metrics_presize(&m->route[metrics_slot(session->req.match.route)]);
+}
+
+__asm__("\n&FUNC	SETC 'createJsonResponse'");
+JsonBuilder *
+createJsonResponse(Session *session, int flags)
+{
+	JsonBuilder *builder = createJsonBuilderIn(&session->arena);
+
+	if (builder && (flags & JSON_STREAMED)) {
+		if (streamJsonBuilder(builder, json_stream_flush, session) < 0) {
+			freeJsonBuilder(builder);
+			return NULL;
+		}
+	} else if (builder) {
+		// sized once, for what this route has been sending: a failure
+		// leaves the builder as it was, to grow the usual way
+		(void)reserveJsonBuilder(builder, json_presize(session));
+	}
+
+	return builder;
+}
+
 int 
 sendJSONResponse(Session *session, int status, JsonBuilder *builder)
 {
   	int irc = 0;
-  	char *json_str = NULL;
 
 	if (!builder) {
 		irc = -1;
 		goto quit;
 	}
 
-	json_str = getJsonString(builder);
-	if (!json_str) {
-		irc = -1;
+	// streamed, and the window has overflowed at least once: the status
+	// went out with it, and only the tail is left
+	if (builder->flushed) {
+		irc = finishJsonBuilder(builder);
 		goto quit;
 	}
 
+	// what the next builder on this route is sized from (router.c)
+	if (!builder->flush) {
+		session->json_size = (unsigned)builder->size;
+	}
+
 	irc = sendDefaultHeaders(session, status, HTTP_CONTENT_TYPE_JSON,
-							strlen(json_str));
+							builder->size);
 	if (irc < 0) {
 		goto quit;
 	}
 
-	irc = send_data(session, json_str);
+	// The builder's own buffer goes out, translated where it lies -- no
+	// copy, and no strlen() of what the builder already counted. It is
+	// ASCII afterwards, so the builder is emptied: nothing may add to it.
+	irc = send_data(session, builder->buffer, builder->size);
+	builder->size = 0;
+	builder->buffer[0] = '\0';
 
 quit:
-	if (json_str) {
-		free(json_str);
-	}
-
   	return irc;
 }
 
@@ -361,7 +510,7 @@ sendErrorResponse(Session *session, int status, int category, int rc,
 {
 	int irc = RC_SUCCESS;  
 
-	JsonBuilder *builder = createJsonBuilder();
+	JsonBuilder *builder = createJsonResponse(session, 0);
 	if (!builder) {
 		goto quit;
 	}
@@ -435,15 +584,20 @@ quit:
 }
 
 int
-send_not_modified(Session *session, const char *etag)
+send_not_modified(Session *session, const char *etag, const char *lastmod)
 {
 	int rc;
 
 	session->headers_sent = 1;
-	if ((rc = http_resp(session->httpc,
+	if ((rc = session_resp(session,
 			HTTP_STATUS_NOT_MODIFIED)) < 0) return rc;
 	if ((rc = send_common_headers(session)) < 0) return rc;
-	if ((rc = http_printf(session->httpc, "ETag: %s\r\n", etag)) < 0) return rc;
+	if (etag) {
+		if ((rc = http_printf(session->httpc, "ETag: %s\r\n", etag)) < 0) return rc;
+	}
+	if (lastmod) {
+		if ((rc = http_printf(session->httpc, "Last-Modified: %s\r\n", lastmod)) < 0) return rc;
+	}
 	if ((rc = http_printf(session->httpc, "\r\n")) < 0) return rc;
 
 	return rc;
@@ -507,11 +661,10 @@ send_op_pause(void *ctx)
 	(void)cthread_timed_wait((void *)&ecb, SEND_STALL_PAUSE, 0);
 }
 
-__asm__("\n&FUNC    SETC 'send_op_abort'");
-static int
-send_op_aborted(void *ctx)
+__asm__("\n&FUNC    SETC 'session_aborted'");
+int
+session_aborted(Session *session)
 {
-	Session *session = (Session *)ctx;
 	unsigned char flag;
 
 	// The client is finished or a failed send already marked it dead:
@@ -524,7 +677,7 @@ send_op_aborted(void *ctx)
 	// for the workers, so every worker wait has to honor quiesce
 	// (httpd#122, #205). The macro is a volatile read and this function runs
 	// once per poll, so the byte the operator-command thread sets is picked
-	// up on the next turn -- never hoisted out of the send loop.
+	// up on the next turn -- never hoisted out of the wait loop.
 	flag = http_get_flag(session->httpd);
 	if (flag & (HTTPD_FLAG_QUIESCE | HTTPD_FLAG_SHUTDOWN)) {
 		return 1;
@@ -533,6 +686,13 @@ send_op_aborted(void *ctx)
 	return 0;
 }
 
+__asm__("\n&FUNC    SETC 'send_op_abort'");
+static int
+send_op_aborted(void *ctx)
+{
+	return session_aborted((Session *)ctx);
+}
+
 __asm__("\n&FUNC    SETC 'send_op_gvup'");
 static void
 send_op_giveup(void *ctx, int stall)
@@ -550,44 +710,398 @@ static const SEND_OPS send_ops = {
 	send_op_giveup
 };
 
+// The gzip stage (deflate.h), for a body send_gzip_offer() armed. The
+// buffer hands its bytes to the encoder instead of the socket, and the
+// encoder hands what it makes to send_bytes() with the real ops, so the
+// #298 policy applies to the compressed bytes as it did to the plain ones.
+// A failed send fails the feed, and the feed failing fails the buffer the
+// way a dead socket would. The buffer's `sent` counts the plain bytes,
+// which is what the metrics have always counted.
+__asm__("\n&FUNC    SETC 'gzip_sink'");
+static int
+gzip_sink(void *ctx, const unsigned char *data, size_t len)
+{
+	return send_bytes(ctx, &send_ops, data, (int)len);
+}
+
+__asm__("\n&FUNC    SETC 'gzip_op_send'");
+static int
+gzip_op_send(void *ctx, const unsigned char *buf, int len)
+{
+	Session *session = (Session *)ctx;
+
+	if (defl_feed(session->gz, buf, (size_t)len, gzip_sink, session) < 0) {
+		return -1;
+	}
+
+	return len;
+}
+
+static const SEND_OPS gzip_ops = {
+	gzip_op_send,
+	send_op_pause,
+	send_op_aborted,
+	send_op_giveup
+};
+
+#define SEND_OPS_OF(session) ((session)->gz ? &gzip_ops : &send_ops)
+
+// The smallest body worth compressing, by route; 0 where none is. The
+// routes are the ones whose bodies are text and long: downloads, spool and
+// listings. Below a few segments the CPU the encoder costs is more than the
+// wire time it saves.
+static const unsigned gzip_min[ROUTE_COUNT] = {
+	[ROUTE_JOB_LIST]	= 4096,
+	[ROUTE_JOB_RECORDS]	= 2048,
+	[ROUTE_DS_LIST]		= 4096,
+	[ROUTE_DS_GET]		= 2048,
+	[ROUTE_DS_GET_VOL]	= 2048,
+	[ROUTE_MBR_LIST]	= 4096,
+	[ROUTE_MBR_LIST_VOL]	= 4096,
+	[ROUTE_MBR_GET]		= 2048,
+	[ROUTE_MBR_GET_VOL]	= 2048,
+};
+
+// The search budget to compress this response with, 0 for a plain body.
+// A body of unknown size is judged by what the route has averaged; a route
+// with no history yet is given the benefit of the doubt.
+__asm__("\n&FUNC    SETC 'gzip_budget'");
+static int
+gzip_budget(Session *session, size_t expect)
+{
+	const char *v = getenv("MVSMF_GZIP");
+	int route = session->req.match.route;
+	MVSMF_METRICS *m;
+	MET_ROUTE *r;
+	int chain;
+
+	if (!v || (chain = atoi(v)) <= 0 || !session->req.accept_gzip) {
+		return 0;
+	}
+	if (route < 0 || route >= ROUTE_COUNT || gzip_min[route] == 0) {
+		return 0;
+	}
+
+	if (expect == 0 && (m = mvsmf_metrics(session->httpd)) != NULL) {
+		r = &m->route[metrics_slot(route)];
+		if (r->count > 0) {
+			expect = (size_t)(r->bytes_out / r->count);
+		}
+	}
+	if (expect != 0 && expect < gzip_min[route]) {
+		return 0;
+	}
+
+	return chain;
+}
+
+__asm__("\n&FUNC    SETC 'send_gzip_offer'");
+int
+send_gzip_offer(Session *session, size_t expect)
+{
+	DEFLATE *d;
+	int chain;
+	int rc;
+
+	if (session->gz || (chain = gzip_budget(session, expect)) <= 0) {
+		return 0;
+	}
+
+	// no storage, no compression: slower on the wire, never wrong
+	d = arena_alloc(&session->arena, sizeof(DEFLATE));
+	if (!d) {
+		return 0;
+	}
+
+	if ((rc = http_printf(session->httpc,
+			"Content-Encoding: gzip\r\n")) < 0) return rc;
+	if ((rc = http_printf(session->httpc,
+			"Vary: Accept-Encoding\r\n")) < 0) return rc;
+
+	defl_init(d, chain);
+	session->gz = d;
+
+	return 1;
+}
+
+__asm__("\n&FUNC    SETC 'send_gzip_wanted'");
+int
+send_gzip_wanted(Session *session, size_t expect)
+{
+	return session->gz || gzip_budget(session, expect) > 0;
+}
+
+// The session's coalescing buffer (sendall.h), its storage taken from the
+// request arena on first use, so it lives and dies with the request. If the
+// arena cannot supply it the buffer stays detached and every write is its
+// own send -- slower, never wrong.
+__asm__("\n&FUNC    SETC 'send_buffer'");
+static SEND_BUF *
+send_buffer(Session *session)
+{
+	SEND_BUF *sb = &session->out;
+	unsigned char *storage;
+
+	if (!sb->buf && !sb->failed) {
+		storage = arena_alloc(&session->arena, SEND_BUF_SIZE);
+		if (storage) {
+			sb->buf = storage;
+			sb->size = SEND_BUF_SIZE;
+		}
+	}
+
+	return sb;
+}
+
+// A send failed: drop the connection, both halves of it.
+//
+// CSTATE_DONE stops the handler's remaining output -- http_printf() and the
+// entry guard in send_bytes() both refuse a client at CSTATE_DONE --
+// instead of every later call paying its own 10 second budget for a peer
+// that is gone (httpd#203).
+//
+// It does NOT close the socket, though: DONE is the normal completion
+// state, and httpd walks DONE -> REPORT -> RESET, where httprese() keeps the
+// connection open if keepalive is still set. That is fine for a response
+// that finished and wrong for this one -- the body is short of the
+// Content-Length it announced, so the next response on the socket would be
+// appended to a truncated one and the client would read the two as a single
+// corrupt reply. Clearing keepalive sends httprese() down its CSTATE_CLOSE
+// branch. httpd's chunked path clears the same flag for the same reason.
+__asm__("\n&FUNC    SETC 'send_cut'");
+static void
+send_cut(Session *session)
+{
+	if (session->httpc->state < CSTATE_DONE) {
+		session->httpc->state = CSTATE_DONE;
+	}
+	session->httpc->keepalive = 0;
+}
+
+// Everything that can reach the socket: a write that overflows the buffer,
+// or a flush (buf NULL). The "send" span and the byte count cover what
+// actually went out, not what was copied into the buffer.
+__asm__("\n&FUNC    SETC 'send_out'");
+static int
+send_out(Session *session, const UCHAR *buf, int len)
+{
+	SEND_BUF *sb = &session->out;
+	unsigned long before = sb->sent;
+	int span;
+	int rc;
+
+	span = session_span_begin(session, "send");
+	if (buf) {
+		rc = sendbuf_write(sb, session, SEND_OPS_OF(session),
+			(const unsigned char *)buf, len);
+	} else {
+		rc = sendbuf_flush(sb, session, SEND_OPS_OF(session));
+	}
+	session_span_end(session, span);
+
+	session->bytes_sent += sb->sent - before;	/* metrics.h */
+
+	if (rc < 0) {
+		send_cut(session);
+	}
+
+	return rc;
+}
+
 __asm__("\n&FUNC    SETC 'send_all'");
 int
 send_all(Session *session, const UCHAR *buf, int len)
 {
-	int rc;
+	SEND_BUF *sb;
 
 	if (!session || !session->httpc) {
 		return -1;
 	}
 
-	rc = send_bytes(session, &send_ops, (const unsigned char *)buf, len);
+	// The common case by far -- one record, one list line -- joins what is
+	// pending: a copy, no send, and no clock read for the span.
+	sb = send_buffer(session);
+	if (sb->buf && !sb->failed && SENDBUF_FITS(sb, len)) {
+		return sendbuf_write(sb, session, SEND_OPS_OF(session),
+			(const unsigned char *)buf, len);
+	}
+
+	return send_out(session, buf, len);
+}
+
+__asm__("\n&FUNC    SETC 'send_flush'");
+int
+send_flush(Session *session)
+{
+	if (!session || !session->httpc) {
+		return -1;
+	}
+
+	if (session->out.len == 0 && !session->out.failed) {
+		return 0;
+	}
+
+	return send_out(session, NULL, 0);
+}
+
+// The flush, and for a gzipped body the encoder's tail: the last block and
+// the trailer. The encoder goes with it, so a later flush is a plain one.
+__asm__("\n&FUNC    SETC 'send_finish'");
+int
+send_finish(Session *session)
+{
+	DEFLATE *gz;
+	int span;
+	int rc;
 
+	rc = send_flush(session);
+	if (!session || !session->gz) {
+		return rc;
+	}
+
+	gz = session->gz;
+	session->gz = NULL;
 	if (rc < 0) {
-		// Drop the connection, both halves of it.
-		//
-		// CSTATE_DONE stops the handler's remaining output --
-		// http_printf() and the entry guard in send_bytes() both refuse a
-		// client at CSTATE_DONE -- instead of every later call paying its
-		// own 10 second budget for a peer that is gone (httpd#203).
-		//
-		// It does NOT close the socket, though: DONE is the normal
-		// completion state, and httpd walks DONE -> REPORT -> RESET, where
-		// httprese() keeps the connection open if keepalive is still set.
-		// That is fine for a response that finished and wrong for this one
-		// -- the body is short of the Content-Length it announced, so the
-		// next response on the socket would be appended to a truncated one
-		// and the client would read the two as a single corrupt reply.
-		// Clearing keepalive sends httprese() down its CSTATE_CLOSE branch.
-		// httpd's chunked path clears the same flag for the same reason.
-		if (session->httpc->state < CSTATE_DONE) {
-			session->httpc->state = CSTATE_DONE;
-		}
-		session->httpc->keepalive = 0;
+		return rc;		/* cut already */
+	}
+
+	span = session_span_begin(session, "send");
+	rc = defl_end(gz, gzip_sink, session);
+	session_span_end(session, span);
+	if (rc < 0) {
+		send_cut(session);
 	}
 
 	return rc;
 }
 
+// http_printf() for body text, into the buffer. Formatted in place behind
+// what is pending and translated there, so a list line costs one vsnprintf
+// and one http_etoa() over its own bytes -- no staging copy. A line that
+// does not fit behind the pending bytes is formatted again at the start once
+// they are sent; one longer than the whole buffer is formatted into request
+// storage and goes through send_all() in one piece.
+__asm__("\n&FUNC    SETC 'send_printf'");
+int
+send_printf(Session *session, const char *fmt, ...)
+{
+	va_list ap;
+	SEND_BUF *sb;
+	char line[256];
+	char *text;
+	int room;
+	int n = -1;
+
+	if (!session || !session->httpc) {
+		return -1;
+	}
+
+	sb = send_buffer(session);
+	if (sb->failed) {
+		return -1;
+	}
+
+	if (sb->buf) {
+		room = sb->size - sb->len;
+		if (room > 0) {
+			va_start(ap, fmt);
+			n = vsnprintf((char *)sb->buf + sb->len, room, fmt, ap);
+			va_end(ap);
+			if (n >= 0 && n < room) {
+				http_etoa(sb->buf + sb->len, n);
+				sb->len += n;
+				return 0;
+			}
+		}
+
+		if (n < 0 || n < sb->size) {
+			if (send_flush(session) < 0) {
+				return -1;
+			}
+			va_start(ap, fmt);
+			n = vsnprintf((char *)sb->buf, sb->size, fmt, ap);
+			va_end(ap);
+			if (n >= 0 && n < sb->size) {
+				http_etoa(sb->buf, n);
+				sb->len = n;
+				return 0;
+			}
+		}
+	} else {
+		va_start(ap, fmt);
+		n = vsnprintf(line, sizeof(line), fmt, ap);
+		va_end(ap);
+		if (n >= 0 && n < (int)sizeof(line)) {
+			http_etoa((unsigned char *)line, n);
+			return send_all(session, (const UCHAR *)line, n);
+		}
+	}
+
+	if (n < 0) {
+		return -1;
+	}
+
+	text = arena_alloc(&session->arena, (size_t)n + 1);
+	if (!text) {
+		return -1;
+	}
+	va_start(ap, fmt);
+	vsnprintf(text, (size_t)n + 1, fmt, ap);
+	va_end(ap);
+	http_etoa((unsigned char *)text, n);
+
+	return send_all(session, (const UCHAR *)text, n);
+}
+
+__asm__("\n&FUNC	SETC 'send_item'");
+int
+send_item(Session *session, const JT_OP *t, const JT_VAL *v)
+{
+	SEND_BUF *sb;
+	char *text;
+	size_t size;
+	int n = -1;
+
+	if (!session || !session->httpc) {
+		return -1;
+	}
+
+	sb = send_buffer(session);
+	if (sb->failed) {
+		return -1;
+	}
+
+	if (sb->buf) {
+		n = jt_render(t, v, (char *)sb->buf + sb->len, sb->size - sb->len);
+		if (n < 0 && sb->len > 0) {
+			if (send_flush(session) < 0) {
+				return -1;
+			}
+			n = jt_render(t, v, (char *)sb->buf, sb->size);
+		}
+		if (n >= 0) {
+			http_etoa(sb->buf + sb->len, n);
+			sb->len += n;
+			return 0;
+		}
+	}
+
+	// larger than the buffer, or there is none: render it where it fits
+	for (size = 2 * SEND_BUF_SIZE; ; size *= 2) {
+		text = arena_alloc(&session->arena, size);
+		if (!text) {
+			return -1;
+		}
+		n = jt_render(t, v, text, size);
+		if (n >= 0) {
+			break;
+		}
+	}
+	http_etoa((unsigned char *)text, n);
+
+	return send_all(session, (const UCHAR *)text, n);
+}
+
 //
 // Read raw data from socket, one byte at a time.
 // Works around the MVS 3.8j TCP/IP ring buffer bug that corrupts data
@@ -709,173 +1223,245 @@ receive_raw_some(HTTPC *httpc, char *buf, int len)
 }
 
 //
-// Read the full request body into a malloc'd buffer.
-// Supports both Content-Length and Transfer-Encoding: chunked.
-// Caller must free the returned buffer via free().
-// Returns 0 on success, -1 on error.
+// The request body through bodydec (bodydec.h), whichever its framing, to a
+// sink. This is the one place a body is decoded; the transport is the
+// caller's choice of the two below, and that choice is where the ring-buffer
+// workaround lives now. body_recv_bytes() is receive_raw_data(), a byte per
+// recv(), and is what every path not already reading in bulk must use.
+// body_recv_some() is receive_raw_some(), for the binary PUT paths that have
+// always read that way (see above).
 //
 
+#define BODY_RECV_SIZE 4096
+
+__asm__("\n&FUNC    SETC 'body_recv_bytes'");
 int
-read_request_content(Session *session, char **content, size_t *content_size)
+body_recv_bytes(void *httpc, char *buf, int len)
+{
+	return receive_raw_data((HTTPC *)httpc, buf, len);
+}
+
+__asm__("\n&FUNC    SETC 'body_recv_some'");
+int
+body_recv_some(void *httpc, char *buf, int len)
+{
+	return receive_raw_some((HTTPC *)httpc, buf, len);
+}
+
+__asm__("\n&FUNC    SETC 'drop_sink'");
+static int
+drop_sink(void *ctx, char *data, size_t len)
+{
+	(void)ctx;
+	(void)data;
+	(void)len;
+	return 0;
+}
+
+__asm__("\n&FUNC    SETC 'receive_framed'");
+static int
+receive_framed(Session *session, BODY_RECV recv, BODY_SINK sink, void *ctx)
 {
-	size_t buffer_size = 0;
-	int bytes_received = 0;
-	int has_content_length = 0;
-	size_t content_length = 0;
-	int is_chunked = 0;
-	int done = 0;
+	BODYDEC bd;
+	char *buf;
 
-	// Check Content-Length header
-	const char *cl_str = getHeaderParam(session, "Content-Length");
-	if (cl_str != NULL) {
-		has_content_length = 1;
-		content_length = strtoul(cl_str, NULL, 10);
+	// Framing, as parsed from Content-Length and Transfer-Encoding
+	if (!session->req.chunked && !session->req.has_length) {
+		return BODY_EFRAME;
 	}
 
-	// Check Transfer-Encoding header
-	const char *te = getHeaderParam(session, "Transfer-Encoding");
-	if (te != NULL && strstr(te, "chunked") != NULL) {
-		is_chunked = 1;
+	buf = arena_alloc(&session->arena, BODY_RECV_SIZE);
+	if (!buf) {
+		wtof(MSG_STORAGE_FAILED, ALLOC_REQUEST_BODY);
+		return BODY_ERECV;
 	}
 
-	if (!is_chunked && !has_content_length) {
-		return -1;
+	bodydec_init(&bd, session->req.chunked, session->req.content_length);
+	return body_pump(&bd, recv, session->httpc, buf, BODY_RECV_SIZE,
+		sink, ctx);
+}
+
+//
+// A body sent with Content-Encoding: gzip or deflate is inflated between
+// the framing and the caller's sink (inflate.h), so a handler never sees
+// the coding. The point is the wire: a text body still comes a byte per
+// recv(), and JCL or source deflates four to eight times.
+//
+// The inflater sits in front of the sink as a sink itself. When it fails,
+// bodydec drains the rest of the body as for any failed sink, and
+// z->err tells whose failure BODY_ESINK was: the caller's sink's
+// (INFL_ESINK), or the stream's, which is BODY_ECODING.
+//
+
+typedef struct body_inflate {
+	INFLATE        *z;
+	BODY_SINK       sink;
+	void           *ctx;
+} BODY_INFLATE;
+
+__asm__("\n&FUNC    SETC 'inflate_sink'");
+static int
+inflate_sink(void *ctx, char *data, size_t len)
+{
+	BODY_INFLATE *bi = (BODY_INFLATE *)ctx;
+
+	return infl_feed(bi->z, data, len, bi->sink, bi->ctx) < 0 ? -1 : 0;
+}
+
+__asm__("\n&FUNC    SETC 'receive_coded'");
+static int
+receive_coded(Session *session, BODY_RECV recv, BODY_SINK sink, void *ctx,
+	      size_t limit)
+{
+	BODY_INFLATE bi;
+	int rc;
+
+	switch (session->req.content_coding) {
+	case CODING_IDENTITY:
+		return receive_framed(session, recv, sink, ctx);
+	case CODING_GZIP:
+	case CODING_DEFLATE:
+		break;
+	default:
+		rc = receive_framed(session, recv, drop_sink, NULL);
+		return rc < 0 ? rc : BODY_ECODING;
 	}
 
-	// Allocate initial buffer
-	*content = malloc(INITIAL_BUFFER_SIZE);
-	if (!*content) {
-		wtof(MSG_STORAGE_FAILED, ALLOC_REQUEST_BODY);
-		return -1;
+	bi.z = arena_alloc(&session->arena, sizeof(INFLATE));
+	if (!bi.z) {
+		wtof(MSG_STORAGE_FAILED, ALLOC_BODY_INFLATER);
+		(void)receive_framed(session, recv, drop_sink, NULL);
+		return BODY_ESINK;
 	}
-	buffer_size = INITIAL_BUFFER_SIZE;
-	*content_size = 0;
+	bi.sink = sink;
+	bi.ctx = ctx;
+	infl_init(bi.z, session->req.content_coding == CODING_GZIP
+		? INFL_GZIP : INFL_DEFLATE, limit);
+
+	rc = receive_framed(session, recv, inflate_sink, &bi);
+	if (rc == BODY_ESINK) {
+		return bi.z->err == INFL_ESINK ? BODY_ESINK : BODY_ECODING;
+	}
+	if (rc < 0) {
+		return rc;
+	}
+	return infl_end(bi.z) == 0 ? 0 : BODY_ECODING;
+}
 
-	if (is_chunked) {
-		while (!done) {
-			char chunk_size_str[10];
-			int i = 0;
-
-			// Read chunk size line (hex + CRLF)
-			while (i < (int)sizeof(chunk_size_str) - 1) {
-				if (receive_raw_data(session->httpc,
-						chunk_size_str + i, 1) != 1) {
-					free(*content);
-					*content = NULL;
-					return -1;
-				}
-				if (chunk_size_str[i] == '\r') {
-					chunk_size_str[i] = '\0';
-					receive_raw_data(session->httpc,
-						chunk_size_str + i, 1);
-					break;
-				}
-				i++;
-			}
+__asm__("\n&FUNC    SETC 'receive_body'");
+int
+receive_body(Session *session, BODY_RECV recv, BODY_SINK sink, void *ctx)
+{
+	// A body streamed to a data set or file needs no bound on what it
+	// inflates to: its storage does not grow with it.
+	return receive_coded(session, recv, sink, ctx, 0);
+}
 
-			http_atoe((unsigned char *)chunk_size_str, i);
-			{
-				int chunk_size = (int)strtoul(chunk_size_str, NULL, 16);
-				int bytes_read = 0;
-
-				if (chunk_size == 0) {
-					// Drain the terminating CRLF of the chunked body (RFC 7230 4.1).
-					// Leaving it unread keeps 2 bytes in the socket; closing the
-					// connection with unread inbound data triggers a TCP RST that
-					// strict HTTP clients (Zowe/Node) report as ECONNRESET /
-					// "socket hang up". Best-effort: the body is already complete
-					// here, so do not fail on a short read. Trailers are not
-					// expected (Zowe sends none); mirrors dsapi.c.
-					char crlf[2];
-					(void)receive_raw_data(session->httpc, crlf, 2);
-					done = 1;
-					break;
-				}
+//
+// Read a body that is not wanted after all, so that it is not left in the
+// socket. Best-effort: the answer is already decided.
+//
 
-				// Ensure buffer capacity
-				if (*content_size + chunk_size > buffer_size) {
-					char *new_buf = realloc(*content,
-						*content_size + chunk_size + 1);
-					if (!new_buf) {
-						wtof(MSG_STORAGE_FAILED, ALLOC_REQUEST_BODY);
-						free(*content);
-						*content = NULL;
-						return -1;
-					}
-					*content = new_buf;
-					buffer_size = *content_size + chunk_size;
-				}
+__asm__("\n&FUNC    SETC 'drain_body'");
+void
+drain_body(Session *session)
+{
+	// the coded bytes as sent: there is nothing to inflate them for
+	(void)receive_framed(session, body_recv_bytes, drop_sink, NULL);
+}
 
-				// Read chunk data
-				while (bytes_read < chunk_size) {
-					bytes_received = receive_raw_data(session->httpc,
-						*content + *content_size + bytes_read,
-						chunk_size - bytes_read);
-					if (bytes_received <= 0) {
-						free(*content);
-						*content = NULL;
-						return -1;
-					}
-					bytes_read += bytes_received;
-				}
+//
+// What the stamp pass of a small object keeps (common.h). 32 KB to start, a
+// small member and its block in one piece, then doubling: the arena copies
+// on growth and hands the old chunk back, so the copies add up to less than
+// the object.
+//
 
-				*content_size += chunk_size;
-			}
+#define KEEP_FIRST (32 * 1024)
 
-			// Consume trailing CRLF after chunk data
-			{
-				char crlf[2];
-				if (receive_raw_data(session->httpc, crlf, 2) != 2) {
-					free(*content);
-					*content = NULL;
-					return -1;
-				}
-			}
-		}
-	} else {
-		char recv_buffer[1024];
-		while (*content_size < content_length) {
-			size_t remaining = content_length - *content_size;
-			size_t to_read = remaining < sizeof(recv_buffer)
-				? remaining : sizeof(recv_buffer);
-
-			if (*content_size + sizeof(recv_buffer) > buffer_size) {
-				char *new_buf = realloc(*content, buffer_size * 2);
-				if (!new_buf) {
-					wtof(MSG_STORAGE_FAILED, ALLOC_REQUEST_BODY);
-					free(*content);
-					*content = NULL;
-					return -1;
-				}
-				*content = new_buf;
-				buffer_size *= 2;
-			}
+__asm__("\n&FUNC    SETC 'keep_append'");
+int
+keep_append(Session *session, KEEPBUF *keep, const void *data, size_t len)
+{
+	size_t need = keep->used + len;
+	size_t size;
+	unsigned char *buf;
 
-			bytes_received = receive_raw_data(session->httpc,
-				*content + *content_size, (int)to_read);
-			if (bytes_received <= 0) {
-				free(*content);
-				*content = NULL;
-				return -1;
-			}
+	if (need > KEEP_MAX) {
+		return -1;
+	}
 
-			*content_size += bytes_received;
+	if (need > keep->size) {
+		size = keep->size ? keep->size : KEEP_FIRST;
+		while (size < need) {
+			size *= 2;
+		}
+		if (size > KEEP_MAX) {
+			size = KEEP_MAX;
+		}
+		buf = keep->buf
+			? arena_realloc(&session->arena, keep->buf, keep->size, size)
+			: arena_alloc(&session->arena, size);
+		if (!buf) {
+			return -1;
 		}
+		keep->buf = buf;
+		keep->size = size;
 	}
 
-	// Ensure null termination
-	if (*content_size + 1 > buffer_size) {
-		char *new_buf = realloc(*content, *content_size + 1);
-		if (!new_buf) {
+	memcpy(keep->buf + keep->used, data, len);
+	keep->used = need;
+	return 0;
+}
+
+//
+// Read the full request body into a malloc'd buffer.
+// Supports both Content-Length and Transfer-Encoding: chunked.
+// Caller must free the returned buffer via free().
+// Returns 0 on success, -1 on error.
+//
+// With a Content-Length the buffer is allocated once at its size; only a
+// chunked body, whose size is not known up front, grows it. So does a coded
+// one, and that is the body a client can make a thousand times larger than
+// what it sends: what it inflates to is held to INFLATED_BODY_MAX.
+//
+
+#define INFLATED_BODY_MAX (4 * 1024 * 1024)
+
+int
+read_request_content(Session *session, char **content, size_t *content_size)
+{
+	BODYMEM mem;
+	int rc;
+
+	*content = NULL;
+	*content_size = 0;
+
+	memset(&mem, 0, sizeof(mem));
+	mem.grow = 1;
+	mem.cap = INITIAL_BUFFER_SIZE;
+	if (!session->req.chunked && session->req.has_length) {
+		mem.cap = session->req.content_length + 1;
+	}
+	mem.buf = malloc(mem.cap);
+	if (!mem.buf) {
+		wtof(MSG_STORAGE_FAILED, ALLOC_REQUEST_BODY);
+		return -1;
+	}
+	mem.buf[0] = '\0';
+
+	rc = receive_coded(session, body_recv_bytes, bodymem_sink, &mem,
+		INFLATED_BODY_MAX);
+	if (rc < 0) {
+		if (rc == BODY_ESINK) {
 			wtof(MSG_STORAGE_FAILED, ALLOC_REQUEST_BODY);
-			free(*content);
-			*content = NULL;
-			return -1;
 		}
-		*content = new_buf;
+		free(mem.buf);
+		return -1;
 	}
-	(*content)[*content_size] = '\0';
 
+	*content = mem.buf;
+	*content_size = mem.len;
 	return 0;
 }
 
@@ -914,14 +1500,12 @@ get_env_param(Session *session, const char *prefix, const char *name)
  */
 __asm__("\n&FUNC	SETC 'send_data'");
 static int 
-send_data(Session *session, char *buf) 
+send_data(Session *session, char *buf, size_t len) 
 {
-	size_t len = strlen(buf);
-
 	http_etoa((unsigned char *)buf, len);
 
-	/* sendJSONResponse() sets Content-Length before this, so the response is
-	   NOT chunked -- which is precisely the mode where http_send() reports 0
+	/* sendJSONResponse() sets Content-Length before this (unless the body
+	   is gzipped, send_gzip_offer()), so the response is NOT chunked -- which is precisely the mode where http_send() reports 0
 	   for a full send buffer. Every JSON response mvsMF produces lands here,
 	   so this is the normal path, not an edge case (issue #298). */
 	return send_all(session, (const UCHAR *)buf, (int)len);
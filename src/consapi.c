@@ -16,6 +16,7 @@
 #include "httpcgi.h"
 #include "ntstore.h"
 #include "mvsmfctx.h"
+#include "routes.h"
 
 /*
  * z/OSMF Console services -- Issue command (endpoint 1).
@@ -204,7 +205,7 @@ static int send_console_error(Session *session, int http, int retcode,
                               int reason_code, const char *reason)
 {
 	int rc = 0;
-	JsonBuilder *b = createJsonBuilder();
+	JsonBuilder *b = createJsonResponse(session, 0);
 	if (!b) {
 		sendDefaultHeaders(session, http, HTTP_CONTENT_TYPE_NONE, 0);
 		return -1;
@@ -263,9 +264,13 @@ __asm__("\n&FUNC	SETC 'correlate_once'");
 static int correlate_once(Session *session, const char *cmd_upper, char *out,
                           size_t outsz, unsigned skip, unsigned *total)
 {
+	/* the snapshot is a copy of the whole MTT, made under its lock: the
+	   phase that grows with the trace table, not with the request */
+	int span = session_span_begin(session, "mtt");
 	CMTT *cmtt = cmtt_new();
 	MTENTRY **arr = cmtt ? cmtt_get_array(cmtt) : NULL;
 	unsigned n = arr ? array_count(&arr) : 0;
+	session_span_end(session, span);
 	int ei = -1;
 	unsigned i, line_idx = 0;
 	int appended = 0;
@@ -454,9 +459,13 @@ __asm__("\n&FUNC	SETC 'detect_count'");
 static int detect_count(Session *session, const char *keyword_upper,
                         char *latest, size_t lsz)
 {
+	/* the snapshot is a copy of the whole MTT, made under its lock: the
+	   phase that grows with the trace table, not with the request */
+	int span = session_span_begin(session, "mtt");
 	CMTT *cmtt = cmtt_new();
 	MTENTRY **arr = cmtt ? cmtt_get_array(cmtt) : NULL;
 	unsigned n = arr ? array_count(&arr) : 0;
+	session_span_end(session, span);
 	unsigned i;
 	int count = 0;
 
@@ -499,6 +508,7 @@ static int detect_count(Session *session, const char *keyword_upper,
 int consoleIssueHandler(Session *session)
 {
 	int rc = 0;
+	int span;
 	char *body = NULL;
 	size_t body_len = 0;
 	char *resp = NULL;
@@ -515,9 +525,9 @@ int consoleIssueHandler(Session *session)
 	char url[256];
 	char uri[160];
 
-	const char *cn = getPathParam(session, "console-name");
-	const char *ct = getHeaderParam(session, "Content-Type");
-	const char *host = getHeaderParam(session, "Host");
+	const char *cn = getPathVar(session, PATH_CONSOLE_NAME);
+	const char *ct = session->req.hdr[RQH_CONTENT_TYPE];
+	const char *host = session->req.hdr[RQH_HOST];
 	const char *scheme = getRequestScheme(session);
 	int cmdlen, cnlen, i, is_async, sol_detected = 0;
 	unsigned delivered = 0;
@@ -621,7 +631,9 @@ int consoleIssueHandler(Session *session)
 	cmd_upper[cmdlen] = '\0';
 
 	/* issue under the authenticated user's ACEE (set by the identity middleware) */
+	span = session_span_begin(session, "command");
 	issue_command(cmd_upper, (unsigned)cmdlen);
+	session_span_end(session, span);
 
 	/* unsol-key: uppercase it and snapshot the baseline match count *before*
 	 * the awaited (unsolicited) message can arrive */
@@ -653,7 +665,11 @@ int consoleIssueHandler(Session *session)
 	resp[0] = '\0';
 
 	if (!is_async) {
-		int captured = capture_response(session, cmd_upper, resp, RESP_CAP);
+		/* the polling, naps included; its snapshots are "mtt" as well */
+		int captured;
+		span = session_span_begin(session, "capture");
+		captured = capture_response(session, cmd_upper, resp, RESP_CAP);
+		session_span_end(session, span);
 		if (captured == CONS_POLL_INTERRUPTED) {
 			/* The command has already been ISSUED (issue_command/MGCR above);
 			 * only the response capture was abandoned. This is NOT a pre-issue
@@ -741,7 +757,7 @@ int consoleIssueHandler(Session *session)
 	}
 
 	/* build the response */
-	b = createJsonBuilder();
+	b = createJsonResponse(session, 0);
 	if (!b) { rc = -1; goto quit; }
 
 	if (startJsonObject(b) < 0) { rc = -1; goto quit; }
@@ -791,7 +807,7 @@ __asm__("\n&FUNC	SETC 'send_collect'");
 static int send_collect(Session *session, const char *text)
 {
 	int rc;
-	JsonBuilder *b = createJsonBuilder();
+	JsonBuilder *b = createJsonResponse(session, 0);
 	if (!b) {
 		sendDefaultHeaders(session, HTTP_STATUS_INTERNAL_SERVER_ERROR,
 		                   HTTP_CONTENT_TYPE_NONE, 0);
@@ -815,7 +831,7 @@ static int send_collect(Session *session, const char *text)
 /* ------------------------------------------------------------------ */
 int consoleCollectHandler(Session *session)
 {
-	const char *key = getPathParam(session, "cmd-response-key");
+	const char *key = getPathVar(session, PATH_CMD_RESPONSE_KEY);
 	char name[MVSMF_KVS_NAMELEN];
 	NT_STORE *store;
 	SOL_CURSOR cur;
@@ -860,7 +876,7 @@ int consoleCollectHandler(Session *session)
 /* ------------------------------------------------------------------ */
 int consoleDetectHandler(Session *session)
 {
-	const char *dkey = getPathParam(session, "detection-key");
+	const char *dkey = getPathVar(session, PATH_DETECTION_KEY);
 	char name[MVSMF_KVS_NAMELEN];
 	NT_STORE *store;
 	SOL_DETECTION det;
@@ -890,7 +906,7 @@ int consoleDetectHandler(Session *session)
 		msg[0] = '\0';
 	}
 
-	b = createJsonBuilder();
+	b = createJsonResponse(session, 0);
 	if (!b) {
 		sendDefaultHeaders(session, HTTP_STATUS_INTERNAL_SERVER_ERROR,
 		                   HTTP_CONTENT_TYPE_NONE, 0);
@@ -981,16 +997,6 @@ static void fmt_gmt_time(char *out, size_t osz, time_t secs)
 	         g.tm_year + 1900);
 }
 
-/* Query parameter lookup tolerant of the CGI env name case: try the name as
- * the client sent it (e.g. "timeRange"), then the upper-cased form, since it
- * is unclear whether httpd preserves or upper-cases the query var name. */
-__asm__("\n&FUNC	SETC 'qparam'");
-static const char *qparam(Session *s, const char *name, const char *upper)
-{
-	const char *v = getQueryParam(s, name);
-	return v ? v : getQueryParam(s, upper);
-}
-
 /* ------------------------------------------------------------------ */
 /* GET /zosmf/restconsoles/v1/log -- hardcopy log (endpoint 4)         */
 /*                                                                      */
@@ -1004,12 +1010,14 @@ static const char *qparam(Session *s, const char *name, const char *upper)
 /* ------------------------------------------------------------------ */
 int consoleLogHandler(Session *session)
 {
-	const char *qrange = qparam(session, "timeRange", "TIMERANGE");
-	const char *qtime  = qparam(session, "time", "TIME");
-	const char *qts    = qparam(session, "timestamp", "TIMESTAMP");
-	const char *qhard  = qparam(session, "hardcopy", "HARDCOPY");
-	const char *qsys   = qparam(session, "sysName", "SYSNAME");
-	const char *qdir   = qparam(session, "direction", "DIRECTION");
+	/* the request context matches names ignoring case, so whether httpd
+	   keeps "timeRange" or files it as TIMERANGE no longer matters */
+	const char *qrange = session->req.qry[RQQ_TIMERANGE];
+	const char *qtime  = session->req.qry[RQQ_TIME];
+	const char *qts    = session->req.qry[RQQ_TIMESTAMP];
+	const char *qhard  = session->req.qry[RQQ_HARDCOPY];
+	const char *qsys   = session->req.qry[RQQ_SYSNAME];
+	const char *qdir   = session->req.qry[RQQ_DIRECTION];
 
 	int range, fwd = 0, tz_min, total = 0, i, days_back, prev_hms;
 	time_t now, now_f, anchor, lo, hi;
@@ -1019,6 +1027,7 @@ int consoleLogHandler(Session *session)
 	CMTT *cmtt;
 	MTENTRY **arr;
 	unsigned n;
+	int span;
 	time_t *esecs = NULL;
 	JsonBuilder *b = NULL;
 	int rc;
@@ -1100,12 +1109,14 @@ int consoleLogHandler(Session *session)
 	{ int k = (int)strlen(sysname); while (k > 0 && sysname[k-1] == ' ') sysname[--k] = '\0'; }
 
 	/* ---- snapshot the MTT, reconstruct each entry's UNIX time ---- */
+	span = session_span_begin(session, "mtt");
 	cmtt = cmtt_new();
 	arr  = cmtt ? cmtt_get_array(cmtt) : (MTENTRY **)0;
 	n    = arr ? array_count(&arr) : 0;
+	session_span_end(session, span);
 
 	if (n) {
-		esecs = (time_t *)malloc(n * sizeof(time_t));
+		esecs = (time_t *)arena_alloc(&session->arena, n * sizeof(time_t));
 		if (!esecs) {
 			if (cmtt) cmtt_free(&cmtt);
 			return send_console_error(session, HTTP_STATUS_INTERNAL_SERVER_ERROR,
@@ -1132,9 +1143,11 @@ int consoleLogHandler(Session *session)
 	}
 
 	/* ---- build the response ---- */
-	b = createJsonBuilder();
+	/* streamed: up to 10 000 messages. The failures past this point can
+	   only be failed adds, which end the response without an error body
+	   either way */
+	b = createJsonResponse(session, JSON_STREAMED);
 	if (!b) {
-		free(esecs);
 		if (cmtt) cmtt_free(&cmtt);
 		sendDefaultHeaders(session, HTTP_STATUS_INTERNAL_SERVER_ERROR,
 		                   HTTP_CONTENT_TYPE_NONE, 0);
@@ -1193,14 +1206,12 @@ int consoleLogHandler(Session *session)
 	if (addJsonRaw(b, "nextTimestamp", numbuf) < 0) goto fail;
 	if (endJsonObject(b) < 0) goto fail;
 
-	free(esecs);
 	if (cmtt) cmtt_free(&cmtt);
 	rc = sendJSONResponse(session, HTTP_STATUS_OK, b);
 	freeJsonBuilder(b);
 	return rc;
 
 fail:
-	free(esecs);
 	if (cmtt) cmtt_free(&cmtt);
 	freeJsonBuilder(b);
 	return -1;
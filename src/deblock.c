@@ -0,0 +1,120 @@
+/*
+ * deblock.c - logical records out of physical blocks.
+ *
+ * See include/deblock.h for the block formats and why the reader wants them.
+ *
+ * Portable C on purpose: no httpd headers, no MVS services, no statics. The
+ * host test #includes it (test/host/tstdblk.c) so the deblocker it drives is
+ * the one that runs on MVS, not a copy of it.
+ */
+
+#include <string.h>
+
+#include "deblock.h"
+
+/* a descriptor word's length: big-endian halfword */
+#define DBK_LL(p)       (((size_t) (p)[0] << 8) | (p)[1])
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'deblock_init'");
+#endif
+void
+deblock_init(DEBLOCK *db, int format, size_t lrecl)
+{
+	memset(db, 0, sizeof(*db));
+	db->format = format;
+	db->lrecl = lrecl;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'deblock_block'");
+#endif
+int
+deblock_block(DEBLOCK *db, const unsigned char *blk, size_t len)
+{
+	if (db->error) {
+		return db->error;
+	}
+
+	db->blk = blk;
+	db->pos = 0;
+	db->len = 0;
+
+	if (len == 0) {
+		return 0;
+	}
+
+	switch (db->format) {
+	case DBK_F:
+		if (db->lrecl == 0 || len % db->lrecl != 0) {
+			return db->error = DBK_ELEN;
+		}
+		db->len = len;
+		break;
+
+	case DBK_V:
+		/* the BDW's length counts itself; the read may have returned more
+		   than the BDW says is in use, never less */
+		if (len < 4 || DBK_LL(blk) < 4 || DBK_LL(blk) > len) {
+			return db->error = DBK_EBDW;
+		}
+		db->len = DBK_LL(blk);
+		db->pos = 4;
+		break;
+
+	default:
+		db->len = len;
+		break;
+	}
+
+	return 0;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'deblock_next'");
+#endif
+int
+deblock_next(DEBLOCK *db, const unsigned char **rec, size_t *len)
+{
+	const unsigned char *p;
+	size_t ll;
+
+	if (db->error) {
+		return db->error;
+	}
+	if (db->pos >= db->len) {
+		return 0;
+	}
+
+	p = db->blk + db->pos;
+
+	switch (db->format) {
+	case DBK_F:
+		*rec = p;
+		*len = db->lrecl;
+		db->pos += db->lrecl;
+		return 1;
+
+	case DBK_V:
+		if (db->len - db->pos < 4) {
+			return db->error = DBK_ERDW;
+		}
+		ll = DBK_LL(p);
+		if (ll < 4 || ll > db->len - db->pos) {
+			return db->error = DBK_ERDW;
+		}
+		if (p[2] != 0) {
+			return db->error = DBK_ESPAN;
+		}
+		*rec = p + 4;
+		*len = ll - 4;
+		db->pos += ll;
+		return 1;
+
+	default:
+		*rec = p;
+		*len = db->len;
+		db->pos = db->len;
+		return 1;
+	}
+}
@@ -0,0 +1,465 @@
+/*
+ * deflate.c - a response body, gzipped as it is sent.
+ *
+ * See include/deflate.h for what the encoder trades away and why. The
+ * matching is zlib's deflate_fast() in miniature: a hash of the next three
+ * bytes heads a chain of earlier positions, the longest match among the
+ * first `chain` of them is taken, and long matches are not hashed into.
+ *
+ * Portable C on purpose: no httpd headers, no MVS services, no statics. The
+ * host test #includes it (test/host/tstdefl.c) so the encoder it drives is
+ * the one that runs on MVS, not a copy of it.
+ */
+
+#include <string.h>
+
+#include "deflate.h"
+
+#define MIN_MATCH       3
+#define MAX_MATCH       258
+#define LOOKAHEAD       (MAX_MATCH + MIN_MATCH + 1)     /* kept for a search */
+#define INSERT_MAX      32      /* a longer match is not hashed into */
+#define STORED_MAX      65535   /* bytes in one stored block */
+#define END_BLOCK       256
+
+static const short defl_lbase[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const unsigned char defl_lext[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const unsigned short defl_dbase[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+	8193, 12289, 16385, 24577
+};
+static const unsigned char defl_dext[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+/* A distance's symbol: dsym[dist - 1] up to 256, dsym[256 + ((dist - 1)
+   >> 7)] above, where every code spans a multiple of 128 distances. */
+#define DSYM(d, dist) ((dist) <= 256 ? (d)->dsym[(dist) - 1] \
+                                     : (d)->dsym[256 + (((dist) - 1) >> 7)])
+
+/* The fixed literal/length code of `sym`: 8, 9, 7 or 8 bits, RFC 1951
+   3.2.6 */
+#define LBITS(sym)    ((sym) < 144 ? 8 : (sym) < 256 ? 9 : (sym) < 280 ? 7 : 8)
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'defl_reverse'");
+#endif
+static unsigned
+defl_reverse(unsigned code, int n)
+{
+	unsigned rev = 0;
+
+	while (n-- > 0) {
+		rev = (rev << 1) | (code & 1);
+		code >>= 1;
+	}
+	return rev;
+}
+
+/* Hand the staged bytes to the sink */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'defl_flush'");
+#endif
+static int
+defl_flush(DEFLATE *d, DEFL_SINK sink, void *ctx)
+{
+	unsigned n = d->olen;
+
+	if (d->err) {
+		return -1;
+	}
+	if (n == 0) {
+		return 0;
+	}
+	d->olen = 0;
+	d->total_out += n;
+	if (sink(ctx, d->out, n) < 0) {
+		d->err = 1;
+		return -1;
+	}
+	return 0;
+}
+
+/* `n` bits of `v`, least significant first; whole bytes go to the staging
+   buffer. n + 7 fits the accumulator: n is at most 16. */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'defl_bits'");
+#endif
+static int
+defl_bits(DEFLATE *d, unsigned long v, unsigned n, DEFL_SINK sink, void *ctx)
+{
+	d->bits |= v << d->nbits;
+	d->nbits += n;
+	while (d->nbits >= 8) {
+		d->out[d->olen++] = (unsigned char) (d->bits & 0xFF);
+		d->bits >>= 8;
+		d->nbits -= 8;
+		if (d->olen == DEFL_OUTSIZE && defl_flush(d, sink, ctx) < 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'defl_align'");
+#endif
+static int
+defl_align(DEFLATE *d, DEFL_SINK sink, void *ctx)
+{
+	return d->nbits ? defl_bits(d, 0, 8 - d->nbits, sink, ctx) : 0;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'defl_le32'");
+#endif
+static int
+defl_le32(DEFLATE *d, unsigned long v, DEFL_SINK sink, void *ctx)
+{
+	if (defl_bits(d, v & 0xFFFF, 16, sink, ctx) < 0) {
+		return -1;
+	}
+	return defl_bits(d, (v >> 16) & 0xFFFF, 16, sink, ctx);
+}
+
+/* The gzip header, no name and no time, then a fixed block opens */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'defl_start'");
+#endif
+static int
+defl_start(DEFLATE *d, DEFL_SINK sink, void *ctx)
+{
+	static const unsigned char hdr[10] = {
+		0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 255    /* OS: unknown */
+	};
+
+	d->started = 1;
+	memcpy(d->out, hdr, sizeof(hdr));
+	d->olen = sizeof(hdr);
+	return defl_bits(d, 1 << 1, 3, sink, ctx);     /* not last, fixed */
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'defl_literal'");
+#endif
+static int
+defl_literal(DEFLATE *d, int sym, DEFL_SINK sink, void *ctx)
+{
+	return defl_bits(d, d->lcode[sym], LBITS(sym), sink, ctx);
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'defl_match'");
+#endif
+static int
+defl_match(DEFLATE *d, unsigned len, unsigned dist, DEFL_SINK sink, void *ctx)
+{
+	int ls = d->lsym[len - MIN_MATCH];
+	int ds = DSYM(d, dist);
+
+	if (defl_literal(d, 257 + ls, sink, ctx) < 0
+	    || defl_bits(d, len - defl_lbase[ls], defl_lext[ls], sink, ctx) < 0
+	    || defl_bits(d, defl_reverse((unsigned) ds, 5), 5, sink, ctx) < 0) {
+		return -1;
+	}
+	return defl_bits(d, dist - defl_dbase[ds], defl_dext[ds], sink, ctx);
+}
+
+/* Make room for a history's worth of input: the upper half of the window
+   moves down, and so does every position the chains hold */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'defl_slide'");
+#endif
+static void
+defl_slide(DEFLATE *d)
+{
+	unsigned i;
+
+	memcpy(d->window, d->window + DEFL_WSIZE, DEFL_WSIZE);
+	d->strstart -= DEFL_WSIZE;
+	for (i = 0; i < DEFL_HSIZE; i++) {
+		d->head[i] = (unsigned short)
+		    (d->head[i] >= DEFL_WSIZE ? d->head[i] - DEFL_WSIZE : 0);
+	}
+	for (i = 0; i < DEFL_WSIZE; i++) {
+		d->prev[i] = (unsigned short)
+		    (d->prev[i] >= DEFL_WSIZE ? d->prev[i] - DEFL_WSIZE : 0);
+	}
+}
+
+/* Put position `p` at the head of its chain; answer the old head */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'defl_insert'");
+#endif
+static unsigned
+defl_insert(DEFLATE *d, unsigned p)
+{
+	const unsigned char *w = d->window + p;
+	unsigned h;
+	unsigned old;
+
+	h = (((unsigned) w[0] << 16 | (unsigned) w[1] << 8 | w[2])
+	    * 2654435761U) >> (32 - DEFL_HBITS) & (DEFL_HSIZE - 1);
+	old = d->head[h];
+	d->prev[p & (DEFL_WSIZE - 1)] = (unsigned short) old;
+	d->head[h] = (unsigned short) p;
+	return old;
+}
+
+/* Encode the window while a full search's worth is ahead, or to its end
+   with `flush` */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'defl_compress'");
+#endif
+static int
+defl_compress(DEFLATE *d, int flush, DEFL_SINK sink, void *ctx)
+{
+	const unsigned char *w = d->window;
+	unsigned s;
+	unsigned avail;
+	unsigned cand;
+	unsigned limit;
+	unsigned maxlen;
+	unsigned best;
+	unsigned dist = 0;
+	unsigned n;
+	unsigned p;
+	int chain;
+
+	while (d->lookahead >= (flush ? 1U : (unsigned) LOOKAHEAD)) {
+		s = d->strstart;
+		avail = d->lookahead;
+		best = MIN_MATCH - 1;
+
+		if (avail >= MIN_MATCH) {
+			cand = defl_insert(d, s);
+			maxlen = avail < MAX_MATCH ? avail : MAX_MATCH;
+			limit = s > DEFL_WSIZE ? s - DEFL_WSIZE : 0;
+			/* position 0 is no candidate: 0 is what an empty chain holds */
+			for (chain = d->chain; cand > limit && chain > 0; chain--) {
+				if (w[cand + best] == w[s + best] && w[cand] == w[s]
+				    && w[cand + 1] == w[s + 1]) {
+					for (n = 2; n < maxlen && w[cand + n] == w[s + n]; n++)
+						;
+					if (n > best) {
+						best = n;
+						dist = s - cand;
+						if (n == maxlen) {
+							break;
+						}
+					}
+				}
+				cand = d->prev[cand & (DEFL_WSIZE - 1)];
+			}
+		}
+
+		if (best >= MIN_MATCH) {
+			if (defl_match(d, best, dist, sink, ctx) < 0) {
+				return -1;
+			}
+			if (best <= INSERT_MAX) {
+				for (p = s + 1; p < s + best && p + MIN_MATCH <= s + avail;
+				    p++) {
+					(void) defl_insert(d, p);
+				}
+			}
+			d->strstart += best;
+			d->lookahead -= best;
+		} else {
+			if (defl_literal(d, w[s], sink, ctx) < 0) {
+				return -1;
+			}
+			d->strstart++;
+			d->lookahead--;
+		}
+	}
+	return 0;
+}
+
+/* The rest of the body as stored blocks: it did not compress */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'defl_stored'");
+#endif
+static int
+defl_stored(DEFLATE *d, const unsigned char *p, size_t len, DEFL_SINK sink,
+    void *ctx)
+{
+	size_t n;
+	size_t k;
+
+	while (len > 0) {
+		n = len < STORED_MAX ? len : STORED_MAX;
+		if (defl_bits(d, 0, 3, sink, ctx) < 0       /* not last, stored */
+		    || defl_align(d, sink, ctx) < 0
+		    || defl_bits(d, n, 16, sink, ctx) < 0
+		    || defl_bits(d, ~n & 0xFFFF, 16, sink, ctx) < 0) {
+			return -1;
+		}
+		len -= n;
+		while (n > 0) {
+			k = DEFL_OUTSIZE - d->olen;
+			if (k > n) {
+				k = n;
+			}
+			memcpy(d->out + d->olen, p, k);
+			d->olen += k;
+			p += k;
+			n -= k;
+			if (d->olen == DEFL_OUTSIZE && defl_flush(d, sink, ctx) < 0) {
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+/* Judge the ratio once enough is in. Giving up ends the fixed block: what
+   is in the window goes out as it would have, then the end-of-block code. */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'defl_probe'");
+#endif
+static int
+defl_probe(DEFLATE *d, DEFL_SINK sink, void *ctx)
+{
+	size_t in = d->total_in - d->lookahead;
+	size_t out = d->total_out + d->olen;
+
+	if (in < DEFL_PROBE) {
+		return 0;
+	}
+	d->probed = 1;
+	if (out * 8 <= in * 7) {
+		return 0;
+	}
+	if (defl_compress(d, 1, sink, ctx) < 0
+	    || defl_literal(d, END_BLOCK, sink, ctx) < 0) {
+		return -1;
+	}
+	d->stored = 1;
+	return 0;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'defl_init'");
+#endif
+void
+defl_init(DEFLATE *d, int chain)
+{
+	int sym;
+	int i;
+	unsigned n;
+
+	memset(d, 0, offsetof(DEFLATE, lcode));
+	d->chain = chain < 1 ? 1 : chain > DEFL_CHAIN_MAX ? DEFL_CHAIN_MAX : chain;
+	etag_init(&d->crc);
+
+	for (sym = 0; sym < 288; sym++) {
+		n = sym < 144 ? 0x30 + sym : sym < 256 ? 0x190 + (sym - 144)
+		    : sym < 280 ? sym - 256 : 0xC0 + (sym - 280);
+		d->lcode[sym] = (unsigned short) defl_reverse(n, LBITS(sym));
+	}
+	for (i = 0; i < 29; i++) {
+		for (n = defl_lbase[i]; n < defl_lbase[i] + (1U << defl_lext[i])
+		    && n <= MAX_MATCH; n++) {
+			d->lsym[n - MIN_MATCH] = (unsigned char) i;
+		}
+	}
+	for (i = 0; i < 30; i++) {
+		for (n = defl_dbase[i]; n < defl_dbase[i] + (1U << defl_dext[i]);
+		    n++) {
+			if (n <= 256) {
+				d->dsym[n - 1] = (unsigned char) i;
+			} else {
+				d->dsym[256 + ((n - 1) >> 7)] = (unsigned char) i;
+			}
+		}
+	}
+	memset(d->head, 0, sizeof(d->head));
+	memset(d->prev, 0, sizeof(d->prev));
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'defl_feed'");
+#endif
+int
+defl_feed(DEFLATE *d, const void *buf, size_t len, DEFL_SINK sink, void *ctx)
+{
+	const unsigned char *p = (const unsigned char *) buf;
+	size_t room;
+
+	if (d->err) {
+		return -1;
+	}
+	if (!d->started && defl_start(d, sink, ctx) < 0) {
+		return -1;
+	}
+	etag_update_raw(&d->crc, p, len);
+	d->total_in += len;
+	if (d->stored) {
+		return defl_stored(d, p, len, sink, ctx);
+	}
+
+	while (len > 0) {
+		room = 2 * DEFL_WSIZE - (d->strstart + d->lookahead);
+		if (room == 0) {
+			defl_slide(d);
+			room = DEFL_WSIZE;
+		}
+		if (room > len) {
+			room = len;
+		}
+		memcpy(d->window + d->strstart + d->lookahead, p, room);
+		d->lookahead += (unsigned) room;
+		p += room;
+		len -= room;
+		if (defl_compress(d, 0, sink, ctx) < 0) {
+			return -1;
+		}
+		if (!d->probed && defl_probe(d, sink, ctx) < 0) {
+			return -1;
+		}
+		if (d->stored) {
+			return defl_stored(d, p, len, sink, ctx);
+		}
+	}
+	return 0;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'defl_end'");
+#endif
+int
+defl_end(DEFLATE *d, DEFL_SINK sink, void *ctx)
+{
+	if (d->err) {
+		return -1;
+	}
+	if (!d->started && defl_start(d, sink, ctx) < 0) {
+		return -1;
+	}
+	if (!d->stored) {
+		if (defl_compress(d, 1, sink, ctx) < 0
+		    || defl_literal(d, END_BLOCK, sink, ctx) < 0) {
+			return -1;
+		}
+	}
+	/* an empty last block, then the trailer on a byte boundary */
+	if (defl_bits(d, 1 | 1 << 1, 3, sink, ctx) < 0
+	    || defl_literal(d, END_BLOCK, sink, ctx) < 0
+	    || defl_align(d, sink, ctx) < 0
+	    || defl_le32(d, ~(unsigned long) d->crc.crc & 0xFFFFFFFFUL, sink,
+	    ctx) < 0
+	    || defl_le32(d, (unsigned long) d->total_in & 0xFFFFFFFFUL, sink,
+	    ctx) < 0) {
+		return -1;
+	}
+	return defl_flush(d, sink, ctx);
+}
@@ -0,0 +1,432 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <clibdscb.h>
+#include <clibthrd.h>
+#include <clibtry.h>
+#include <clibwto.h>
+
+#include "common.h"
+#include "dsread.h"
+#include "mvsmfmsg.h"
+#include "router.h"
+
+/* The largest block a DCB can describe: what a block read is sized for when
+   the DSCB gives no BLKSIZE. */
+#define DSREAD_BLKMAX   32760
+
+#define DSN_LEN         44
+
+/* A read-ahead wait, in .01s for cthread_timed_wait(): each side looks
+   again this often even without a post, and the worker checks
+   session_aborted() as often. The same 100 ms as SEND_STALL_PAUSE. */
+#define DSREAD_PAUSE    10
+
+/* How many DSREAD_PAUSEs dsread_stop() gives a reader to end: 5 s. The
+   reader is told to stop and posted, so all it has left is the one block
+   read it may be in, which takes milliseconds. */
+#define DSREAD_JOIN     50
+
+/* the post bit of an ECB */
+#define ECB_POSTED      0x40000000u
+
+/* The DSCB1 of the data set `name` is in -- a member's is its PDS's -- and
+   the volume it is on. */
+__asm__("\n&FUNC    SETC 'dsread_dscb1'");
+static int
+dsread_dscb1(const char *name, DSCB *dscb1, char *volser)
+{
+	LOCWORK locwork;
+	char dsn44[DSN_LEN];
+	size_t len = strcspn(name, "(");
+
+	if (len > DSN_LEN) {
+		len = DSN_LEN;
+	}
+	memset(dsn44, ' ', sizeof(dsn44));
+	memcpy(dsn44, name, len);
+
+	memset(&locwork, 0, sizeof(locwork));
+	if (__locate(dsn44, &locwork) != 0) {
+		return -1;
+	}
+	memcpy(volser, locwork.volser, 6);
+
+	memset(dscb1, 0, sizeof(*dscb1));
+	if (__dscbdv(dsn44, volser, dscb1) != 0) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Total record count of an FB data set from its DSCB1 and the volume's
+   DSCB4 -- the last block written (DS1LSTAR) times the records in a block.
+   Only the record fallback needs it: it is where fread() has to stop before
+   the residue of the last block. -1 for anything it cannot count. */
+__asm__("\n&FUNC    SETC 'dsread_fb_count'");
+static long
+dsread_fb_count(const DSCB *dscb1, const char *volser)
+{
+	DSCB dscb4;
+	unsigned short blksz, lrecl;
+	unsigned overhead, bpt;
+	unsigned tt, r;
+
+	/* Must be FB (fixed, non-keyed) */
+	if ((dscb1->dscb1.recfm & RECFF) == 0) return -1;
+	if (dscb1->dscb1.keyl != 0) return -1;
+
+	blksz = dscb1->dscb1.blksz;
+	lrecl = dscb1->dscb1.lrecl;
+	if (blksz == 0 || lrecl == 0) return -1;
+
+	memset(&dscb4, 0, sizeof(dscb4));
+	if (__dscbv(volser, &dscb4) != 0) return -1;
+
+	/* blocks_per_track = floor((devtk - overhead) / (overhead + blksz))
+	   where overhead = devov - devk for non-keyed records */
+	overhead = dscb4.dscb4.devov - dscb4.dscb4.devk;
+	if (overhead + blksz == 0) return -1;
+	bpt = (dscb4.dscb4.devtk - overhead) / (overhead + blksz);
+	if (bpt == 0) return -1;
+
+	/* DS1LSTAR: TT = relative track (0-based), R = block on track (1-based) */
+	tt = ((unsigned)dscb1->dscb1.lstar[0] << 8) | dscb1->dscb1.lstar[1];
+	r  = dscb1->dscb1.lstar[2];
+
+	return ((long)tt * bpt + r) * (blksz / lrecl);
+}
+
+/* The record fallback: the open every handler did before, and what it
+   needed to know to stop. */
+__asm__("\n&FUNC    SETC 'dsread_records'");
+static int
+dsread_records(Session *session, DSREAD *r, const char *name,
+	const DSCB *dscb1, const char *volser)
+{
+	int is_undefined;
+	size_t eff_lrecl;
+
+	r->fp = fopen(name, r->text ? "r" : "rb");
+	if (!r->fp) {
+		return -1;
+	}
+	session_register_file(session, r->fp);
+
+	is_undefined = ((r->fp->recfm & _FILE_RECFM_TYPE) == _FILE_RECFM_U);
+	eff_lrecl = is_undefined ? (size_t) r->fp->blksize : (size_t) r->fp->lrecl;
+	r->format = is_undefined ? DBK_U
+		: (r->fp->recfm & _FILE_RECFM_TYPE) == _FILE_RECFM_V ? DBK_V : DBK_F;
+
+	/* a line is the record, its '\n' and fgets()'s NUL */
+	r->size = eff_lrecl + 2;
+	r->block = arena_alloc(&session->arena, r->size);
+	if (!r->block) {
+		return -2;
+	}
+
+	/* Members have a real EOF; so does text, which reads through the
+	   access method's end of data rather than the block's bytes. */
+	if (!r->text && dscb1 && !strchr(name, '(')) {
+		int span = session_span_begin(session, "count");
+
+		r->left = dsread_fb_count(dscb1, volser);
+		session_span_end(session, span);
+	}
+
+	return 0;
+}
+
+__asm__("\n&FUNC    SETC 'dsread_open'");
+int
+dsread_open(Session *session, DSREAD *r, const char *name, int text)
+{
+	DSCB dscb1;
+	char volser[6];
+	unsigned char recfm;
+	size_t size;
+
+	memset(r, 0, sizeof(*r));
+	r->name = name;
+	r->left = -1;
+	r->text = text;
+
+	if (dsread_dscb1(name, &dscb1, volser) != 0) {
+		/* not in the catalog, or no DSCB: the plain open gives the caller
+		   its usual failure to diagnose */
+		return dsread_records(session, r, name, NULL, NULL);
+	}
+
+	recfm = dscb1.dscb1.recfm;
+	switch (recfm & 0xC0) {
+	case RECFU: r->format = DBK_U; break;
+	case RECFV: r->format = DBK_V; break;
+	default:    r->format = DBK_F; break;
+	}
+	if (r->format == DBK_V && (recfm & RECFS)) {
+		/* a spanned record is one the deblocker would have to copy
+		   together; the access method already does */
+		return dsread_records(session, r, name, &dscb1, volser);
+	}
+	if (r->format == DBK_F && dscb1.dscb1.lrecl == 0) {
+		return dsread_records(session, r, name, &dscb1, volser);
+	}
+
+	/* RECFM=U on the open is the old way to read blocks through a record
+	   interface: every READ is one physical block, and "record" has fread()
+	   return it with the length actually read. The data set's own format
+	   comes from the DSCB above, not from the DCB, which now says U. */
+	r->fp = fopen(name, "rb,record,recfm=u");
+	if (!r->fp) {
+		return -1;
+	}
+	if ((r->fp->recfm & _FILE_RECFM_TYPE) != _FILE_RECFM_U) {
+		/* the override did not take: this is a record stream */
+		fclose(r->fp);
+		r->fp = NULL;
+		return dsread_records(session, r, name, &dscb1, volser);
+	}
+	session_register_file(session, r->fp);
+
+	size = dscb1.dscb1.blksz ? dscb1.dscb1.blksz : DSREAD_BLKMAX;
+	r->block = arena_alloc(&session->arena, size);
+	if (!r->block) {
+		return -2;
+	}
+	r->size = size;
+	r->blocked = 1;
+	deblock_init(&r->db, r->format, dscb1.dscb1.lrecl);
+
+	return 0;
+}
+
+/* The read-ahead subtask's loop: fill whichever buffer the worker has given
+   back, post, and go on until the end of the data or until told to stop. A
+   read that fails ends the data, as fread() returning 0 always has in line. */
+__asm__("\n&FUNC    SETC 'dsread_fill'");
+static int
+dsread_fill(DSAHEAD *a)
+{
+	unsigned char *buf;
+	size_t n;
+	int rc;
+
+	for (;;) {
+		/* zeroed before the look, so a post after it is not lost */
+		a->ecb_free = 0;
+		rc = rdahead_slot(&a->ra, &buf);
+		if (rc == RDA_WAIT) {
+			(void) cthread_timed_wait((void *) &a->ecb_free, DSREAD_PAUSE, 0);
+			continue;
+		}
+		if (rc == 0) {
+			break;
+		}
+		n = fread(buf, 1, a->ra.size, a->fp);
+		rdahead_filled(&a->ra, (long) n);
+		cthread_post((void *) &a->ecb_full, 0);
+		if (n == 0) {
+			break;
+		}
+	}
+	return 0;
+}
+
+/* The read-ahead subtask: the loop under try(), so that an abend in a read
+   still ends in ecb_done. A reader that ended without giving the end of the
+   data is a failed read to the worker (dsread_take()). */
+__asm__("\n&FUNC    SETC 'dsread_reader'");
+static int
+dsread_reader(void *arg1, void *arg2)
+{
+	DSAHEAD *a = arg1;
+	unsigned abend;
+
+	(void) arg2;
+
+	if (try(dsread_fill, a) != 0) {
+		abend = tryrc();
+		wtof(MSG_DS_SUBTASK_ABEND, "READ-AHEAD", a->name,
+			(abend >> 12) & 0xFFF, abend & 0xFFF);
+	}
+
+	cthread_post((void *) &a->ecb_done, 0);
+	return 0;
+}
+
+__asm__("\n&FUNC    SETC 'dsread_ahead'");
+int
+dsread_ahead(Session *session, DSREAD *r)
+{
+	const char *v = getenv("MVSMF_READAHEAD");
+	unsigned char *second;
+	DSAHEAD *a;
+
+	if (!r->blocked || !v || atoi(v) <= 0) {
+		return -1;
+	}
+
+	second = arena_alloc(&session->arena, r->size);
+	a = arena_alloc(&session->arena, sizeof(DSAHEAD));
+	if (!second || !a) {
+		return -1;
+	}
+	memset(a, 0, sizeof(*a));
+	rdahead_init(&a->ra, r->block, second, r->size);
+	a->fp = r->fp;
+	strncpy(a->name, r->name, sizeof(a->name) - 1);
+
+	a->task = cthread_create(dsread_reader, a, NULL);
+	if (!a->task) {
+		return -1;
+	}
+	r->session = session;
+	r->ahead = a;
+	session->rd = a;
+	return 0;
+}
+
+/* The next block from the read-ahead: the one before it goes back to the
+   reader first. Bytes in *blk, 0 at the end, -1 when the worker stopped
+   waiting. */
+__asm__("\n&FUNC    SETC 'dsread_take'");
+static long
+dsread_take(DSREAD *r, const unsigned char **blk)
+{
+	DSAHEAD *a = r->ahead;
+	size_t n;
+	int done;
+	int rc;
+
+	if (rdahead_release(&a->ra)) {
+		cthread_post((void *) &a->ecb_free, 0);
+	}
+
+	for (;;) {
+		/* looked at before the take: a reader that had ended by then has
+		   given everything it will, so a wait after it is for nothing */
+		done = (a->ecb_done & ECB_POSTED) != 0;
+		a->ecb_full = 0;
+		rc = rdahead_take(&a->ra, blk, &n);
+		if (rc != RDA_WAIT) {
+			break;
+		}
+		if (done || session_aborted(r->session)) {
+			return -1;
+		}
+		(void) cthread_timed_wait((void *) &a->ecb_full, DSREAD_PAUSE, 0);
+	}
+
+	return rc == 1 ? (long) n : rc;
+}
+
+__asm__("\n&FUNC    SETC 'dsread_next'");
+int
+dsread_next(DSREAD *r, const unsigned char **rec, size_t *len)
+{
+	const unsigned char *blk;
+	long got;
+	size_t n;
+	int rc;
+
+	if (r->blocked) {
+		while ((rc = deblock_next(&r->db, rec, len)) == 0) {
+			if (r->ahead) {
+				got = dsread_take(r, &blk);
+			} else {
+				blk = r->block;
+				got = (long) fread(r->block, 1, r->size, r->fp);
+			}
+			if (got <= 0) {
+				return got < 0 ? -1 : 0;
+			}
+			deblock_block(&r->db, blk, (size_t) got);
+		}
+		if (rc < 0) {
+			wtof(MSG_DS_DEBLOCK, r->name, rc);
+			return -1;
+		}
+		return 1;
+	}
+
+	if (r->left == 0) {
+		return 0;
+	}
+
+	if (r->text) {
+		char *line = (char *) r->block;
+
+		/* A whole F record leaves its '\n' at line[size - 2]; clearing it
+		   first means a shorter line cannot leave the last one's there,
+		   and the common case needs no strlen(). */
+		line[r->size - 2] = 0;
+		if (fgets(line, (int) r->size, r->fp) <= 0) {
+			return 0;
+		}
+		if (r->format == DBK_F && line[r->size - 2] == '\n') {
+			n = r->size - 2;
+		} else {
+			n = strlen(line);
+			if (n > 0 && line[n - 1] == '\n') {
+				n--;
+			}
+		}
+	} else {
+		n = fread(r->block, 1, r->size - 2, r->fp);
+		if (n == 0) {
+			return 0;
+		}
+	}
+
+	if (r->left > 0) {
+		r->left--;
+	}
+	*rec = r->block;
+	*len = n;
+	return 1;
+}
+
+__asm__("\n&FUNC    SETC 'dsread_stop'");
+void
+dsread_stop(Session *session, DSAHEAD *a)
+{
+	int turns = 0;
+
+	if (!a || !a->task) {
+		return;
+	}
+
+	/* the reader may be in a read, or waiting for a buffer: it has to be
+	   out of both before the DCB it reads is closed */
+	rdahead_stop(&a->ra);
+	cthread_post((void *) &a->ecb_free, 0);
+	while (!(a->ecb_done & ECB_POSTED)) {
+		(void) cthread_timed_wait((void *) &a->ecb_done, DSREAD_PAUSE, 0);
+		if (a->ecb_done & ECB_POSTED) {
+			break;
+		}
+		if (++turns == DSREAD_JOIN || session_aborted(session)) {
+			wtof(MSG_DS_SUBTASK_DETACH, "READ-AHEAD", a->name);
+			break;
+		}
+	}
+	cthread_delete(&a->task);
+	if (session->rd == a) {
+		session->rd = NULL;
+	}
+}
+
+__asm__("\n&FUNC    SETC 'dsread_close'");
+void
+dsread_close(Session *session, DSREAD *r)
+{
+	if (r->ahead) {
+		dsread_stop(session, r->ahead);
+		r->ahead = NULL;
+	}
+	if (r->fp) {
+		session_fclose(session, r->fp);
+		r->fp = NULL;
+	}
+}
@@ -0,0 +1,309 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <clibthrd.h>
+#include <clibtry.h>
+#include <clibwto.h>
+
+#include "common.h"
+#include "dswrite.h"
+#include "mvsmfmsg.h"
+#include "router.h"
+
+/* Slots in the ring, each the largest block there is: the worker's buffer
+   is one block, so this is how many blocks it can be ahead of the disk. */
+#define DSWRITE_SLOTS   3
+#define DSWRITE_SLOTSZ  32760
+
+/* A write-behind wait, in .01s for cthread_timed_wait(): each side looks
+   again this often even without a post, and the worker checks
+   session_aborted() as often. */
+#define DSWRITE_PAUSE   10
+
+/* How many DSWRITE_PAUSEs the worker gives the writer for any one step --
+   the open, a free slot, the end -- before it stops waiting: 30 s. The open
+   allocates, and a write may have to take a secondary extent first, so this
+   is longer than a read-ahead's. */
+#define DSWRITE_JOIN    300
+
+/* the post bit of an ECB */
+#define ECB_POSTED      0x40000000u
+
+/* The writer subtask's work: open, write the slots in order, close. A
+   failed write stops the writing; the slots after it are freed unwritten.
+   The worker's stop ends it where it is. */
+__asm__("\n&FUNC    SETC 'dswrite_work'");
+static int
+dswrite_work(DSWRITE *w)
+{
+	const unsigned char *buf;
+	size_t len;
+	int flush;
+	int failed = 0;
+	int rc;
+
+	w->fp = fopen(w->name, w->mode);
+	w->open_errno = errno;
+	w->opened = w->fp ? 1 : -1;
+	cthread_post((void *) &w->ecb_ready, 0);
+	if (!w->fp) {
+		return 0;
+	}
+
+	while (!w->stop) {
+		/* zeroed before the look, so a post after it is not lost */
+		w->ecb_work = 0;
+		rc = wbring_take(w->wb, &buf, &len, &flush);
+		if (rc == WBR_WAIT) {
+			(void) cthread_timed_wait((void *) &w->ecb_work,
+				DSWRITE_PAUSE, 0);
+			continue;
+		}
+		if (rc == 0) {
+			break;
+		}
+		if (!failed) {
+			if (fwrite(buf, 1, len, w->fp) != len) {
+				failed = 1;
+			} else if (flush) {
+				fflush(w->fp);
+			}
+		}
+		wbring_done(w->wb, failed ? -1 : 0);
+		cthread_post((void *) &w->ecb_ready, 0);
+	}
+	fclose(w->fp);
+	return 0;
+}
+
+/* The writer subtask: its work under try(). An abend in the open is a
+   failed open, and one after it a failed write, which the worker's next
+   put or its close returns. A DCB the abend left open is closed by the
+   system as the subtask ends, and its enqueue released with it. */
+__asm__("\n&FUNC    SETC 'dswrite_writer'");
+static int
+dswrite_writer(void *arg1, void *arg2)
+{
+	DSWRITE *w = arg1;
+	unsigned abend;
+
+	(void) arg2;
+
+	if (try(dswrite_work, w) != 0) {
+		abend = tryrc();
+		wtof(MSG_DS_SUBTASK_ABEND, "WRITE-BEHIND", w->name,
+			(abend >> 12) & 0xFFF, abend & 0xFFF);
+		if (w->opened == 0) {
+			w->open_errno = 0;
+			w->opened = -1;
+		} else {
+			w->wb->failed = 1;
+		}
+		cthread_post((void *) &w->ecb_ready, 0);
+	}
+
+	cthread_post((void *) &w->ecb_done, 0);
+	return 0;
+}
+
+/* One wait of the worker's on *ecb. 0 to look again; -1 when the step has
+   had its DSWRITE_JOIN turns, counted in *turns, or the session is done. */
+__asm__("\n&FUNC    SETC 'dswrite_wait'");
+static int
+dswrite_wait(DSWRITE *w, unsigned *ecb, int *turns)
+{
+	(void) cthread_timed_wait((void *) ecb, DSWRITE_PAUSE, 0);
+	if (++*turns >= DSWRITE_JOIN || session_aborted(w->session)) {
+		return -1;
+	}
+	return 0;
+}
+
+/* Wait for the writer to end, and let it go. 0 when it ended; -1 when the
+   wait gave up and the writer was detached where it was, with what it had
+   not written yet. */
+__asm__("\n&FUNC    SETC 'dswrite_join'");
+static int
+dswrite_join(DSWRITE *w)
+{
+	int turns = 0;
+	int rc = 0;
+
+	while (!(w->ecb_done & ECB_POSTED)) {
+		if (dswrite_wait(w, &w->ecb_done, &turns) < 0
+		    && !(w->ecb_done & ECB_POSTED)) {
+			wtof(MSG_DS_SUBTASK_DETACH, "WRITE-BEHIND", w->name);
+			rc = -1;
+			break;
+		}
+	}
+	cthread_delete(&w->task);
+	return rc;
+}
+
+/* Write-behind, when the environment asks for it and there is storage and
+   a subtask for it. 1 when the writer's open is done (w->opened says how),
+   0 when the open is to be made in line after all. */
+__asm__("\n&FUNC    SETC 'dswrite_behind'");
+static int
+dswrite_behind(Session *session, DSWRITE *w, const char *name)
+{
+	const char *v = getenv("MVSMF_WRITEBEHIND");
+	unsigned char *bufs[DSWRITE_SLOTS];
+	int turns = 0;
+	int i;
+
+	if (!v || atoi(v) <= 0 || strlen(name) >= sizeof(w->name)) {
+		return 0;
+	}
+	strcpy(w->name, name);
+	w->session = session;
+
+	w->wb = arena_alloc(&session->arena, sizeof(WBRING));
+	for (i = 0; i < DSWRITE_SLOTS; i++) {
+		bufs[i] = w->wb ? arena_alloc(&session->arena, DSWRITE_SLOTSZ) : NULL;
+		if (!bufs[i]) {
+			w->wb = NULL;
+			return 0;
+		}
+	}
+	wbring_init(w->wb, bufs, DSWRITE_SLOTS, DSWRITE_SLOTSZ);
+
+	w->task = cthread_create(dswrite_writer, w, NULL);
+	if (!w->task) {
+		w->wb = NULL;
+		return 0;
+	}
+
+	while (!w->opened) {
+		w->ecb_ready = 0;
+		if (w->opened) {
+			break;
+		}
+		if (dswrite_wait(w, &w->ecb_ready, &turns) < 0) {
+			break;
+		}
+	}
+	if (w->opened != 1) {
+		/* failed, or not done in time: an open that succeeds after this
+		   is closed again by the stop, and reported failed all the same */
+		w->stop = 1;
+		cthread_post((void *) &w->ecb_work, 0);
+		(void) dswrite_join(w);
+		w->opened = -1;
+		w->wb = NULL;
+	}
+	return 1;
+}
+
+__asm__("\n&FUNC    SETC 'dswrite_open'");
+int
+dswrite_open(Session *session, DSWRITE *w, const char *name, const char *mode)
+{
+	memset(w, 0, sizeof(*w));
+	w->mode = mode;
+
+	if (dswrite_behind(session, w, name)) {
+		if (w->opened < 0) {
+			w->fp = NULL;
+			wtof(MSG_DS_OPEN_WRITE, name, w->open_errno);
+			return -1;
+		}
+		return 0;
+	}
+
+	w->fp = fopen(name, mode);
+	if (!w->fp) {
+		wtof(MSG_DS_OPEN_WRITE, name, errno);
+		return -1;
+	}
+	session_register_file(session, w->fp);
+	return 0;
+}
+
+__asm__("\n&FUNC    SETC 'dswrite_put'");
+int
+dswrite_put(DSWRITE *w, const void *data, size_t len, int flush)
+{
+	const unsigned char *p = data;
+	size_t n;
+	int turns;
+	int rc;
+
+	if (!w->wb) {
+		if (fwrite(data, 1, len, w->fp) != len) {
+			return -1;
+		}
+		if (flush) {
+			fflush(w->fp);
+		}
+		return 0;
+	}
+
+	if (w->stop) {
+		return -1;
+	}
+
+	/* a record over the slot size goes in pieces, the flush after the
+	   last -- the same bytes fwrite() would have had in one call */
+	do {
+		n = len > w->wb->size ? w->wb->size : len;
+		turns = 0;
+		for (;;) {
+			w->ecb_ready = 0;
+			rc = wbring_put(w->wb, p, n, flush && n == len);
+			if (rc != WBR_WAIT) {
+				break;
+			}
+			if (dswrite_wait(w, &w->ecb_ready, &turns) < 0) {
+				/* the writer is stuck, or nobody is left to answer:
+				   the close stops it and fails the PUT */
+				w->stop = 1;
+				return -1;
+			}
+		}
+		if (rc < 0) {
+			return -1;
+		}
+		cthread_post((void *) &w->ecb_work, 0);
+		p += n;
+		len -= n;
+	} while (len > 0);
+
+	return 0;
+}
+
+__asm__("\n&FUNC    SETC 'dswrite_close'");
+int
+dswrite_close(Session *session, DSWRITE *w)
+{
+	int rc = 0;
+
+	if (w->wb) {
+		wbring_close(w->wb);
+		cthread_post((void *) &w->ecb_work, 0);
+		if (dswrite_join(w) < 0 || w->stop || w->wb->failed) {
+			rc = -1;
+		}
+		w->wb = NULL;
+	} else if (w->fp) {
+		session_fclose(session, w->fp);
+	}
+	w->fp = NULL;
+	return rc;
+}
+
+__asm__("\n&FUNC    SETC 'dswrite_stop'");
+void
+dswrite_stop(DSWRITE *w)
+{
+	if (!w->wb || !w->task) {
+		return;
+	}
+	w->stop = 1;
+	cthread_post((void *) &w->ecb_work, 0);
+	(void) dswrite_join(w);
+	w->wb = NULL;
+	w->fp = NULL;
+}
@@ -0,0 +1,171 @@
+/*
+ * etagcache.c - ETags kept across requests, checked against cheap metadata.
+ *
+ * See include/etagcache.h for what the metadata is and why a hit may be
+ * trusted. Portable C on purpose: no httpd headers, no MVS services, no
+ * statics. The host test #includes it (test/host/tstetcc.c) so the cache it
+ * drives is the one that runs on MVS, not a copy of it.
+ *
+ * A lookup walks the slots, comparing the key's hash before the key. At
+ * ETC_SLOTS entries that is a few hundred compares, nothing next to the
+ * directory or DSCB read that produced the metadata. LRU is a tick: each hit
+ * and store stamps the entry, and a full block gives up the lowest stamp.
+ */
+
+#include <string.h>
+
+#include "etagcache.h"
+
+/* FNV-1a. 0 marks a free slot, so a key that hashes to 0 is given 1. */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'etc_hash'");
+#endif
+static unsigned
+etc_hash(const char *key)
+{
+	unsigned h = 2166136261U;
+
+	while (*key) {
+		h ^= (unsigned char) *key++;
+		h *= 16777619U;
+	}
+	return h ? h : 1;
+}
+
+/* The slot holding `key`, or NULL */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'etc_find'");
+#endif
+static ETC_ENTRY *
+etc_find(ETAG_CACHE *c, const char *key, unsigned h)
+{
+	int i;
+
+	for (i = 0; i < ETC_SLOTS; i++) {
+		if (c->entry[i].hash == h && strcmp(c->entry[i].key, key) == 0) {
+			return &c->entry[i];
+		}
+	}
+	return NULL;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'etc_init'");
+#endif
+void
+etc_init(ETAG_CACHE *c)
+{
+	memset(c, 0, sizeof(*c));
+	memcpy(c->eye, ETC_EYE, sizeof(c->eye));
+	c->len = (unsigned short) sizeof(*c);
+	c->ver = ETC_VERSION;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'etc_valid'");
+#endif
+int
+etc_valid(const ETAG_CACHE *c)
+{
+	return c && memcmp(c->eye, ETC_EYE, sizeof(c->eye)) == 0
+	    && c->len == sizeof(*c) && c->ver == ETC_VERSION;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'etc_lookup'");
+#endif
+int
+etc_lookup(ETAG_CACHE *c, const char *key, const void *meta, size_t mlen,
+    char *etag)
+{
+	ETC_ENTRY *e;
+
+	if (!c || !key || !meta) {
+		return 0;
+	}
+
+	e = etc_find(c, key, etc_hash(key));
+	if (!e) {
+		return 0;
+	}
+	if (e->mlen != mlen || memcmp(e->meta, meta, mlen) != 0) {
+		/* the resource changed: the stamp is of content that is gone */
+		e->hash = 0;
+		return 0;
+	}
+
+	memcpy(etag, e->etag, ETAG_SIZE);
+	e->used = ++c->tick;
+	return 1;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'etc_store'");
+#endif
+int
+etc_store(ETAG_CACHE *c, const char *key, const void *meta, size_t mlen,
+    const char *etag)
+{
+	unsigned h;
+	ETC_ENTRY *e;
+	size_t klen;
+	int i;
+
+	if (!c || !key || !meta || !etag) {
+		return -1;
+	}
+
+	h = etc_hash(key);
+	e = etc_find(c, key, h);
+	klen = strlen(key);
+	if (klen >= ETC_KEYMAX || mlen > ETC_METAMAX
+	    || strlen(etag) != ETAG_LEN) {
+		if (e) {
+			e->hash = 0;
+		}
+		return -1;
+	}
+
+	/* the key's own slot, else a free one, else the least recently used.
+	   The tick would take years of requests to wrap, and wrapping costs
+	   one eviction out of order. */
+	for (i = 0; !e && i < ETC_SLOTS; i++) {
+		if (c->entry[i].hash == 0) {
+			e = &c->entry[i];
+		}
+	}
+	if (!e) {
+		e = &c->entry[0];
+		for (i = 1; i < ETC_SLOTS; i++) {
+			if (c->entry[i].used < e->used) {
+				e = &c->entry[i];
+			}
+		}
+	}
+
+	e->hash = h;
+	e->used = ++c->tick;
+	e->mlen = (unsigned char) mlen;
+	memcpy(e->etag, etag, ETAG_SIZE);
+	memcpy(e->key, key, klen + 1);
+	memcpy(e->meta, meta, mlen);
+	return 0;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'etc_forget'");
+#endif
+void
+etc_forget(ETAG_CACHE *c, const char *key)
+{
+	ETC_ENTRY *e;
+
+	if (!c || !key) {
+		return;
+	}
+
+	e = etc_find(c, key, etc_hash(key));
+	if (e) {
+		e->hash = 0;
+	}
+}
@@ -0,0 +1,782 @@
+/*
+ * inflate.c - a gzip or deflate request body, inflated as it arrives.
+ *
+ * See include/inflate.h for what is accepted and why the storage is fixed.
+ * The decoding follows RFC 1951 the way Mark Adler's puff.c reads it: each
+ * Huffman code kept as counts and symbols, and a code decoded a bit at a
+ * time. Unlike puff, it stops wherever a feed runs out and resumes there
+ * with the next one, because a body arrives in pieces.
+ *
+ * Portable C on purpose: no httpd headers, no MVS services, no statics. The
+ * host test #includes it (test/host/tstinfl.c) so the inflater it drives is
+ * the one that runs on MVS, not a copy of it.
+ */
+
+#include <string.h>
+
+#include "inflate.h"
+
+enum {
+	IFS_GZ_HEAD,                    /* gzip's ten fixed bytes */
+	IFS_GZ_XLEN,                    /* FEXTRA's length */
+	IFS_GZ_EXTRA,                   /* its bytes */
+	IFS_GZ_NAME,                    /* FNAME, to its NUL */
+	IFS_GZ_COMMENT,                 /* FCOMMENT, to its NUL */
+	IFS_GZ_HCRC,                    /* FHCRC */
+	IFS_ZLIB_HEAD,                  /* CMF and FLG, or the first data bytes */
+	IFS_BLOCK,                      /* BFINAL and BTYPE */
+	IFS_STORED_LEN,                 /* LEN and NLEN */
+	IFS_STORED,                     /* a stored block's bytes */
+	IFS_DYN_HEAD,                   /* HLIT, HDIST and HCLEN */
+	IFS_DYN_CLEN,                   /* the code length code's lengths */
+	IFS_DYN_LENS,                   /* the literal/length and distance lengths */
+	IFS_DYN_REPEAT,                 /* a repeat's extra bits */
+	IFS_CODES,                      /* literals, to a length or the block end */
+	IFS_LEN_EXTRA,                  /* a length's extra bits */
+	IFS_DIST,                       /* its distance symbol */
+	IFS_DIST_EXTRA,                 /* the distance's extra bits, then the copy */
+	IFS_TRAILER,                    /* gzip CRC32 and ISIZE, zlib Adler-32 */
+	IFS_DONE
+};
+
+/* z->wrap of a deflate stream once its first two bytes are read */
+#define INFL_ZLIB       3
+#define INFL_RAW        4
+
+/* gzip FLG bits */
+#define GZ_FHCRC        0x02
+#define GZ_FEXTRA       0x04
+#define GZ_FNAME        0x08
+#define GZ_FCOMMENT     0x10
+#define GZ_FRESERVED    0xE0
+
+#define ADLER_BASE      65521UL
+
+#define BITS(z, n)      ((unsigned) ((z)->bits & ((1UL << (n)) - 1)))
+
+static const short infl_lbase[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const short infl_lext[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const unsigned short infl_dbase[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+	8193, 12289, 16385, 24577
+};
+static const short infl_dext[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const short infl_clorder[19] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+/* Build a code from its lengths: 0 for a complete code, > 0 for an
+   incomplete one, < 0 for one that is oversubscribed. */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'infl_build'");
+#endif
+static int
+infl_build(INFL_HUFF *h, const short *lens, int n)
+{
+	short offs[16];
+	int left;
+	int len;
+	int sym;
+
+	memset(h->count, 0, sizeof(h->count));
+	for (sym = 0; sym < n; sym++) {
+		h->count[lens[sym]]++;
+	}
+	if (h->count[0] == n) {
+		return 0;
+	}
+
+	left = 1;
+	for (len = 1; len < 16; len++) {
+		left <<= 1;
+		left -= h->count[len];
+		if (left < 0) {
+			return left;
+		}
+	}
+
+	offs[1] = 0;
+	for (len = 1; len < 15; len++) {
+		offs[len + 1] = (short) (offs[len] + h->count[len]);
+	}
+	for (sym = 0; sym < n; sym++) {
+		if (lens[sym] != 0) {
+			h->symbol[offs[lens[sym]]++] = (short) sym;
+		}
+	}
+	return left;
+}
+
+/* The codes of a fixed Huffman block, RFC 1951 3.2.6 */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'infl_fixed'");
+#endif
+static void
+infl_fixed(INFLATE *z)
+{
+	int sym;
+
+	for (sym = 0; sym < 144; sym++) {
+		z->lens[sym] = 8;
+	}
+	for (; sym < 256; sym++) {
+		z->lens[sym] = 9;
+	}
+	for (; sym < 280; sym++) {
+		z->lens[sym] = 7;
+	}
+	for (; sym < 288; sym++) {
+		z->lens[sym] = 8;
+	}
+	(void) infl_build(&z->lencode, z->lens, 288);
+
+	for (sym = 0; sym < 30; sym++) {
+		z->lens[sym] = 5;
+	}
+	(void) infl_build(&z->distcode, z->lens, 30);
+}
+
+/* Take input bytes into the bit buffer while it has room for one. Bytes
+   taken past the end of the deflate data are read back by infl_byte(). */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'infl_fill'");
+#endif
+static void
+infl_fill(INFLATE *z, const unsigned char **in, const unsigned char *end)
+{
+	while (z->nbits <= 24 && *in < end) {
+		z->bits |= (unsigned long) *(*in)++ << z->nbits;
+		z->nbits += 8;
+	}
+}
+
+/* 1 with `n` bits in the buffer, 0 when the input ran out first */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'infl_need'");
+#endif
+static int
+infl_need(INFLATE *z, unsigned n, const unsigned char **in,
+    const unsigned char *end)
+{
+	while (z->nbits < n) {
+		if (*in == end) {
+			return 0;
+		}
+		z->bits |= (unsigned long) *(*in)++ << z->nbits;
+		z->nbits += 8;
+	}
+	return 1;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'infl_drop'");
+#endif
+static void
+infl_drop(INFLATE *z, unsigned n)
+{
+	z->bits >>= n;
+	z->nbits -= n;
+}
+
+/* The next whole byte, from the bit buffer first; -1 when there is none.
+   Only called on a byte boundary. */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'infl_byte'");
+#endif
+static int
+infl_byte(INFLATE *z, const unsigned char **in, const unsigned char *end)
+{
+	int c;
+
+	if (z->nbits >= 8) {
+		c = (int) (z->bits & 0xFF);
+		infl_drop(z, 8);
+		return c;
+	}
+	if (*in == end) {
+		return -1;
+	}
+	return *(*in)++;
+}
+
+/* A symbol of `h`; -1 when the bits run out first, -2 for no code at all.
+   Nothing is consumed unless a symbol is decoded. */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'infl_decode'");
+#endif
+static int
+infl_decode(INFLATE *z, const INFL_HUFF *h)
+{
+	unsigned long bits = z->bits;
+	unsigned len;
+	int code = 0;
+	int first = 0;
+	int index = 0;
+	int count;
+
+	for (len = 1; len < 16; len++) {
+		if (len > z->nbits) {
+			return -1;
+		}
+		code |= (int) (bits & 1);
+		bits >>= 1;
+		count = h->count[len];
+		if (code - count < first) {
+			z->bits = bits;
+			z->nbits -= len;
+			return h->symbol[index + (code - first)];
+		}
+		index += count;
+		first += count;
+		first <<= 1;
+		code <<= 1;
+	}
+	return -2;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'infl_adler'");
+#endif
+static unsigned long
+infl_adler(unsigned long adler, const unsigned char *p, unsigned len)
+{
+	unsigned long a = adler & 0xFFFF;
+	unsigned long b = (adler >> 16) & 0xFFFF;
+	unsigned n;
+
+	while (len > 0) {
+		/* 5552 bytes keep b below 2^32 before the reduction */
+		n = len < 5552 ? len : 5552;
+		len -= n;
+		while (n-- > 0) {
+			a += *p++;
+			b += a;
+		}
+		a %= ADLER_BASE;
+		b %= ADLER_BASE;
+	}
+	return (b << 16) | a;
+}
+
+/* Hand the staged bytes to the sink, check values first: the sink may
+   translate them in place. */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'infl_flush'");
+#endif
+static int
+infl_flush(INFLATE *z, BODY_SINK sink, void *ctx)
+{
+	unsigned n = z->olen;
+
+	if (n == 0) {
+		return 0;
+	}
+	z->olen = 0;
+
+	if (z->wrap == INFL_GZIP) {
+		etag_update_raw(&z->crc, z->out, n);
+	} else if (z->wrap == INFL_ZLIB) {
+		z->adler = infl_adler(z->adler, z->out, n);
+	}
+	z->member_out += n;
+	z->total_out += n;
+
+	if (z->limit && z->total_out > z->limit) {
+		z->err = INFL_ELIMIT;
+		return -1;
+	}
+	if (sink(ctx, (char *) z->out, n) < 0) {
+		z->err = INFL_ESINK;
+		return -1;
+	}
+	return 0;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'infl_put'");
+#endif
+static int
+infl_put(INFLATE *z, int c, BODY_SINK sink, void *ctx)
+{
+	z->window[z->wpos] = (unsigned char) c;
+	z->wpos = (z->wpos + 1) & (INFL_WSIZE - 1);
+	if (z->whave < INFL_WSIZE) {
+		z->whave++;
+	}
+
+	z->out[z->olen++] = (unsigned char) c;
+	if (z->olen == INFL_OUTSIZE) {
+		return infl_flush(z, sink, ctx);
+	}
+	return 0;
+}
+
+/* After a block: the next one, or the trailer on the next byte boundary */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'infl_block_end'");
+#endif
+static void
+infl_block_end(INFLATE *z)
+{
+	if (!z->last) {
+		z->state = IFS_BLOCK;
+		return;
+	}
+	infl_drop(z, z->nbits & 7);
+	z->have = 0;
+	z->state = IFS_TRAILER;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'infl_init'");
+#endif
+void
+infl_init(INFLATE *z, int wrap, size_t limit)
+{
+	memset(z, 0, offsetof(INFLATE, window));
+	z->adler = 1;
+	z->limit = limit;
+	z->wrap = wrap;
+	z->state = wrap == INFL_GZIP ? IFS_GZ_HEAD : IFS_ZLIB_HEAD;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'infl_feed'");
+#endif
+int
+infl_feed(INFLATE *z, const char *buf, size_t len, BODY_SINK sink, void *ctx)
+{
+	const unsigned char *in = (const unsigned char *) buf;
+	const unsigned char *end = in + len;
+	unsigned long check;
+	unsigned dist;
+	unsigned n;
+	int c;
+	int sym;
+	int rc;
+
+	if (z->err) {
+		return z->err;
+	}
+	z->total_in += len;
+
+	for (;;) {
+		switch (z->state) {
+		case IFS_GZ_HEAD:
+			while (z->have < 10) {
+				if ((c = infl_byte(z, &in, end)) < 0) {
+					goto more;
+				}
+				z->hdr[z->have++] = (unsigned char) c;
+			}
+			if (z->hdr[0] != 0x1F || z->hdr[1] != 0x8B || z->hdr[2] != 8
+			    || (z->hdr[3] & GZ_FRESERVED)) {
+				goto bad;
+			}
+			z->flags = z->hdr[3];
+			z->have = 0;
+			etag_init(&z->crc);
+			z->member_out = 0;
+			z->whave = 0;           /* a member does not reach back */
+			z->state = IFS_GZ_XLEN;
+			break;
+
+		case IFS_GZ_XLEN:
+			if (z->flags & GZ_FEXTRA) {
+				while (z->have < 2) {
+					if ((c = infl_byte(z, &in, end)) < 0) {
+						goto more;
+					}
+					z->hdr[z->have++] = (unsigned char) c;
+				}
+				z->need = z->hdr[0] | (unsigned) z->hdr[1] << 8;
+				z->have = 0;
+			}
+			z->state = IFS_GZ_EXTRA;
+			break;
+
+		case IFS_GZ_EXTRA:
+			while (z->need > 0) {
+				if (infl_byte(z, &in, end) < 0) {
+					goto more;
+				}
+				z->need--;
+			}
+			z->state = IFS_GZ_NAME;
+			break;
+
+		case IFS_GZ_NAME:
+		case IFS_GZ_COMMENT:
+			if (z->flags & (z->state == IFS_GZ_NAME ? GZ_FNAME : GZ_FCOMMENT)) {
+				do {
+					if ((c = infl_byte(z, &in, end)) < 0) {
+						goto more;
+					}
+				} while (c != 0);
+			}
+			z->state++;
+			break;
+
+		case IFS_GZ_HCRC:
+			if (z->flags & GZ_FHCRC) {
+				while (z->have < 2) {
+					if (infl_byte(z, &in, end) < 0) {
+						goto more;
+					}
+					z->have++;
+				}
+				z->have = 0;
+			}
+			z->state = IFS_BLOCK;
+			break;
+
+		case IFS_ZLIB_HEAD:
+			while (z->have < 2) {
+				if ((c = infl_byte(z, &in, end)) < 0) {
+					goto more;
+				}
+				z->hdr[z->have++] = (unsigned char) c;
+			}
+			z->have = 0;
+			if ((z->hdr[0] & 0x0F) == 8 && (z->hdr[0] >> 4) <= 7
+			    && (((unsigned) z->hdr[0] << 8) | z->hdr[1]) % 31 == 0) {
+				if (z->hdr[1] & 0x20) {
+					goto bad;       /* a preset dictionary */
+				}
+				z->wrap = INFL_ZLIB;
+			} else {
+				/* a bare deflate stream: its first bytes go back */
+				z->wrap = INFL_RAW;
+				z->bits = z->hdr[0] | (unsigned long) z->hdr[1] << 8;
+				z->nbits = 16;
+			}
+			z->state = IFS_BLOCK;
+			break;
+
+		case IFS_BLOCK:
+			if (!infl_need(z, 3, &in, end)) {
+				goto more;
+			}
+			z->last = (int) BITS(z, 1);
+			n = BITS(z, 3) >> 1;
+			infl_drop(z, 3);
+			if (n == 0) {
+				infl_drop(z, z->nbits & 7);
+				z->have = 0;
+				z->state = IFS_STORED_LEN;
+			} else if (n == 1) {
+				infl_fixed(z);
+				z->state = IFS_CODES;
+			} else if (n == 2) {
+				z->state = IFS_DYN_HEAD;
+			} else {
+				goto bad;
+			}
+			break;
+
+		case IFS_STORED_LEN:
+			while (z->have < 4) {
+				if ((c = infl_byte(z, &in, end)) < 0) {
+					goto more;
+				}
+				z->hdr[z->have++] = (unsigned char) c;
+			}
+			z->have = 0;
+			n = z->hdr[0] | (unsigned) z->hdr[1] << 8;
+			if ((z->hdr[2] | (unsigned) z->hdr[3] << 8) != (~n & 0xFFFF)) {
+				goto bad;
+			}
+			z->need = n;
+			z->state = IFS_STORED;
+			break;
+
+		case IFS_STORED:
+			while (z->need > 0) {
+				if (z->nbits >= 8) {
+					c = infl_byte(z, &in, end);
+				} else if (in < end) {
+					c = *in++;
+				} else {
+					goto more;
+				}
+				if (infl_put(z, c, sink, ctx) < 0) {
+					return z->err;
+				}
+				z->need--;
+			}
+			infl_block_end(z);
+			break;
+
+		case IFS_DYN_HEAD:
+			if (!infl_need(z, 14, &in, end)) {
+				goto more;
+			}
+			z->nlen = BITS(z, 5) + 257;
+			infl_drop(z, 5);
+			z->ndist = BITS(z, 5) + 1;
+			infl_drop(z, 5);
+			z->ncode = BITS(z, 4) + 4;
+			infl_drop(z, 4);
+			if (z->nlen > 286 || z->ndist > 30) {
+				goto bad;
+			}
+			z->have = 0;
+			z->state = IFS_DYN_CLEN;
+			break;
+
+		case IFS_DYN_CLEN:
+			while (z->have < z->ncode) {
+				if (!infl_need(z, 3, &in, end)) {
+					goto more;
+				}
+				z->lens[infl_clorder[z->have++]] = (short) BITS(z, 3);
+				infl_drop(z, 3);
+			}
+			while (z->have < 19) {
+				z->lens[infl_clorder[z->have++]] = 0;
+			}
+			if (infl_build(&z->lencode, z->lens, 19) != 0) {
+				goto bad;
+			}
+			z->have = 0;
+			z->state = IFS_DYN_LENS;
+			break;
+
+		case IFS_DYN_LENS:
+			while (z->have < z->nlen + z->ndist) {
+				infl_fill(z, &in, end);
+				sym = infl_decode(z, &z->lencode);
+				if (sym == -1) {
+					goto more;
+				}
+				if (sym < 0) {
+					goto bad;
+				}
+				if (sym >= 16) {
+					z->sym = sym;
+					break;
+				}
+				z->lens[z->have++] = (short) sym;
+			}
+			if (z->have < z->nlen + z->ndist) {
+				z->state = IFS_DYN_REPEAT;
+				break;
+			}
+
+			/* an incomplete code only for a single symbol, as zlib */
+			if (z->lens[256] == 0) {
+				goto bad;
+			}
+			rc = infl_build(&z->lencode, z->lens, (int) z->nlen);
+			if (rc < 0 || (rc > 0 && z->nlen != (unsigned)
+			    (z->lencode.count[0] + z->lencode.count[1]))) {
+				goto bad;
+			}
+			rc = infl_build(&z->distcode, z->lens + z->nlen, (int) z->ndist);
+			if (rc < 0 || (rc > 0 && z->ndist != (unsigned)
+			    (z->distcode.count[0] + z->distcode.count[1]))) {
+				goto bad;
+			}
+			z->state = IFS_CODES;
+			break;
+
+		case IFS_DYN_REPEAT:
+			if (z->sym == 16) {
+				if (z->have == 0) {
+					goto bad;       /* nothing to repeat */
+				}
+				if (!infl_need(z, 2, &in, end)) {
+					goto more;
+				}
+				c = z->lens[z->have - 1];
+				n = 3 + BITS(z, 2);
+				infl_drop(z, 2);
+			} else if (z->sym == 17) {
+				if (!infl_need(z, 3, &in, end)) {
+					goto more;
+				}
+				c = 0;
+				n = 3 + BITS(z, 3);
+				infl_drop(z, 3);
+			} else {
+				if (!infl_need(z, 7, &in, end)) {
+					goto more;
+				}
+				c = 0;
+				n = 11 + BITS(z, 7);
+				infl_drop(z, 7);
+			}
+			if (z->have + n > z->nlen + z->ndist) {
+				goto bad;
+			}
+			while (n-- > 0) {
+				z->lens[z->have++] = (short) c;
+			}
+			z->state = IFS_DYN_LENS;
+			break;
+
+		case IFS_CODES:
+			for (;;) {
+				infl_fill(z, &in, end);
+				sym = infl_decode(z, &z->lencode);
+				if (sym == -1) {
+					goto more;
+				}
+				if (sym < 0) {
+					goto bad;
+				}
+				if (sym >= 256) {
+					break;
+				}
+				if (infl_put(z, sym, sink, ctx) < 0) {
+					return z->err;
+				}
+			}
+			if (sym == 256) {
+				infl_block_end(z);
+				break;
+			}
+			sym -= 257;
+			if (sym >= 29) {
+				goto bad;
+			}
+			z->sym = sym;
+			z->state = IFS_LEN_EXTRA;
+			break;
+
+		case IFS_LEN_EXTRA:
+			n = (unsigned) infl_lext[z->sym];
+			if (!infl_need(z, n, &in, end)) {
+				goto more;
+			}
+			z->length = (unsigned) infl_lbase[z->sym] + BITS(z, n);
+			infl_drop(z, n);
+			z->state = IFS_DIST;
+			break;
+
+		case IFS_DIST:
+			infl_fill(z, &in, end);
+			sym = infl_decode(z, &z->distcode);
+			if (sym == -1) {
+				goto more;
+			}
+			if (sym < 0 || sym >= 30) {
+				goto bad;
+			}
+			z->sym = sym;
+			z->state = IFS_DIST_EXTRA;
+			break;
+
+		case IFS_DIST_EXTRA:
+			n = (unsigned) infl_dext[z->sym];
+			if (!infl_need(z, n, &in, end)) {
+				goto more;
+			}
+			dist = infl_dbase[z->sym] + BITS(z, n);
+			infl_drop(z, n);
+			if (dist > z->whave) {
+				goto bad;
+			}
+			/* byte by byte: a copy may overlap the bytes it makes */
+			for (n = z->length; n > 0; n--) {
+				c = z->window[(z->wpos - dist) & (INFL_WSIZE - 1)];
+				if (infl_put(z, c, sink, ctx) < 0) {
+					return z->err;
+				}
+			}
+			z->state = IFS_CODES;
+			break;
+
+		case IFS_TRAILER:
+			if (infl_flush(z, sink, ctx) < 0) {
+				return z->err;
+			}
+			n = z->wrap == INFL_GZIP ? 8 : z->wrap == INFL_ZLIB ? 4 : 0;
+			while (z->have < n) {
+				if ((c = infl_byte(z, &in, end)) < 0) {
+					goto more;
+				}
+				z->hdr[z->have++] = (unsigned char) c;
+			}
+			z->have = 0;
+			if (z->wrap == INFL_GZIP) {
+				check = z->hdr[0] | (unsigned long) z->hdr[1] << 8
+				    | (unsigned long) z->hdr[2] << 16
+				    | (unsigned long) z->hdr[3] << 24;
+				if (check != (~(unsigned long) z->crc.crc & 0xFFFFFFFFUL)) {
+					goto bad;
+				}
+				check = z->hdr[4] | (unsigned long) z->hdr[5] << 8
+				    | (unsigned long) z->hdr[6] << 16
+				    | (unsigned long) z->hdr[7] << 24;
+				if (check != (z->member_out & 0xFFFFFFFFUL)) {
+					goto bad;
+				}
+				/* another member may follow */
+				z->members++;
+				z->state = IFS_GZ_HEAD;
+				break;
+			}
+			if (z->wrap == INFL_ZLIB) {
+				check = (unsigned long) z->hdr[0] << 24
+				    | (unsigned long) z->hdr[1] << 16
+				    | (unsigned long) z->hdr[2] << 8 | z->hdr[3];
+				if (check != z->adler) {
+					goto bad;
+				}
+			}
+			z->state = IFS_DONE;
+			break;
+
+		case IFS_DONE:
+			/* nothing may follow a deflate stream */
+			if (z->nbits >= 8 || in < end) {
+				goto bad;
+			}
+			goto more;
+
+		default:
+			goto bad;
+		}
+	}
+
+more:
+	if (infl_flush(z, sink, ctx) < 0) {
+		return z->err;
+	}
+	return 0;
+
+bad:
+	z->err = INFL_EDATA;
+	return z->err;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'infl_end'");
+#endif
+int
+infl_end(INFLATE *z)
+{
+	if (z->err) {
+		return z->err;
+	}
+	if (z->state == IFS_DONE) {
+		return 0;
+	}
+	/* a gzip body ends after a member, between members */
+	if (z->state == IFS_GZ_HEAD && z->members > 0 && z->have == 0
+	    && z->nbits == 0) {
+		return 0;
+	}
+	return INFL_ETRUNC;
+}
@@ -35,7 +35,7 @@ infoHandler(Session *session)
 	char hostname[MAX_HOST_NAME_LENGTH] = DEFAULT_HOST;
 	char port_str[MAX_PORT_LENGTH] = DEFAULT_PORT;
 
-	JsonBuilder *builder = createJsonBuilder();
+	JsonBuilder *builder = createJsonResponse(session, 0);
 	if (!builder) {
 		sendDefaultHeaders(session, HTTP_STATUS_INTERNAL_SERVER_ERROR,
 					   HTTP_CONTENT_TYPE_NONE, 0);
@@ -43,7 +43,7 @@ infoHandler(Session *session)
 		goto quit;
 	}
 
-	char *value = getHeaderParam(session, "Host"); // e.g. "example.org:8080"
+	char *value = (char *) session->req.hdr[RQH_HOST]; // e.g. "example.org:8080"
 	if (value) {
 		/* A Host header this handler cannot make sense of must not fail the
 		   request: /zosmf/info is the first call every client makes, and it
@@ -150,7 +150,7 @@ __asm__("\n&FUNC	SETC 'default_port'");
 static void
 default_port(Session *session, char *outPort, size_t outSize)
 {
-	const char *fwd_port = getHeaderParam(session, "X-Forwarded-Port");
+	const char *fwd_port = session->req.hdr[RQH_X_FORWARDED_PORT];
 
 	if (fwd_port && strlen(fwd_port) < outSize && validate_port(fwd_port) == 0) {
 		strcpy(outPort, fwd_port);
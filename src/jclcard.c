@@ -0,0 +1,90 @@
+/*
+ * jclcard.c - a submitted JCL body cut into card images as it arrives.
+ *
+ * See include/jclcard.h for the rules, all of them inherited from the
+ * tokenize() cutting this replaces.
+ *
+ * Portable C on purpose: no httpd headers, no MVS services, no statics. The
+ * host test #includes it (test/host/tstjcrd.c) so the framer it drives is
+ * the one that runs on MVS, not a copy of it.
+ */
+
+#include <string.h>
+
+#include "jclcard.h"
+
+/* The line so far is a card, if it has any byte at all. */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'jclcard_emit'");
+#endif
+static int
+jclcard_emit(JCLCARD *jc, JCLCARD_EMIT emit, void *ctx)
+{
+	size_t kept = jc->kept;
+
+	if (jc->full == 0) {
+		return 0;
+	}
+	/* a CR past column 80 went with the cut anyway */
+	if (jc->last == '\r' && jc->full <= JCLCARD_COLS) {
+		kept--;
+	}
+	jc->card[kept] = '\0';
+	jc->kept = 0;
+	jc->full = 0;
+	jc->last = 0;
+	jc->cards++;
+	return emit(ctx, jc->card);
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'jclcard_init'");
+#endif
+void
+jclcard_init(JCLCARD *jc)
+{
+	memset(jc, 0, sizeof(*jc));
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'jclcard_feed'");
+#endif
+int
+jclcard_feed(JCLCARD *jc, const char *buf, size_t len, int delim,
+    JCLCARD_EMIT emit, void *ctx)
+{
+	size_t i;
+	int c;
+	int rc;
+
+	for (i = 0; i < len && !jc->ended; i++) {
+		c = (unsigned char) buf[i];
+		if (c == '\0') {
+			jc->ended = 1;
+			return jclcard_emit(jc, emit, ctx);
+		}
+		if (c == (delim & 0xFF)) {
+			rc = jclcard_emit(jc, emit, ctx);
+			if (rc < 0) {
+				return rc;
+			}
+			continue;
+		}
+		if (jc->kept < JCLCARD_COLS) {
+			jc->card[jc->kept++] = (char) c;
+		}
+		jc->full++;
+		jc->last = c;
+	}
+	return 0;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'jclcard_end'");
+#endif
+int
+jclcard_end(JCLCARD *jc, JCLCARD_EMIT emit, void *ctx)
+{
+	jc->ended = 1;
+	return jclcard_emit(jc, emit, ctx);
+}
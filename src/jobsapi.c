@@ -3,6 +3,7 @@
 #include <clibio.h>
 #include <clibstr.h>
 #include <ctype.h>
+#include <limits.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -17,23 +18,25 @@
 #include <time64.h>
 
 #include "common.h"
+#include "dsread.h"
 #include "httpcgi.h"
-#include "jclines.h"
+#include "jclcard.h"
 #include "jobsapi.h"
 #include "jobsapi_msg.h"
+#include "listitem.h"
 #include "mvsmfmsg.h"
 #include "json.h"
 #include "router.h"
+#include "routes.h"
 #include "spoolln.h"
 
 #define INITIAL_BUFFER_SIZE 4096
 #define MAX_JOBS_LIMIT 1000
 #define MAX_URL_LENGTH 256
 #define MAX_ERR_MSG_LENGTH 256
-#define INITIAL_JCL_CAPACITY 256
+#define INITIAL_JCL_CAPACITY 16  // held cards: through the JOB statement only
 
 #define JES_INFO_SIZE   20 + 1
-#define TYPE_STR_SIZE    3 + 1
 #define CLASS_STR_SIZE   3 + 1
 /* room for the longest status job_status_str() reports ("RECEIVE") plus slack:
    a requested value long enough to be truncated here is 15 characters and can
@@ -90,12 +93,11 @@ static JESJOB* find_job_by_name_and_id(Session *session, const char *jobname, co
 static int process_job_files(Session *session, JESJOB *job, const char *host, JsonBuilder *builder);
 static int validate_intrdr_headers(Session *session);
 static int open_intrdr(Session *session, VSFILE **intrdr);
-static int submit_jcl_content(Session *session, VSFILE *intrdr, const char *content, size_t content_length, 
-                              char *jobname, char *jobid, char *jobclass);
+static int submit_jcl_content(Session *session, char *jobname, char *jobid, char *jobclass);
 static const char *extract_file_value(char *json, size_t len);
-static int submit_file(Session *session, VSFILE *intrdr, const char *filename,
+static int submit_file(Session *session, const char *filename,
                        char *jobname, char *jobid, char *jobclass);
-static char* tokenize(char *str, const char *delim, char **saveptr);
+static void find_job_card_range(char **lines, int count, int *start_idx, int *end_idx);
 static int process_jobcard(char **lines, int num_lines, char *jobname, char *jobclass,
                           const char *user, const char *password);
 static char *find_notify_operand(char *line);
@@ -119,6 +121,7 @@ int
 jobListHandler(Session *session) 
 {
 	int rc = 0;
+	int span;
 	
 	JES *jes = NULL;
 	JESJOB **joblist = NULL;
@@ -126,7 +129,10 @@ jobListHandler(Session *session)
 	JESFILT jesfilt = FILTER_NONE;
 	const char *filter = NULL;
 
-	JsonBuilder *builder = createJsonBuilder();
+	/* Streamed: thousands of jobs are hundreds of KB of JSON. Every error
+	   below that answers with a status comes before the first job is
+	   added, so none of them can find the 200 already sent. */
+	JsonBuilder *builder = createJsonResponse(session, JSON_STREAMED);
 
 	if (!builder) {
 		sendErrorResponse(session, HTTP_STATUS_INTERNAL_SERVER_ERROR,
@@ -135,8 +141,8 @@ jobListHandler(Session *session)
 		goto quit;
 	}
 
-	const char *host = getHeaderParam(session, "HOST");
-	const char *owner = getQueryParam(session, "owner");
+	const char *host = session->req.hdr[RQH_HOST];
+	const char *owner = session->req.qry[RQQ_OWNER];
 	const unsigned max_jobs = get_max_jobs(session);
 	UCHAR ownerid[64];
 	/* MVSMF is link-edited RENT, so the normalized status stays on the stack */
@@ -154,7 +160,9 @@ jobListHandler(Session *session)
 
 	process_job_list_filters(session, &filter, &jesfilt, status, sizeof(status));
 
+	span = session_span_begin(session, "jesopen");
 	jes = jesopen();
+	session_span_end(session, span);
 	session_register_jes(session, jes);
 	if (!jes) {
 		wtof(MSG_JES_UNAVAILABLE);
@@ -164,7 +172,10 @@ jobListHandler(Session *session)
 		goto quit;
 	}
 
+	/* the checkpoint scan: one JESJOB per job on the queue */
+	span = session_span_begin(session, "jesjob");
 	joblist = jesjob(jes, filter, jesfilt, 0);
+	session_span_end(session, span);
 
 	startArray(builder);
 
@@ -213,7 +224,7 @@ jobFilesHandler(Session *session)
 	JESJOB *job = NULL;
 	JESJOB **joblist = NULL;
 
-	JsonBuilder *builder = createJsonBuilder();
+	JsonBuilder *builder = createJsonResponse(session, 0);
 	
 	if (!builder) {
 		sendErrorResponse(session, HTTP_STATUS_INTERNAL_SERVER_ERROR,
@@ -222,10 +233,10 @@ jobFilesHandler(Session *session)
 		goto quit;
 	}
 
-	const char *host = getHeaderParam(session, "HOST");
+	const char *host = session->req.hdr[RQH_HOST];
 
-	const char *jobname = getPathParam(session, "job-name");
-	const char *jobid   = getPathParam(session, "jobid");
+	const char *jobname = getPathVar(session, PATH_JOB_NAME);
+	const char *jobid   = getPathVar(session, PATH_JOBID);
 
 	if (!jobname || !jobid) {
 		sendErrorResponse(session, HTTP_STATUS_INTERNAL_SERVER_ERROR,
@@ -277,9 +288,9 @@ jobRecordsHandler(Session *session)
 	JESJOB *job = NULL;
 	JESJOB **joblist = NULL;
 
-	const char *jobname = getPathParam(session, "job-name");
-	const char *jobid = getPathParam(session, "jobid");
-	const char *ddid = getPathParam(session, "ddid");
+	const char *jobname = getPathVar(session, PATH_JOB_NAME);
+	const char *jobid = getPathVar(session, PATH_JOBID);
+	const char *ddid = getPathVar(session, PATH_DDID);
 
 	if (!jobname || !jobid || !ddid) {
 		sendErrorResponse(session, HTTP_STATUS_INTERNAL_SERVER_ERROR, CATEGORY_UNEXPECTED,
@@ -349,9 +360,9 @@ quit:
 int 
 jobStatusHandler(Session *session) 
 {
-	const char *host = getHeaderParam(session, "HOST");
-	const char *jobname = getPathParam(session, "job-name");
-	const char *jobid = getPathParam(session, "jobid");
+	const char *host = session->req.hdr[RQH_HOST];
+	const char *jobname = getPathVar(session, PATH_JOB_NAME);
+	const char *jobid = getPathVar(session, PATH_JOBID);
 
 	find_and_send_job_status(session, jobname, jobid, host);	
 
@@ -363,12 +374,12 @@ jobPurgeHandler(Session *session)
 {
 	int rc = 0;
 
-	const char *jobname = getPathParam(session, "job-name");
-	const char *jobid = getPathParam(session, "jobid");
+	const char *jobname = getPathVar(session, PATH_JOB_NAME);
+	const char *jobid = getPathVar(session, PATH_JOBID);
 
 	JESJOB *job = NULL;
 	JESJOB **joblist = NULL;
-	JsonBuilder *builder = createJsonBuilder();
+	JsonBuilder *builder = createJsonResponse(session, 0);
 	char owner[JOBNAME_STR_SIZE + 1] = {0};
 
 	if (!jobname || !jobid) {
@@ -465,8 +476,6 @@ int jobSubmitHandler(Session *session)
 {
 	int rc = 0;
 
-	VSFILE *intrdr = NULL;
-
 	char *data = NULL;
 	size_t data_size = 0;
 	char jobname[JOBNAME_STR_SIZE + 1];
@@ -476,28 +485,21 @@ int jobSubmitHandler(Session *session)
 	/* validate internal reader headers */
 	rc = validate_intrdr_headers(session);
 	if (rc < 0) {
+		drain_body(session);
 		sendErrorResponse(session, HTTP_STATUS_BAD_REQUEST, CATEGORY_SERVICE,
 						RC_ERROR, REASON_INVALID_QUERY,
 						"Invalid internal reader parameters", NULL, 0);
 		goto quit;
 	}
 
-	/* read request content */
-	rc = read_request_content(session, &data, &data_size);
-	if (rc < 0) {
-		sendErrorResponse(session, HTTP_STATUS_BAD_REQUEST, CATEGORY_SERVICE,
-						RC_ERROR, REASON_INVALID_REQUEST,
-						"Failed to read request content", NULL, 0);
-		goto quit;
-	}
-
 	/* dispatch based on Content-Type */
 	{
-		const char *content_type = getHeaderParam(session, "Content-Type");
+		const char *content_type = session->req.hdr[RQH_CONTENT_TYPE];
 		int is_json = (content_type && strstr(content_type, "application/json") != NULL);
 		int is_text = (!content_type || strstr(content_type, "text/plain") != NULL);
 
 		if (!is_json && !is_text) {
+			drain_body(session);
 			sendErrorResponse(session, HTTP_STATUS_BAD_REQUEST, CATEGORY_SERVICE,
 							RC_ERROR, REASON_INVALID_REQUEST,
 							"Unsupported Content-Type for job submission. "
@@ -507,6 +509,15 @@ int jobSubmitHandler(Session *session)
 		}
 
 		if (is_json) {
+			/* read request content */
+			rc = read_request_content(session, &data, &data_size);
+			if (rc < 0) {
+				sendErrorResponse(session, HTTP_STATUS_BAD_REQUEST, CATEGORY_SERVICE,
+								RC_ERROR, REASON_INVALID_REQUEST,
+								"Failed to read request content", NULL, 0);
+				goto quit;
+			}
+
 			/* convert ASCII request body to EBCDIC (CP037) so strstr/strchr work */
 			http_xlate((unsigned char *)data, data_size, httpx->xlate_cp037->atoe);
 
@@ -521,30 +532,17 @@ int jobSubmitHandler(Session *session)
 					goto quit;
 				}
 
-				if (open_intrdr(session, &intrdr) < 0) {
-					rc = -1;
-					goto quit;
-				}
-
 				/* file_value is already EBCDIC after atoe conversion */
-				rc = submit_file(session, intrdr, file_value,
+				rc = submit_file(session, file_value,
 								jobname, jobid, &jobclass);
 			}
-			intrdr = NULL; /* submit_file handles intrdr lifecycle */
 
 			if (rc < 0) {
 				goto quit;
 			}
 		} else {
-			/* text/plain or absent: inline JCL submission */
-			if (open_intrdr(session, &intrdr) < 0) {
-				rc = -1;
-				goto quit;
-			}
-
-			rc = submit_jcl_content(session, intrdr, data, data_size,
-									jobname, jobid, &jobclass);
-			intrdr = NULL; /* submit_jcl_content handles intrdr lifecycle */
+			/* text/plain or absent: inline JCL, submitted as it arrives */
+			rc = submit_jcl_content(session, jobname, jobid, &jobclass);
 			if (rc < 0) {
 				goto quit;
 			}
@@ -552,14 +550,11 @@ int jobSubmitHandler(Session *session)
 	}
 
 	{
-		const char *host = getHeaderParam(session, "HOST");
+		const char *host = session->req.hdr[RQH_HOST];
 		rc = find_and_send_job_status(session, jobname, jobid, host);
 	}
 
 quit:
-	if (intrdr) {
-		jesircls(intrdr);
-	}
 	if (data) {
 		free(data);
 	}
@@ -707,7 +702,7 @@ do_print_sysout_line(const char *line, unsigned linelen, void *arg)
 		}
 	}
 
-	rc = http_printf(session->httpc, "%-*.*s\r\n", linelen, linelen, line);
+	rc = send_printf(session, "%-*.*s\r\n", linelen, linelen, line);
 
 	if (rc >= 0) {
 		ctx->count++;
@@ -738,7 +733,9 @@ do_print_sysout(Session *session, JESJOB *job, unsigned dsid)
 	SPOOL_CTX ctx;
 	JESPRST st;
 
+	int span = session_span_begin(session, "jesopen");
 	JES *jes = jesopen();
+	session_span_end(session, span);
 	session_register_jes(session, jes);
 	if (!jes) {
 		wtof(MSG_JES_UNAVAILABLE);
@@ -780,7 +777,7 @@ do_print_sysout(Session *session, JESJOB *job, unsigned dsid)
 		/* dashed separator between dds that produced output - never leading,
 		   never trailing */
 		if (ctx.total) {
-			rc = http_printf(session->httpc, "- - - - - - - - - - - - - - - - - - - - "
+			rc = send_printf(session, "- - - - - - - - - - - - - - - - - - - - "
 											"- - - - - - - - - - - - - - - - - - - - "
 											"- - - - - - - - - - - - - - - - - - - - "
 											"- - - - - -\r\n");
@@ -795,7 +792,10 @@ do_print_sysout(Session *session, JESJOB *job, unsigned dsid)
 		ctx.count = 0;
 		ctx.jclin = (dd->dsid == PDBINJCL);
 
+		/* the spool walk, sends included -- they are "send" as well */
+		span = session_span_begin(session, "spool");
 		prc = jesprint(jes, job, dd->dsid, do_print_sysout_line, &ctx, &st);
+		session_span_end(session, span);
 
 		/* Since libc370 #26 prc is a status (0/404/503) and no longer carries
 		   the print callback's rc: a callback that stopped the walk arrives as
@@ -874,9 +874,9 @@ static void
 process_job_list_filters(Session *session, const char **filter, JESFILT *jesfilt,
 						char *status, size_t status_size)
 {
-	const char *prefix     = getQueryParam(session, "prefix");
-	const char *req_status = getQueryParam(session, "status");
-	const char *jobid      = getQueryParam(session, "jobid");
+	const char *prefix     = session->req.qry[RQQ_PREFIX];
+	const char *req_status = session->req.qry[RQQ_STATUS];
+	const char *jobid      = session->req.qry[RQQ_JOBID];
 
 	if (prefix && prefix[0] == '*') {
 		prefix = NULL;
@@ -993,7 +993,7 @@ __asm__("\n&FUNC	SETC 'want_exec_data'");
 static int
 want_exec_data(Session *session)
 {
-	const char *exec_data = getQueryParam(session, "exec-data");
+	const char *exec_data = session->req.qry[RQQ_EXEC_DATA];
 
 	return (exec_data && (exec_data[0] == 'Y' || exec_data[0] == 'y'));
 }
@@ -1064,50 +1064,33 @@ process_job(JsonBuilder *builder, JESJOB *job, const char *owner, const char *st
 
 	const char *host_str = host ? host : "127.0.0.1:8080";
 
-	char type_str[TYPE_STR_SIZE];
 	char class_str[CLASS_STR_SIZE];
-	char url_str[MAX_URL_LENGTH];
-	char files_url_str[MAX_URL_LENGTH];
-	const char *stat_str = job_status_str(job);
+	/* one each: the template reads both after they are formatted */
+	char started[EXEC_TIME_STR_SIZE];
+	char ended[EXEC_TIME_STR_SIZE];
+	JT_VAL v[JBI_COUNT];
 
 	if (should_skip_job(job, owner, status)) {
 		return 0;
 	}
 
-	// type is the first 3 characters of the jobid
-	rc = snprintf(type_str, sizeof(type_str), "%.3s", job->jobid);
-	
-	// for STCs and TSO users, class is the first 3 characters of the jobid
-	rc = snprintf(class_str, sizeof(class_str), "%.3s", job->jobid);
-	
-	// for standard jobs, class is the job class
+	// type is the first 3 characters of the jobid; for STCs and TSO users,
+	// so is class -- for standard jobs, class is the job class
+	v[JBI_CLASS].s = (const char *)job->jobid;
 	if (isalnum(job->eclass)) {
-		rc = snprintf(class_str, sizeof(class_str), "%c", job->eclass);
-	} 
-
-	// url is the full url to the job
-	rc = snprintf(url_str, sizeof(url_str),
-					"%s://%s/zosmf/restjobs/jobs/%s/%s", scheme, host_str,
-					job->jobname, job->jobid);
-	
-	// files_url is the full url to the job sysout files
-	rc = snprintf(files_url_str, sizeof(files_url_str), "%s/files", url_str);
-
-	if (rc < 0) {
-		return -1;
+		class_str[0] = (char)job->eclass;
+		class_str[1] = '\0';
+		v[JBI_CLASS].s = class_str;
 	}
 
-	rc = startJsonObject(builder);
+	// url and files-url are put together by the template, from these
+	v[JBI_JOBNAME].s = (const char *)job->jobname;
+	v[JBI_JOBID].s = (const char *)job->jobid;
+	v[JBI_OWNER].s = (const char *)job->owner;
+	v[JBI_SCHEME].s = scheme;
+	v[JBI_HOST].s = host_str;
+	v[JBI_STATUS].s = job_status_str(job);
 
-	rc = addJsonString(builder, "subsystem", "JES2");
-	rc = addJsonString(builder, "jobname", (const char *)job->jobname);
-	rc = addJsonString(builder, "jobid", (const char *)job->jobid);
-	rc = addJsonString(builder, "owner", (const char *)job->owner);
-	rc = addJsonString(builder, "type", type_str);
-	rc = addJsonString(builder, "class", class_str);
-	rc = addJsonString(builder, "url", url_str);
-	rc = addJsonString(builder, "files-url", files_url_str);
-	rc = addJsonString(builder, "status", stat_str);
 	/* build retcode from JCTCNVRC completion info:
 	   after execution  (high byte 0x77): bits 12-23 = system ABEND, bits 0-11 = max CC
 	   before execution (converter RC):   4 = JCL error, 8 = I/O error, 36 = abend
@@ -1173,8 +1156,9 @@ process_job(JsonBuilder *builder, JESJOB *job, const char *owner, const char *st
 			retcode = "JCL ERROR";
 		}
 	}
-	rc = addJsonString(builder, "retcode", retcode);
+	v[JBI_RETCODE].s = retcode;
 
+	v[JBI_EXEC].u = (unsigned)exec_data;
 	if (exec_data) {
 		/* crttzoff is seconds east of UTC (negative west) and UTC = local -
 		   offset, so the addend is the negated offset.  __tzget() reports the
@@ -1183,20 +1167,19 @@ process_job(JsonBuilder *builder, JESJOB *job, const char *owner, const char *st
 		   stack: MVSMF is link-edited RENT, so caching it in a static would
 		   ABEND S0C4 on the write. */
 		int  tzadjust = __tzget() * -1;
-		char exec_time[EXEC_TIME_STR_SIZE];
 
 		/* exec-submitted is deliberately absent: JES2 records it as
 		   JCTRDRON/JCTRDTON (time/date on the input processor), which libc370's
 		   JESJOB does not carry -- see mvslovers/libc370#79. */
-		rc = addJsonString(builder, "exec-started",
-			format_exec_time(&job->start_time64, tzadjust,
-				exec_time, sizeof(exec_time)));
-		rc = addJsonString(builder, "exec-ended",
-			format_exec_time(&job->end_time64, tzadjust,
-				exec_time, sizeof(exec_time)));
+		v[JBI_STARTED].s = format_exec_time(&job->start_time64, tzadjust,
+				started, sizeof(started));
+		v[JBI_ENDED].s = format_exec_time(&job->end_time64, tzadjust,
+				ended, sizeof(ended));
 	}
 
-	rc = endJsonObject(builder);
+	/* the whole object in one pass over the template (listitem.c),
+	   instead of a snprintf() per field */
+	rc = addJsonTemplate(builder, list_template(LIST_JOB), v);
 	if (rc < 0) {
 		return rc;
 	}
@@ -1217,6 +1200,7 @@ JESJOB* find_job_by_name_and_id(Session *session, const char *jobname, const cha
 	/* declared here, not at the jesopen() below: the early exit for a missing
 	   path variable jumps over that line, and quit: reads this pointer */
 	JES *jes = NULL;
+	int span;
 
 	if (out_joblist) {
 		*out_joblist = NULL;
@@ -1226,7 +1210,9 @@ JESJOB* find_job_by_name_and_id(Session *session, const char *jobname, const cha
 		goto quit;
 	}
 
+	span = session_span_begin(session, "jesopen");
 	jes = jesopen();
+	session_span_end(session, span);
 	session_register_jes(session, jes);
 	if (!jes) {
 		wtof(MSG_JES_UNAVAILABLE);
@@ -1235,7 +1221,9 @@ JESJOB* find_job_by_name_and_id(Session *session, const char *jobname, const cha
 
 	/* the abend of #282 lands in here, which is why the handle is registered
 	   above rather than merely closed at quit: -- that label is not reached */
+	span = session_span_begin(session, "jesjob");
 	joblist = jesjob(jes, filter, jesfilt, 1);
+	session_span_end(session, span);
 	if (!joblist) {
 		goto quit;
 	}
@@ -1360,15 +1348,11 @@ __asm__("\n&FUNC    SETC 'get_max_jobs'");
 static 
 unsigned get_max_jobs(Session *session) 
 {
-    const char *max_jobs_str = getQueryParam(session, "max-jobs");
     unsigned max_jobs = MAX_JOBS_LIMIT;
 
-    if (max_jobs_str) {
-        char *endptr = NULL;
-        long val = strtol(max_jobs_str, &endptr, DECIMAL_BASE);
-        if (*endptr == '\0' && val > 0 && val <= UINT_MAX) {
-            max_jobs = (unsigned)val;
-        }
+    /* parsed once with the request; 0 when absent or not a positive number */
+    if (session->req.max_jobs > 0) {
+        max_jobs = (unsigned) session->req.max_jobs;
     }
 
     // validate max_jobs boundaries
@@ -1385,17 +1369,17 @@ __asm__("\n&FUNC    SETC 'validate_intrdr_headers'");
 static 
 int validate_intrdr_headers(Session *session) 
 {
-    const char *intrdr_mode = getHeaderParam(session, "X-IBM-Intrdr-Mode");
+    const char *intrdr_mode = session->req.hdr[RQH_X_IBM_INTRDR_MODE];
     if (intrdr_mode != NULL && strcmp(intrdr_mode, "TEXT") != 0) {
         return -1;
     }
 
-    const char *intrdr_lrecl = getHeaderParam(session, "X-IBM-Intrdr-Lrecl");
+    const char *intrdr_lrecl = session->req.hdr[RQH_X_IBM_INTRDR_LRECL];
     if (intrdr_lrecl != NULL && strcmp(intrdr_lrecl, "80") != 0) {
         return -1;
     }
 
-    const char *intrdr_recfm = getHeaderParam(session, "X-IBM-Intrdr-Recfm");
+    const char *intrdr_recfm = session->req.hdr[RQH_X_IBM_INTRDR_RECFM];
     if (intrdr_recfm != NULL && strcmp(intrdr_recfm, "F") != 0) {
         return -1;
     }
@@ -1405,17 +1389,23 @@ int validate_intrdr_headers(Session *session)
 
 /* Open the internal reader, as late on the path as the request allows.
  *
- * jesiropn() dynallocs an INTRDR SYSOUT DD and opens the JES2 ACB, and
- * nothing in mvsMF reclaims either one if the request abends before the
- * close: the session tracker knows FILE and JES handles, not VSFILE. So the
- * open belongs after everything that can still reject the request. It used
+ * jesiropn() dynallocs an INTRDR SYSOUT DD and opens the JES2 ACB. The open
+ * reader is registered with the session, and an abend before the close has
+ * session_cleanup() delete the job in it and close it. Recovery is a cost
+ * all the same, so the open belongs after everything that can still reject
+ * the request. It used
  * to sit before read_request_content(), which held both resources across a
  * byte-at-a-time read of a body that can be megabytes, and paid a full
  * open/close cycle for every request that turned out to submit nothing --
  * an unsupported Content-Type, a body that would not read, a JSON document
  * with no "file" member (issue #300).
  *
- * Returns 0 with *intrdr usable, -1 with the 500 already sent.
+ * The streaming submitter below goes one step further: it opens the reader
+ * when the JOB statement is complete, the first moment it has a card to
+ * write, and not a card earlier.
+ *
+ * Returns 0 with *intrdr usable, -1 after MVSMF204E; the caller answers,
+ * since the body may still be arriving.
  */
 __asm__("\n&FUNC    SETC 'open_intrdr'");
 static
@@ -1423,15 +1413,356 @@ int open_intrdr(Session *session, VSFILE **intrdr)
 {
 	if (jesiropn(intrdr) < 0) {
 		wtof(MSG_INTRDR_OPEN);
-		sendErrorResponse(session, HTTP_STATUS_INTERNAL_SERVER_ERROR, CATEGORY_SERVICE,
-						RC_SEVERE, REASON_SERVER_ERROR,
-						"Failed to open internal reader", NULL, 0);
 		return -1;
 	}
+	session_register_intrdr(session, *intrdr);
 
 	return 0;
 }
 
+/*
+ * One job on its way to the internal reader, from a request body or a data
+ * set.
+ *
+ * Both used to hold the whole deck: the body copied and translated, then cut
+ * into the line table, or the data set read into it record by record, and
+ * only then was the first card written. Yet process_jobcard() needs no more
+ * than the cards up to the end of the JOB statement -- it rewrites that
+ * statement and adds a card behind it -- and every card after it goes to
+ * the reader unchanged. So the line table now holds only that prefix. Each
+ * card is offered to jcl_submit_card() as it arrives; once the JOB statement
+ * is known to be complete, the held cards are rewritten and written, the
+ * table is freed, and every later card goes straight through. Peak storage
+ * no longer grows with the deck, and JES2 reads the first card while the
+ * rest of the body is still on the wire.
+ *
+ * The JOB statement is complete when the card after its last one is in:
+ * whether a card that ends in a comma is continued depends on the next one
+ * (find_job_card_range()). A prefix that settles the range settles it as the
+ * whole deck would, so the rewritten card is the one it always was. A deck
+ * with no JOB statement is held to its end and rejected as before.
+ *
+ * A job whose first cards are already in the reader when the rest fails --
+ * the body breaks off, the data set will not read, a write fails -- must not
+ * run on what arrived. jesircls() ENDREQs, which would queue it as it is, so
+ * jcl_submit_abort() first writes JCL_CANCEL_CARD, the JES2 internal reader
+ * control statement that deletes the job being read (MVSMF208W), and so
+ * does session_cleanup() when the handler abends with the reader open.
+ *
+ * The held cards are in the request's arena, like the rest of its storage:
+ * an abend gives them back with it.
+ */
+
+/* jcl_submit failure codes, besides the JOBCARD_ERR_* of process_jobcard() */
+#define JCL_SUBMIT_ECREDS	(-10)	/* no userid and password to inject */
+#define JCL_SUBMIT_ESTORAGE	(-11)	/* the line table could not grow */
+#define JCL_SUBMIT_EOPEN	(-12)	/* the internal reader would not open */
+#define JCL_SUBMIT_EWRITE	(-13)	/* jesirput() failed */
+#define JCL_SUBMIT_ECLOSE	(-14)	/* jesircl2() failed */
+#define JCL_SUBMIT_EREAD	(-15)	/* the deck could not be read to its end */
+
+typedef struct jcl_submit {
+	Session		*session;
+	VSFILE		*intrdr;		/* open from the JOB statement on */
+	char		**lines;		/* the held cards; see jclines.h */
+	char		*lines_buf;
+	int			capacity;
+	int			num_lines;
+	int			scan_from;		/* no JOB statement before this card */
+	int			streaming;		/* the JOB statement is out */
+	int			err;			/* JCL_SUBMIT_E* or JOBCARD_ERR_* */
+	unsigned	cards;			/* cards written to the reader */
+	char		*jobname;
+	char		*jobclass;
+	char		user[64];
+	char		password[256];	/* scrubbed once it is on the card */
+	JCLCARD		framer;			/* an inline body's card cutting */
+} JCL_SUBMIT;
+
+__asm__("\n&FUNC    SETC 'jcl_submit_start'");
+static int
+jcl_submit_start(JCL_SUBMIT *js, Session *session, char *jobname, char *jobid,
+				 char *jobclass)
+{
+	int ii = 0;
+
+	memset(js, 0, sizeof(*js));
+	js->session = session;
+	js->jobname = jobname;
+	js->jobclass = jobclass;
+	js->capacity = INITIAL_JCL_CAPACITY;
+	jclcard_init(&js->framer);
+
+	*jobclass = 'A';
+	memset(jobname, 0, JOBNAME_STR_SIZE + 1);
+	memset(jobid, 0, JOBID_STR_SIZE + 1);
+
+	if (get_caller_credentials(session, js->user, sizeof(js->user),
+							   js->password, sizeof(js->password)) < 0) {
+		js->err = JCL_SUBMIT_ECREDS;
+		return -1;
+	}
+
+	js->lines = (char **)arena_calloc(&session->arena,
+									   js->capacity * sizeof(char *));
+	js->lines_buf = (char *)arena_calloc(&session->arena,
+										 (size_t)js->capacity * 81);
+	if (!js->lines || !js->lines_buf) {
+		wtof(MSG_STORAGE_FAILED, ALLOC_JCL_LINES);
+		js->err = JCL_SUBMIT_ESTORAGE;
+		return -1;
+	}
+	for (ii = 0; ii < js->capacity; ii++) {
+		js->lines[ii] = js->lines_buf + (ii * 81);
+	}
+
+	return 0;
+}
+
+/* Make room for `required` held cards. The same order as
+   grow_lines_arrays() (jclines.h), over the arena: the pointer array first,
+   then the buffer, so that a failure leaves every entry below the old
+   capacity addressing a live buffer. */
+__asm__("\n&FUNC    SETC 'jcl_submit_grow'");
+static int
+jcl_submit_grow(JCL_SUBMIT *js, int required)
+{
+	ARENA *arena = &js->session->arena;
+	int cap = js->capacity;
+	char **lines;
+	char *buf;
+	int ii;
+
+	if (required <= cap) {
+		return 0;
+	}
+	while (cap < required) {
+		if (cap > INT_MAX / 2) {
+			return -1;
+		}
+		cap *= 2;
+	}
+
+	lines = (char **)arena_realloc(arena, js->lines,
+		(size_t)js->capacity * sizeof(char *), (size_t)cap * sizeof(char *));
+	if (!lines) {
+		return -1;
+	}
+	js->lines = lines;
+	buf = (char *)arena_realloc(arena, js->lines_buf,
+		(size_t)js->capacity * 81, (size_t)cap * 81);
+	if (!buf) {
+		return -1;
+	}
+
+	js->lines_buf = buf;
+	js->capacity = cap;
+	for (ii = 0; ii < cap; ii++) {
+		js->lines[ii] = buf + (ii * 81);
+	}
+	return 0;
+}
+
+/* Drop the line table, and scrub the password on the rewritten card in
+   it; the storage goes with the arena. */
+__asm__("\n&FUNC    SETC 'jcl_submit_drop_lines'");
+static void
+jcl_submit_drop_lines(JCL_SUBMIT *js)
+{
+	if (js->lines_buf) {
+		memset(js->lines_buf, 0, (size_t)js->capacity * 81);
+		js->lines_buf = NULL;
+	}
+	js->lines = NULL;
+}
+
+__asm__("\n&FUNC    SETC 'jcl_submit_put'");
+static int
+jcl_submit_put(JCL_SUBMIT *js, char *card)
+{
+	if (card[0] == '\0') {
+		return 0;	/* only non-empty cards, as always */
+	}
+	if (jesirput(js->intrdr, card) < 0) {
+		wtof(MSG_INTRDR_WRITE);
+		js->err = JCL_SUBMIT_EWRITE;
+		return -1;
+	}
+	js->cards++;
+	return 0;
+}
+
+/* The JOB statement is complete: rewrite it, and write the held cards. */
+__asm__("\n&FUNC    SETC 'jcl_submit_jobcard'");
+static int
+jcl_submit_jobcard(JCL_SUBMIT *js)
+{
+	int rc = 0;
+	int ii = 0;
+
+	rc = process_jobcard(js->lines, js->num_lines, js->jobname, js->jobclass,
+						 js->user, js->password);
+	memset(js->password, 0, sizeof(js->password));   /* scrub; it now lives on the card */
+	if (rc < 0) {
+		js->err = rc;
+		return -1;
+	}
+
+	if (open_intrdr(js->session, &js->intrdr) < 0) {
+		js->intrdr = NULL;
+		js->err = JCL_SUBMIT_EOPEN;
+		return -1;
+	}
+
+	for (ii = 0; ii < rc; ii++) {
+		if (jcl_submit_put(js, js->lines[ii]) < 0) {
+			return -1;
+		}
+	}
+
+	jcl_submit_drop_lines(js);
+	js->streaming = 1;
+	return 0;
+}
+
+/*
+ * The next card of the deck, NUL-terminated and at most 80 columns: held
+ * until the JOB statement is complete, written straight through after.
+ * A JCLCARD_EMIT, so an inline body's framer calls it directly.
+ */
+__asm__("\n&FUNC    SETC 'jcl_submit_card'");
+static int
+jcl_submit_card(void *ctx, char *card)
+{
+	JCL_SUBMIT *js = ctx;
+	int start_idx = -1;
+	int end_idx = -1;
+
+	if (js->err) {
+		return -1;
+	}
+	if (js->streaming) {
+		return jcl_submit_put(js, card);
+	}
+
+	/* one slot to spare for the card process_jobcard() adds */
+	if (jcl_submit_grow(js, js->num_lines + 2) < 0) {
+		wtof(MSG_STORAGE_FAILED, ALLOC_JCL_LINES);
+		js->err = JCL_SUBMIT_ESTORAGE;
+		return -1;
+	}
+	strncpy(js->lines[js->num_lines], card, 80);
+	js->lines[js->num_lines][80] = '\0';
+	js->num_lines++;
+
+	/* Only the cards not yet known to hold no JOB statement are scanned,
+	   so a long preamble is not scanned again for every card. */
+	find_job_card_range(js->lines + js->scan_from,
+						js->num_lines - js->scan_from, &start_idx, &end_idx);
+	if (start_idx < 0) {
+		js->scan_from = js->num_lines;
+		return 0;
+	}
+	end_idx += js->scan_from;
+	js->scan_from += start_idx;
+	if (end_idx < js->num_lines - 1) {
+		return jcl_submit_jobcard(js);
+	}
+
+	return 0;
+}
+
+/* The deck is over: close the reader, which queues the job. */
+__asm__("\n&FUNC    SETC 'jcl_submit_finish'");
+static int
+jcl_submit_finish(JCL_SUBMIT *js, char *jobid)
+{
+	unsigned char jobid_raw[8];
+	int rc = 0;
+
+	if (js->err) {
+		return -1;
+	}
+	if (!js->streaming && jcl_submit_jobcard(js) < 0) {
+		return -1;
+	}
+
+	/* jesircl2() copies the jobid out between the ENDREQ and the close --
+	   the old read of intrdr->rpl.rplrbar after jesircls() fetched from the
+	   freed VSFILE (#296).  The handle is gone even on a close error, so
+	   drop the pointer right away instead of letting the abort close it
+	   again. */
+	session_unregister_intrdr(js->session, js->intrdr);
+	rc = jesircl2(js->intrdr, jobid_raw);
+	js->intrdr = NULL;
+	if (rc < 0) {
+		wtof(MSG_INTRDR_CLOSE);
+		js->err = JCL_SUBMIT_ECLOSE;
+		return -1;
+	}
+
+	memcpy(jobid, jobid_raw, JOBID_STR_SIZE);
+	jobid[JOBID_STR_SIZE] = '\0';
+
+	wtof(MSG_JOB_SUBMITTED, js->jobname, jobid);
+	return 0;
+}
+
+/* Release whatever the submission still holds; after a failure, take back
+   the cards already written. Safe to call after jcl_submit_finish(). */
+__asm__("\n&FUNC    SETC 'jcl_submit_abort'");
+static void
+jcl_submit_abort(JCL_SUBMIT *js)
+{
+	if (js->intrdr) {
+		session_unregister_intrdr(js->session, js->intrdr);
+		if (js->cards > 0 && jesirput(js->intrdr, JCL_CANCEL_CARD) >= 0) {
+			wtof(MSG_INTRDR_CANCEL, js->jobname);
+		}
+		jesircls(js->intrdr);
+		js->intrdr = NULL;
+	}
+
+	jcl_submit_drop_lines(js);
+	memset(js->password, 0, sizeof(js->password));
+}
+
+/* Answer a failed submission; `nocard` says where the JOB card was missing. */
+__asm__("\n&FUNC    SETC 'jcl_submit_respond'");
+static void
+jcl_submit_respond(JCL_SUBMIT *js, const char *nocard)
+{
+	Session *session = js->session;
+
+	switch (js->err) {
+	case JCL_SUBMIT_ECREDS:
+		sendErrorResponse(session, HTTP_STATUS_BAD_REQUEST, CATEGORY_SERVICE,
+						RC_ERROR, REASON_INVALID_REQUEST,
+						"Job submission requires an authenticated session with a password", NULL, 0);
+		break;
+	case JOBCARD_ERR_TOO_LONG:
+		sendErrorResponse(session, HTTP_STATUS_BAD_REQUEST, CATEGORY_SERVICE,
+						RC_ERROR, REASON_JOBCARD_TOO_LONG,
+						ERR_MSG_JOBCARD_TOO_LONG, NULL, 0);
+		break;
+	case JOBCARD_ERR_NO_CARD:
+		sendErrorResponse(session, HTTP_STATUS_BAD_REQUEST, CATEGORY_SERVICE,
+						RC_ERROR, REASON_INVALID_REQUEST,
+						nocard, NULL, 0);
+		break;
+	case JCL_SUBMIT_EOPEN:
+		sendErrorResponse(session, HTTP_STATUS_INTERNAL_SERVER_ERROR, CATEGORY_SERVICE,
+						RC_SEVERE, REASON_SERVER_ERROR,
+						"Failed to open internal reader", NULL, 0);
+		break;
+	default:
+		sendErrorResponse(session, HTTP_STATUS_INTERNAL_SERVER_ERROR,
+						CATEGORY_UNEXPECTED, RC_SEVERE, REASON_SERVER_ERROR,
+						ERR_MSG_SERVER_ERROR, NULL, 0);
+		break;
+	}
+}
+
 __asm__("\n&FUNC	SETC 'extract_file_value'");
 static const char *
 extract_file_value(char *json, size_t len)
@@ -1490,25 +1821,22 @@ extract_file_value(char *json, size_t len)
 
 __asm__("\n&FUNC	SETC 'submit_file'");
 static int
-submit_file(Session *session, VSFILE *intrdr, const char *filename,
+submit_file(Session *session, const char *filename,
             char *jobname, char *jobid, char *jobclass)
 {
 	int rc = 0;
 
-	FILE *fp = NULL;
-	char *buffer = NULL;
-	size_t buffer_size = 0;
-	char **lines = NULL;
-	char *lines_buf = NULL;
-	int num_lines = 0;
-	int capacity = INITIAL_JCL_CAPACITY;
-	int modified_lines_count = 0;
+	JCL_SUBMIT js;
+	DSREAD r;
+	const unsigned char *rec;
+	size_t rec_len;
+	int more;
+	char card[JCLCARD_COLS + 1];
 
 	char dsname[DSNAME_STR_SIZE + 1];
 
-	*jobclass = 'A';
-	memset(jobname, 0, JOBNAME_STR_SIZE + 1);
-	memset(jobid, 0, JOBID_STR_SIZE + 1);
+	memset(&js, 0, sizeof(js));
+	memset(&r, 0, sizeof(r));
 
 	/* strip //'DSN' → DSN */
 	size_t len = strlen(filename);
@@ -1525,20 +1853,15 @@ submit_file(Session *session, VSFILE *intrdr, const char *filename,
 		goto quit;
 	}
 
-	fp = fopen(dsname, "re");
-	if (!fp) {
+	rc = dsread_open(session, &r, dsname, 1);
+	if (rc == -1) {
 		char msg[MAX_ERR_MSG_LENGTH] = {0};
 		snprintf(msg, sizeof(msg), ERR_MSG_SUBMIT_FILE_OPEN, dsname);
 		sendErrorResponse(session, HTTP_STATUS_NOT_FOUND, CATEGORY_SERVICE,
 						RC_ERROR, REASON_SUBMIT_FILE_OPEN, msg, NULL, 0);
-		rc = -1;
 		goto quit;
 	}
-	session_register_file(session, fp);
-
-	buffer_size = fp->lrecl + 2;
-	buffer = calloc(1, buffer_size);
-	if (!buffer) {
+	if (rc < 0) {
 		sendErrorResponse(session, HTTP_STATUS_INTERNAL_SERVER_ERROR,
 						CATEGORY_UNEXPECTED, RC_SEVERE, REASON_SERVER_ERROR,
 						ERR_MSG_SERVER_ERROR, NULL, 0);
@@ -1546,202 +1869,58 @@ submit_file(Session *session, VSFILE *intrdr, const char *filename,
 		goto quit;
 	}
 
-	/* allocate lines array with initial capacity */
-	lines = (char **)calloc(capacity, sizeof(char *));
-	lines_buf = (char *)calloc(capacity, 81);
-	if (!lines || !lines_buf) {
-		sendErrorResponse(session, HTTP_STATUS_INTERNAL_SERVER_ERROR,
-						CATEGORY_UNEXPECTED, RC_SEVERE, REASON_SERVER_ERROR,
-						ERR_MSG_SERVER_ERROR, NULL, 0);
+	if (jcl_submit_start(&js, session, jobname, jobid, jobclass) < 0) {
+		jcl_submit_respond(&js, "No valid JOB card found in dataset");
 		rc = -1;
 		goto quit;
 	}
-	{
-		int alloc_idx = 0;
-		for (alloc_idx = 0; alloc_idx < capacity; alloc_idx++) {
-			lines[alloc_idx] = lines_buf + (alloc_idx * 81);
-		}
-	}
-
-	/* read dataset into lines array */
-	while (fgets(buffer, (int)buffer_size, fp) > 0) {
-		size_t line_len;
-
-		if (num_lines >= capacity) {
-			if (grow_lines_arrays(&lines, &lines_buf, &capacity,
-								  num_lines + 1) < 0) {
-				sendErrorResponse(session, HTTP_STATUS_INTERNAL_SERVER_ERROR,
-								CATEGORY_UNEXPECTED, RC_SEVERE, REASON_SERVER_ERROR,
-								ERR_MSG_SERVER_ERROR, NULL, 0);
-				rc = -1;
-				goto quit;
-			}
-		}
 
-		line_len = strlen(buffer);
+	/* one card per record, written as it is read once the JOB card is out */
+	while ((more = dsread_next(&r, &rec, &rec_len)) > 0) {
+		size_t line_len = rec_len > 80 ? 80 : rec_len;
 
 		/* remove trailing newline/CR */
-		while (line_len > 0 && (buffer[line_len - 1] == '\n' ||
-				buffer[line_len - 1] == '\r' ||
-				buffer[line_len - 1] == EBCDIC_LF)) {
-			buffer[line_len - 1] = '\0';
+		while (line_len > 0 && (rec[line_len - 1] == '\n' ||
+				rec[line_len - 1] == '\r' ||
+				rec[line_len - 1] == EBCDIC_LF)) {
 			line_len--;
 		}
 
-		strncpy(lines[num_lines], buffer, 80);
-		lines[num_lines][80] = '\0';
-		num_lines++;
-	}
-
-	session_fclose(session, fp);
-	fp = NULL;
-
-	/* ensure room for the extra line added by process_jobcard */
-	if (grow_lines_arrays(&lines, &lines_buf, &capacity, num_lines + 1) < 0) {
-		sendErrorResponse(session, HTTP_STATUS_INTERNAL_SERVER_ERROR,
-						CATEGORY_UNEXPECTED, RC_SEVERE, REASON_SERVER_ERROR,
-						ERR_MSG_SERVER_ERROR, NULL, 0);
-		rc = -1;
-		goto quit;
-	}
-
-	/* process jobcard: inject USER/PASSWORD */
-	{
-		char user[64] = {0};
-		char password[256] = {0};
-
-		if (get_caller_credentials(session, user, sizeof(user),
-									   password, sizeof(password)) < 0) {
-			sendErrorResponse(session, HTTP_STATUS_BAD_REQUEST, CATEGORY_SERVICE,
-							RC_ERROR, REASON_INVALID_REQUEST,
-							"Job submission requires an authenticated session with a password", NULL, 0);
-			rc = -1;
-			goto quit;
-		}
-
-		rc = process_jobcard(lines, num_lines, jobname, jobclass, user, password);
-		memset(password, 0, sizeof(password));   /* scrub; it now lives on the card */
-		if (rc == JOBCARD_ERR_TOO_LONG) {
-			sendErrorResponse(session, HTTP_STATUS_BAD_REQUEST, CATEGORY_SERVICE,
-							RC_ERROR, REASON_JOBCARD_TOO_LONG,
-							ERR_MSG_JOBCARD_TOO_LONG, NULL, 0);
-			goto quit;
-		}
-		if (rc < 0) {
-			sendErrorResponse(session, HTTP_STATUS_BAD_REQUEST, CATEGORY_SERVICE,
-							RC_ERROR, REASON_INVALID_REQUEST,
-							"No valid JOB card found in dataset", NULL, 0);
-			goto quit;
+		memcpy(card, rec, line_len);
+		card[line_len] = '\0';
+		if (jcl_submit_card(&js, card) < 0) {
+			break;
 		}
-		modified_lines_count = rc;
 	}
 
-	/* submit all lines to internal reader */
-	{
-		int ii = 0;
-		for (ii = 0; ii < modified_lines_count; ii++) {
-			if (lines[ii][0] != '\0') {
-				rc = jesirput(intrdr, lines[ii]);
-				if (rc < 0) {
-					wtof(MSG_INTRDR_WRITE);
-					sendErrorResponse(session, HTTP_STATUS_INTERNAL_SERVER_ERROR,
-									CATEGORY_UNEXPECTED, RC_SEVERE, REASON_SERVER_ERROR,
-									ERR_MSG_SERVER_ERROR, NULL, 0);
-					goto quit;
-				}
-			}
-		}
+	dsread_close(session, &r);
+	if (more < 0 && !js.err) {
+		/* MVSMF106W has said which block; the job is not submitted half */
+		js.err = JCL_SUBMIT_EREAD;
 	}
 
-	/* Close internal reader and retrieve jobid.  jesircl2() copies the
-	   feedback out between the ENDREQ and the close -- the old read of
-	   intrdr->rpl.rplrbar after jesircls() fetched from the freed VSFILE
-	   (#296).  The handle is gone even when the close reports an error,
-	   so drop the pointer right away; the old error path handed the dead
-	   handle to jesircls() a second time at quit:. */
-	{
-		unsigned char jobid_raw[8];
-
-		rc = jesircl2(intrdr, jobid_raw);
-		intrdr = NULL;
-		if (rc < 0) {
-			wtof(MSG_INTRDR_CLOSE);
-			sendErrorResponse(session, HTTP_STATUS_INTERNAL_SERVER_ERROR,
-							CATEGORY_UNEXPECTED, RC_SEVERE, REASON_SERVER_ERROR,
-							ERR_MSG_SERVER_ERROR, NULL, 0);
-			goto quit;
-		}
-
-		memcpy(jobid, jobid_raw, JOBID_STR_SIZE);
-		jobid[JOBID_STR_SIZE] = '\0';
+	rc = jcl_submit_finish(&js, jobid);
+	if (rc < 0) {
+		jcl_submit_abort(&js);
+		jcl_submit_respond(&js, "No valid JOB card found in dataset");
+		rc = -1;
+		goto quit;
 	}
 
-	wtof(MSG_JOB_SUBMITTED, jobname, jobid);
-	rc = 0;
-
 quit:
-	if (intrdr) {
-		jesircls(intrdr);
-	}
-
-	if (fp) {
-		session_fclose(session, fp);
-	}
-
-	if (buffer) {
-		free(buffer);
-	}
-
-	if (lines) {
-		free((void *)lines);
-	}
-	if (lines_buf) {
-		free(lines_buf);
-	}
+	jcl_submit_abort(&js);
+	dsread_close(session, &r);
 
 	return rc;
 }
 
-__asm__("\n&FUNC    SETC 'tokenize'");
-static 
-char* tokenize(char *str, const char *delim, char **saveptr) 
-{
-    char *token = NULL;
-
-    if (str == NULL) {
-        str = *saveptr;
-    }
-
-    if (str == NULL) {
-        return NULL;
-    }
-
-    // Skip leading delimiters
-    str += strspn(str, delim);
-    if (*str == '\0') {
-        *saveptr = str;
-        return NULL;
-    }
-
-    // Find end of token
-    token = str;
-    str = strpbrk(token, delim);
-    if (str == NULL) {
-        *saveptr = token + strlen(token);
-    } else {
-        *str = '\0';
-        *saveptr = str + 1;
-    }
-    return token;
-}
-
 __asm__("\n&FUNC    SETC 'send_job_status_response'");
 static int
 send_job_status_response(Session *session, JESJOB *job, const char *host)
 {
     int rc = 0;
     
-	JsonBuilder *builder = createJsonBuilder();
+	JsonBuilder *builder = createJsonResponse(session, 0);
 
     if (!builder) {
         sendErrorResponse(session, HTTP_STATUS_INTERNAL_SERVER_ERROR, CATEGORY_UNEXPECTED,
@@ -2286,172 +2465,60 @@ process_jobcard(char **lines, int num_lines, char *jobname, char *jobclass,
     return num_lines + 1;
 }
 
-__asm__("\n&FUNC    SETC 'submit_jcl_content'");
-static 
-int submit_jcl_content(Session *session, VSFILE *intrdr, const char *content, size_t content_length, 
-                      char *jobname, char *jobid, char *jobclass) 
+/* The sink of an inline body: translate, then cut into cards. cp037 is
+   byte for byte, so a span boundary changes nothing. */
+__asm__("\n&FUNC    SETC 'jcl_body_sink'");
+static int
+jcl_body_sink(void *ctx, char *data, size_t len)
 {
-    int rc = 0;
-    char *ebcdic_content = NULL;
-    char **lines = NULL;
-    char *lines_buf = NULL;
-    int num_lines = 0;
-    int capacity = INITIAL_JCL_CAPACITY;
-    int final_lines_count = 0;
-    
-    *jobclass = 'A';
-    memset(jobname, 0, JOBNAME_STR_SIZE + 1);
-    memset(jobid, 0, JOBID_STR_SIZE + 1);
-
-    /* Use malloc+memcpy instead of strdup to ensure all bytes are copied
-     * even if content contains embedded nulls */
-    ebcdic_content = (char *)malloc(content_length + 1);
-    if (!ebcdic_content) {
-        wtof(MSG_STORAGE_FAILED, ALLOC_JCL_TEXT);
-        rc = -1;
-        goto quit;
-    }
-    memcpy(ebcdic_content, content, content_length);
-    ebcdic_content[content_length] = '\0';
-
-    http_xlate((unsigned char *)ebcdic_content, content_length, httpx->xlate_cp037->atoe);
-
-    /* Allocate lines array + contiguous buffer */
-    lines = (char **)calloc(capacity, sizeof(char *));
-    lines_buf = (char *)calloc(capacity, 81);
-    if (!lines || !lines_buf) {
-        wtof(MSG_STORAGE_FAILED, ALLOC_JCL_LINES);
-        rc = -1;
-        goto quit;
-    }
-    {
-        int li;
-        for (li = 0; li < capacity; li++) {
-            lines[li] = lines_buf + (li * 81);
-        }
-    }
-
-    char delimiter[2] = {EBCDIC_NEL, '\0'}; // CP037 A2E maps ASCII LF to NEL (0x15)
-    char *saveptr = NULL;
-    char *line = tokenize(ebcdic_content, delimiter, &saveptr);
-
-    // Collect all lines
-    while (line != NULL) {
-        size_t line_len;
-
-        if (num_lines >= capacity) {
-            if (grow_lines_arrays(&lines, &lines_buf, &capacity,
-                                  num_lines + 1) < 0) {
-                wtof(MSG_STORAGE_FAILED, ALLOC_JCL_LINES);
-                rc = -1;
-                goto quit;
-            }
-        }
-
-        line_len = strlen(line);
-
-        // Remove trailing CR if present
-        if (line_len > 0 && line[line_len - 1] == '\r') {
-            line[line_len - 1] = '\0';
-            line_len--;
-        }
-
-        strncpy(lines[num_lines], line, 80);
-        lines[num_lines][80] = '\0';
-        num_lines++;
-
-        line = tokenize(NULL, delimiter, &saveptr);
-    }
-
-    /* ensure room for the extra line added by process_jobcard */
-    if (grow_lines_arrays(&lines, &lines_buf, &capacity, num_lines + 1) < 0) {
-        wtof(MSG_STORAGE_FAILED, ALLOC_JCL_LINES);
-        rc = -1;
-        goto quit;
-    }
-
-    /* Analyze and potentially modify job card */
-    char user[64] = {0};
-    char password[256] = {0};
-
-    if (get_caller_credentials(session, user, sizeof(user),
-                                   password, sizeof(password)) < 0) {
-        sendErrorResponse(session, HTTP_STATUS_BAD_REQUEST, CATEGORY_SERVICE,
-                        RC_ERROR, REASON_INVALID_REQUEST,
-                        "Job submission requires an authenticated session with a password", NULL, 0);
-        rc = -1;
-        goto quit;
-    }
-
-    rc = process_jobcard(lines, num_lines, jobname, jobclass, user, password);
-    memset(password, 0, sizeof(password));   /* scrub; it now lives on the card */
-    if (rc == JOBCARD_ERR_TOO_LONG) {
-        sendErrorResponse(session, HTTP_STATUS_BAD_REQUEST, CATEGORY_SERVICE,
-                        RC_ERROR, REASON_JOBCARD_TOO_LONG,
-                        ERR_MSG_JOBCARD_TOO_LONG, NULL, 0);
-        goto quit;
-    }
-    if (rc < 0) {
-        sendErrorResponse(session, HTTP_STATUS_BAD_REQUEST, CATEGORY_SERVICE,
-                        RC_ERROR, REASON_INVALID_REQUEST,
-                        "No valid JOB card found in submitted JCL", NULL, 0);
-        goto quit;
-    }
-
-    // Submit all lines
-    final_lines_count = rc;
-
-    int submit_idx = 0;
-    for (submit_idx = 0; submit_idx < final_lines_count; submit_idx++) {
-        if (lines[submit_idx][0] != '\0') {  // Only submit non-empty lines
-            rc = jesirput(intrdr, lines[submit_idx]);
-            if (rc < 0) {
-                wtof(MSG_INTRDR_WRITE);
-                goto quit;
-            }
-        }
-    }
-
-    /* jesircl2() copies the jobid out between the ENDREQ and the close --
-       the old read of intrdr->rpl.rplrbar after jesircls() fetched from the
-       freed VSFILE (#296).  The handle is gone even on a close error, so
-       drop the pointer right away instead of letting quit: close it again. */
-    {
-        unsigned char jobid_raw[8];
-
-        rc = jesircl2(intrdr, jobid_raw);
-        intrdr = NULL;
-        if (rc < 0) {
-            wtof(MSG_INTRDR_CLOSE);
-            goto quit;
-        }
+	JCL_SUBMIT *js = ctx;
+	Session *session = js->session;	/* for httpx */
 
-        memcpy(jobid, jobid_raw, JOBID_STR_SIZE);
-        jobid[JOBID_STR_SIZE] = '\0';
-    }
+	http_xlate((unsigned char *)data, len, httpx->xlate_cp037->atoe);
 
-    wtof(MSG_JOB_SUBMITTED, jobname, jobid);
-    rc = 0;
+	/* CP037 A2E maps ASCII LF to NEL (0x15) */
+	if (jclcard_feed(&js->framer, data, len, EBCDIC_NEL,
+					 jcl_submit_card, js) < 0) {
+		return -1;
+	}
+	return 0;
+}
 
+__asm__("\n&FUNC    SETC 'submit_jcl_content'");
+static int
+submit_jcl_content(Session *session, char *jobname, char *jobid, char *jobclass)
+{
+	JCL_SUBMIT js;
+	int rc = 0;
 
-quit:
-	// Close internal reader if it was still opened
-	if (intrdr)	 {
-		jesircls(intrdr);
+	if (jcl_submit_start(&js, session, jobname, jobid, jobclass) < 0) {
+		drain_body(session);
+		jcl_submit_abort(&js);
+		jcl_submit_respond(&js, NULL);
+		return -1;
 	}
 
-    // Free all allocated memory
-    if (lines) {
-        free((void *) lines);
-    }
-    if (lines_buf) {
-        free((void *) lines_buf);
-    }
+	rc = receive_body(session, body_recv_bytes, jcl_body_sink, &js);
+	if (rc == 0) {
+		(void)jclcard_end(&js.framer, jcl_submit_card, &js);
+	}
+	if (rc < 0 && !js.err) {
+		/* ERECV, EFRAME or ECODING: the body did not arrive whole */
+		jcl_submit_abort(&js);
+		sendErrorResponse(session, HTTP_STATUS_BAD_REQUEST, CATEGORY_SERVICE,
+						RC_ERROR, REASON_INVALID_REQUEST,
+						rc == BODY_ECODING
+						? "Unsupported or corrupt Content-Encoding"
+						: "Failed to read request content", NULL, 0);
+		return -1;
+	}
 
-    if (ebcdic_content) {
-        free((void *) ebcdic_content);
-    }
+	rc = jcl_submit_finish(&js, jobid);
+	jcl_submit_abort(&js);
+	if (rc < 0) {
+		jcl_submit_respond(&js, "No valid JOB card found in submitted JCL");
+		return -1;
+	}
 
-    return rc;
+	return 0;
 }
-
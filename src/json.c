@@ -5,6 +5,8 @@
 #include "json.h"
 
 static int append_string(JsonBuilder *builder, const char *str);
+static int flush_window(JsonBuilder *builder);
+static int ensure_capacity(JsonBuilder *builder, size_t needed);
 
 JsonBuilder *
 createJsonBuilder(void) 
@@ -27,6 +29,70 @@ createJsonBuilder(void)
     return builder;
 }
 
+JsonBuilder *
+createJsonBuilderIn(ARENA *arena)
+{
+    JsonBuilder *builder;
+    char *p;
+
+    if (!arena) {
+        return createJsonBuilder();
+    }
+
+    // the arena aligns to a doubleword, the struct asks for more
+    p = arena_calloc(arena, sizeof(JsonBuilder) + JSON_BUILDER_ALIGNMENT - 1);
+    if (!p) {
+        return NULL;
+    }
+    builder = (JsonBuilder *)(((size_t)p + JSON_BUILDER_ALIGNMENT - 1) &
+                              ~(size_t)(JSON_BUILDER_ALIGNMENT - 1));
+
+    // allocated second, so it is the arena's most recent allocation and
+    // ensure_capacity() can grow it without a copy
+    builder->buffer = arena_calloc(arena, JSON_INITIAL_BUFFER_SIZE);
+    if (!builder->buffer) {
+        return NULL;
+    }
+
+    builder->capacity = JSON_INITIAL_BUFFER_SIZE;
+    builder->size = 0;
+    builder->is_first = 1;
+    builder->arena = arena;
+
+    return builder;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'reserveJsonBuilder'");
+#endif
+int
+reserveJsonBuilder(JsonBuilder *builder, size_t capacity)
+{
+    char *new_buffer;
+
+    if (!builder) {
+        return -1;
+    }
+    if (capacity <= builder->capacity) {
+        return 0;
+    }
+
+    if (builder->arena) {
+        new_buffer = arena_realloc(builder->arena, builder->buffer,
+                                   builder->capacity, capacity);
+    } else {
+        new_buffer = realloc(builder->buffer, capacity);
+    }
+    if (!new_buffer) {
+        return -1;
+    }
+
+    builder->buffer = new_buffer;
+    builder->capacity = capacity;
+
+    return 0;
+}
+
 void 
 freeJsonBuilder(JsonBuilder *builder) 
 {
@@ -34,6 +100,16 @@ freeJsonBuilder(JsonBuilder *builder)
         return;
     }
 
+    // part of the document is already out and the rest never will be
+    if (builder->flush && builder->flushed && !builder->finished) {
+        (void)builder->flush(builder->flush_ctx, NULL, 0);
+    }
+
+    // the arena's release gives it back
+    if (builder->arena) {
+        return;
+    }
+
     if (builder->buffer) {
         free(builder->buffer);
     }
@@ -348,19 +424,145 @@ getJsonString(JsonBuilder *builder)
     return strdup(builder->buffer);
 }
 
+int
+streamJsonBuilder(JsonBuilder *builder, JsonFlush flush, void *ctx)
+{
+    char *window;
+
+    if (!builder || !flush) {
+        return -1;
+    }
+
+    if (builder->capacity < JSON_STREAM_WINDOW) {
+        if (builder->arena) {
+            window = arena_realloc(builder->arena, builder->buffer,
+                                   builder->capacity, JSON_STREAM_WINDOW);
+        } else {
+            window = realloc(builder->buffer, JSON_STREAM_WINDOW);
+        }
+        if (!window) {
+            return -1;
+        }
+        builder->buffer = window;
+        builder->capacity = JSON_STREAM_WINDOW;
+    }
+
+    builder->flush = flush;
+    builder->flush_ctx = ctx;
+    builder->flushed = 0;
+    builder->finished = 0;
+
+    return 0;
+}
+
+int
+finishJsonBuilder(JsonBuilder *builder)
+{
+    if (!builder) {
+        return -1;
+    }
+
+    if (!builder->flush || builder->finished) {
+        return 0;
+    }
+
+    // finished even when the last flush fails: the sink has seen the
+    // failure, freeJsonBuilder() must not report an abandoned document
+    builder->finished = 1;
+
+    return flush_window(builder);
+}
+
 // private functions
 
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'addJsonTemplate'");
+#endif
+int
+addJsonTemplate(JsonBuilder *builder, const JT_OP *t, const JT_VAL *v)
+{
+    size_t room;
+    int n;
+
+    if (!builder || !t) {
+        return -1;
+    }
+
+    if (!builder->is_first) {
+        if (append_string(builder, ",") < 0) {
+            return -1;
+        }
+    }
+
+    // into what is left, keeping a byte for the terminator; short of
+    // room, flush or grow by at least as much again and render anew
+    for (;;) {
+        room = builder->capacity - builder->size;
+        n = jt_render(t, v, builder->buffer + builder->size, room - 1);
+        if (n >= 0) {
+            break;
+        }
+        if (ensure_capacity(builder, room) < 0) {
+            return -1;
+        }
+    }
+
+    builder->size += (size_t)n;
+    builder->buffer[builder->size] = '\0';
+    builder->is_first = 0;
+
+    return 0;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'flush_window'");
+#endif
+static int
+flush_window(JsonBuilder *builder)
+{
+    size_t len = builder->size;
+    int rc;
+
+    if (len == 0) {
+        return 0;
+    }
+
+    // the window starts over whatever the sink made of it
+    builder->size = 0;
+    builder->flushed += len;
+    rc = builder->flush(builder->flush_ctx, builder->buffer, len);
+    builder->buffer[0] = '\0';
+
+    return rc < 0 ? -1 : 0;
+}
+
+#ifdef __MVS__
 __asm__("\n&FUNC    SETC 'ensure_capacity'");
+#endif
 static int 
 ensure_capacity(JsonBuilder *builder, size_t needed) 
 {
+    // streaming: a full window goes out before it would grow. Only a
+    // single piece larger than the whole window grows it.
+    if (builder->flush && builder->size + needed >= builder->capacity) {
+        if (flush_window(builder) < 0) {
+            return -1;
+        }
+    }
+
     if (builder->size + needed >= builder->capacity) {
         size_t new_capacity = builder->capacity * JSON_GROWTH_FACTOR;
         if (new_capacity < builder->size + needed) {
             new_capacity = builder->size + needed + JSON_INITIAL_BUFFER_SIZE;
         }
         
-        char *new_buffer = realloc(builder->buffer, new_capacity);
+        char *new_buffer;
+        if (builder->arena) {
+            new_buffer = arena_realloc(builder->arena, builder->buffer,
+                                       builder->capacity, new_capacity);
+        } else {
+            new_buffer = realloc(builder->buffer, new_capacity);
+        }
         if (!new_buffer) {
 			return -1;
 		}
@@ -372,7 +574,9 @@ ensure_capacity(JsonBuilder *builder, size_t needed)
 	return 0;
 }
 
+#ifdef __MVS__
 __asm__("\n&FUNC    SETC 'append_string'");
+#endif
 static int 
 append_string(JsonBuilder *builder, const char *str) 
 {
@@ -0,0 +1,212 @@
+/*
+ * jsontmpl.c - render one list item from its template.
+ *
+ * See include/jsontmpl.h for the ops and why the list items are rendered
+ * this way.
+ *
+ * Portable C on purpose: no httpd headers, no MVS services, no statics. The
+ * host test #includes it (test/host/tstjtmp.c) so the renderer it drives is
+ * the one that runs on MVS, not a copy of it.
+ */
+
+#include <string.h>
+
+#include "jsontmpl.h"
+
+/* Room check: every write below goes through it first. */
+#define JT_ROOM(o, k)   ((size_t) (k) <= size - (o))
+
+/* u in decimal, at least `width` digits. Returns the length, or 0 when it
+   does not fit -- a number always has a digit. */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'jt_uint'");
+#endif
+static size_t
+jt_uint(char *out, size_t room, unsigned u, unsigned width)
+{
+	char digits[10];
+	size_t k = 0;
+	size_t len;
+	size_t i;
+
+	do {
+		digits[k++] = (char) ('0' + u % 10);
+		u /= 10;
+	} while (u);
+
+	len = k < width ? width : k;
+	if (len > room) {
+		return 0;
+	}
+	for (i = 0; i < len - k; i++) {
+		out[i] = '0';
+	}
+	while (k) {
+		out[i++] = digits[--k];
+	}
+	return len;
+}
+
+/* u as three fields of two decimal digits below a leading one:
+   yyyymmdd or hhmmss. */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'jt_triple'");
+#endif
+static size_t
+jt_triple(char *out, size_t room, unsigned u, char sep, unsigned width)
+{
+	size_t o;
+	unsigned lo = u % 100;
+	unsigned mid = (u / 100) % 100;
+
+	o = jt_uint(out, room, u / 10000, width);
+	if (o == 0 || room - o < 6) {
+		return 0;
+	}
+	out[o++] = sep;
+	out[o++] = (char) ('0' + mid / 10);
+	out[o++] = (char) ('0' + mid % 10);
+	out[o++] = sep;
+	out[o++] = (char) ('0' + lo / 10);
+	out[o++] = (char) ('0' + lo % 10);
+	return o;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'jt_render'");
+#endif
+int
+jt_render(const JT_OP *t, const JT_VAL *v, char *out, size_t size)
+{
+	size_t o = 0;
+	size_t k;
+	const char *s;
+
+	for (; t->op != JTO_END; t++) {
+		switch (t->op) {
+		case JTO_LIT:
+			if (!JT_ROOM(o, t->n)) {
+				return -1;
+			}
+			memcpy(out + o, t->lit, t->n);
+			o += t->n;
+			break;
+
+		case JTO_STR:
+		case JTO_FIX:
+		case JTO_RAW:
+			s = v[t->n].s;
+			if (!s && t->op != JTO_RAW) {
+				if (!JT_ROOM(o, 4)) {
+					return -1;
+				}
+				memcpy(out + o, "null", 4);
+				o += 4;
+				break;
+			}
+			if (!s) {
+				break;
+			}
+			if (t->op == JTO_FIX) {
+				for (k = 0; k < t->arg && s[k]; k++)
+					;
+			} else {
+				k = strlen(s);
+			}
+			if (t->op == JTO_RAW) {
+				if (!JT_ROOM(o, k)) {
+					return -1;
+				}
+				memcpy(out + o, s, k);
+				o += k;
+				break;
+			}
+			if (!JT_ROOM(o, k + 2)) {
+				return -1;
+			}
+			out[o++] = '"';
+			memcpy(out + o, s, k);
+			o += k;
+			out[o++] = '"';
+			break;
+
+		case JTO_ESC:
+			s = v[t->n].s;
+			if (!s) {
+				if (!JT_ROOM(o, 4)) {
+					return -1;
+				}
+				memcpy(out + o, "null", 4);
+				o += 4;
+				break;
+			}
+			if (!JT_ROOM(o, 1)) {
+				return -1;
+			}
+			out[o++] = '"';
+			for (; *s; s++) {
+				char e;
+
+				switch (*s) {
+				case '"':  e = '"';  break;
+				case '\\': e = '\\'; break;
+				case '\r': e = 'r';  break;
+				case '\n': e = 'n';  break;
+				case '\t': e = 't';  break;
+				default:   e = 0;    break;
+				}
+				if (!JT_ROOM(o, e ? 2 : 1)) {
+					return -1;
+				}
+				if (e) {
+					out[o++] = '\\';
+					out[o++] = e;
+				} else {
+					out[o++] = *s;
+				}
+			}
+			if (!JT_ROOM(o, 1)) {
+				return -1;
+			}
+			out[o++] = '"';
+			break;
+
+		case JTO_UINT:
+			k = jt_uint(out + o, size - o, v[t->n].u, t->arg);
+			if (k == 0) {
+				return -1;
+			}
+			o += k;
+			break;
+
+		case JTO_DATE:
+			k = jt_triple(out + o, size - o, v[t->n].u, (char) t->arg, 0);
+			if (k == 0) {
+				return -1;
+			}
+			o += k;
+			break;
+
+		case JTO_TIME:
+			k = jt_triple(out + o, size - o, v[t->n].u, ':', 2);
+			if (k == 0) {
+				return -1;
+			}
+			o += k;
+			break;
+
+		case JTO_IF:
+			if (!v[t->n].u) {
+				for (k = t->arg; k > 0 && t[1].op != JTO_END; k--) {
+					t++;
+				}
+			}
+			break;
+
+		default:
+			return -1;
+		}
+	}
+
+	return (int) o;
+}
@@ -0,0 +1,360 @@
+/*
+ * lastmod.c - Last-Modified and If-Modified-Since from MVS and UFS metadata.
+ *
+ * See include/lastmod.h for where the dates come from and why a date whose
+ * span is not over is withheld. Portable C on purpose: no httpd headers, no
+ * MVS services, no statics. The host test #includes it (test/host/tstlmod.c)
+ * so the conversions it drives are the ones that run on MVS, not a copy.
+ *
+ * The calendar is the proleptic Gregorian one, counted in days from 1970 --
+ * no mktime(), which would apply the task's timezone, and no gmtime(), whose
+ * time_t MVS does not share with time64_t (see format_exec_time() in
+ * jobsapi.c).
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "lastmod.h"
+
+#define LM_DAY  86400UL
+
+static const char *const lm_wday[7] = {
+	"Thu", "Fri", "Sat", "Sun", "Mon", "Tue", "Wed"    /* 1970-01-01 on */
+};
+
+static const char *const lm_mon[12] = {
+	"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+	"Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+/* Days before each month, in a common year */
+static const int lm_before[12] = {
+	0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334
+};
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'lm_leap'");
+#endif
+static int
+lm_leap(int year)
+{
+	return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+/* Leap days in the years before `year`, from year 1 */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'lm_leaps'");
+#endif
+static long
+lm_leaps(int year)
+{
+	year--;
+	return year / 4 - year / 100 + year / 400;
+}
+
+/* A packed-decimal byte as its two digits, or -1 */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'lm_bcd'");
+#endif
+static int
+lm_bcd(unsigned char b)
+{
+	if ((b >> 4) > 9 || (b & 0x0F) > 9) {
+		return -1;
+	}
+	return (b >> 4) * 10 + (b & 0x0F);
+}
+
+/* Local seconds `t` as UTC, by tzadjust; 0 when that leaves the range */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'lm_adjust'");
+#endif
+static unsigned long
+lm_adjust(unsigned long t, long tzadjust)
+{
+	if (tzadjust < 0) {
+		unsigned long back = (unsigned long) -tzadjust;
+
+		return t > back ? t - back : 0;
+	}
+	return t + (unsigned long) tzadjust >= t ? t + (unsigned long) tzadjust
+		: 0;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'lm_yday'");
+#endif
+int
+lm_yday(int year, int mon, int mday)
+{
+	static const int days[12] = {
+		31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+	};
+
+	if (mon < 1 || mon > 12 || mday < 1 || mday > days[mon - 1]) {
+		return 0;
+	}
+	if (mon == 2 && mday == 29 && !lm_leap(year)) {
+		return 0;
+	}
+	return lm_before[mon - 1] + mday + (mon > 2 && lm_leap(year));
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'lm_time'");
+#endif
+unsigned long
+lm_time(int year, int yday, int hour, int min, int sec)
+{
+	unsigned long days;
+
+	if (year < 1970 || year > 2105 || yday < 1
+	    || yday > 365 + lm_leap(year) || hour < 0 || hour > 23
+	    || min < 0 || min > 59 || sec < 0 || sec > 60) {
+		return 0;
+	}
+
+	days = (unsigned long) (365L * (year - 1970)
+		+ lm_leaps(year) - lm_leaps(1970) + yday - 1);
+	return days * LM_DAY + (unsigned long) (hour * 3600L + min * 60L + sec);
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'lm_ispf'");
+#endif
+int
+lm_ispf(const unsigned char *udata, size_t len, long tzadjust,
+    unsigned long now, unsigned long *t)
+{
+	int cent;
+	int yy;
+	int ddd;
+	int hh;
+	int mm;
+	int ss;
+	unsigned long end;
+
+	if (!udata || len < 30) {
+		return -1;
+	}
+
+	/* 0c yy dd dF: c the century, 0 for 19xx and 1 for 20xx */
+	cent = lm_bcd(udata[8]);
+	yy = lm_bcd(udata[9]);
+	ddd = lm_bcd(udata[10]);
+	hh = lm_bcd(udata[12]);
+	mm = lm_bcd(udata[13]);
+	ss = lm_bcd(udata[3]);
+	if (cent < 0 || cent > 1 || yy < 0 || ddd < 0 || (udata[11] >> 4) > 9
+	    || hh < 0 || mm < 0 || ss < 0) {
+		return -1;
+	}
+	ddd = ddd * 10 + (udata[11] >> 4);
+
+	/* an editor that keeps no seconds leaves them 0: the minute is the
+	   span then, and the stamp its last second */
+	end = lm_time(1900 + cent * 100 + yy, ddd, hh, mm, ss ? ss : 59);
+	end = lm_adjust(end, tzadjust);
+	if (end == 0 || end >= now) {
+		return -1;
+	}
+	*t = end;
+	return 0;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'lm_format'");
+#endif
+int
+lm_format(unsigned long t, char *out, size_t outlen)
+{
+	unsigned long days = t / LM_DAY;
+	unsigned long secs = t % LM_DAY;
+	int year = 1970;
+	int yday;
+	int mon;
+
+	if (outlen < LASTMOD_SIZE) {
+		return -1;
+	}
+
+	for (;;) {
+		unsigned long n = 365UL + lm_leap(year);
+
+		if (days < n) {
+			break;
+		}
+		days -= n;
+		year++;
+	}
+	yday = (int) days;      /* from 0 */
+	for (mon = 11; mon > 0; mon--) {
+		if (yday >= lm_before[mon] + (mon > 1 && lm_leap(year))) {
+			break;
+		}
+	}
+	yday -= lm_before[mon] + (mon > 1 && lm_leap(year));
+
+	snprintf(out, outlen, "%s, %02d %s %04d %02lu:%02lu:%02lu GMT",
+		lm_wday[(t / LM_DAY) % 7], yday + 1, lm_mon[mon], year,
+		secs / 3600, secs / 60 % 60, secs % 60);
+	return 0;
+}
+
+/* Exactly n digits at *p, moved past; -1 if they are not there */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'lm_num'");
+#endif
+static int
+lm_num(const char **p, int n)
+{
+	int v = 0;
+
+	while (n-- > 0) {
+		if (!isdigit((unsigned char) **p)) {
+			return -1;
+		}
+		v = v * 10 + (**p - '0');
+		(*p)++;
+	}
+	return v;
+}
+
+/* A month's abbreviation at *p, moved past: 1 to 12, or 0 */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'lm_month'");
+#endif
+static int
+lm_month(const char **p)
+{
+	int i;
+
+	for (i = 0; i < 12; i++) {
+		if (strncmp(*p, lm_mon[i], 3) == 0) {
+			*p += 3;
+			return i + 1;
+		}
+	}
+	return 0;
+}
+
+/* "hh:mm:ss" at *p, moved past: 0, or -1 if it is not there */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'lm_clock'");
+#endif
+static int
+lm_clock(const char **p, int *h, int *m, int *s)
+{
+	if ((*h = lm_num(p, 2)) < 0 || *(*p)++ != ':'
+	    || (*m = lm_num(p, 2)) < 0 || *(*p)++ != ':'
+	    || (*s = lm_num(p, 2)) < 0) {
+		return -1;
+	}
+	return 0;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'lm_parse'");
+#endif
+int
+lm_parse(const char *s, unsigned long *t)
+{
+	int year;
+	int mon;
+	int mday;
+	int h;
+	int m;
+	int sec;
+	int yday;
+
+	if (!s) {
+		return -1;
+	}
+	while (*s == ' ' || *s == '\t') {
+		s++;
+	}
+	while (isalpha((unsigned char) *s)) {
+		s++;            /* the day of the week: not checked */
+	}
+
+	if (*s == ',') {
+		if (*++s != ' ') {
+			return -1;
+		}
+		s++;
+		if ((mday = lm_num(&s, 2)) < 0) {
+			return -1;
+		}
+		if (*s == ' ') {
+			/* IMF-fixdate: "06 Nov 1994 08:49:37 GMT" */
+			s++;
+			if (!(mon = lm_month(&s)) || *s++ != ' '
+			    || (year = lm_num(&s, 4)) < 0) {
+				return -1;
+			}
+		} else if (*s == '-') {
+			/* RFC 850: "06-Nov-94 08:49:37 GMT"; a two-digit year
+			   that would be ahead of 2069 is taken as the 1900s */
+			s++;
+			if (!(mon = lm_month(&s)) || *s++ != '-'
+			    || (year = lm_num(&s, 2)) < 0) {
+				return -1;
+			}
+			year += year < 70 ? 2000 : 1900;
+		} else {
+			return -1;
+		}
+		if (*s++ != ' ' || lm_clock(&s, &h, &m, &sec) < 0
+		    || strncmp(s, " GMT", 4) != 0) {
+			return -1;
+		}
+		s += 4;
+	} else if (*s == ' ') {
+		/* asctime: "Nov  6 08:49:37 1994" */
+		s++;
+		if (!(mon = lm_month(&s)) || *s++ != ' ') {
+			return -1;
+		}
+		if (*s == ' ') {
+			s++;
+			mday = lm_num(&s, 1);
+		} else {
+			mday = lm_num(&s, 2);
+		}
+		if (mday < 0 || *s++ != ' ' || lm_clock(&s, &h, &m, &sec) < 0
+		    || *s++ != ' ' || (year = lm_num(&s, 4)) < 0) {
+			return -1;
+		}
+	} else {
+		return -1;
+	}
+
+	while (*s == ' ' || *s == '\t') {
+		s++;
+	}
+	if (*s != '\0') {
+		return -1;
+	}
+
+	yday = lm_yday(year, mon, mday);
+	if (yday == 0 || (*t = lm_time(year, yday, h, m, sec)) == 0) {
+		return -1;
+	}
+	return 0;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'lm_unmodified'");
+#endif
+int
+lm_unmodified(unsigned long t, const char *since, unsigned long now)
+{
+	unsigned long when;
+
+	if (!since || lm_parse(since, &when) != 0 || when > now) {
+		return 0;
+	}
+	return t <= when;
+}
@@ -0,0 +1,99 @@
+/*
+ * listitem.c - the JSON templates of the list items, as compile-time data.
+ *
+ * See include/listitem.h for which handler fills which, and
+ * include/jsontmpl.h for the ops. Every literal here is a piece of a format
+ * string that used to be parsed once per item; keep them byte for byte --
+ * test/host/tstjtmp.c renders each template next to the printf path it
+ * replaced and compares.
+ */
+
+#include <stddef.h>
+
+#include "listitem.h"
+
+static const JT_OP dataset_item[] = {
+	JT_RAW(DSI_SEP),
+	JT_LIT("{\n      \"dsname\": "),        JT_FIX(DSI_DSNAME, 44),
+	JT_LIT(",\n      \"blksz\": \""),       JT_UINT(DSI_BLKSZ, 0),
+	JT_LIT("\",\n      \"catnm\": \"\",\n      \"cdate\": \""),
+	JT_DATE(DSI_CDATE, '/'),
+	JT_LIT("\",\n      \"dev\": "),         JT_FIX(DSI_DEV, 4),
+	JT_LIT(",\n      \"dsntp\": "),         JT_STR(DSI_DSNTP),
+	JT_LIT(",\n      \"dsorg\": "),         JT_FIX(DSI_DSORG, 4),
+	JT_LIT(",\n      \"edate\": \"***None***\",\n      \"extx\": \""),
+	JT_UINT(DSI_EXTX, 0),
+	JT_LIT("\",\n      \"lrecl\": \""),     JT_UINT(DSI_LRECL, 0),
+	JT_LIT("\",\n      \"migr\": \"NO\",\n      \"mvol\": \"N\",\n"
+	       "      \"ovf\": \"NO\",\n      \"rdate\": \""),
+	JT_DATE(DSI_RDATE, '/'),
+	JT_LIT("\",\n      \"recfm\": "),       JT_FIX(DSI_RECFM, 4),
+	JT_LIT(",\n      \"sizex\": \""),       JT_UINT(DSI_SIZEX, 0),
+	JT_LIT("\",\n      \"spacu\": "),       JT_STR(DSI_SPACU),
+	JT_LIT(",\n      \"used\": \""),        JT_UINT(DSI_USED, 0),
+	JT_LIT("\",\n      \"vol\": "),         JT_FIX(DSI_VOL, 6),
+	JT_LIT(",\n      \"vols\": "),          JT_FIX(DSI_VOL, 6),
+	JT_LIT("\n    }\n"),
+	JT_END
+};
+
+static const JT_OP member_item[] = {
+	JT_RAW(MBI_SEP),
+	JT_LIT("{\n      \"member\": "),        JT_STR(MBI_MEMBER),
+	JT_LIT("\n    }\n"),
+	JT_END
+};
+
+static const JT_OP uss_item[] = {
+	JT_RAW(USI_SEP),
+	JT_LIT("{\n      \"name\": "),          JT_STR(USI_NAME),
+	JT_LIT(",\n      \"mode\": "),          JT_STR(USI_MODE),
+	JT_LIT(",\n      \"size\": "),          JT_UINT(USI_SIZE, 0),
+	JT_LIT(",\n      \"user\": "),          JT_STR(USI_USER),
+	JT_LIT(",\n      \"group\": "),         JT_STR(USI_GROUP),
+	JT_LIT(",\n      \"links\": "),         JT_UINT(USI_LINKS, 0),
+	JT_LIT(",\n      \"mtime\": \""),       JT_DATE(USI_MDATE, '-'),
+	JT_LIT("T"),                            JT_TIME(USI_MTIME),
+	JT_LIT("Z\",\n      \"inode\": "),      JT_UINT(USI_INODE, 0),
+	JT_LIT("\n    }\n"),
+	JT_END
+};
+
+static const JT_OP job_item[] = {
+	JT_LIT("{\"subsystem\":\"JES2\",\"jobname\":"), JT_STR(JBI_JOBNAME),
+	JT_LIT(",\"jobid\":"),                  JT_STR(JBI_JOBID),
+	JT_LIT(",\"owner\":"),                  JT_STR(JBI_OWNER),
+	JT_LIT(",\"type\":"),                   JT_FIX(JBI_JOBID, 3),
+	JT_LIT(",\"class\":"),                  JT_FIX(JBI_CLASS, 3),
+	JT_LIT(",\"url\":\""),                  JT_RAW(JBI_SCHEME),
+	JT_LIT("://"),                          JT_RAW(JBI_HOST),
+	JT_LIT("/zosmf/restjobs/jobs/"),        JT_RAW(JBI_JOBNAME),
+	JT_LIT("/"),                            JT_RAW(JBI_JOBID),
+	JT_LIT("\",\"files-url\":\""),          JT_RAW(JBI_SCHEME),
+	JT_LIT("://"),                          JT_RAW(JBI_HOST),
+	JT_LIT("/zosmf/restjobs/jobs/"),        JT_RAW(JBI_JOBNAME),
+	JT_LIT("/"),                            JT_RAW(JBI_JOBID),
+	JT_LIT("/files\",\"status\":"),         JT_STR(JBI_STATUS),
+	JT_LIT(",\"retcode\":"),                JT_STR(JBI_RETCODE),
+	JT_IF(JBI_EXEC, 4),
+	JT_LIT(",\"exec-started\":"),           JT_STR(JBI_STARTED),
+	JT_LIT(",\"exec-ended\":"),             JT_STR(JBI_ENDED),
+	JT_LIT("}"),
+	JT_END
+};
+
+static const JT_OP *const list_templates[LIST_COUNT] = {
+	[LIST_DATASET]  = dataset_item,
+	[LIST_MEMBER]   = member_item,
+	[LIST_USS]      = uss_item,
+	[LIST_JOB]      = job_item,
+};
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'list_template'");
+#endif
+const JT_OP *
+list_template(int list)
+{
+	return (list >= 0 && list < LIST_COUNT) ? list_templates[list] : NULL;
+}
@@ -0,0 +1,357 @@
+/*
+ * metrics.c - per-route counters and latency histograms, and their two
+ * renderings.
+ *
+ * See include/metrics.h for the block layout and where it lives.
+ *
+ * Portable C on purpose: no httpd headers, no MVS services, no statics. The
+ * host test #includes it (test/host/tstmetr.c) so the recorder and the
+ * renderers it drives are the ones that run on MVS, not copies of them.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "metrics.h"
+
+/* HttpMethod names, for route labels */
+static const char *const met_methods[] = {
+	"GET", "POST", "PUT", "DELETE", "HEAD", "OPTIONS", "PATCH"
+};
+
+static const char *const met_classes[5] = {
+	"1xx", "2xx", "3xx", "4xx", "5xx"
+};
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'metrics_init'");
+#endif
+void
+metrics_init(MVSMF_METRICS *m, unsigned since)
+{
+	memset(m, 0, sizeof(*m));
+	memcpy(m->eye, MET_EYE, sizeof(m->eye));
+	m->len = (unsigned short) sizeof(*m);
+	m->ver = MET_VERSION;
+	m->since = since;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'metrics_valid'");
+#endif
+int
+metrics_valid(const MVSMF_METRICS *m)
+{
+	return m && memcmp(m->eye, MET_EYE, sizeof(m->eye)) == 0 &&
+		m->len == sizeof(*m) && m->ver == MET_VERSION;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'metrics_slot'");
+#endif
+int
+metrics_slot(int route)
+{
+	return (route >= 0 && route < MET_UNMATCHED) ? route : MET_UNMATCHED;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'metrics_bucket'");
+#endif
+int
+metrics_bucket(unsigned usec)
+{
+	int b = 0;
+
+	while (usec > 1 && b < MET_BUCKETS - 1) {
+		usec >>= 1;
+		b++;
+	}
+	return b;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'metrics_record'");
+#endif
+void
+metrics_record(MVSMF_METRICS *m, int slot, int status, double bytes_in,
+	double bytes_out, unsigned usec)
+{
+	MET_ROUTE *r;
+
+	if (!m || slot < 0 || slot >= MET_SLOTS) {
+		return;
+	}
+	r = &m->route[slot];
+
+	r->count++;
+	if (status >= 100 && status < 600) {
+		r->status[status / 100 - 1]++;
+	}
+	r->hist[metrics_bucket(usec)]++;
+	r->usec_sum += usec;
+	if (usec > r->usec_max) {
+		r->usec_max = usec;
+	}
+	r->bytes_in += bytes_in;
+	r->bytes_out += bytes_out;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'metrics_size'");
+#endif
+void
+metrics_size(MET_ROUTE *r, unsigned size)
+{
+	if (!r) {
+		return;
+	}
+	if (size >= r->json_hint) {
+		r->json_hint = size;
+	} else {
+		r->json_hint -= (r->json_hint - size) / 32;
+	}
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'metrics_presize'");
+#endif
+unsigned
+metrics_presize(const MET_ROUTE *r)
+{
+	unsigned hint;
+
+	if (!r || (hint = r->json_hint) == 0) {
+		return 0;
+	}
+	if (hint >= MET_PRESIZE_MAX - MET_PRESIZE_MAX / 8) {
+		return MET_PRESIZE_MAX;
+	}
+	/* the builder grows when size + needed reaches capacity, so the slack
+	   also covers the last piece and its terminator */
+	return hint + hint / 8;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'metrics_quantile'");
+#endif
+unsigned
+metrics_quantile(const MET_ROUTE *r, unsigned permille)
+{
+	unsigned total = 0;
+	unsigned seen = 0;
+	unsigned rank;
+	int i;
+
+	for (i = 0; i < MET_BUCKETS; i++) {
+		total += r->hist[i];
+	}
+	if (total == 0) {
+		return 0;
+	}
+
+	/* the smallest rank that covers permille of the requests, 1-based:
+	   ceil(total * permille / 1000), in integers */
+	rank = (unsigned) (((double) total * permille + 999) / 1000);
+	if (rank == 0) {
+		rank = 1;
+	}
+
+	for (i = 0; i < MET_BUCKETS - 1; i++) {
+		seen += r->hist[i];
+		if (seen >= rank) {
+			return 2u << i;
+		}
+	}
+
+	/* the open bucket has no upper bound; the maximum is the honest one */
+	return r->usec_max;
+}
+
+/* "GET /zosmf/restfiles/ds/{dataset-name}", or "(none)" */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'met_label'");
+#endif
+static void
+met_label(const ROUTETAB *tab, int slot, char *buf, size_t size)
+{
+	const RTDEF *def;
+
+	if (slot == MET_UNMATCHED || !tab || slot >= tab->count) {
+		snprintf(buf, size, "(none)");
+		return;
+	}
+
+	def = &tab->defs[slot];
+	snprintf(buf, size, "%s %s",
+		(unsigned) def->method < sizeof(met_methods) / sizeof(met_methods[0])
+			? met_methods[def->method] : "?",
+		def->pattern);
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'metrics_render_json'");
+#endif
+int
+metrics_render_json(const MVSMF_METRICS *m, const ROUTETAB *tab,
+	MET_EMIT emit, void *ctx)
+{
+	char label[128];
+	char line[512];
+	const MET_ROUTE *r;
+	int first = 1;
+	int slot;
+	int i;
+	int rc;
+
+	snprintf(line, sizeof(line), "{\"since\":%u,\"routes\":[", m->since);
+	if ((rc = emit(ctx, line)) < 0) return rc;
+
+	for (slot = 0; slot < MET_SLOTS; slot++) {
+		r = &m->route[slot];
+		if (r->count == 0) {
+			continue;
+		}
+		met_label(tab, slot, label, sizeof(label));
+
+		snprintf(line, sizeof(line),
+			"%s{\"route\":\"%s\",\"count\":%u,\"status\":{",
+			first ? "" : ",", label, r->count);
+		if ((rc = emit(ctx, line)) < 0) return rc;
+		first = 0;
+
+		for (i = 0; i < 5; i++) {
+			snprintf(line, sizeof(line), "%s\"%s\":%u",
+				i ? "," : "", met_classes[i], r->status[i]);
+			if ((rc = emit(ctx, line)) < 0) return rc;
+		}
+
+		snprintf(line, sizeof(line),
+			"},\"bytesIn\":%.0f,\"bytesOut\":%.0f,"
+			"\"latencyUs\":{\"sum\":%.0f,\"max\":%u,"
+			"\"p50\":%u,\"p90\":%u,\"p99\":%u},\"histogram\":[",
+			r->bytes_in, r->bytes_out, r->usec_sum, r->usec_max,
+			metrics_quantile(r, 500), metrics_quantile(r, 900),
+			metrics_quantile(r, 990));
+		if ((rc = emit(ctx, line)) < 0) return rc;
+
+		for (i = 0; i < MET_BUCKETS; i++) {
+			snprintf(line, sizeof(line), "%s%u", i ? "," : "", r->hist[i]);
+			if ((rc = emit(ctx, line)) < 0) return rc;
+		}
+
+		if ((rc = emit(ctx, "]}")) < 0) return rc;
+	}
+
+	return emit(ctx, "]}\n") < 0 ? -1 : 0;
+}
+
+/* One family header: # HELP and # TYPE. */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'met_family'");
+#endif
+static int
+met_family(MET_EMIT emit, void *ctx, const char *name, const char *type,
+	const char *help)
+{
+	char line[512];
+
+	snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n",
+		name, help, name, type);
+	return emit(ctx, line);
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'metrics_render_prom'");
+#endif
+int
+metrics_render_prom(const MVSMF_METRICS *m, const ROUTETAB *tab,
+	MET_EMIT emit, void *ctx)
+{
+	char label[128];
+	char line[512];
+	const MET_ROUTE *r;
+	unsigned cum;
+	int slot;
+	int i;
+	int rc;
+
+	/* Families are emitted one after the other, each over every slot:
+	   the format wants all samples of a family together. */
+	if ((rc = met_family(emit, ctx, "mvsmf_requests_total", "counter",
+			"Requests answered, by route and status class.")) < 0)
+		return rc;
+	for (slot = 0; slot < MET_SLOTS; slot++) {
+		r = &m->route[slot];
+		if (r->count == 0) continue;
+		met_label(tab, slot, label, sizeof(label));
+		for (i = 0; i < 5; i++) {
+			if (r->status[i] == 0) continue;
+			snprintf(line, sizeof(line),
+				"mvsmf_requests_total{route=\"%s\",code=\"%s\"} %u\n",
+				label, met_classes[i], r->status[i]);
+			if ((rc = emit(ctx, line)) < 0) return rc;
+		}
+	}
+
+	if ((rc = met_family(emit, ctx, "mvsmf_received_bytes_total", "counter",
+			"Request body bytes received, by route.")) < 0)
+		return rc;
+	for (slot = 0; slot < MET_SLOTS; slot++) {
+		r = &m->route[slot];
+		if (r->count == 0) continue;
+		met_label(tab, slot, label, sizeof(label));
+		snprintf(line, sizeof(line),
+			"mvsmf_received_bytes_total{route=\"%s\"} %.0f\n",
+			label, r->bytes_in);
+		if ((rc = emit(ctx, line)) < 0) return rc;
+	}
+
+	if ((rc = met_family(emit, ctx, "mvsmf_sent_bytes_total", "counter",
+			"Response body bytes sent, by route.")) < 0)
+		return rc;
+	for (slot = 0; slot < MET_SLOTS; slot++) {
+		r = &m->route[slot];
+		if (r->count == 0) continue;
+		met_label(tab, slot, label, sizeof(label));
+		snprintf(line, sizeof(line),
+			"mvsmf_sent_bytes_total{route=\"%s\"} %.0f\n",
+			label, r->bytes_out);
+		if ((rc = emit(ctx, line)) < 0) return rc;
+	}
+
+	if ((rc = met_family(emit, ctx, "mvsmf_request_duration_seconds",
+			"histogram", "Request latency, by route.")) < 0)
+		return rc;
+	for (slot = 0; slot < MET_SLOTS; slot++) {
+		r = &m->route[slot];
+		if (r->count == 0) continue;
+		met_label(tab, slot, label, sizeof(label));
+
+		/* Bucket i holds whole microseconds in [2^i, 2^(i+1)), and le
+		   is inclusive: its bound is 2^(i+1) - 1 us. */
+		cum = 0;
+		for (i = 0; i < MET_BUCKETS - 1; i++) {
+			cum += r->hist[i];
+			snprintf(line, sizeof(line),
+				"mvsmf_request_duration_seconds_bucket"
+				"{route=\"%s\",le=\"%.6f\"} %u\n",
+				label, (double) ((2u << i) - 1) / 1e6, cum);
+			if ((rc = emit(ctx, line)) < 0) return rc;
+		}
+		snprintf(line, sizeof(line),
+			"mvsmf_request_duration_seconds_bucket"
+			"{route=\"%s\",le=\"+Inf\"} %u\n", label, r->count);
+		if ((rc = emit(ctx, line)) < 0) return rc;
+		snprintf(line, sizeof(line),
+			"mvsmf_request_duration_seconds_sum{route=\"%s\"} %.6f\n",
+			label, r->usec_sum / 1e6);
+		if ((rc = emit(ctx, line)) < 0) return rc;
+		snprintf(line, sizeof(line),
+			"mvsmf_request_duration_seconds_count{route=\"%s\"} %u\n",
+			label, r->count);
+		if ((rc = emit(ctx, line)) < 0) return rc;
+	}
+
+	return 0;
+}
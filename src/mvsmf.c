@@ -19,6 +19,7 @@
 #include "authapi.h"
 #include "testapi.h"
 #include "router.h"
+#include "routes.h"
 
 /* C stack size for this module, read by libc370's @@crt0/@@crt1 through the
  * WXTRN @@STKLEN (issue #290).  Without it the startup takes the default:
@@ -61,8 +62,7 @@ int identity_middleware(Session *session)
 	 * shaped 401, and logout must run even once the token is gone. Let it
 	 * through here (the handler inspects httpc->cred itself via the HTTPX
 	 * auth export). */
-	char *path = (char *) http_get_env(session->httpc,
-	                                   (const UCHAR *) "REQUEST_PATH");
+	const char *path = session->req.env[RQE_REQUEST_PATH];
 	if (path && strcmp(path, "/zosmf/services/authenticate") == 0) {
 		return 0;
 	}
@@ -78,6 +78,55 @@ int identity_middleware(Session *session)
 	return 0;
 }
 
+/* The handler behind each route id. The routes themselves -- method,
+ * pattern and the trie dispatch walks -- are const data in routes.c; this is
+ * the one place that sees every API header, so the binding is made here.
+ * `static const`, like the table it indexes: nothing is built per request,
+ * and MVSMF is link-edited RENT. */
+static const RouteHandler route_handlers[ROUTE_COUNT] = {
+	[ROUTE_INFO]            = infoHandler,
+	[ROUTE_TEST]            = testHandler,
+	[ROUTE_TEST_WILDCARD]   = testWildcardHandler,
+
+	[ROUTE_AUTH_LOGIN]      = authLoginHandler,
+	[ROUTE_AUTH_LOGOUT]     = authLogoutHandler,
+
+	[ROUTE_JOB_LIST]        = jobListHandler,
+	[ROUTE_JOB_FILES]       = jobFilesHandler,
+	[ROUTE_JOB_RECORDS]     = jobRecordsHandler,
+	[ROUTE_JOB_SUBMIT]      = jobSubmitHandler,
+	[ROUTE_JOB_STATUS]      = jobStatusHandler,
+	[ROUTE_JOB_PURGE]       = jobPurgeHandler,
+
+	[ROUTE_DS_LIST]         = datasetListHandler,
+	[ROUTE_DS_GET]          = datasetGetHandler,
+	[ROUTE_DS_GET_VOL]      = datasetGetHandler,
+	[ROUTE_DS_PUT]          = datasetPutHandler,
+	[ROUTE_DS_PUT_VOL]      = datasetPutHandler,
+	[ROUTE_DS_CREATE]       = datasetCreateHandler,
+	[ROUTE_DS_DELETE]       = datasetDeleteHandler,
+	[ROUTE_DS_DELETE_VOL]   = datasetDeleteHandler,
+	[ROUTE_MBR_LIST]        = memberListHandler,
+	[ROUTE_MBR_LIST_VOL]    = memberListHandler,
+	[ROUTE_MBR_GET]         = memberGetHandler,
+	[ROUTE_MBR_GET_VOL]     = memberGetHandler,
+	[ROUTE_MBR_PUT]         = memberPutHandler,
+	[ROUTE_MBR_PUT_VOL]     = memberPutHandler,
+	[ROUTE_MBR_DELETE]      = memberDeleteHandler,
+	[ROUTE_MBR_DELETE_VOL]  = memberDeleteHandler,
+
+	[ROUTE_USS_LIST]        = ussListHandler,
+	[ROUTE_CONS_ISSUE]      = consoleIssueHandler,
+	[ROUTE_CONS_COLLECT]    = consoleCollectHandler,
+	[ROUTE_CONS_DETECT]     = consoleDetectHandler,
+	[ROUTE_CONS_LOG]        = consoleLogHandler,
+
+	[ROUTE_USS_GET]         = ussGetHandler,
+	[ROUTE_USS_PUT]         = ussPutHandler,
+	[ROUTE_USS_CREATE]      = ussCreateHandler,
+	[ROUTE_USS_DELETE]      = ussDeleteHandler,
+};
+
 int main(int argc, char **argv)
 {
 	int irc = 0;
@@ -116,7 +165,7 @@ int main(int argc, char **argv)
 	 * The original target, a local cgxstart.c, no longer exists -- the CGI
 	 * launcher comes from libhttpd now and is shared by every CGI, so mvsMF's
 	 * own router setup cannot move there. */
-	init_router(&router);
+	init_router(&router, mvsmf_routes(), route_handlers);
 	init_session(&session, &router, httpd, httpc);
 
 	add_middleware(&router, "Authentication", identity_middleware);
@@ -125,49 +174,6 @@ int main(int argc, char **argv)
 	add_middleware(&router, "Logging", logging_middleware);
 #endif
 
-	/* add the URL mappings */
-	add_route(&router, GET, "/zosmf/info", infoHandler);
-	add_route(&router, GET, "/zosmf/test", testHandler);
-	add_route(&router, GET, "/zosmf/test/wildcard/{*filepath}", testWildcardHandler);
-
-	add_route(&router, POST, "/zosmf/services/authenticate", authLoginHandler);
-	add_route(&router, DELETE, "/zosmf/services/authenticate", authLogoutHandler);
-
-	add_route(&router, GET, "/zosmf/restjobs/jobs", jobListHandler);
-	add_route(&router, GET, "/zosmf/restjobs/jobs/{job-name}/{jobid}/files", jobFilesHandler);
-	add_route(&router, GET, "/zosmf/restjobs/jobs/{job-name}/{jobid}/files/{ddid}/records", jobRecordsHandler);
-	add_route(&router, PUT, "/zosmf/restjobs/jobs", jobSubmitHandler);
-	add_route(&router, GET, "/zosmf/restjobs/jobs/{job-name}/{jobid}", jobStatusHandler);
-	add_route(&router, DELETE, "/zosmf/restjobs/jobs/{job-name}/{jobid}", jobPurgeHandler);
-
-	add_route(&router, GET, "/zosmf/restfiles/ds", datasetListHandler);
-	add_route(&router, GET, "/zosmf/restfiles/ds/{dataset-name}", datasetGetHandler);
-	add_route(&router, GET, "/zosmf/restfiles/ds/-({volume-serial})/{dataset-name}", datasetGetHandler);
-	add_route(&router, PUT, "/zosmf/restfiles/ds/{dataset-name}", datasetPutHandler);
-	add_route(&router, PUT, "/zosmf/restfiles/ds/-({volume-serial})/{dataset-name}", datasetPutHandler);
-	add_route(&router, POST, "/zosmf/restfiles/ds/{dataset-name}", datasetCreateHandler);
-	add_route(&router, DELETE, "/zosmf/restfiles/ds/{dataset-name}", datasetDeleteHandler);
-	add_route(&router, DELETE, "/zosmf/restfiles/ds/-({volume-serial})/{dataset-name}", datasetDeleteHandler);
-	add_route(&router, GET, "/zosmf/restfiles/ds/{dataset-name}/member", memberListHandler);
-	add_route(&router, GET, "/zosmf/restfiles/ds/-({volume-serial})/{dataset-name}/member", memberListHandler);
-	add_route(&router, GET, "/zosmf/restfiles/ds/{dataset-name}({member-name})", memberGetHandler);
-	add_route(&router, GET, "/zosmf/restfiles/ds/-({volume-serial})/{dataset-name}({member-name})", memberGetHandler);
-	add_route(&router, PUT, "/zosmf/restfiles/ds/{dataset-name}({member-name})", memberPutHandler);
-	add_route(&router, PUT, "/zosmf/restfiles/ds/-({volume-serial})/{dataset-name}({member-name})", memberPutHandler);
-	add_route(&router, DELETE, "/zosmf/restfiles/ds/{dataset-name}({member-name})", memberDeleteHandler);
-	add_route(&router, DELETE, "/zosmf/restfiles/ds/-({volume-serial})/{dataset-name}({member-name})", memberDeleteHandler);
-
-	add_route(&router, GET, "/zosmf/restfiles/fs", ussListHandler);
-	add_route(&router, PUT, "/zosmf/restconsoles/consoles/{console-name}", consoleIssueHandler);
-	add_route(&router, GET, "/zosmf/restconsoles/consoles/{console-name}/solmsgs/{cmd-response-key}", consoleCollectHandler);
-	add_route(&router, GET, "/zosmf/restconsoles/consoles/{console-name}/detections/{detection-key}", consoleDetectHandler);
-	add_route(&router, GET, "/zosmf/restconsoles/v1/log", consoleLogHandler);
-
-	add_route(&router, GET, "/zosmf/restfiles/fs/{*filepath}", ussGetHandler);
-	add_route(&router, PUT, "/zosmf/restfiles/fs/{*filepath}", ussPutHandler);
-	add_route(&router, POST, "/zosmf/restfiles/fs/{*filepath}", ussCreateHandler);
-	add_route(&router, DELETE, "/zosmf/restfiles/fs/{*filepath}", ussDeleteHandler);
-
 	/* dispatch the request */
 	irc = handle_request(&router, &session);
 
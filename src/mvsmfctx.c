@@ -4,6 +4,8 @@
 #include "clibos.h"     /* __getmsp */
 #include "cliblock.h"   /* lock / unlock, LOCK_EXC */
 #include "httpcgi.h"    /* HTTPD, HTTPX, http_get_httpx, http_cgictx_get */
+#include <stdlib.h>     /* getenv, atoi */
+#include <time.h>
 
 /*
  * Per-CGI persistent mvsMF context + lazy cursor store.
@@ -75,3 +77,118 @@ NT_STORE *mvsmf_kvstore(void *httpd)
 
 	return (NT_STORE *)ctx->kvstore;
 }
+
+__asm__("\n&FUNC	SETC 'mvsmf_metrics'");
+MVSMF_METRICS *mvsmf_metrics(void *httpd)
+{
+	MVSMF_CTX *ctx = mvsmf_ctx_get(httpd);
+	MVSMF_METRICS *m;
+
+	if (!ctx) {
+		return (MVSMF_METRICS *)0;
+	}
+
+	m = (MVSMF_METRICS *)ctx->metrics;
+	if (!metrics_valid(m)) {
+		/* Same lazy init as the cursor store, same subpool 0 pin (#223).
+		 *
+		 * A block that is there but not valid was anchored by an MVSMF of
+		 * another layout -- the context outlives the module, and a new
+		 * build can be dropped in while the server runs. It is replaced,
+		 * not reinitialised and not freed: a worker still running the old
+		 * module may be counting into it right now. The few KB are the
+		 * price of an upgrade without a restart. */
+		lock((void *)&ctx->metrics, LOCK_EXC);
+		if (ctx->len == 0) {
+			ctx->len = (unsigned short)sizeof(MVSMF_CTX);
+			ctx->ver = 1;
+		}
+		m = (MVSMF_METRICS *)ctx->metrics;
+		if (!metrics_valid(m)) {
+			m = (MVSMF_METRICS *)__getmsp(sizeof(MVSMF_METRICS), 0);
+			if (m) {
+				metrics_init(m, (unsigned)time((time_t *)0));
+				ctx->metrics = m;
+			}
+		}
+		unlock((void *)&ctx->metrics, LOCK_EXC);
+	}
+
+	return m;
+}
+
+__asm__("\n&FUNC	SETC 'mvsmf_etags'");
+ETAG_CACHE *mvsmf_etags(void *httpd)
+{
+	const char *v = getenv("MVSMF_ETAG_CACHE");
+	MVSMF_CTX *ctx;
+	ETAG_CACHE *c;
+
+	if (!v || atoi(v) <= 0) {
+		return (ETAG_CACHE *)0;
+	}
+
+	ctx = mvsmf_ctx_get(httpd);
+	if (!ctx) {
+		return (ETAG_CACHE *)0;
+	}
+
+	c = (ETAG_CACHE *)ctx->etags;
+	if (!etc_valid(c)) {
+		/* Same lazy init as the metrics, same subpool 0 pin (#223), and
+		 * the same answer to a block of another layout: replaced, not
+		 * freed, because an older module may be looking into it. */
+		lock((void *)&ctx->etags, LOCK_EXC);
+		if (ctx->len == 0) {
+			ctx->len = (unsigned short)sizeof(MVSMF_CTX);
+			ctx->ver = 1;
+		}
+		c = (ETAG_CACHE *)ctx->etags;
+		if (!etc_valid(c)) {
+			c = (ETAG_CACHE *)__getmsp(sizeof(ETAG_CACHE), 0);
+			if (c) {
+				etc_init(c);
+				ctx->etags = c;
+			}
+		}
+		unlock((void *)&ctx->etags, LOCK_EXC);
+	}
+
+	return c;
+}
+
+/* The latch is the block's own address, as for the metrics: a lookup is a
+ * walk of the slots and a few compares, no I/O, no SVC. */
+__asm__("\n&FUNC	SETC 'mvsmf_etag_get'");
+int mvsmf_etag_get(ETAG_CACHE *c, const char *key, const void *meta,
+                   size_t mlen, char *etag)
+{
+	int hit;
+
+	if (!c) {
+		return 0;
+	}
+
+	lock((void *)c, LOCK_EXC);
+	hit = etc_lookup(c, key, meta, mlen, etag);
+	unlock((void *)c, LOCK_EXC);
+
+	return hit;
+}
+
+__asm__("\n&FUNC	SETC 'mvsmf_etag_put'");
+void mvsmf_etag_put(ETAG_CACHE *c, const char *key, const void *meta,
+                    size_t mlen, const char *etag)
+{
+	if (!c) {
+		return;
+	}
+
+	lock((void *)c, LOCK_EXC);
+	if (etag) {
+		(void)etc_store(c, key, meta, mlen, etag);
+	} else {
+		etc_forget(c, key);
+	}
+	unlock((void *)c, LOCK_EXC);
+}
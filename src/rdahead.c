@@ -0,0 +1,120 @@
+/*
+ * rdahead.c - read-ahead: two block buffers between a reader and a sender.
+ *
+ * See include/rdahead.h for the hand-over and why it overlaps disk and
+ * network.
+ *
+ * Portable C on purpose: no httpd headers, no MVS services, no statics. The
+ * host test #includes it (test/host/tstrdah.c) so the schedule it drives is
+ * the one that runs on MVS, not a copy of it.
+ */
+
+#include <string.h>
+
+#include "rdahead.h"
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'rdahead_init'");
+#endif
+void
+rdahead_init(RDAHEAD *ra, unsigned char *buf0, unsigned char *buf1,
+	size_t size)
+{
+	memset(ra, 0, sizeof(*ra));
+	ra->slot[0].buf = buf0;
+	ra->slot[1].buf = buf1;
+	ra->size = size;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'rdahead_slot'");
+#endif
+int
+rdahead_slot(RDAHEAD *ra, unsigned char **buf)
+{
+	unsigned i = ra->fill;
+
+	if (ra->stop) {
+		return 0;
+	}
+	switch (ra->slot[i].state) {
+	case RDA_FREE:
+		*buf = ra->slot[i].buf;
+		return 1;
+	case RDA_FULL:
+		ra->reader_waits++;
+		return RDA_WAIT;
+	default:
+		/* the end or a failure is the last thing the reader gives */
+		return 0;
+	}
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'rdahead_filled'");
+#endif
+void
+rdahead_filled(RDAHEAD *ra, long n)
+{
+	unsigned i = ra->fill;
+
+	if (n > 0) {
+		ra->slot[i].len = (size_t) n;
+		ra->blocks++;
+		ra->fill = (i + 1) % RDAHEAD_NBUF;
+		ra->slot[i].state = RDA_FULL;
+		return;
+	}
+	ra->slot[i].len = 0;
+	ra->slot[i].state = n == 0 ? RDA_END : RDA_FAIL;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'rdahead_take'");
+#endif
+int
+rdahead_take(RDAHEAD *ra, const unsigned char **buf, size_t *len)
+{
+	unsigned i = ra->take;
+
+	switch (ra->slot[i].state) {
+	case RDA_FULL:
+		*buf = ra->slot[i].buf;
+		*len = ra->slot[i].len;
+		ra->held = 1;
+		return 1;
+	case RDA_END:
+		return 0;
+	case RDA_FAIL:
+		return -1;
+	default:
+		ra->sender_waits++;
+		return RDA_WAIT;
+	}
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'rdahead_release'");
+#endif
+int
+rdahead_release(RDAHEAD *ra)
+{
+	unsigned i = ra->take;
+
+	if (!ra->held) {
+		return 0;
+	}
+	ra->held = 0;
+	ra->take = (i + 1) % RDAHEAD_NBUF;
+	ra->slot[i].state = RDA_FREE;
+	return 1;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'rdahead_stop'");
+#endif
+void
+rdahead_stop(RDAHEAD *ra)
+{
+	ra->stop = 1;
+}
@@ -1,4 +1,5 @@
 #include <stddef.h>
+#include <string.h>
 
 #include "reclines.h"
 
@@ -77,6 +78,75 @@ recline_put(RECLINE *rl, char c, char **rec, size_t *rec_len)
 	return RECLINE_MORE;
 }
 
+#ifdef __MVS__
+__asm__("\n&FUNC	SETC 'recline_feed'");
+#endif
+int
+recline_feed(RECLINE *rl, const char *buf, size_t len, RECLINE_EMIT emit,
+	void *ctx)
+{
+	const char *p = buf;
+	const char *end = buf + len;
+	const char *eol;
+	const char *cr;
+	size_t run;
+	size_t room;
+	int rc;
+
+	while (p < end) {
+		/* the LF of a CRLF pair, as in recline_put() -- the CR may have
+		   been the last byte of the previous feed */
+		if (rl->pending_lf) {
+			rl->pending_lf = 0;
+			if (*p == ASCII_LF) {
+				p++;
+				continue;
+			}
+		}
+
+		/* the next terminator: the first LF, then a CR before it */
+		eol = memchr(p, ASCII_LF, (size_t) (end - p));
+		cr = memchr(p, ASCII_CR, (size_t) ((eol ? eol : end) - p));
+		if (cr) {
+			eol = cr;
+		}
+
+		/* the content up to it, in one copy; what does not fit is the
+		   overflow recline_put() drops a byte at a time */
+		run = (size_t) ((eol ? eol : end) - p);
+		room = rl->content_max - rl->len;
+		if (run > room) {
+			rl->truncated = 1;
+			memcpy(rl->buf + rl->len, p, room);
+			rl->len += room;
+		} else {
+			memcpy(rl->buf + rl->len, p, run);
+			rl->len += run;
+		}
+
+		if (!eol) {
+			break;
+		}
+
+		if (rl->len == 0) {
+			/* a blank line is a record of one blank (#233) */
+			rl->buf[0] = ASCII_BLANK;
+			rl->len = 1;
+		}
+		run = rl->len;
+		rl->len = 0;
+		if (*eol == ASCII_CR) {
+			rl->pending_lf = 1;
+		}
+		if ((rc = emit(ctx, rl->buf, run)) < 0) {
+			return rc;
+		}
+		p = eol + 1;
+	}
+
+	return 0;
+}
+
 #ifdef __MVS__
 __asm__("\n&FUNC	SETC 'recline_flush'");
 #endif
@@ -0,0 +1,130 @@
+/*
+ * recwrite.c - records gathered into a block-sized buffer.
+ *
+ * See include/recwrite.h for why the records are not flushed one by one.
+ *
+ * Portable C on purpose: no httpd headers, no MVS services, no statics. The
+ * host test #includes it (test/host/tstrecw.c) so the writer it drives is
+ * the one that runs on MVS, not a copy of it.
+ */
+
+#include <string.h>
+
+#include "recwrite.h"
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'recwrite_init'");
+#endif
+void
+recwrite_init(RECWRITE *rw, unsigned char *buf, size_t size, int nl,
+	RECWRITE_SINK sink, void *ctx)
+{
+	memset(rw, 0, sizeof(*rw));
+	rw->buf = buf;
+	rw->size = size;
+	rw->nl = nl;
+	rw->sink = sink;
+	rw->ctx = ctx;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'recwrite_flush'");
+#endif
+int
+recwrite_flush(RECWRITE *rw)
+{
+	size_t used = rw->used;
+
+	if (used == 0) {
+		return 0;
+	}
+	rw->used = 0;
+	rw->writes++;
+	return rw->sink(rw->ctx, rw->buf, used);
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'recwrite_stamp'");
+#endif
+void
+recwrite_stamp(RECWRITE *rw, size_t fixlen, int fill)
+{
+	etag_init(&rw->stamp);
+	rw->fixlen = fixlen;
+	rw->fill = fill;
+	rw->stamping = 1;
+}
+
+/* A record longer than a fixed LRECL is not padded, and is not the access
+   method's to keep either: the write fails or splits it, and the stamp is
+   then of a request that is answered as failed. */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'recwrite_note'");
+#endif
+void
+recwrite_note(RECWRITE *rw, const void *rec, size_t len)
+{
+	if (rw->stamping <= 0) {
+		return;
+	}
+	if (len >= rw->fixlen) {
+		etag_update(&rw->stamp, rec, len);
+	} else if (rw->fill != RECWRITE_NOFILL) {
+		etag_update_padded(&rw->stamp, rec, len, rw->fixlen, rw->fill);
+	} else {
+		rw->stamping = -1;
+	}
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'recwrite_etag'");
+#endif
+int
+recwrite_etag(const RECWRITE *rw, char *out, size_t outlen)
+{
+	if (rw->stamping <= 0) {
+		return -1;
+	}
+	return etag_final(&rw->stamp, out, outlen);
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'recwrite_put'");
+#endif
+int
+recwrite_put(RECWRITE *rw, const void *rec, size_t len)
+{
+	size_t need = len + (rw->nl != RECWRITE_NONL);
+
+	rw->records++;
+	recwrite_note(rw, rec, len);
+
+	if (need > rw->size - rw->used && recwrite_flush(rw) < 0) {
+		return -1;
+	}
+
+	if (need > rw->size) {
+		/* larger than the whole buffer -- a record over BLKSIZE, which the
+		   access method will refuse or split as it always did: straight
+		   through, and its delimiter after it */
+		unsigned char nl = (unsigned char) rw->nl;
+
+		rw->writes++;
+		if (rw->sink(rw->ctx, rec, len) < 0) {
+			return -1;
+		}
+		if (rw->nl != RECWRITE_NONL) {
+			rw->writes++;
+			return rw->sink(rw->ctx, &nl, 1);
+		}
+		return 0;
+	}
+
+	memcpy(rw->buf + rw->used, rec, len);
+	rw->used += len;
+	if (rw->nl != RECWRITE_NONL) {
+		rw->buf[rw->used++] = (unsigned char) rw->nl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,346 @@
+/*
+ * reqctx.c - filing the CGI environment into a RequestCtx.
+ *
+ * See include/reqctx.h for what the context holds and why it replaces the
+ * per-question http_get_env() walks.
+ *
+ * Portable C on purpose: no httpd headers, no MVS services, no statics. The
+ * host test #includes it (test/host/tstrctx.c) so the filing it drives is
+ * the one that runs on MVS, not a copy of it.
+ */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "reqctx.h"
+#include "etag.h"
+
+/* Name tables, in id order. The spelling is the one the handlers used to
+   pass to getHeaderParam(); comparison ignores case, so it is documentation
+   as much as key. */
+static const char *const rq_env_names[RQE_COUNT] = {
+	[RQE_REQUEST_METHOD]		= "REQUEST_METHOD",
+	[RQE_REQUEST_PATH]		= "REQUEST_PATH",
+	[RQE_POST_STRING]		= "POST_STRING",
+};
+
+static const char *const rq_hdr_names[RQH_COUNT] = {
+	[RQH_ACCEPT_ENCODING]		= "Accept-Encoding",
+	[RQH_AUTHORIZATION]		= "Authorization",
+	[RQH_CONTENT_ENCODING]		= "Content-Encoding",
+	[RQH_CONTENT_LENGTH]		= "Content-Length",
+	[RQH_CONTENT_TYPE]		= "Content-Type",
+	[RQH_HOST]			= "Host",
+	[RQH_IF_MATCH]			= "If-Match",
+	[RQH_IF_MODIFIED_SINCE]		= "If-Modified-Since",
+	[RQH_IF_NONE_MATCH]		= "If-None-Match",
+	[RQH_SEC_FETCH_MODE]		= "Sec-Fetch-Mode",
+	[RQH_TRANSFER_ENCODING]		= "Transfer-Encoding",
+	[RQH_X_FORWARDED_PORT]		= "X-Forwarded-Port",
+	[RQH_X_FORWARDED_PROTO]		= "X-Forwarded-Proto",
+	[RQH_X_IBM_DATA_TYPE]		= "X-IBM-Data-Type",
+	[RQH_X_IBM_INTRDR_LRECL]	= "X-IBM-Intrdr-Lrecl",
+	[RQH_X_IBM_INTRDR_MODE]		= "X-IBM-Intrdr-Mode",
+	[RQH_X_IBM_INTRDR_RECFM]	= "X-IBM-Intrdr-Recfm",
+	[RQH_X_IBM_MAX_ITEMS]		= "X-IBM-Max-Items",
+	[RQH_X_IBM_OPTION]		= "X-IBM-Option",
+	[RQH_X_IBM_RETURN_ETAG]		= "X-IBM-Return-Etag",
+	[RQH_X_MVSMF_CLIENT]		= "X-MVSMF-Client",
+};
+
+static const char *const rq_qry_names[RQQ_COUNT] = {
+	[RQQ_DIRECTION]			= "direction",
+	[RQQ_DSLEVEL]			= "dslevel",
+	[RQQ_EXEC_DATA]			= "exec-data",
+	[RQQ_HARDCOPY]			= "hardcopy",
+	[RQQ_JOBID]			= "jobid",
+	[RQQ_MAX_JOBS]			= "max-jobs",
+	[RQQ_OWNER]			= "owner",
+	[RQQ_PATH]			= "path",
+	[RQQ_PATTERN]			= "pattern",
+	[RQQ_PREFIX]			= "prefix",
+	[RQQ_START]			= "start",
+	[RQQ_STATUS]			= "status",
+	[RQQ_SYSNAME]			= "sysName",
+	[RQQ_TIME]			= "time",
+	[RQQ_TIMERANGE]			= "timeRange",
+	[RQQ_TIMESTAMP]			= "timestamp",
+	[RQQ_VOLSER]			= "volser",
+};
+
+/* Case-insensitive equality. toupper() rather than arithmetic on the
+   letters: in EBCDIC they are not one contiguous run. */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'rq_ieq'");
+#endif
+static int
+rq_ieq(const char *a, const char *b)
+{
+	for (; *a && *b; a++, b++) {
+		if (toupper((unsigned char) *a) != toupper((unsigned char) *b)) {
+			return 0;
+		}
+	}
+	return *a == *b;
+}
+
+/* Linear, and that is the right size: the longest table has twenty-one
+   entries, and the first-letter test turns nearly every miss into one
+   compare. */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'rq_lookup'");
+#endif
+static int
+rq_lookup(const char *const *names, int count, const char *name)
+{
+	int c = toupper((unsigned char) *name);
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (toupper((unsigned char) names[i][0]) == c &&
+				rq_ieq(names[i], name)) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/* Prefix test, ignoring case; returns what follows it or NULL. */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'rq_prefix'");
+#endif
+static const char *
+rq_prefix(const char *name, const char *prefix)
+{
+	for (; *prefix; name++, prefix++) {
+		if (toupper((unsigned char) *name) !=
+				toupper((unsigned char) *prefix)) {
+			return NULL;
+		}
+	}
+	return name;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'reqctx_init'");
+#endif
+void
+reqctx_init(RequestCtx *ctx)
+{
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->data_type = DATA_TYPE_TEXT;
+	ctx->match.route = -1;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'reqctx_add'");
+#endif
+void
+reqctx_add(RequestCtx *ctx, const char *name, const char *value)
+{
+	const char *rest;
+	int id;
+
+	if (!ctx || !name || !value) {
+		return;
+	}
+
+	if ((rest = rq_prefix(name, "HTTP_")) != NULL) {
+		id = rq_lookup(rq_hdr_names, RQH_COUNT, rest);
+		if (id >= 0 && !ctx->hdr[id]) {
+			ctx->hdr[id] = value;
+		}
+	} else if ((rest = rq_prefix(name, "QUERY_")) != NULL) {
+		id = rq_lookup(rq_qry_names, RQQ_COUNT, rest);
+		if (id >= 0 && !ctx->qry[id]) {
+			ctx->qry[id] = value;
+		}
+	} else {
+		id = rq_lookup(rq_env_names, RQE_COUNT, name);
+		if (id >= 0 && !ctx->env[id]) {
+			ctx->env[id] = value;
+		}
+	}
+}
+
+/* Content-Encoding: one coding, any case, blanks around it. A list of
+   codings is a body coded twice over, which nothing sends, so it is
+   CODING_UNKNOWN with the rest. */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'rq_coding'");
+#endif
+static int
+rq_coding(const char *v)
+{
+	char name[16];
+	size_t n;
+
+	while (*v == ' ' || *v == '\t') {
+		v++;
+	}
+	n = strlen(v);
+	while (n > 0 && (v[n - 1] == ' ' || v[n - 1] == '\t')) {
+		n--;
+	}
+	if (n >= sizeof(name)) {
+		return CODING_UNKNOWN;
+	}
+	memcpy(name, v, n);
+	name[n] = '\0';
+
+	if (n == 0 || rq_ieq(name, "identity")) {
+		return CODING_IDENTITY;
+	}
+	if (rq_ieq(name, "gzip") || rq_ieq(name, "x-gzip")) {
+		return CODING_GZIP;
+	}
+	if (rq_ieq(name, "deflate")) {
+		return CODING_DEFLATE;
+	}
+	return CODING_UNKNOWN;
+}
+
+/* Accept-Encoding: a list of codings, each with an optional ;q=. gzip (or
+   x-gzip) named with a q above zero is taken; named with q=0 it is
+   refused, whatever else the list says; not named, a "*" above zero takes
+   it. Parameters other than q are skipped. */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'rq_accepts_gzip'");
+#endif
+static int
+rq_accepts_gzip(const char *v)
+{
+	char name[16];
+	size_t n;
+	int q;
+	int gzip = -1;
+	int star = 0;
+
+	while (*v) {
+		while (*v == ' ' || *v == '\t' || *v == ',') {
+			v++;
+		}
+		for (n = 0; *v && *v != ',' && *v != ';' && *v != ' '
+				&& *v != '\t'; v++) {
+			if (n < sizeof(name) - 1) {
+				name[n++] = *v;
+			}
+		}
+		name[n] = '\0';
+
+		/* q is above zero unless every digit after "0." is a 0 */
+		q = 1;
+		while (*v && *v != ',') {
+			if (*v == ';') {
+				v++;
+				while (*v == ' ' || *v == '\t') {
+					v++;
+				}
+				if ((*v == 'q' || *v == 'Q') && v[1] == '=') {
+					v += 2;
+					q = (*v != '0');
+					if (*v == '0' && v[1] == '.') {
+						for (v += 2; isdigit((unsigned char) *v); v++) {
+							if (*v != '0') {
+								q = 1;
+							}
+						}
+					}
+				}
+			} else {
+				v++;
+			}
+		}
+
+		if (rq_ieq(name, "gzip") || rq_ieq(name, "x-gzip")) {
+			if (gzip != 0) {
+				gzip = q;
+			}
+		} else if (name[0] == '*' && name[1] == '\0') {
+			star = q;
+		}
+	}
+	return gzip >= 0 ? gzip : star;
+}
+
+/* The parses below are the ones the handlers did at each call site, moved
+   here unchanged so a handler reading the field sees what it used to
+   compute: strtoul() for Content-Length, a substring test for chunked,
+   atoi() for X-IBM-Max-Items. */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'reqctx_finish'");
+#endif
+void
+reqctx_finish(RequestCtx *ctx)
+{
+	const char *v;
+
+	if (!ctx) {
+		return;
+	}
+
+	v = ctx->hdr[RQH_CONTENT_LENGTH];
+	if (v) {
+		ctx->has_length = 1;
+		ctx->content_length = strtoul(v, NULL, 10);
+	}
+
+	v = ctx->hdr[RQH_TRANSFER_ENCODING];
+	ctx->chunked = (v && strstr(v, "chunked") != NULL);
+
+	v = ctx->hdr[RQH_CONTENT_ENCODING];
+	ctx->content_coding = (unsigned char)
+		(v ? rq_coding(v) : CODING_IDENTITY);
+
+	v = ctx->hdr[RQH_ACCEPT_ENCODING];
+	ctx->accept_gzip = (unsigned char) (v && rq_accepts_gzip(v));
+
+	v = ctx->hdr[RQH_X_IBM_MAX_ITEMS];
+	if (v) {
+		ctx->has_max_items = 1;
+		ctx->max_items = atoi(v);
+	}
+
+	/* "text" is a prefix test: the header may carry ;fileEncoding=... */
+	v = ctx->hdr[RQH_X_IBM_DATA_TYPE];
+	if (v && strcmp(v, "binary") == 0) {
+		ctx->data_type = DATA_TYPE_BINARY;
+	} else if (v && strcmp(v, "record") == 0) {
+		ctx->data_type = DATA_TYPE_RECORD;
+	} else {
+		ctx->data_type = DATA_TYPE_TEXT;
+	}
+
+	ctx->return_etag = (unsigned char)
+		etag_requested(ctx->hdr[RQH_X_IBM_RETURN_ETAG]);
+
+	v = ctx->qry[RQQ_MAX_JOBS];
+	if (v) {
+		char *end = NULL;
+		long val = strtol(v, &end, 10);
+		if (*end == '\0' && val > 0) {
+			ctx->max_jobs = val;
+		}
+	}
+
+	ctx->filled = 1;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'reqctx_header_id'");
+#endif
+int
+reqctx_header_id(const char *name)
+{
+	return name ? rq_lookup(rq_hdr_names, RQH_COUNT, name) : -1;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'reqctx_query_id'");
+#endif
+int
+reqctx_query_id(const char *name)
+{
+	return name ? rq_lookup(rq_qry_names, RQQ_COUNT, name) : -1;
+}
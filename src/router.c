@@ -1,14 +1,21 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <clibary.h>
 #include <clibwto.h>
 #include <clibtry.h>
 #include <clibjes2.h>
 
 #include "router.h"
 #include "common.h"
+#include "dsread.h"
+#include "dswrite.h"
 #include "httpcgi.h"
 #include "abendmsg.h"
 #include "mvsmfmsg.h"
+#include "mvsmfctx.h"
+#include "mvssupa.h"    /* __getclk */
+#include "cliblock.h"   /* lock / unlock, LOCK_EXC */
 
 
 #define INITIAL_BUFFER_SIZE 4096
@@ -27,6 +34,10 @@ struct handler_ctx {
 
 static int handler_thunk(struct handler_ctx *ctx);
 static int safe_fclose_thunk(FILE *fp);
+static int safe_arena_thunk(ARENA *arena);
+
+static void *arena_getmain(void *ctx, unsigned size);
+static void arena_freemain(void *ctx, void *block, unsigned size);
 
 static int route_matching_middleware(Session *session);
 static int path_vars_extracting_middleware(Session *session);
@@ -36,17 +47,26 @@ static int is_hex_digit(char c);
 static void percent_decode(Session *session, char *str);
 
 static HttpMethod parseMethod(const char *method);
-static Route *find_route(Router *router, HttpMethod method, const char *path);
-static int is_pattern_match(const char *pattern, const char *path);
-static int extract_path_vars(Session *session, const char *pattern, const char *path);
+static void parse_request(Session *session);
+static int dispatch_request(Router *router, Session *session);
+static void count_request(Session *session, unsigned long long elapsed);
+static void report_slow(Session *session, unsigned long long now);
+
+// RENT: read-only, so it may be static. A writable static would S0C4.
+static const ARENA_OPS arena_ops = {
+    arena_getmain,
+    arena_freemain
+};
 
 //
 // public functions
 //
 
-void init_router(Router *router) 
+void init_router(Router *router, const ROUTETAB *routes, const RouteHandler *handlers)
 {
     memset(router, 0, sizeof(Router));  
+    router->routes = routes;
+    router->handlers = handlers;
 
     add_middleware(router, "RouteMatching", route_matching_middleware);
     add_middleware(router, "PathVars", path_vars_extracting_middleware);
@@ -58,25 +78,7 @@ void init_session(Session *session, Router *router, HTTPD *httpd, HTTPC *httpc)
     session->router = router;
     session->httpd = httpd;
     session->httpc = httpc;
-}
-
-void add_route(Router *router, HttpMethod method, const char *pattern, RouteHandler handler) 
-{
-    if (router->route_count >= MAX_ROUTES) {
-        wtof(MSG_ROUTES_FULL, MAX_ROUTES);
-        return;
-    }
-
-    if (!pattern || !handler) {
-        wtof(MSG_ROUTE_INVALID);
-        return;
-    }
-
-    Route *route = &router->routes[router->route_count++];
-    route->method = method;
-    route->pattern = pattern;
-    route->handler = handler;
-
+    arena_init(&session->arena, &arena_ops, session);
 }
 
 void add_middleware(Router *router, const char *middleware_name, MiddlewareHandler handler)
@@ -93,17 +95,52 @@ void add_middleware(Router *router, const char *middleware_name, MiddlewareHandl
 
 int handle_request(Router *router, Session *session) 
 {
+    unsigned long long t0 = 0;
+    unsigned long long t1 = 0;
+    int rc;
+
     if (router == NULL || session == NULL) {
         wtof(MSG_ROUTER_NULL);
         return -1;
     } 
 
-    // needed for http_get_env
+    // STCK around the whole request, every exit included: a 404 or a
+    // rejected credential is load the server carried too
+    __getclk(&t0);
+    trace_init(&session->trace, t0);
+    rc = dispatch_request(router, session);
+    // the tail of the body, still in the buffer, and the gzip trailer of a
+    // compressed one; a send that fails here has already dropped the
+    // connection and there is nothing to answer
+    (void)send_finish(session);
+    __getclk(&t1);
+
+    count_request(session, t1 - t0);
+    report_slow(session, t1);
+
+    // everything the request allocated from its arena goes back in one
+    // piece; nothing in the session points into it past this line -- the
+    // output buffer's storage included
+    sendbuf_init(&session->out, NULL, 0);
+    session->gz = NULL;
+    arena_release(&session->arena);
+
+    return rc;
+}
+
+__asm__("\n&FUNC    SETC 'dispatch_request'");
+static int dispatch_request(Router *router, Session *session)
+{
+    // needed for the httpx macros (http_resp and friends)
     HTTPD *httpd = session->httpd;
     HTTPC *httpc = session->httpc;
 
-    char *method = (char *) http_get_env(httpc, (const UCHAR *) "REQUEST_METHOD");
-    char *raw_path = (char *) http_get_env(httpc, (const UCHAR *) "REQUEST_PATH");
+    // one walk over the environment for everything mvsMF reads from it;
+    // from here on handlers read session->req instead of searching
+    parse_request(session);
+
+    char *method = (char *) session->req.env[RQE_REQUEST_METHOD];
+    char *raw_path = (char *) session->req.env[RQE_REQUEST_PATH];
     char path[1024];
 
     // Percent-decode the request path (e.g. %28/%29 -> parentheses)
@@ -113,7 +150,7 @@ int handle_request(Router *router, Session *session)
 
     HttpMethod reqMethod = parseMethod(method);
     if (reqMethod == -1) {
-        http_resp(httpc, 405);
+        session_resp(session, 405);
         return -1;
     }
 
@@ -128,24 +165,32 @@ int handle_request(Router *router, Session *session)
         }
     }
 
-    Route *route = find_route(router, reqMethod, path);
+    // one walk down the const trie (routetab.h), whatever the route count;
+    // the same walk records where each path variable sits in `path`
+    int route = rt_match(router->routes, reqMethod, path, &session->req.match);
 
-    if (route == NULL) {
+    if (route < 0 || router->handlers[route] == NULL) {
         sendErrorResponse(session, HTTP_STATUS_NOT_FOUND, 6, 4, 7, "Not Found", NULL, 0);
         return -1;
     }
 
-    extract_path_vars(session, route->pattern, path);
+    // Terminate the captures where they lie and hand the handler pointers
+    // into this buffer (getPathVar). No per-variable copies on the stack and
+    // no http_set_env()/http_get_env() round trip. `path` is no longer the
+    // request path after this -- messages below use raw_path.
+    rt_split(path, &session->req.match);
+    session->req.path = path;
 
     // call the handler with ESTAE protection
     struct handler_ctx ctx;
     int try_rc;
 
-    ctx.handler = route->handler;
+    ctx.handler = router->handlers[route];
     ctx.session = session;
     ctx.rc = 0;
 
     try_rc = try(handler_thunk, &ctx);
+    session->req.path = NULL;   // `path` dies with this frame
     if (try_rc != 0) {
         unsigned abend = tryrc();
         unsigned sys = (abend >> 12) & 0xFFF;
@@ -153,7 +198,7 @@ int handle_request(Router *router, Session *session)
         // on the stack, not static: MVSMF is RENT, and this runs in the
         // recovery path where a second abend would be unrecoverable
         char msg[ABEND_MSG_SIZE];
-        wtof(MSG_HANDLER_ABEND, sys, usr, method, path);
+        wtof(MSG_HANDLER_ABEND, sys, usr, method, raw_path);
         session_cleanup(session);
         if (!session->headers_sent) {
             /* An S913 is not a failure, it is a refusal OPEN made, and the
@@ -264,6 +309,54 @@ void session_jesclose(Session *session, JES **jes)
     jesclose(jes);
 }
 
+__asm__("\n&FUNC    SETC 'ses_reg_intrdr'");
+void session_register_intrdr(Session *session, VSFILE *intrdr)
+{
+    if (!session) return;
+    session->open_intrdr = intrdr;
+}
+
+__asm__("\n&FUNC    SETC 'ses_unreg_intrdr'");
+void session_unregister_intrdr(Session *session, VSFILE *intrdr)
+{
+    if (session && session->open_intrdr == intrdr) {
+        session->open_intrdr = NULL;
+    }
+}
+
+__asm__("\n&FUNC    SETC 'session_resp'");
+int session_resp(Session *session, int status)
+{
+    session->status = status;
+    // httpd writes the status line and the headers straight to the
+    // socket; body bytes still waiting in the buffer go first
+    if (send_flush(session) < 0) {
+        return -1;
+    }
+    return http_resp(session->httpc, status);
+}
+
+__asm__("\n&FUNC    SETC 'ses_span_begin'");
+int session_span_begin(Session *session, const char *name)
+{
+    unsigned long long now;
+
+    if (!session) return TRC_NONE;
+    __getclk(&now);
+    return trace_begin(&session->trace, name, now);
+}
+
+__asm__("\n&FUNC    SETC 'ses_span_end'");
+void session_span_end(Session *session, int span)
+{
+    unsigned long long now;
+
+    // TRC_NONE costs no STCK: nested begins and a full table return it
+    if (!session || span == TRC_NONE) return;
+    __getclk(&now);
+    trace_end(&session->trace, span, now);
+}
+
 // Thunk for ESTAE-protected jesclose() during recovery.
 // Returns 0 on success; a secondary abend is caught by try().
 __asm__("\n&FUNC    SETC 'safe_jesclose'");
@@ -275,6 +368,34 @@ static int safe_jesclose_thunk(JES *jes)
     return 0;
 }
 
+// Thunk for ESTAE-protected dsread_stop() during recovery.
+// Returns 0 on success; a secondary abend is caught by try().
+__asm__("\n&FUNC    SETC 'safe_reader'");
+static int safe_reader_thunk(Session *session)
+{
+    dsread_stop(session, session->rd);
+    return 0;
+}
+
+// Thunk for ESTAE-protected dswrite_stop() during recovery.
+// Returns 0 on success; a secondary abend is caught by try().
+__asm__("\n&FUNC    SETC 'safe_writer'");
+static int safe_writer_thunk(DSWRITE *w)
+{
+    dswrite_stop(w);
+    return 0;
+}
+
+// Thunk for the ESTAE-protected cancel and close of the internal reader.
+// Returns 0 on success; a secondary abend is caught by try().
+__asm__("\n&FUNC    SETC 'safe_intrdr'");
+static int safe_intrdr_thunk(VSFILE *intrdr)
+{
+    (void)jesirput(intrdr, JCL_CANCEL_CARD);
+    jesircls(intrdr);
+    return 0;
+}
+
 // Thunk for ESTAE-protected fclose during recovery.
 // Returns 0 on success; a secondary abend is caught by try().
 __asm__("\n&FUNC    SETC 'safe_fclose'");
@@ -293,6 +414,40 @@ void session_cleanup(Session *session)
     int i;
     if (!session) return;
 
+    // A read-ahead subtask reads a DCB closed below into buffers in the
+    // arena released below: it goes first. Stopped under ESTAE like the
+    // rest, since the abend may have been in its storage too.
+    if (session->rd) {
+        if (try(safe_reader_thunk, session) != 0) {
+            wtof(MSG_RECOVERY_SUBTASK, "READ-AHEAD");
+        }
+        session->rd = NULL;
+    }
+
+    // A write-behind subtask owns the PUT target's DCB and writes from
+    // slots in the arena. Stopped, not drained: what it has not written is
+    // the rest of a body the abend cut short anyway.
+    if (session->wr) {
+        if (try(safe_writer_thunk, session->wr) != 0) {
+            wtof(MSG_RECOVERY_SUBTASK, "WRITE-BEHIND");
+        }
+        session->wr = NULL;
+    }
+
+    // A submission cut short by the abend: the reader holds the cards
+    // that arrived, and the close alone would queue them as a job. The
+    // cancel card deletes it, then the close gives back the ACB and the
+    // SYSOUT DD.
+    if (session->open_intrdr) {
+        VSFILE *intrdr = session->open_intrdr;
+
+        session->open_intrdr = NULL;
+        wtof(MSG_RECOVERY_INTRDR);
+        if (try(safe_intrdr_thunk, intrdr) != 0) {
+            wtof(MSG_RECOVERY_INTRDR_ABEND);
+        }
+    }
+
     // Close tracked FILE handles under individual ESTAE protection.
     // A corrupted pointer from the original abend must not prevent
     // cleanup of the remaining resources.
@@ -321,6 +476,31 @@ void session_cleanup(Session *session)
         }
     }
 
+    // Output still pending is dropped, not sent: the body it belongs to was
+    // cut short by the abend anyway, and a send here could stall for the
+    // whole budget inside recovery. Its storage is the arena's, and so is a
+    // gzip encoder's, whose stream is as cut short as the body.
+    if ((session->out.len || session->gz) && session->headers_sent
+            && session->httpc) {
+        session->httpc->keepalive = 0;
+    }
+    sendbuf_init(&session->out, NULL, 0);
+    session->gz = NULL;
+
+    // The request's storage. Under its own ESTAE like the closes: an abend
+    // that overlaid a chunk header would abend the walk in turn. Then the
+    // chunks are written off -- the chain is not to be trusted again, and
+    // the error response the router is about to build needs an arena that
+    // starts empty.
+    if (session->arena.head) {
+        if (try(safe_arena_thunk, &session->arena) != 0) {
+            wtof(MSG_RECOVERY_ARENA, session->arena.held);
+            session->arena.head = NULL;
+            session->arena.last = NULL;
+            session->arena.held = 0;
+        }
+    }
+
     // UFS session lifecycle is managed by HTTPD (http_get_ufs).
     // HTTPD's worker ESTAE handles cleanup on abend.
 }
@@ -329,6 +509,50 @@ void session_cleanup(Session *session)
 // private functions
 //
 
+// Thunk for ESTAE-protected arena release during recovery.
+__asm__("\n&FUNC    SETC 'safe_arena'");
+static int safe_arena_thunk(ARENA *arena)
+{
+    arena_release(arena);
+    return 0;
+}
+
+// The arena's chunk source (arena.h): conditional GETMAIN/FREEMAIN, register
+// form, subpool 0 -- the register form because MVSMF is RENT and the list
+// forms store into the code stream, and not libc370's getmain() because a
+// failed request must come back as NULL, not as a console message. The same
+// reasoning as stg_getmain() in testapi.c; a request that cannot get a chunk
+// answers 500 through the caller's allocation-failure path.
+__asm__("\n&FUNC    SETC 'arena_getmain'");
+static void *arena_getmain(void *ctx, unsigned size)
+{
+    int rc = 0;
+    void *r1 = (void *)0;
+    unsigned sp = 0;
+
+    (void)ctx;
+    __asm__("GETMAIN RC,LV=(%2),SP=(%3)\n\t"
+            "LR\t%0,15\n\t"
+            "LR\t%1,1"
+            : "=r"(rc), "=r"(r1)
+            : "r"(size), "r"(sp)
+            : "0", "1", "14", "15");
+
+    return rc ? (void *)0 : r1;
+}
+
+__asm__("\n&FUNC    SETC 'arena_freemain'");
+static void arena_freemain(void *ctx, void *block, unsigned size)
+{
+    unsigned sp = 0;
+
+    (void)ctx;
+    __asm__("FREEMAIN RC,A=(%0),LV=(%1),SP=(%2)"
+            :
+            : "r"(block), "r"(size), "r"(sp)
+            : "0", "1", "14", "15");
+}
+
 __asm__("\n&FUNC    SETC 'hex_nibble'");
 static unsigned char
 hex_nibble(char c)
@@ -403,117 +627,111 @@ HttpMethod parseMethod(const char *method)
     return (HttpMethod) -1; 
 }
 
-__asm__("\n&FUNC	SETC 'find_route'");
+/* Fill session->req from httpc->env in one pass. The array is httpd's, and
+   so are the strings: the context keeps pointers, which stay valid until the
+   request ends. array_count() is reached through the httpx vector, hence the
+   session in scope for the macro. */
+__asm__("\n&FUNC	SETC 'parse_request'");
 static 
-Route *find_route(Router *router, HttpMethod method, const char *path)
+void parse_request(Session *session) 
 {
-    int i = 0;
-    for (i = 0; i < router->route_count; i++) {
-        if (router->routes[i].method == method) {
-            if (is_pattern_match(router->routes[i].pattern, path)) {
-                return &router->routes[i];
-            }
-        }
-    }
-    return NULL;
-}
+    HTTPV **env = session->httpc->env;
+    unsigned count = env ? array_count(&env) : 0;
+    unsigned n;
 
-__asm__("\n&FUNC	SETC 'is_pattern_match'");
-static
-int is_pattern_match(const char *pattern, const char *path)
-{
-    while (*pattern && *path) {
-        if (*pattern == '{') {
-            int is_wildcard = (*(pattern + 1) == '*');
-            if (is_wildcard) pattern++;
-            while (*pattern && *pattern != '}') pattern++;
-            if (*pattern == '}') pattern++;
-
-            if (is_wildcard) {
-                /* {*var} consumes entire remaining path including slashes */
-                while (*path) path++;
-            } else {
-                while (*path && *path != '/' && *path != '(' && *path != ')') path++;
-            }
-        } else {
-            if (*pattern == *path) {
-                pattern++;
-                path++;
-            } else {
-                return 0;
-            }
-        }
-    }
+    reqctx_init(&session->req);
 
-    /* A trailing {*wildcard} matches empty when path is already consumed */
-    while (*pattern == '{' && *(pattern + 1) == '*') {
-        while (*pattern && *pattern != '}') pattern++;
-        if (*pattern == '}') pattern++;
+    for (n = 0; n < count; n++) {
+        if (env[n]) {
+            reqctx_add(&session->req, (const char *) env[n]->name,
+                (const char *) env[n]->value);
+        }
     }
 
-    return *pattern == '\0' && *path == '\0';
+    reqctx_finish(&session->req);
 }
 
-__asm__("\n&FUNC	SETC 'extract_path_vars'");
-static
-int extract_path_vars(Session *session, const char *pattern, const char *path)
+/* Count the request into its route's metrics slot (metrics.h). The latch
+   is held for the few stores metrics_record() makes and nothing else; the
+   block lookup and every division happen outside it.
+
+   Bytes received are the declared Content-Length, or what httpd read into
+   POST_STRING. A chunked upload that mvsMF reads itself has no declared
+   length and counts 0 -- the body decoders do not report what they read.
+
+   The size of a buffered JSON body is learned under the same latch, for
+   the next builder on this route (createJsonResponse()). */
+__asm__("\n&FUNC	SETC 'count_request'");
+static 
+void count_request(Session *session, unsigned long long elapsed) 
 {
-    if (session == NULL || pattern == NULL || path == NULL) {
-        return -1;
+    MVSMF_METRICS *m = mvsmf_metrics(session->httpd);
+    const char *post;
+    unsigned long long usec;
+    double bytes_in = 0;
+    int slot;
+
+    if (!m) {
+        return;
     }
 
-    HTTPD *httpd = session->httpd;
-    HTTPC *httpc = session->httpc;
+    // bit 51 of the TOD clock is one microsecond
+    usec = elapsed >> 12;
+    if (usec > 0xFFFFFFFFUL) {
+        usec = 0xFFFFFFFFUL;
+    }
 
-    while (*pattern) {
-        if (*pattern == '{') {
-            pattern++;
-            int is_wildcard = (*pattern == '*');
-            if (is_wildcard) pattern++;
-            const char *var_start = pattern;
-            while (*pattern && *pattern != '}') pattern++;
-            int var_name_len = pattern - var_start;
-            char var_name[256];
-            strncpy(var_name, var_start, var_name_len);
-            var_name[var_name_len] = '\0';
-            if (*pattern == '}') pattern++;
-
-            const char *value_start = path;
-
-            if (is_wildcard) {
-                /* {*var} captures entire remaining path */
-                while (*path) path++;
-            } else {
-                const char *pattern_next = pattern;
-                while (*pattern_next && *pattern_next != '/' && *pattern_next != '(' && *pattern_next != ')') pattern_next++;
+    if (session->req.has_length) {
+        bytes_in = (double) session->req.content_length;
+    } else if ((post = session->req.env[RQE_POST_STRING]) != NULL) {
+        bytes_in = (double) strlen(post);
+    }
 
-                while (*path && *path != *pattern_next) path++;
-            }
+    slot = metrics_slot(session->req.match.route);
 
-            int value_len = path - value_start;
-            char value[1024];
-            strncpy(value, value_start, value_len);
-            value[value_len] = '\0';
+    lock((void *) m, LOCK_EXC);
+    metrics_record(m, slot, session->status, bytes_in,
+        (double) session->bytes_sent, (unsigned) usec);
+    if (session->json_size) {
+        metrics_size(&m->route[slot], session->json_size);
+    }
+    unlock((void *) m, LOCK_EXC);
+}
 
-            /* Trim trailing spaces - clients like Zowe Explorer
-               may pad names with spaces (e.g. member names to 8 chars) */
-            while (value_len > 0 && value[value_len - 1] == ' ') {
-                value[--value_len] = '\0';
-            }
+/* The slow-request record (trace.h). Off unless the server environment sets
+   MVSMF_TRACE_MS -- a //SYSENV DD line, like MVSMF_ABEND_TEST -- to the
+   threshold in milliseconds: the console is read back by consapi.c, so a
+   line per request by default would flood the very log it reports into.
 
-            char env_name[256];
-            sprintf(env_name, "HTTP_%s", var_name);
-            http_set_env(httpc, (UCHAR *) env_name, (UCHAR *) value);
+   Two lines, because the phases do not fit beside the method and path in
+   one WTO: MVSMF009W says which request, MVSMF010I where its time went.
+   Written after the response, so it never holds up the client. */
+__asm__("\n&FUNC	SETC 'report_slow'");
+static
+void report_slow(Session *session, unsigned long long now)
+{
+    const char *v = getenv("MVSMF_TRACE_MS");
+    const char *method;
+    const char *path;
+    unsigned long ms;
+    long limit;
+    char phases[100];
+
+    if (!v || (limit = atol(v)) <= 0) {
+        return;
+    }
 
-        } else {
-            if (*pattern == *path) {
-                pattern++;
-                path++;
-            } else {
-                return 0;
-            }
-        }
+    ms = trace_usec(now - session->trace.t0) / 1000;
+    if (ms < (unsigned long) limit) {
+        return;
     }
 
-	return 0;
+    method = session->req.env[RQE_REQUEST_METHOD];
+    path = session->req.env[RQE_REQUEST_PATH];
+    wtof(MSG_SLOW_REQUEST, method ? method : "?", path ? path : "?",
+        (unsigned) ms, session->status);
+
+    if (trace_summary(&session->trace, now, phases, sizeof(phases)) > 0) {
+        wtof(MSG_SLOW_PHASES, phases);
+    }
 }
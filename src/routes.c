@@ -0,0 +1,268 @@
+/*
+ * routes.c - mvsMF's route table, as compile-time data.
+ *
+ * Two views of the same routes, both `static const`:
+ *
+ *   route_defs[]  what each route id is: method and pattern, in the order
+ *                 the routes were once registered by add_route();
+ *   the trie      what dispatch walks. Written bottom-up, because C wants an
+ *                 array defined before a node can point at it, so read it
+ *                 from n_root at the end upwards.
+ *
+ * Sibling literals start with different characters, so a miss costs one
+ * compare per sibling; common prefixes ("rest") are their own edge for that
+ * reason. Captures come after the literals of the same parent -- see
+ * routetab.h for why that order never changes which route wins.
+ *
+ * test/host/tstrout.c #includes this file and checks the trie against the
+ * definitions route by route, so an edit to one that misses the other
+ * fails `make test-host` rather than a request.
+ */
+
+#include <stddef.h>
+
+#include "routes.h"
+
+static const RTDEF route_defs[ROUTE_COUNT] = {
+	[ROUTE_INFO]            = { GET,    "/zosmf/info" },
+	[ROUTE_TEST]            = { GET,    "/zosmf/test" },
+	[ROUTE_TEST_WILDCARD]   = { GET,    "/zosmf/test/wildcard/{*filepath}" },
+
+	[ROUTE_AUTH_LOGIN]      = { POST,   "/zosmf/services/authenticate" },
+	[ROUTE_AUTH_LOGOUT]     = { DELETE, "/zosmf/services/authenticate" },
+
+	[ROUTE_JOB_LIST]        = { GET,    "/zosmf/restjobs/jobs" },
+	[ROUTE_JOB_FILES]       = { GET,    "/zosmf/restjobs/jobs/{job-name}/{jobid}/files" },
+	[ROUTE_JOB_RECORDS]     = { GET,    "/zosmf/restjobs/jobs/{job-name}/{jobid}/files/{ddid}/records" },
+	[ROUTE_JOB_SUBMIT]      = { PUT,    "/zosmf/restjobs/jobs" },
+	[ROUTE_JOB_STATUS]      = { GET,    "/zosmf/restjobs/jobs/{job-name}/{jobid}" },
+	[ROUTE_JOB_PURGE]       = { DELETE, "/zosmf/restjobs/jobs/{job-name}/{jobid}" },
+
+	[ROUTE_DS_LIST]         = { GET,    "/zosmf/restfiles/ds" },
+	[ROUTE_DS_GET]          = { GET,    "/zosmf/restfiles/ds/{dataset-name}" },
+	[ROUTE_DS_GET_VOL]      = { GET,    "/zosmf/restfiles/ds/-({volume-serial})/{dataset-name}" },
+	[ROUTE_DS_PUT]          = { PUT,    "/zosmf/restfiles/ds/{dataset-name}" },
+	[ROUTE_DS_PUT_VOL]      = { PUT,    "/zosmf/restfiles/ds/-({volume-serial})/{dataset-name}" },
+	[ROUTE_DS_CREATE]       = { POST,   "/zosmf/restfiles/ds/{dataset-name}" },
+	[ROUTE_DS_DELETE]       = { DELETE, "/zosmf/restfiles/ds/{dataset-name}" },
+	[ROUTE_DS_DELETE_VOL]   = { DELETE, "/zosmf/restfiles/ds/-({volume-serial})/{dataset-name}" },
+	[ROUTE_MBR_LIST]        = { GET,    "/zosmf/restfiles/ds/{dataset-name}/member" },
+	[ROUTE_MBR_LIST_VOL]    = { GET,    "/zosmf/restfiles/ds/-({volume-serial})/{dataset-name}/member" },
+	[ROUTE_MBR_GET]         = { GET,    "/zosmf/restfiles/ds/{dataset-name}({member-name})" },
+	[ROUTE_MBR_GET_VOL]     = { GET,    "/zosmf/restfiles/ds/-({volume-serial})/{dataset-name}({member-name})" },
+	[ROUTE_MBR_PUT]         = { PUT,    "/zosmf/restfiles/ds/{dataset-name}({member-name})" },
+	[ROUTE_MBR_PUT_VOL]     = { PUT,    "/zosmf/restfiles/ds/-({volume-serial})/{dataset-name}({member-name})" },
+	[ROUTE_MBR_DELETE]      = { DELETE, "/zosmf/restfiles/ds/{dataset-name}({member-name})" },
+	[ROUTE_MBR_DELETE_VOL]  = { DELETE, "/zosmf/restfiles/ds/-({volume-serial})/{dataset-name}({member-name})" },
+
+	[ROUTE_USS_LIST]        = { GET,    "/zosmf/restfiles/fs" },
+	[ROUTE_CONS_ISSUE]      = { PUT,    "/zosmf/restconsoles/consoles/{console-name}" },
+	[ROUTE_CONS_COLLECT]    = { GET,    "/zosmf/restconsoles/consoles/{console-name}/solmsgs/{cmd-response-key}" },
+	[ROUTE_CONS_DETECT]     = { GET,    "/zosmf/restconsoles/consoles/{console-name}/detections/{detection-key}" },
+	[ROUTE_CONS_LOG]        = { GET,    "/zosmf/restconsoles/v1/log" },
+
+	[ROUTE_USS_GET]         = { GET,    "/zosmf/restfiles/fs/{*filepath}" },
+	[ROUTE_USS_PUT]         = { PUT,    "/zosmf/restfiles/fs/{*filepath}" },
+	[ROUTE_USS_CREATE]      = { POST,   "/zosmf/restfiles/fs/{*filepath}" },
+	[ROUTE_USS_DELETE]      = { DELETE, "/zosmf/restfiles/fs/{*filepath}" },
+};
+
+/*
+ * /zosmf/restjobs/jobs[/{job-name}/{jobid}[/files[/{ddid}/records]]]
+ */
+static const RTLEAF e_job_records[] = { { GET, ROUTE_JOB_RECORDS } };
+static const RTNODE n_job_records[] = {
+	RT_LEAFNODE(RT_TEXT("/records"), e_job_records),
+};
+static const RTNODE n_job_ddid[] = {
+	RT_INNER(RT_CAPTURE(PATH_DDID, "ddid"), n_job_records),
+};
+static const RTNODE n_job_ddslash[] = {
+	RT_INNER(RT_TEXT("/"), n_job_ddid),
+};
+static const RTLEAF e_job_files[] = { { GET, ROUTE_JOB_FILES } };
+static const RTNODE n_job_files[] = {
+	RT_NODE(RT_TEXT("/files"), n_job_ddslash, e_job_files),
+};
+static const RTLEAF e_job[] = {
+	{ GET,    ROUTE_JOB_STATUS },
+	{ DELETE, ROUTE_JOB_PURGE },
+};
+static const RTNODE n_jobid[] = {
+	RT_NODE(RT_CAPTURE(PATH_JOBID, "jobid"), n_job_files, e_job),
+};
+static const RTNODE n_jobid_slash[] = {
+	RT_INNER(RT_TEXT("/"), n_jobid),
+};
+static const RTNODE n_jobname[] = {
+	RT_INNER(RT_CAPTURE(PATH_JOB_NAME, "job-name"), n_jobid_slash),
+};
+static const RTNODE n_jobs_slash[] = {
+	RT_INNER(RT_TEXT("/"), n_jobname),
+};
+static const RTLEAF e_jobs[] = {
+	{ GET, ROUTE_JOB_LIST },
+	{ PUT, ROUTE_JOB_SUBMIT },
+};
+
+/*
+ * /zosmf/restfiles/ds[/{dataset-name}[/member|({member-name})]]
+ * /zosmf/restfiles/ds/-({volume-serial})/{dataset-name}[/member|({member-name})]
+ */
+static const RTLEAF e_mbr[] = {
+	{ GET,    ROUTE_MBR_GET },
+	{ PUT,    ROUTE_MBR_PUT },
+	{ DELETE, ROUTE_MBR_DELETE },
+};
+static const RTNODE n_mbr_close[] = {
+	RT_LEAFNODE(RT_TEXT(")"), e_mbr),
+};
+static const RTNODE n_mbr_name[] = {
+	RT_INNER(RT_CAPTURE(PATH_MEMBER_NAME, "member-name"), n_mbr_close),
+};
+static const RTLEAF e_mbr_list[] = { { GET, ROUTE_MBR_LIST } };
+static const RTNODE n_ds_kids[] = {
+	RT_LEAFNODE(RT_TEXT("/member"), e_mbr_list),
+	RT_INNER(RT_TEXT("("), n_mbr_name),
+};
+static const RTLEAF e_ds[] = {
+	{ GET,    ROUTE_DS_GET },
+	{ PUT,    ROUTE_DS_PUT },
+	{ POST,   ROUTE_DS_CREATE },
+	{ DELETE, ROUTE_DS_DELETE },
+};
+
+static const RTLEAF e_vol_mbr[] = {
+	{ GET,    ROUTE_MBR_GET_VOL },
+	{ PUT,    ROUTE_MBR_PUT_VOL },
+	{ DELETE, ROUTE_MBR_DELETE_VOL },
+};
+static const RTNODE n_vol_mbr_close[] = {
+	RT_LEAFNODE(RT_TEXT(")"), e_vol_mbr),
+};
+static const RTNODE n_vol_mbr_name[] = {
+	RT_INNER(RT_CAPTURE(PATH_MEMBER_NAME, "member-name"), n_vol_mbr_close),
+};
+static const RTLEAF e_vol_mbr_list[] = { { GET, ROUTE_MBR_LIST_VOL } };
+static const RTNODE n_vol_ds_kids[] = {
+	RT_LEAFNODE(RT_TEXT("/member"), e_vol_mbr_list),
+	RT_INNER(RT_TEXT("("), n_vol_mbr_name),
+};
+/* no POST: a create names no volume */
+static const RTLEAF e_vol_ds[] = {
+	{ GET,    ROUTE_DS_GET_VOL },
+	{ PUT,    ROUTE_DS_PUT_VOL },
+	{ DELETE, ROUTE_DS_DELETE_VOL },
+};
+static const RTNODE n_vol_dsn[] = {
+	RT_NODE(RT_CAPTURE(PATH_DATASET_NAME, "dataset-name"), n_vol_ds_kids, e_vol_ds),
+};
+static const RTNODE n_vol_close[] = {
+	RT_INNER(RT_TEXT(")/"), n_vol_dsn),
+};
+static const RTNODE n_vol[] = {
+	RT_INNER(RT_CAPTURE(PATH_VOLUME_SERIAL, "volume-serial"), n_vol_close),
+};
+
+static const RTNODE n_ds_slash_kids[] = {
+	RT_INNER(RT_TEXT("-("), n_vol),
+	RT_NODE(RT_CAPTURE(PATH_DATASET_NAME, "dataset-name"), n_ds_kids, e_ds),
+};
+static const RTNODE n_ds_slash[] = {
+	RT_INNER(RT_TEXT("/"), n_ds_slash_kids),
+};
+static const RTLEAF e_ds_list[] = { { GET, ROUTE_DS_LIST } };
+
+/*
+ * /zosmf/restfiles/fs[/{*filepath}]
+ */
+static const RTLEAF e_uss[] = {
+	{ GET,    ROUTE_USS_GET },
+	{ PUT,    ROUTE_USS_PUT },
+	{ POST,   ROUTE_USS_CREATE },
+	{ DELETE, ROUTE_USS_DELETE },
+};
+static const RTNODE n_uss_path[] = {
+	RT_LEAFNODE(RT_WILDCARD(PATH_FILEPATH, "filepath"), e_uss),
+};
+static const RTNODE n_fs_slash[] = {
+	RT_INNER(RT_TEXT("/"), n_uss_path),
+};
+static const RTLEAF e_uss_list[] = { { GET, ROUTE_USS_LIST } };
+
+static const RTNODE n_restfiles_kids[] = {
+	RT_NODE(RT_TEXT("ds"), n_ds_slash, e_ds_list),
+	RT_NODE(RT_TEXT("fs"), n_fs_slash, e_uss_list),
+};
+
+/*
+ * /zosmf/restconsoles/consoles/{console-name}[/solmsgs/..|/detections/..]
+ * /zosmf/restconsoles/v1/log
+ */
+static const RTLEAF e_cons_collect[] = { { GET, ROUTE_CONS_COLLECT } };
+static const RTNODE n_cons_collect_key[] = {
+	RT_LEAFNODE(RT_CAPTURE(PATH_CMD_RESPONSE_KEY, "cmd-response-key"), e_cons_collect),
+};
+static const RTLEAF e_cons_detect[] = { { GET, ROUTE_CONS_DETECT } };
+static const RTNODE n_cons_detect_key[] = {
+	RT_LEAFNODE(RT_CAPTURE(PATH_DETECTION_KEY, "detection-key"), e_cons_detect),
+};
+static const RTNODE n_cons_kids[] = {
+	RT_INNER(RT_TEXT("solmsgs/"), n_cons_collect_key),
+	RT_INNER(RT_TEXT("detections/"), n_cons_detect_key),
+};
+static const RTNODE n_cons_slash[] = {
+	RT_INNER(RT_TEXT("/"), n_cons_kids),
+};
+static const RTLEAF e_cons_issue[] = { { PUT, ROUTE_CONS_ISSUE } };
+static const RTNODE n_cons_name[] = {
+	RT_NODE(RT_CAPTURE(PATH_CONSOLE_NAME, "console-name"), n_cons_slash, e_cons_issue),
+};
+static const RTLEAF e_cons_log[] = { { GET, ROUTE_CONS_LOG } };
+static const RTNODE n_restconsoles_kids[] = {
+	RT_INNER(RT_TEXT("consoles/"), n_cons_name),
+	RT_LEAFNODE(RT_TEXT("v1/log"), e_cons_log),
+};
+
+static const RTNODE n_rest_kids[] = {
+	RT_NODE(RT_TEXT("jobs/jobs"), n_jobs_slash, e_jobs),
+	RT_INNER(RT_TEXT("files/"), n_restfiles_kids),
+	RT_INNER(RT_TEXT("consoles/"), n_restconsoles_kids),
+};
+
+/*
+ * /zosmf/info, /zosmf/test[/wildcard/{*filepath}], /zosmf/services/...
+ */
+static const RTLEAF e_test_wildcard[] = { { GET, ROUTE_TEST_WILDCARD } };
+static const RTNODE n_test_wildcard_path[] = {
+	RT_LEAFNODE(RT_WILDCARD(PATH_FILEPATH, "filepath"), e_test_wildcard),
+};
+static const RTNODE n_test_kids[] = {
+	RT_INNER(RT_TEXT("/wildcard/"), n_test_wildcard_path),
+};
+static const RTLEAF e_test[] = { { GET, ROUTE_TEST } };
+static const RTLEAF e_info[] = { { GET, ROUTE_INFO } };
+static const RTLEAF e_auth[] = {
+	{ POST,   ROUTE_AUTH_LOGIN },
+	{ DELETE, ROUTE_AUTH_LOGOUT },
+};
+
+static const RTNODE n_zosmf_kids[] = {
+	RT_LEAFNODE(RT_TEXT("info"), e_info),
+	RT_NODE(RT_TEXT("test"), n_test_kids, e_test),
+	RT_LEAFNODE(RT_TEXT("services/authenticate"), e_auth),
+	RT_INNER(RT_TEXT("rest"), n_rest_kids),
+};
+
+static const RTNODE n_root = RT_INNER(RT_TEXT("/zosmf/"), n_zosmf_kids);
+
+static const ROUTETAB routes = { &n_root, route_defs, ROUTE_COUNT };
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'mvsmf_routes'");
+#endif
+const ROUTETAB *
+mvsmf_routes(void)
+{
+	return &routes;
+}
@@ -0,0 +1,158 @@
+/*
+ * routetab.c - the trie dispatcher behind the const route table.
+ *
+ * See include/routetab.h for the table layout and why it is data rather
+ * than a list of add_route() calls.
+ *
+ * Portable C on purpose: no httpd headers, no MVS services, no statics. The
+ * host test #includes it (test/host/tstrout.c) so the walk it drives is the
+ * one that runs on MVS, not a copy of it.
+ */
+
+#include <stddef.h>
+
+#include "routetab.h"
+
+/*
+ * Match `node`'s edge at `p`, then the rest of the path below it. Returns
+ * the route id, or -1. Captures are recorded into m->caps[ncap..] on the way
+ * down; a branch that fails simply leaves its slots to be overwritten by the
+ * next one, and only the successful leaf sets m->ncaps. Recursion is bounded
+ * by the depth of the table (a dozen edges at most), not by the path.
+ */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'rt_walk'");
+#endif
+static int
+rt_walk(const RTNODE *node, int method, const char *path, const char *p,
+	RTMATCH *m, int ncap)
+{
+	const char *start = p;
+	const char *t;
+	int len;
+	int i;
+	int rc;
+
+	switch (node->kind) {
+	case RT_LIT:
+		for (t = node->text; *t; t++, p++) {
+			if (*p != *t) {
+				return -1;
+			}
+		}
+		break;
+
+	case RT_VAR:
+		/* Not at the very end of the path: the old matcher stopped as
+		   soon as the path ran out, and a {name} left in the pattern
+		   failed it. Mid-path an empty capture was, and is, accepted. */
+		if (!*p) {
+			return -1;
+		}
+		while (*p && *p != '/' && *p != '(' && *p != ')') {
+			p++;
+		}
+		break;
+
+	case RT_REST:
+		while (*p) {
+			p++;
+		}
+		break;
+
+	default:
+		return -1;
+	}
+
+	if (node->kind != RT_LIT) {
+		/* a table deeper than RTMATCH can hold is a table bug; the
+		   host test reaches every route, so it cannot ship */
+		if (ncap >= RT_MAX_CAPS) {
+			return -1;
+		}
+
+		/* Trim trailing blanks - clients like Zowe Explorer may pad
+		   names with blanks (e.g. member names to 8 chars) */
+		len = (int) (p - start);
+		while (len > 0 && start[len - 1] == ' ') {
+			len--;
+		}
+
+		m->caps[ncap].name = node->text;
+		m->caps[ncap].var = node->var;
+		m->caps[ncap].off = (unsigned short) (start - path);
+		m->caps[ncap].len = (unsigned short) len;
+		ncap++;
+	}
+
+	if (!*p) {
+		for (i = 0; i < node->nleaves; i++) {
+			if (node->leaves[i].method == method) {
+				m->ncaps = ncap;
+				return node->leaves[i].route;
+			}
+		}
+		/* No route of this method ends here -- but an {*name} below
+		   would still match the empty rest, so keep going. */
+	}
+
+	for (i = 0; i < node->nkids; i++) {
+		rc = rt_walk(&node->kids[i], method, path, p, m, ncap);
+		if (rc >= 0) {
+			return rc;
+		}
+	}
+
+	return -1;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'rt_match'");
+#endif
+int
+rt_match(const ROUTETAB *tab, HttpMethod method, const char *path,
+	RTMATCH *match)
+{
+	RTMATCH scratch;
+	RTMATCH *m = match ? match : &scratch;
+	int rc;
+
+	m->route = -1;
+	m->ncaps = 0;
+
+	if (!tab || !tab->root || !path) {
+		return -1;
+	}
+
+	rc = rt_walk(tab->root, (int) method, path, path, m, 0);
+
+	/* A leaf naming a route the table does not define is a table bug;
+	   answer it as no route rather than index past the end. */
+	if (rc >= tab->count) {
+		rc = -1;
+	}
+
+	if (rc < 0) {
+		m->ncaps = 0;
+	}
+	m->route = rc;
+
+	return rc;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'rt_split'");
+#endif
+void
+rt_split(char *path, const RTMATCH *match)
+{
+	int i;
+
+	if (!path || !match) {
+		return;
+	}
+
+	for (i = 0; i < match->ncaps; i++) {
+		path[match->caps[i].off + match->caps[i].len] = '\0';
+	}
+}
@@ -2,13 +2,16 @@
  * sendall.c - the send loop and its no-progress policy (issue #298).
  *
  * See include/sendall.h for why this is its own TU and why the loop never
- * advances by the return value without checking it first.
+ * advances by the return value without checking it first, and for the
+ * coalescing buffer that sits in front of the loop.
  *
  * Portable C on purpose: no httpd headers, no MVS services, no statics. The
  * host test #includes it (test/host/tstsend.c) so the loop it drives is the
  * one that runs on MVS, not a copy of it.
  */
 
+#include <string.h>
+
 #include "sendall.h"
 
 #ifdef __MVS__
@@ -65,3 +68,101 @@ send_bytes(void *ctx, const SEND_OPS *ops, const unsigned char *buf, int len)
 
 	return 0;
 }
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'sendbuf_init'");
+#endif
+void
+sendbuf_init(SEND_BUF *sb, unsigned char *storage, int size)
+{
+	memset(sb, 0, sizeof(*sb));
+	if (storage && size > 0) {
+		sb->buf = storage;
+		sb->size = size;
+	}
+}
+
+/* One send_bytes() call, counted; a failure is final. */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'sendbuf_send'");
+#endif
+static int
+sendbuf_send(SEND_BUF *sb, void *ctx, const SEND_OPS *ops,
+	const unsigned char *buf, int len)
+{
+	sb->flushes++;
+	if (send_bytes(ctx, ops, buf, len) < 0) {
+		sb->failed = 1;
+		sb->len = 0;
+		return -1;
+	}
+	sb->sent += (unsigned long) len;
+	return 0;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'sendbuf_flush'");
+#endif
+int
+sendbuf_flush(SEND_BUF *sb, void *ctx, const SEND_OPS *ops)
+{
+	int len = sb->len;
+
+	if (sb->failed) {
+		return -1;
+	}
+	if (len == 0) {
+		return 0;
+	}
+
+	sb->len = 0;
+	return sendbuf_send(sb, ctx, ops, sb->buf, len);
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'sendbuf_write'");
+#endif
+int
+sendbuf_write(SEND_BUF *sb, void *ctx, const SEND_OPS *ops,
+	const unsigned char *buf, int len)
+{
+	int room;
+
+	if (sb->failed) {
+		return -1;
+	}
+	if (len <= 0) {
+		return 0;
+	}
+
+	/* no storage: every write is its own send, as before the buffer */
+	if (!sb->buf) {
+		return sendbuf_send(sb, ctx, ops, buf, len);
+	}
+
+	if (SENDBUF_FITS(sb, len)) {
+		memcpy(sb->buf + sb->len, buf, len);
+		sb->len += len;
+		return 0;
+	}
+
+	/* A write the size of the buffer or more: what is pending first, then
+	   the write itself, straight from the caller's storage. */
+	if (len >= sb->size) {
+		if (sendbuf_flush(sb, ctx, ops) < 0) {
+			return -1;
+		}
+		return sendbuf_send(sb, ctx, ops, buf, len);
+	}
+
+	/* Otherwise top the buffer up, so every send but the last is full. */
+	room = sb->size - sb->len;
+	memcpy(sb->buf + sb->len, buf, room);
+	sb->len = sb->size;
+	if (sendbuf_flush(sb, ctx, ops) < 0) {
+		return -1;
+	}
+	memcpy(sb->buf, buf + room, len - room);
+	sb->len = len - room;
+	return 0;
+}
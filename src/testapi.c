@@ -16,7 +16,9 @@
 #include "common.h"
 #include "httpcgi.h"
 #include "testapi.h"
+#include "routes.h"
 #include "mvsmfmsg.h"
+#include "mvsmfctx.h"          /* mvsmf_metrics */
 #include "zosmferr.h"          /* CATEGORY_SERVICE, REASON_SERVER_ERROR */
 #include "buildid.h"           /* generated by the Makefile: #define BUILD_ID "<hash>" */
 
@@ -385,6 +387,48 @@ static void stg_comb(unsigned sp, unsigned *sizes, int max_sizes, int *nsizes,
   }
 }
 
+/* --- fn=metrics ----------------------------------------------------------
+ * The per-route counters and latency histograms the router keeps in MVSMF_CTX
+ * (metrics.h), as JSON, or with format=prometheus in the Prometheus text
+ * format for a scraper. Read without the latch -- see metrics.h for why a
+ * torn read is acceptable here. Handled before the generic JSON headers,
+ * because the Prometheus form is not JSON.
+ */
+__asm__("\n&FUNC	SETC 'met_emit'");
+static int met_emit(void *ctx, const char *text) {
+  Session *session = (Session *)ctx;
+
+  return http_printf(session->httpc, "%s", text);
+}
+
+__asm__("\n&FUNC	SETC 'testMetrics'");
+static int testMetrics(Session *session) {
+  MVSMF_METRICS *m = mvsmf_metrics(session->httpd);
+  const char *format = getQueryParam(session, "format");
+  int prom = format && (strcmp(format, "prometheus") == 0 ||
+                        strcmp(format, "prom") == 0);
+  int rc;
+
+  if (!m) {
+    return sendErrorResponse(
+        session, HTTP_STATUS_INTERNAL_SERVER_ERROR, CATEGORY_SERVICE,
+        RC_ERROR, REASON_SERVER_ERROR,
+        "fn=metrics: no metrics block (httpd cgictx service unavailable)",
+        NULL, 0);
+  }
+
+  session->headers_sent = 1;
+  if ((rc = session_resp(session, 200)) < 0)
+    return rc;
+  if ((rc = http_printf(session->httpc, "Content-Type: %s\r\n\r\n",
+                        prom ? "text/plain; version=0.0.4"
+                             : "application/json")) < 0)
+    return rc;
+
+  return prom ? metrics_render_prom(m, mvsmf_routes(), met_emit, session)
+              : metrics_render_json(m, mvsmf_routes(), met_emit, session);
+}
+
 int testHandler(Session *session) {
   int rc = 0;
   char *fn = NULL;
@@ -405,8 +449,11 @@ int testHandler(Session *session) {
   if (strcmp(fn, "denyopen") == 0)
     return testDenyOpen(session);
 
+  if (strcmp(fn, "metrics") == 0)
+    return testMetrics(session);
+
   session->headers_sent = 1;
-  if ((rc = http_resp(session->httpc, 200)) < 0)
+  if ((rc = session_resp(session, 200)) < 0)
     goto quit;
   if ((rc = http_printf(session->httpc,
                         "Content-Type: application/json\r\n\r\n")) < 0)
@@ -1449,6 +1496,7 @@ int testHandler(Session *session) {
         session->httpc,
         "{ \"fn\": \"help\", \"usage\": ["
         " \"?fn=version             (deployed version + git build id)\","
+        " \"?fn=metrics&format=json|prometheus (per-route counts, status classes, bytes, latency histograms)\","
         " \"?fn=listds&level=HLQ&filter=HLQ.X*\","
         " \"?fn=locate&dsn=SYS1.MACLIB\","
         " \"?fn=dscb&dsn=DS        (format-1 DSCB space fields incl. secondary)\","
@@ -1478,13 +1526,12 @@ int testWildcardHandler(Session *session) {
   int rc = 0;
   char *filepath = NULL;
 
-  filepath =
-      (char *)http_get_env(session->httpc, (const UCHAR *)"HTTP_filepath");
+  filepath = getPathVar(session, PATH_FILEPATH);
   if (!filepath)
     filepath = "(null)";
 
   session->headers_sent = 1;
-  if ((rc = http_resp(session->httpc, 200)) < 0)
+  if ((rc = session_resp(session, 200)) < 0)
     goto quit2;
   if ((rc = http_printf(session->httpc,
                         "Content-Type: application/json\r\n\r\n")) < 0)
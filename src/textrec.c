@@ -0,0 +1,83 @@
+/*
+ * textrec.c - fixed-length records to text lines, in one pass.
+ *
+ * See include/textrec.h for what it replaces and what it promises.
+ *
+ * Portable C on purpose: no httpd headers, no MVS services, no statics. The
+ * host test #includes it (test/host/tsttrec.c) so the kernel it drives is
+ * the one that runs on MVS, not a copy of it.
+ */
+
+#include <string.h>
+
+#include "textrec.h"
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'textrec_line'");
+#endif
+size_t
+textrec_line(unsigned char *out, const unsigned char *rec, size_t len,
+	unsigned char nl, const unsigned char *xlate)
+{
+	size_t i;
+
+	/* translate as it is copied, four at a time */
+	for (i = 0; i + 4 <= len; i += 4) {
+		out[i]     = xlate[rec[i]];
+		out[i + 1] = xlate[rec[i + 1]];
+		out[i + 2] = xlate[rec[i + 2]];
+		out[i + 3] = xlate[rec[i + 3]];
+	}
+	for (; i < len; i++) {
+		out[i] = xlate[rec[i]];
+	}
+	out[len] = xlate[nl];
+
+	return len + 1;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'textrec_fixed'");
+#endif
+size_t
+textrec_fixed(unsigned char *out, const unsigned char *rec, size_t lrecl,
+	unsigned char pad, unsigned char nl, const unsigned char *xlate)
+{
+	unsigned pads = pad * 0x01010101u;
+	unsigned w;
+	size_t end = lrecl;
+
+	/* The padding a word at a time: memcpy() because a record in a block
+	   sits at any offset, and a fullword compare is what it compiles to. A
+	   word that is not all pad stops the scan, and the bytes finish it. */
+	while (end >= sizeof(w)) {
+		memcpy(&w, rec + end - sizeof(w), sizeof(w));
+		if (w != pads) {
+			break;
+		}
+		end -= sizeof(w);
+	}
+	while (end > 0 && rec[end - 1] == pad) {
+		end--;
+	}
+
+	return textrec_line(out, rec, end, nl, xlate);
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'textrec_block'");
+#endif
+size_t
+textrec_block(unsigned char *out, const unsigned char *recs, size_t nrec,
+	size_t lrecl, unsigned char pad, unsigned char nl,
+	const unsigned char *xlate)
+{
+	size_t o = 0;
+	size_t r;
+
+	for (r = 0; r < nrec; r++) {
+		o += textrec_fixed(out + o, recs + r * lrecl, lrecl, pad, nl, xlate);
+	}
+
+	return o;
+}
@@ -0,0 +1,229 @@
+/*
+ * trace.c - per-request phase spans and their two renderings.
+ *
+ * See include/trace.h for what a span is and where the table lives.
+ *
+ * Portable C on purpose: no httpd headers, no MVS services, no statics. The
+ * host test #includes it (test/host/tsttrace.c) so the recorder it drives is
+ * the one that runs on MVS, not a copy of it.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "trace.h"
+
+/* Room kept for ", total;dur=NNNNNNN.NNN" at the end of the header. */
+#define TRC_TOTAL_RESERVE   32
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'trace_init'");
+#endif
+void
+trace_init(TRC_TRACE *t, unsigned long long now)
+{
+	memset(t, 0, sizeof(*t));
+	t->t0 = now;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'trace_begin'");
+#endif
+int
+trace_begin(TRC_TRACE *t, const char *name, unsigned long long now)
+{
+	TRC_SPAN *s;
+	int i;
+
+	if (!t || !name) {
+		return TRC_NONE;
+	}
+
+	/* by name, not by pointer: the same literal in two TUs need not be
+	   one string */
+	for (i = 0; i < t->nspans; i++) {
+		if (strcmp(t->span[i].name, name) == 0) {
+			break;
+		}
+	}
+
+	if (i == t->nspans) {
+		if (t->nspans >= TRC_SPANS) {
+			t->dropped++;
+			return TRC_NONE;
+		}
+		t->span[t->nspans++].name = name;
+	}
+
+	s = &t->span[i];
+	if (s->start != 0) {
+		/* already open further up the stack: the outer pair counts it */
+		return TRC_NONE;
+	}
+
+	/* A TOD of 0 is 1900; a caller's clock that starts there is a test
+	   clock, and 0 would read as "closed". */
+	s->start = now ? now : 1;
+	return i;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'trace_end'");
+#endif
+void
+trace_end(TRC_TRACE *t, int slot, unsigned long long now)
+{
+	TRC_SPAN *s;
+
+	if (!t || slot < 0 || slot >= t->nspans) {
+		return;
+	}
+
+	s = &t->span[slot];
+	if (s->start == 0) {
+		return;
+	}
+
+	if (now > s->start) {
+		s->total += now - s->start;
+	}
+	s->start = 0;
+	s->count++;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'trace_usec'");
+#endif
+unsigned long
+trace_usec(unsigned long long tod)
+{
+	tod >>= 12;
+	return tod > 0xFFFFFFFFUL ? 0xFFFFFFFFUL : (unsigned long) tod;
+}
+
+/* TOD units to milliseconds, for printing. */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'trc_ms'");
+#endif
+static double
+trc_ms(unsigned long long tod)
+{
+	return (double) trace_usec(tod) / 1000.0;
+}
+
+/* Append one formatted entry if it fits whole; returns the new length. */
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'trc_put'");
+#endif
+static int
+trc_put(char *buf, size_t size, int len, const char *entry)
+{
+	size_t n = strlen(entry);
+
+	if ((size_t) len + n + 1 > size) {
+		return len;
+	}
+	memcpy(buf + len, entry, n + 1);
+	return len + (int) n;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'trace_server_timing'");
+#endif
+int
+trace_server_timing(const TRC_TRACE *t, unsigned long long now,
+	char *buf, size_t size)
+{
+	char entry[64];
+	size_t room;
+	int len = 0;
+	int n;
+	int i;
+
+	if (!buf || size == 0) {
+		return 0;
+	}
+	buf[0] = '\0';
+	if (!t) {
+		return 0;
+	}
+
+	room = size > TRC_TOTAL_RESERVE ? size - TRC_TOTAL_RESERVE : 0;
+
+	for (i = 0; i < t->nspans; i++) {
+		const TRC_SPAN *s = &t->span[i];
+
+		/* an open phase has no duration yet, and a zero-count slot is
+		   one whose only begin is still open */
+		if (s->count == 0) {
+			continue;
+		}
+		snprintf(entry, sizeof(entry), "%s%s;dur=%.3f",
+			len ? ", " : "", s->name, trc_ms(s->total));
+		if ((n = trc_put(buf, room, len, entry)) == len) {
+			break;		/* stop at the first that does not fit */
+		}
+		len = n;
+	}
+
+	snprintf(entry, sizeof(entry), "%stotal;dur=%.3f",
+		len ? ", " : "", trc_ms(now > t->t0 ? now - t->t0 : 0));
+	return trc_put(buf, size, len, entry);
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'trace_summary'");
+#endif
+int
+trace_summary(const TRC_TRACE *t, unsigned long long now,
+	char *buf, size_t size)
+{
+	char entry[64];
+	int len = 0;
+	int n;
+	int i;
+
+	if (!buf || size == 0) {
+		return 0;
+	}
+	buf[0] = '\0';
+	if (!t) {
+		return 0;
+	}
+
+	for (i = 0; i < t->nspans; i++) {
+		const TRC_SPAN *s = &t->span[i];
+		unsigned long long total = s->total;
+		unsigned count = s->count;
+		int open = (s->start != 0);
+
+		if (open) {
+			if (now > s->start) {
+				total += now - s->start;
+			}
+			count++;
+		}
+
+		if (count > 1) {
+			snprintf(entry, sizeof(entry), "%s%s=%.1f/%u%s",
+				len ? " " : "", s->name, trc_ms(total), count,
+				open ? "+" : "");
+		} else {
+			snprintf(entry, sizeof(entry), "%s%s=%.1f%s",
+				len ? " " : "", s->name, trc_ms(total),
+				open ? "+" : "");
+		}
+		if ((n = trc_put(buf, size, len, entry)) == len) {
+			break;
+		}
+		len = n;
+	}
+
+	if (t->dropped) {
+		snprintf(entry, sizeof(entry), "%s+%u", len ? " " : "",
+			(unsigned) t->dropped);
+		len = trc_put(buf, size, len, entry);
+	}
+
+	return len;
+}
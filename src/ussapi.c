@@ -11,6 +11,10 @@
 #include "common.h"
 #include "etag.h"
 #include "httpcgi.h"
+#include "lastmod.h"
+#include "listitem.h"
+#include "mvsmfctx.h"	/* mvsmf_etags */
+#include "routes.h"
 
 // Data type constants
 #define USS_DATA_TYPE_TEXT   1
@@ -182,11 +186,8 @@ __asm__("\n&FUNC    SETC 'get_data_type'");
 static int
 get_data_type(Session *session)
 {
-	char *dt = (char *) http_get_env(session->httpc,
-		(const UCHAR *) "HTTP_X-IBM-Data-Type");
-
-	if (!dt) return USS_DATA_TYPE_TEXT;
-	if (strcmp(dt, "binary") == 0) return USS_DATA_TYPE_BINARY;
+	/* "record" has no meaning for a byte stream and reads as text */
+	if (session->req.data_type == DATA_TYPE_BINARY) return USS_DATA_TYPE_BINARY;
 	return USS_DATA_TYPE_TEXT;
 }
 
@@ -210,6 +211,80 @@ uss_build_path(char *buf, size_t bufsz, const char *captured)
 }
 
 
+//
+// uss_etag_key — the path's name in the ETag cache. 0 when it fits; a path
+// too long for an entry is not cached, never cached under a truncated name.
+//
+__asm__("\n&FUNC    SETC 'uss_etag_key'");
+static int
+uss_etag_key(const char *path, char *key)
+{
+	int n = snprintf(key, ETC_KEYMAX, "U:%s", path);
+
+	return (n > 0 && n < ETC_KEYMAX) ? 0 : -1;
+}
+
+//
+// uss_etag_meta — what the cached stamp is checked against: the mtime, size
+// and inode as ufs_stat() reports them, byte for byte. 0 when there is no
+// stat to go on.
+//
+__asm__("\n&FUNC    SETC 'uss_etag_meta'");
+static size_t
+uss_etag_meta(UFS *ufs, const char *path, unsigned char *meta)
+{
+	UFSDLIST st;
+	size_t   m = 0;
+
+	memset(&st, 0, sizeof(st));
+	if (ufs_stat(ufs, path, &st) != UFSD_RC_OK || st.attr[0] == 'd') {
+		return 0;
+	}
+
+	memcpy(meta + m, &st.mtime, sizeof(st.mtime));
+	m += sizeof(st.mtime);
+	memcpy(meta + m, &st.filesize, sizeof(st.filesize));
+	m += sizeof(st.filesize);
+	memcpy(meta + m, &st.inode_number, sizeof(st.inode_number));
+	m += sizeof(st.inode_number);
+
+	return m;
+}
+
+//
+// uss_lastmod — the file's Last-Modified date: its mtime, to the second
+// (lastmod.h). A file changed in the second that is still running gets no
+// date, since a change later in that second would keep it. 0 with out
+// (LASTMOD_SIZE) and *t filled, -1 for a directory or no stat.
+//
+__asm__("\n&FUNC    SETC 'uss_lastmod'");
+static int
+uss_lastmod(UFS *ufs, const char *path, char *out, unsigned long *t)
+{
+	UFSDLIST   st;
+	struct tm *tm;
+	unsigned long now = (unsigned long) time(NULL);
+	int        year;
+
+	memset(&st, 0, sizeof(st));
+	if (ufs_stat(ufs, path, &st) != UFSD_RC_OK || st.attr[0] == 'd') {
+		return -1;
+	}
+
+	tm = mgmtime64(&st.mtime);
+	if (!tm) {
+		return -1;
+	}
+	year = tm->tm_year + 1900;
+	*t = lm_time(year, lm_yday(year, tm->tm_mon + 1, tm->tm_mday),
+		tm->tm_hour, tm->tm_min, tm->tm_sec);
+	if (*t == 0 || *t >= now) {
+		return -1;
+	}
+
+	return lm_format(*t, out, LASTMOD_SIZE);
+}
+
 //
 // uss_etag — compute the ETag of a USS file (issue #264)
 //
@@ -233,6 +308,16 @@ uss_build_path(char *buf, size_t bufsz, const char *captured)
 //   - It never runs while the same file is open elsewhere in the handler.
 //     Open-hash-close, then open for the body.
 //
+// With MVSMF_ETAG_CACHE set, a stamp is kept across requests against the
+// file's mtime, size and inode (etagcache.h), and while those stay what they
+// were the pass is skipped. They are read before the file is, so a write
+// racing the read leaves an entry that never matches again.
+//
+// The GET passes `keep`: the bytes read are kept as well, up to KEEP_MAX
+// (common.h), and keep->whole says the whole file is there to send without
+// opening it again. A cache hit reads nothing and keeps nothing. The PUT
+// passes NULL.
+//
 // Returns 0 with out filled. On failure returns -1 and sets *ufs_rc to the
 // UFSD diagnosis, which the caller needs: a path that is a directory is a
 // different answer from a path that is not there (see uss_check_if_match).
@@ -242,14 +327,32 @@ uss_build_path(char *buf, size_t bufsz, const char *captured)
 
 __asm__("\n&FUNC    SETC 'uss_etag'");
 static int
-uss_etag(UFS *ufs, const char *path, char *out, size_t outlen, int *ufs_rc)
+uss_etag(Session *session, UFS *ufs, const char *path, char *out,
+         size_t outlen, int *ufs_rc, KEEPBUF *keep)
 {
-	ETAGCTX  ctx;
-	UFSFILE *fp;
-	char     buf[USS_ETAG_BUFSZ];
-	UINT32   n;
+	ETAGCTX     ctx;
+	UFSFILE    *fp;
+	ETAG_CACHE *cache = mvsmf_etags(session->httpd);
+	char        key[ETC_KEYMAX];
+	unsigned char meta[ETC_METAMAX];
+	size_t      mlen = 0;
+	char        buf[USS_ETAG_BUFSZ];
+	UINT32      n;
+	int         keeping = (keep != NULL);
+	int         rc;
 
 	*ufs_rc = UFSD_RC_NOFILE;
+	if (keep) {
+		memset(keep, 0, sizeof(*keep));
+	}
+
+	if (cache && outlen >= ETAG_SIZE && uss_etag_key(path, key) == 0) {
+		mlen = uss_etag_meta(ufs, path, meta);
+		if (mlen > 0 && mvsmf_etag_get(cache, key, meta, mlen, out)) {
+			*ufs_rc = UFSD_RC_OK;
+			return 0;
+		}
+	}
 
 	fp = ufs_fopen(ufs, path, "r");
 	if (!fp) {
@@ -265,6 +368,10 @@ uss_etag(UFS *ufs, const char *path, char *out, size_t outlen, int *ufs_rc)
 	etag_init(&ctx);
 	while ((n = ufs_fread(buf, 1, sizeof(buf), fp)) > 0) {
 		etag_update_raw(&ctx, buf, n);
+		// past KEEP_MAX the rest is only hashed, and the GET reads again
+		if (keeping && keep_append(session, keep, buf, n) < 0) {
+			keeping = 0;
+		}
 	}
 
 	// A read that stopped short leaves a stamp over a prefix of the file,
@@ -279,7 +386,15 @@ uss_etag(UFS *ufs, const char *path, char *out, size_t outlen, int *ufs_rc)
 	*ufs_rc = UFSD_RC_OK;
 	ufs_fclose(&fp);
 
-	return etag_final(&ctx, out, outlen);
+	rc = etag_final(&ctx, out, outlen);
+	if (rc == 0 && mlen > 0) {
+		mvsmf_etag_put(cache, key, meta, mlen, out);
+	}
+	if (rc == 0 && keeping) {
+		keep->whole = 1;
+	}
+
+	return rc;
 }
 
 //
@@ -314,12 +429,13 @@ uss_check_if_match(Session *session, UFS *ufs, const char *path)
 	char        current[ETAG_SIZE];
 	int         urc = UFSD_RC_OK;
 
-	if_match = getHeaderParam(session, "If-Match");
+	if_match = session->req.hdr[RQH_IF_MATCH];
 	if (!if_match) {
 		return 0;
 	}
 
-	if (uss_etag(ufs, path, current, sizeof(current), &urc) < 0) {
+	if (uss_etag(session, ufs, path, current, sizeof(current), &urc,
+			NULL) < 0) {
 		UFSDLIST st;
 
 		memset(&st, 0, sizeof(st));
@@ -428,12 +544,12 @@ uss_stat_file(Session *session, UFS *ufs, const char *path)
 
 	// Send single-item response with full path in name
 	session->headers_sent = 1;
-	if ((rc = http_resp(session->httpc, 200)) < 0) goto quit;
+	if ((rc = session_resp(session, 200)) < 0) goto quit;
 	if ((rc = send_common_headers(session)) < 0) goto quit;
 	if ((rc = http_printf(session->httpc, "Content-Type: %s\r\n", "application/json")) < 0) goto quit;
 	if ((rc = http_printf(session->httpc, "\r\n")) < 0) goto quit;
 
-	rc = http_printf(session->httpc,
+	rc = send_printf(session,
 		"{\n"
 		"  \"items\": [\n"
 		"    {\n"
@@ -481,22 +597,21 @@ int ussListHandler(Session *session)
 	unsigned total = 0;
 	int more = 0;
 	char *path = NULL;
-	char *maxitems_str = NULL;
 	UFS *ufs = NULL;
 	UFSDDESC *dd = NULL;
 	UFSDLIST *entry = NULL;
+	int span;
 
 	// Get required path query parameter
-	path = getQueryParam(session, "path");
+	path = (char *) session->req.qry[RQQ_PATH];
 	if (!path || path[0] == '\0') {
 		return sendErrorResponse(session, 400, 2, 8, 1,
 			"Missing required query parameter 'path'", NULL, 0);
 	}
 
 	// Parse optional X-IBM-Max-Items header (0 = unlimited)
-	maxitems_str = getHeaderParam(session, "X-IBM-Max-Items");
-	if (maxitems_str) {
-		maxitems = (unsigned) atoi(maxitems_str);
+	if (session->req.has_max_items) {
+		maxitems = (unsigned) session->req.max_items;
 	}
 
 	// Open UFS session
@@ -506,7 +621,9 @@ int ussListHandler(Session *session)
 	}
 
 	// Open directory — if this fails, path may be a file (stat query)
+	span = session_span_begin(session, "open");
 	dd = ufs_diropen(ufs, path, NULL);
+	session_span_end(session, span);
 	if (!dd) {
 		return uss_stat_file(session, ufs, path);
 	}
@@ -521,18 +638,18 @@ int ussListHandler(Session *session)
 	   there is no ufs_dirrewind(), so measuring up front would cost a close and
 	   a second open of every directory the client puts a limit on. */
 	session->headers_sent = 1;
-	if ((rc = http_resp(session->httpc, 200)) < 0) goto quit;
+	if ((rc = session_resp(session, 200)) < 0) goto quit;
 	if ((rc = send_common_headers(session)) < 0) goto quit;
 	if ((rc = http_printf(session->httpc, "Content-Type: %s\r\n", "application/json")) < 0) goto quit;
 	if ((rc = http_printf(session->httpc, "\r\n")) < 0) goto quit;
 
-	if ((rc = http_printf(session->httpc, "{\n")) < 0) goto quit;
-	if ((rc = http_printf(session->httpc, "  \"items\": [\n")) < 0) goto quit;
+	if ((rc = send_printf(session, "{\n")) < 0) goto quit;
+	if ((rc = send_printf(session, "  \"items\": [\n")) < 0) goto quit;
 
 	// Read directory entries
 	while ((entry = ufs_dirread(dd)) != NULL) {
 		struct tm *tm_info;
-		char mtime_buf[32];
+		JT_VAL v[USI_COUNT];
 
 		// Skip . and ..
 		if (strcmp(entry->name, ".") == 0 ||
@@ -548,54 +665,50 @@ int ussListHandler(Session *session)
 		}
 
 		// Emit JSON object separator
-		if (first) {
-			if ((rc = http_printf(session->httpc, "    {\n")) < 0) goto quit;
-			first = 0;
-		} else {
-			if ((rc = http_printf(session->httpc, "   ,{\n")) < 0) goto quit;
-		}
+		v[USI_SEP].s = first ? "    " : "   ,";
+		first = 0;
 
 		// Format mtime as ISO 8601 (mtime is milliseconds since epoch)
 		tm_info = mgmtime64(&entry->mtime);
 		if (tm_info) {
-			snprintf(mtime_buf, sizeof(mtime_buf),
-				"%04d-%02d-%02dT%02d:%02d:%02dZ",
-				tm_info->tm_year + 1900, tm_info->tm_mon + 1,
-				tm_info->tm_mday, tm_info->tm_hour,
+			v[USI_MDATE].u = JT_YMD(tm_info->tm_year + 1900,
+				tm_info->tm_mon + 1, tm_info->tm_mday);
+			v[USI_MTIME].u = JT_HMS(tm_info->tm_hour,
 				tm_info->tm_min, tm_info->tm_sec);
 		} else {
-			snprintf(mtime_buf, sizeof(mtime_buf), "1970-01-01T00:00:00Z");
+			v[USI_MDATE].u = JT_YMD(1970, 1, 1);
+			v[USI_MTIME].u = 0;
 		}
 
-		// Emit fields matching UFSDLIST → JSON mapping from issue spec
-		if ((rc = http_printf(session->httpc, "      \"name\": \"%s\",\n", entry->name)) < 0) goto quit;
-		if ((rc = http_printf(session->httpc, "      \"mode\": \"%s\",\n", entry->attr)) < 0) goto quit;
-		if ((rc = http_printf(session->httpc, "      \"size\": %u,\n", entry->filesize)) < 0) goto quit;
-		if ((rc = http_printf(session->httpc, "      \"user\": \"%s\",\n", entry->owner)) < 0) goto quit;
-		if ((rc = http_printf(session->httpc, "      \"group\": \"%s\",\n", entry->group)) < 0) goto quit;
-		if ((rc = http_printf(session->httpc, "      \"links\": %u,\n", (unsigned) entry->nlink)) < 0) goto quit;
-		if ((rc = http_printf(session->httpc, "      \"mtime\": \"%s\",\n", mtime_buf)) < 0) goto quit;
-		if ((rc = http_printf(session->httpc, "      \"inode\": %u\n", entry->inode_number)) < 0) goto quit;
+		// Emit fields matching UFSDLIST → JSON mapping from issue spec,
+		// in one pass over the template (listitem.c)
+		v[USI_NAME].s = entry->name;
+		v[USI_MODE].s = entry->attr;
+		v[USI_SIZE].u = entry->filesize;
+		v[USI_USER].s = entry->owner;
+		v[USI_GROUP].s = entry->group;
+		v[USI_LINKS].u = (unsigned) entry->nlink;
+		v[USI_INODE].u = entry->inode_number;
 
-		if ((rc = http_printf(session->httpc, "    }\n")) < 0) goto quit;
+		if ((rc = send_item(session, list_template(LIST_USS), v)) < 0) goto quit;
 
 		emitted++;
 	}
 
 	// Close JSON array and add metadata
-	if ((rc = http_printf(session->httpc, "  ],\n")) < 0) goto quit;
-	if ((rc = http_printf(session->httpc, "  \"returnedRows\": %u,\n", emitted)) < 0) goto quit;
-	if ((rc = http_printf(session->httpc, "  \"totalRows\": %u,\n", total)) < 0) goto quit;
+	if ((rc = send_printf(session, "  ],\n")) < 0) goto quit;
+	if ((rc = send_printf(session, "  \"returnedRows\": %u,\n", emitted)) < 0) goto quit;
+	if ((rc = send_printf(session, "  \"totalRows\": %u,\n", total)) < 0) goto quit;
 	/* The emit loop keeps counting after the page is full, so total is the
 	   whole directory and this is exact -- for the client's limit and for
 	   USS_LIST_DEFAULT_MAX_ITEMS alike, which truncates the same way. */
 	more = (maxitems > 0 && emitted < total);
 	/* only when true -- see the note in datasetListHandler() (#279) */
 	if (more) {
-		if ((rc = http_printf(session->httpc, "  \"moreRows\": true,\n")) < 0) goto quit;
+		if ((rc = send_printf(session, "  \"moreRows\": true,\n")) < 0) goto quit;
 	}
-	if ((rc = http_printf(session->httpc, "  \"JSONversion\": 1\n")) < 0) goto quit;
-	if ((rc = http_printf(session->httpc, "}\n")) < 0) goto quit;
+	if ((rc = send_printf(session, "  \"JSONversion\": 1\n")) < 0) goto quit;
+	if ((rc = send_printf(session, "}\n")) < 0) goto quit;
 
 quit:
 	if (dd) {
@@ -630,9 +743,15 @@ int ussGetHandler(Session *session)
 	const char *etag_hdr = NULL;
 	const char *if_none_match;
 	int want_etag;
+	char lastmod[LASTMOD_SIZE];
+	const char *lastmod_hdr = NULL;
+	unsigned long modified;
+	int unmodified = 0;
+	int span;
+	KEEPBUF keep;
 
 	// Get filepath from path variable and build absolute path
-	raw_path = getPathParam(session, "filepath");
+	raw_path = getPathVar(session, PATH_FILEPATH);
 	if (!raw_path || raw_path[0] == '\0') {
 		return sendErrorResponse(session, 400, 2, 8, 1,
 			"Missing file path", NULL, 0);
@@ -652,10 +771,28 @@ int ussGetHandler(Session *session)
 		return -1;
 	}
 
+	if_none_match = session->req.hdr[RQH_IF_NONE_MATCH];
+	want_etag = session->req.return_etag;
+
+	// Last-Modified from a ufs_stat(), before the file is read (lastmod.h).
+	// The rules are dsapi.c's: If-Modified-Since only without If-None-Match,
+	// and on its own only when the 200 would carry no ETag -- a 304 carries
+	// what the 200 would have.
+	if (uss_lastmod(ufs, abspath, lastmod, &modified) == 0) {
+		lastmod_hdr = lastmod;
+		unmodified = !if_none_match && lm_unmodified(modified,
+			session->req.hdr[RQH_IF_MODIFIED_SINCE],
+			(unsigned long) time(NULL));
+		if (unmodified && !want_etag) {
+			return send_not_modified(session, NULL, lastmod_hdr);
+		}
+	}
+
 	// ETag, if asked for (issue #264). Before the file is opened for the
 	// body: one handle on a path at a time, and the value has to be known
-	// before the first response byte goes out anyway. That costs a second
-	// read pass over the file, which is why it is opt-in.
+	// before the first response byte goes out anyway. For a file of up to
+	// KEEP_MAX the pass keeps what it read and the body is sent from that;
+	// a larger one costs a second read pass, which is why it is opt-in.
 	//
 	// One pass serves both halves of the protocol -- the value returned for
 	// X-IBM-Return-Etag and the comparison for If-None-Match (issue #271).
@@ -668,15 +805,21 @@ int ussGetHandler(Session *session)
 	// no stamp to match. Deliberately no ufs_stat() probe like the write side
 	// has (uss_check_if_match): there a failed hash means 412, so the probe is
 	// load-bearing; here it already means "no ETag, let the open diagnose it".
-	if_none_match = getHeaderParam(session, "If-None-Match");
-	want_etag = etag_requested(getHeaderParam(session, "X-IBM-Return-Etag"));
+	memset(&keep, 0, sizeof(keep));
 
 	if (if_none_match || want_etag) {
 		int urc = UFSD_RC_OK;
+		int hashed;
+
+		span = session_span_begin(session, "etag");
+		hashed = uss_etag(session, ufs, abspath, etag, sizeof(etag), &urc,
+			&keep);
+		session_span_end(session, span);
 
-		if (uss_etag(ufs, abspath, etag, sizeof(etag), &urc) == 0) {
-			if (if_none_match && etag_matches(if_none_match, etag)) {
-				return send_not_modified(session, etag);
+		if (hashed == 0) {
+			if ((if_none_match && etag_matches(if_none_match, etag))
+			    || unmodified) {
+				return send_not_modified(session, etag, lastmod_hdr);
 			}
 			// Either header means the client wants the validator, and this
 			// branch is only reached when one of them was sent -- so the
@@ -687,25 +830,30 @@ int ussGetHandler(Session *session)
 		}
 	}
 
-	// Open file for reading. A NULL handle carries no error of its own —
-	// the diagnosis is on the session (issue #269).
-	fp = ufs_fopen(ufs, abspath, "r");
-	if (!fp) {
-		int urc = uss_open_rc(ufs);
-		rc = sendErrorResponse(session,
-			ufsd_rc_to_http(urc), ufsd_rc_to_category(urc), 8, 1,
-			ufsd_rc_message(urc), NULL, 0);
-		return rc;
-	}
+	// Open file for reading, unless the pass above has all of it. A NULL
+	// handle carries no error of its own — the diagnosis is on the session
+	// (issue #269).
+	if (!keep.whole) {
+		span = session_span_begin(session, "open");
+		fp = ufs_fopen(ufs, abspath, "r");
+		session_span_end(session, span);
+		if (!fp) {
+			int urc = uss_open_rc(ufs);
+			rc = sendErrorResponse(session,
+				ufsd_rc_to_http(urc), ufsd_rc_to_category(urc), 8, 1,
+				ufsd_rc_message(urc), NULL, 0);
+			return rc;
+		}
 
-	// Check for error after open (e.g. ISDIR)
-	if (fp->error != UFSD_RC_OK) {
-		int urc = fp->error;
-		ufs_fclose(&fp);
-		rc = sendErrorResponse(session,
-			ufsd_rc_to_http(urc), ufsd_rc_to_category(urc), 8, 1,
-			ufsd_rc_message(urc), NULL, 0);
-		return rc;
+		// Check for error after open (e.g. ISDIR)
+		if (fp->error != UFSD_RC_OK) {
+			int urc = fp->error;
+			ufs_fclose(&fp);
+			rc = sendErrorResponse(session,
+				ufsd_rc_to_http(urc), ufsd_rc_to_category(urc), 8, 1,
+				ufsd_rc_message(urc), NULL, 0);
+			return rc;
+		}
 	}
 
 	// Send response headers
@@ -714,24 +862,42 @@ int ussGetHandler(Session *session)
 		: "text/plain";
 
 	session->headers_sent = 1;
-	if ((rc = http_resp(session->httpc, 200)) < 0) goto quit;
+	if ((rc = session_resp(session, 200)) < 0) goto quit;
 	if ((rc = send_common_headers(session)) < 0) goto quit;
 	if ((rc = http_printf(session->httpc, "Content-Type: %s\r\n", content_type)) < 0) goto quit;
 	if (etag_hdr) {
 		if ((rc = http_printf(session->httpc, "ETag: %s\r\n", etag_hdr)) < 0) goto quit;
 	}
+	if (lastmod_hdr) {
+		if ((rc = http_printf(session->httpc, "Last-Modified: %s\r\n", lastmod_hdr)) < 0) goto quit;
+	}
 	if ((rc = http_printf(session->httpc, "\r\n")) < 0) goto quit;
 
-	// Stream file content in chunks
-	while ((n = ufs_fread(buf, 1, sizeof(buf), fp)) > 0) {
+	// Stream file content in chunks. One phase for the loop, as in dsapi.c:
+	// the sends inside it are "send" on their own. A kept file goes out in
+	// one piece, translated in place: nothing else reads the buffer.
+	span = session_span_begin(session, "records");
+	if (keep.whole) {
+		if (data_type == USS_DATA_TYPE_TEXT) {
+			http_xlate(keep.buf, (int)keep.used, httpx->xlate_1047->etoa);
+		}
+		if (keep.used > 0) {
+			rc = send_all(session, (const UCHAR *)keep.buf, (int)keep.used);
+		}
+	}
+	while (fp && rc >= 0 && (n = ufs_fread(buf, 1, sizeof(buf), fp)) > 0) {
 		if (data_type == USS_DATA_TYPE_TEXT) {
 			http_xlate((unsigned char *)buf, n, httpx->xlate_1047->etoa);
 		}
 		rc = send_all(session, (const UCHAR *)buf, (int)n);
 		if (rc < 0) {
-			goto quit;
+			break;
 		}
 	}
+	session_span_end(session, span);
+	if (rc < 0) {
+		goto quit;
+	}
 
 	rc = 0;
 
@@ -770,13 +936,13 @@ uss_handle_chtag(Session *session, const char *filepath, const char *body)
 			"- untagged    T=off %s", filepath);
 
 		session->headers_sent = 1;
-		if (http_resp(session->httpc, 200) < 0) return -1;
+		if (session_resp(session, 200) < 0) return -1;
 		if (http_printf(session->httpc,
 			"Content-Type: application/json\r\n") < 0) return -1;
 		if (send_common_headers(session) < 0) return -1;
 		if (http_printf(session->httpc, "\r\n") < 0) return -1;
 
-		if (http_printf(session->httpc,
+		if (send_printf(session,
 			"{\"stdout\":[\"%s\"]}\n", tagline) < 0) return -1;
 
 		return 0;
@@ -809,8 +975,7 @@ uss_handle_utilities(Session *session, const char *filepath)
 
 	// Read request body — try POST_STRING first (HTTPD pre-reads when
 	// Content-Type is set), fall back to socket read otherwise.
-	body = (char *)http_get_env(session->httpc,
-		(const UCHAR *)"POST_STRING");
+	body = (char *)session->req.env[RQE_POST_STRING];
 
 	if (body && *body) {
 		body_len = strlen(body);
@@ -849,10 +1014,37 @@ uss_handle_utilities(Session *session, const char *filepath)
 		"Unsupported utility request", NULL, 0);
 }
 
+//
+// The sink a PUT body is streamed into (receive_body()): the open file.
+// IBM-1047 translation is byte for byte, so a span boundary changes nothing.
+//
+
+typedef struct uss_put {
+	Session	*session;
+	UFSFILE	*fp;
+	int	text;		// ASCII→EBCDIC before the write
+} USS_PUT;
+
+__asm__("\n&FUNC    SETC 'uss_put_sink'");
+static int
+uss_put_sink(void *ctx, char *data, size_t len)
+{
+	USS_PUT *up = ctx;
+	Session *session = up->session;	// for httpx
+
+	if (up->text) {
+		http_xlate((unsigned char *)data, (int)len, httpx->xlate_1047->atoe);
+	}
+	if (ufs_fwrite(data, 1, (UINT32)len, up->fp) != (UINT32)len) {
+		return -1;
+	}
+	return 0;
+}
+
 //
 // ussPutHandler — PUT /zosmf/restfiles/fs/{*filepath}
 //
-// Writes data to a file via ufs_fopen("w") + ufs_fwrite().
+// Streams the body into a file via ufs_fopen("w") + ufs_fwrite().
 // Creates the file if it does not exist.
 // Content-Type application/json dispatches to utilities handler.
 // Text mode (default): ASCII→EBCDIC before write.
@@ -865,17 +1057,16 @@ int ussPutHandler(Session *session)
 	int data_type;
 	char *raw_path = NULL;
 	char abspath[UFS_PATH_MAX];
-	char *body = NULL;
-	size_t body_len = 0;
 	const char *content_type = NULL;
 	UFS *ufs = NULL;
 	UFSFILE *fp = NULL;
-	UINT32 written;
+	USS_PUT up;
 	char etag[ETAG_SIZE] = {0};
 	const char *etag_hdr = NULL;
+	int span;
 
 	// Get filepath from path variable and build absolute path
-	raw_path = getPathParam(session, "filepath");
+	raw_path = getPathVar(session, PATH_FILEPATH);
 	if (!raw_path || raw_path[0] == '\0') {
 		return sendErrorResponse(session, 400, 2, 8, 1,
 			"Missing file path", NULL, 0);
@@ -887,7 +1078,7 @@ int ussPutHandler(Session *session)
 	}
 
 	// Check Content-Type: application/json → dispatch to utilities handler
-	content_type = getHeaderParam(session, "Content-Type");
+	content_type = session->req.hdr[RQH_CONTENT_TYPE];
 	if (content_type && strstr(content_type, "application/json") != NULL) {
 		return uss_handle_utilities(session, abspath);
 	}
@@ -895,43 +1086,54 @@ int ussPutHandler(Session *session)
 	// Determine data type from X-IBM-Data-Type header
 	data_type = get_data_type(session);
 
-	// Read request body (supports Content-Length and chunked encoding)
-	if (read_request_content(session, &body, &body_len) < 0) {
-		sendErrorResponse(session, 400, 2, 8, 1,
+	// A body without Content-Length or chunked framing cannot be read at all
+	if (!session->req.chunked && !session->req.has_length) {
+		return sendErrorResponse(session, 400, 2, 8, 1,
 			"Failed to read request body", NULL, 0);
-		return -1;
 	}
-	// An empty body is valid: it truncates the file to zero length (e.g. Zowe
-	// saving an emptied file, or uploading a touch'd file). The dataset PUT
-	// handler allows this too, so do not reject body_len == 0 here.
 
-	// Text mode: ASCII→EBCDIC (IBM-1047) before writing
-	if (data_type == USS_DATA_TYPE_TEXT) {
-		http_xlate((unsigned char *)body, (int)body_len, httpx->xlate_1047->atoe);
+	// A coding receive_body() does not take: refused before the "w" open
+	if (session->req.content_coding == CODING_UNKNOWN) {
+		drain_body(session);
+		return sendErrorResponse(session, 400, 2, 8, 1,
+			"Unsupported Content-Encoding", NULL, 0);
 	}
 
 	// Open UFS session
 	ufs = uss_get_ufs(session);
 	if (!ufs) {
-		free(body);
+		drain_body(session);
 		return -1;
 	}
 
 	// If-Match, before the file is opened for output (issue #264). The "w"
 	// open truncates, so a precondition checked after it would already have
-	// destroyed the content it exists to protect. The body is read first
-	// regardless -- leaving it in the socket would break the connection for
-	// the next request on it.
+	// destroyed the content it exists to protect. Every exit before the body
+	// is streamed still drains it -- leaving it in the socket would break the
+	// connection for the next request on it.
 	if (uss_check_if_match(session, ufs, abspath) < 0) {
-		free(body);
+		drain_body(session);
 		return 0;
 	}
 
+	// The open truncates: a stamp kept for the old content goes first, so no
+	// later GET can be answered from it whatever the stat says by then.
+	{
+		char key[ETC_KEYMAX];
+
+		if (uss_etag_key(abspath, key) == 0) {
+			mvsmf_etag_put(mvsmf_etags(session->httpd), key, NULL, 0, NULL);
+		}
+	}
+
 	// Open file for writing (creates if not exists). A NULL handle carries no
 	// error of its own — the diagnosis is on the session (issue #269).
+	span = session_span_begin(session, "open");
 	fp = ufs_fopen(ufs, abspath, "w");
+	session_span_end(session, span);
 	if (!fp) {
 		int urc = uss_open_rc(ufs);
+		drain_body(session);
 		rc = sendErrorResponse(session,
 			ufsd_rc_to_http(urc), ufsd_rc_to_category(urc), 8, 1,
 			ufsd_rc_message(urc), NULL, 0);
@@ -943,16 +1145,27 @@ int ussPutHandler(Session *session)
 		int urc = fp->error;
 		ufs_fclose(&fp);
 		fp = NULL;
+		drain_body(session);
 		rc = sendErrorResponse(session,
 			ufsd_rc_to_http(urc), ufsd_rc_to_category(urc), 8, 1,
 			ufsd_rc_message(urc), NULL, 0);
 		goto quit;
 	}
 
-	// Write body to file (an empty body just truncates: the "w" open above
-	// already set the file to zero length, so skip the zero-length write)
-	written = body_len ? ufs_fwrite(body, 1, (UINT32)body_len, fp) : 0;
-	if (written != (UINT32)body_len) {
+	// Stream the body into the file as it arrives (receive_body()), with no
+	// copy of it in storage whatever its size. Text is translated ASCII→EBCDIC
+	// (IBM-1047) a span at a time. An empty body writes nothing: the "w" open
+	// above already set the file to zero length, which is the truncate Zowe
+	// relies on when it saves an emptied file. The phase is the client's
+	// pace and the write's together now.
+	memset(&up, 0, sizeof(up));
+	up.session = session;
+	up.fp = fp;
+	up.text = (data_type == USS_DATA_TYPE_TEXT);
+	span = session_span_begin(session, "body");
+	rc = receive_body(session, body_recv_bytes, uss_put_sink, &up);
+	session_span_end(session, span);
+	if (rc == BODY_ESINK) {
 		int urc = fp->error;
 		ufs_fclose(&fp);
 		fp = NULL;
@@ -966,6 +1179,16 @@ int ussPutHandler(Session *session)
 		}
 		goto quit;
 	}
+	if (rc < 0) {
+		// What arrived is in the file, as with the data set PUTs: the
+		// content it replaced went with the "w" open.
+		ufs_fclose(&fp);
+		fp = NULL;
+		rc = sendErrorResponse(session, 400, 2, 8, 1,
+			rc == BODY_ECODING ? "Corrupt Content-Encoding"
+			: "Failed to read request body", NULL, 0);
+		goto quit;
+	}
 
 	// Close before stamping: the write-behind buffer is only flushed here,
 	// so a stamp taken with the file still open would hash a stale tail.
@@ -976,18 +1199,21 @@ int ussPutHandler(Session *session)
 	// file -- never from hashing the request body. The body has been
 	// translated in place by now, and one definition of the stamp is what
 	// makes the value a PUT returns usable as the next If-Match.
-	if (etag_requested(getHeaderParam(session, "X-IBM-Return-Etag"))) {
+	if (session->req.return_etag) {
 		int urc = UFSD_RC_OK;
 
-		if (uss_etag(ufs, abspath, etag, sizeof(etag), &urc) == 0) {
+		span = session_span_begin(session, "etag");
+		if (uss_etag(session, ufs, abspath, etag, sizeof(etag), &urc,
+				NULL) == 0) {
 			etag_hdr = etag;
 		}
+		session_span_end(session, span);
 	}
 
 	// Success — 204 No Content. Hand-rolled rather than via
 	// sendDefaultHeaders(), which has nowhere to put the ETag.
 	session->headers_sent = 1;
-	if ((rc = http_resp(session->httpc, 204)) < 0) goto quit;
+	if ((rc = session_resp(session, 204)) < 0) goto quit;
 	if ((rc = send_common_headers(session)) < 0) goto quit;
 	if (etag_hdr) {
 		if ((rc = http_printf(session->httpc, "ETag: %s\r\n", etag_hdr)) < 0) goto quit;
@@ -998,7 +1224,6 @@ quit:
 	if (fp) {
 		ufs_fclose(&fp);
 	}
-	free(body);
 
 	return rc;
 }
@@ -1098,7 +1323,7 @@ int ussCreateHandler(Session *session)
 	UFSDDESC *dd = NULL;
 
 	// Get filepath from path variable and build absolute path
-	raw_path = getPathParam(session, "filepath");
+	raw_path = getPathVar(session, PATH_FILEPATH);
 	if (!raw_path || raw_path[0] == '\0') {
 		return sendErrorResponse(session, 400, 2, 8, 1,
 			"Missing file path", NULL, 0);
@@ -1112,8 +1337,7 @@ int ussCreateHandler(Session *session)
 	// Read request body — try POST_STRING first (HTTPD pre-reads when
 	// Content-Type is set), fall back to socket read otherwise.
 	// POST_STRING is already in EBCDIC; socket data needs conversion.
-	body = (char *)http_get_env(session->httpc,
-		(const UCHAR *)"POST_STRING");
+	body = (char *)session->req.env[RQE_POST_STRING];
 
 	if (body && *body) {
 		body_len = strlen(body);
@@ -1306,7 +1530,7 @@ int ussDeleteHandler(Session *session)
 	UFS *ufs = NULL;
 
 	// Get filepath from path variable and build absolute path
-	raw_path = getPathParam(session, "filepath");
+	raw_path = getPathVar(session, PATH_FILEPATH);
 	if (!raw_path || raw_path[0] == '\0') {
 		return sendErrorResponse(session, 400, 2, 8, 1,
 			"Missing file path", NULL, 0);
@@ -1318,7 +1542,7 @@ int ussDeleteHandler(Session *session)
 	}
 
 	// Check X-IBM-Option header for recursive delete
-	option = getHeaderParam(session, "X-IBM-Option");
+	option = session->req.hdr[RQH_X_IBM_OPTION];
 	if (option && strcmp(option, "recursive") == 0) {
 		is_recursive = 1;
 	}
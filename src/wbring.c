@@ -0,0 +1,112 @@
+/*
+ * wbring.c - write-behind: a ring of finished blocks for the writer subtask.
+ *
+ * See include/wbring.h for the hand-over and what a failed write does.
+ *
+ * Portable C on purpose: no httpd headers, no MVS services, no statics. The
+ * host test #includes it (test/host/tstwbr.c) so the ring it drives is the
+ * one that runs on MVS, not a copy of it.
+ */
+
+#include <string.h>
+
+#include "wbring.h"
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'wbring_init'");
+#endif
+void
+wbring_init(WBRING *wb, unsigned char **bufs, unsigned nslot, size_t size)
+{
+	unsigned i;
+
+	memset(wb, 0, sizeof(*wb));
+	if (nslot > WBRING_MAX) {
+		nslot = WBRING_MAX;
+	}
+	for (i = 0; i < nslot; i++) {
+		wb->slot[i].buf = bufs[i];
+	}
+	wb->nslot = nslot;
+	wb->size = size;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'wbring_put'");
+#endif
+int
+wbring_put(WBRING *wb, const void *data, size_t len, int flush)
+{
+	unsigned i = wb->put;
+
+	if (wb->failed || len > wb->size) {
+		return -1;
+	}
+	if (wb->slot[i].full) {
+		wb->put_waits++;
+		return WBR_WAIT;
+	}
+
+	memcpy(wb->slot[i].buf, data, len);
+	wb->slot[i].len = len;
+	wb->slot[i].flush = flush;
+	wb->blocks++;
+	wb->put = (i + 1) % wb->nslot;
+	/* last: the writer must not see the slot before its bytes */
+	wb->slot[i].full = 1;
+	return 1;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'wbring_close'");
+#endif
+void
+wbring_close(WBRING *wb)
+{
+	wb->closed = 1;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'wbring_take'");
+#endif
+int
+wbring_take(WBRING *wb, const unsigned char **buf, size_t *len, int *flush)
+{
+	unsigned i = wb->take;
+
+	if (!wb->slot[i].full) {
+		/* closed is set after the last slot is full, so an empty slot
+		   seen here with closed set is the end, not a slot on its way */
+		if (wb->closed && !wb->slot[i].full) {
+			return 0;
+		}
+		wb->take_waits++;
+		return WBR_WAIT;
+	}
+
+	*buf = wb->slot[i].buf;
+	*len = wb->slot[i].len;
+	*flush = wb->slot[i].flush;
+	wb->held = 1;
+	return 1;
+}
+
+#ifdef __MVS__
+__asm__("\n&FUNC    SETC 'wbring_done'");
+#endif
+int
+wbring_done(WBRING *wb, int rc)
+{
+	unsigned i = wb->take;
+
+	if (!wb->held) {
+		return 0;
+	}
+	if (rc < 0) {
+		wb->failed = 1;
+	}
+	wb->held = 0;
+	wb->take = (i + 1) % wb->nslot;
+	wb->slot[i].full = 0;
+	return 1;
+}
@@ -0,0 +1,509 @@
+/*
+ * tstarena.c - the request arena: bump allocation, growth, bulk release.
+ *
+ * An arena that is wrong fails late and far away: two allocations that
+ * overlap corrupt a JSON body or a record two calls later, a chunk not given
+ * back is a slow leak that only a long-running server shows, and a chunk
+ * given back with the wrong length is a FREEMAIN that abends the next
+ * request. So:
+ *
+ *   1. Every allocation is ARENA_ALIGN-aligned, disjoint from every other,
+ *      and a request's worth of small ones costs one chunk.
+ *   2. arena_calloc() zeroes, over storage the chunk source left dirty.
+ *   3. arena_realloc() grows the most recent allocation in place, copies
+ *      anything else, and keeps the contents either way.
+ *   4. A large allocation gets its own chunk without disturbing the shared
+ *      one, and growing it hands the old chunk back at once.
+ *   5. Release puts every chunk back with the length it was got with, is
+ *      idempotent, and leaves the arena usable.
+ *   6. A chunk source that fails: NULL out, the old pointer of a failed
+ *      realloc still valid, and release still balances.
+ *   7. Randomized: tagged allocations and growths against a model, every
+ *      tag intact at the end.
+ *
+ * Then a benchmark: a simulated request (a JSON buffer doubling its way up,
+ * record buffers, a time table) against calloc/realloc/free.
+ *
+ * ====================================================================
+ * This test drives the REAL implementation: src/arena.c is #included
+ * below, so a later refactor stays covered. router.c, whose chunk source is
+ * GETMAIN/FREEMAIN, cannot compile on the host; the source here is malloc,
+ * instrumented.
+ * ====================================================================
+ *
+ * Runs on host via `make test-host`.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <mbtcheck.h>
+
+#include "../../src/arena.c"
+
+#define LIVE_MAX    256
+
+/* The chunk source: malloc, dirtied, with every block remembered so a put
+   of the wrong length (or of something never got) is caught. */
+typedef struct test_src {
+	unsigned gets;
+	unsigned puts;
+	unsigned bad_puts;
+	unsigned fail_after;        /* 0: never fail */
+	unsigned nlive;
+	void    *live[LIVE_MAX];
+	unsigned live_size[LIVE_MAX];
+} TEST_SRC;
+
+static void *
+src_get(void *ctx, unsigned size)
+{
+	TEST_SRC *s = (TEST_SRC *) ctx;
+	void *p;
+
+	if (s->fail_after && s->gets >= s->fail_after) {
+		return NULL;
+	}
+	if (s->nlive >= LIVE_MAX || (p = malloc(size)) == NULL) {
+		return NULL;
+	}
+	memset(p, 0xA5, size);
+	s->live[s->nlive] = p;
+	s->live_size[s->nlive] = size;
+	s->nlive++;
+	s->gets++;
+	return p;
+}
+
+static void
+src_put(void *ctx, void *block, unsigned size)
+{
+	TEST_SRC *s = (TEST_SRC *) ctx;
+	unsigned i;
+
+	s->puts++;
+	for (i = 0; i < s->nlive; i++) {
+		if (s->live[i] == block) {
+			break;
+		}
+	}
+	if (i == s->nlive || s->live_size[i] != size) {
+		s->bad_puts++;
+		return;
+	}
+	s->live[i] = s->live[s->nlive - 1];
+	s->live_size[i] = s->live_size[s->nlive - 1];
+	s->nlive--;
+	free(block);
+}
+
+static const ARENA_OPS test_ops = { src_get, src_put };
+
+/* For the benchmark: malloc and free and a count, nothing else -- the
+   checks above would be timed along with the arena otherwise. */
+static void *
+bench_get(void *ctx, unsigned size)
+{
+	(*(unsigned *) ctx)++;
+	return malloc(size);
+}
+
+static void
+bench_put(void *ctx, void *block, unsigned size)
+{
+	(void) ctx;
+	(void) size;
+	free(block);
+}
+
+static const ARENA_OPS bench_ops = { bench_get, bench_put };
+
+static void
+src_init(TEST_SRC *s, ARENA *a)
+{
+	memset(s, 0, sizeof(*s));
+	arena_init(a, &test_ops, s);
+}
+
+/* One allocation of the randomized run: where, how big, and its tag. */
+typedef struct model {
+	unsigned char *p;
+	size_t         size;
+	unsigned char  tag;
+} MODEL;
+
+static int
+tag_intact(const MODEL *m)
+{
+	size_t i;
+
+	for (i = 0; i < m->size; i++) {
+		if (m->p[i] != m->tag) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static int
+is_aligned(const void *p)
+{
+	return ((size_t) p % ARENA_ALIGN) == 0;
+}
+
+int
+main(void)
+{
+	TEST_SRC src;
+	ARENA a;
+	char *p;
+	char *q;
+	char *r;
+	int i;
+
+	printf("--- bump allocation ---\n");
+	{
+		static const size_t sizes[] = { 1, 7, 8, 9, 80, 133, 256, 1023 };
+		char *prev = NULL;
+		size_t prev_size = 0;
+		int ok_align = 1;
+		int ok_disjoint = 1;
+
+		src_init(&src, &a);
+		CHECK(a.head == NULL && src.gets == 0, "init takes no storage");
+
+		for (i = 0; i < (int) (sizeof(sizes) / sizeof(sizes[0])); i++) {
+			p = arena_alloc(&a, sizes[i]);
+			if (!p || !is_aligned(p)) {
+				ok_align = 0;
+				continue;
+			}
+			if (prev && p < prev + prev_size) {
+				ok_disjoint = 0;
+			}
+			memset(p, i, sizes[i]);
+			prev = p;
+			prev_size = sizes[i];
+		}
+		CHECK(ok_align, "every allocation aligned");
+		CHECK(ok_disjoint, "each one past the end of the last");
+		CHECK_EQ(src.gets, 1u, "all of them from one chunk");
+		CHECK_EQ(a.allocs, 8u, "allocations counted");
+
+		p = arena_alloc(&a, 0);
+		q = arena_alloc(&a, 0);
+		CHECK(p && q && p != q, "size 0 is a distinct allocation");
+		CHECK(arena_alloc(&a, ARN_MAX + 1) == NULL, "over 16 MB refused");
+		CHECK(arena_alloc(NULL, 8) == NULL, "no arena, no storage");
+
+		/* fill the shared chunk until it turns over */
+		for (i = 0; i < 100; i++) {
+			if (!arena_alloc(&a, 1000)) {
+				break;
+			}
+		}
+		CHECK_EQ(src.gets, 2u, "a full chunk is followed by one new one");
+		CHECK(a.high == 2 * ARENA_CHUNK_SIZE, "high-water mark is both");
+
+		arena_release(&a);
+		CHECK_EQ(src.puts, 2u, "release puts both");
+		CHECK_EQ(src.bad_puts, 0u, "with their lengths");
+	}
+
+	printf("\n--- calloc ---\n");
+	{
+		int zero = 1;
+
+		src_init(&src, &a);
+		p = arena_alloc(&a, 40);
+		memset(p, 0xFF, 40);
+		q = arena_calloc(&a, 300);
+		for (i = 0; i < 300; i++) {
+			if (q[i] != 0) {
+				zero = 0;
+			}
+		}
+		CHECK(zero, "calloc zeroes over a dirty chunk");
+		CHECK((unsigned char) p[39] == 0xFF, "and not its neighbour");
+		arena_release(&a);
+	}
+
+	printf("\n--- realloc ---\n");
+	{
+		int kept = 1;
+
+		src_init(&src, &a);
+		p = arena_alloc(&a, 100);
+		memset(p, 'x', 100);
+		q = arena_realloc(&a, p, 100, 1000);
+		CHECK(q == p, "the most recent allocation grows in place");
+		q = arena_realloc(&a, q, 1000, 500);
+		CHECK(q == p, "and shrinks in place");
+		r = arena_alloc(&a, 16);
+		CHECK(r == p + 504 || r == p + 500, "shrinking gave the tail back");
+
+		q = arena_realloc(&a, p, 500, 2000);
+		CHECK(q != p, "an earlier one is copied");
+		for (i = 0; i < 100; i++) {
+			if (q[i] != 'x') {
+				kept = 0;
+			}
+		}
+		CHECK(kept, "with its contents");
+		CHECK(is_aligned(q), "to an aligned address");
+
+		q = arena_realloc(&a, NULL, 0, 64);
+		CHECK(q != NULL && is_aligned(q), "NULL is an allocation");
+		CHECK_EQ(src.gets, 1u, "all of it in the first chunk");
+
+		/* the JSON pattern: a buffer doubling while nothing else is
+		   allocated stays where it is until the chunk runs out */
+		arena_release(&a);
+		p = arena_alloc(&a, 1024);
+		for (i = 2048; i <= ARENA_LARGE; i *= 2) {
+			q = arena_realloc(&a, p, i / 2, i);
+			if (q != p) {
+				break;
+			}
+		}
+		CHECK(i > ARENA_LARGE, "doubling to a quarter chunk never copies");
+		arena_release(&a);
+		CHECK_EQ(src.bad_puts, 0u, "no put with a wrong length");
+		CHECK_EQ(src.nlive, 0u, "nothing held");
+	}
+
+	printf("\n--- large allocations ---\n");
+	{
+		char *small1;
+		char *small2;
+		unsigned held;
+
+		src_init(&src, &a);
+		small1 = arena_alloc(&a, 64);
+		p = arena_alloc(&a, 32760);
+		CHECK(p != NULL && is_aligned(p), "a 32K record buffer");
+		CHECK_EQ(src.gets, 2u, "in a chunk of its own");
+		CHECK(src.live_size[1] < ARENA_CHUNK_SIZE, "sized to fit");
+		small2 = arena_alloc(&a, 64);
+		CHECK(small2 == small1 + 64, "the shared chunk carries on");
+		CHECK(a.head->large == 0, "and stays the head");
+
+		memset(p, 'L', 32760);
+		held = a.held;
+		q = arena_realloc(&a, p, 32760, 100000);
+		CHECK(q != NULL && q[32759] == 'L', "grown, contents kept");
+		CHECK_EQ(src.puts, 1u, "the old chunk went back at once");
+		CHECK(a.held < held + 100000 + 64, "one copy held, not two");
+
+		arena_release(&a);
+		CHECK_EQ(src.gets, src.puts, "every chunk back");
+		CHECK_EQ(src.bad_puts, 0u, "with its length");
+
+		/* a large one first: it heads the list until a small one comes */
+		src_init(&src, &a);
+		p = arena_alloc(&a, 20000);
+		q = arena_alloc(&a, 10);
+		CHECK(p && q && a.head->large == 0, "small after large gets a shared chunk");
+		CHECK_EQ(src.gets, 2u, "one each");
+		arena_release(&a);
+		CHECK_EQ(src.nlive, 0u, "both back");
+	}
+
+	printf("\n--- release ---\n");
+	{
+		src_init(&src, &a);
+		for (i = 0; i < 50; i++) {
+			arena_alloc(&a, (size_t) (i % 7) * 3000 + 10);
+		}
+		CHECK(src.gets > 1, "several chunks");
+		arena_release(&a);
+		CHECK_EQ(src.gets, src.puts, "every get put");
+		CHECK_EQ(src.bad_puts, 0u, "every put the right length");
+		CHECK_EQ(a.held, 0u, "nothing held");
+		CHECK(a.head == NULL && a.last == NULL, "empty");
+
+		arena_release(&a);
+		CHECK_EQ(src.gets, src.puts, "a second release does nothing");
+		arena_release(NULL);
+
+		p = arena_alloc(&a, 10);
+		CHECK(p != NULL, "usable again after release");
+		arena_release(&a);
+		CHECK_EQ(src.nlive, 0u, "and releasable again");
+	}
+
+	printf("\n--- chunk source failure ---\n");
+	{
+		src_init(&src, &a);
+		src.fail_after = 1;
+		p = arena_alloc(&a, 100);
+		CHECK(p != NULL, "the first chunk came");
+		CHECK(arena_alloc(&a, 30000) == NULL, "a large one fails");
+		CHECK(arena_alloc(&a, ARENA_CHUNK_SIZE - 200) == NULL, "a turnover fails");
+		memset(p, 'k', 100);
+		q = arena_realloc(&a, p, 100, 100000);
+		CHECK(q == NULL, "a growth past the chunk fails");
+		CHECK(p[0] == 'k' && p[99] == 'k', "and leaves the old one valid");
+		q = arena_realloc(&a, p, 100, 200);
+		CHECK(q == p, "growth in place still works");
+		CHECK_EQ(a.allocs, 1u, "failures are not counted");
+		arena_release(&a);
+		CHECK_EQ(src.gets, src.puts, "release balances");
+		CHECK_EQ(src.bad_puts, 0u, "with the right lengths");
+
+		src_init(&src, &a);
+		src.fail_after = 1;
+		src.gets = 1;
+		CHECK(arena_alloc(&a, 8) == NULL, "no first chunk, NULL");
+		CHECK(a.head == NULL, "and nothing linked");
+		arena_release(&a);
+		CHECK_EQ(src.puts, 0u, "nothing to put");
+	}
+
+	printf("\n--- randomized against a model ---\n");
+	{
+		MODEL m[200];
+		int nm;
+		int round;
+		int intact = 1;
+		int aligned = 1;
+		int balanced = 1;
+
+		srand(20261016);
+		for (round = 0; round < 200; round++) {
+			src_init(&src, &a);
+			nm = 0;
+			while (nm < 200) {
+				int op = rand() % 10;
+				size_t size;
+				int k;
+
+				if (op < 6 || nm == 0) {
+					/* mostly small, now and then large */
+					size = rand() % 8 == 0 ? (size_t) (rand() % 40000)
+						: (size_t) (rand() % 600);
+					k = nm;
+					if (!(m[k].p = arena_alloc(&a, size))) {
+						break;
+					}
+					nm++;
+				} else {
+					/* resize the last one, or now and then an earlier one */
+					unsigned char *np;
+
+					k = op < 9 ? nm - 1 : rand() % nm;
+					size = (size_t) (rand() % 3000);
+					np = arena_realloc(&a, m[k].p, m[k].size, size);
+					if (!np) {
+						break;
+					}
+					m[k].p = np;
+					if (size < m[k].size) {
+						m[k].size = size;
+					}
+					if (!tag_intact(&m[k])) {
+						intact = 0;
+					}
+				}
+				m[k].size = size;
+				m[k].tag = (unsigned char) (rand() & 0xFF);
+				memset(m[k].p, m[k].tag, size);
+				if (!is_aligned(m[k].p)) {
+					aligned = 0;
+				}
+			}
+			for (i = 0; i < nm; i++) {
+				if (!tag_intact(&m[i])) {
+					intact = 0;
+				}
+			}
+			arena_release(&a);
+			if (src.gets != src.puts || src.bad_puts || src.nlive) {
+				balanced = 0;
+			}
+		}
+		CHECK(intact, "no allocation overwrote another");
+		CHECK(aligned, "every one aligned");
+		CHECK(balanced, "every round released in full");
+	}
+
+	printf("\n--- benchmark: one simulated request, heap vs arena ---\n");
+	{
+		/* A data set GET that ends in a JSON error and a job list: a JSON
+		   buffer doubling from 1K to 64K, a 32K and an 84-byte record
+		   buffer, a 2000-entry time table, a handful of small pieces. */
+		const int iters = 20000;
+		unsigned long heap_calls = 0;
+		clock_t t0;
+		double t_heap;
+		double t_arena;
+		unsigned long sink = 0;
+		unsigned gets = 0;
+		int n;
+
+		t0 = clock();
+		for (n = 0; n < iters; n++) {
+			char *json = calloc(1, 1024);
+			char *rec = calloc(1, 32760);
+			char *fb = calloc(1, 84);
+			char *tt = malloc(2000 * 8);
+			char *small[6];
+			size_t cap;
+
+			heap_calls += 4;
+			for (cap = 2048; cap <= 65536; cap *= 2) {
+				json = realloc(json, cap);
+				json[cap - 1] = 1;
+				heap_calls++;
+			}
+			for (i = 0; i < 6; i++) {
+				small[i] = calloc(1, 48);
+				heap_calls++;
+			}
+			sink += (unsigned long) (json[65535] + rec[0] + fb[0] + tt[0]);
+			free(json);
+			free(rec);
+			free(fb);
+			free(tt);
+			for (i = 0; i < 6; i++) {
+				free(small[i]);
+			}
+			heap_calls += 10;
+		}
+		t_heap = (double) (clock() - t0) / CLOCKS_PER_SEC;
+
+		arena_init(&a, &bench_ops, &gets);
+		t0 = clock();
+		for (n = 0; n < iters; n++) {
+			char *rec = arena_calloc(&a, 32760);
+			char *fb = arena_calloc(&a, 84);
+			char *tt = arena_alloc(&a, 2000 * 8);
+			char *json;
+			size_t cap;
+
+			for (i = 0; i < 6; i++) {
+				arena_calloc(&a, 48);
+			}
+			json = arena_calloc(&a, 1024);
+			for (cap = 2048; cap <= 65536; cap *= 2) {
+				json = arena_realloc(&a, json, cap / 2, cap);
+				json[cap - 1] = 1;
+			}
+			sink += (unsigned long) (json[65535] + rec[0] + fb[0] + tt[0]);
+			arena_release(&a);
+		}
+		t_arena = (double) (clock() - t0) / CLOCKS_PER_SEC;
+
+		printf("  heap:  %lu calls per request, %.2f us\n",
+			heap_calls / iters, t_heap * 1e6 / iters);
+		printf("  arena: %.1f chunk gets per request, %.2f us, %u KB high\n",
+			(double) gets / iters, t_arena * 1e6 / iters,
+			a.high / 1024);
+		CHECK(sink != 0, "the benchmark did allocate");
+		CHECK(a.head == NULL && a.held == 0, "and released every request");
+		CHECK(gets / iters <= 4, "at most four chunks a request");
+	}
+
+	return mbt_test_summary("TSTARENA");
+}
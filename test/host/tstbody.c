@@ -0,0 +1,472 @@
+/*
+ * tstbody.c - the request body decoder (src/bodydec.c): Content-Length and
+ * chunked framing, decoded as the bytes arrive and pushed to a sink.
+ *
+ * Bodies are encoded here by a reference chunker -- random chunk sizes, hex
+ * in either case with leading zeros, extensions, blanks, bare LFs, trailers
+ * -- and decoded in raw runs of random length. So:
+ *
+ *   1. Content-Length: the body comes out whole; a byte after it is not
+ *      consumed; a zero length is done before a byte is read.
+ *   2. Chunked, 3000 random bodies in random runs: the body comes out
+ *      whole, and exactly the encoded bytes are consumed even with the next
+ *      request's bytes behind them.
+ *   3. body_pump() never asks the transport for a byte past the body: a
+ *      transport that fails any such read is never failed.
+ *   4. Framing errors are BODY_EFRAME: no digits, a stray byte, an
+ *      over-long line, a size past size_t, a chunk without its CRLF.
+ *   5. A failed sink is called no more, the body is still read to its end,
+ *      and the pump answers BODY_ESINK. A peer that closes early is
+ *      BODY_ERECV.
+ *   6. BODYMEM: grown, or fixed with the overflow counted and drained; the
+ *      buffer is NUL-terminated either way.
+ *   7. One byte per read (the ring-buffer transport) and bulk reads decode
+ *      the same body; the read counts of each.
+ *
+ * ====================================================================
+ * This test drives the REAL implementation: src/bodydec.c is #included
+ * below. The transports are the test's own; the recv() ones in common.c
+ * cannot compile on the host.
+ * ====================================================================
+ *
+ * Runs on host via `make test-host`.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mbtcheck.h>
+
+#include "../../src/bodydec.c"
+
+#define BODY_MAX    20000
+#define WIRE_MAX    (BODY_MAX * 4 + 4096)
+
+/* the wire is ASCII: the test builds it from these, never from literals */
+#define CRLF        "\x0d\x0a"
+#define LF          "\x0a"
+
+static char body[BODY_MAX];
+static char wire[WIRE_MAX];
+static char out[BODY_MAX + 1];
+static size_t out_len;
+static int sink_calls;
+static int sink_fail_at;        /* the sink call that fails, 0 for none */
+
+static int
+out_sink(void *ctx, char *data, size_t len)
+{
+	(void) ctx;
+	if (++sink_calls == sink_fail_at) {
+		return -1;
+	}
+	if (out_len + len > BODY_MAX) {
+		return -1;
+	}
+	memcpy(out + out_len, data, len);
+	out_len += len;
+	return 0;
+}
+
+static void
+out_reset(void)
+{
+	out_len = 0;
+	sink_calls = 0;
+	sink_fail_at = 0;
+}
+
+/* an ASCII hex rendering of n, in random case, with leading zeros */
+static size_t
+put_hex(char *w, size_t n, int zeros)
+{
+	static const char lo[] = "\x30\x31\x32\x33\x34\x35\x36\x37\x38\x39"
+		"\x61\x62\x63\x64\x65\x66";
+	static const char up[] = "\x30\x31\x32\x33\x34\x35\x36\x37\x38\x39"
+		"\x41\x42\x43\x44\x45\x46";
+	char tmp[32];
+	size_t k = 0;
+	size_t i;
+
+	do {
+		int d = (int) (n & 15);
+		tmp[k++] = rand() % 2 ? lo[d] : up[d];
+		n >>= 4;
+	} while (n);
+	for (i = 0; i < (size_t) zeros; i++) {
+		w[i] = 0x30;
+	}
+	for (i = 0; i < k; i++) {
+		w[zeros + i] = tmp[k - 1 - i];
+	}
+	return (size_t) zeros + k;
+}
+
+static size_t
+put_str(char *w, const char *s)
+{
+	size_t n = strlen(s);
+
+	memcpy(w, s, n);
+	return n;
+}
+
+static const char *
+eol(void)
+{
+	return rand() % 6 ? CRLF : LF;
+}
+
+/* the reference chunker: `body` of `n` bytes onto `wire` */
+static size_t
+encode(size_t n)
+{
+	size_t w = 0;
+	size_t at = 0;
+	int t;
+
+	while (at < n) {
+		size_t c = 1 + (size_t) rand() % (rand() % 4 ? 700 : 5);
+
+		if (c > n - at) {
+			c = n - at;
+		}
+		w += put_hex(wire + w, c, rand() % 4 ? 0 : rand() % 3);
+		if (rand() % 8 == 0) {
+			w += put_str(wire + w, "\x20\x09");
+		}
+		if (rand() % 6 == 0) {
+			/* ;name=value */
+			w += put_str(wire + w, "\x3b\x6e\x61\x6d\x65\x3d\x76");
+		}
+		w += put_str(wire + w, eol());
+		memcpy(wire + w, body + at, c);
+		w += c;
+		at += c;
+		w += put_str(wire + w, eol());
+	}
+	w += put_hex(wire + w, 0, rand() % 3);
+	w += put_str(wire + w, eol());
+	for (t = rand() % 3; t > 0; t--) {
+		/* X-Sum: 1 */
+		w += put_str(wire + w, "\x58\x2d\x53\x75\x6d\x3a\x20\x31");
+		w += put_str(wire + w, eol());
+	}
+	w += put_str(wire + w, eol());
+	return w;
+}
+
+static size_t
+random_body(void)
+{
+	size_t n = (size_t) rand() % (rand() % 5 ? 3000 : BODY_MAX);
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		/* every byte value, the framing's own among them */
+		body[i] = (char) (rand() % 4 ? rand() % 256 : 0x0d + rand() % 2 * -3);
+	}
+	return n;
+}
+
+/* Decode wire[0..len) in random runs. The raw bytes consumed, or the
+   first negative answer. */
+static long
+feed_runs(BODYDEC *bd, size_t len, int maxrun)
+{
+	size_t at = 0;
+	long used;
+
+	while (at < len && !bodydec_done(bd)) {
+		size_t run = 1 + (size_t) rand() % (size_t) maxrun;
+
+		if (run > len - at) {
+			run = len - at;
+		}
+		used = bodydec_feed(bd, wire + at, run, out_sink, NULL);
+		if (used < 0) {
+			return used;
+		}
+		at += (size_t) used;
+		if ((size_t) used < run) {
+			break;
+		}
+	}
+	return (long) at;
+}
+
+/* a transport over wire[0..wire_end) that fails any read past body_end */
+typedef struct {
+	size_t at;
+	size_t body_end;
+	size_t wire_end;
+	int bulk;
+	int reads;
+	int overread;
+} TRANSPORT;
+
+static int
+wire_recv(void *ctx, char *buf, int len)
+{
+	TRANSPORT *t = ctx;
+	size_t n = t->bulk ? (size_t) len : 1;
+
+	t->reads++;
+	if (t->at + (size_t) len > t->body_end) {
+		t->overread++;
+		return -1;
+	}
+	if (t->at >= t->wire_end) {
+		return 0;
+	}
+	if (n > t->wire_end - t->at) {
+		n = t->wire_end - t->at;
+	}
+	memcpy(buf, wire + t->at, n);
+	t->at += n;
+	return (int) n;
+}
+
+static int
+frame_error(const char *text)
+{
+	BODYDEC bd;
+	size_t n = strlen(text);
+
+	memcpy(wire, text, n);
+	out_reset();
+	bodydec_init(&bd, 1, 0);
+	return (int) feed_runs(&bd, n, 3);
+}
+
+int
+main(void)
+{
+	BODYDEC bd;
+	char rbuf[4096];
+	size_t n;
+	size_t w;
+	long used;
+	int i;
+
+	srand(17);
+
+	printf("\n--- Content-Length ---\n");
+	{
+		n = 5000;
+		for (i = 0; i < (int) n; i++) {
+			body[i] = (char) (i * 7);
+		}
+		memcpy(wire, body, n);
+		memcpy(wire + n, "GET /", 5);
+
+		out_reset();
+		bodydec_init(&bd, 0, n);
+		CHECK_EQ(bodydec_want(&bd), n, "want: the whole length");
+		used = feed_runs(&bd, n + 5, 900);
+		CHECK_EQ(used, (long) n, "the length consumed, not the next request");
+		CHECK(bodydec_done(&bd) && out_len == n
+			&& memcmp(out, body, n) == 0, "the body, whole");
+		CHECK_EQ(bodydec_want(&bd), 0, "want: nothing once done");
+
+		bodydec_init(&bd, 0, 0);
+		CHECK(bodydec_done(&bd), "a zero length is done before a read");
+	}
+
+	printf("\n--- chunked, random ---\n");
+	{
+		int bad = 0;
+		int over = 0;
+		int k;
+
+		for (k = 0; k < 3000; k++) {
+			n = random_body();
+			w = encode(n);
+			/* the next request, already in the socket */
+			memcpy(wire + w, "\x47\x45\x54\x20", 4);
+
+			out_reset();
+			bodydec_init(&bd, 1, 0);
+			used = feed_runs(&bd, w + 4, k % 3 ? 1000 : 3);
+			bad += used != (long) w || !bodydec_done(&bd)
+				|| out_len != n || memcmp(out, body, n) != 0
+				|| bd.total != n;
+			over += bodydec_want(&bd) != 0;
+		}
+		CHECK_EQ(bad, 0, "3000 chunked bodies in random runs: each whole, "
+			"exactly its bytes consumed");
+		CHECK_EQ(over, 0, "want is 0 after each");
+
+		n = 0;
+		w = encode(0);
+		out_reset();
+		bodydec_init(&bd, 1, 0);
+		CHECK(feed_runs(&bd, w, 5) == (long) w && bodydec_done(&bd)
+			&& out_len == 0, "an empty chunked body");
+	}
+
+	printf("\n--- body_pump and the transport ---\n");
+	{
+		TRANSPORT t;
+		int bad = 0;
+		int overread = 0;
+		int k;
+
+		for (k = 0; k < 500; k++) {
+			n = random_body();
+			w = encode(n);
+			memset(&t, 0, sizeof(t));
+			t.body_end = w;
+			t.wire_end = w;
+			t.bulk = k % 2;
+			out_reset();
+			bodydec_init(&bd, 1, 0);
+			bad += body_pump(&bd, wire_recv, &t, rbuf, sizeof(rbuf),
+				out_sink, NULL) != 0 || out_len != n
+				|| memcmp(out, body, n) != 0 || t.at != w;
+			overread += t.overread;
+		}
+		CHECK_EQ(bad, 0, "500 bodies pumped, byte and bulk transports");
+		CHECK_EQ(overread, 0, "never a read past the body");
+
+		n = 3000;
+		memcpy(wire, body, n);
+		memset(&t, 0, sizeof(t));
+		t.body_end = n;
+		t.wire_end = n - 10;
+		t.bulk = 1;
+		out_reset();
+		bodydec_init(&bd, 0, n);
+		CHECK_EQ(body_pump(&bd, wire_recv, &t, rbuf, sizeof(rbuf),
+			out_sink, NULL), BODY_ERECV, "the peer closes early: ERECV");
+	}
+
+	printf("\n--- framing errors ---\n");
+	{
+		/* "\r\n" */
+		CHECK_EQ(frame_error(CRLF), BODY_EFRAME, "a size line with no digits");
+		/* "1g\r\n" */
+		CHECK_EQ(frame_error("\x31\x67" CRLF), BODY_EFRAME, "a stray byte");
+		/* "1 2\r\n" */
+		CHECK_EQ(frame_error("\x31\x20\x32" CRLF), BODY_EFRAME,
+			"a digit after the blanks");
+		/* "1\rx" */
+		CHECK_EQ(frame_error("\x31\x0d\x78"), BODY_EFRAME,
+			"a CR without its LF");
+		/* "2\r\nabX\r\n" */
+		CHECK_EQ(frame_error("\x32" CRLF "\x61\x62\x58" CRLF), BODY_EFRAME,
+			"a chunk longer than its size");
+		/* 17 hex digits */
+		CHECK_EQ(frame_error("\x31\x30\x30\x30\x30\x30\x30\x30\x30\x30\x30"
+			"\x30\x30\x30\x30\x30\x30" CRLF), BODY_EFRAME,
+			"a size past size_t");
+		/* "0\r\nX\rY" */
+		CHECK_EQ(frame_error("\x30" CRLF "\x58\x0d\x59"), BODY_EFRAME,
+			"a trailer's CR without its LF");
+
+		memset(wire, 0x78, BODY_LINE_MAX + 10);
+		wire[0] = 0x31;
+		wire[1] = A_SEMI;
+		out_reset();
+		bodydec_init(&bd, 1, 0);
+		CHECK_EQ(feed_runs(&bd, BODY_LINE_MAX + 10, 50), BODY_EFRAME,
+			"an extension past BODY_LINE_MAX");
+
+		/* "1;x\n" is fine, and so is a long trailer under the limit */
+		n = put_str(wire, "\x31\x3b\x78" LF "\x5a" CRLF "\x30" LF);
+		memset(wire + n, 0x54, BODY_LINE_MAX - 1);
+		n += BODY_LINE_MAX - 1;
+		n += put_str(wire + n, CRLF CRLF);
+		out_reset();
+		bodydec_init(&bd, 1, 0);
+		CHECK(feed_runs(&bd, n, 7) == (long) n && out_len == 1
+			&& out[0] == 0x5a, "an extension and a long trailer");
+	}
+
+	printf("\n--- a failed sink ---\n");
+	{
+		TRANSPORT t;
+
+		do {
+			n = random_body();
+		} while (n < 2000);
+		w = encode(n);
+		memset(&t, 0, sizeof(t));
+		t.body_end = w;
+		t.wire_end = w;
+		out_reset();
+		sink_fail_at = 2;
+		bodydec_init(&bd, 1, 0);
+		CHECK_EQ(body_pump(&bd, wire_recv, &t, rbuf, sizeof(rbuf),
+			out_sink, NULL), BODY_ESINK, "the pump answers ESINK");
+		CHECK_EQ(sink_calls, 2, "the sink is called no more");
+		CHECK(t.at == w && bodydec_done(&bd) && bd.total == n,
+			"the body is still read to its end");
+	}
+
+	printf("\n--- BODYMEM ---\n");
+	{
+		BODYMEM m;
+		char fixed[100];
+		int k;
+
+		for (i = 0; i < 3000; i++) {
+			body[i] = (char) ('a' + i % 26);
+		}
+
+		memset(&m, 0, sizeof(m));
+		m.grow = 1;
+		for (k = 0; k < 3000; k += 300) {
+			CHECK_EQ(bodymem_sink(&m, body + k, 300), 0, "grown");
+		}
+		CHECK(m.len == 3000 && memcmp(m.buf, body, 3000) == 0
+			&& m.buf[3000] == '\0' && m.cap >= 3001,
+			"3000 bytes, NUL-terminated");
+		free(m.buf);
+
+		memset(&m, 0, sizeof(m));
+		m.buf = fixed;
+		m.cap = sizeof(fixed);
+		CHECK_EQ(bodymem_sink(&m, body, 60), 0, "fixed: fits");
+		CHECK_EQ(bodymem_sink(&m, body + 60, 60), 0, "fixed: overflows");
+		CHECK(m.len == 99 && m.dropped == 21 && fixed[99] == '\0'
+			&& memcmp(fixed, body, 99) == 0,
+			"99 kept, 21 dropped, NUL after them");
+	}
+
+	printf("\n--- reads per body, byte vs bulk ---\n");
+	{
+		TRANSPORT t;
+		int reads[2];
+		int b;
+
+		srand(5);
+		n = 10000;
+		for (i = 0; i < (int) n; i++) {
+			body[i] = (char) rand();
+		}
+		w = encode(n);
+		for (b = 0; b < 2; b++) {
+			memset(&t, 0, sizeof(t));
+			t.body_end = w;
+			t.wire_end = w;
+			t.bulk = b;
+			out_reset();
+			bodydec_init(&bd, 1, 0);
+			CHECK(body_pump(&bd, wire_recv, &t, rbuf, sizeof(rbuf),
+				out_sink, NULL) == 0 && out_len == n
+				&& memcmp(out, body, n) == 0,
+				b ? "bulk: the same body" : "byte: the body");
+			reads[b] = t.reads;
+		}
+		printf("  %lu body bytes, %lu on the wire, %lu chunks: "
+			"%d reads a byte at a time, %d in bulk\n",
+			(unsigned long) n, (unsigned long) w, bd.chunks,
+			reads[0], reads[1]);
+		CHECK_EQ(reads[0], (int) w, "byte: a read per wire byte");
+		CHECK(reads[1] < reads[0] / 4, "bulk: the framing's bytes and a "
+			"read per chunk");
+	}
+
+	return mbt_test_summary("TSTBODY");
+}
@@ -0,0 +1,317 @@
+/*
+ * tstdblk.c - the deblocker: logical records out of synthetic F/FB, V/VB
+ * and U blocks.
+ *
+ * On MVS the deblocker is all that stands between a physical block and the
+ * records a download, an ETag or a submitted job is made of, and a record
+ * too many or too few is wrong in all three at once. So:
+ *
+ *   1. F/FB: every record of every block, at its LRECL, and a short last
+ *      block is exactly its records -- no residue.
+ *   2. V/VB: blocks built here the way QSAM writes them (BDW, then RDW and
+ *      data per record) give back the records written, zero-length records
+ *      included, and bytes past the BDW's length are ignored.
+ *   3. U: the block is the record.
+ *   4. A data set's worth of random records, blocked and deblocked again in
+ *      each format, round-trips byte for byte and record for record.
+ *   5. A block that does not hold what its format says -- a BDW or RDW
+ *      below 4 or past its end, a spanned segment, an F block that is not
+ *      whole records -- is an error, and it stays one.
+ *   6. The records are spans into the caller's block, not copies.
+ *
+ * ====================================================================
+ * This test drives the REAL implementation: src/deblock.c is #included
+ * below. The block builders are the test's own.
+ * ====================================================================
+ *
+ * Runs on host via `make test-host`.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mbtcheck.h>
+
+#include "../../src/deblock.c"
+
+#define BLK_MAX     32760
+#define REC_MAX     4096
+#define NREC        3000
+
+/* one record of the round trip */
+struct rec {
+	size_t          len;
+	unsigned char   data[REC_MAX];
+};
+
+static struct rec recs[NREC];
+
+static void
+put_ll(unsigned char *p, size_t ll)
+{
+	p[0] = (unsigned char) (ll >> 8);
+	p[1] = (unsigned char) ll;
+	p[2] = 0;
+	p[3] = 0;
+}
+
+/* Block recs[from..] as VB into blk, up to blksize; returns the block length
+   and sets *next to the first record not in it. */
+static size_t
+block_vb(unsigned char *blk, size_t blksize, int from, int *next)
+{
+	size_t o = 4;
+	int i;
+
+	for (i = from; i < NREC; i++) {
+		if (o + 4 + recs[i].len > blksize) {
+			break;
+		}
+		put_ll(blk + o, 4 + recs[i].len);
+		memcpy(blk + o + 4, recs[i].data, recs[i].len);
+		o += 4 + recs[i].len;
+	}
+	put_ll(blk, o);
+	*next = i;
+	return o;
+}
+
+/* Deblock `len` bytes of blk and check the records against recs[*at..]. */
+static int
+check_block(DEBLOCK *db, const unsigned char *blk, size_t len, int *at)
+{
+	const unsigned char *rec;
+	size_t rlen;
+	int rc;
+	int bad = 0;
+
+	if (deblock_block(db, blk, len) != 0) {
+		return 1;
+	}
+	while ((rc = deblock_next(db, &rec, &rlen)) == 1) {
+		if (*at >= NREC || rlen != recs[*at].len
+		    || memcmp(rec, recs[*at].data, rlen) != 0
+		    || rec < blk || rec + rlen > blk + len) {
+			bad++;
+		}
+		(*at)++;
+	}
+	return bad + (rc != 0);
+}
+
+int
+main(void)
+{
+	static unsigned char blk[BLK_MAX + 64];
+	DEBLOCK db;
+	const unsigned char *rec;
+	size_t len;
+	int i;
+	int n;
+	int rc;
+
+	srand(7);
+
+	printf("\n--- F/FB ---\n");
+	{
+		for (i = 0; i < 27 * 80; i++) {
+			blk[i] = (unsigned char) (i / 80);
+		}
+
+		deblock_init(&db, DBK_F, 80);
+		CHECK_EQ(deblock_block(&db, blk, 27 * 80), 0, "FB80 block of 27");
+		for (n = 0; (rc = deblock_next(&db, &rec, &len)) == 1; n++) {
+			if (len != 80 || rec != blk + n * 80 || rec[0] != n || rec[79] != n) {
+				break;
+			}
+		}
+		CHECK_EQ(n, 27, "27 records, each at its offset in the block");
+		CHECK_EQ(rc, 0, "then the block is used up");
+		CHECK_EQ(deblock_next(&db, &rec, &len), 0, "and stays used up");
+
+		CHECK_EQ(deblock_block(&db, blk, 3 * 80), 0, "a short last block");
+		for (n = 0; deblock_next(&db, &rec, &len) == 1; n++)
+			;
+		CHECK_EQ(n, 3, "is its 3 records, no residue after them");
+
+		CHECK_EQ(deblock_block(&db, blk, 0), 0, "an empty block");
+		CHECK_EQ(deblock_next(&db, &rec, &len), 0, "has no records");
+
+		deblock_init(&db, DBK_F, 133);
+		CHECK_EQ(deblock_block(&db, blk, 133), 0, "F133: one record a block");
+		CHECK(deblock_next(&db, &rec, &len) == 1 && len == 133 && rec == blk,
+			"the block is the record");
+	}
+
+	printf("\n--- V/VB ---\n");
+	{
+		unsigned char *p = blk + 4;
+
+		/* three records: 10 bytes, none, 100 */
+		put_ll(p, 14);
+		memset(p + 4, 'A', 10);
+		p += 14;
+		put_ll(p, 4);
+		p += 4;
+		put_ll(p, 104);
+		memset(p + 4, 'C', 100);
+		p += 104;
+		put_ll(blk, (size_t) (p - blk));
+		memset(p, 0xEE, 40);            /* the read returned more */
+
+		deblock_init(&db, DBK_V, 0);
+		CHECK_EQ(deblock_block(&db, blk, (size_t) (p - blk) + 40), 0,
+			"VB block, read longer than its BDW");
+		CHECK(deblock_next(&db, &rec, &len) == 1 && len == 10
+			&& rec == blk + 8 && rec[0] == 'A',
+			"first record: 10 bytes after its RDW");
+		CHECK(deblock_next(&db, &rec, &len) == 1 && len == 0,
+			"second: a zero-length record");
+		CHECK(deblock_next(&db, &rec, &len) == 1 && len == 100 && rec[99] == 'C',
+			"third: 100 bytes");
+		CHECK_EQ(deblock_next(&db, &rec, &len), 0,
+			"then the end of the BDW, not of the read");
+
+		put_ll(blk, 4);
+		CHECK_EQ(deblock_block(&db, blk, 4), 0, "a block of a BDW only");
+		CHECK_EQ(deblock_next(&db, &rec, &len), 0, "has no records");
+	}
+
+	printf("\n--- U ---\n");
+	{
+		deblock_init(&db, DBK_U, 0);
+		CHECK_EQ(deblock_block(&db, blk, 1234), 0, "U block of 1234");
+		CHECK(deblock_next(&db, &rec, &len) == 1 && len == 1234 && rec == blk,
+			"is one record of 1234");
+		CHECK_EQ(deblock_next(&db, &rec, &len), 0, "and no more");
+	}
+
+	printf("\n--- round trip ---\n");
+	{
+		size_t blksizes[] = { 6233, 27998, BLK_MAX };
+		size_t k;
+		int at;
+		int bad;
+
+		/* V: random lengths, zero included */
+		for (i = 0; i < NREC; i++) {
+			size_t j;
+
+			recs[i].len = (size_t) rand() % 300;
+			if (rand() % 50 == 0) {
+				recs[i].len = 0;
+			}
+			if (rand() % 200 == 0) {
+				recs[i].len = REC_MAX;
+			}
+			for (j = 0; j < recs[i].len; j++) {
+				recs[i].data[j] = (unsigned char) rand();
+			}
+		}
+		for (k = 0; k < sizeof(blksizes) / sizeof(blksizes[0]); k++) {
+			int from = 0;
+
+			at = 0;
+			bad = 0;
+			deblock_init(&db, DBK_V, 0);
+			while (from < NREC) {
+				size_t blen = block_vb(blk, blksizes[k], from, &from);
+
+				bad += check_block(&db, blk, blen, &at);
+			}
+			CHECK(bad == 0 && at == NREC,
+				"VB: every record back, in order, at each BLKSIZE");
+		}
+
+		/* FB: 80-byte records, the last block short */
+		for (i = 0; i < NREC; i++) {
+			size_t j;
+
+			recs[i].len = 80;
+			for (j = 0; j < 80; j++) {
+				recs[i].data[j] = (unsigned char) rand();
+			}
+		}
+		at = 0;
+		bad = 0;
+		deblock_init(&db, DBK_F, 80);
+		for (i = 0; i < NREC; i += 78) {
+			int m = NREC - i < 78 ? NREC - i : 78;
+			int j;
+
+			for (j = 0; j < m; j++) {
+				memcpy(blk + j * 80, recs[i + j].data, 80);
+			}
+			bad += check_block(&db, blk, (size_t) m * 80, &at);
+		}
+		CHECK(bad == 0 && at == NREC,
+			"FB80 BLKSIZE 6240: every record back, and the short last "
+			"block ends the data");
+
+		/* U: each record its own block */
+		at = 0;
+		bad = 0;
+		deblock_init(&db, DBK_U, 0);
+		for (i = 0; i < NREC; i++) {
+			recs[i].len = 1 + (size_t) rand() % REC_MAX;
+			memset(recs[i].data, i, recs[i].len);
+			memcpy(blk, recs[i].data, recs[i].len);
+			bad += check_block(&db, blk, recs[i].len, &at);
+		}
+		CHECK(bad == 0 && at == NREC, "U: every block a record");
+	}
+
+	printf("\n--- blocks that do not hold their format ---\n");
+	{
+		deblock_init(&db, DBK_F, 80);
+		CHECK_EQ(deblock_block(&db, blk, 81), DBK_ELEN,
+			"F block not a multiple of LRECL");
+		CHECK_EQ(deblock_next(&db, &rec, &len), DBK_ELEN, "stays an error");
+		CHECK_EQ(deblock_block(&db, blk, 80), DBK_ELEN,
+			"a good block after it does not clear it");
+
+		deblock_init(&db, DBK_F, 0);
+		CHECK_EQ(deblock_block(&db, blk, 80), DBK_ELEN, "F with LRECL 0");
+
+		deblock_init(&db, DBK_V, 0);
+		CHECK_EQ(deblock_block(&db, blk, 3), DBK_EBDW, "V block under 4 bytes");
+		deblock_init(&db, DBK_V, 0);
+		put_ll(blk, 2);
+		CHECK_EQ(deblock_block(&db, blk, 100), DBK_EBDW, "BDW length below 4");
+		deblock_init(&db, DBK_V, 0);
+		put_ll(blk, 200);
+		CHECK_EQ(deblock_block(&db, blk, 100), DBK_EBDW,
+			"BDW longer than the block read");
+
+		deblock_init(&db, DBK_V, 0);
+		put_ll(blk, 20);
+		put_ll(blk + 4, 30);
+		CHECK_EQ(deblock_block(&db, blk, 20), 0, "RDW past the BDW: block ok");
+		CHECK_EQ(deblock_next(&db, &rec, &len), DBK_ERDW, "record not");
+
+		deblock_init(&db, DBK_V, 0);
+		put_ll(blk, 20);
+		put_ll(blk + 4, 3);
+		deblock_block(&db, blk, 20);
+		CHECK_EQ(deblock_next(&db, &rec, &len), DBK_ERDW, "RDW length below 4");
+
+		deblock_init(&db, DBK_V, 0);
+		put_ll(blk, 10);
+		put_ll(blk + 4, 4);
+		deblock_block(&db, blk, 10);
+		CHECK_EQ(deblock_next(&db, &rec, &len), 1, "a record, then");
+		CHECK_EQ(deblock_next(&db, &rec, &len), DBK_ERDW,
+			"two bytes left: too short for an RDW");
+
+		deblock_init(&db, DBK_V, 0);
+		put_ll(blk, 20);
+		put_ll(blk + 4, 16);
+		blk[6] = 0x01;                  /* first segment of a spanned record */
+		deblock_block(&db, blk, 20);
+		CHECK_EQ(deblock_next(&db, &rec, &len), DBK_ESPAN, "a spanned segment");
+		CHECK_EQ(deblock_block(&db, blk, 20), DBK_ESPAN,
+			"stays an error until deblock_init()");
+	}
+
+	return mbt_test_summary("TSTDBLK");
+}
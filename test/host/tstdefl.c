@@ -0,0 +1,348 @@
+/*
+ * tstdefl.c - gzip response bodies (src/deflate.c): what they cost and
+ * what they save.
+ *
+ * The encoder's output goes through the inflater the request side uses
+ * (src/inflate.c), which checks the gzip CRC32 and length itself. The
+ * samples are what the gzipped routes send: a JCL deck, a job's listing
+ * (JES2 log, allocation messages, a utility's SYSPRINT) and a data set
+ * list in JSON. So:
+ *
+ *   1. Every sample, at every search budget from 1 to DEFL_CHAIN_MAX, fed
+ *      whole, in random runs and a byte at a time, inflates to itself. So
+ *      does an empty body.
+ *   2. 300 random bodies up to 100 KB, text and bytes, random budgets,
+ *      inflate to themselves.
+ *   3. A body that does not compress goes stored after DEFL_PROBE bytes: it
+ *      grows by a few bytes per 64 KB, no more, and still inflates. Text
+ *      never gives up.
+ *   4. A failed sink fails the feed, and every later feed and the end.
+ *   5. What it costs: ratio against host CPU per byte, by budget, on each
+ *      sample. An emulated CPU runs far slower than the host, so the
+ *      numbers compare budgets with each other, not with the network.
+ *
+ * ====================================================================
+ * This test drives the REAL implementation: src/deflate.c is #included
+ * below, with src/inflate.c to read its output back and src/etag.c for
+ * the CRC32 both use.
+ * ====================================================================
+ *
+ * Runs on host via `make test-host`.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <mbtcheck.h>
+
+#include "../../src/etag.c"
+#include "../../src/inflate.c"
+#include "../../src/deflate.c"
+
+#define BODY_MAX    (256 * 1024)
+
+static unsigned char body[BODY_MAX];
+static unsigned char gz[BODY_MAX + BODY_MAX / 8];
+static size_t gz_len;
+static unsigned char back[BODY_MAX];
+static size_t back_len;
+static int sink_fail_at;        /* the sink call that fails, 0 for none */
+static int sink_calls;
+static DEFLATE d;               /* 45 KB: not on the stack */
+static INFLATE z;
+
+static int
+gz_sink(void *ctx, const unsigned char *data, size_t len)
+{
+	(void) ctx;
+	if (++sink_calls == sink_fail_at) {
+		return -1;
+	}
+	if (len > DEFL_OUTSIZE || gz_len + len > sizeof(gz)) {
+		return -1;
+	}
+	memcpy(gz + gz_len, data, len);
+	gz_len += len;
+	return 0;
+}
+
+static int
+back_sink(void *ctx, char *data, size_t len)
+{
+	(void) ctx;
+	if (back_len + len > sizeof(back)) {
+		return -1;
+	}
+	memcpy(back + back_len, data, len);
+	back_len += len;
+	return 0;
+}
+
+/* Compress t[0..len) fed in runs of `run` bytes (0: random runs) */
+static int
+compress(const unsigned char *t, size_t len, int chain, size_t run)
+{
+	size_t off = 0;
+	size_t n;
+
+	gz_len = 0;
+	sink_calls = 0;
+	defl_init(&d, chain);
+	while (off < len) {
+		n = run ? run : 1 + (size_t) rand() % 20000;
+		if (n > len - off) {
+			n = len - off;
+		}
+		if (defl_feed(&d, t + off, n, gz_sink, NULL) < 0) {
+			return -1;
+		}
+		off += n;
+	}
+	return defl_end(&d, gz_sink, NULL);
+}
+
+/* The gzip stream in gz[] inflates to t[0..len) */
+static int
+round_trips(const unsigned char *t, size_t len)
+{
+	back_len = 0;
+	infl_init(&z, INFL_GZIP, 0);
+	if (infl_feed(&z, (const char *) gz, gz_len, back_sink, NULL) < 0
+	    || infl_end(&z) != 0) {
+		return 0;
+	}
+	return back_len == len && memcmp(back, t, len) == 0;
+}
+
+/* ---- the samples ------------------------------------------------------ */
+
+static unsigned seed;
+
+static unsigned
+next(void)
+{
+	seed = seed * 1103515245U + 12345U;
+	return seed >> 8;
+}
+
+static size_t
+sample_jcl(unsigned char *buf, size_t max)
+{
+	size_t len = 0;
+	int i;
+
+	seed = 1;
+	len += (size_t) sprintf((char *) buf,
+	    "//HERC01A JOB (ACCT),'BUILD',CLASS=A,MSGCLASS=H,NOTIFY=HERC01\n");
+	for (i = 0; len + 400 < max; i++) {
+		len += (size_t) sprintf((char *) buf + len,
+		    "//* ---------------------------------------------------------\n"
+		    "//ASM%04d  EXEC PGM=IFOX00,PARM='DECK,NOOBJECT,TERM'\n"
+		    "//SYSLIB   DD DSN=SYS1.MACLIB,DISP=SHR\n"
+		    "//         DD DSN=HERC01.MACLIB,DISP=SHR\n"
+		    "//SYSUT1   DD UNIT=SYSDA,SPACE=(CYL,(%u,1))\n"
+		    "//SYSPUNCH DD DSN=&&OBJ%u,DISP=(,PASS),UNIT=SYSDA\n"
+		    "//SYSIN    DD DSN=HERC01.SOURCE(MOD%05u),DISP=SHR\n",
+		    i, next() % 9 + 1, i, next() % 40000);
+	}
+	return len;
+}
+
+static size_t
+sample_listing(unsigned char *buf, size_t max)
+{
+	static const char *const msgs[] = {
+		"IEF236I ALLOC. FOR HERC01A ASM%04u",
+		"IEF237I 0%03X  ALLOCATED TO SYSLIB",
+		"IEF142I HERC01A ASM%04u - STEP WAS EXECUTED - COND CODE 0000",
+		"IEF285I   SYS1.MACLIB                                  KEPT",
+		"IEF285I   VOL SER NOS= MVSRES.",
+		"IEF373I STEP /ASM%04u / START 25290.1412",
+		"IEF374I STEP /ASM%04u / STOP  25290.1412 CPU    0MIN 00.%02uSEC"
+		" SRB    0MIN 00.00SEC VIRT   %3uK SYS   232K",
+	};
+	size_t len = 0;
+	unsigned line = 0;
+	char text[160];
+
+	seed = 2;
+	while (len + 200 < max) {
+		line++;
+		if (line % 60 == 1) {
+			len += (size_t) sprintf((char *) buf + len,
+			    "1                    J E S 2   J O B   L O G  --  "
+			    "S Y S T E M   M V S 3  --  N O D E   N 1\n0\n");
+		}
+		sprintf(text, msgs[next() % 7], next() % 400, next() % 0x1000,
+		    next() % 100);
+		len += (size_t) sprintf((char *) buf + len,
+		    " 14.12.%02u JOB %5u  %s\n", line % 60, 1234 + line / 500, text);
+		if (next() % 5 == 0) {
+			len += (size_t) sprintf((char *) buf + len,
+			    "  %06u         MVC   WORK%u(8),=CL8'HERC%04u'"
+			    "                                 %08u\n",
+			    line * 10, next() % 10, next() % 10000, line * 100);
+		}
+	}
+	return len;
+}
+
+static size_t
+sample_json(unsigned char *buf, size_t max)
+{
+	size_t len = 0;
+	unsigned i;
+
+	seed = 3;
+	len += (size_t) sprintf((char *) buf, "{\n  \"items\": [\n");
+	for (i = 0; len + 400 < max; i++) {
+		len += (size_t) sprintf((char *) buf + len,
+		    "    {\"dsname\": \"HERC01.PROJ%u.%s\", \"blksz\": \"%u\", "
+		    "\"catnm\": \"SYS1.UCAT.MVS\", \"cdate\": \"2025/%02u/%02u\", "
+		    "\"dev\": \"3390\", \"dsorg\": \"%s\", \"lrecl\": \"%u\", "
+		    "\"recfm\": \"%s\", \"used\": \"%u\", \"vol\": \"PUB00%u\"},\n",
+		    next() % 40, next() % 2 ? "SOURCE" : "LOADLIB", 3120 * (next() % 9 + 1),
+		    next() % 12 + 1, next() % 28 + 1, next() % 3 ? "PO" : "PS",
+		    next() % 2 ? 80 : 133, next() % 2 ? "FB" : "VBA",
+		    next() % 100, next() % 4);
+	}
+	len += (size_t) sprintf((char *) buf + len,
+	    "  ],\n  \"returnedRows\": %u,\n  \"moreRows\": false\n}\n", i);
+	return len;
+}
+
+typedef struct {
+	const char *name;
+	size_t (*make)(unsigned char *, size_t);
+} SAMPLE;
+
+static const SAMPLE samples[] = {
+	{ "JCL", sample_jcl },
+	{ "listing", sample_listing },
+	{ "JSON list", sample_json },
+};
+
+#define N_SAMPLES   ((int) (sizeof(samples) / sizeof(samples[0])))
+
+static size_t
+random_body(void)
+{
+	size_t len = (size_t) rand() % (100 * 1024);
+	size_t i;
+	int kind = rand() % 3;
+
+	if (kind == 0) {
+		seed = (unsigned) rand();
+		return sample_listing(body, len + 200);
+	}
+	for (i = 0; i < len; i++) {
+		body[i] = (unsigned char) (kind == 1 && i > 16 && rand() % 3
+		    ? body[i - 1 - rand() % 16] : rand());
+	}
+	return len;
+}
+
+int
+main(void)
+{
+	static const int chains[] = { 1, 2, 4, 8, 16, DEFL_CHAIN_MAX };
+	size_t len;
+	int bad;
+	int i;
+	int c;
+
+	srand(20);
+
+	printf("--- the samples, every budget ---\n");
+	for (i = 0; i < N_SAMPLES; i++) {
+		char what[80];
+
+		len = samples[i].make(body, 120 * 1024);
+		bad = 0;
+		for (c = 0; c < (int) (sizeof(chains) / sizeof(chains[0])); c++) {
+			if (compress(body, len, chains[c], len) != 0
+			    || !round_trips(body, len)) {
+				bad++;
+			}
+			if (compress(body, len, chains[c], 0) != 0
+			    || !round_trips(body, len)) {
+				bad++;
+			}
+		}
+		if (compress(body, 20000, 4, 1) != 0 || !round_trips(body, 20000)) {
+			bad++;
+		}
+		sprintf(what, "%s: whole, in runs and a byte at a time", samples[i].name);
+		CHECK_EQ(bad, 0, what);
+		CHECK(!d.stored, "  and never gives up");
+	}
+	CHECK(compress(body, 0, 4, 0) == 0 && round_trips(body, 0),
+		"an empty body: a valid empty stream");
+	CHECK(gz_len >= 20 && gz[0] == 0x1F && gz[1] == 0x8B && gz[2] == 8,
+		"  with a gzip header");
+
+	printf("\n--- random bodies ---\n");
+	{
+		bad = 0;
+		for (i = 0; i < 300; i++) {
+			len = random_body();
+			if (compress(body, len, 1 + rand() % DEFL_CHAIN_MAX, 0) != 0
+			    || !round_trips(body, len)) {
+				bad++;
+			}
+		}
+		CHECK_EQ(bad, 0, "300 bodies in random runs: themselves");
+	}
+
+	printf("\n--- a body that does not compress ---\n");
+	{
+		len = 200 * 1024;
+		for (i = 0; i < (int) len; i++) {
+			body[i] = (unsigned char) rand();
+		}
+		CHECK(compress(body, len, 4, 0) == 0 && round_trips(body, len),
+			"random bytes: themselves");
+		CHECK(d.stored, "  stored after the probe");
+		printf("  %lu bytes in, %lu out\n", (unsigned long) len,
+			(unsigned long) gz_len);
+		CHECK(gz_len < len + len / 64 + 64, "  a few bytes over, no more");
+	}
+
+	printf("\n--- a failed sink ---\n");
+	{
+		len = sample_listing(body, 64 * 1024);
+		sink_fail_at = 2;
+		CHECK_EQ(compress(body, len, 4, len), -1, "the feed fails");
+		CHECK_EQ(defl_feed(&d, body, 10, gz_sink, NULL), -1,
+			"  and the next feed");
+		CHECK_EQ(defl_end(&d, gz_sink, NULL), -1, "  and the end");
+		sink_fail_at = 0;
+	}
+
+	printf("\n--- ratio against CPU, by budget ---\n");
+	for (i = 0; i < N_SAMPLES; i++) {
+		len = samples[i].make(body, 120 * 1024);
+		printf("  %s, %lu bytes:\n", samples[i].name, (unsigned long) len);
+		for (c = 0; c < (int) (sizeof(chains) / sizeof(chains[0])); c++) {
+			clock_t t0 = clock();
+			double secs;
+			int rounds = 0;
+
+			do {
+				compress(body, len, chains[c], 16384);
+				rounds++;
+			} while ((secs = (double) (clock() - t0) / CLOCKS_PER_SEC) < 0.1);
+			printf("    chain %2d: %5.1f%% of the size (%.2fx), "
+				"%5.1f ns a byte\n", chains[c],
+				100.0 * gz_len / len, (double) len / gz_len,
+				secs * 1e9 / ((double) len * rounds));
+			if (chains[c] == 1) {
+				CHECK(gz_len * 3 < len, "  the least budget saves two "
+					"thirds or more");
+			}
+		}
+	}
+
+	return mbt_test_summary("TSTDEFL");
+}
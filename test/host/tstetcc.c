@@ -0,0 +1,285 @@
+/*
+ * tstetcc.c - ETags kept across requests (src/etagcache.c).
+ *
+ * A cached stamp is only as good as the rule that decides when to trust it,
+ * and a wrong answer is silent: a 304 for content that changed, or a PUT
+ * let through over someone else's edit. So:
+ *
+ *   1. A stamp comes back only for the key and the metadata it was stored
+ *      with. Other metadata -- a byte of it, or its length -- is a miss, and
+ *      the entry is gone: a later lookup with the old metadata misses too.
+ *   2. A key or metadata too long for an entry is not cached, and storing
+ *      one drops what the key had.
+ *   3. Forgetting a key (mvsMF's own writes) drops its entry and no other.
+ *   4. A full block gives up the entry used least recently; a hit counts
+ *      as a use. Storing an existing key replaces it in place.
+ *   5. A block of another layout is not valid, so the anchor replaces it.
+ *
+ * Then what a hit saves: a lookup against a re-stamp of the member it
+ * stands for.
+ *
+ * ====================================================================
+ * This test drives the REAL implementation: src/etagcache.c is #included
+ * below, so a later refactor stays covered. The anchor and the latch
+ * (mvsmfctx.c) cannot run on the host.
+ * ====================================================================
+ *
+ * Runs on host via `make test-host`.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <mbtcheck.h>
+
+#include "../../src/etag.c"
+#include "../../src/etagcache.c"
+
+static ETAG_CACHE cache;
+
+/* A stamp that is ETAG_LEN characters, different for each n */
+static void
+fake_etag(char *out, unsigned n)
+{
+	snprintf(out, ETAG_SIZE, "%016X", n);
+}
+
+/* The metadata of a member: TTR, indicator, 15 bytes of ISPF stats */
+static size_t
+fake_meta(unsigned char *meta, unsigned ttr)
+{
+	memset(meta, 0x40, 19);
+	meta[0] = (unsigned char) (ttr >> 16);
+	meta[1] = (unsigned char) (ttr >> 8);
+	meta[2] = (unsigned char) ttr;
+	meta[3] = 0x0F;
+	return 19;
+}
+
+int
+main(void)
+{
+	unsigned char meta[ETC_METAMAX + 1];
+	char etag[ETAG_SIZE];
+	char got[ETAG_SIZE];
+	char key[ETC_KEYMAX + 16];
+	size_t mlen;
+
+	printf("\n--- hit and miss ---\n");
+	{
+		etc_init(&cache);
+		CHECK(etc_valid(&cache), "an initialised block is valid");
+
+		mlen = fake_meta(meta, 0x000105);
+		fake_etag(etag, 1);
+		CHECK(!etc_lookup(&cache, "D:HERC01.SRC(A)", meta, mlen, got),
+			"an empty block misses");
+		CHECK_EQ(etc_store(&cache, "D:HERC01.SRC(A)", meta, mlen, etag), 0,
+			"a store that fits is taken");
+		memset(got, 0, sizeof(got));
+		CHECK(etc_lookup(&cache, "D:HERC01.SRC(A)", meta, mlen, got)
+			&& strcmp(got, etag) == 0,
+			"the same key and metadata hit, with the stamp stored");
+		CHECK(!etc_lookup(&cache, "D:HERC01.SRC(B)", meta, mlen, got),
+			"another key with the same metadata misses");
+		CHECK(!etc_lookup(&cache, "D:HERC01.SRC", meta, mlen, got),
+			"a prefix of the key misses");
+	}
+
+	printf("\n--- metadata that changed ---\n");
+	{
+		unsigned char moved[ETC_METAMAX];
+
+		mlen = fake_meta(meta, 0x000105);
+		memcpy(moved, meta, mlen);
+		moved[2] = 0x06;		/* rewritten: a new TTR */
+		CHECK(!etc_lookup(&cache, "D:HERC01.SRC(A)", moved, mlen, got),
+			"a new TTR misses");
+		CHECK(!etc_lookup(&cache, "D:HERC01.SRC(A)", meta, mlen, got),
+			"and the entry is gone: the old metadata misses after it");
+
+		fake_etag(etag, 2);
+		etc_store(&cache, "D:HERC01.SRC(A)", meta, mlen, etag);
+		CHECK(!etc_lookup(&cache, "D:HERC01.SRC(A)", meta, mlen - 1, got),
+			"metadata that is a prefix of the stored one misses");
+
+		etc_store(&cache, "D:HERC01.SRC(A)", meta, mlen, etag);
+		memcpy(moved, meta, mlen);
+		moved[mlen - 1] ^= 1;		/* the ISPF time, a minute on */
+		CHECK(!etc_lookup(&cache, "D:HERC01.SRC(A)", moved, mlen, got),
+			"a change in the last byte of the statistics misses");
+	}
+
+	printf("\n--- what does not fit ---\n");
+	{
+		mlen = fake_meta(meta, 0x000207);
+		fake_etag(etag, 3);
+
+		memset(key, 'K', sizeof(key));
+		key[ETC_KEYMAX - 1] = '\0';
+		CHECK_EQ(etc_store(&cache, key, meta, mlen, etag), 0,
+			"a key of ETC_KEYMAX - 1 characters fits");
+		CHECK(etc_lookup(&cache, key, meta, mlen, got),
+			"and is found");
+		key[ETC_KEYMAX - 1] = 'K';
+		key[ETC_KEYMAX] = '\0';
+		CHECK_EQ(etc_store(&cache, key, meta, mlen, etag), -1,
+			"a key of ETC_KEYMAX characters does not");
+
+		CHECK_EQ(etc_store(&cache, "U:/tmp/a", meta, ETC_METAMAX, etag), 0,
+			"ETC_METAMAX bytes of metadata fit");
+		CHECK_EQ(etc_store(&cache, "U:/tmp/a", meta, ETC_METAMAX + 1,
+			etag), -1, "one more does not");
+		CHECK(!etc_lookup(&cache, "U:/tmp/a", meta, ETC_METAMAX, got),
+			"and the refused store dropped what the key had");
+
+		CHECK_EQ(etc_store(&cache, "U:/tmp/a", meta, mlen, "W/\"x\""), -1,
+			"a stamp that is not ETAG_LEN characters is refused");
+	}
+
+	printf("\n--- forget ---\n");
+	{
+		mlen = fake_meta(meta, 0x000301);
+		fake_etag(etag, 4);
+		etc_store(&cache, "D:HERC01.SRC(A)", meta, mlen, etag);
+		etc_store(&cache, "D:HERC01.SRC(B)", meta, mlen, etag);
+		etc_forget(&cache, "D:HERC01.SRC(A)");
+		CHECK(!etc_lookup(&cache, "D:HERC01.SRC(A)", meta, mlen, got),
+			"a forgotten key misses");
+		CHECK(etc_lookup(&cache, "D:HERC01.SRC(B)", meta, mlen, got),
+			"its neighbour still hits");
+		etc_forget(&cache, "D:NOT.THERE");
+		CHECK(etc_lookup(&cache, "D:HERC01.SRC(B)", meta, mlen, got),
+			"forgetting an absent key changes nothing");
+	}
+
+	printf("\n--- a full block ---\n");
+	{
+		int i;
+		int bad;
+
+		etc_init(&cache);
+		for (i = 0; i < ETC_SLOTS; i++) {
+			snprintf(key, sizeof(key), "D:HERC01.SRC(M%04d)", i);
+			mlen = fake_meta(meta, (unsigned) i);
+			fake_etag(etag, (unsigned) i);
+			etc_store(&cache, key, meta, mlen, etag);
+		}
+
+		/* M0000 used, so M0001 is now the least recently used */
+		mlen = fake_meta(meta, 0);
+		CHECK(etc_lookup(&cache, "D:HERC01.SRC(M0000)", meta, mlen, got),
+			"a full block still hits");
+
+		mlen = fake_meta(meta, 9999);
+		fake_etag(etag, 9999);
+		etc_store(&cache, "D:HERC01.SRC(NEW)", meta, mlen, etag);
+		CHECK(etc_lookup(&cache, "D:HERC01.SRC(NEW)", meta, mlen, got),
+			"the new entry is in");
+		mlen = fake_meta(meta, 1);
+		CHECK(!etc_lookup(&cache, "D:HERC01.SRC(M0001)", meta, mlen, got),
+			"the least recently used one gave way");
+		mlen = fake_meta(meta, 0);
+		CHECK(etc_lookup(&cache, "D:HERC01.SRC(M0000)", meta, mlen, got),
+			"the one a hit kept fresh did not");
+
+		bad = 0;
+		for (i = 2; i < ETC_SLOTS; i++) {
+			snprintf(key, sizeof(key), "D:HERC01.SRC(M%04d)", i);
+			mlen = fake_meta(meta, (unsigned) i);
+			fake_etag(etag, (unsigned) i);
+			if (!etc_lookup(&cache, key, meta, mlen, got)
+			    || strcmp(got, etag) != 0) {
+				bad++;
+			}
+		}
+		CHECK_EQ(bad, 0, "every other entry is there, with its own stamp");
+
+		/* replacing in place: storing every key again evicts nothing */
+		for (i = 2; i < ETC_SLOTS; i++) {
+			snprintf(key, sizeof(key), "D:HERC01.SRC(M%04d)", i);
+			mlen = fake_meta(meta, (unsigned) i + 1);
+			fake_etag(etag, (unsigned) i + 1);
+			etc_store(&cache, key, meta, mlen, etag);
+		}
+		mlen = fake_meta(meta, 9999);
+		CHECK(etc_lookup(&cache, "D:HERC01.SRC(NEW)", meta, mlen, got),
+			"a store of a key already in replaces it, evicting none");
+	}
+
+	printf("\n--- layout ---\n");
+	{
+		CHECK(!etc_valid(NULL), "no block is not valid");
+		etc_init(&cache);
+		cache.ver = ETC_VERSION + 1;
+		CHECK(!etc_valid(&cache), "another version is not valid");
+		etc_init(&cache);
+		cache.len = (unsigned short) (sizeof(cache) - 4);
+		CHECK(!etc_valid(&cache), "another length is not valid");
+		etc_init(&cache);
+		cache.eye[0] = 'X';
+		CHECK(!etc_valid(&cache), "another eye-catcher is not valid");
+		etc_init(&cache);
+		CHECK(!etc_lookup(NULL, "D:X", meta, 1, got)
+			&& etc_store(NULL, "D:X", meta, 1, "0123456789ABCDEF") == -1,
+			"no block: every lookup misses, every store is refused");
+		printf("  block: %u bytes, %d entries\n",
+			(unsigned) sizeof(ETAG_CACHE), ETC_SLOTS);
+	}
+
+	printf("\n--- a hit against a re-stamp ---\n");
+	{
+		/* a 3000-line member of 80-byte records */
+		static char rec[80];
+		ETAGCTX ctx;
+		clock_t t0;
+		double hit_ns;
+		double read_ns;
+		int rounds;
+		int i;
+
+		etc_init(&cache);
+		for (i = 0; i < ETC_SLOTS; i++) {
+			snprintf(key, sizeof(key), "D:HERC01.SRC(M%04d)", i);
+			mlen = fake_meta(meta, (unsigned) i);
+			fake_etag(etag, (unsigned) i);
+			etc_store(&cache, key, meta, mlen, etag);
+		}
+		mlen = fake_meta(meta, ETC_SLOTS - 1);
+		snprintf(key, sizeof(key), "D:HERC01.SRC(M%04d)", ETC_SLOTS - 1);
+
+		t0 = clock();
+		rounds = 0;
+		do {
+			for (i = 0; i < 1000; i++) {
+				etc_lookup(&cache, key, meta, mlen, got);
+			}
+			rounds += 1000;
+		} while (clock() - t0 < CLOCKS_PER_SEC / 5);
+		hit_ns = (double) (clock() - t0) / CLOCKS_PER_SEC * 1e9 / rounds;
+
+		memset(rec, 'X', sizeof(rec));
+		t0 = clock();
+		rounds = 0;
+		do {
+			etag_init(&ctx);
+			for (i = 0; i < 3000; i++) {
+				rec[0] = (char) i;
+				etag_update(&ctx, rec, sizeof(rec));
+			}
+			etag_final(&ctx, got, ETAG_SIZE);
+			rounds++;
+		} while (clock() - t0 < CLOCKS_PER_SEC / 5);
+		read_ns = (double) (clock() - t0) / CLOCKS_PER_SEC * 1e9 / rounds;
+
+		printf("  lookup, full block, last slot: %.0f ns\n", hit_ns);
+		printf("  re-stamp of 3000 x 80 bytes, CPU only: %.0f ns (%.0fx)\n",
+			read_ns, read_ns / hit_ns);
+		printf("  (the re-stamp also reads the member; the hit reads one"
+			" directory block)\n");
+		CHECK(hit_ns < read_ns, "a hit costs less than the CRC alone");
+	}
+
+	return mbt_test_summary("TSTETCC");
+}
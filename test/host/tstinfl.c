@@ -0,0 +1,921 @@
+/*
+ * tstinfl.c - gzip and deflate request bodies, inflated as they arrive
+ * (src/inflate.c).
+ *
+ * The corpus has two halves. Three fixtures were deflated by zlib 1.2.13
+ * and are kept below as bytes: a JCL deck as gzip (with a file name in
+ * the header), the same deck as zlib, and a binary buffer as a bare
+ * deflate stream. Those are the dynamic Huffman blocks real clients send.
+ * The plain text of each is rebuilt here by the generator that made it. The
+ * other half is the test's own encoder: stored and fixed Huffman blocks
+ * with LZ77 matches, in all three wrappings and random gzip header fields.
+ * So:
+ *
+ *   1. The zlib fixtures inflate to their text whole, in random runs, and a
+ *      byte at a time.
+ *   2. 1000 random bodies from the test's encoder, some of them two gzip
+ *      members, inflate to their text in random runs.
+ *   3. A bad CRC32, ISIZE or Adler-32, a reserved gzip flag, a preset
+ *      dictionary, block type 3, a stored length that does not check, a
+ *      distance past the history, a byte after a zlib stream: INFL_EDATA.
+ *      Every proper prefix of a fixture is INFL_ETRUNC at the end, never a
+ *      success.
+ *   4. A limit below the inflated size is INFL_ELIMIT, one at it is not. A
+ *      failed sink is INFL_ESINK, and stays so.
+ *   5. What it buys: the recv() calls a body costs a byte at a time, plain
+ *      and compressed, and the inflater's own speed.
+ *
+ * ====================================================================
+ * This test drives the REAL implementation: src/inflate.c is #included
+ * below, with src/etag.c for the CRC32 it checks gzip against. The CRC32
+ * and Adler-32 the test's encoder writes are the test's own.
+ * ====================================================================
+ *
+ * Runs on host via `make test-host`.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <mbtcheck.h>
+
+#include "../../src/etag.c"
+#include "../../src/inflate.c"
+
+#define TEXT_MAX    (64 * 1024)
+#define WIRE_MAX    (TEXT_MAX * 2 + 1024)
+
+static unsigned char text[TEXT_MAX];
+static unsigned char wire[WIRE_MAX];
+static unsigned char out[TEXT_MAX * 2];
+static size_t out_len;
+static int sink_fail_at;        /* the sink call that fails, 0 for none */
+static int sink_calls;
+static INFLATE z;               /* 38 KB: not on the stack */
+
+static int
+out_sink(void *ctx, char *data, size_t len)
+{
+	(void) ctx;
+	if (++sink_calls == sink_fail_at) {
+		return -1;
+	}
+	if (len > INFL_OUTSIZE || out_len + len > sizeof(out)) {
+		return -1;
+	}
+	memcpy(out + out_len, data, len);
+	/* the span is the sink's: scribble on it, as a translation would */
+	memset(data, 0x5A, len);
+	out_len += len;
+	return 0;
+}
+
+/* Inflate wire[0..len) fed in runs of `run` bytes (0: random runs).
+   Answers the first failure, of infl_feed() or of infl_end(). */
+static int
+inflate_wire(const unsigned char *w, size_t len, int wrap, size_t run,
+    size_t limit)
+{
+	size_t off = 0;
+	size_t n;
+	int rc;
+
+	out_len = 0;
+	sink_calls = 0;
+	infl_init(&z, wrap, limit);
+	while (off < len) {
+		n = run ? run : 1 + (size_t) rand() % 700;
+		if (n > len - off) {
+			n = len - off;
+		}
+		rc = infl_feed(&z, (const char *) w + off, n, out_sink, NULL);
+		if (rc < 0) {
+			return rc;
+		}
+		off += n;
+	}
+	return infl_end(&z);
+}
+
+static int
+inflated_to(const unsigned char *t, size_t len)
+{
+	return out_len == len && memcmp(out, t, len) == 0;
+}
+
+/* ---- deflated by zlib 1.2.13: levels 9, 6 and 9 -------------------- */
+
+static const unsigned char fix_gzip_jcl[833] = {
+	0x1f, 0x8b, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x02, 0xff, 0x64, 0x65,
+	0x63, 0x6b, 0x2e, 0x6a, 0x63, 0x6c, 0x00, 0xbd, 0x98, 0xcd, 0x6e, 0x5b,
+	0x39, 0x0c, 0x46, 0xf7, 0x79, 0x0a, 0xee, 0xda, 0x09, 0x82, 0x58, 0x22,
+	0x29, 0x51, 0x5c, 0x78, 0xa1, 0xdf, 0x24, 0x45, 0x1d, 0x1b, 0xbe, 0x37,
+	0x45, 0xe7, 0xfd, 0x5f, 0x64, 0xe4, 0x09, 0xda, 0x6d, 0xb8, 0x10, 0xbc,
+	0x33, 0xae, 0x2f, 0xec, 0x0f, 0x94, 0xa8, 0x73, 0xa8, 0xc3, 0xe1, 0xf4,
+	0x6b, 0x3b, 0x8d, 0x7d, 0xdb, 0xe1, 0xc7, 0xb9, 0xc0, 0xf7, 0x5c, 0xeb,
+	0xfe, 0xcf, 0xd3, 0xb7, 0x7a, 0xbe, 0x5e, 0x3e, 0xb6, 0x6f, 0x4f, 0xf5,
+	0x67, 0xde, 0xb6, 0x63, 0x7e, 0x3a, 0x6d, 0x2f, 0x9f, 0x1f, 0x5f, 0x1f,
+	0x0e, 0x87, 0x6d, 0xef, 0x17, 0xe7, 0x1c, 0xf4, 0xdf, 0xbd, 0xc2, 0xe5,
+	0xe5, 0x74, 0x7c, 0xeb, 0xe5, 0xa5, 0xbf, 0xf7, 0xeb, 0xed, 0xbb, 0x7f,
+	0xb7, 0xcb, 0xf5, 0xed, 0x7d, 0x87, 0xd6, 0x60, 0x7e, 0x3e, 0x7f, 0xec,
+	0xc7, 0xc7, 0xcf, 0xc7, 0x1f, 0x3b, 0x02, 0xdc, 0x1e, 0xb7, 0xed, 0xfd,
+	0xf8, 0xda, 0xaf, 0xd5, 0xf9, 0xe7, 0xbd, 0x6f, 0xfb, 0x73, 0xcb, 0x7b,
+	0xa6, 0xf4, 0xd4, 0xde, 0xb6, 0xcb, 0x71, 0x7b, 0xbd, 0xfe, 0x79, 0xdb,
+	0x7f, 0xbe, 0xfd, 0xf8, 0x00, 0xd7, 0x3e, 0xe3, 0x34, 0x08, 0x2e, 0x79,
+	0x06, 0xf6, 0x35, 0x4a, 0xcf, 0x11, 0x60, 0x3b, 0x9f, 0x3a, 0xec, 0xfd,
+	0xf7, 0x0e, 0xe3, 0x7c, 0x85, 0xfd, 0xb5, 0xc3, 0xed, 0x97, 0x60, 0xeb,
+	0xfb, 0xc3, 0xe1, 0xf1, 0x6f, 0x4c, 0xbf, 0x32, 0x26, 0xc6, 0xaf, 0x63,
+	0x12, 0x32, 0x21, 0xe8, 0x0c, 0x59, 0x5c, 0x17, 0x6b, 0x4c, 0x5c, 0x19,
+	0xd3, 0x93, 0x21, 0x26, 0x61, 0x40, 0x40, 0x49, 0xbe, 0xb3, 0xb2, 0x35,
+	0x26, 0xad, 0x8c, 0x99, 0x0c, 0x31, 0x51, 0x02, 0x0b, 0x54, 0x8e, 0x45,
+	0x0b, 0x35, 0x6b, 0x4c, 0x5e, 0x5a, 0x4d, 0xfd, 0x3a, 0xa6, 0x57, 0x46,
+	0x82, 0xa1, 0x5c, 0xda, 0x98, 0xab, 0x6f, 0x8c, 0x19, 0x56, 0xc6, 0xd4,
+	0xf0, 0x75, 0xcc, 0xc8, 0x24, 0x73, 0x6f, 0x86, 0x51, 0x84, 0x13, 0x59,
+	0x63, 0xc6, 0x95, 0x31, 0xc5, 0xd2, 0xe9, 0xc9, 0x51, 0x82, 0xa6, 0x1d,
+	0x4b, 0x9c, 0xe7, 0x8c, 0x31, 0xa6, 0x2c, 0xdd, 0x9b, 0x62, 0xa9, 0x26,
+	0x93, 0x03, 0xad, 0xa3, 0xe4, 0x4e, 0x6a, 0x8d, 0x99, 0x96, 0xc6, 0x74,
+	0x86, 0x16, 0xf2, 0x51, 0x11, 0xca, 0x08, 0x5c, 0xaa, 0x74, 0x6b, 0x4c,
+	0x5d, 0x1a, 0xd3, 0x70, 0x6e, 0x46, 0xf2, 0x49, 0xc1, 0x8d, 0x11, 0x5b,
+	0x68, 0xc3, 0x18, 0xd3, 0x2f, 0xa5, 0x10, 0x1b, 0x3a, 0x9d, 0x13, 0x13,
+	0x83, 0xcb, 0xa5, 0x11, 0x62, 0xb5, 0xc6, 0x5c, 0x4a, 0xa1, 0x68, 0xd8,
+	0x9b, 0x41, 0xe6, 0x01, 0x0f, 0xe4, 0xdb, 0x18, 0x3c, 0x82, 0x35, 0xe6,
+	0x52, 0x0a, 0x25, 0x36, 0x50, 0xc8, 0x8b, 0x24, 0x40, 0x92, 0x8a, 0x98,
+	0xb2, 0x35, 0xe6, 0x52, 0x0a, 0xa1, 0xe1, 0x40, 0x72, 0xc2, 0xb3, 0x6f,
+	0xf3, 0xf0, 0x75, 0xb8, 0x51, 0xac, 0x31, 0x97, 0x52, 0x08, 0x83, 0x65,
+	0xd1, 0x63, 0x54, 0x90, 0xd6, 0x3d, 0x07, 0x9f, 0xac, 0x31, 0x97, 0x52,
+	0xc8, 0x7b, 0xc3, 0xa2, 0xb3, 0x68, 0x98, 0x4c, 0x4f, 0x53, 0x91, 0xc4,
+	0x5b, 0x63, 0x2e, 0xa5, 0x50, 0x30, 0xb4, 0xd0, 0xd4, 0x08, 0x99, 0x4c,
+	0x41, 0xe7, 0x5b, 0x0b, 0x56, 0xdf, 0xf4, 0x4b, 0x29, 0x14, 0x0c, 0xd5,
+	0x64, 0x75, 0x41, 0xa0, 0x61, 0x19, 0xd9, 0x37, 0xab, 0x6f, 0xfa, 0xa5,
+	0x14, 0x32, 0x6c, 0x4d, 0x8f, 0x51, 0xe7, 0x7f, 0x22, 0x79, 0xcd, 0xd5,
+	0xaa, 0x9b, 0x7e, 0x29, 0x84, 0x88, 0x2d, 0x1d, 0xe4, 0x68, 0xae, 0x20,
+	0xb5, 0x5e, 0x5b, 0xb6, 0xea, 0x26, 0xba, 0x7b, 0xc7, 0x44, 0xf4, 0x34,
+	0xfb, 0x41, 0x43, 0x94, 0xd4, 0xad, 0xba, 0x89, 0x4b, 0x21, 0xc4, 0x06,
+	0xa4, 0xa3, 0xd2, 0x6c, 0x5b, 0x9d, 0xce, 0x99, 0x58, 0xac, 0xba, 0x89,
+	0x78, 0x6f, 0x2b, 0x76, 0xa4, 0xaa, 0x73, 0xbc, 0x74, 0x43, 0x07, 0x59,
+	0x75, 0x13, 0xe9, 0xde, 0xc7, 0xa6, 0x4f, 0x84, 0x02, 0xb7, 0x52, 0xaa,
+	0x64, 0xab, 0x6e, 0x22, 0xdf, 0xdb, 0x3c, 0x70, 0x0e, 0x19, 0x04, 0x38,
+	0xa7, 0x74, 0xf6, 0x68, 0xd5, 0x4d, 0x5c, 0x0a, 0xa1, 0x60, 0x69, 0xa1,
+	0x48, 0xf3, 0x50, 0x97, 0x10, 0xe3, 0xe0, 0x6a, 0xd5, 0x4d, 0x5c, 0x0a,
+	0x21, 0x32, 0xb1, 0x32, 0xa6, 0x08, 0x8c, 0x49, 0xa4, 0x07, 0xab, 0x6e,
+	0xa2, 0xdc, 0xfb, 0x36, 0x01, 0x51, 0xa6, 0xbc, 0x17, 0x0a, 0x13, 0x46,
+	0xd1, 0xaa, 0x9b, 0xb8, 0x76, 0x14, 0x42, 0x03, 0x2b, 0x29, 0xdc, 0xaa,
+	0xd9, 0x72, 0x9e, 0xe3, 0xba, 0x55, 0x37, 0x71, 0x29, 0x85, 0x2c, 0x52,
+	0x3c, 0x67, 0xf3, 0x89, 0x14, 0x4e, 0xc9, 0xf5, 0x6e, 0xb5, 0x4d, 0x5a,
+	0x0a, 0x21, 0x35, 0x14, 0xd3, 0x07, 0xd2, 0x08, 0x43, 0xa8, 0x22, 0xb3,
+	0xd5, 0x36, 0x69, 0x29, 0x84, 0xc4, 0xb4, 0x35, 0xf5, 0x56, 0x9b, 0x11,
+	0x54, 0xb1, 0x5b, 0x6d, 0x93, 0x96, 0x42, 0x28, 0x1a, 0xaa, 0x39, 0xe3,
+	0xc9, 0x3c, 0x5d, 0x7a, 0xcf, 0x9c, 0x9c, 0xd5, 0x36, 0x69, 0xed, 0x24,
+	0x64, 0x12, 0x0f, 0x75, 0x30, 0x5b, 0x3c, 0xe6, 0x5e, 0xad, 0xb2, 0x49,
+	0x77, 0xbf, 0x8e, 0x73, 0xac, 0x37, 0xf0, 0x79, 0x4f, 0x54, 0x87, 0xd5,
+	0x36, 0x69, 0x29, 0x83, 0x28, 0x58, 0xa6, 0xdf, 0x38, 0x47, 0xee, 0x9a,
+	0xa5, 0x48, 0xf5, 0x56, 0xdb, 0xa4, 0x78, 0x6f, 0x54, 0xce, 0x3e, 0x4f,
+	0xff, 0xdf, 0x25, 0x60, 0xeb, 0x6a, 0xb5, 0x4d, 0x5a, 0xca, 0x20, 0x34,
+	0xa1, 0xd2, 0x47, 0x07, 0xb9, 0xa5, 0x29, 0xf1, 0xd1, 0x6a, 0x9b, 0xb4,
+	0x94, 0x41, 0x68, 0xb9, 0x40, 0x9a, 0xa3, 0x50, 0x02, 0xd5, 0xc9, 0x55,
+	0x8e, 0x56, 0xdb, 0xa4, 0xa5, 0x0c, 0x52, 0x83, 0xbb, 0x87, 0xc0, 0x29,
+	0x40, 0xd4, 0x96, 0x4a, 0xf3, 0x5f, 0xda, 0xe6, 0x7f, 0x3a, 0xd3, 0x7e,
+	0x3a, 0x47, 0x1a, 0x00, 0x00,
+};
+
+static const unsigned char fix_zlib_jcl[823] = {
+	0x78, 0x9c, 0xbd, 0x98, 0xcb, 0x6e, 0x23, 0x47, 0x0c, 0x45, 0xf7, 0xfe,
+	0x0a, 0xee, 0x66, 0xc6, 0x30, 0x46, 0x55, 0x64, 0xbd, 0xb8, 0xf0, 0xa2,
+	0xba, 0x1e, 0xb6, 0x83, 0xc8, 0x12, 0xd4, 0xed, 0x60, 0xf2, 0xff, 0x3f,
+	0x92, 0x52, 0x8c, 0xc9, 0xd6, 0x77, 0x41, 0x64, 0x27, 0xb4, 0x1a, 0xd2,
+	0x05, 0xbb, 0xc8, 0x73, 0xd8, 0xa7, 0xd3, 0xf9, 0xaf, 0xfd, 0x3c, 0x8f,
+	0xfd, 0xa0, 0x3f, 0x2e, 0x1b, 0x7d, 0xaf, 0xad, 0x1d, 0x3f, 0x9e, 0xbe,
+	0xb5, 0xcb, 0xed, 0xfa, 0xb1, 0x7f, 0x7b, 0x6a, 0x7f, 0xd6, 0x7d, 0x7f,
+	0xae, 0x4f, 0xe7, 0xfd, 0xe5, 0xf3, 0xe3, 0xeb, 0xc3, 0xe9, 0xb4, 0x1f,
+	0xe3, 0xea, 0x9c, 0xa3, 0xf1, 0x6b, 0x34, 0xba, 0xbe, 0x9c, 0x9f, 0xdf,
+	0xc6, 0xf6, 0x32, 0xde, 0xc7, 0xed, 0xfe, 0xdd, 0xdf, 0xfb, 0xf5, 0xf6,
+	0xf6, 0x7e, 0x50, 0xef, 0xb4, 0x3e, 0x5f, 0x3e, 0x8e, 0xe7, 0xc7, 0xcf,
+	0xcb, 0x1f, 0x07, 0x13, 0xdd, 0x2f, 0xf7, 0xfd, 0xfd, 0xf9, 0x75, 0xdc,
+	0x9a, 0xf3, 0x3f, 0x8f, 0xb1, 0x1f, 0x3f, 0x7b, 0x3d, 0xaa, 0x94, 0xa7,
+	0xfe, 0xb6, 0x5f, 0x9f, 0xf7, 0xd7, 0xdb, 0xef, 0xbb, 0xfd, 0xe7, 0xdd,
+	0x8f, 0x0f, 0x74, 0x1b, 0x2b, 0x4e, 0xa7, 0xe8, 0x8a, 0x0f, 0x14, 0x7c,
+	0x4b, 0x79, 0xd4, 0x44, 0xb4, 0x5f, 0xce, 0x83, 0x8e, 0xf1, 0xeb, 0xa0,
+	0x79, 0xb9, 0xd1, 0xf1, 0x3a, 0xe8, 0xfe, 0x4b, 0xb4, 0x8f, 0xe3, 0xe1,
+	0xf4, 0xf8, 0x5f, 0x4c, 0x6f, 0x19, 0x93, 0xd3, 0xd7, 0x31, 0x85, 0x83,
+	0x30, 0xe9, 0x0a, 0xb9, 0xb9, 0x91, 0xd1, 0x98, 0x6c, 0x19, 0xd3, 0x0b,
+	0x10, 0x53, 0x38, 0x32, 0x71, 0x2e, 0x7e, 0x04, 0x0d, 0x68, 0x4c, 0xb1,
+	0x8c, 0x59, 0x80, 0x98, 0x9c, 0x63, 0xc8, 0xd4, 0x42, 0xda, 0x74, 0x93,
+	0x8e, 0xc6, 0x0c, 0xa6, 0xd5, 0xd4, 0xaf, 0x63, 0x7a, 0x0d, 0x2c, 0x34,
+	0x35, 0x6c, 0x7d, 0xae, 0xa7, 0x0f, 0xc6, 0x8c, 0x96, 0x31, 0x35, 0x7e,
+	0x1d, 0x33, 0x05, 0xc9, 0xeb, 0x6c, 0xc6, 0xb9, 0xe5, 0x50, 0x04, 0x8d,
+	0x99, 0x2c, 0x63, 0x66, 0xa4, 0xd3, 0x8b, 0x93, 0x42, 0x5d, 0x07, 0x6f,
+	0x69, 0xcd, 0x19, 0x30, 0x66, 0x36, 0x3d, 0x9b, 0x19, 0xa9, 0x66, 0x10,
+	0x47, 0xda, 0xe6, 0x56, 0x87, 0x28, 0x1a, 0xb3, 0x98, 0xc6, 0x74, 0x40,
+	0x0b, 0xf9, 0xa4, 0x4c, 0xdb, 0x8c, 0x61, 0x6b, 0x79, 0xa0, 0x31, 0xd5,
+	0x34, 0x26, 0x30, 0x37, 0x93, 0xf8, 0xa2, 0xe4, 0xe6, 0x4c, 0x3d, 0xf6,
+	0x09, 0xc6, 0xf4, 0xa6, 0x14, 0x0a, 0x40, 0xa7, 0x87, 0x12, 0x24, 0x90,
+	0xab, 0x5b, 0x17, 0xe6, 0x86, 0xc6, 0x34, 0xa5, 0x50, 0x02, 0xce, 0x66,
+	0xcc, 0x6b, 0xc0, 0x93, 0xf8, 0x3e, 0x67, 0x98, 0x11, 0x8d, 0x69, 0x4a,
+	0xa1, 0x12, 0x00, 0x0a, 0xf9, 0x9c, 0x0b, 0xb1, 0xe4, 0xc6, 0x5c, 0x2a,
+	0x1a, 0xd3, 0x94, 0x42, 0x0c, 0x0c, 0x24, 0x97, 0xc3, 0xea, 0xdb, 0x3a,
+	0x7d, 0x9b, 0x6e, 0x6e, 0x68, 0x4c, 0x53, 0x0a, 0x31, 0x30, 0xde, 0x63,
+	0x4e, 0x49, 0x29, 0xf7, 0xe1, 0x43, 0xf4, 0x05, 0x8d, 0x69, 0x4a, 0x21,
+	0xef, 0x81, 0x87, 0x1e, 0xb2, 0xc6, 0xc5, 0xf4, 0xb2, 0x14, 0x29, 0x7b,
+	0x34, 0xa6, 0x29, 0x85, 0x22, 0xd0, 0x42, 0x4b, 0x23, 0xf2, 0x62, 0x0a,
+	0x3b, 0xdf, 0x7b, 0x44, 0x7d, 0xd3, 0x9b, 0x52, 0x28, 0x02, 0xd5, 0x0c,
+	0xea, 0x62, 0xa6, 0xce, 0xdb, 0xac, 0xbe, 0xa3, 0xbe, 0xe9, 0x4d, 0x29,
+	0x04, 0x1c, 0x4d, 0xcf, 0x49, 0xd7, 0x7f, 0xb2, 0x78, 0xad, 0x0d, 0xd5,
+	0x4d, 0x6f, 0x0a, 0x21, 0x01, 0xe6, 0x51, 0xcc, 0x4e, 0xd6, 0x13, 0x94,
+	0x3e, 0x5a, 0xaf, 0xa8, 0x6e, 0xb2, 0xed, 0x2a, 0x04, 0xc4, 0x64, 0xf6,
+	0xb2, 0xfa, 0x41, 0x63, 0xca, 0x65, 0xa0, 0xba, 0xc9, 0xa6, 0x10, 0x0a,
+	0x00, 0xd2, 0x59, 0x65, 0xb5, 0xad, 0x2e, 0xe7, 0x2c, 0x21, 0xa3, 0xba,
+	0xc9, 0xa6, 0x10, 0x42, 0xac, 0xd8, 0x89, 0xaa, 0xae, 0xf5, 0xd2, 0x4d,
+	0x9d, 0x82, 0xea, 0x26, 0x9b, 0x42, 0x08, 0x19, 0x9b, 0xbe, 0x08, 0x67,
+	0xba, 0x97, 0x52, 0x73, 0x45, 0x75, 0x93, 0x4d, 0x21, 0x84, 0x98, 0x07,
+	0xaf, 0x25, 0x43, 0x88, 0xd7, 0x96, 0x1e, 0x3c, 0xa3, 0xba, 0xc9, 0xa6,
+	0x10, 0x8a, 0x48, 0x0b, 0x25, 0x59, 0x43, 0x3d, 0xc7, 0x94, 0x66, 0x68,
+	0xa8, 0x6e, 0xb2, 0x29, 0x84, 0x04, 0x62, 0x65, 0x2a, 0x89, 0x02, 0x97,
+	0x9c, 0x47, 0x44, 0x75, 0x93, 0x4d, 0x21, 0x84, 0xbc, 0x4d, 0x60, 0xce,
+	0x4b, 0xde, 0x37, 0x89, 0x0b, 0x46, 0x09, 0xd5, 0x4d, 0xb6, 0x5d, 0x85,
+	0x18, 0x60, 0xa5, 0xc4, 0x7b, 0x35, 0x7b, 0xad, 0x6b, 0x5d, 0x47, 0x75,
+	0x93, 0x4d, 0x29, 0x84, 0x48, 0xf1, 0xda, 0xcd, 0x17, 0x52, 0x42, 0x29,
+	0x6e, 0x0c, 0xd4, 0x36, 0xc5, 0x14, 0x42, 0x0a, 0x14, 0xd3, 0x47, 0xd1,
+	0x44, 0x33, 0x4b, 0xe3, 0x10, 0x50, 0xdb, 0x14, 0x53, 0x08, 0x65, 0xe8,
+	0x68, 0xea, 0xbd, 0x36, 0x33, 0xaa, 0xf2, 0x40, 0x6d, 0x53, 0x4c, 0x21,
+	0x94, 0x80, 0x6a, 0xae, 0x78, 0x79, 0x4d, 0x97, 0x31, 0x6a, 0x28, 0x0e,
+	0xb5, 0x4d, 0xb1, 0xdd, 0x84, 0x20, 0xf1, 0x50, 0x47, 0xab, 0xc5, 0x53,
+	0x1d, 0x0d, 0x95, 0x4d, 0xf9, 0xdf, 0x5f, 0xc7, 0xb9, 0xa0, 0x77, 0xf0,
+	0x79, 0x2f, 0xd2, 0x26, 0x6a, 0x9b, 0x62, 0xca, 0x20, 0x01, 0xc4, 0x63,
+	0xd9, 0xd1, 0x5a, 0xb9, 0x5b, 0xcd, 0x5b, 0x6e, 0x1e, 0xb5, 0x4d, 0xb1,
+	0x5d, 0x84, 0x10, 0x29, 0x16, 0x2d, 0xff, 0xbe, 0x4b, 0xe0, 0x3e, 0x14,
+	0xb5, 0x4d, 0x31, 0x65, 0x10, 0x43, 0xa8, 0xf4, 0xc9, 0x51, 0xed, 0x65,
+	0x49, 0x7c, 0x42, 0x6d, 0x53, 0x4c, 0x19, 0xc4, 0xc8, 0x0b, 0xa4, 0xb5,
+	0x0a, 0x15, 0x52, 0x5d, 0x5c, 0x0d, 0x09, 0xb5, 0x4d, 0x31, 0x65, 0x90,
+	0x02, 0xee, 0x1e, 0x63, 0x28, 0x91, 0x92, 0xf6, 0xb2, 0x75, 0xff, 0xa5,
+	0x6d, 0xfe, 0x03, 0xf5, 0xfe, 0x68, 0x11,
+};
+
+static const unsigned char fix_raw_bin[1911] = {
+	0x55, 0x57, 0x7f, 0x4c, 0xd4, 0x75, 0x18, 0x36, 0x98, 0x35, 0x7f, 0x24,
+	0x73, 0x67, 0x03, 0x05, 0x1b, 0x7a, 0x94, 0x14, 0x7a, 0xca, 0x62, 0x0e,
+	0x2f, 0xc6, 0xd2, 0x34, 0xb2, 0xbb, 0x25, 0x75, 0x92, 0x9a, 0xe2, 0xc2,
+	0x09, 0xea, 0x79, 0xcc, 0x51, 0x27, 0xd3, 0x81, 0xa4, 0x96, 0xda, 0x42,
+	0x3b, 0x8f, 0x1f, 0x8b, 0x1f, 0x39, 0x69, 0x89, 0x2e, 0xc9, 0x1c, 0x8a,
+	0xe0, 0x96, 0x1c, 0x05, 0xe2, 0x0f, 0xa6, 0x9e, 0x0b, 0xa7, 0x5d, 0xb2,
+	0x12, 0xf2, 0x86, 0xe7, 0x79, 0x72, 0x50, 0x29, 0x72, 0x09, 0xbd, 0xf7,
+	0x3e, 0x2f, 0xdb, 0xe7, 0xf8, 0xe3, 0x7d, 0xf6, 0x7c, 0xf8, 0xde, 0x7d,
+	0xef, 0xfb, 0xf9, 0xbc, 0xef, 0xf3, 0x3c, 0x5f, 0x8b, 0x85, 0xff, 0x74,
+	0x00, 0x1f, 0x40, 0xab, 0x63, 0x6e, 0x06, 0x0b, 0x07, 0xa4, 0xf8, 0xf8,
+	0xbf, 0x76, 0xb0, 0x56, 0x40, 0xb2, 0x96, 0xae, 0xd5, 0xe9, 0x8c, 0xf8,
+	0xbc, 0x1f, 0x8b, 0xe9, 0x66, 0xfe, 0x64, 0x13, 0x98, 0x03, 0x50, 0x19,
+	0xce, 0xdf, 0x13, 0x00, 0xeb, 0x96, 0xff, 0xa5, 0xd0, 0xb7, 0xfa, 0x7c,
+	0x6e, 0xdc, 0xd7, 0x83, 0x45, 0x9b, 0x9d, 0xef, 0x11, 0x25, 0x0c, 0x60,
+	0x6d, 0xe5, 0x3b, 0xba, 0xc0, 0x22, 0x00, 0x5d, 0xc9, 0x74, 0x7f, 0xad,
+	0xd6, 0xc5, 0xbf, 0x41, 0x57, 0xc1, 0x55, 0xe7, 0x35, 0x1a, 0xa9, 0x5a,
+	0x0a, 0x70, 0x49, 0x03, 0xa0, 0xce, 0xcf, 0xbf, 0x2d, 0x03, 0x2c, 0x41,
+	0x1e, 0x3a, 0x9d, 0x7e, 0xa9, 0xd9, 0x1c, 0xc0, 0x73, 0x66, 0x63, 0x31,
+	0xb6, 0x89, 0x7f, 0xf7, 0x00, 0x58, 0x2a, 0x20, 0xdf, 0xc1, 0x4f, 0x11,
+	0x07, 0xd6, 0x03, 0x28, 0xac, 0xa4, 0x67, 0x0a, 0x0f, 0x77, 0x60, 0x7f,
+	0x8a, 0xb0, 0x78, 0x20, 0x10, 0x50, 0x6e, 0x54, 0x03, 0x28, 0xef, 0xe6,
+	0xe7, 0xcd, 0x04, 0x1b, 0x96, 0x67, 0x77, 0xd0, 0xd3, 0xa7, 0xa4, 0x98,
+	0x78, 0x07, 0x7c, 0x25, 0x5c, 0x7d, 0x11, 0x6e, 0x37, 0x55, 0x8b, 0x13,
+	0x97, 0x2c, 0x05, 0xf4, 0x7b, 0x78, 0x67, 0x9e, 0x82, 0x25, 0xc9, 0x77,
+	0xda, 0x68, 0x9f, 0xec, 0x76, 0x3d, 0xce, 0x63, 0x03, 0x16, 0x0d, 0x51,
+	0xbc, 0x6b, 0x7b, 0xc0, 0xd6, 0x00, 0x34, 0x36, 0xde, 0xc3, 0x9d, 0x60,
+	0x43, 0x80, 0x4d, 0x56, 0xda, 0xd1, 0xd6, 0xd6, 0x33, 0x38, 0xc7, 0x59,
+	0x58, 0xdc, 0xef, 0x72, 0x29, 0xb7, 0xb5, 0x02, 0x26, 0x44, 0xf0, 0x6e,
+	0xe7, 0x81, 0xcd, 0x95, 0x1d, 0xec, 0xa2, 0xbd, 0x4f, 0x4e, 0x6e, 0xe3,
+	0xfd, 0xd7, 0xc6, 0x70, 0xd5, 0x3a, 0x5d, 0x2e, 0xaa, 0xba, 0x3c, 0x9c,
+	0xc3, 0x65, 0x40, 0x6d, 0x05, 0x9f, 0x8b, 0x01, 0x6c, 0x15, 0xc0, 0xe0,
+	0xa5, 0x53, 0x32, 0x1a, 0x1f, 0x1a, 0x99, 0xf9, 0x75, 0xdc, 0x6f, 0x4f,
+	0x0a, 0x0a, 0x94, 0x7e, 0xd9, 0x05, 0x38, 0xd2, 0xc0, 0x27, 0x78, 0x1c,
+	0x6c, 0x3e, 0x60, 0x41, 0x1d, 0x9d, 0xa7, 0xdf, 0x1f, 0x8d, 0x7e, 0xd3,
+	0xc8, 0x19, 0x65, 0xf0, 0xa6, 0x1f, 0x03, 0xbb, 0x06, 0x70, 0x27, 0xf0,
+	0x59, 0x5f, 0x04, 0x9b, 0x27, 0xcd, 0xa0, 0xa3, 0x93, 0x4f, 0x4f, 0xcf,
+	0xe1, 0xd3, 0x37, 0x17, 0x73, 0x35, 0x0f, 0x06, 0x02, 0x54, 0x2d, 0xc5,
+	0xb8, 0xe4, 0x84, 0x34, 0x5f, 0x76, 0xb6, 0xb2, 0x75, 0x39, 0x80, 0xfa,
+	0x58, 0xea, 0x91, 0xa6, 0x26, 0x6d, 0x93, 0xda, 0x8a, 0x69, 0x03, 0xdc,
+	0x31, 0x61, 0x60, 0xf7, 0x01, 0x9d, 0xa9, 0xdc, 0x3f, 0x23, 0x60, 0x26,
+	0xc0, 0x96, 0x7c, 0xea, 0x26, 0x87, 0xa3, 0x1d, 0xcf, 0x59, 0x85, 0xc5,
+	0xe6, 0x38, 0xee, 0xad, 0x1d, 0x32, 0x40, 0x80, 0xb2, 0x1e, 0xee, 0xb4,
+	0xf3, 0x21, 0x23, 0x7a, 0xb2, 0x90, 0xfa, 0xae, 0xb2, 0xb2, 0x83, 0x7b,
+	0x2f, 0x3c, 0x92, 0x6b, 0x78, 0x8b, 0xc3, 0x41, 0x75, 0x74, 0x64, 0xe4,
+	0x31, 0xa7, 0x15, 0x71, 0x4f, 0xc6, 0x83, 0x55, 0xcb, 0xef, 0x3c, 0x40,
+	0x1d, 0x1a, 0x08, 0x68, 0x31, 0x87, 0xb9, 0x58, 0xec, 0xc0, 0xd6, 0x19,
+	0xc0, 0xa4, 0x7b, 0x4e, 0xd7, 0x70, 0xf7, 0x46, 0x82, 0xcd, 0x01, 0x2c,
+	0x2b, 0xa7, 0x5e, 0xee, 0xee, 0xd6, 0x60, 0x7e, 0xc7, 0x60, 0x71, 0x49,
+	0x26, 0x77, 0x76, 0x27, 0x58, 0x22, 0xc0, 0x3b, 0xcc, 0x7d, 0xde, 0x0e,
+	0x76, 0x0f, 0xf0, 0xa5, 0x83, 0xff, 0xae, 0x73, 0xe7, 0xa7, 0xf4, 0x71,
+	0x4d, 0xf1, 0x99, 0x4c, 0xc1, 0x7a, 0x10, 0x13, 0x50, 0x05, 0x18, 0x5b,
+	0xc2, 0x13, 0x51, 0x0a, 0xb6, 0x15, 0x60, 0x8c, 0xa0, 0xf9, 0x70, 0xbb,
+	0xc3, 0xdc, 0xcc, 0x56, 0xfa, 0x58, 0x91, 0x2e, 0x39, 0x79, 0x5a, 0xee,
+	0x4a, 0xb7, 0x02, 0x6e, 0x2c, 0xe5, 0x26, 0x6e, 0x03, 0x93, 0x53, 0xa9,
+	0xed, 0xa7, 0x49, 0xf2, 0x78, 0x1a, 0xa1, 0x33, 0x59, 0xb2, 0x21, 0x4f,
+	0x79, 0xae, 0x8e, 0x82, 0xc9, 0xf1, 0x27, 0x26, 0x25, 0x29, 0xc7, 0xe1,
+	0x05, 0x2c, 0x2a, 0xa7, 0x99, 0xb3, 0xd9, 0xbc, 0x3c, 0x77, 0xf6, 0xed,
+	0x5c, 0xed, 0x57, 0xf5, 0x7a, 0xaa, 0xa3, 0xd3, 0x21, 0x4f, 0xdb, 0xba,
+	0x61, 0x83, 0x72, 0xe0, 0x2b, 0x00, 0x9f, 0x1b, 0x68, 0x3a, 0xa3, 0xa2,
+	0xfa, 0x70, 0x48, 0x2f, 0x8b, 0x40, 0xec, 0xd9, 0xa3, 0x5c, 0x29, 0x3b,
+	0x98, 0xb6, 0x66, 0x8d, 0xd2, 0x44, 0x22, 0x25, 0x1f, 0x6a, 0x34, 0xc1,
+	0xbb, 0xef, 0x82, 0x1e, 0x8e, 0xc3, 0x62, 0x60, 0xe7, 0x4e, 0xe5, 0xc0,
+	0x0f, 0xc9, 0x16, 0x0c, 0xf1, 0x8c, 0xbf, 0x00, 0xf6, 0x92, 0x7c, 0x7c,
+	0x13, 0x4d, 0xbc, 0xd5, 0x1a, 0xe0, 0xa9, 0x6f, 0xfd, 0x9e, 0x6b, 0xeb,
+	0x7b, 0x67, 0xce, 0x50, 0xb5, 0x4c, 0xc5, 0x25, 0x1b, 0xe5, 0xf8, 0x67,
+	0xb1, 0x1a, 0x0c, 0xca, 0xe7, 0x00, 0xdf, 0xed, 0x27, 0x6d, 0x70, 0xb9,
+	0xca, 0x5c, 0x6a, 0x2b, 0x7a, 0xb0, 0xc9, 0x97, 0xc1, 0x44, 0x31, 0x93,
+	0xad, 0xac, 0x1b, 0x37, 0xc1, 0xf6, 0x02, 0x7e, 0x9e, 0x40, 0x2a, 0x12,
+	0x11, 0xd1, 0x84, 0x61, 0x91, 0x8e, 0x2c, 0xcf, 0xcb, 0x53, 0x6c, 0x42,
+	0xba, 0x6e, 0xd9, 0xdc, 0xb9, 0xca, 0xf3, 0x15, 0x8a, 0x90, 0x25, 0x90,
+	0xde, 0x74, 0x75, 0xad, 0x66, 0xcd, 0x49, 0x36, 0x72, 0x4d, 0x3e, 0xdb,
+	0xd6, 0x46, 0x55, 0xab, 0x87, 0xf6, 0xf8, 0x01, 0x9e, 0x18, 0xd6, 0x22,
+	0x37, 0xd8, 0x5e, 0xc0, 0x63, 0xa7, 0x33, 0xf8, 0xe3, 0x27, 0xb8, 0x98,
+	0xf5, 0x6a, 0xd9, 0xb3, 0xfa, 0xf3, 0x58, 0xa7, 0x34, 0x10, 0xa4, 0x36,
+	0x40, 0xd6, 0x65, 0x56, 0xad, 0x68, 0x30, 0x17, 0x60, 0x62, 0x2d, 0x69,
+	0x58, 0x45, 0x45, 0x1b, 0xfc, 0xe5, 0x3f, 0x2c, 0x36, 0x1b, 0x58, 0xd1,
+	0xbe, 0x02, 0x8b, 0x03, 0x8c, 0xac, 0x62, 0x7d, 0xbb, 0x02, 0x06, 0x57,
+	0xd2, 0xdd, 0x30, 0x90, 0xda, 0x79, 0xbd, 0x0f, 0x58, 0xf1, 0x8c, 0xd3,
+	0xb9, 0x1a, 0x63, 0x1e, 0x3e, 0xa4, 0xaa, 0xfb, 0x11, 0x97, 0xc8, 0xb7,
+	0x3c, 0xe7, 0x0f, 0x2a, 0xa1, 0x6e, 0x91, 0x8e, 0xf5, 0x50, 0x0e, 0x75,
+	0xd2, 0x13, 0xd2, 0xc5, 0x82, 0x82, 0xc9, 0x05, 0xea, 0x11, 0x1b, 0xe0,
+	0x47, 0x33, 0xc1, 0x7e, 0x00, 0x3c, 0xda, 0xb5, 0x4b, 0x11, 0x78, 0xe9,
+	0x9e, 0x6f, 0x8f, 0x90, 0x82, 0x36, 0x34, 0x44, 0xc3, 0x07, 0x4b, 0xb0,
+	0x58, 0x7a, 0x9c, 0xf5, 0xf4, 0x1d, 0xb0, 0x5e, 0xc0, 0x1f, 0xf3, 0xe7,
+	0x2b, 0x23, 0xb3, 0x1b, 0x30, 0xb2, 0x80, 0xb4, 0xb6, 0xae, 0xae, 0x97,
+	0xf5, 0xd6, 0x7f, 0x8a, 0xab, 0x7f, 0x4d, 0x74, 0x34, 0xd5, 0x51, 0x7b,
+	0x29, 0x07, 0x4c, 0xd5, 0x68, 0x14, 0x26, 0x73, 0x34, 0x94, 0x4f, 0xaa,
+	0x9c, 0x91, 0x71, 0x15, 0x3d, 0x7c, 0x49, 0x2c, 0xf9, 0xd8, 0x31, 0xc5,
+	0xb2, 0x5e, 0x01, 0x64, 0x5f, 0x63, 0xc5, 0x5e, 0x2b, 0x8a, 0x22, 0x66,
+	0xe3, 0x26, 0xfd, 0x4e, 0x48, 0xc8, 0x82, 0x5f, 0x3f, 0x14, 0x47, 0xb8,
+	0x28, 0x6a, 0xae, 0x3e, 0xfb, 0xdf, 0xf3, 0xe6, 0x29, 0xe1, 0x44, 0x76,
+	0x29, 0xbb, 0xae, 0x0e, 0xe7, 0x10, 0x54, 0xfb, 0xf4, 0x57, 0xb9, 0xa6,
+	0x4f, 0xc9, 0xc9, 0xa1, 0x6a, 0x76, 0x42, 0xf5, 0x67, 0x02, 0x3e, 0x2e,
+	0x66, 0x17, 0xf8, 0x1d, 0x6c, 0x0c, 0xe0, 0xd9, 0xc1, 0xc1, 0xa0, 0x54,
+	0xfe, 0x15, 0x60, 0x56, 0x6a, 0xe6, 0x54, 0x93, 0x59, 0x5c, 0xac, 0xdc,
+	0xe1, 0x82, 0xe4, 0xa5, 0x13, 0x27, 0x14, 0x97, 0xd9, 0x0c, 0x58, 0x6c,
+	0x23, 0xf7, 0xc8, 0xce, 0xd6, 0x20, 0x57, 0x94, 0x89, 0xa7, 0x62, 0x60,
+	0xf5, 0x22, 0xb1, 0x12, 0x32, 0x72, 0xd8, 0x59, 0x9a, 0xc1, 0xc4, 0xfb,
+	0x47, 0xea, 0xc9, 0x67, 0x62, 0x63, 0xbb, 0xd8, 0x6b, 0x9a, 0x4a, 0xb8,
+	0x36, 0x5d, 0xd0, 0x6a, 0xa9, 0x5a, 0x16, 0xe2, 0x92, 0xf7, 0x01, 0xfb,
+	0x60, 0xd0, 0x72, 0xb6, 0xdb, 0x25, 0x3a, 0xa4, 0x91, 0x23, 0x0d, 0x0c,
+	0xa4, 0x62, 0x2a, 0x67, 0x63, 0x71, 0x47, 0x18, 0x2b, 0xe1, 0x9f, 0x60,
+	0x0f, 0x44, 0x15, 0xef, 0xdf, 0x57, 0x12, 0xd9, 0x8b, 0xe2, 0x16, 0x9d,
+	0xe4, 0x5d, 0xa9, 0xa9, 0x85, 0xc8, 0x3f, 0x5f, 0x63, 0x71, 0xf6, 0xc8,
+	0x88, 0x6a, 0x44, 0x80, 0xe5, 0x26, 0x93, 0x72, 0x62, 0x32, 0xda, 0xa5,
+	0x5b, 0xc8, 0xe5, 0xf2, 0xf3, 0xcf, 0xb2, 0xd3, 0x39, 0xcc, 0x50, 0xfd,
+	0x84, 0xf6, 0x76, 0xaa, 0x96, 0x75, 0x21, 0x19, 0xec, 0xb7, 0x2a, 0x76,
+	0xc0, 0x37, 0x2c, 0xea, 0x8d, 0xf6, 0x36, 0x93, 0x1f, 0xc6, 0xc5, 0x2d,
+	0x40, 0xde, 0xba, 0x2d, 0x5a, 0xb7, 0x83, 0xe5, 0x78, 0x5b, 0x88, 0x9d,
+	0x55, 0xa7, 0xa7, 0x2b, 0x42, 0x7d, 0x44, 0x8e, 0xa3, 0x8c, 0x9c, 0xb3,
+	0xa7, 0xe7, 0x06, 0x72, 0x9a, 0x34, 0xf4, 0xfe, 0xf3, 0xec, 0xa3, 0x9f,
+	0x82, 0x5d, 0x01, 0x7c, 0x86, 0xa0, 0x3b, 0x2f, 0xe4, 0xd9, 0x2f, 0x9c,
+	0x24, 0x8f, 0x2d, 0x2c, 0xb4, 0xb3, 0xcf, 0x56, 0x5a, 0xb9, 0x56, 0xce,
+	0xe8, 0xe8, 0xa0, 0x1a, 0xfe, 0x0b, 0xfc, 0xb6, 0x11, 0xb0, 0x38, 0x92,
+	0xfd, 0x77, 0x12, 0xd8, 0x08, 0x60, 0x49, 0x4b, 0x4b, 0xf0, 0x69, 0xb7,
+	0x39, 0x98, 0xbd, 0x1d, 0xce, 0xb9, 0xf7, 0x2d, 0x04, 0x33, 0xf1, 0xdb,
+	0x7c, 0xc0, 0x42, 0x34, 0xad, 0x78, 0xe3, 0xbb, 0x80, 0xaa, 0x69, 0xe4,
+	0xdb, 0x45, 0x45, 0x9b, 0x8b, 0xd4, 0x31, 0xbc, 0x1a, 0xcf, 0x1b, 0xbb,
+	0x52, 0xf2, 0xa0, 0xec, 0x52, 0x75, 0xb5, 0xe2, 0x24, 0xd3, 0x65, 0x9c,
+	0xd2, 0xc8, 0xe1, 0x0f, 0x1c, 0xd8, 0xc6, 0x2e, 0x1f, 0x78, 0x93, 0x6b,
+	0x60, 0x50, 0xab, 0xa5, 0x3a, 0xda, 0xad, 0x22, 0x10, 0xd7, 0x73, 0x73,
+	0x95, 0x40, 0x2e, 0x5d, 0xf7, 0x45, 0x47, 0x47, 0x70, 0x60, 0x9f, 0xc7,
+	0xc0, 0x7e, 0x24, 0x7d, 0x66, 0xe0, 0x64, 0xf0, 0x8c, 0x45, 0xf5, 0xcd,
+	0x5c, 0x38, 0xd7, 0xcd, 0x10, 0x8b, 0xac, 0x3f, 0x4d, 0xa9, 0xa1, 0xa6,
+	0x26, 0x12, 0xb9, 0xb7, 0x14, 0x8b, 0x5b, 0x23, 0x23, 0x95, 0x38, 0x29,
+	0x2e, 0xb3, 0x6e, 0x0e, 0x27, 0x8a, 0xd7, 0xc5, 0x1b, 0x01, 0x87, 0x97,
+	0x51, 0xbe, 0x28, 0x2f, 0xb7, 0x72, 0xc6, 0xe8, 0xee, 0xe0, 0xda, 0xdd,
+	0xa0, 0xd1, 0x50, 0xb5, 0x4c, 0xc3, 0x25, 0x12, 0x86, 0xee, 0x8d, 0x19,
+	0xa3, 0x98, 0xdb, 0xbf, 0x00, 0xe3, 0x12, 0x4a, 0x22, 0x99, 0x99, 0x25,
+	0xc8, 0xd9, 0x1f, 0x60, 0x31, 0xaf, 0xb3, 0x53, 0xb1, 0x33, 0xf9, 0xf8,
+	0x48, 0x62, 0xa2, 0x62, 0x91, 0x92, 0xcb, 0x87, 0xbc, 0x94, 0x59, 0x86,
+	0x87, 0xbf, 0x19, 0x56, 0x07, 0x36, 0xbe, 0xbd, 0x5d, 0xe9, 0xba, 0x0e,
+	0xc0, 0x27, 0xf7, 0xee, 0x29, 0x77, 0x90, 0xd8, 0xb4, 0xfc, 0x4b, 0x4e,
+	0x37, 0x1b, 0xd1, 0xec, 0xf1, 0x80, 0x89, 0xd7, 0xaf, 0x07, 0x73, 0xfe,
+	0x78, 0x24, 0x9d, 0xdd, 0x80, 0x5f, 0xfb, 0x38, 0xf9, 0x6c, 0x02, 0x5b,
+	0x01, 0x98, 0xe8, 0xa3, 0x1c, 0x64, 0x32, 0x3d, 0x36, 0x31, 0x5b, 0x9f,
+	0xc2, 0x6f, 0x46, 0xb6, 0x83, 0x9c, 0x8a, 0x12, 0x11, 0x7f, 0x6e, 0x01,
+	0x56, 0x54, 0x71, 0x46, 0x1a, 0x0f, 0xb6, 0x16, 0xb0, 0x78, 0x2c, 0x25,
+	0xa6, 0x92, 0x92, 0x66, 0xbc, 0x47, 0xfc, 0x83, 0xc5, 0x4d, 0xa5, 0xa5,
+	0xa3, 0x41, 0x89, 0xfe, 0xea, 0x01, 0x77, 0xb6, 0x72, 0x9a, 0xb2, 0x82,
+	0xf5, 0x02, 0x92, 0x8c, 0xc6, 0xa0, 0x41, 0xc7, 0x72, 0xbe, 0x72, 0x1f,
+	0xe4, 0xea, 0x6e, 0x08, 0x0b, 0xa3, 0x3a, 0x7a, 0xf7, 0x9b, 0x00, 0xed,
+	0x4a, 0xfe, 0xba, 0xf5, 0x3e, 0x4e, 0x5f, 0x32, 0xb7, 0x97, 0x2e, 0x51,
+	0x0a, 0x73, 0x3a, 0xc7, 0x39, 0xd5, 0x37, 0x94, 0x84, 0xbb, 0x9c, 0xc9,
+	0x1e, 0x85, 0x58, 0xb9, 0x65, 0x02, 0x27, 0xb4, 0xd7, 0x42, 0xda, 0xe6,
+	0xd4, 0x0d, 0xca, 0x6b, 0x4b, 0x97, 0x1e, 0xc4, 0x8b, 0xc7, 0x64, 0x89,
+	0x70, 0x6d, 0x6d, 0xca, 0xcb, 0xc8, 0x6a, 0xc0, 0x39, 0x28, 0xd8, 0x72,
+	0x8b, 0xfa, 0xca, 0xb6, 0xb9, 0x96, 0x92, 0x5d, 0x7f, 0x7f, 0x1f, 0xa7,
+	0x3b, 0xcf, 0x14, 0xae, 0x9e, 0xb2, 0xc6, 0x46, 0xaa, 0x96, 0x9f, 0x42,
+	0xba, 0x2e, 0x26, 0x2b, 0x4b, 0x39, 0x4d, 0x89, 0x5b, 0x7d, 0x69, 0x94,
+	0x01, 0x9f, 0x3e, 0xed, 0xc1, 0xfb, 0xd5, 0x0c, 0x2c, 0xb6, 0x1c, 0xe5,
+	0x44, 0x18, 0x13, 0x12, 0xa2, 0x52, 0x20, 0xfe, 0xf2, 0xee, 0x7b, 0x4b,
+	0x04, 0x37, 0x91, 0xd2, 0x62, 0x52, 0x92, 0x1f, 0x4f, 0x2d, 0x61, 0xe8,
+	0x10, 0xc4, 0xaa, 0x26, 0xe4, 0x5d, 0xe6, 0xb0, 0xd7, 0xab, 0x64, 0x22,
+	0xb1, 0x90, 0x73, 0x8b, 0x16, 0x05, 0x7b, 0xfe, 0x2e, 0x67, 0x4b, 0xdb,
+	0x38, 0xae, 0xb6, 0x7d, 0x5e, 0x2f, 0x55, 0xfb, 0x64, 0x64, 0xcc, 0x66,
+	0x40, 0xc1, 0x76, 0xce, 0x9c, 0xb1, 0x60, 0x45, 0x00, 0xc3, 0x55, 0x4a,
+	0xa0, 0x7a, 0xfd, 0x6a, 0x3d, 0xb3, 0x38, 0x3b, 0xbf, 0x3b, 0x27, 0x22,
+	0x59, 0xdd, 0x0e, 0x11, 0x96, 0x2c, 0x74, 0xb2, 0xe4, 0x82, 0x3b, 0x92,
+	0x12, 0xfe, 0x07,
+};
+
+/* ---- the corpus generators (gen.py made the fixtures from the same) --- */
+
+static size_t
+corpus_jcl(unsigned char *buf)
+{
+	unsigned seed = 1;
+	size_t len;
+	int i;
+
+	len = (size_t) sprintf((char *) buf,
+	    "//MVSMFTST JOB (ACCT),'CORPUS',CLASS=A,MSGCLASS=H\n");
+	for (i = 0; i < 40; i++) {
+		seed = seed * 1103515245U + 12345U;
+		len += (size_t) sprintf((char *) buf + len,
+		    "//STEP%03d EXEC PGM=IEBGENER\n//SYSPRINT DD SYSOUT=*\n"
+		    "//SYSUT2   DD DSN=HERC01.TEST.DATA%u,DISP=SHR\n"
+		    "//SYSUT1   DD *\n"
+		    " RECORD %05u %08X  SOME TEXT FOR THE DATA SET\n/*\n",
+		    i, (seed >> 16) % 100, (seed >> 8) & 0xFFFF, seed);
+	}
+	return len;
+}
+
+static size_t
+corpus_binary(unsigned char *buf)
+{
+	unsigned seed = 7;
+	size_t i;
+
+	for (i = 0; i < 4096; i++) {
+		seed = seed * 1103515245U + 12345U;
+		buf[i] = (unsigned char) (i % 7 == 0 ? (seed >> 16) & 0xFF : buf[i / 3]);
+	}
+	return 4096;
+}
+
+/* ---- the test's own encoder: stored and fixed Huffman blocks ---------- */
+
+static unsigned long
+ref_crc32(const unsigned char *p, size_t len)
+{
+	unsigned long crc = 0xFFFFFFFFUL;
+	int k;
+
+	while (len-- > 0) {
+		crc ^= *p++;
+		for (k = 0; k < 8; k++) {
+			crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320UL : crc >> 1;
+		}
+	}
+	return ~crc & 0xFFFFFFFFUL;
+}
+
+static unsigned long
+ref_adler32(const unsigned char *p, size_t len)
+{
+	unsigned long a = 1;
+	unsigned long b = 0;
+
+	while (len-- > 0) {
+		a = (a + *p++) % 65521;
+		b = (b + a) % 65521;
+	}
+	return (b << 16) | a;
+}
+
+typedef struct {
+	unsigned char *buf;
+	size_t len;
+	unsigned long bits;
+	int n;
+} BITW;
+
+static void
+put_bits(BITW *w, unsigned long v, int n)
+{
+	w->bits |= v << w->n;
+	w->n += n;
+	while (w->n >= 8) {
+		w->buf[w->len++] = (unsigned char) (w->bits & 0xFF);
+		w->bits >>= 8;
+		w->n -= 8;
+	}
+}
+
+/* a Huffman code goes out most significant bit first */
+static void
+put_code(BITW *w, unsigned code, int n)
+{
+	unsigned rev = 0;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		rev = (rev << 1) | ((code >> i) & 1);
+	}
+	put_bits(w, rev, n);
+}
+
+static void
+put_align(BITW *w)
+{
+	if (w->n > 0) {
+		put_bits(w, 0, 8 - w->n);
+	}
+}
+
+static void
+put_literal(BITW *w, int sym)
+{
+	if (sym < 144) {
+		put_code(w, 0x30 + sym, 8);
+	} else if (sym < 256) {
+		put_code(w, 0x190 + sym - 144, 9);
+	} else if (sym < 280) {
+		put_code(w, sym - 256, 7);
+	} else {
+		put_code(w, 0xC0 + sym - 280, 8);
+	}
+}
+
+static void
+put_match(BITW *w, unsigned len, unsigned dist)
+{
+	int i;
+
+	for (i = 28; infl_lbase[i] > (short) len; i--)
+		;
+	put_literal(w, 257 + i);
+	put_bits(w, len - infl_lbase[i], infl_lext[i]);
+	for (i = 29; infl_dbase[i] > dist; i--)
+		;
+	put_code(w, i, 5);
+	put_bits(w, dist - infl_dbase[i], infl_dext[i]);
+}
+
+/* One fixed block, greedy matches found by brute force over a short
+   reach: slow and simple, which is what a reference should be. */
+static void
+put_fixed(BITW *w, const unsigned char *t, size_t start, size_t end, int last)
+{
+	size_t i = start;
+	size_t j;
+	size_t best;
+	size_t best_dist;
+	size_t k;
+	size_t reach;
+
+	put_bits(w, last, 1);
+	put_bits(w, 1, 2);
+	while (i < end) {
+		best = 0;
+		best_dist = 0;
+		reach = rand() % 128 == 0 ? 32768 : 300;
+		for (j = i > reach ? i - reach : 0; j < i; j++) {
+			for (k = 0; i + k < end && k < 258 && t[j + k] == t[i + k]; k++)
+				;
+			if (k >= 3 && k >= best) {
+				best = k;
+				best_dist = i - j;
+			}
+		}
+		if (best >= 3) {
+			put_match(w, (unsigned) best, (unsigned) best_dist);
+			i += best;
+		} else {
+			put_literal(w, t[i++]);
+		}
+	}
+	put_literal(w, 256);
+}
+
+static void
+put_stored(BITW *w, const unsigned char *t, size_t start, size_t end, int last)
+{
+	size_t n = end - start;
+
+	put_bits(w, last, 1);
+	put_bits(w, 0, 2);
+	put_align(w);
+	put_bits(w, n & 0xFFFF, 16);
+	put_bits(w, ~n & 0xFFFF, 16);
+	memcpy(w->buf + w->len, t + start, n);
+	w->len += n;
+}
+
+/* A bare deflate stream of t, in blocks of random size and type */
+static void
+put_deflate(BITW *w, const unsigned char *t, size_t len)
+{
+	size_t start = 0;
+	size_t end;
+
+	do {
+		end = start + 1 + (size_t) rand() % 6000;
+		if (end > len) {
+			end = len;
+		}
+		if (rand() % 3 == 0) {
+			put_stored(w, t, start, end, end == len);
+		} else {
+			put_fixed(w, t, start, end, end == len);
+		}
+		start = end;
+	} while (start < len);
+	put_align(w);
+}
+
+static void
+put_le32(BITW *w, unsigned long v)
+{
+	put_bits(w, v & 0xFFFF, 16);
+	put_bits(w, (v >> 16) & 0xFFFF, 16);
+}
+
+static void
+put_gzip_member(BITW *w, const unsigned char *t, size_t len)
+{
+	int flags = rand() & (GZ_FHCRC | GZ_FEXTRA | GZ_FNAME | GZ_FCOMMENT);
+	int i;
+	int n;
+
+	put_bits(w, 0x1F, 8);
+	put_bits(w, 0x8B, 8);
+	put_bits(w, 8, 8);
+	put_bits(w, (unsigned long) flags, 8);
+	for (i = 0; i < 6; i++) {
+		put_bits(w, (unsigned long) rand() & 0xFF, 8);    /* MTIME XFL OS */
+	}
+	if (flags & GZ_FEXTRA) {
+		n = rand() % 40;
+		put_bits(w, (unsigned long) n, 16);
+		while (n-- > 0) {
+			put_bits(w, (unsigned long) rand() & 0xFF, 8);
+		}
+	}
+	for (i = 0; i < 2; i++) {
+		if (flags & (i ? GZ_FCOMMENT : GZ_FNAME)) {
+			n = rand() % 30;
+			while (n-- > 0) {
+				put_bits(w, (unsigned long) 'a' + rand() % 26, 8);
+			}
+			put_bits(w, 0, 8);
+		}
+	}
+	if (flags & GZ_FHCRC) {
+		put_bits(w, (unsigned long) rand() & 0xFFFF, 16); /* not checked */
+	}
+	put_deflate(w, t, len);
+	put_le32(w, ref_crc32(t, len));
+	put_le32(w, (unsigned long) len);
+}
+
+/* t wrapped as `wrap` (INFL_GZIP, INFL_ZLIB, INFL_RAW) into wire[] */
+static size_t
+encode(const unsigned char *t, size_t len, int wrap, int members)
+{
+	BITW w;
+	unsigned long adler;
+	size_t half;
+
+	memset(&w, 0, sizeof(w));
+	w.buf = wire;
+	if (wrap == INFL_GZIP) {
+		half = members > 1 ? len / 2 : len;
+		put_gzip_member(&w, t, half);
+		if (members > 1) {
+			put_gzip_member(&w, t + half, len - half);
+		}
+	} else if (wrap == INFL_ZLIB) {
+		put_bits(&w, 0x78, 8);
+		put_bits(&w, 0x9C, 8);
+		put_deflate(&w, t, len);
+		adler = ref_adler32(t, len);
+		put_bits(&w, (adler >> 24) & 0xFF, 8);
+		put_bits(&w, (adler >> 16) & 0xFF, 8);
+		put_bits(&w, (adler >> 8) & 0xFF, 8);
+		put_bits(&w, adler & 0xFF, 8);
+	} else {
+		put_deflate(&w, t, len);
+	}
+	return w.len;
+}
+
+/* a random body: JCL-ish lines, or bytes with repeats in them */
+static size_t
+random_text(void)
+{
+	static const char *words[] = {
+		"//", "JOB", "EXEC", "PGM=IEFBR14", "DD", "DSN=HERC01.SRC",
+		"DISP=SHR", " ", ",", "\n", "SYSOUT=*", "'", "0123456789"
+	};
+	size_t len = (size_t) rand() % 20000;
+	size_t i = 0;
+	const char *wd;
+
+	if (rand() % 2) {
+		while (i < len) {
+			wd = words[rand() % 13];
+			while (*wd && i < len) {
+				text[i++] = (unsigned char) *wd++;
+			}
+		}
+	} else {
+		for (i = 0; i < len; i++) {
+			text[i] = (unsigned char) (rand() % 4 == 0 || i < 8
+			    ? rand() : text[i - 1 - rand() % 8]);
+		}
+	}
+	return len;
+}
+
+/* `len` bytes of a fixture inflate to t: whole, in random runs, a byte
+   at a time */
+static void
+check_fixture(const unsigned char *f, size_t len, int wrap,
+    const unsigned char *t, size_t tlen, const char *what)
+{
+	int ok;
+
+	ok = inflate_wire(f, len, wrap, len, 0) == 0 && inflated_to(t, tlen);
+	ok = ok && inflate_wire(f, len, wrap, 0, 0) == 0 && inflated_to(t, tlen);
+	ok = ok && inflate_wire(f, len, wrap, 1, 0) == 0 && inflated_to(t, tlen);
+	CHECK(ok, what);
+}
+
+/* every proper prefix is truncated, never a success or a data error */
+static int
+prefixes_truncated(const unsigned char *f, size_t len, int wrap)
+{
+	size_t n;
+	int bad = 0;
+
+	for (n = 0; n < len; n++) {
+		if (inflate_wire(f, n, wrap, n ? n : 1, 0) != INFL_ETRUNC) {
+			bad++;
+		}
+	}
+	return bad;
+}
+
+static int
+inflate_copy(const unsigned char *f, size_t len, int wrap)
+{
+	memcpy(wire, f, len);
+	return inflate_wire(wire, len, wrap, 0, 0);
+}
+
+int
+main(void)
+{
+	static unsigned char jcl[8192];
+	static unsigned char bin[4096];
+	size_t jcl_len;
+	size_t bin_len;
+	size_t len;
+	size_t wlen;
+	int wrap;
+	int bad;
+	int i;
+
+	srand(19);
+	jcl_len = corpus_jcl(jcl);
+	bin_len = corpus_binary(bin);
+
+	printf("--- the zlib fixtures ---\n");
+	{
+		CHECK_EQ((int) jcl_len, 6727, "the JCL deck is the one deflated");
+		check_fixture(fix_gzip_jcl, sizeof(fix_gzip_jcl), INFL_GZIP,
+			jcl, jcl_len, "gzip, a file name in the header: the deck");
+		check_fixture(fix_zlib_jcl, sizeof(fix_zlib_jcl), INFL_DEFLATE,
+			jcl, jcl_len, "deflate as zlib: the deck");
+		check_fixture(fix_raw_bin, sizeof(fix_raw_bin), INFL_DEFLATE,
+			bin, bin_len, "deflate as a bare stream: the binary");
+	}
+
+	printf("\n--- the test's encoder, random ---\n");
+	{
+		bad = 0;
+		for (i = 0; i < 1000; i++) {
+			len = random_text();
+			wrap = rand() % 3 == 0 ? INFL_GZIP
+			    : rand() % 2 ? INFL_ZLIB : INFL_RAW;
+			wlen = encode(text, len, wrap, rand() % 3 == 0 ? 2 : 1);
+			if (inflate_wire(wire, wlen, wrap == INFL_GZIP ? INFL_GZIP
+			    : INFL_DEFLATE, 0, 0) != 0 || !inflated_to(text, len)) {
+				bad++;
+			}
+		}
+		CHECK_EQ(bad, 0, "1000 bodies in random runs: their text");
+		wlen = encode(jcl, jcl_len, INFL_GZIP, 2);
+		CHECK(inflate_wire(wire, wlen, INFL_GZIP, 0, 0) == 0
+			&& inflated_to(jcl, jcl_len) && z.members == 2,
+			"two gzip members: one body");
+	}
+
+	printf("\n--- bad streams ---\n");
+	{
+		static const unsigned char fdict[] = { 0x78, 0xBB, 0, 0, 0, 1, 3, 0 };
+		static const unsigned char btype3[] = { 0x07, 0x00, 0x00 };
+		static const unsigned char nlen[] = { 0x01, 0x05, 0x00, 0x00, 0x00,
+			'A', 'B', 'C', 'D', 'E' };
+		unsigned char far[16];
+		BITW w;
+
+		len = sizeof(fix_gzip_jcl);
+		memcpy(wire, fix_gzip_jcl, len);
+		wire[len - 8] ^= 1;
+		CHECK_EQ(inflate_wire(wire, len, INFL_GZIP, 0, 0), INFL_EDATA,
+			"gzip: a bad CRC32");
+		memcpy(wire, fix_gzip_jcl, len);
+		wire[len - 4] ^= 1;
+		CHECK_EQ(inflate_wire(wire, len, INFL_GZIP, 0, 0), INFL_EDATA,
+			"gzip: a bad ISIZE");
+		memcpy(wire, fix_gzip_jcl, len);
+		wire[3] |= 0x20;
+		CHECK_EQ(inflate_wire(wire, len, INFL_GZIP, 0, 0), INFL_EDATA,
+			"gzip: a reserved flag");
+		memcpy(wire, fix_gzip_jcl, len);
+		memcpy(wire + len, "\x1f\x8c\x08\0\0\0\0\0\0\3", 10);
+		CHECK_EQ(inflate_wire(wire, len + 10, INFL_GZIP, 0, 0), INFL_EDATA,
+			"gzip: no member after a member");
+
+		len = sizeof(fix_zlib_jcl);
+		memcpy(wire, fix_zlib_jcl, len);
+		wire[len - 1] ^= 1;
+		CHECK_EQ(inflate_wire(wire, len, INFL_DEFLATE, 0, 0), INFL_EDATA,
+			"zlib: a bad Adler-32");
+		memcpy(wire, fix_zlib_jcl, len);
+		wire[len] = 0;
+		CHECK_EQ(inflate_wire(wire, len + 1, INFL_DEFLATE, 0, 0), INFL_EDATA,
+			"zlib: a byte after the stream");
+		CHECK_EQ(inflate_copy(fdict, sizeof(fdict), INFL_DEFLATE), INFL_EDATA,
+			"zlib: a preset dictionary");
+
+		CHECK_EQ(inflate_copy(btype3, sizeof(btype3), INFL_DEFLATE),
+			INFL_EDATA, "block type 3");
+		CHECK_EQ(inflate_copy(nlen, sizeof(nlen), INFL_DEFLATE), INFL_EDATA,
+			"a stored length that does not check");
+
+		memset(&w, 0, sizeof(w));
+		w.buf = far;
+		put_bits(&w, 1, 1);
+		put_bits(&w, 1, 2);
+		put_literal(&w, 'A');
+		put_match(&w, 3, 2);
+		put_literal(&w, 256);
+		put_align(&w);
+		CHECK_EQ(inflate_copy(far, w.len, INFL_DEFLATE), INFL_EDATA,
+			"a distance past the history");
+		CHECK_EQ(infl_feed(&z, "x", 1, out_sink, NULL), INFL_EDATA,
+			"  and the next feed answers it too");
+
+		CHECK_EQ(prefixes_truncated(fix_gzip_jcl, sizeof(fix_gzip_jcl),
+			INFL_GZIP), 0, "every gzip prefix: truncated");
+		CHECK_EQ(prefixes_truncated(fix_zlib_jcl, sizeof(fix_zlib_jcl),
+			INFL_DEFLATE), 0, "every zlib prefix: truncated");
+		CHECK_EQ(prefixes_truncated(fix_raw_bin, sizeof(fix_raw_bin),
+			INFL_DEFLATE), 0, "every bare deflate prefix: truncated");
+	}
+
+	printf("\n--- limits and the sink ---\n");
+	{
+		len = sizeof(fix_gzip_jcl);
+		CHECK_EQ(inflate_wire(fix_gzip_jcl, len, INFL_GZIP, 0, jcl_len - 1),
+			INFL_ELIMIT, "a byte over the limit");
+		CHECK(inflate_wire(fix_gzip_jcl, len, INFL_GZIP, 0, jcl_len) == 0
+			&& inflated_to(jcl, jcl_len), "exactly the limit");
+		sink_fail_at = 2;
+		CHECK_EQ(inflate_wire(fix_gzip_jcl, len, INFL_GZIP, len, 0),
+			INFL_ESINK, "a failed sink");
+		CHECK_EQ(out_len, (size_t) INFL_OUTSIZE, "  after one full call");
+		CHECK_EQ(infl_feed(&z, (const char *) fix_gzip_jcl, 1, out_sink,
+			NULL), INFL_ESINK, "  the next feed answers it");
+		CHECK_EQ(infl_end(&z), INFL_ESINK, "  and so does the end");
+		sink_fail_at = 0;
+	}
+
+	printf("\n--- what it buys ---\n");
+	{
+		clock_t t0;
+		double secs;
+		size_t bytes = 0;
+		int rounds = 0;
+
+		printf("  recv() calls a byte at a time: JCL %lu plain, %lu gzip; "
+			"binary %lu plain, %lu deflate\n",
+			(unsigned long) jcl_len, (unsigned long) sizeof(fix_gzip_jcl),
+			(unsigned long) bin_len, (unsigned long) sizeof(fix_raw_bin));
+		CHECK(sizeof(fix_gzip_jcl) * 4 < jcl_len,
+			"JCL: a quarter of the recv() calls, or fewer");
+
+		t0 = clock();
+		do {
+			inflate_wire(fix_gzip_jcl, sizeof(fix_gzip_jcl), INFL_GZIP,
+				sizeof(fix_gzip_jcl), 0);
+			bytes += out_len;
+			rounds++;
+		} while ((secs = (double) (clock() - t0) / CLOCKS_PER_SEC) < 0.2);
+		printf("  inflate: %d decks, %.1f MB/s out\n", rounds,
+			bytes / secs / 1e6);
+		CHECK(bytes == (size_t) rounds * jcl_len, "every round: the deck");
+	}
+
+	return mbt_test_summary("TSTINFL");
+}
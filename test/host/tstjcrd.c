@@ -0,0 +1,280 @@
+/*
+ * tstjcrd.c - the JCL card framer (src/jclcard.c) the streaming submitter
+ * cuts an arriving body with.
+ *
+ * The framer replaced a whole-body pass: copy the body with a NUL after it,
+ * tokenize() it at the EBCDIC NEL, drop one trailing CR from each token,
+ * strncpy() 80 columns into the line table. That pass is reproduced below
+ * as the reference, and the framer has to give the same cards. So:
+ *
+ *   1. 3000 random decks -- empty lines, runs of delimiters, CRs anywhere,
+ *      lines of 0 to 120 columns, a stray NUL now and then -- fed in random
+ *      runs give exactly the reference's cards, in order.
+ *   2. The edges by name: a CR-only line, a CR past column 80, 80 columns and
+ *      a CR, no delimiter after the last line, an empty body, bytes after a
+ *      NUL.
+ *   3. A deck fed a byte at a time gives what one feed of it gives.
+ *   4. A negative answer from the emitter stops the framing and comes back
+ *      from jclcard_feed(); no card is emitted after it.
+ *
+ * ====================================================================
+ * This test drives the REAL implementation: src/jclcard.c is #included
+ * below. The reference is the test's own copy of the old cutting, since
+ * jobsapi.c cannot compile on the host.
+ * ====================================================================
+ *
+ * Runs on host via `make test-host`.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mbtcheck.h>
+
+#include "../../src/jclcard.c"
+
+#define NEL         0x15        /* what the cp037 atoe makes of an LF */
+#define DECK_MAX    16384
+#define CARDS_MAX   2048
+
+static char deck[DECK_MAX];
+static char copy[DECK_MAX + 1];
+
+/* the reference's cards, and the framer's */
+static char ref[CARDS_MAX][81];
+static int ref_n;
+static char got[CARDS_MAX][81];
+static int got_n;
+static int stop_at;             /* the emit that answers -1, 0 for none */
+
+/* ---- the old cutting, as submit_jcl_content() had it ------------------ */
+
+static char *
+ref_tokenize(char *str, const char *delim, char **saveptr)
+{
+	char *token;
+
+	if (str == NULL) {
+		str = *saveptr;
+	}
+	if (str == NULL) {
+		return NULL;
+	}
+	str += strspn(str, delim);
+	if (*str == '\0') {
+		*saveptr = str;
+		return NULL;
+	}
+	token = str;
+	str = strpbrk(token, delim);
+	if (str == NULL) {
+		*saveptr = token + strlen(token);
+	} else {
+		*str = '\0';
+		*saveptr = str + 1;
+	}
+	return token;
+}
+
+static void
+ref_cut(const char *buf, size_t len)
+{
+	char delimiter[2] = { NEL, '\0' };
+	char *saveptr = NULL;
+	char *line;
+	size_t line_len;
+
+	memcpy(copy, buf, len);
+	copy[len] = '\0';
+	ref_n = 0;
+	line = ref_tokenize(copy, delimiter, &saveptr);
+	while (line != NULL && ref_n < CARDS_MAX) {
+		line_len = strlen(line);
+		if (line_len > 0 && line[line_len - 1] == '\r') {
+			line[line_len - 1] = '\0';
+		}
+		strncpy(ref[ref_n], line, 80);
+		ref[ref_n][80] = '\0';
+		ref_n++;
+		line = ref_tokenize(NULL, delimiter, &saveptr);
+	}
+}
+
+/* ---- the framer ------------------------------------------------------- */
+
+static int
+got_emit(void *ctx, char *card)
+{
+	(void) ctx;
+	if (got_n + 1 == stop_at) {
+		return -1;
+	}
+	if (got_n < CARDS_MAX) {
+		strcpy(got[got_n], card);
+	}
+	got_n++;
+	return 0;
+}
+
+/* frame buf in runs of at most `run` bytes, 0 for random ones */
+static int
+frame(const char *buf, size_t len, size_t run)
+{
+	JCLCARD jc;
+	size_t off = 0;
+	size_t n;
+	int rc;
+
+	got_n = 0;
+	jclcard_init(&jc);
+	while (off < len) {
+		n = run ? run : 1 + (size_t) rand() % 300;
+		if (n > len - off) {
+			n = len - off;
+		}
+		rc = jclcard_feed(&jc, buf + off, n, NEL, got_emit, NULL);
+		if (rc < 0) {
+			return rc;
+		}
+		off += n;
+	}
+	return jclcard_end(&jc, got_emit, NULL);
+}
+
+static int
+same_cards(void)
+{
+	int i;
+
+	if (got_n != ref_n) {
+		return 0;
+	}
+	for (i = 0; i < ref_n; i++) {
+		if (strcmp(got[i], ref[i]) != 0) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static int
+check_deck(const char *buf, size_t len, const char *what)
+{
+	int ok;
+
+	ref_cut(buf, len);
+	stop_at = 0;
+	ok = frame(buf, len, 0) == 0 && same_cards();
+	CHECK(ok, what);
+	return ok;
+}
+
+/* a random deck: lines of random length with a CR here and there */
+static size_t
+random_deck(void)
+{
+	static const char alphabet[] = "// JOB EXEC PGM=IEFBR14,DD*'";
+	size_t len = 0;
+	size_t cols;
+	size_t i;
+	int lines = 1 + rand() % 60;
+
+	while (lines-- > 0 && len + 130 < DECK_MAX) {
+		cols = (size_t) rand() % 121;
+		for (i = 0; i < cols; i++) {
+			deck[len++] = alphabet[rand() % (int) (sizeof(alphabet) - 1)];
+		}
+		if (rand() % 4 == 0) {
+			deck[len++] = '\r';
+		}
+		if (rand() % 8 == 0) {
+			deck[len++] = '\r';
+		}
+		if (rand() % 50 == 0) {
+			deck[len++] = '\0';
+		}
+		i = (size_t) (rand() % 10 == 0 ? 1 + rand() % 3 : 1);
+		while (i-- > 0 && lines > 0) {
+			deck[len++] = NEL;
+		}
+	}
+	return len;
+}
+
+int
+main(void)
+{
+	char card[130];
+	int i;
+	int bad;
+	size_t len;
+
+	srand(18);
+
+	/* 1 */
+	{
+		bad = 0;
+		for (i = 0; i < 3000; i++) {
+			len = random_deck();
+			ref_cut(deck, len);
+			stop_at = 0;
+			if (frame(deck, len, 0) != 0 || !same_cards()) {
+				bad++;
+			}
+		}
+		CHECK_EQ(bad, 0, "random decks in random runs: the reference's cards");
+	}
+
+	/* 2 */
+	{
+		check_deck("\r\x15//S EXEC PGM=X\x15", 17, "a CR-only line is an empty card");
+		memset(card, 'A', 80);
+		card[80] = '\r';
+		card[81] = NEL;
+		check_deck(card, 82, "80 columns and a CR: the CR goes");
+		CHECK(got_n == 1 && strlen(got[0]) == 80, "  80 columns kept");
+		card[80] = 'B';
+		card[81] = '\r';
+		check_deck(card, 82, "a CR in column 82 goes with the cut");
+		memset(card, 'A', 120);
+		card[100] = '\r';
+		check_deck(card, 120, "a CR inside column 100 goes with the cut");
+		check_deck("//J JOB\x15//S EXEC", 16, "the last line needs no delimiter");
+		CHECK(got_n == 2 && strcmp(got[1], "//S EXEC") == 0, "  and is a card");
+		check_deck("", 0, "an empty body");
+		CHECK_EQ(got_n, 0, "  has no card");
+		check_deck("\x15\x15\x15", 3, "only delimiters");
+		CHECK_EQ(got_n, 0, "  are no card");
+		check_deck("//J JOB\x15//A\0//B\x15//C", 19, "a NUL ends the body");
+		CHECK(got_n == 2 && strcmp(got[1], "//A") == 0, "  after the card it cut");
+	}
+
+	/* 3 */
+	{
+		bad = 0;
+		for (i = 0; i < 200; i++) {
+			len = random_deck();
+			ref_cut(deck, len);
+			stop_at = 0;
+			if (frame(deck, len, 1) != 0 || !same_cards()) {
+				bad++;
+			}
+		}
+		CHECK_EQ(bad, 0, "a byte per feed: the same cards");
+	}
+
+	/* 4 */
+	{
+		static const char five[] = "//1\x15//2\x15//3\x15//4\x15//5\x15";
+
+		stop_at = 3;
+		CHECK_EQ(frame(five, sizeof(five) - 1, 4), -1,
+			"a failed emit comes back from the feed");
+		CHECK_EQ(got_n, 2, "  and nothing after it is emitted");
+		stop_at = 5;
+		CHECK_EQ(frame("//1\x15//2\x15//3\x15//4\x15//5", 19, 64), -1,
+			"a failed last card comes back from the end");
+	}
+
+	return mbt_test_summary("TSTJCRD");
+}
@@ -0,0 +1,401 @@
+/*
+ * tstjson.c - the JSON builder, buffered and streaming.
+ *
+ * A streaming builder that is wrong sends a document that parses and is
+ * not the one that was built -- a piece lost or doubled at a window edge --
+ * or holds the whole document after all. So:
+ *
+ *   1. A document that fits the window is never flushed: it is all in the
+ *      buffer at the end, `flushed` is 0, and the caller sends it with a
+ *      Content-Length as before.
+ *   2. A streamed document, windows concatenated, is byte for byte the
+ *      document the buffered builder produces -- over random documents
+ *      from every add function, escapes and long strings included.
+ *   3. The window never grows past JSON_STREAM_WINDOW unless one piece is
+ *      larger than the whole window, and every flush but the last carries
+ *      a nearly full window.
+ *   4. A failed flush fails the add that made it, and the failure is not
+ *      reported as an abandoned document when the builder is finished.
+ *   5. Freeing a builder that flushed and was not finished tells the sink
+ *      (NULL buffer) exactly once; finishing or never flushing does not.
+ *   6. Arena builders grow in place and are not freed by freeJsonBuilder().
+ *   7. A builder reserved for its document is built without one
+ *      reallocation; a reservation that cannot be had changes nothing.
+ *
+ * ====================================================================
+ * This test drives the REAL implementation: src/json.c and src/arena.c
+ * are #included below. The sink is the test's own -- common.c's, which
+ * sends the headers and translates to ASCII, cannot compile on the host.
+ * ====================================================================
+ *
+ * Runs on host via `make test-host`.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mbtcheck.h>
+
+#include "../../src/arena.c"
+#include "../../src/jsontmpl.c"
+#include "../../src/json.c"
+
+#define DOC_MAX     (4 * 1024 * 1024)
+
+/* Arena chunks from the heap. */
+static void *
+heap_get(void *ctx, unsigned size)
+{
+	(void) ctx;
+	return malloc(size);
+}
+
+static void
+heap_put(void *ctx, void *block, unsigned size)
+{
+	(void) ctx;
+	(void) size;
+	free(block);
+}
+
+static const ARENA_OPS heap_ops = { heap_get, heap_put };
+
+/* The sink: every window appended, in order. */
+struct sink {
+	char    *doc;
+	size_t   len;
+	int      flushes;
+	int      abandoned;
+	int      fail_at;        /* 0: never; else the flush number that fails */
+	size_t   smallest;       /* shortest flush but the last */
+	size_t   last;
+};
+
+static int
+sink_flush(void *ctx, char *buf, size_t len)
+{
+	struct sink *k = (struct sink *) ctx;
+
+	if (!buf) {
+		k->abandoned++;
+		return 0;
+	}
+	k->flushes++;
+	if (k->fail_at && k->flushes >= k->fail_at) {
+		return -1;
+	}
+	if (k->flushes > 1 && k->last < k->smallest) {
+		k->smallest = k->last;
+	}
+	k->last = len;
+	if (k->len + len <= DOC_MAX) {
+		memcpy(k->doc + k->len, buf, len);
+	}
+	k->len += len;
+	/* the sink may translate in place: the builder must not care */
+	memset(buf, '#', len);
+	return 0;
+}
+
+static void
+sink_init(struct sink *k, char *doc)
+{
+	memset(k, 0, sizeof(*k));
+	k->doc = doc;
+	k->smallest = (size_t) -1;
+}
+
+/* A document from a seed: every add function, nested objects and arrays,
+   now and then a long or awkward string. The same seed builds the same
+   document in any builder. */
+static int
+build(JsonBuilder *b, unsigned seed, int items)
+{
+	static char big[40000];
+	char key[16];
+	char val[64];
+	int i;
+	int rc = 0;
+
+	srand(seed);
+	rc |= startJsonObject(b);
+	rc |= addJsonNumber(b, "count", items);
+	rc |= startJsonArrayKey(b, "items");
+	for (i = 0; i < items && rc == 0; i++) {
+		int kind = rand() % 10;
+
+		snprintf(key, sizeof(key), "k%d", i);
+		snprintf(val, sizeof(val), "value-%d-%d", i, rand() % 100000);
+		rc |= startJsonObject(b);
+		rc |= addJsonString(b, "name", val);
+		rc |= addJsonNumber(b, "n", rand());
+		rc |= addJsonBool(b, "ok", rand() & 1);
+		rc |= addJsonRaw(b, "ts", "1760000000000");
+		if (kind == 0) {
+			rc |= addJsonString(b, key, NULL);
+		} else if (kind == 1) {
+			rc |= addJsonStringEsc(b, "text", "a \"quoted\"\tline\\\r\n");
+		} else if (kind == 2) {
+			int len = rand() % (int) sizeof(big);
+
+			memset(big, 'x' + rand() % 3, len);
+			big[len] = '\0';
+			rc |= addJsonStringEsc(b, "long", big);
+		} else if (kind == 3) {
+			rc |= startJsonArrayKey(b, "tags");
+			rc |= addJsonArrayString(b, val);
+			rc |= addJsonArrayString(b, NULL);
+			rc |= endArray(b);
+		}
+		rc |= endJsonObject(b);
+	}
+	rc |= endArray(b);
+	rc |= endJsonObject(b);
+	return rc ? -1 : 0;
+}
+
+int
+main(void)
+{
+	static char doc[DOC_MAX];
+	struct sink k;
+	JsonBuilder *ref;
+	JsonBuilder *b;
+	int rc;
+
+	printf("--- a document that fits is never flushed ---\n");
+	{
+		ref = createJsonBuilder();
+		build(ref, 1, 20);
+		b = createJsonBuilder();
+		sink_init(&k, doc);
+		rc = streamJsonBuilder(b, sink_flush, &k);
+		CHECK_EQ(rc, 0, "switched to streaming");
+		CHECK_EQ(b->capacity, (size_t) JSON_STREAM_WINDOW, "with a full window");
+		build(b, 1, 20);
+		CHECK(ref->size < JSON_STREAM_WINDOW, "the document is small");
+		CHECK_EQ(k.flushes, 0, "nothing flushed");
+		CHECK_EQ(b->flushed, (size_t) 0, "flushed says so");
+		CHECK(b->size == ref->size && strcmp(b->buffer, ref->buffer) == 0,
+			"the whole document is in the buffer");
+		freeJsonBuilder(b);
+		CHECK_EQ(k.abandoned, 0, "freeing it abandons nothing");
+		freeJsonBuilder(ref);
+	}
+
+	printf("\n--- streamed == buffered, over random documents ---\n");
+	{
+		unsigned seed;
+		int same = 1;
+		int bounded = 1;
+		int full = 1;
+		int flushed = 0;
+
+		for (seed = 1; seed <= 60; seed++) {
+			int items = 50 + (int) (seed * 97 % 1500);
+
+			ref = createJsonBuilder();
+			build(ref, seed, items);
+
+			b = createJsonBuilder();
+			sink_init(&k, doc);
+			streamJsonBuilder(b, sink_flush, &k);
+			if (build(b, seed, items) < 0) {
+				same = 0;
+			}
+			/* longest piece: a 40000-byte string escaped one byte at a
+			   time, so the window never needs to grow */
+			if (b->capacity != JSON_STREAM_WINDOW) {
+				bounded = 0;
+			}
+			rc = finishJsonBuilder(b);
+			if (rc != 0 || k.len != ref->size
+				|| memcmp(k.doc, ref->buffer, ref->size) != 0) {
+				same = 0;
+			}
+			if (k.flushes > 2 && k.smallest < JSON_STREAM_WINDOW - 300) {
+				full = 0;
+			}
+			if (b->flushed != ref->size) {
+				same = 0;
+			}
+			flushed += k.flushes;
+			freeJsonBuilder(b);
+			if (k.abandoned) {
+				same = 0;
+			}
+			freeJsonBuilder(ref);
+		}
+		CHECK(flushed > 60, "the documents did stream");
+		CHECK(same, "every streamed document equals the buffered one");
+		CHECK(bounded, "the window never grew");
+		CHECK(full, "every flush but the last was a nearly full window");
+	}
+
+	printf("\n--- one piece larger than the window ---\n");
+	{
+		char key[JSON_STREAM_WINDOW + 100];
+
+		memset(key, 'K', sizeof(key) - 1);
+		key[sizeof(key) - 1] = '\0';
+		ref = createJsonBuilder();
+		startJsonObject(ref);
+		addJsonRaw(ref, key, "1");
+		endJsonObject(ref);
+
+		b = createJsonBuilder();
+		sink_init(&k, doc);
+		streamJsonBuilder(b, sink_flush, &k);
+		startJsonObject(b);
+		rc = addJsonRaw(b, key, "1");
+		CHECK_EQ(rc, 0, "accepted");
+		CHECK(b->capacity > JSON_STREAM_WINDOW, "by growing the window");
+		endJsonObject(b);
+		finishJsonBuilder(b);
+		CHECK(k.len == ref->size && memcmp(k.doc, ref->buffer, k.len) == 0,
+			"and the document is still whole");
+		freeJsonBuilder(b);
+		freeJsonBuilder(ref);
+	}
+
+	printf("\n--- a failed flush ---\n");
+	{
+		b = createJsonBuilder();
+		sink_init(&k, doc);
+		k.fail_at = 2;
+		streamJsonBuilder(b, sink_flush, &k);
+		rc = build(b, 7, 2000);
+		CHECK_EQ(rc, -1, "fails the add that made it");
+		CHECK_EQ(k.flushes >= 2, 1, "on the second window");
+		rc = finishJsonBuilder(b);
+		CHECK_EQ(rc, -1, "the finish fails too");
+		freeJsonBuilder(b);
+		CHECK_EQ(k.abandoned, 0, "a finished builder is not abandoned");
+
+		b = createJsonBuilder();
+		sink_init(&k, doc);
+		k.fail_at = 1;
+		streamJsonBuilder(b, sink_flush, &k);
+		build(b, 9, 20);
+		rc = finishJsonBuilder(b);
+		CHECK_EQ(rc, -1, "a failed final flush is reported");
+		CHECK_EQ(finishJsonBuilder(b), 0, "and only once");
+		freeJsonBuilder(b);
+		CHECK_EQ(k.abandoned, 0, "and is not an abandonment");
+	}
+
+	printf("\n--- abandoned ---\n");
+	{
+		b = createJsonBuilder();
+		sink_init(&k, doc);
+		streamJsonBuilder(b, sink_flush, &k);
+		build(b, 3, 2000);
+		CHECK(k.flushes > 0, "part of the document is out");
+		freeJsonBuilder(b);
+		CHECK_EQ(k.abandoned, 1, "freeing it unfinished tells the sink once");
+
+		b = createJsonBuilder();
+		sink_init(&k, doc);
+		streamJsonBuilder(b, sink_flush, &k);
+		build(b, 3, 5);
+		freeJsonBuilder(b);
+		CHECK_EQ(k.abandoned, 0, "nothing out, nothing abandoned");
+
+		CHECK_EQ(streamJsonBuilder(NULL, sink_flush, &k), -1, "no builder");
+		b = createJsonBuilder();
+		CHECK_EQ(streamJsonBuilder(b, NULL, &k), -1, "no sink");
+		CHECK_EQ(finishJsonBuilder(b), 0, "finishing a buffered builder is a no-op");
+		freeJsonBuilder(b);
+	}
+
+	printf("\n--- arena builders ---\n");
+	{
+		ARENA a;
+		char *first;
+		unsigned held;
+
+		arena_init(&a, NULL, NULL);
+		CHECK(createJsonBuilderIn(&a) == NULL, "an arena without a source fails");
+
+		arena_init(&a, &heap_ops, NULL);
+		b = createJsonBuilderIn(&a);
+		CHECK(b != NULL && b->arena == &a, "built in the arena");
+		first = b->buffer;
+		ref = createJsonBuilder();
+		build(ref, 5, 40);
+		build(b, 5, 40);
+		CHECK(b->capacity > JSON_INITIAL_BUFFER_SIZE, "the buffer grew");
+		CHECK(b->buffer == first, "in place");
+		CHECK(strcmp(b->buffer, ref->buffer) == 0, "to the same document");
+		held = a.held;
+		freeJsonBuilder(b);
+		CHECK_EQ(a.held, held, "freeJsonBuilder() leaves it to the arena");
+
+		b = createJsonBuilderIn(&a);
+		sink_init(&k, doc);
+		CHECK_EQ(streamJsonBuilder(b, sink_flush, &k), 0, "an arena builder streams");
+		build(b, 5, 40);
+		finishJsonBuilder(b);
+		CHECK(k.len == ref->size && memcmp(k.doc, ref->buffer, k.len) == 0,
+			"the same document");
+		freeJsonBuilder(ref);
+		arena_release(&a);
+		CHECK_EQ(a.held, 0u, "and the arena gives it all back");
+	}
+
+	printf("\n--- reserved builders ---\n");
+	{
+		ARENA a;
+		char *first;
+		unsigned allocs;
+		size_t need;
+
+		ref = createJsonBuilder();
+		build(ref, 6, 30);
+		need = ref->size + ref->size / 8;
+
+		arena_init(&a, &heap_ops, NULL);
+		b = createJsonBuilderIn(&a);
+		CHECK_EQ(reserveJsonBuilder(b, need), 0, "reserved");
+		CHECK_EQ(b->capacity, need, "to the size asked");
+		CHECK_EQ(reserveJsonBuilder(b, 10), 0, "a smaller reservation is a no-op");
+		CHECK_EQ(b->capacity, need, "and shrinks nothing");
+		first = b->buffer;
+		allocs = a.allocs;
+		build(b, 6, 30);
+		CHECK(b->buffer == first && b->capacity == need, "built without a realloc");
+		CHECK_EQ(a.allocs, allocs, "nor an arena allocation");
+		CHECK(b->size == ref->size && strcmp(b->buffer, ref->buffer) == 0,
+			"to the same document");
+		arena_release(&a);
+
+		b = createJsonBuilder();
+		CHECK_EQ(reserveJsonBuilder(b, need), 0, "a heap builder reserves too");
+		build(b, 6, 30);
+		CHECK(strcmp(b->buffer, ref->buffer) == 0, "to the same document");
+		CHECK(reserveJsonBuilder(b, (size_t) -1) < 0, "an impossible reservation fails");
+		CHECK(strcmp(b->buffer, ref->buffer) == 0, "and leaves the builder alone");
+		freeJsonBuilder(b);
+		freeJsonBuilder(ref);
+		CHECK(reserveJsonBuilder(NULL, 1) < 0, "NULL fails");
+	}
+
+	printf("\n--- memory: O(window), not O(document) ---\n");
+	{
+		ref = createJsonBuilder();
+		build(ref, 11, 3000);
+		b = createJsonBuilder();
+		sink_init(&k, doc);
+		streamJsonBuilder(b, sink_flush, &k);
+		build(b, 11, 3000);
+		finishJsonBuilder(b);
+		printf("  %lu-byte document: buffered holds %lu, streamed %lu in %d windows\n",
+			(unsigned long) ref->size, (unsigned long) ref->capacity,
+			(unsigned long) b->capacity, k.flushes);
+		CHECK(ref->capacity > 8 * b->capacity, "the window is a fraction of it");
+		freeJsonBuilder(b);
+		freeJsonBuilder(ref);
+	}
+
+	return mbt_test_summary("TSTJSON");
+}
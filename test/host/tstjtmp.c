@@ -0,0 +1,653 @@
+/*
+ * tstjtmp.c - list item templates: the renderer, and the four items against
+ * the printf and addJson* calls they replaced.
+ *
+ * A template that is wrong still renders JSON -- one with a field missing,
+ * a digit short, a quote where the old output had none -- and the client
+ * that notices is the one diffing a listing. So:
+ *
+ *   1. Every slot renders what the printf conversion it stands for wrote:
+ *      %u and %0<w>u, %.<w>s, "%s" and null, the escapes of
+ *      addJsonStringEsc(), dates and times.
+ *   2. An item that does not fit fails as a whole, at every size short of
+ *      its length, and fits exactly at its length: the caller relies on
+ *      that to flush and render again.
+ *   3. Each of the four list items renders byte for byte what its handler
+ *      wrote before, over random items: the dataset, member and USS items
+ *      against their send_printf() sequence, the job item against its
+ *      addJson* calls through the real builder.
+ *   4. A benchmark renders 10 000 dataset entries both ways.
+ *
+ * ====================================================================
+ * This test drives the REAL implementation: src/jsontmpl.c, src/listitem.c,
+ * src/json.c and src/arena.c are #included below. The printf paths are
+ * transcribed from the handlers as they were; the handlers themselves
+ * cannot compile on the host.
+ * ====================================================================
+ *
+ * Runs on host via `make test-host`.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <mbtcheck.h>
+
+#include "../../src/arena.c"
+#include "../../src/jsontmpl.c"
+#include "../../src/listitem.c"
+#include "../../src/json.c"
+
+#define OUT_MAX     (64 * 1024)
+
+/* The DSLIST fields datasetListHandler() reads. */
+struct ds {
+	char            dsn[45];
+	char            volser[7];
+	char            dsorg[5];
+	char            recfm[5];
+	char            dev[5];
+	unsigned short  blksize;
+	unsigned short  lrecl;
+	unsigned char   extents;
+	unsigned short  alloc_trks;
+	unsigned short  used_trks;
+	char            spacu;
+	unsigned short  cryear, crmon, crday;
+	unsigned short  rfyear, rfmon, rfday;
+};
+
+static char   out[OUT_MAX];
+static size_t out_len;
+
+/* send_printf(), as far as the bytes go */
+static void
+out_printf(const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	out_len += (size_t) vsnprintf(out + out_len, OUT_MAX - out_len, fmt, ap);
+	va_end(ap);
+}
+
+static void
+random_name(char *buf, int max)
+{
+	static const char chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789@#$";
+	int len = 1 + rand() % max;
+	int i;
+
+	for (i = 0; i < len; i++) {
+		buf[i] = chars[rand() % (sizeof(chars) - 1)];
+		if (i % 9 == 8 && i + 1 < len) {
+			buf[i] = '.';
+		}
+	}
+	buf[len] = '\0';
+}
+
+static void
+random_ds(struct ds *ds)
+{
+	static const char *const orgs[] = { "PO", "PS", "DA", "IS", "VS", "" };
+	static const char *const recfms[] = { "FB", "VB", "U", "FBA", "VBS", "" };
+	static const char *const devs[] = { "3350", "3375", "3380", "3390", "" };
+
+	memset(ds, 0, sizeof(*ds));
+	random_name(ds->dsn, 44);
+	random_name(ds->volser, 6);
+	strcpy(ds->dsorg, orgs[rand() % 6]);
+	strcpy(ds->recfm, recfms[rand() % 6]);
+	strcpy(ds->dev, devs[rand() % 5]);
+	ds->blksize = (unsigned short) rand();
+	ds->lrecl = (unsigned short) rand();
+	ds->extents = (unsigned char) (rand() % 17);
+	ds->alloc_trks = (unsigned short) (rand() % 3 ? rand() : 0);
+	ds->used_trks = ds->alloc_trks ? (unsigned short) (rand() % ds->alloc_trks) : 0;
+	ds->spacu = rand() & 1 ? 'C' : 'T';
+	ds->cryear = (unsigned short) (1980 + rand() % 100);
+	ds->crmon = (unsigned short) (1 + rand() % 12);
+	ds->crday = (unsigned short) (1 + rand() % 31);
+	ds->rfyear = (unsigned short) (1980 + rand() % 100);
+	ds->rfmon = (unsigned short) (1 + rand() % 12);
+	ds->rfday = (unsigned short) (1 + rand() % 31);
+}
+
+/* datasetListHandler()'s item, as it was */
+static void
+ds_printf(const struct ds *ds, int first)
+{
+	const char *dsntp;
+	unsigned pct;
+
+	if (first) out_printf("    {\n");
+	else out_printf("   ,{\n");
+
+	out_printf("      \"dsname\": \"%.44s\",\n", ds->dsn);
+
+	if (strcmp(ds->dsorg, "PO") == 0) dsntp = "PDS";
+	else if (strcmp(ds->dsorg, "PS") == 0) dsntp = "BASIC";
+	else dsntp = "UNKNOWN";
+
+	out_printf("      \"blksz\": \"%u\",\n", ds->blksize);
+	out_printf("      \"catnm\": \"\",\n");
+	out_printf("      \"cdate\": \"%u/%02u/%02u\",\n", ds->cryear, ds->crmon, ds->crday);
+	out_printf("      \"dev\": \"%.4s\",\n", ds->dev[0] ? ds->dev : "3390");
+	out_printf("      \"dsntp\": \"%s\",\n", dsntp);
+	out_printf("      \"dsorg\": \"%.4s\",\n", ds->dsorg);
+	out_printf("      \"edate\": \"***None***\",\n");
+	out_printf("      \"extx\": \"%u\",\n", ds->extents);
+	out_printf("      \"lrecl\": \"%u\",\n", ds->lrecl);
+	out_printf("      \"migr\": \"NO\",\n");
+	out_printf("      \"mvol\": \"N\",\n");
+	out_printf("      \"ovf\": \"NO\",\n");
+	out_printf("      \"rdate\": \"%u/%02u/%02u\",\n", ds->rfyear, ds->rfmon, ds->rfday);
+	out_printf("      \"recfm\": \"%.4s\",\n", ds->recfm);
+	out_printf("      \"sizex\": \"%u\",\n", ds->alloc_trks);
+	out_printf("      \"spacu\": \"%s\",\n",
+		ds->spacu == 'C' ? "CYLINDERS" : "TRACKS");
+	pct = ds->alloc_trks ? (ds->used_trks * 100 / ds->alloc_trks) : 0;
+	out_printf("      \"used\": \"%u\",\n", pct);
+	out_printf("      \"vol\": \"%.6s\",\n", ds->volser);
+	out_printf("      \"vols\": \"%.6s\"\n", ds->volser);
+	out_printf("    }\n");
+}
+
+/* ... and as it is now: the slot values datasetListHandler() fills in */
+static void
+ds_values(JT_VAL *v, const struct ds *ds, int first)
+{
+	v[DSI_SEP].s = first ? "    " : "   ,";
+	v[DSI_DSNAME].s = ds->dsn;
+	v[DSI_BLKSZ].u = ds->blksize;
+	v[DSI_CDATE].u = JT_YMD(ds->cryear, ds->crmon, ds->crday);
+	v[DSI_DEV].s = ds->dev[0] ? ds->dev : "3390";
+	if (strcmp(ds->dsorg, "PO") == 0) v[DSI_DSNTP].s = "PDS";
+	else if (strcmp(ds->dsorg, "PS") == 0) v[DSI_DSNTP].s = "BASIC";
+	else v[DSI_DSNTP].s = "UNKNOWN";
+	v[DSI_DSORG].s = ds->dsorg;
+	v[DSI_EXTX].u = ds->extents;
+	v[DSI_LRECL].u = ds->lrecl;
+	v[DSI_RDATE].u = JT_YMD(ds->rfyear, ds->rfmon, ds->rfday);
+	v[DSI_RECFM].s = ds->recfm;
+	v[DSI_SIZEX].u = ds->alloc_trks;
+	v[DSI_SPACU].s = ds->spacu == 'C' ? "CYLINDERS" : "TRACKS";
+	v[DSI_USED].u = ds->alloc_trks ?
+		(ds->used_trks * 100 / ds->alloc_trks) : 0;
+	v[DSI_VOL].s = ds->volser;
+}
+
+/* A streaming builder's sink: every window appended. */
+static struct {
+	char    doc[8 * 1024 * 1024];
+	size_t  len;
+} keep;
+
+static int
+keep_flush(void *ctx, char *buf, size_t n)
+{
+	(void) ctx;
+	if (!buf) {
+		return 0;
+	}
+	if (keep.len + n <= sizeof(keep.doc)) {
+		memcpy(keep.doc + keep.len, buf, n);
+	}
+	keep.len += n;
+	memset(buf, '#', n);
+	return 0;
+}
+
+static int
+render_one(const JT_OP *t, const JT_VAL *v)
+{
+	int n = jt_render(t, v, out + out_len, OUT_MAX - out_len);
+
+	if (n > 0) {
+		out_len += (size_t) n;
+	}
+	return n;
+}
+
+/* Every size short of the item fails, its own length fits. */
+static int
+fits_exactly(const JT_OP *t, const JT_VAL *v, const char *want, size_t len)
+{
+	static char buf[OUT_MAX];
+	size_t size;
+
+	for (size = 0; size < len; size++) {
+		if (jt_render(t, v, buf, size) != -1) {
+			return 0;
+		}
+	}
+	return jt_render(t, v, buf, len) == (int) len &&
+		memcmp(buf, want, len) == 0;
+}
+
+int
+main(void)
+{
+	static char ref[OUT_MAX];
+	size_t ref_len;
+	JT_VAL v[16];
+	int i;
+
+	printf("--- slots against their printf conversions ---\n");
+	{
+		static const JT_OP t_uint[] = { JT_UINT(0, 0), JT_END };
+		static const JT_OP t_uint2[] = { JT_UINT(0, 2), JT_END };
+		static const JT_OP t_uint4[] = { JT_UINT(0, 4), JT_END };
+		static const JT_OP t_fix[] = { JT_FIX(0, 6), JT_END };
+		static const JT_OP t_str[] = { JT_STR(0), JT_END };
+		static const JT_OP t_raw[] = { JT_LIT("<"), JT_RAW(0), JT_LIT(">"), JT_END };
+		static const JT_OP t_date[] = { JT_DATE(0, '/'), JT_END };
+		static const JT_OP t_time[] = { JT_TIME(0), JT_END };
+		static const JT_OP t_if[] = {
+			JT_LIT("a"), JT_IF(0, 2), JT_LIT("b"), JT_UINT(1, 0), JT_LIT("c"),
+			JT_END
+		};
+		static const JT_OP t_iftail[] = { JT_LIT("a"), JT_IF(0, 9), JT_LIT("b"), JT_END };
+		char want[64];
+		char got[64];
+		int bad = 0;
+		int n;
+
+		srand(1);
+		for (i = 0; i < 100000; i++) {
+			unsigned u = i < 20 ? (unsigned) i :
+				i < 40 ? 0xFFFFFFFFu - (unsigned) (i - 20) :
+				(unsigned) rand() >> (rand() % 31);
+
+			v[0].u = u;
+			snprintf(want, sizeof(want), "%u", u);
+			n = jt_render(t_uint, v, got, sizeof(got));
+			bad += n != (int) strlen(want) || memcmp(got, want, n) != 0;
+			snprintf(want, sizeof(want), "%02u", u);
+			n = jt_render(t_uint2, v, got, sizeof(got));
+			bad += n != (int) strlen(want) || memcmp(got, want, n) != 0;
+			snprintf(want, sizeof(want), "%04u", u);
+			n = jt_render(t_uint4, v, got, sizeof(got));
+			bad += n != (int) strlen(want) || memcmp(got, want, n) != 0;
+		}
+		CHECK_EQ(bad, 0, "%u, %02u and %04u over 100 000 values, both ends included");
+
+		bad = 0;
+		for (i = 0; i < 10000; i++) {
+			unsigned y = 1900 + rand() % 200, mo = 1 + rand() % 12,
+				d = 1 + rand() % 31, h = rand() % 24, mi = rand() % 60,
+				s = rand() % 60;
+
+			v[0].u = JT_YMD(y, mo, d);
+			snprintf(want, sizeof(want), "%u/%02u/%02u", y, mo, d);
+			n = jt_render(t_date, v, got, sizeof(got));
+			bad += n != (int) strlen(want) || memcmp(got, want, n) != 0;
+			v[0].u = JT_HMS(h, mi, s);
+			snprintf(want, sizeof(want), "%02u:%02u:%02u", h, mi, s);
+			n = jt_render(t_time, v, got, sizeof(got));
+			bad += n != (int) strlen(want) || memcmp(got, want, n) != 0;
+		}
+		CHECK_EQ(bad, 0, "dates and times as %u/%02u/%02u and %02u:%02u:%02u");
+
+		v[0].s = "SYSRES";
+		n = jt_render(t_fix, v, got, sizeof(got));
+		CHECK(n == 8 && memcmp(got, "\"SYSRES\"", 8) == 0, "a full fixed field");
+		v[0].s = "AB";
+		n = jt_render(t_fix, v, got, sizeof(got));
+		CHECK(n == 4 && memcmp(got, "\"AB\"", 4) == 0, "a short one stops at its NUL");
+		v[0].s = "VOLUME1-and-more";
+		n = jt_render(t_fix, v, got, sizeof(got));
+		CHECK(n == 8 && memcmp(got, "\"VOLUME\"", 8) == 0, "a long one is cut, as %.6s");
+		v[0].s = NULL;
+		n = jt_render(t_str, v, got, sizeof(got));
+		CHECK(n == 4 && memcmp(got, "null", 4) == 0, "NULL is null");
+		v[0].s = "";
+		n = jt_render(t_str, v, got, sizeof(got));
+		CHECK(n == 2 && memcmp(got, "\"\"", 2) == 0, "empty is \"\"");
+		v[0].s = "x/y";
+		n = jt_render(t_raw, v, got, sizeof(got));
+		CHECK(n == 5 && memcmp(got, "<x/y>", 5) == 0, "raw has no quotes");
+		v[0].s = NULL;
+		n = jt_render(t_raw, v, got, sizeof(got));
+		CHECK(n == 2 && memcmp(got, "<>", 2) == 0, "and NULL is nothing");
+
+		v[0].u = 1;
+		v[1].u = 7;
+		n = jt_render(t_if, v, got, sizeof(got));
+		CHECK(n == 4 && memcmp(got, "ab7c", 4) == 0, "JT_IF true renders what it guards");
+		v[0].u = 0;
+		n = jt_render(t_if, v, got, sizeof(got));
+		CHECK(n == 2 && memcmp(got, "ac", 2) == 0, "false skips exactly that");
+		n = jt_render(t_iftail, v, got, sizeof(got));
+		CHECK(n == 1 && got[0] == 'a', "a skip past the end stops at it");
+	}
+
+	printf("\n--- escapes, as addJsonStringEsc() ---\n");
+	{
+		static const JT_OP t_esc[] = { JT_LIT("{"), JT_ESC(0), JT_LIT("}"), JT_END };
+		JsonBuilder *b;
+		char s[200];
+		int bad = 0;
+		int n;
+		int k;
+
+		for (i = 0; i < 5000; i++) {
+			int len = rand() % (int) sizeof(s);
+
+			for (k = 0; k < len; k++) {
+				static const char pick[] = "ab\"\\\r\n\t x{}";
+				s[k] = rand() & 1 ? pick[rand() % (sizeof(pick) - 1)] :
+					(char) (1 + rand() % 126);
+			}
+			s[len] = '\0';
+
+			b = createJsonBuilder();
+			startJsonObject(b);
+			addJsonStringEsc(b, "k", s);
+			endJsonObject(b);
+			/* the builder wrote {"k":"..."}: compare the value */
+			v[0].s = s;
+			n = jt_render(t_esc, v, ref, sizeof(ref));
+			bad += n != (int) b->size - 4 || ref[0] != '{' ||
+				memcmp(ref + 1, b->buffer + 5, n - 1) != 0;
+			freeJsonBuilder(b);
+		}
+		CHECK_EQ(bad, 0, "5000 random strings escape alike");
+	}
+
+	printf("\n--- the dataset item ---\n");
+	{
+		struct ds ds;
+		int bad = 0;
+		int exact = 1;
+
+		srand(2);
+		for (i = 0; i < 5000; i++) {
+			random_ds(&ds);
+			out_len = 0;
+			ds_printf(&ds, i % 7 == 0);
+			memcpy(ref, out, out_len);
+			ref_len = out_len;
+
+			out_len = 0;
+			ds_values(v, &ds, i % 7 == 0);
+			render_one(list_template(LIST_DATASET), v);
+			bad += out_len != ref_len || memcmp(out, ref, ref_len) != 0;
+			if (i < 50) {
+				exact &= fits_exactly(list_template(LIST_DATASET), v, ref, ref_len);
+			}
+		}
+		CHECK_EQ(bad, 0, "5000 random data sets, byte for byte");
+		CHECK(exact, "fails at every size short of the item, fits at its length");
+	}
+
+	printf("\n--- the member item ---\n");
+	{
+		char member[32];
+		int bad = 0;
+
+		for (i = 0; i < 1000; i++) {
+			random_name(member, 8);
+			out_len = 0;
+			if (i == 0) out_printf("    {\n");
+			else out_printf("   ,{\n");
+			out_printf("      \"member\": \"%s\"\n", member);
+			out_printf("    }\n");
+			memcpy(ref, out, out_len);
+			ref_len = out_len;
+
+			out_len = 0;
+			v[MBI_SEP].s = i == 0 ? "    " : "   ,";
+			v[MBI_MEMBER].s = member;
+			render_one(list_template(LIST_MEMBER), v);
+			bad += out_len != ref_len || memcmp(out, ref, ref_len) != 0;
+		}
+		CHECK_EQ(bad, 0, "1000 members, byte for byte");
+	}
+
+	printf("\n--- the USS item ---\n");
+	{
+		char name[64], mode[11], owner[10], group[10], mtime[80];
+		int bad = 0;
+
+		for (i = 0; i < 2000; i++) {
+			time_t t = (time_t) (rand() % 2000000000);
+			struct tm *tm = gmtime(&t);
+			unsigned size = (unsigned) rand(), links = rand() % 40,
+				inode = (unsigned) rand();
+
+			random_name(name, 60);
+			strcpy(mode, rand() & 1 ? "drwxr-xr-x" : "-rw-r--r--");
+			random_name(owner, 8);
+			random_name(group, 8);
+			if (i % 50 == 0) {
+				tm = NULL;
+			}
+			if (tm) {
+				snprintf(mtime, sizeof(mtime), "%04d-%02d-%02dT%02d:%02d:%02dZ",
+					tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday,
+					tm->tm_hour, tm->tm_min, tm->tm_sec);
+			} else {
+				snprintf(mtime, sizeof(mtime), "1970-01-01T00:00:00Z");
+			}
+
+			out_len = 0;
+			if (i == 0) out_printf("    {\n");
+			else out_printf("   ,{\n");
+			out_printf("      \"name\": \"%s\",\n", name);
+			out_printf("      \"mode\": \"%s\",\n", mode);
+			out_printf("      \"size\": %u,\n", size);
+			out_printf("      \"user\": \"%s\",\n", owner);
+			out_printf("      \"group\": \"%s\",\n", group);
+			out_printf("      \"links\": %u,\n", links);
+			out_printf("      \"mtime\": \"%s\",\n", mtime);
+			out_printf("      \"inode\": %u\n", inode);
+			out_printf("    }\n");
+			memcpy(ref, out, out_len);
+			ref_len = out_len;
+
+			out_len = 0;
+			v[USI_SEP].s = i == 0 ? "    " : "   ,";
+			if (tm) {
+				v[USI_MDATE].u = JT_YMD(tm->tm_year + 1900, tm->tm_mon + 1,
+					tm->tm_mday);
+				v[USI_MTIME].u = JT_HMS(tm->tm_hour, tm->tm_min, tm->tm_sec);
+			} else {
+				v[USI_MDATE].u = JT_YMD(1970, 1, 1);
+				v[USI_MTIME].u = 0;
+			}
+			v[USI_NAME].s = name;
+			v[USI_MODE].s = mode;
+			v[USI_SIZE].u = size;
+			v[USI_USER].s = owner;
+			v[USI_GROUP].s = group;
+			v[USI_LINKS].u = links;
+			v[USI_INODE].u = inode;
+			render_one(list_template(LIST_USS), v);
+			bad += out_len != ref_len || memcmp(out, ref, ref_len) != 0;
+		}
+		CHECK_EQ(bad, 0, "2000 directory entries, byte for byte");
+	}
+
+	printf("\n--- the job item, against addJson* ---\n");
+	{
+		static const char *const retcodes[] = {
+			NULL, "CC 0000", "CC 0012", "ABEND S0C4", "ABEND U0100", "JCL ERROR"
+		};
+		static const char *const statuses[] = { "INPUT", "ACTIVE", "OUTPUT" };
+		char jobname[10], jobid[16], owner[10], class_str[4], type_str[4];
+		char url[300], files_url[320];
+		char started[32], ended[32];
+		JsonBuilder *old;
+		JsonBuilder *new;
+		int bad = 0;
+		int k;
+
+		old = createJsonBuilder();
+		new = createJsonBuilder();
+		startArray(old);
+		startArray(new);
+		for (k = 0; k < 500; k++) {
+			const char *retcode = retcodes[rand() % 6];
+			const char *status = statuses[rand() % 3];
+			const char *host = rand() % 4 ? "mvs.example:1080" : "127.0.0.1:8080";
+			const char *scheme = rand() & 1 ? "https" : "http";
+			int exec_data = rand() & 1;
+			int eclass = rand() % 3 ? 'A' + rand() % 26 : 0;
+
+			random_name(jobname, 8);
+			snprintf(jobid, sizeof(jobid), "%s%05d",
+				rand() & 1 ? "JOB" : "STC", rand() % 100000);
+			random_name(owner, 8);
+			snprintf(started, sizeof(started), "2026-10-16T12:%02d:%02d.000Z",
+				rand() % 60, rand() % 60);
+			snprintf(ended, sizeof(ended), "2026-10-16T13:%02d:%02d.000Z",
+				rand() % 60, rand() % 60);
+
+			/* process_job() as it was */
+			snprintf(type_str, sizeof(type_str), "%.3s", jobid);
+			snprintf(class_str, sizeof(class_str), "%.3s", jobid);
+			if (eclass) {
+				snprintf(class_str, sizeof(class_str), "%c", eclass);
+			}
+			snprintf(url, sizeof(url), "%s://%s/zosmf/restjobs/jobs/%s/%s",
+				scheme, host, jobname, jobid);
+			snprintf(files_url, sizeof(files_url), "%s/files", url);
+			startJsonObject(old);
+			addJsonString(old, "subsystem", "JES2");
+			addJsonString(old, "jobname", jobname);
+			addJsonString(old, "jobid", jobid);
+			addJsonString(old, "owner", owner);
+			addJsonString(old, "type", type_str);
+			addJsonString(old, "class", class_str);
+			addJsonString(old, "url", url);
+			addJsonString(old, "files-url", files_url);
+			addJsonString(old, "status", status);
+			addJsonString(old, "retcode", retcode);
+			if (exec_data) {
+				addJsonString(old, "exec-started", k % 9 ? started : NULL);
+				addJsonString(old, "exec-ended", k % 5 ? ended : NULL);
+			}
+			endJsonObject(old);
+
+			/* ... and as it is */
+			v[JBI_CLASS].s = jobid;
+			if (eclass) {
+				class_str[0] = (char) eclass;
+				class_str[1] = '\0';
+				v[JBI_CLASS].s = class_str;
+			}
+			v[JBI_JOBNAME].s = jobname;
+			v[JBI_JOBID].s = jobid;
+			v[JBI_OWNER].s = owner;
+			v[JBI_SCHEME].s = scheme;
+			v[JBI_HOST].s = host;
+			v[JBI_STATUS].s = status;
+			v[JBI_RETCODE].s = retcode;
+			v[JBI_EXEC].u = (unsigned) exec_data;
+			v[JBI_STARTED].s = k % 9 ? started : NULL;
+			v[JBI_ENDED].s = k % 5 ? ended : NULL;
+			bad += addJsonTemplate(new, list_template(LIST_JOB), v) != 0;
+		}
+		endArray(old);
+		endArray(new);
+		CHECK_EQ(bad, 0, "500 jobs added");
+		CHECK(new->size == old->size && strcmp(new->buffer, old->buffer) == 0,
+			"the job array, byte for byte");
+		CHECK(new->capacity > JSON_INITIAL_BUFFER_SIZE, "the builder grew to take it");
+		freeJsonBuilder(old);
+		freeJsonBuilder(new);
+	}
+
+	printf("\n--- a template item into a streaming builder ---\n");
+	{
+		static const JT_OP t_big[] = {
+			JT_LIT("{\"k\":"), JT_ESC(0), JT_LIT("}"), JT_END
+		};
+		static char big[3 * JSON_STREAM_WINDOW];
+		JsonBuilder *b = createJsonBuilder();
+		JsonBuilder *r = createJsonBuilder();
+		int rc = 0;
+
+		keep.len = 0;
+		memset(big, 'q', sizeof(big) - 1);
+		streamJsonBuilder(b, keep_flush, &keep);
+		startArray(b);
+		startArray(r);
+		for (i = 0; i < 300; i++) {
+			big[i % 7 == 0 ? sizeof(big) - 1 : (size_t) (40 + rand() % 4000)] = '\0';
+			v[0].s = big;
+			rc |= addJsonTemplate(b, t_big, v);
+			startJsonObject(r);
+			addJsonStringEsc(r, "k", big);
+			endJsonObject(r);
+			memset(big, 'q', sizeof(big) - 1);
+		}
+		endArray(b);
+		endArray(r);
+		finishJsonBuilder(b);
+		CHECK_EQ(rc, 0, "every item went in");
+		CHECK(b->capacity <= sizeof(big) + JSON_STREAM_WINDOW,
+			"the window grew only for the item larger than it");
+		CHECK(keep.len == r->size && memcmp(keep.doc, r->buffer, keep.len) == 0,
+			"windows concatenated are the buffered document");
+		freeJsonBuilder(b);
+		freeJsonBuilder(r);
+	}
+
+	printf("\n--- benchmark: 10 000 dataset entries ---\n");
+	{
+		static struct ds list[10000];
+		static char stream_a[10000 * 700];
+		static char stream_b[10000 * 700];
+		const int reps = 20;
+		size_t len_a = 0;
+		size_t len_b = 0;
+		clock_t t0;
+		double t_printf;
+		double t_tmpl;
+		int r;
+
+		srand(3);
+		for (i = 0; i < 10000; i++) {
+			random_ds(&list[i]);
+		}
+
+		/* the send_printf() path: 22 vsnprintf() calls an item into the
+		   send buffer -- translation and sending left out of both */
+		t0 = clock();
+		for (r = 0; r < reps; r++) {
+			len_a = 0;
+			for (i = 0; i < 10000; i++) {
+				out_len = 0;
+				ds_printf(&list[i], i == 0);
+				memcpy(stream_a + len_a, out, out_len);
+				len_a += out_len;
+			}
+		}
+		t_printf = (double) (clock() - t0) / CLOCKS_PER_SEC / reps;
+
+		t0 = clock();
+		for (r = 0; r < reps; r++) {
+			len_b = 0;
+			for (i = 0; i < 10000; i++) {
+				ds_values(v, &list[i], i == 0);
+				len_b += (size_t) jt_render(list_template(LIST_DATASET), v,
+					stream_b + len_b, sizeof(stream_b) - len_b);
+			}
+		}
+		t_tmpl = (double) (clock() - t0) / CLOCKS_PER_SEC / reps;
+
+		CHECK(len_a == len_b && memcmp(stream_a, stream_b, len_a) == 0,
+			"the same 10 000 items both ways");
+		printf("  %lu bytes: printf %.0f us, template %.0f us (%.1fx)\n",
+			(unsigned long) len_a, t_printf * 1e6, t_tmpl * 1e6,
+			t_printf / t_tmpl);
+		CHECK(t_tmpl < t_printf, "the template is faster");
+	}
+
+	return mbt_test_summary("TSTJTMP");
+}
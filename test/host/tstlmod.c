@@ -0,0 +1,191 @@
+/*
+ * tstlmod.c - Last-Modified and If-Modified-Since (src/lastmod.c).
+ *
+ * A date validator that is wrong answers 304 for content that changed, and
+ * the client never finds out. So:
+ *
+ *   1. Noon of every day from 1970 to 2105 renders as an IMF-fixdate and
+ *      parses back to itself, and the anchors render as they should; leap
+ *      days are the Gregorian ones (2000 is leap, 2100 is not).
+ *   2. The three forms RFC 9110 names parse to the same time; anything else
+ *      -- a date that does not exist, a missing "GMT", trailing bytes -- is
+ *      not a date.
+ *   3. ISPF statistics are the last second they name -- of the minute, when
+ *      no seconds were kept -- and a span that is not over is no date;
+ *      statistics that are short or not packed decimal are none.
+ *   4. If-Modified-Since holds only for a parseable date, not in the
+ *      future, at or after the resource's.
+ *
+ * ====================================================================
+ * This test drives the REAL implementation: src/lastmod.c is #included
+ * below, so a later refactor stays covered. Reading the directory and the
+ * stat (dsapi.c, ussapi.c) cannot run on the host.
+ * ====================================================================
+ *
+ * Runs on host via `make test-host`.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mbtcheck.h>
+
+#include "../../src/lastmod.c"
+
+/* 1994-11-06 08:49:37 UTC, RFC 9110's example */
+#define EXAMPLE 784111777UL
+
+/* ISPF statistics changed on `year`/`yday` at hh:mm:ss (ss 0: none kept) */
+static void
+fake_stats(unsigned char *u, int year, int yday, int hh, int mm, int ss)
+{
+	memset(u, 0, 30);
+	u[0] = 0x01;					/* version 01 */
+	u[3] = (unsigned char) (((ss / 10) << 4) | ss % 10);
+	u[8] = (unsigned char) (year >= 2000);
+	u[9] = (unsigned char) ((((year % 100) / 10) << 4) | year % 10);
+	u[10] = (unsigned char) (((yday / 100) << 4) | (yday / 10) % 10);
+	u[11] = (unsigned char) (((yday % 10) << 4) | 0x0F);
+	u[12] = (unsigned char) (((hh / 10) << 4) | hh % 10);
+	u[13] = (unsigned char) (((mm / 10) << 4) | mm % 10);
+}
+
+int
+main(void)
+{
+	char out[LASTMOD_SIZE];
+	unsigned long t;
+	unsigned long now;
+
+	printf("\n--- the calendar ---\n");
+	{
+		unsigned long day;
+		int bad = 0;
+
+		lm_format(0, out, sizeof(out));
+		CHECK(strcmp(out, "Thu, 01 Jan 1970 00:00:00 GMT") == 0,
+			"0 is the start of 1970, a Thursday");
+		lm_format(EXAMPLE, out, sizeof(out));
+		CHECK(strcmp(out, "Sun, 06 Nov 1994 08:49:37 GMT") == 0,
+			"RFC 9110's example renders as it is written there");
+		CHECK_EQ(lm_time(1994, lm_yday(1994, 11, 6), 8, 49, 37), EXAMPLE,
+			"and lm_time() builds it from its fields");
+
+		CHECK_EQ(lm_yday(2000, 2, 29), 60, "2000 has a 29 February");
+		CHECK_EQ(lm_yday(2100, 2, 29), 0, "2100 does not");
+		CHECK_EQ(lm_yday(2024, 12, 31), 366, "a leap year has 366 days");
+		CHECK_EQ(lm_yday(2023, 4, 31), 0, "31 April does not exist");
+		CHECK_EQ(lm_time(1969, 365, 23, 59, 59), 0UL,
+			"before 1970 is out of range");
+
+		lm_format(lm_time(2105, 365, 23, 59, 59), out, sizeof(out));
+		CHECK(strcmp(out, "Thu, 31 Dec 2105 23:59:59 GMT") == 0,
+			"the last second in range renders");
+
+		for (day = 0; day < 49673UL; day++) {
+			unsigned long back;
+
+			lm_format(day * 86400UL + 43200UL, out, sizeof(out));
+			if (lm_parse(out, &back) != 0
+			    || back != day * 86400UL + 43200UL) {
+				if (bad++ < 3) {
+					printf("  day %lu: %s\n", day, out);
+				}
+			}
+		}
+		CHECK_EQ(bad, 0, "every day to 2105 round-trips through a string");
+
+		CHECK_EQ(lm_format(0, out, LASTMOD_SIZE - 1), -1,
+			"a buffer one byte short is refused");
+	}
+
+	printf("\n--- parsing ---\n");
+	{
+		CHECK(lm_parse("Sun, 06 Nov 1994 08:49:37 GMT", &t) == 0
+			&& t == EXAMPLE, "IMF-fixdate");
+		CHECK(lm_parse("Sunday, 06-Nov-94 08:49:37 GMT", &t) == 0
+			&& t == EXAMPLE, "RFC 850");
+		CHECK(lm_parse("Sun Nov  6 08:49:37 1994", &t) == 0
+			&& t == EXAMPLE, "asctime, a one-digit day");
+		CHECK(lm_parse("Thu Nov 16 08:49:37 2023", &t) == 0
+			&& t == lm_time(2023, lm_yday(2023, 11, 16), 8, 49, 37),
+			"asctime, a two-digit day");
+		CHECK(lm_parse("Wednesday, 06-Nov-24 08:49:37 GMT", &t) == 0
+			&& t == lm_time(2024, lm_yday(2024, 11, 6), 8, 49, 37),
+			"a two-digit year below 70 is the 2000s");
+
+		CHECK_EQ(lm_parse("Sun, 06 Nov 1994 08:49:37", &t), -1,
+			"no GMT is not a date");
+		CHECK_EQ(lm_parse("Sun, 06 Nov 1994 08:49:37 GMT x", &t), -1,
+			"nor are trailing bytes");
+		CHECK_EQ(lm_parse("Sun, 30 Feb 1994 08:49:37 GMT", &t), -1,
+			"nor 30 February");
+		CHECK_EQ(lm_parse("Sun, 06 Nox 1994 08:49:37 GMT", &t), -1,
+			"nor an unknown month");
+		CHECK_EQ(lm_parse("Sun, 06 Nov 1994 8:49:37 GMT", &t), -1,
+			"nor a one-digit hour");
+		CHECK_EQ(lm_parse("Wed, 31 Dec 1969 23:59:59 GMT", &t), -1,
+			"nor a date before 1970");
+		CHECK_EQ(lm_parse("", &t), -1, "nor an empty value");
+		CHECK_EQ(lm_parse("\"0123456789ABCDEF\"", &t), -1,
+			"nor an ETag sent in the wrong header");
+	}
+
+	printf("\n--- ISPF statistics ---\n");
+	{
+		unsigned char u[40];
+		unsigned long at = lm_time(2024, 300, 14, 5, 33);
+
+		now = at + 86400;
+		fake_stats(u, 2024, 300, 14, 5, 33);
+		CHECK(lm_ispf(u, 30, 0, now, &t) == 0 && t == at,
+			"changed date and time, to the second");
+		CHECK(lm_ispf(u, 40, -3600, now, &t) == 0 && t == at - 3600,
+			"extended statistics are read the same; local time moves"
+			" to UTC");
+
+		fake_stats(u, 2024, 300, 14, 5, 0);
+		CHECK(lm_ispf(u, 30, 0, now, &t) == 0
+			&& t == lm_time(2024, 300, 14, 5, 59),
+			"no seconds kept: the last second of the minute");
+		CHECK_EQ(lm_ispf(u, 30, 0, lm_time(2024, 300, 14, 5, 59), &t), -1,
+			"which is no date until the minute is over");
+
+		fake_stats(u, 1999, 365, 23, 59, 1);
+		CHECK(lm_ispf(u, 30, 0, now, &t) == 0
+			&& t == lm_time(1999, 365, 23, 59, 1),
+			"century 0 is the 1900s");
+
+		CHECK_EQ(lm_ispf(u, 28, 0, now, &t), -1,
+			"user data shorter than statistics is none");
+		CHECK_EQ(lm_ispf(NULL, 0, 0, now, &t), -1,
+			"nor is no user data");
+		u[10] = 0x4A;
+		CHECK_EQ(lm_ispf(u, 30, 0, now, &t), -1,
+			"nor a date that is not packed decimal");
+		fake_stats(u, 2024, 300, 14, 5, 33);
+		u[12] = 0x40;
+		u[13] = 0x40;
+		CHECK_EQ(lm_ispf(u, 30, 0, now, &t), -1,
+			"nor blanks where the time belongs");
+	}
+
+	printf("\n--- If-Modified-Since ---\n");
+	{
+		now = EXAMPLE + 86400;
+		CHECK_EQ(lm_unmodified(EXAMPLE, "Sun, 06 Nov 1994 08:49:37 GMT",
+			now), 1, "the date sent back holds");
+		CHECK_EQ(lm_unmodified(EXAMPLE - 1, "Sun, 06 Nov 1994 08:49:37 GMT",
+			now), 1, "so does any later one");
+		CHECK_EQ(lm_unmodified(EXAMPLE + 1, "Sun, 06 Nov 1994 08:49:37 GMT",
+			now), 0, "a change a second later does not");
+		CHECK_EQ(lm_unmodified(EXAMPLE, "Mon, 07 Nov 1994 08:49:38 GMT",
+			now), 0, "a date after now is ignored");
+		CHECK_EQ(lm_unmodified(EXAMPLE, "yesterday", now), 0,
+			"so is one that does not parse");
+		CHECK_EQ(lm_unmodified(EXAMPLE, NULL, now), 0,
+			"and no header at all");
+	}
+
+	return mbt_test_summary("TSTLMOD");
+}
@@ -0,0 +1,355 @@
+/*
+ * tstmetr.c - per-route metrics: the recorder, the quantiles, the renderings.
+ *
+ * The block is counted into by every request and read by a scraper, and
+ * either side going wrong is quiet: a histogram off by one bucket still
+ * renders, it only reports the wrong p99. So:
+ *
+ *   1. Bucket i holds [2^i, 2^(i+1)) us, 0 and 1 in bucket 0, everything
+ *      from 2^27 us in the last; slot mapping puts unknown routes in the
+ *      unmatched slot and never past the array.
+ *   2. Status classes count 1xx..5xx and nothing else.
+ *   3. A quantile is never below the true value and at most twice it.
+ *   4. JSON is balanced and names every active route once; Prometheus
+ *      buckets are cumulative, end at +Inf == _count, and every family
+ *      has its HELP and TYPE before its samples.
+ *   5. A block of another layout is recognised as such.
+ *   6. The JSON size hint follows a larger body at once, decays toward
+ *      smaller ones, and never asks for less than the hint or more than
+ *      MET_PRESIZE_MAX.
+ *
+ * ====================================================================
+ * This test drives the REAL implementation: src/metrics.c is #included
+ * below, with src/routetab.c and src/routes.c for the route labels, so a
+ * later refactor stays covered. router.c and mvsmfctx.c, which time,
+ * latch and anchor the block, cannot compile on the host.
+ * ====================================================================
+ *
+ * Runs on host via `make test-host`.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mbtcheck.h>
+
+#include "../../src/routetab.c"
+#include "../../src/routes.c"
+#include "../../src/metrics.c"
+
+static char msg[200];
+
+/* the emit sink: everything into one buffer */
+static char out[256 * 1024];
+static size_t out_len;
+static int emit_calls;
+static int emit_fail_at;
+
+static int
+collect(void *ctx, const char *text)
+{
+	size_t n = strlen(text);
+
+	(void) ctx;
+	if (emit_fail_at && ++emit_calls >= emit_fail_at) {
+		return -1;
+	}
+	if (out_len + n < sizeof(out)) {
+		memcpy(out + out_len, text, n + 1);
+		out_len += n;
+	}
+	return 0;
+}
+
+static void
+out_reset(void)
+{
+	out[0] = '\0';
+	out_len = 0;
+	emit_calls = 0;
+	emit_fail_at = 0;
+}
+
+static int
+count_of(const char *hay, const char *needle)
+{
+	int n = 0;
+	const char *p = hay;
+
+	while ((p = strstr(p, needle)) != NULL) {
+		n++;
+		p += strlen(needle);
+	}
+	return n;
+}
+
+/* the true quantile of a sorted sample, same rank rule as the histogram */
+static unsigned
+true_quantile(const unsigned *sorted, unsigned n, unsigned permille)
+{
+	unsigned rank = (unsigned) (((double) n * permille + 999) / 1000);
+
+	if (rank == 0) {
+		rank = 1;
+	}
+	return sorted[rank - 1];
+}
+
+static int
+ucmp(const void *a, const void *b)
+{
+	unsigned x = *(const unsigned *) a;
+	unsigned y = *(const unsigned *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+static MVSMF_METRICS met;
+
+int main(void)
+{
+	int i;
+
+	printf("\n--- layout ---\n");
+	CHECK(MET_SLOTS > ROUTE_COUNT, "every route id has a slot, and one is left for no route");
+	metrics_init(&met, 1234);
+	CHECK(metrics_valid(&met), "an initialised block is valid");
+	CHECK_EQ(met.since, 1234u, "since is stamped");
+	met.ver = MET_VERSION + 1;
+	CHECK(!metrics_valid(&met), "another version is not");
+	metrics_init(&met, 0);
+	met.len--;
+	CHECK(!metrics_valid(&met), "another length is not");
+	metrics_init(&met, 0);
+	met.eye[0] = 'X';
+	CHECK(!metrics_valid(&met), "another eyecatcher is not");
+	CHECK(!metrics_valid(NULL), "NULL is not");
+
+	printf("\n--- slots and buckets ---\n");
+	CHECK_EQ(metrics_slot(0), 0, "route 0 has slot 0");
+	CHECK_EQ(metrics_slot(ROUTE_COUNT - 1), ROUTE_COUNT - 1, "the last route has its own slot");
+	CHECK_EQ(metrics_slot(-1), MET_UNMATCHED, "no route counts as unmatched");
+	CHECK_EQ(metrics_slot(MET_SLOTS + 5), MET_UNMATCHED, "an id past the array does too");
+	CHECK_EQ(metrics_bucket(0), 0, "0 us is bucket 0");
+	CHECK_EQ(metrics_bucket(1), 0, "1 us is bucket 0");
+	for (i = 1; i < MET_BUCKETS - 1; i++) {
+		snprintf(msg, sizeof(msg), "2^%d us starts bucket %d", i, i);
+		CHECK_EQ(metrics_bucket(1u << i), i, msg);
+		snprintf(msg, sizeof(msg), "2^%d - 1 us ends bucket %d", i + 1, i);
+		CHECK_EQ(metrics_bucket((2u << i) - 1), i, msg);
+	}
+	CHECK_EQ(metrics_bucket(1u << (MET_BUCKETS - 1)), MET_BUCKETS - 1, "2^27 us is the open bucket");
+	CHECK_EQ(metrics_bucket(0xFFFFFFFFu), MET_BUCKETS - 1, "and so is the largest value");
+
+	printf("\n--- recording ---\n");
+	metrics_init(&met, 0);
+	metrics_record(&met, ROUTE_DS_GET, 200, 0, 1000, 150);
+	metrics_record(&met, ROUTE_DS_GET, 304, 0, 0, 40);
+	metrics_record(&met, ROUTE_DS_GET, 404, 0, 120, 30);
+	metrics_record(&met, ROUTE_DS_GET, 500, 0, 120, 9000);
+	metrics_record(&met, ROUTE_DS_GET, 0, 0, 0, 5);		/* nothing sent */
+	metrics_record(&met, ROUTE_DS_GET, 999, 0, 0, 5);	/* not a status */
+	metrics_record(&met, ROUTE_DS_PUT, 204, 4096, 0, 2000);
+	metrics_record(&met, -3, 200, 0, 0, 1);			/* dropped */
+	metrics_record(&met, MET_SLOTS, 200, 0, 0, 1);		/* dropped */
+	metrics_record(NULL, 0, 200, 0, 0, 1);			/* ignored */
+	{
+		const MET_ROUTE *r = &met.route[ROUTE_DS_GET];
+		unsigned sum = 0;
+
+		CHECK_EQ(r->count, 6u, "six requests on the data set GET");
+		CHECK_EQ(r->status[1], 1u, "one 2xx");
+		CHECK_EQ(r->status[2], 1u, "one 3xx");
+		CHECK_EQ(r->status[3], 1u, "one 4xx");
+		CHECK_EQ(r->status[4], 1u, "one 5xx");
+		CHECK_EQ(r->status[0], 0u, "no 1xx; neither 0 nor 999 is a class");
+		CHECK_EQ(r->usec_max, 9000u, "the maximum");
+		CHECK(r->usec_sum == 150 + 40 + 30 + 9000 + 5 + 5, "the latency sum");
+		CHECK(r->bytes_out == 1240, "bytes sent add up");
+		for (i = 0; i < MET_BUCKETS; i++) {
+			sum += r->hist[i];
+		}
+		CHECK_EQ(sum, r->count, "the histogram holds every request");
+		CHECK_EQ(r->hist[metrics_bucket(150)], 1u, "150 us landed in its bucket");
+		CHECK(met.route[ROUTE_DS_PUT].bytes_in == 4096, "bytes received on the PUT");
+		CHECK_EQ(met.route[MET_UNMATCHED].count, 0u, "out-of-range slots were dropped, not folded");
+	}
+
+	printf("\n--- quantiles: never low, at most twice ---\n");
+	{
+		static unsigned sample[20000];
+		static const unsigned pm[] = { 1, 500, 900, 990, 999, 1000 };
+		unsigned long seed = 12345;
+		unsigned n;
+		int k;
+
+		for (k = 0; k < 6; k++) {
+			MET_ROUTE r;
+			int j;
+
+			memset(&r, 0, sizeof(r));
+			n = 1000 + (unsigned) k * 3000;
+			for (j = 0; j < (int) n; j++) {
+				seed = seed * 1103515245UL + 12345UL;
+				/* log-spread: 1 us .. ~16 s, the shape latencies have */
+				sample[j] = 1u + (unsigned) ((seed >> 8) & 0xFFFF) %
+					(1u << (1 + (seed >> 4) % 24));
+				r.hist[metrics_bucket(sample[j])]++;
+				if (sample[j] > r.usec_max) r.usec_max = sample[j];
+			}
+			qsort(sample, n, sizeof(sample[0]), ucmp);
+			for (j = 0; j < 6; j++) {
+				unsigned t = true_quantile(sample, n, pm[j]);
+				unsigned q = metrics_quantile(&r, pm[j]);
+				snprintf(msg, sizeof(msg), "n=%u p%u.%u: %u us for true %u us",
+					n, pm[j] / 10, pm[j] % 10, q, t);
+				CHECK(q >= t && (q <= 2 * t || (t <= 1 && q <= 2)), msg);
+			}
+		}
+
+		{
+			MET_ROUTE r;
+			memset(&r, 0, sizeof(r));
+			CHECK_EQ(metrics_quantile(&r, 990), 0u, "an empty slot has no p99");
+			r.hist[MET_BUCKETS - 1] = 3;
+			r.usec_max = 500000000u;
+			CHECK_EQ(metrics_quantile(&r, 500), 500000000u, "the open bucket answers with the maximum");
+		}
+	}
+
+	printf("\n--- JSON size hint ---\n");
+	{
+		MET_ROUTE r;
+		unsigned prev;
+		int n;
+
+		memset(&r, 0, sizeof(r));
+		CHECK_EQ(metrics_presize(&r), 0u, "no hint before the first body");
+		metrics_size(&r, 5000);
+		CHECK_EQ(r.json_hint, 5000u, "the first body is the hint");
+		CHECK(metrics_presize(&r) > 5000u, "the presize covers it, with slack");
+		metrics_size(&r, 9000);
+		CHECK_EQ(r.json_hint, 9000u, "a larger body raises it at once");
+		metrics_size(&r, 1000);
+		CHECK_EQ(r.json_hint, 8750u, "a smaller one lowers it by a 32nd of the gap");
+
+		prev = r.json_hint;
+		for (n = 0; n < 400; n++) {
+			metrics_size(&r, 1000);
+			if (r.json_hint > prev) {
+				break;
+			}
+			prev = r.json_hint;
+		}
+		CHECK(n == 400, "it never rises on smaller bodies");
+		CHECK(r.json_hint >= 1000u && r.json_hint < 1032u, "and settles on their size");
+
+		metrics_size(&r, 10u * MET_PRESIZE_MAX);
+		CHECK_EQ(metrics_presize(&r), (unsigned) MET_PRESIZE_MAX, "a huge route is capped");
+		metrics_size(NULL, 1);
+		CHECK_EQ(metrics_presize(NULL), 0u, "NULL is ignored");
+
+		/* a route whose documents vary by half from one request to the
+		   next -- a member list, a job's files -- must still be answered
+		   from a presized buffer almost every time */
+		srand(8);
+		memset(&r, 0, sizeof(r));
+		{
+			int covered = 0;
+			for (n = 0; n < 2000; n++) {
+				unsigned size = 4000 + rand() % 2000;
+				if (n >= 100) {
+					covered += metrics_presize(&r) > size;
+				}
+				metrics_size(&r, size);
+			}
+			printf("  varying route: %d of 1900 bodies fit the presize\n",
+				covered);
+			CHECK(covered >= 1900 * 99 / 100, "99% fit without a realloc");
+		}
+	}
+
+	printf("\n--- JSON rendering ---\n");
+	out_reset();
+	metrics_init(&met, 77);
+	metrics_record(&met, ROUTE_DS_GET, 200, 0, 10, 100);
+	metrics_record(&met, ROUTE_USS_PUT, 201, 50, 0, 3000);
+	metrics_record(&met, metrics_slot(-1), 404, 0, 0, 20);
+	CHECK_EQ(metrics_render_json(&met, mvsmf_routes(), collect, NULL), 0, "renders");
+	printf("  %.300s...\n", out);
+	CHECK(strncmp(out, "{\"since\":77,\"routes\":[", 22) == 0, "opens with since and the routes array");
+	CHECK_EQ(count_of(out, "{"), count_of(out, "}"), "braces balance");
+	CHECK_EQ(count_of(out, "["), count_of(out, "]"), "brackets balance");
+	CHECK_EQ(count_of(out, "\"route\":"), 3, "three active slots, three entries");
+	CHECK(strstr(out, "\"route\":\"GET /zosmf/restfiles/ds/{dataset-name}\"") != NULL, "the data set GET by its pattern");
+	CHECK(strstr(out, "\"route\":\"PUT /zosmf/restfiles/fs/{*filepath}\"") != NULL, "the USS PUT by its pattern");
+	CHECK(strstr(out, "\"route\":\"(none)\"") != NULL, "the unmatched slot");
+	CHECK(strstr(out, "\"p99\":128") != NULL, "p99 of one 100 us request is its bucket's bound");
+	CHECK(strstr(out, ",,") == NULL && strstr(out, ",]") == NULL && strstr(out, ",}") == NULL, "no stray commas");
+
+	out_reset();
+	emit_fail_at = 3;
+	CHECK(metrics_render_json(&met, mvsmf_routes(), collect, NULL) < 0, "a failing sink stops the rendering");
+
+	printf("\n--- Prometheus rendering ---\n");
+	out_reset();
+	for (i = 0; i < 50; i++) {
+		metrics_record(&met, ROUTE_DS_GET, 200, 0, 10, 1u << (i % 20));
+	}
+	CHECK_EQ(metrics_render_prom(&met, mvsmf_routes(), collect, NULL), 0, "renders");
+	{
+		static const char *fam[] = {
+			"mvsmf_requests_total", "mvsmf_received_bytes_total",
+			"mvsmf_sent_bytes_total", "mvsmf_request_duration_seconds"
+		};
+		const char *line;
+		const char *inf;
+		unsigned prev = 0;
+		unsigned v;
+		int monotonic = 1;
+		int nb = 0;
+		char want[160];
+
+		for (i = 0; i < 4; i++) {
+			char h[96];
+			const char *ph;
+			const char *pt;
+			const char *ps;
+
+			snprintf(h, sizeof(h), "# HELP %s ", fam[i]);
+			ph = strstr(out, h);
+			snprintf(h, sizeof(h), "# TYPE %s ", fam[i]);
+			pt = strstr(out, h);
+			snprintf(h, sizeof(h), "\n%s{", fam[i]);
+			ps = strstr(out, h);
+			if (!ps) {
+				snprintf(h, sizeof(h), "\n%s_bucket{", fam[i]);
+				ps = strstr(out, h);
+			}
+			snprintf(msg, sizeof(msg), "%s: HELP, TYPE, then samples", fam[i]);
+			CHECK(ph && pt && ps && ph < pt && pt < ps, msg);
+		}
+
+		snprintf(want, sizeof(want),
+			"mvsmf_request_duration_seconds_bucket{route=\"GET /zosmf/restfiles/ds/{dataset-name}\",le=");
+		for (line = strstr(out, want); line; line = strstr(line + 1, want)) {
+			const char *sp = strchr(line, '}');
+			v = (unsigned) strtoul(sp + 2, NULL, 10);
+			if (v < prev) monotonic = 0;
+			prev = v;
+			nb++;
+		}
+		CHECK_EQ(nb, MET_BUCKETS, "one bucket line per bucket, +Inf included");
+		CHECK(monotonic, "bucket counts are cumulative");
+		inf = strstr(out, "{route=\"GET /zosmf/restfiles/ds/{dataset-name}\",le=\"+Inf\"} 51\n");
+		CHECK(inf != NULL, "+Inf carries every request");
+		CHECK(strstr(out, "mvsmf_request_duration_seconds_count{route=\"GET /zosmf/restfiles/ds/{dataset-name}\"} 51\n") != NULL,
+			"and equals _count");
+		CHECK(strstr(out, "le=\"0.000001\"} ") != NULL, "the first bound is 1 us, inclusive");
+		CHECK(strstr(out, "code=\"4xx\"} 1\n") != NULL, "the unmatched 404 is a 4xx");
+		CHECK(strstr(out, "code=\"1xx\"") == NULL, "empty classes are left out");
+		CHECK(out_len > 0 && out[out_len - 1] == '\n', "ends with a newline");
+	}
+
+	return mbt_test_summary("TSTMETR");
+}
@@ -0,0 +1,534 @@
+/*
+ * tstrctx.c - the request context: one walk over the CGI environment.
+ *
+ * Handlers used to ask http_get_env() for every header and query parameter
+ * they needed, one linear walk of the environment per question, with a
+ * snprintf() in front of each. The router now files the environment into a
+ * RequestCtx once, and handlers read its fields. Three things must hold for
+ * that to be a pure optimization:
+ *
+ *   1. Every name a handler reads resolves to what http_get_env() returned
+ *      for it -- same value, whatever case the client or httpd used, first
+ *      occurrence winning.
+ *   2. The typed fields equal the parse each call site used to do itself:
+ *      strtoul() Content-Length, a substring test for chunked, the dsapi.c
+ *      X-IBM-Data-Type rules, atoi() X-IBM-Max-Items, jobsapi.c's max-jobs
+ *      validation and etag_requested(). Content-Encoding, which no call
+ *      site parsed before, is checked against the codings receive_body()
+ *      takes, and Accept-Encoding, with its q-values, against gzip.
+ *   3. The name tables and the id enums agree, so no slot is unreachable.
+ *
+ * Then a benchmark: for each route, the env lookups its handler made before
+ * (read off the code this replaced) against the one walk now, counted in
+ * lookups and in environment entries visited, and timed.
+ *
+ * ====================================================================
+ * This test drives the REAL implementation: src/reqctx.c is #included
+ * below (with src/etag.c, whose etag_requested() it calls), so a later
+ * refactor stays covered. router.c, which feeds it httpc->env, cannot
+ * compile on the host, which is why the filing lives in its own TU.
+ * ====================================================================
+ *
+ * Runs on host via `make test-host`.
+ */
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <mbtcheck.h>
+
+#include "../../src/etag.c"
+#include "../../src/reqctx.c"
+
+static char msg[200];
+
+typedef struct {
+	const char *name;
+	const char *value;
+} ENVVAR;
+
+/* What httpd hands a CGI for a typical Zowe Explorer request: the CGI
+   variables, then the headers, then the query string. The request-specific
+   variables are appended per case below. */
+static const ENVVAR base_env[] = {
+	{ "REQUEST_METHOD",		"GET" },
+	{ "REQUEST_PATH",		"/zosmf/restfiles/ds/IBMUSER.JCL" },
+	{ "REQUEST_VERSION",		"HTTP/1.1" },
+	{ "QUERY_STRING",		"" },
+	{ "SERVER_NAME",		"mvs38j" },
+	{ "SERVER_PORT",		"1080" },
+	{ "SERVER_SOFTWARE",		"httpd" },
+	{ "REMOTE_ADDR",		"192.168.1.10" },
+	{ "REMOTE_PORT",		"51234" },
+	{ "HTTP_Host",			"mvs38j:1080" },
+	{ "HTTP_User-Agent",		"Zowe-SDK/8" },
+	{ "HTTP_Accept",		"*/*" },
+	{ "HTTP_Accept-Encoding",	"gzip, deflate" },
+	{ "HTTP_Connection",		"keep-alive" },
+	{ "HTTP_Authorization",		"Basic SUJNVVNFUjpTWVMx" },
+	{ "HTTP_X-CSRF-ZOSMF-HEADER",	"true" },
+};
+#define N_BASE	((int) (sizeof(base_env) / sizeof(base_env[0])))
+
+#define MAX_ENV	40
+
+static ENVVAR env[MAX_ENV];
+static int n_env;
+
+static void
+env_reset(void)
+{
+	memcpy(env, base_env, sizeof(base_env));
+	n_env = N_BASE;
+}
+
+static void
+env_add(const char *name, const char *value)
+{
+	env[n_env].name = name;
+	env[n_env].value = value;
+	n_env++;
+}
+
+static int
+ieq(const char *a, const char *b)
+{
+	for (; *a && *b; a++, b++) {
+		if (toupper((unsigned char) *a) != toupper((unsigned char) *b)) {
+			return 0;
+		}
+	}
+	return *a == *b;
+}
+
+/* http_get_env() as the handlers used it: one walk from the top, first
+   match wins, names compared ignoring case. `visited` counts the entries
+   the walk looked at. */
+static long visited;
+
+static const char *
+old_get_env(const char *name)
+{
+	int i;
+
+	for (i = 0; i < n_env; i++) {
+		visited++;
+		if (ieq(env[i].name, name)) {
+			return env[i].value;
+		}
+	}
+	return NULL;
+}
+
+/* getHeaderParam()/getQueryParam() as they were: snprintf, then the walk */
+static const char *
+old_param(const char *prefix, const char *name)
+{
+	char buf[64];
+
+	(void) snprintf(buf, sizeof(buf), "%s%s", prefix, name);
+	return old_get_env(buf);
+}
+
+static void
+fill(RequestCtx *ctx)
+{
+	int i;
+
+	reqctx_init(ctx);
+	for (i = 0; i < n_env; i++) {
+		reqctx_add(ctx, env[i].name, env[i].value);
+	}
+	reqctx_finish(ctx);
+}
+
+/* The context's answer for a full environment name. */
+static const char *
+ctx_get(const RequestCtx *ctx, const char *name)
+{
+	int id;
+
+	if (strncmp(name, "HTTP_", 5) == 0) {
+		id = reqctx_header_id(name + 5);
+		return id >= 0 ? ctx->hdr[id] : "<no slot>";
+	}
+	if (strncmp(name, "QUERY_", 6) == 0) {
+		id = reqctx_query_id(name + 6);
+		return id >= 0 ? ctx->qry[id] : "<no slot>";
+	}
+	for (id = 0; id < RQE_COUNT; id++) {
+		if (ieq(rq_env_names[id], name)) {
+			return ctx->env[id];
+		}
+	}
+	return "<no slot>";
+}
+
+static int
+same(const char *a, const char *b)
+{
+	return (!a && !b) || (a && b && strcmp(a, b) == 0);
+}
+
+/* The lookups each route's handler made before, in the order it made them,
+   read off the code the request context replaced. Every route also paid for
+   the router's REQUEST_METHOD and REQUEST_PATH and the identity middleware's
+   REQUEST_PATH. consoleLogHandler tried each parameter as sent and then
+   upper-cased, so a miss there cost two walks. */
+#define MAX_LOOKUPS 16
+
+typedef struct {
+	const char *route;
+	const char *extra[4][2];	/* request-specific variables */
+	const char *names[MAX_LOOKUPS];
+} ROUTECASE;
+
+static const ROUTECASE cases[] = {
+	{ "GET  ds list",
+	  { { "QUERY_DSLEVEL", "IBMUSER.*" }, { "HTTP_X-IBM-Max-Items", "0" } },
+	  { "REQUEST_METHOD", "REQUEST_PATH", "REQUEST_PATH",
+	    "REQUEST_METHOD", "REQUEST_PATH", "QUERY_DSLEVEL", "QUERY_VOLSER",
+	    "QUERY_START", "HTTP_X-IBM-Max-Items" } },
+	{ "GET  ds",
+	  { { "HTTP_X-IBM-Data-Type", "text" },
+	    { "HTTP_If-None-Match", "\"0123456789ABCDEF\"" } },
+	  { "REQUEST_METHOD", "REQUEST_PATH", "REQUEST_PATH",
+	    "HTTP_X-IBM-Data-Type", "HTTP_If-None-Match",
+	    "HTTP_X-IBM-Return-Etag" } },
+	{ "PUT  ds",
+	  { { "HTTP_Content-Type", "text/plain" },
+	    { "HTTP_Content-Length", "4000" },
+	    { "HTTP_If-Match", "0123456789ABCDEF" },
+	    { "HTTP_X-IBM-Return-Etag", "true" } },
+	  { "REQUEST_METHOD", "REQUEST_PATH", "REQUEST_PATH",
+	    "HTTP_Content-Type", "HTTP_X-IBM-Data-Type",
+	    "HTTP_TRANSFER-ENCODING", "HTTP_CONTENT-LENGTH", "HTTP_If-Match",
+	    "HTTP_X-IBM-Return-Etag" } },
+	{ "GET  member list",
+	  { { "QUERY_PATTERN", "IEF*" }, { "HTTP_X-IBM-Max-Items", "1000" } },
+	  { "REQUEST_METHOD", "REQUEST_PATH", "REQUEST_PATH",
+	    "REQUEST_METHOD", "REQUEST_PATH", "QUERY_START", "QUERY_PATTERN",
+	    "HTTP_X-IBM-Max-Items" } },
+	{ "PUT  member",
+	  { { "HTTP_Content-Type", "text/plain" },
+	    { "HTTP_Transfer-Encoding", "chunked" },
+	    { "HTTP_If-Match", "0123456789ABCDEF" } },
+	  { "REQUEST_METHOD", "REQUEST_PATH", "REQUEST_PATH",
+	    "HTTP_Content-Type", "HTTP_CONTENT-LENGTH",
+	    "HTTP_TRANSFER-ENCODING", "HTTP_X-IBM-Data-Type", "HTTP_If-Match",
+	    "HTTP_X-IBM-Return-Etag" } },
+	{ "GET  jobs",
+	  { { "QUERY_OWNER", "IBMUSER" }, { "QUERY_PREFIX", "*" } },
+	  { "REQUEST_METHOD", "REQUEST_PATH", "REQUEST_PATH", "HTTP_HOST",
+	    "QUERY_owner", "QUERY_max-jobs", "QUERY_prefix", "QUERY_status",
+	    "QUERY_jobid", "QUERY_exec-data" } },
+	{ "PUT  jobs",
+	  { { "HTTP_Content-Type", "text/plain" },
+	    { "HTTP_Content-Length", "800" },
+	    { "HTTP_X-IBM-Intrdr-Mode", "TEXT" } },
+	  { "REQUEST_METHOD", "REQUEST_PATH", "REQUEST_PATH",
+	    "HTTP_X-IBM-Intrdr-Mode", "HTTP_X-IBM-Intrdr-Lrecl",
+	    "HTTP_X-IBM-Intrdr-Recfm", "HTTP_Content-Length",
+	    "HTTP_Transfer-Encoding", "HTTP_Content-Type", "HTTP_HOST" } },
+	{ "GET  fs list",
+	  { { "QUERY_PATH", "/u/ibmuser" } },
+	  { "REQUEST_METHOD", "REQUEST_PATH", "REQUEST_PATH", "QUERY_path",
+	    "HTTP_X-IBM-Max-Items" } },
+	{ "PUT  fs",
+	  { { "HTTP_Content-Type", "application/octet-stream" },
+	    { "HTTP_X-IBM-Data-Type", "binary" },
+	    { "HTTP_Content-Length", "65536" } },
+	  { "REQUEST_METHOD", "REQUEST_PATH", "REQUEST_PATH", "HTTP_If-Match",
+	    "HTTP_Content-Type", "HTTP_X-IBM-Data-Type",
+	    "HTTP_Content-Length", "HTTP_Transfer-Encoding",
+	    "HTTP_X-IBM-Return-Etag" } },
+	{ "GET  console log",
+	  { { "QUERY_TIMERANGE", "10m" } },
+	  { "REQUEST_METHOD", "REQUEST_PATH", "REQUEST_PATH",
+	    "QUERY_timeRange", "QUERY_TIMERANGE", "QUERY_time", "QUERY_TIME",
+	    "QUERY_timestamp", "QUERY_TIMESTAMP", "QUERY_hardcopy",
+	    "QUERY_HARDCOPY", "QUERY_sysName", "QUERY_SYSNAME",
+	    "QUERY_direction", "QUERY_DIRECTION" } },
+	{ "GET  info",
+	  { { "HTTP_X-Forwarded-Proto", "https" } },
+	  { "REQUEST_METHOD", "REQUEST_PATH", "REQUEST_PATH", "HTTP_Host",
+	    "HTTP_X-Forwarded-Port", "HTTP_X-Forwarded-Proto" } },
+};
+#define N_CASES	((int) (sizeof(cases) / sizeof(cases[0])))
+
+static void
+case_env(const ROUTECASE *c)
+{
+	int i;
+
+	env_reset();
+	for (i = 0; i < 4 && c->extra[i][0]; i++) {
+		env_add(c->extra[i][0], c->extra[i][1]);
+	}
+}
+
+static int
+n_lookups(const ROUTECASE *c)
+{
+	int n = 0;
+
+	while (n < MAX_LOOKUPS && c->names[n]) {
+		n++;
+	}
+	return n;
+}
+
+int main(void)
+{
+	RequestCtx ctx;
+	int i;
+	int j;
+
+	printf("\n--- the name tables and the ids agree ---\n");
+	for (i = 0; i < RQH_COUNT; i++) {
+		char up[64];
+		snprintf(msg, sizeof(msg), "header %s has id %d", rq_hdr_names[i], i);
+		CHECK_EQ(reqctx_header_id(rq_hdr_names[i]), i, msg);
+		for (j = 0; rq_hdr_names[i][j]; j++) {
+			up[j] = (char) toupper((unsigned char) rq_hdr_names[i][j]);
+		}
+		up[j] = '\0';
+		snprintf(msg, sizeof(msg), "and %s has it too", up);
+		CHECK_EQ(reqctx_header_id(up), i, msg);
+	}
+	for (i = 0; i < RQQ_COUNT; i++) {
+		snprintf(msg, sizeof(msg), "query %s has id %d", rq_qry_names[i], i);
+		CHECK_EQ(reqctx_query_id(rq_qry_names[i]), i, msg);
+	}
+	for (i = 0; i < RQE_COUNT; i++) {
+		CHECK(rq_env_names[i] != NULL, "every CGI variable id has a name");
+	}
+	CHECK_EQ(reqctx_header_id("X-IBM-Data"), -1, "a prefix of a name is not the name");
+	CHECK_EQ(reqctx_header_id("X-IBM-Data-Type2"), -1, "nor is an extension of it");
+	CHECK_EQ(reqctx_header_id("User-Agent"), -1, "an unknown header has no slot");
+	CHECK_EQ(reqctx_query_id("fn"), -1, "an unknown query parameter has no slot");
+	CHECK_EQ(reqctx_header_id(""), -1, "the empty name has no slot");
+	CHECK_EQ(reqctx_header_id(NULL), -1, "NULL has no slot");
+
+	printf("\n--- filing: same answer as http_get_env() ---\n");
+	env_reset();
+	env_add("HTTP_CONTENT-TYPE", "text/plain");
+	env_add("HTTP_content-type", "application/json");	/* second: loses */
+	env_add("QUERY_DSLEVEL", "SYS1.*");
+	env_add("query_Volser", "PUB001");
+	env_add("HTTP_X-Unknown", "x");
+	env_add("HTTPX_Host", "not a header");
+	env_add("QUERY_", "empty name");
+	fill(&ctx);
+	CHECK(ctx.filled, "the context says it is filled");
+	CHECK(same(ctx.hdr[RQH_CONTENT_TYPE], "text/plain"), "first Content-Type wins, any case");
+	CHECK(same(ctx.hdr[RQH_HOST], "mvs38j:1080"), "Host is filed");
+	CHECK(same(ctx.qry[RQQ_DSLEVEL], "SYS1.*"), "QUERY_DSLEVEL files as dslevel");
+	CHECK(same(ctx.qry[RQQ_VOLSER], "PUB001"), "the prefix matches ignoring case");
+	CHECK(ctx.qry[RQQ_START] == NULL, "an absent parameter stays NULL");
+	CHECK(same(ctx.env[RQE_REQUEST_PATH], "/zosmf/restfiles/ds/IBMUSER.JCL"), "REQUEST_PATH is filed");
+	CHECK(ctx.env[RQE_POST_STRING] == NULL, "POST_STRING absent");
+	CHECK(ctx.hdr[RQH_IF_MATCH] == NULL, "If-Match absent");
+	CHECK(ctx.match.route == -1, "no route until the router matches one");
+	for (i = 0; i < n_env; i++) {
+		visited = 0;
+		if (strcmp(ctx_get(&ctx, env[i].name), "<no slot>") == 0) {
+			continue;
+		}
+		snprintf(msg, sizeof(msg), "%s: context and env walk agree", env[i].name);
+		CHECK(same(ctx_get(&ctx, env[i].name), old_get_env(env[i].name)), msg);
+	}
+	reqctx_add(&ctx, NULL, "v");
+	reqctx_add(&ctx, "HTTP_Host", NULL);
+	CHECK(same(ctx.hdr[RQH_HOST], "mvs38j:1080"), "NULL name or value is ignored");
+
+	printf("\n--- typed fields: the parse each call site did ---\n");
+	{
+		static const struct {
+			const char *cl, *te, *dt, *mi, *mj, *re;
+			int has_cl; unsigned long cl_v; int chunked; int dt_v;
+			int has_mi; int mi_v; long mj_v; int re_v;
+		} t[] = {
+			{ NULL, NULL, NULL, NULL, NULL, NULL,
+			  0, 0, 0, DATA_TYPE_TEXT, 0, 0, 0, 0 },
+			{ "4000", "chunked", "binary", "1000", "25", "true",
+			  1, 4000, 1, DATA_TYPE_BINARY, 1, 1000, 25, 1 },
+			{ "0", "gzip, chunked", "record", "0", "25x", "TRUE",
+			  1, 0, 1, DATA_TYPE_RECORD, 1, 0, 0, 1 },
+			{ "12abc", "identity", "text;fileEncoding=IBM-1047", "-1", "-5", " true",
+			  1, 12, 0, DATA_TYPE_TEXT, 1, -1, 0, 1 },
+			{ "", "CHUNKED", "BINARY", "abc", "0", "false",
+			  1, 0, 0, DATA_TYPE_TEXT, 1, 0, 0, 0 },
+			{ NULL, NULL, "Record", NULL, "1", "yes",
+			  0, 0, 0, DATA_TYPE_TEXT, 0, 0, 1, 0 },
+		};
+
+		for (i = 0; i < (int) (sizeof(t) / sizeof(t[0])); i++) {
+			env_reset();
+			if (t[i].cl) env_add("HTTP_Content-Length", t[i].cl);
+			if (t[i].te) env_add("HTTP_Transfer-Encoding", t[i].te);
+			if (t[i].dt) env_add("HTTP_X-IBM-Data-Type", t[i].dt);
+			if (t[i].mi) env_add("HTTP_X-IBM-Max-Items", t[i].mi);
+			if (t[i].mj) env_add("QUERY_MAX-JOBS", t[i].mj);
+			if (t[i].re) env_add("HTTP_X-IBM-Return-Etag", t[i].re);
+			fill(&ctx);
+
+			snprintf(msg, sizeof(msg), "case %d: has Content-Length", i);
+			CHECK_EQ(ctx.has_length, t[i].has_cl, msg);
+			snprintf(msg, sizeof(msg), "case %d: Content-Length value", i);
+			CHECK_EQ((unsigned long) ctx.content_length, t[i].cl_v, msg);
+			snprintf(msg, sizeof(msg), "case %d: chunked", i);
+			CHECK_EQ(ctx.chunked, t[i].chunked, msg);
+			snprintf(msg, sizeof(msg), "case %d: data type", i);
+			CHECK_EQ(ctx.data_type, t[i].dt_v, msg);
+			snprintf(msg, sizeof(msg), "case %d: has X-IBM-Max-Items", i);
+			CHECK_EQ(ctx.has_max_items, t[i].has_mi, msg);
+			snprintf(msg, sizeof(msg), "case %d: X-IBM-Max-Items value", i);
+			CHECK_EQ(ctx.max_items, t[i].mi_v, msg);
+			snprintf(msg, sizeof(msg), "case %d: max-jobs", i);
+			CHECK_EQ(ctx.max_jobs, t[i].mj_v, msg);
+			snprintf(msg, sizeof(msg), "case %d: X-IBM-Return-Etag", i);
+			CHECK_EQ(ctx.return_etag, t[i].re_v, msg);
+		}
+	}
+
+	printf("\n--- Content-Encoding ---\n");
+	{
+		static const struct {
+			const char *ce;
+			int coding;
+		} t[] = {
+			{ NULL, CODING_IDENTITY },
+			{ "", CODING_IDENTITY },
+			{ "identity", CODING_IDENTITY },
+			{ "gzip", CODING_GZIP },
+			{ " GZip ", CODING_GZIP },
+			{ "x-gzip", CODING_GZIP },
+			{ "deflate", CODING_DEFLATE },
+			{ "br", CODING_UNKNOWN },
+			{ "gzip, deflate", CODING_UNKNOWN },
+			{ "gzipgzipgzipgzipgzip", CODING_UNKNOWN },
+		};
+
+		for (i = 0; i < (int) (sizeof(t) / sizeof(t[0])); i++) {
+			env_reset();
+			if (t[i].ce) env_add("HTTP_Content-Encoding", t[i].ce);
+			fill(&ctx);
+			snprintf(msg, sizeof(msg), "\"%s\"", t[i].ce ? t[i].ce : "(none)");
+			CHECK_EQ(ctx.content_coding, t[i].coding, msg);
+		}
+	}
+
+	printf("\n--- Accept-Encoding ---\n");
+	{
+		static const struct {
+			const char *ae;
+			int gzip;
+		} t[] = {
+			{ NULL, 0 },
+			{ "", 0 },
+			{ "identity", 0 },
+			{ "gzip", 1 },
+			{ "GZIP", 1 },
+			{ "x-gzip", 1 },
+			{ "gzip, deflate, br", 1 },
+			{ "deflate,gzip", 1 },
+			{ "br;q=1.0, gzip;q=0.8, *;q=0.1", 1 },
+			{ "gzip ; q=0.001", 1 },
+			{ "gzip;q=0", 0 },
+			{ "gzip;q=0.000", 0 },
+			{ "gzip;q=0, *", 0 },
+			{ "*", 1 },
+			{ "*;q=0", 0 },
+			{ "deflate, br", 0 },
+			{ "gzipped", 0 },
+		};
+
+		/* the base request sends one; the case replaces it */
+		for (i = 0; i < (int) (sizeof(t) / sizeof(t[0])); i++) {
+			int k;
+
+			env_reset();
+			for (k = 0; k < n_env; k++) {
+				if (strcmp(env[k].name, "HTTP_Accept-Encoding") == 0) {
+					env[k].name = t[i].ae ? env[k].name : "HTTP_X-Absent";
+					env[k].value = t[i].ae ? t[i].ae : "";
+				}
+			}
+			fill(&ctx);
+			snprintf(msg, sizeof(msg), "\"%s\"", t[i].ae ? t[i].ae : "(none)");
+			CHECK_EQ(ctx.accept_gzip, t[i].gzip, msg);
+		}
+	}
+
+	printf("\n--- every route: each name its handler read, same value ---\n");
+	for (i = 0; i < N_CASES; i++) {
+		const ROUTECASE *c = &cases[i];
+
+		case_env(c);
+		fill(&ctx);
+		for (j = 0; j < n_lookups(c); j++) {
+			const char *got = ctx_get(&ctx, c->names[j]);
+			snprintf(msg, sizeof(msg), "%s: %s has a slot", c->route, c->names[j]);
+			CHECK(!got || strcmp(got, "<no slot>") != 0, msg);
+			snprintf(msg, sizeof(msg), "%s: %s as before", c->route, c->names[j]);
+			CHECK(same(got, old_get_env(c->names[j])), msg);
+		}
+	}
+
+	printf("\n--- benchmark: env lookups per route, before and after ---\n");
+	printf("  %-18s %8s %9s  %8s %9s  %9s %9s\n", "route", "lookups",
+		"visited", "walks", "visited", "old ns", "new ns");
+	for (i = 0; i < N_CASES; i++) {
+		const ROUTECASE *c = &cases[i];
+		const long iters = 200000;
+		long before_visits;
+		long it;
+		clock_t t0;
+		double t_old;
+		double t_new;
+		volatile const char *sink = NULL;
+
+		case_env(c);
+
+		visited = 0;
+		for (j = 0; j < n_lookups(c); j++) {
+			(void) old_get_env(c->names[j]);
+		}
+		before_visits = visited;
+
+		t0 = clock();
+		for (it = 0; it < iters; it++) {
+			for (j = 0; j < n_lookups(c); j++) {
+				if (strncmp(c->names[j], "HTTP_", 5) == 0) {
+					sink = old_param("HTTP_", c->names[j] + 5);
+				} else if (strncmp(c->names[j], "QUERY_", 6) == 0) {
+					sink = old_param("QUERY_", c->names[j] + 6);
+				} else {
+					sink = old_get_env(c->names[j]);
+				}
+			}
+		}
+		t_old = (double) (clock() - t0) / CLOCKS_PER_SEC;
+
+		t0 = clock();
+		for (it = 0; it < iters; it++) {
+			fill(&ctx);
+			sink = ctx.hdr[RQH_HOST];
+		}
+		t_new = (double) (clock() - t0) / CLOCKS_PER_SEC;
+		(void) sink;
+
+		printf("  %-18s %8d %9ld  %8d %9d  %9.1f %9.1f\n", c->route,
+			n_lookups(c), before_visits, 1, n_env,
+			t_old * 1e9 / iters, t_new * 1e9 / iters);
+
+		snprintf(msg, sizeof(msg), "%s: one walk visits fewer entries than the lookups did",
+			c->route);
+		CHECK(n_env < before_visits, msg);
+	}
+
+	return mbt_test_summary("TSTRCTX");
+}
@@ -0,0 +1,370 @@
+/*
+ * tstrdah.c - read-ahead: the two-buffer schedule between the reader
+ * subtask and the worker that sends (src/rdahead.c).
+ *
+ * dsread.c runs the schedule on two TCBs and hands it over through ECBs;
+ * here both sides run on one simulated clock, each taking as long per
+ * block as its disk or network would. So:
+ *
+ *   1. The hand-over by itself: the reader fills the two buffers in turn
+ *      and waits when both are full; the sender takes them in the order
+ *      filled and waits when none is; a buffer goes back to the reader only
+ *      on release.
+ *   2. The end of the data, a failed read and a sender that stops early
+ *      each end both sides, and stay ended.
+ *   3. Through the simulation, every block arrives once, whole and in
+ *      order, at any mix of latencies -- and neither side ever waits with
+ *      the other waiting too.
+ *   4. The time: with the reads in line a data set takes disk plus
+ *      network; read ahead, at steady latencies, at most the slower of the
+ *      two plus one block of the other. Jittered latencies lose some of
+ *      that to the two buffers running dry or full, and must still beat
+ *      the reads in line by a quarter. Disk-bound, network-bound, balanced
+ *      and jittered, with the MB/s both ways.
+ *
+ * ====================================================================
+ * This test drives the REAL implementation: src/rdahead.c is #included
+ * below. The clock and the two actors are the test's own; dsread.c, with
+ * its subtask and ECBs, cannot compile on the host.
+ * ====================================================================
+ *
+ * Runs on host via `make test-host`.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mbtcheck.h>
+
+#include "../../src/rdahead.c"
+
+#define BLKSIZE     27998
+#define NBLK_MAX    400
+
+/* ---- the simulation ---- */
+
+struct sim {
+	int             nblk;
+	double          disk[NBLK_MAX];         /* ms to read block i */
+	double          net[NBLK_MAX];          /* ms to send block i */
+	int             fail_at;                /* read that fails, -1 none */
+
+	double          t_read;                 /* the reader's clock */
+	double          t_send;                 /* the sender's clock */
+	unsigned long   both_waiting;           /* would be a hang */
+	unsigned long   turns;
+	int             received;               /* blocks the sender took */
+	int             bad;                    /* out of order or damaged */
+	int             end;                    /* what ended the sender */
+};
+
+static unsigned char bufs[RDAHEAD_NBUF][BLKSIZE];
+
+/* block i: its length and every byte tell which block it is */
+static size_t
+block_len(int i)
+{
+	return BLKSIZE - (size_t) (i % 7) * 80;
+}
+
+static int
+block_ok(const unsigned char *p, size_t len, int i)
+{
+	size_t j;
+
+	if (len != block_len(i)) {
+		return 0;
+	}
+	for (j = 0; j < len; j += 997) {
+		if (p[j] != (unsigned char) (i * 31 + 7)) {
+			return 0;
+		}
+	}
+	return p[len - 1] == (unsigned char) (i * 31 + 7);
+}
+
+static double
+dmax(double a, double b)
+{
+	return a > b ? a : b;
+}
+
+/* Both sides to the end. Each turn goes to the side whose clock is behind
+   and is not waiting; a wait lasts until the other side's next post. */
+static double
+simulate(struct sim *s)
+{
+	RDAHEAD ra;
+	unsigned char *fillbuf = NULL;
+	const unsigned char *blk;
+	size_t len;
+	int reading = 0;        /* a read is under way, done at t_read */
+	int next_read = 0;
+	int reader_done = 0;
+	int reader_wait = 0;
+	int holding = 0;        /* a block is being sent, done at t_send */
+	int sender_wait = 0;
+	int rc;
+
+	rdahead_init(&ra, bufs[0], bufs[1], BLKSIZE);
+	s->t_read = 0;
+	s->t_send = 0;
+	s->both_waiting = 0;
+	s->turns = 0;
+	s->received = 0;
+	s->bad = 0;
+	s->end = RDA_WAIT;
+
+	while (s->end == RDA_WAIT && s->turns++ < 100000) {
+		int reader_turn;
+
+		if (reader_wait && sender_wait) {
+			s->both_waiting++;
+			break;
+		}
+		if (reader_done || reader_wait) {
+			reader_turn = 0;
+		} else if (sender_wait) {
+			reader_turn = 1;
+		} else {
+			reader_turn = s->t_read <= s->t_send;
+		}
+
+		if (reader_turn) {
+			if (reading) {
+				if (next_read == s->fail_at) {
+					rdahead_filled(&ra, -1);
+					reader_done = 1;
+				} else {
+					len = block_len(next_read);
+					memset(fillbuf, (unsigned char) (next_read * 31 + 7), len);
+					rdahead_filled(&ra, (long) len);
+					next_read++;
+				}
+				reading = 0;
+				/* the post: a waiting sender goes on from now */
+				if (sender_wait) {
+					sender_wait = 0;
+					s->t_send = dmax(s->t_send, s->t_read);
+				}
+				continue;
+			}
+			rc = rdahead_slot(&ra, &fillbuf);
+			if (rc == RDA_WAIT) {
+				reader_wait = 1;
+			} else if (rc == 0) {
+				reader_done = 1;
+			} else if (next_read == s->nblk) {
+				/* the read that finds the end takes no time here */
+				rdahead_filled(&ra, 0);
+				reader_done = 1;
+				if (sender_wait) {
+					sender_wait = 0;
+					s->t_send = dmax(s->t_send, s->t_read);
+				}
+			} else {
+				reading = 1;
+				s->t_read += s->disk[next_read];
+			}
+			continue;
+		}
+
+		if (holding) {
+			rdahead_release(&ra);
+			holding = 0;
+			if (reader_wait) {
+				reader_wait = 0;
+				s->t_read = dmax(s->t_read, s->t_send);
+			}
+			continue;
+		}
+		rc = rdahead_take(&ra, &blk, &len);
+		if (rc == RDA_WAIT) {
+			sender_wait = 1;
+		} else if (rc == 1) {
+			if (!block_ok(blk, len, s->received)) {
+				s->bad++;
+			}
+			s->t_send += s->net[s->received];
+			s->received++;
+			holding = 1;
+		} else {
+			s->end = rc;
+		}
+	}
+
+	return dmax(s->t_read, s->t_send);
+}
+
+static void
+latencies(struct sim *s, int nblk, double disk, double net, double jitter)
+{
+	int i;
+
+	s->nblk = nblk;
+	s->fail_at = -1;
+	for (i = 0; i < nblk; i++) {
+		s->disk[i] = disk * (1.0 + jitter * ((double) rand() / RAND_MAX - 0.5));
+		s->net[i] = net * (1.0 + jitter * ((double) rand() / RAND_MAX - 0.5));
+	}
+}
+
+int
+main(void)
+{
+	static struct sim s;
+	RDAHEAD ra;
+	unsigned char *b;
+	unsigned char *b2;
+	const unsigned char *blk;
+	size_t len;
+
+	srand(41);
+
+	printf("\n--- the hand-over ---\n");
+	{
+		rdahead_init(&ra, bufs[0], bufs[1], BLKSIZE);
+		CHECK_EQ(rdahead_take(&ra, &blk, &len), RDA_WAIT,
+			"nothing read yet: the sender waits");
+		CHECK(rdahead_slot(&ra, &b) == 1 && b == bufs[0],
+			"the reader gets the first buffer");
+		CHECK(rdahead_slot(&ra, &b2) == 1 && b2 == bufs[0],
+			"and the same one until it is filled");
+		rdahead_filled(&ra, 100);
+		CHECK(rdahead_slot(&ra, &b) == 1 && b == bufs[1], "then the second");
+		rdahead_filled(&ra, 200);
+		CHECK_EQ(rdahead_slot(&ra, &b), RDA_WAIT,
+			"both full: the reader waits");
+
+		CHECK(rdahead_take(&ra, &blk, &len) == 1 && blk == bufs[0]
+			&& len == 100, "the sender takes the first block read");
+		CHECK(rdahead_take(&ra, &blk, &len) == 1 && blk == bufs[0],
+			"and is given it again until it releases it");
+		CHECK_EQ(rdahead_slot(&ra, &b), RDA_WAIT,
+			"taken is not released: the reader still waits");
+		rdahead_release(&ra);
+		CHECK(rdahead_slot(&ra, &b) == 1 && b == bufs[0],
+			"released: the reader has it back");
+		CHECK_EQ(rdahead_release(&ra), 0,
+			"a release without a take gives nothing back");
+		CHECK(rdahead_take(&ra, &blk, &len) == 1 && blk == bufs[1]
+			&& len == 200, "and the block read next is still there");
+		CHECK_EQ(ra.blocks, 2, "two blocks filled");
+	}
+
+	printf("\n--- the end, a failure, a stop ---\n");
+	{
+		rdahead_init(&ra, bufs[0], bufs[1], BLKSIZE);
+		rdahead_slot(&ra, &b);
+		rdahead_filled(&ra, 50);
+		rdahead_slot(&ra, &b);
+		rdahead_filled(&ra, 0);
+		CHECK_EQ(rdahead_slot(&ra, &b), 0, "after the end the reader is done");
+		CHECK_EQ(rdahead_take(&ra, &blk, &len), 1, "the block before the end");
+		rdahead_release(&ra);
+		CHECK_EQ(rdahead_take(&ra, &blk, &len), 0, "then the end");
+		CHECK_EQ(rdahead_take(&ra, &blk, &len), 0, "and it stays the end");
+		CHECK_EQ(rdahead_slot(&ra, &b), 0, "for the reader as well");
+
+		rdahead_init(&ra, bufs[0], bufs[1], BLKSIZE);
+		rdahead_slot(&ra, &b);
+		rdahead_filled(&ra, 50);
+		rdahead_slot(&ra, &b);
+		rdahead_filled(&ra, -1);
+		CHECK_EQ(rdahead_take(&ra, &blk, &len), 1,
+			"a failed read: the block before it still arrives");
+		rdahead_release(&ra);
+		CHECK_EQ(rdahead_take(&ra, &blk, &len), -1, "then the failure");
+		CHECK_EQ(rdahead_slot(&ra, &b), 0, "and the reader is done");
+
+		rdahead_init(&ra, bufs[0], bufs[1], BLKSIZE);
+		rdahead_slot(&ra, &b);
+		rdahead_filled(&ra, 50);
+		rdahead_stop(&ra);
+		CHECK_EQ(rdahead_slot(&ra, &b), 0,
+			"the sender stopped: the reader's next slot is none");
+	}
+
+	printf("\n--- simulated ---\n");
+	{
+		int bad = 0;
+		int hang = 0;
+		int k;
+
+		for (k = 0; k < 200; k++) {
+			double d = 1.0 + rand() % 20;
+			double n = 1.0 + rand() % 20;
+
+			latencies(&s, 1 + rand() % 60, d, n, 1.5);
+			simulate(&s);
+			bad += s.bad || s.received != s.nblk || s.end != 0;
+			hang += s.both_waiting != 0;
+		}
+		CHECK_EQ(bad, 0, "200 random runs: every block once, whole, in order");
+		CHECK_EQ(hang, 0, "and never both sides waiting");
+
+		latencies(&s, 0, 1, 1, 0);
+		simulate(&s);
+		CHECK(s.end == 0 && s.received == 0, "an empty data set: the end at once");
+
+		latencies(&s, 50, 2, 3, 0.5);
+		s.fail_at = 17;
+		simulate(&s);
+		CHECK(s.end == -1 && s.received == 17 && s.bad == 0,
+			"a read failing at block 17: 17 blocks, then the failure");
+	}
+
+	printf("\n--- in line vs read ahead, %d blocks of %d ---\n",
+		NBLK_MAX, BLKSIZE);
+	{
+		static const struct {
+			const char *name;
+			double disk;
+			double net;
+			double jitter;
+		} mix[] = {
+			{ "disk-bound", 12.0, 5.0, 0.0 },
+			{ "network-bound", 4.0, 11.0, 0.0 },
+			{ "balanced", 8.0, 8.0, 0.0 },
+			{ "jittered", 8.0, 8.0, 1.8 },
+		};
+		double mb = (double) NBLK_MAX * BLKSIZE / (1024.0 * 1024.0);
+		size_t m;
+		int i;
+
+		for (m = 0; m < sizeof(mix) / sizeof(mix[0]); m++) {
+			double sum_d = 0;
+			double sum_n = 0;
+			double max_d = 0;
+			double max_n = 0;
+			double t;
+			char what[80];
+
+			latencies(&s, NBLK_MAX, mix[m].disk, mix[m].net, mix[m].jitter);
+			for (i = 0; i < NBLK_MAX; i++) {
+				sum_d += s.disk[i];
+				sum_n += s.net[i];
+				max_d = dmax(max_d, s.disk[i]);
+				max_n = dmax(max_n, s.net[i]);
+			}
+			t = simulate(&s);
+
+			printf("  %-14s in line %6.0f ms (%4.1f MB/s), read ahead %6.0f ms "
+				"(%4.1f MB/s)\n", mix[m].name, sum_d + sum_n,
+				mb * 1000.0 / (sum_d + sum_n), t, mb * 1000.0 / t);
+			sprintf(what, "%s: at most the slower side plus one block",
+				mix[m].name);
+			if (mix[m].jitter == 0) {
+				CHECK(s.received == NBLK_MAX && s.bad == 0
+					&& t <= dmax(sum_d, sum_n) + max_d + max_n + 1e-6, what);
+			} else {
+				sprintf(what, "%s: a quarter under the reads in line",
+					mix[m].name);
+				CHECK(s.received == NBLK_MAX && s.bad == 0
+					&& t < 0.75 * (sum_d + sum_n), what);
+			}
+		}
+	}
+
+	return mbt_test_summary("TSTRDAH");
+}
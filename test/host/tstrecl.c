@@ -16,6 +16,11 @@
  * a terminated empty line is emitted as a single blank (libc370 pads a short
  * record out to LRECL).
  *
+ * recline_feed() frames a whole chunk at once -- memchr() for the
+ * terminators, one copy per run -- and has to frame exactly as the byte
+ * loop does. The last two sections cross-check the two on random bodies cut
+ * into random chunks, and time them.
+ *
  * ====================================================================
  * This test drives the REAL state machine: src/reclines.c is #included
  * below, so a later refactor stays covered. dsapi.c itself cannot compile
@@ -34,6 +39,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include <mbtcheck.h>
 
@@ -134,6 +140,141 @@ static int canary_intact(size_t content_max)
 static char	line80[80];
 static char	line81[81];
 
+/* ---- recline_feed() against recline_put() ---------------------------------
+ * Both write what they frame into a TRACE: every record's length and bytes,
+ * back to back, so two framings are equal when their traces are. */
+
+#define TRACE_MAX	(1024 * 1024)
+#define BENCH_BYTES	(8 * 1024 * 1024)
+
+typedef struct {
+	unsigned char	*p;
+	size_t		 len;
+	unsigned long	 nrec;
+	int		 stop_at;	/* emit fails on this record, 0 never */
+} TRACE;
+
+static void trace_rec(TRACE *t, const char *rec, size_t rec_len)
+{
+	if (t->len + rec_len + 2 <= TRACE_MAX) {
+		t->p[t->len++] = (unsigned char)(rec_len >> 8);
+		t->p[t->len++] = (unsigned char)rec_len;
+		memcpy(t->p + t->len, rec, rec_len);
+		t->len += rec_len;
+	}
+	t->nrec++;
+}
+
+static int trace_emit(void *ctx, char *rec, size_t rec_len)
+{
+	TRACE *t = ctx;
+
+	trace_rec(t, rec, rec_len);
+	return t->stop_at && (int)t->nrec == t->stop_at ? -1 : 0;
+}
+
+/* The byte loop of the handlers, into a trace. */
+static void frame_put(RECLINE *rl, const char *b, size_t n, TRACE *t)
+{
+	char   *rec;
+	size_t  rec_len;
+	size_t  i;
+
+	for (i = 0; i < n; i++) {
+		if (recline_put(rl, b[i], &rec, &rec_len) == RECLINE_RECORD) {
+			trace_rec(t, rec, rec_len);
+		}
+	}
+}
+
+static void frame_end(RECLINE *rl, TRACE *t)
+{
+	char   *rec;
+	size_t  rec_len;
+
+	if (recline_flush(rl, &rec, &rec_len)) {
+		trace_rec(t, rec, rec_len);
+	}
+}
+
+/* A body of lines around `width` long: content, blank lines, every
+   terminator, and runs of them. */
+static size_t random_body(char *b, size_t max, size_t width)
+{
+	static const char term[][3] = { "\x0a", "\x0d", "\x0d\x0a", "\x0a\x0d" };
+	size_t n = 0;
+
+	while (n + width * 2 + 4 < max) {
+		size_t len = (size_t)rand() % (width * 2 + 1);
+		const char *t;
+
+		if (rand() % 8 == 0) {
+			len = 0;
+		}
+		while (len--) {
+			b[n++] = (char)('!' + rand() % 90);
+		}
+		t = term[rand() % 4];
+		while (*t) {
+			b[n++] = *t++;
+		}
+	}
+	/* sometimes no terminator at the end */
+	if (rand() % 2) {
+		b[n++] = 'Z';
+	}
+	return n;
+}
+
+/* The handlers' old byte loop and recline_feed(), timed over one body. */
+static void bench(const char *body, size_t n, size_t width, TRACE *ta,
+	TRACE *tb)
+{
+	static char buf_a[256];
+	static char buf_b[256];
+	RECLINE ra;
+	RECLINE rb;
+	const int reps = 5;
+	const size_t chunk = 4096;
+	int rep;
+	size_t off;
+	clock_t t0;
+	double t_put;
+	double t_feed;
+	double mb = (double)n / (1024.0 * 1024.0);
+
+	t0 = clock();
+	for (rep = 0; rep < reps; rep++) {
+		ta->len = 0;
+		ta->nrec = 0;
+		recline_init(&ra, buf_a, width);
+		frame_put(&ra, body, n, ta);
+		frame_end(&ra, ta);
+	}
+	t_put = (double)(clock() - t0) / CLOCKS_PER_SEC / reps;
+
+	t0 = clock();
+	for (rep = 0; rep < reps; rep++) {
+		tb->len = 0;
+		tb->nrec = 0;
+		recline_init(&rb, buf_b, width);
+		for (off = 0; off < n; off += chunk) {
+			recline_feed(&rb, body + off,
+				n - off < chunk ? n - off : chunk, trace_emit, tb);
+		}
+		frame_end(&rb, tb);
+	}
+	t_feed = (double)(clock() - t0) / CLOCKS_PER_SEC / reps;
+
+	CHECK(ta->nrec == tb->nrec && ta->len == tb->len
+		&& memcmp(ta->p, tb->p, ta->len) == 0,
+		"benchmark: the same records both ways");
+	printf("  content_max %lu: recline_put %.0f MB/s, recline_feed %.0f MB/s "
+		"(%.1fx)\n", (unsigned long)width, mb / t_put, mb / t_feed,
+		t_put / t_feed);
+	CHECK(t_feed < t_put, "benchmark: recline_feed is faster");
+}
+
 int main(void)
 {
 	static const char blank = 0x20;		/* ASCII, as the record carries it */
@@ -278,5 +419,104 @@ int main(void)
 	feed(stream, 1);
 	CHECK_EQ(g_toolong, 1, "content_max=4: the fifth column is dropped");
 
+	/* 13. recline_feed() frames as recline_put() does: random bodies, random
+	 *     record lengths, cut into random chunks -- so a chunk boundary falls
+	 *     inside content, between CR and LF, and on either side of a blank
+	 *     line -- and the two mixed on one stream. */
+	{
+		static char	body[64 * 1024];
+		static char	buf_a[128 + 8];
+		static char	buf_b[128 + 8];
+		static unsigned char trace_a[TRACE_MAX];
+		static unsigned char trace_b[TRACE_MAX];
+		TRACE		ta = { trace_a, 0, 0, 0 };
+		TRACE		tb = { trace_b, 0, 0, 0 };
+		RECLINE		ra;
+		RECLINE		rb;
+		int		bad = 0;
+		int		overrun = 0;
+		int		round;
+
+		srand(233);
+		for (round = 0; round < 2000; round++) {
+			size_t width = 1 + (size_t)rand() % 128;
+			size_t n = random_body(body,
+				sizeof(body) / (1 + (size_t)(round % 8)), width);
+			size_t off = 0;
+			size_t i;
+
+			memset(buf_b, CANARY, sizeof(buf_b));
+			ta.len = ta.nrec = 0;
+			tb.len = tb.nrec = 0;
+			recline_init(&ra, buf_a, width);
+			recline_init(&rb, buf_b, width);
+
+			frame_put(&ra, body, n, &ta);
+			frame_end(&ra, &ta);
+
+			while (off < n) {
+				size_t c = 1 + (size_t)rand() % (round % 3 ? 300 : 3);
+
+				if (c > n - off) {
+					c = n - off;
+				}
+				if (round % 5 == 0 && rand() % 4 == 0) {
+					/* a byte through the old call, mid-stream */
+					frame_put(&rb, body + off, 1, &tb);
+					c = 1;
+				} else {
+					recline_feed(&rb, body + off, c, trace_emit, &tb);
+				}
+				off += c;
+			}
+			frame_end(&rb, &tb);
+
+			bad += ta.nrec != tb.nrec || ta.len != tb.len
+				|| memcmp(trace_a, trace_b, ta.len) != 0
+				|| ra.truncated != rb.truncated
+				|| ra.pending_lf != rb.pending_lf;
+			for (i = width; i < sizeof(buf_b); i++) {
+				overrun += buf_b[i] != (char)CANARY;
+			}
+		}
+		CHECK_EQ(bad, 0, "feed vs put: 2000 random bodies in random chunks, "
+			"the same records and the same sticky flag");
+		CHECK_EQ(overrun, 0, "feed: nothing written past content_max");
+
+		/* a CRLF whose LF starts the next feed */
+		ta.len = ta.nrec = 0;
+		recline_init(&rb, buf_b, 80);
+		recline_feed(&rb, "AB" CR, 3, trace_emit, &ta);
+		recline_feed(&rb, LF "C" LF, 3, trace_emit, &ta);
+		CHECK_EQ(ta.nrec, 2, "feed: a CRLF split across two feeds is one end");
+
+		/* an emit that fails stops the feed there */
+		tb.len = tb.nrec = 0;
+		tb.stop_at = 2;
+		recline_init(&rb, buf_b, 80);
+		CHECK_EQ(recline_feed(&rb, "A" LF "B" LF "C" LF, 6, trace_emit, &tb),
+			-1, "feed: a failing emit is the result");
+		CHECK_EQ(tb.nrec, 2, "feed: and no record after it is framed");
+		tb.stop_at = 0;
+
+		/* 14. throughput: an 8 MB body of text lines, the byte loop against
+		 *     4 K feeds */
+		printf("\n--- recline_put vs recline_feed, 8 MB ---\n");
+		{
+			static char big[BENCH_BYTES + 512];
+			size_t n = 0;
+
+			while (n < BENCH_BYTES) {
+				size_t len = 20 + (size_t)rand() % 60;
+
+				memset(big + n, 'x', len);
+				n += len;
+				big[n++] = 0x0d;
+				big[n++] = 0x0a;
+			}
+			bench(big, n, 80, &ta, &tb);
+		}
+	}
+
 	return mbt_test_summary("TSTRECL");
 }
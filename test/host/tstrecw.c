@@ -0,0 +1,714 @@
+/*
+ * tstrecw.c - the record writer behind a data set or member PUT: records
+ * gathered into a BLKSIZE buffer (src/recwrite.c) instead of an fflush()
+ * after each one.
+ *
+ * What a PUT writes is what the next GET returns, so the writer may change
+ * how many writes reach the access method and nothing else:
+ *
+ *   1. The stream it hands the sink is the records in order, each followed
+ *      by its delimiter -- the same bytes, at every buffer size, however the
+ *      records fall across the buffer's end.
+ *   2. The sink is called only when the next record does not fit, and at
+ *      recwrite_flush(); never with an empty buffer.
+ *   3. A zero-length record is still a record: with a delimiter, a line of
+ *      its own (the blank record of issue #233). Without one it adds nothing.
+ *   4. A record larger than the buffer goes through on its own, after what
+ *      was buffered and before what follows.
+ *   5. A sink that fails fails the put or flush that called it.
+ *   6. The stamp the writer folds as the records go in (recwrite_stamp()) is
+ *      the one dataset_etag() gets reading the data set back: F, FB, V, VB
+ *      and U, text and binary, over random bodies fed in random pieces
+ *      through the real framing (src/reclines.c). A short fixed record whose
+ *      padding is not known gives the stamp up rather than guess.
+ *   7. Through a model of the text output stream -- '\n' ends a record,
+ *      fflush() ends a record and writes the block it is in, a full block is
+ *      written -- FB80 at BLKSIZE 27920: the old per-record flush against the
+ *      writer, as blocks written and MB/s through the model.
+ *
+ * ====================================================================
+ * This test drives the REAL implementation: src/recwrite.c is #included
+ * below, with src/reclines.c and src/etag.c. The access-method model is the
+ * test's own, and so is the few lines of write_record() that decide which
+ * record goes through the writer and which past it; write_record() itself
+ * cannot compile on the host.
+ * ====================================================================
+ *
+ * Runs on host via `make test-host`.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <mbtcheck.h>
+
+#include "../../src/etag.c"
+#include "../../src/reclines.c"
+#include "../../src/recwrite.c"
+
+static char msg[160];
+
+#define NREC        5000
+#define LRECL       80
+#define BLKSIZE     27920
+#define REC_MAX     200
+#define STREAM_MAX  (NREC * (REC_MAX + 1) + 16)
+
+/* ---- a sink that keeps everything, and can be told to fail ---- */
+
+struct keep {
+	unsigned char   *data;
+	size_t          len;
+	unsigned long   calls;
+	unsigned long   empty;          /* calls with len 0 */
+	int             fail_at;        /* call number that fails, 0 never */
+};
+
+static int
+keep_sink(void *ctx, const void *data, size_t len)
+{
+	struct keep *k = ctx;
+
+	k->calls++;
+	if (len == 0) {
+		k->empty++;
+	}
+	if (k->fail_at && (int) k->calls == k->fail_at) {
+		return -1;
+	}
+	memcpy(k->data + k->len, data, len);
+	k->len += len;
+	return 0;
+}
+
+/* ---- the text output stream of an FB data set, as far as blocks go ---- */
+
+struct qsam {
+	unsigned char   blk[BLKSIZE];
+	size_t          blen;           /* bytes in the block being built */
+	size_t          rlen;           /* bytes of the record being built */
+	int             open;           /* a record has been started */
+	unsigned long   blocks;
+	unsigned long   records;
+	unsigned char   out[(NREC + 1) * LRECL];
+	size_t          olen;           /* every block written, back to back */
+};
+
+static void
+qsam_block(struct qsam *q)
+{
+	if (q->blen == 0) {
+		return;
+	}
+	memcpy(q->out + q->olen, q->blk, q->blen);
+	q->olen += q->blen;
+	q->blen = 0;
+	q->blocks++;
+}
+
+/* the record ends: padded to LRECL, a full block goes out */
+static void
+qsam_endrec(struct qsam *q)
+{
+	memset(q->blk + q->blen + q->rlen, ' ', LRECL - q->rlen);
+	q->blen += LRECL;
+	q->rlen = 0;
+	q->open = 0;
+	q->records++;
+	if (q->blen + LRECL > BLKSIZE) {
+		qsam_block(q);
+	}
+}
+
+static size_t
+qsam_write(struct qsam *q, const unsigned char *p, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		if (p[i] == '\n') {
+			qsam_endrec(q);
+			continue;
+		}
+		if (q->rlen < LRECL) {
+			q->blk[q->blen + q->rlen++] = p[i];
+		}
+		q->open = 1;
+	}
+	return len;
+}
+
+/* fflush(): the record ends, and the block it is in is written, short */
+static void
+qsam_flush(struct qsam *q)
+{
+	if (q->open) {
+		qsam_endrec(q);
+	}
+	qsam_block(q);
+}
+
+static int
+qsam_sink(void *ctx, const void *data, size_t len)
+{
+	return qsam_write(ctx, data, len) == len ? 0 : -1;
+}
+
+static void
+qsam_init(struct qsam *q)
+{
+	q->blen = 0;
+	q->rlen = 0;
+	q->open = 0;
+	q->blocks = 0;
+	q->records = 0;
+	q->olen = 0;
+}
+
+/* ---- the records ---- */
+
+static unsigned char recs[NREC][REC_MAX];
+static size_t lens[NREC];
+
+static void
+random_records(size_t minlen, size_t maxlen)
+{
+	int i;
+	size_t j;
+
+	for (i = 0; i < NREC; i++) {
+		lens[i] = minlen + (size_t) rand() % (maxlen - minlen + 1);
+		for (j = 0; j < lens[i]; j++) {
+			/* anything but the delimiter */
+			recs[i][j] = (unsigned char) ('!' + rand() % 90);
+		}
+	}
+}
+
+/* the records as the stream should carry them */
+static size_t
+expect_stream(unsigned char *out, int nl)
+{
+	size_t o = 0;
+	int i;
+
+	for (i = 0; i < NREC; i++) {
+		memcpy(out + o, recs[i], lens[i]);
+		o += lens[i];
+		if (nl != RECWRITE_NONL) {
+			out[o++] = (unsigned char) nl;
+		}
+	}
+	return o;
+}
+
+/* ---- a data set of any RECFM, and what reading it back stamps ---- */
+
+#define DS_MAXREC       6144
+#define EBCDIC_BLANK    0x40
+
+struct ds {
+	size_t          fixlen;         /* LRECL when fixed, else 0 */
+	int             text;           /* the stream is delimited by '\n' */
+	unsigned char   cur[DS_MAXREC];
+	size_t          clen;
+	unsigned long   records;
+	ETAGCTX         reread;         /* dataset_etag() over what is stored */
+};
+
+static void
+ds_init(struct ds *d, size_t fixlen, int text)
+{
+	d->fixlen = fixlen;
+	d->text = text;
+	d->clen = 0;
+	d->records = 0;
+	etag_init(&d->reread);
+}
+
+/* the record ends: a short fixed one is padded, blanks in text mode and
+   whatever the library likes in binary -- 0x00 here */
+static void
+ds_endrec(struct ds *d)
+{
+	size_t len = d->clen;
+
+	if (d->fixlen && len < d->fixlen) {
+		memset(d->cur + len, d->text ? EBCDIC_BLANK : 0x00,
+			d->fixlen - len);
+		len = d->fixlen;
+	}
+	etag_update(&d->reread, d->cur, len);
+	d->clen = 0;
+	d->records++;
+}
+
+/* the writer's sink: a text stream, or binary F records end to end */
+static int
+ds_sink(void *ctx, const void *data, size_t len)
+{
+	struct ds *d = ctx;
+	const unsigned char *p = data;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		if (d->text && p[i] == '\n') {
+			ds_endrec(d);
+			continue;
+		}
+		d->cur[d->clen++] = p[i];
+		if (!d->text && d->clen == d->fixlen) {
+			ds_endrec(d);
+		}
+	}
+	return 0;
+}
+
+/* a record written past the writer and ended with a flush */
+static void
+ds_record(struct ds *d, const void *rec, size_t len)
+{
+	memcpy(d->cur, rec, len);
+	d->clen = len;
+	ds_endrec(d);
+}
+
+/* ---- a PUT: put_body_sink() and the writer's half of write_record() ---- */
+
+struct put {
+	RECWRITE        rw;
+	struct ds       *ds;
+	size_t          fixlen;
+	size_t          eff;            /* binary records are cut this long */
+	int             pad;            /* binary: the last one padded to eff */
+	unsigned char   rec[DS_MAXREC];
+	size_t          pos;
+};
+
+static int
+put_text(void *ctx, char *rec, size_t len)
+{
+	struct put *p = ctx;
+
+	return recwrite_put(&p->rw, rec, len);
+}
+
+static void
+put_binary(struct put *p, const unsigned char *rec, size_t len)
+{
+	if (p->fixlen && len == p->fixlen) {
+		recwrite_put(&p->rw, rec, len);
+		return;
+	}
+	recwrite_flush(&p->rw);
+	recwrite_note(&p->rw, rec, len);
+	ds_record(p->ds, rec, len);
+}
+
+static void
+put_binary_feed(struct put *p, const unsigned char *data, size_t len)
+{
+	size_t n;
+
+	while (len > 0) {
+		n = p->eff - p->pos;
+		if (n > len) n = len;
+		memcpy(p->rec + p->pos, data, n);
+		p->pos += n;
+		data += n;
+		len -= n;
+		if (p->pos == p->eff) {
+			put_binary(p, p->rec, p->pos);
+			p->pos = 0;
+		}
+	}
+}
+
+/* A text body: lines of every length from blank to past the record, ended
+   by LF, CRLF or CR, the last one perhaps not ended at all. */
+static size_t
+text_body(char *out, size_t max, size_t content_max)
+{
+	size_t o = 0;
+	int lines = rand() % 60;
+	int l;
+	size_t j;
+	size_t n;
+
+	for (l = 0; l < lines; l++) {
+		n = (size_t) rand() % (content_max + 12);
+		if (rand() % 8 == 0) n = 0;
+		if (rand() % 8 == 0) n = content_max;
+		if (o + n + 2 > max) break;
+		for (j = 0; j < n; j++) {
+			out[o++] = (char) (' ' + rand() % 95);
+		}
+		switch (rand() % 4) {
+		case 0:  out[o++] = '\r'; out[o++] = '\n'; break;
+		case 1:  out[o++] = '\r'; break;
+		default: out[o++] = '\n'; break;
+		}
+	}
+	if (rand() % 2 && o + 20 < max) {
+		for (j = 0; j < 20; j++) {
+			out[o++] = 'T';
+		}
+	}
+	return o;
+}
+
+int
+main(void)
+{
+	static unsigned char buf[BLKSIZE];
+	static unsigned char want[STREAM_MAX];
+	static unsigned char got[STREAM_MAX];
+	static struct qsam q;
+	struct keep k;
+	RECWRITE rw;
+	size_t wlen;
+	int i;
+
+	srand(13);
+
+	printf("\n--- the stream ---\n");
+	{
+		size_t sizes[] = { 1, 7, 80, 81, 6233, BLKSIZE };
+		size_t s;
+		int nl;
+
+		random_records(0, REC_MAX);
+		for (nl = 0; nl < 2; nl++) {
+			int delim = nl ? '\n' : RECWRITE_NONL;
+			int bad = 0;
+
+			wlen = expect_stream(want, delim);
+			for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+				memset(&k, 0, sizeof(k));
+				k.data = got;
+				recwrite_init(&rw, buf, sizes[s], delim, keep_sink, &k);
+				for (i = 0; i < NREC; i++) {
+					bad += recwrite_put(&rw, recs[i], lens[i]) != 0;
+				}
+				bad += recwrite_flush(&rw) != 0;
+				bad += k.len != wlen || memcmp(got, want, wlen) != 0;
+				bad += k.empty != 0;
+				bad += rw.records != NREC || rw.writes != k.calls;
+			}
+			CHECK_EQ(bad, 0, nl ? "text: records in order, each with its "
+				"'\\n', at every buffer size"
+				: "binary: records in order, back to back, at every "
+				"buffer size");
+		}
+	}
+
+	printf("\n--- when the sink is called ---\n");
+	{
+		memset(&k, 0, sizeof(k));
+		k.data = got;
+		recwrite_init(&rw, buf, 10, '\n', keep_sink, &k);
+		recwrite_put(&rw, "abcd", 4);
+		recwrite_put(&rw, "efgh", 4);
+		CHECK_EQ(k.calls, 0, "two records that fit: nothing written yet");
+		recwrite_put(&rw, "ij", 2);
+		CHECK(k.calls == 1 && k.len == 10, "the third does not fit: the "
+			"buffer goes out, whole");
+		recwrite_flush(&rw);
+		CHECK(k.calls == 2 && k.len == 13, "the flush writes the rest");
+		recwrite_flush(&rw);
+		CHECK_EQ(k.calls, 2, "a second flush has nothing to write");
+		CHECK(memcmp(got, "abcd\nefgh\nij\n", 13) == 0, "the bytes in order");
+
+		memset(&k, 0, sizeof(k));
+		k.data = got;
+		recwrite_init(&rw, buf, 8, '\n', keep_sink, &k);
+		recwrite_put(&rw, "ab", 2);
+		recwrite_put(&rw, "0123456789", 10);
+		recwrite_put(&rw, "cd", 2);
+		recwrite_flush(&rw);
+		CHECK(k.len == 17 && memcmp(got, "ab\n0123456789\ncd\n", 17) == 0,
+			"a record over the buffer: after what was buffered, before "
+			"what follows");
+		CHECK_EQ(k.empty, 0, "and the sink never sees an empty write");
+
+		memset(&k, 0, sizeof(k));
+		k.data = got;
+		recwrite_init(&rw, NULL, 0, '\n', keep_sink, &k);
+		recwrite_put(&rw, "ab", 2);
+		recwrite_put(&rw, "", 0);
+		CHECK(k.len == 4 && memcmp(got, "ab\n\n", 4) == 0,
+			"no buffer at all: every record straight through");
+	}
+
+	printf("\n--- zero-length records ---\n");
+	{
+		memset(&k, 0, sizeof(k));
+		k.data = got;
+		recwrite_init(&rw, buf, sizeof(buf), '\n', keep_sink, &k);
+		recwrite_put(&rw, "", 0);
+		recwrite_put(&rw, "x", 1);
+		recwrite_put(&rw, "", 0);
+		recwrite_flush(&rw);
+		CHECK(k.len == 4 && memcmp(got, "\nx\n\n", 4) == 0,
+			"text: a blank record is a line of its own");
+
+		qsam_init(&q);
+		recwrite_init(&rw, buf, sizeof(buf), '\n', qsam_sink, &q);
+		recwrite_put(&rw, "", 0);
+		recwrite_flush(&rw);
+		qsam_flush(&q);
+		CHECK(q.records == 1 && q.olen == LRECL
+			&& q.out[0] == ' ' && q.out[LRECL - 1] == ' ',
+			"and reaches the data set as one blank record (issue #233)");
+
+		memset(&k, 0, sizeof(k));
+		k.data = got;
+		recwrite_init(&rw, buf, sizeof(buf), RECWRITE_NONL, keep_sink, &k);
+		recwrite_put(&rw, "", 0);
+		recwrite_flush(&rw);
+		CHECK(k.calls == 0 && rw.records == 1,
+			"binary: counted, and nothing to write");
+	}
+
+	printf("\n--- a failing sink ---\n");
+	{
+		memset(&k, 0, sizeof(k));
+		k.data = got;
+		k.fail_at = 1;
+		recwrite_init(&rw, buf, 8, '\n', keep_sink, &k);
+		CHECK_EQ(recwrite_put(&rw, "abcdef", 6), 0, "buffered: no write yet");
+		CHECK_EQ(recwrite_put(&rw, "gh", 2), -1,
+			"the write the next record forces fails the put");
+
+		memset(&k, 0, sizeof(k));
+		k.data = got;
+		k.fail_at = 1;
+		recwrite_init(&rw, buf, 8, '\n', keep_sink, &k);
+		recwrite_put(&rw, "ab", 2);
+		CHECK_EQ(recwrite_flush(&rw), -1, "a failed flush is -1");
+
+		memset(&k, 0, sizeof(k));
+		k.data = got;
+		k.fail_at = 2;
+		recwrite_init(&rw, buf, 4, '\n', keep_sink, &k);
+		CHECK_EQ(recwrite_put(&rw, "0123456789", 10), -1,
+			"a record over the buffer: its delimiter's write fails the put");
+	}
+
+	printf("\n--- FB80, BLKSIZE 27920: per-record flush vs the writer ---\n");
+	{
+		static unsigned char old_out[(NREC + 1) * LRECL];
+		size_t old_len;
+		unsigned long old_blocks;
+		unsigned long new_blocks;
+		const int reps = 50;
+		int rep;
+		clock_t t0;
+		double t_old;
+		double t_new;
+		double mb;
+
+		/* no empty records: a flush after nothing ends no record, which
+		   is why the blank record of #233 is written as a blank, not as
+		   nothing -- here it would only make the counts differ */
+		random_records(1, LRECL);
+		mb = 0;
+		for (i = 0; i < NREC; i++) {
+			mb += (double) lens[i];
+		}
+		mb = mb * reps / (1024.0 * 1024.0);
+
+		/* before: fwrite() the record, fflush() */
+		t0 = clock();
+		for (rep = 0; rep < reps; rep++) {
+			qsam_init(&q);
+			for (i = 0; i < NREC; i++) {
+				qsam_write(&q, recs[i], lens[i]);
+				qsam_flush(&q);
+			}
+		}
+		t_old = (double) (clock() - t0) / CLOCKS_PER_SEC;
+		old_blocks = q.blocks;
+		old_len = q.olen;
+		memcpy(old_out, q.out, old_len);
+
+		/* after: through the writer, one flush before the close */
+		t0 = clock();
+		for (rep = 0; rep < reps; rep++) {
+			qsam_init(&q);
+			recwrite_init(&rw, buf, BLKSIZE, '\n', qsam_sink, &q);
+			for (i = 0; i < NREC; i++) {
+				recwrite_put(&rw, recs[i], lens[i]);
+			}
+			recwrite_flush(&rw);
+			qsam_flush(&q);
+		}
+		t_new = (double) (clock() - t0) / CLOCKS_PER_SEC;
+		new_blocks = q.blocks;
+
+		CHECK(q.olen == old_len && memcmp(q.out, old_out, old_len) == 0
+			&& q.records == NREC,
+			"the same records in the data set both ways");
+		CHECK_EQ(old_blocks, NREC, "before: a block per record");
+		CHECK_EQ(new_blocks, (NREC + BLKSIZE / LRECL - 1) / (BLKSIZE / LRECL),
+			"after: full blocks of 349, one short one at the end");
+		printf("  %d records: %lu blocks before, %lu after\n",
+			NREC, old_blocks, new_blocks);
+		printf("  through the model: %.0f MB/s before, %.0f MB/s after\n",
+			t_old > 0 ? mb / t_old : 0.0, t_new > 0 ? mb / t_new : 0.0);
+	}
+
+	printf("\n--- the stamp of the records written ---\n");
+	{
+		static const struct {
+			const char *name;
+			size_t      lrecl;
+			size_t      blksize;
+			int         fixed;
+			int         variable;
+		} fmt[] = {
+			{ "F",  80,   80,    1, 0 },
+			{ "FB", 80,   3120,  1, 0 },
+			{ "V",  84,   88,    0, 1 },
+			{ "VB", 255,  6233,  0, 1 },
+			{ "U",  0,    6144,  0, 0 },
+		};
+		static struct ds d;
+		static struct put p;
+		static unsigned char blk[32760];
+		static char body[64 * 1024];
+		static char rbuf[DS_MAXREC];
+		char streamed[ETAG_SIZE];
+		char reread[ETAG_SIZE];
+		int f;
+		int text;
+
+		for (f = 0; f < (int) (sizeof(fmt) / sizeof(fmt[0])); f++) {
+			for (text = 1; text >= 0; text--) {
+				size_t cmax = fmt[f].variable ? fmt[f].lrecl - 4
+				    : fmt[f].lrecl ? fmt[f].lrecl : fmt[f].blksize;
+				size_t fixlen = fmt[f].fixed ? fmt[f].lrecl : 0;
+				unsigned long recs = 0;
+				int bad = 0;
+				int b;
+
+				for (b = 0; b < 40; b++) {
+					size_t len;
+					size_t o;
+
+					ds_init(&d, fixlen, text);
+					p.ds = &d;
+					p.fixlen = fixlen;
+					p.eff = fmt[f].lrecl ? fmt[f].lrecl
+					    : fmt[f].blksize;
+					p.pad = fmt[f].lrecl != 0;
+					p.pos = 0;
+					/* open_write_target() */
+					recwrite_init(&p.rw, blk, fmt[f].blksize,
+						text ? '\n' : RECWRITE_NONL, ds_sink, &d);
+					recwrite_stamp(&p.rw, fixlen,
+						text ? EBCDIC_BLANK : RECWRITE_NOFILL);
+
+					if (text) {
+						RECLINE rl;
+						char *rec;
+						size_t rlen;
+
+						len = text_body(body, sizeof(body), cmax);
+						recline_init(&rl, rbuf, cmax);
+						for (o = 0; o < len; ) {
+							size_t n = 1 + (size_t) rand() % 300;
+							if (n > len - o) n = len - o;
+							recline_feed(&rl, body + o, n, put_text, &p);
+							o += n;
+						}
+						if (recline_flush(&rl, &rec, &rlen)) {
+							put_text(&p, rec, rlen);
+						}
+					} else {
+						len = (size_t) rand() % (5 * p.eff + 7);
+						for (o = 0; o < len; o++) {
+							body[o] = (char) rand();
+						}
+						for (o = 0; o < len; ) {
+							size_t n = 1 + (size_t) rand() % 300;
+							if (n > len - o) n = len - o;
+							put_binary_feed(&p,
+								(unsigned char *) body + o, n);
+							o += n;
+						}
+						if (p.pos > 0) {
+							if (p.pad) {
+								memset(p.rec + p.pos, 0x00,
+									p.eff - p.pos);
+								p.pos = p.eff;
+							}
+							put_binary(&p, p.rec, p.pos);
+						}
+					}
+					/* close_write_target() */
+					recwrite_flush(&p.rw);
+
+					etag_final(&d.reread, reread, sizeof(reread));
+					if (recwrite_etag(&p.rw, streamed,
+						sizeof(streamed)) != 0
+					    || strcmp(streamed, reread) != 0) {
+						bad++;
+					}
+					recs += d.records;
+				}
+				snprintf(msg, sizeof(msg), "%s %s: 40 bodies, %lu records,"
+					" the streamed stamp is the re-read one",
+					fmt[f].name, text ? "text" : "binary", recs);
+				CHECK_EQ(bad, 0, msg);
+				printf("  %-2s %-6s %6lu records, %d stamps differ\n",
+					fmt[f].name, text ? "text" : "binary", recs, bad);
+			}
+		}
+
+		/* a short F record outside text mode: the padding is not known */
+		ds_init(&d, 80, 0);
+		p.ds = &d;
+		p.fixlen = 80;
+		recwrite_init(&p.rw, blk, 3120, RECWRITE_NONL, ds_sink, &d);
+		recwrite_stamp(&p.rw, 80, RECWRITE_NOFILL);
+		memset(body, 'R', 80);
+		put_binary(&p, (unsigned char *) body, 80);
+		put_binary(&p, (unsigned char *) body, 10);
+		recwrite_flush(&p.rw);
+		CHECK(recwrite_etag(&p.rw, streamed, sizeof(streamed)) == -1,
+			"a short binary F record gives the stamp up: read it back");
+
+		/* and not asked for: nothing to hand out */
+		recwrite_init(&p.rw, blk, 3120, '\n', ds_sink, &d);
+		recwrite_put(&p.rw, body, 80);
+		CHECK(recwrite_etag(&p.rw, streamed, sizeof(streamed)) == -1,
+			"a writer that was not stamping has no stamp");
+
+		/* the padding is in the stamp: FB text folded unpadded differs */
+		{
+			ETAGCTX a;
+			ETAGCTX b;
+			unsigned char padded[80];
+
+			etag_init(&a);
+			etag_update_padded(&a, "SHORT", 5, 80, EBCDIC_BLANK);
+			memset(padded, EBCDIC_BLANK, sizeof(padded));
+			memcpy(padded, "SHORT", 5);
+			etag_init(&b);
+			etag_update(&b, padded, sizeof(padded));
+			etag_final(&a, streamed, sizeof(streamed));
+			etag_final(&b, reread, sizeof(reread));
+			CHECK(strcmp(streamed, reread) == 0,
+				"etag_update_padded() is etag_update() of the padded record");
+			etag_init(&b);
+			etag_update(&b, "SHORT", 5);
+			etag_final(&b, reread, sizeof(reread));
+			CHECK(strcmp(streamed, reread) != 0,
+				"and not of the record as the client sent it");
+		}
+	}
+
+	return mbt_test_summary("TSTRECW");
+}
@@ -0,0 +1,552 @@
+/*
+ * tstrout.c - the const route trie must dispatch exactly as add_route() did.
+ *
+ * mvsMF used to rebuild its router in main() on every request -- httpd
+ * re-LINKs the module each time -- with one add_route() per endpoint, and
+ * then found the handler by trying every pattern in turn. The table is
+ * compile-time data now: route definitions plus a hand-written trie in
+ * src/routes.c. A hand-written trie can drift from the routes it is meant to
+ * spell, and a drifted route answers 404 or, worse, the wrong handler. So:
+ *
+ *   1. the trie, read back edge by edge, spells every definition exactly
+ *      once, with the definition's method;
+ *   2. every route is reached by a path made from its own pattern;
+ *   3. for a corpus of edge cases and a large pseudo-random sample, the trie
+ *      picks the same route the old first-registered-wins matcher picks
+ *      (that matcher is reproduced below as the oracle);
+ *   4. the same walk yields the path variables as spans of the path, and
+ *      once terminated in place (rt_split) they read exactly as the values
+ *      extract_path_vars() used to copy into the environment;
+ *   5. a benchmark times both over every route.
+ *
+ * ====================================================================
+ * This test drives the REAL dispatcher and the REAL table:
+ * src/routetab.c and src/routes.c are #included below. router.c cannot
+ * compile on the host (clibwto, clibtry, the httpd callback table),
+ * which is why the trie walk lives in its own portable TU.
+ * ====================================================================
+ *
+ * Runs on host via `make test-host`.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <mbtcheck.h>
+
+#include "../../src/routetab.c"
+#include "../../src/routes.c"
+
+static char msg[640];
+
+/*
+ * The oracle: router.c's is_pattern_match() as it was before the trie,
+ * scanned over the definitions in registration order.
+ */
+static int
+old_pattern_match(const char *pattern, const char *path)
+{
+	while (*pattern && *path) {
+		if (*pattern == '{') {
+			int is_wildcard = (*(pattern + 1) == '*');
+			if (is_wildcard) pattern++;
+			while (*pattern && *pattern != '}') pattern++;
+			if (*pattern == '}') pattern++;
+
+			if (is_wildcard) {
+				while (*path) path++;
+			} else {
+				while (*path && *path != '/' && *path != '(' && *path != ')') path++;
+			}
+		} else {
+			if (*pattern == *path) {
+				pattern++;
+				path++;
+			} else {
+				return 0;
+			}
+		}
+	}
+
+	while (*pattern == '{' && *(pattern + 1) == '*') {
+		while (*pattern && *pattern != '}') pattern++;
+		if (*pattern == '}') pattern++;
+	}
+
+	return *pattern == '\0' && *path == '\0';
+}
+
+static int
+old_find_route(HttpMethod method, const char *path)
+{
+	int i;
+
+	for (i = 0; i < ROUTE_COUNT; i++) {
+		if (route_defs[i].method == method
+		    && old_pattern_match(route_defs[i].pattern, path)) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/*
+ * The capture oracle: router.c's extract_path_vars() as it was, minus the
+ * http_set_env() at the end -- the (name, value) pairs it would have set.
+ */
+#define OLD_MAX_VARS 8
+
+struct old_vars {
+	int n;
+	char name[OLD_MAX_VARS][256];
+	char value[OLD_MAX_VARS][1024];
+};
+
+static void
+old_extract(const char *pattern, const char *path, struct old_vars *v)
+{
+	v->n = 0;
+
+	while (*pattern) {
+		if (*pattern == '{') {
+			pattern++;
+			int is_wildcard = (*pattern == '*');
+			if (is_wildcard) pattern++;
+			const char *var_start = pattern;
+			while (*pattern && *pattern != '}') pattern++;
+			int var_name_len = pattern - var_start;
+			char *var_name = v->name[v->n];
+			memcpy(var_name, var_start, var_name_len);
+			var_name[var_name_len] = '\0';
+			if (*pattern == '}') pattern++;
+
+			const char *value_start = path;
+
+			if (is_wildcard) {
+				while (*path) path++;
+			} else {
+				const char *pattern_next = pattern;
+				while (*pattern_next && *pattern_next != '/' && *pattern_next != '(' && *pattern_next != ')') pattern_next++;
+
+				while (*path && *path != *pattern_next) path++;
+			}
+
+			int value_len = path - value_start;
+			char *value = v->value[v->n];
+			memcpy(value, value_start, value_len);
+			value[value_len] = '\0';
+
+			while (value_len > 0 && value[value_len - 1] == ' ') {
+				value[--value_len] = '\0';
+			}
+			v->n++;
+		} else {
+			if (*pattern == *path) {
+				pattern++;
+				path++;
+			} else {
+				return;
+			}
+		}
+	}
+}
+
+/* The new way, for the same path: match, split, read the spans. */
+static int
+captures_agree(int route, const char *path)
+{
+	struct old_vars want;
+	char copy[1024];
+	RTMATCH m;
+	int i;
+
+	old_extract(route_defs[route].pattern, path, &want);
+
+	strcpy(copy, path);
+	if (rt_match(mvsmf_routes(), route_defs[route].method, copy, &m) != route) {
+		return 0;
+	}
+	rt_split(copy, &m);
+
+	if (m.ncaps != want.n) {
+		printf("  %s: %d captures, old %d\n", path, m.ncaps, want.n);
+		return 0;
+	}
+	for (i = 0; i < m.ncaps; i++) {
+		if (strcmp(m.caps[i].name, want.name[i]) != 0
+		    || strcmp(copy + m.caps[i].off, want.value[i]) != 0) {
+			printf("  %s: {%s}=\"%s\", old {%s}=\"%s\"\n", path,
+				m.caps[i].name, copy + m.caps[i].off,
+				want.name[i], want.value[i]);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* What each path variable id is called; a capture edge must agree. */
+static const char *path_var_names[PATH_VAR_COUNT] = {
+	[PATH_DATASET_NAME]     = "dataset-name",
+	[PATH_MEMBER_NAME]      = "member-name",
+	[PATH_VOLUME_SERIAL]    = "volume-serial",
+	[PATH_JOB_NAME]         = "job-name",
+	[PATH_JOBID]            = "jobid",
+	[PATH_DDID]             = "ddid",
+	[PATH_CONSOLE_NAME]     = "console-name",
+	[PATH_CMD_RESPONSE_KEY] = "cmd-response-key",
+	[PATH_DETECTION_KEY]    = "detection-key",
+	[PATH_FILEPATH]         = "filepath",
+};
+static int bad_var;
+
+/* Spell the trie back into patterns; count each route id seen. */
+static int seen[ROUTE_COUNT];
+static int bad_leaf;
+
+static void
+spell(const RTNODE *node, char *buf, size_t at)
+{
+	size_t n;
+	int i;
+
+	switch (node->kind) {
+	case RT_LIT:  n = sprintf(buf + at, "%s", node->text);     break;
+	case RT_VAR:  n = sprintf(buf + at, "{%s}", node->text);   break;
+	default:      n = sprintf(buf + at, "{*%s}", node->text);  break;
+	}
+	at += n;
+
+	if (node->kind != RT_LIT
+	    && (node->var >= PATH_VAR_COUNT
+		|| strcmp(path_var_names[node->var], node->text) != 0)) {
+		printf("  {%s} carries path variable id %d\n", node->text, node->var);
+		bad_var++;
+	}
+
+	for (i = 0; i < node->nleaves; i++) {
+		int r = node->leaves[i].route;
+
+		if (r < 0 || r >= ROUTE_COUNT) {
+			bad_leaf++;
+			continue;
+		}
+		seen[r]++;
+		snprintf(msg, sizeof(msg), "trie spells route %d as its definition: %s",
+			r, route_defs[r].pattern);
+		CHECK(strcmp(buf, route_defs[r].pattern) == 0, msg);
+		snprintf(msg, sizeof(msg), "route %d ends under its own method", r);
+		CHECK_EQ(node->leaves[i].method, route_defs[r].method, msg);
+	}
+
+	for (i = 0; i < node->nkids; i++) {
+		spell(&node->kids[i], buf, at);
+	}
+	buf[at - n] = '\0';
+}
+
+/* A concrete path for a pattern: {name} -> "A1", {*name} -> "u/x.c" */
+static void
+sample_path(const char *pattern, char *out, const char *var, const char *rest)
+{
+	while (*pattern) {
+		if (*pattern == '{') {
+			int wild = pattern[1] == '*';
+
+			while (*pattern && *pattern != '}') pattern++;
+			if (*pattern) pattern++;
+			strcpy(out, wild ? rest : var);
+			out += strlen(out);
+		} else {
+			*out++ = *pattern++;
+		}
+	}
+	*out = '\0';
+}
+
+static const char *method_names[] = {
+	"GET", "POST", "PUT", "DELETE", "HEAD", "OPTIONS", "PATCH"
+};
+
+static const HttpMethod methods[] = { GET, POST, PUT, DELETE, HEAD };
+#define NMETHODS ((int) (sizeof(methods) / sizeof(methods[0])))
+
+static int
+agree(const char *path)
+{
+	int m;
+	int ok = 1;
+
+	for (m = 0; m < NMETHODS; m++) {
+		int want = old_find_route(methods[m], path);
+		int got = rt_match(mvsmf_routes(), methods[m], path, NULL);
+
+		if (want != got) {
+			printf("  %d %s: trie %d, old %d\n", methods[m], path, got, want);
+			ok = 0;
+		} else if (want >= 0 && !captures_agree(want, path)) {
+			ok = 0;
+		}
+	}
+	return ok;
+}
+
+/* Fragments the fuzzer strings together: every literal of the table cut at
+ * its delimiters, the delimiters themselves, and some noise. */
+static const char *frags[] = {
+	"/", "(", ")", "-", "-(", ")/", "/zosmf", "/zosmf/", "zosmf", "info",
+	"test", "wildcard", "services", "authenticate", "rest", "restjobs",
+	"jobs", "files", "records", "restfiles", "ds", "fs", "member",
+	"restconsoles", "consoles", "solmsgs", "detections", "v1", "log",
+	"IBMUSER.JCL", "HERC01", "JOB00042", "2", "JESMSGLG", "", " ", "%",
+};
+#define NFRAGS ((unsigned) (sizeof(frags) / sizeof(frags[0])))
+
+static unsigned long lcg_state = 12345;
+
+static unsigned
+lcg(void)
+{
+	lcg_state = lcg_state * 1103515245UL + 12345UL;
+	return (unsigned) (lcg_state >> 16) & 0x7FFF;
+}
+
+int main(void)
+{
+	char buf[512];
+	char path[512];
+	int i;
+	int rc;
+
+	printf("\n--- the trie spells every definition, once ---\n");
+	{
+		memset(seen, 0, sizeof(seen));
+		bad_leaf = 0;
+		buf[0] = '\0';
+		spell(mvsmf_routes()->root, buf, 0);
+
+		CHECK_EQ(bad_leaf, 0, "no leaf names a route id outside the table");
+		CHECK_EQ(bad_var, 0, "every capture edge carries its variable's id");
+		for (i = 0; i < ROUTE_COUNT; i++) {
+			snprintf(msg, sizeof(msg), "route %d (%s) has exactly one leaf",
+				i, route_defs[i].pattern);
+			CHECK_EQ(seen[i], 1, msg);
+		}
+		CHECK_EQ(mvsmf_routes()->count, ROUTE_COUNT, "the table knows its size");
+	}
+
+	printf("\n--- every route is reached by its own pattern ---\n");
+	for (i = 0; i < ROUTE_COUNT; i++) {
+		sample_path(route_defs[i].pattern, path, "A1", "u/x.c");
+		rc = rt_match(mvsmf_routes(), route_defs[i].method, path, NULL);
+		snprintf(msg, sizeof(msg), "%s dispatches to route %d", path, i);
+		CHECK_EQ(rc, i, msg);
+		snprintf(msg, sizeof(msg), "and the old matcher agrees on %s", path);
+		CHECK(agree(path), msg);
+	}
+
+	printf("\n--- edge cases: same answer as the old matcher ---\n");
+	{
+		static const char *edge[] = {
+			"", "/", "/zosmf", "/zosmf/", "/zosmf/inf", "/zosmf/info/",
+			"/zosmf/infox", "/zosmf/test/", "/zosmf/test/wildcard",
+			"/zosmf/test/wildcard/", "/zosmf/test/wildcard/a/b/c",
+			"/zosmf/restjobs/jobs/", "/zosmf/restjobs/jobs//",
+			"/zosmf/restjobs/jobs//J1", "/zosmf/restjobs/jobs/N/",
+			"/zosmf/restjobs/jobs/N/J/files/", "/zosmf/restjobs/jobs/N/J/files//records",
+			"/zosmf/restjobs/jobs/N(J)/x",
+			"/zosmf/restfiles/ds/", "/zosmf/restfiles/dsx",
+			"/zosmf/restfiles/ds/A.B/", "/zosmf/restfiles/ds/A.B/member/",
+			"/zosmf/restfiles/ds/A.B(", "/zosmf/restfiles/ds/A.B()",
+			"/zosmf/restfiles/ds/A.B(M", "/zosmf/restfiles/ds/A.B(M)x",
+			"/zosmf/restfiles/ds/-(V)", "/zosmf/restfiles/ds/-(V)/",
+			"/zosmf/restfiles/ds/-(V)/A.B", "/zosmf/restfiles/ds/-(V)/A.B(M)",
+			"/zosmf/restfiles/ds/-(V)/A.B/member", "/zosmf/restfiles/ds/-()/X",
+			"/zosmf/restfiles/ds/-(", "/zosmf/restfiles/ds/-", "/zosmf/restfiles/ds/(M)",
+			"/zosmf/restfiles/ds/-(V)(M)", "/zosmf/restfiles/ds/A.B (M  )",
+			"/zosmf/restfiles/fs", "/zosmf/restfiles/fs/", "/zosmf/restfiles/fs//",
+			"/zosmf/restfiles/fs/u/a(b)/c",
+			"/zosmf/restconsoles/consoles/", "/zosmf/restconsoles/consoles/C",
+			"/zosmf/restconsoles/consoles/C/", "/zosmf/restconsoles/consoles/C/solmsgs/",
+			"/zosmf/restconsoles/consoles/C/solmsgs/K/x",
+			"/zosmf/restconsoles/consoles//detections/K",
+			"/zosmf/restconsoles/v1/log/", "/zosmf/restconsoles/v1/lo",
+			"/zosmf/services/authenticate", "/zosmf/services/authenticatex",
+		};
+
+		for (i = 0; i < (int) (sizeof(edge) / sizeof(edge[0])); i++) {
+			snprintf(msg, sizeof(msg), "trie and old matcher agree on \"%s\"", edge[i]);
+			CHECK(agree(edge[i]), msg);
+		}
+		CHECK_EQ(rt_match(mvsmf_routes(), GET, "/zosmf/restfiles/ds/-(V)/A.B(M)", NULL),
+			ROUTE_MBR_GET_VOL, "a volume-qualified member is a member GET");
+		CHECK_EQ(rt_match(mvsmf_routes(), GET, "/zosmf/restfiles/fs/", NULL),
+			ROUTE_USS_GET, "{*filepath} matches the empty rest");
+		CHECK_EQ(rt_match(mvsmf_routes(), POST, "/zosmf/restfiles/ds/-(V)/A.B", NULL),
+			-1, "there is no volume-qualified create");
+		CHECK_EQ(rt_match(mvsmf_routes(), PUT, "/zosmf/info", NULL),
+			-1, "a known path under the wrong method is no route");
+		CHECK_EQ(rt_match(NULL, GET, "/zosmf/info", NULL), -1, "no table, no route");
+		CHECK_EQ(rt_match(mvsmf_routes(), GET, NULL, NULL), -1, "no path, no route");
+	}
+
+	printf("\n--- captures are spans of the path, split in place ---\n");
+	{
+		RTMATCH m;
+
+		strcpy(path, "/zosmf/restfiles/ds/-(WORK01)/IBMUSER.CNTL(IEFBR14 )");
+		rc = rt_match(mvsmf_routes(), PUT, path, &m);
+		CHECK_EQ(rc, ROUTE_MBR_PUT_VOL, "a volume-qualified member PUT");
+		CHECK_EQ(m.route, rc, "the match records the route");
+		CHECK_EQ(m.ncaps, 3, "with three captures");
+		CHECK_EQ(m.caps[0].var, PATH_VOLUME_SERIAL, "the volume first");
+		CHECK_EQ(m.caps[0].off, 22, "as an offset into the path");
+		CHECK_EQ(m.caps[0].len, 6, "and a length");
+		CHECK_EQ(m.caps[2].var, PATH_MEMBER_NAME, "the member last");
+		CHECK_EQ(m.caps[2].len, 7, "trailing blanks are off its length");
+		CHECK(strcmp(path, "/zosmf/restfiles/ds/-(WORK01)/IBMUSER.CNTL(IEFBR14 )") == 0,
+			"matching does not touch the path");
+
+		rt_split(path, &m);
+		CHECK(strcmp(path + m.caps[0].off, "WORK01") == 0, "split: volume-serial");
+		CHECK(strcmp(path + m.caps[1].off, "IBMUSER.CNTL") == 0, "split: dataset-name");
+		CHECK(strcmp(path + m.caps[2].off, "IEFBR14") == 0, "split: member-name, trimmed");
+
+		strcpy(path, "/zosmf/restjobs/jobs//J1/files");
+		rc = rt_match(mvsmf_routes(), GET, path, &m);
+		rt_split(path, &m);
+		CHECK_EQ(rc, ROUTE_JOB_FILES, "an empty job name mid-path still routes");
+		CHECK(strcmp(path + m.caps[0].off, "") == 0, "as an empty capture");
+		CHECK(strcmp(path + m.caps[1].off, "J1") == 0, "and does not eat the next one");
+
+		strcpy(path, "/zosmf/restfiles/fs/u/a b/c  ");
+		rc = rt_match(mvsmf_routes(), GET, path, &m);
+		rt_split(path, &m);
+		CHECK_EQ(rc, ROUTE_USS_GET, "a USS GET");
+		CHECK(strcmp(path + m.caps[0].off, "u/a b/c") == 0,
+			"{*filepath} keeps inner blanks and slashes, loses trailing ones");
+
+		rc = rt_match(mvsmf_routes(), GET, "/zosmf/nothere", &m);
+		CHECK_EQ(rc, -1, "no route");
+		CHECK_EQ(m.route, -1, "recorded as such");
+		CHECK_EQ(m.ncaps, 0, "with no captures left over from a failed branch");
+	}
+
+	printf("\n--- pseudo-random paths: same answer as the old matcher ---\n");
+	{
+		int disagree = 0;
+		int hits = 0;
+		int n;
+
+		for (n = 0; n < 200000; n++) {
+			int pieces = 1 + lcg() % 12;
+			int p;
+
+			/* half the sample starts from a real route, so the fuzz
+			   spends its time near the table rather than far outside */
+			if (lcg() & 1) {
+				int r = lcg() % ROUTE_COUNT;
+
+				sample_path(route_defs[r].pattern, path,
+					frags[lcg() % NFRAGS], frags[lcg() % NFRAGS]);
+				path[lcg() % (strlen(path) + 1)] = '\0';
+			} else {
+				path[0] = '\0';
+			}
+			for (p = 0; p < pieces && strlen(path) < 400; p++) {
+				strcat(path, frags[lcg() % NFRAGS]);
+			}
+
+			if (!agree(path)) {
+				disagree++;
+			}
+			if (old_find_route(GET, path) >= 0) {
+				hits++;
+			}
+		}
+		CHECK_EQ(disagree, 0, "no disagreement, route or captures, over 200000 random paths");
+		CHECK(hits > 1000, "and the sample did exercise real routes");
+	}
+
+	printf("\n--- benchmark: dispatch every route ---\n");
+	{
+		char paths[ROUTE_COUNT][256];
+		long iters = 20000;
+		volatile int sink = 0;
+		clock_t t0;
+		double t_old;
+		double t_trie;
+		long k;
+
+		for (i = 0; i < ROUTE_COUNT; i++) {
+			sample_path(route_defs[i].pattern, paths[i], "IBMUSER.TEST.JCL", "u/ibmuser/x.c");
+		}
+
+		t0 = clock();
+		for (k = 0; k < iters; k++) {
+			for (i = 0; i < ROUTE_COUNT; i++) {
+				sink += old_find_route(route_defs[i].method, paths[i]);
+			}
+		}
+		t_old = (double) (clock() - t0) / CLOCKS_PER_SEC;
+
+		t0 = clock();
+		for (k = 0; k < iters; k++) {
+			for (i = 0; i < ROUTE_COUNT; i++) {
+				sink += rt_match(mvsmf_routes(), route_defs[i].method, paths[i], NULL);
+			}
+		}
+		t_trie = (double) (clock() - t0) / CLOCKS_PER_SEC;
+
+		printf("  %d routes x %ld: linear %.1f ns/dispatch, trie %.1f ns/dispatch\n",
+			ROUTE_COUNT, iters,
+			t_old * 1e9 / ((double) iters * ROUTE_COUNT),
+			t_trie * 1e9 / ((double) iters * ROUTE_COUNT));
+
+		/* with the variables: find + extract_path_vars() copies, against
+		   one walk + an in-place split (the env set itself not counted) */
+		{
+			struct old_vars ov;
+			RTMATCH m;
+			char copy[256];
+
+			t0 = clock();
+			for (k = 0; k < iters; k++) {
+				for (i = 0; i < ROUTE_COUNT; i++) {
+					int r = old_find_route(route_defs[i].method, paths[i]);
+					old_extract(route_defs[r].pattern, paths[i], &ov);
+					sink += ov.n;
+				}
+			}
+			t_old = (double) (clock() - t0) / CLOCKS_PER_SEC;
+
+			t0 = clock();
+			for (k = 0; k < iters; k++) {
+				for (i = 0; i < ROUTE_COUNT; i++) {
+					strcpy(copy, paths[i]);
+					rt_match(mvsmf_routes(), route_defs[i].method, copy, &m);
+					rt_split(copy, &m);
+					sink += m.ncaps;
+				}
+			}
+			t_trie = (double) (clock() - t0) / CLOCKS_PER_SEC;
+
+			printf("  with captures: find+extract %.1f ns/request, match+split %.1f ns/request\n",
+				t_old * 1e9 / ((double) iters * ROUTE_COUNT),
+				t_trie * 1e9 / ((double) iters * ROUTE_COUNT));
+		}
+		for (i = 0; i < ROUTE_COUNT; i++) {
+			long r;
+
+			t0 = clock();
+			for (r = 0; r < iters; r++) {
+				sink += rt_match(mvsmf_routes(), route_defs[i].method, paths[i], NULL);
+			}
+			printf("  %-6s %-68.68s %6.1f ns\n",
+				method_names[route_defs[i].method], route_defs[i].pattern,
+				(double) (clock() - t0) / CLOCKS_PER_SEC * 1e9 / iters);
+		}
+		CHECK(sink != 0, "the benchmark did dispatch");
+	}
+
+	return mbt_test_summary("TSTROUT");
+}
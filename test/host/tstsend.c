@@ -24,10 +24,18 @@
  * four MVS/httpd services injected through SEND_OPS.
  * ====================================================================
  *
+ * The coalescing buffer in front of the loop (SEND_BUF) is checked here
+ * too: bytes arrive in order and whole, every send but the last is full,
+ * a large write passes through without a copy, the #298 policy holds for a
+ * flush exactly as for a bare send, and a failed flush is final. Then the
+ * FB80 download: 10 000 records, sent one per call and coalesced.
+ *
  * Runs on host via `make test-host`.
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include <mbtcheck.h>
 
@@ -154,10 +162,106 @@ check_payload(struct client *c, int len)
 	CHECK(1, "the bytes arrived in order, none dropped or repeated");
 }
 
+/*
+ * A client for the buffer: accepts up to `chunk` bytes a call into a large
+ * sink, and can stall (`stall_from`..+`stall_for` calls return 0) or die
+ * (`dead_at`, a call number). Call sizes are kept to check full sends.
+ */
+#define SINK_MAX    (1024 * 1024)
+#define CALLS_MAX   4096
+
+struct sink {
+	int            chunk;         /* most bytes accepted per call, 0: all */
+	int            calls;
+	int            stall_from;    /* 0: never */
+	int            stall_for;
+	int            dead_at;       /* 0: never */
+	int            aborted;
+	int            pauses;
+	int            giveups;
+	int            len;
+	int            call_len[CALLS_MAX];
+	unsigned char *got;
+};
+
+static int
+sink_send(void *ctx, const unsigned char *buf, int len)
+{
+	struct sink *k = (struct sink *)ctx;
+	int n = len;
+
+	k->calls++;
+	if (k->dead_at && k->calls >= k->dead_at) {
+		return -1;
+	}
+	if (k->stall_from && k->calls >= k->stall_from
+		&& k->calls < k->stall_from + k->stall_for) {
+		return 0;
+	}
+	if (k->chunk && n > k->chunk) {
+		n = k->chunk;
+	}
+	if (k->len + n > SINK_MAX) {
+		return -1;
+	}
+	memcpy(k->got + k->len, buf, n);
+	k->len += n;
+	if (k->calls <= CALLS_MAX) {
+		k->call_len[k->calls - 1] = n;
+	}
+	return n;
+}
+
+static void
+sink_pause(void *ctx)
+{
+	((struct sink *)ctx)->pauses++;
+}
+
+static int
+sink_aborted(void *ctx)
+{
+	return ((struct sink *)ctx)->aborted;
+}
+
+static void
+sink_giveup(void *ctx, int stall)
+{
+	(void)stall;
+	((struct sink *)ctx)->giveups++;
+}
+
+static const SEND_OPS sink_ops = { sink_send, sink_pause, sink_aborted,
+	sink_giveup };
+
+/* The n-th byte of the test stream. */
+#define STREAM(n)   ((unsigned char)((n) * 7 + ((n) >> 8)))
+
+static unsigned char stream[SINK_MAX];
+static unsigned char storage[SEND_BUF_SIZE];
+
+static void
+sink_init(struct sink *k)
+{
+	unsigned char *got = k->got;
+
+	memset(k, 0, sizeof(*k));
+	k->got = got;
+}
+
+/* The sink holds the first `len` bytes of the stream, in order. */
+static int
+sink_matches(const struct sink *k, int len)
+{
+	return k->len == len && memcmp(k->got, stream, len) == 0;
+}
+
 int
 main(void)
 {
 	struct client c;
+	struct sink k;
+	SEND_BUF sb;
 	int rc;
 
 	printf("\n--- #298: a zero return must not advance, and must terminate ---\n");
@@ -309,5 +413,246 @@ main(void)
 		CHECK_EQ(c.attempts, 0, "without touching the socket");
 	}
 
+	for (rc = 0; rc < SINK_MAX; rc++) {
+		stream[rc] = STREAM(rc);
+	}
+	k.got = malloc(SINK_MAX);
+	if (!k.got) {
+		printf("no storage for the sink\n");
+		return 1;
+	}
+
+	printf("\n--- buffer: small writes coalesce into full sends ---\n");
+	{
+		int pos = 0;
+		int i;
+		int full = 1;
+
+		sink_init(&k);
+		sendbuf_init(&sb, storage, SEND_BUF_SIZE);
+		for (i = 0; i < 1000; i++) {
+			rc = sendbuf_write(&sb, &k, &sink_ops, stream + pos, 80);
+			pos += 80;
+		}
+		CHECK_EQ(rc, 0, "every write accepted");
+		CHECK_EQ(k.calls, 80000 / SEND_BUF_SIZE, "one send per full buffer");
+		rc = sendbuf_flush(&sb, &k, &sink_ops);
+		CHECK_EQ(rc, 0, "the tail flushed");
+		CHECK_EQ(k.calls, 80000 / SEND_BUF_SIZE + 1, "in one more send");
+		for (i = 0; i < k.calls - 1; i++) {
+			if (k.call_len[i] != SEND_BUF_SIZE) {
+				full = 0;
+			}
+		}
+		CHECK(full, "every send but the last carries a full buffer");
+		CHECK(sink_matches(&k, 80000), "the bytes arrived in order, whole");
+		CHECK_EQ((int)sb.sent, 80000, "and are counted as sent");
+		CHECK_EQ(sb.len, 0, "nothing pending");
+
+		rc = sendbuf_flush(&sb, &k, &sink_ops);
+		CHECK_EQ(rc, 0, "a flush with nothing pending succeeds");
+		CHECK_EQ(k.calls, 80000 / SEND_BUF_SIZE + 1, "without a send");
+		rc = sendbuf_write(&sb, &k, &sink_ops, stream, 0);
+		CHECK_EQ(rc, 0, "an empty write succeeds");
+		CHECK_EQ(sb.len, 0, "and adds nothing");
+	}
+
+	printf("\n--- buffer: a large write passes through, in order ---\n");
+	{
+		sink_init(&k);
+		sendbuf_init(&sb, storage, SEND_BUF_SIZE);
+		sendbuf_write(&sb, &k, &sink_ops, stream, 100);
+		rc = sendbuf_write(&sb, &k, &sink_ops, stream + 100, 40000);
+		CHECK_EQ(rc, 0, "accepted");
+		CHECK_EQ(k.calls, 2, "the pending 100 bytes, then the write itself");
+		CHECK_EQ(k.call_len[0], 100, "pending first");
+		CHECK_EQ(k.call_len[1], 40000, "then the write, not cut up");
+		CHECK_EQ(sb.len, 0, "nothing left pending");
+		sendbuf_write(&sb, &k, &sink_ops, stream + 40100, 10);
+		sendbuf_flush(&sb, &k, &sink_ops);
+		CHECK(sink_matches(&k, 40110), "the stream is whole and in order");
+	}
+
+	printf("\n--- buffer: a write that straddles tops the buffer up ---\n");
+	{
+		sink_init(&k);
+		sendbuf_init(&sb, storage, SEND_BUF_SIZE);
+		sendbuf_write(&sb, &k, &sink_ops, stream, SEND_BUF_SIZE - 10);
+		rc = sendbuf_write(&sb, &k, &sink_ops,
+			stream + SEND_BUF_SIZE - 10, 100);
+		CHECK_EQ(rc, 0, "accepted");
+		CHECK_EQ(k.calls, 1, "one send");
+		CHECK_EQ(k.call_len[0], SEND_BUF_SIZE, "of a full buffer");
+		CHECK_EQ(sb.len, 90, "the rest pending");
+		sendbuf_flush(&sb, &k, &sink_ops);
+		CHECK(sink_matches(&k, SEND_BUF_SIZE + 90), "in order");
+	}
+
+	printf("\n--- buffer: without storage every write is a send ---\n");
+	{
+		sink_init(&k);
+		sendbuf_init(&sb, NULL, 0);
+		sendbuf_write(&sb, &k, &sink_ops, stream, 80);
+		sendbuf_write(&sb, &k, &sink_ops, stream + 80, 80);
+		CHECK_EQ(k.calls, 2, "two writes, two sends");
+		CHECK(sink_matches(&k, 160), "in order");
+		CHECK_EQ(sendbuf_flush(&sb, &k, &sink_ops), 0, "flush is a no-op");
+	}
+
+	printf("\n--- buffer: #298 holds for a flush ---\n");
+	{
+		/* a short-accepting client with a stall inside the budget: the
+		   flush waits it out and delivers everything */
+		sink_init(&k);
+		k.chunk = 1000;
+		k.stall_from = 3;
+		k.stall_for = SEND_STALL_MAX - 1;
+		sendbuf_init(&sb, storage, SEND_BUF_SIZE);
+		sendbuf_write(&sb, &k, &sink_ops, stream, 5000);
+		rc = sendbuf_flush(&sb, &k, &sink_ops);
+		CHECK_EQ(rc, 0, "a stall inside the budget is waited out");
+		CHECK_EQ(k.pauses, SEND_STALL_MAX - 1, "paused, not spun");
+		CHECK(sink_matches(&k, 5000), "short sends resumed, in order");
+		CHECK_EQ(sb.failed, 0, "and the buffer is still good");
+
+		/* a stall past the budget: the flush fails, once, for good */
+		sink_init(&k);
+		k.stall_from = 1;
+		k.stall_for = 100000;
+		sendbuf_init(&sb, storage, SEND_BUF_SIZE);
+		sendbuf_write(&sb, &k, &sink_ops, stream, SEND_BUF_SIZE - 1);
+		rc = sendbuf_write(&sb, &k, &sink_ops, stream, 100);
+		CHECK_EQ(rc, -1, "the write that filled the buffer reports it");
+		CHECK_EQ(k.giveups, 1, "MVSMF008W once");
+		CHECK_EQ(k.calls, SEND_STALL_MAX + 1, "after exactly the budget");
+		CHECK_EQ(sb.failed, 1, "the buffer is failed");
+		CHECK_EQ(sb.len, 0, "the pending bytes dropped");
+
+		rc = sendbuf_write(&sb, &k, &sink_ops, stream, 10);
+		CHECK_EQ(rc, -1, "a later write fails at once");
+		rc = sendbuf_write(&sb, &k, &sink_ops, stream, 40000);
+		CHECK_EQ(rc, -1, "a large one too");
+		rc = sendbuf_flush(&sb, &k, &sink_ops);
+		CHECK_EQ(rc, -1, "and the final flush");
+		CHECK_EQ(k.calls, SEND_STALL_MAX + 1, "none of them touched the socket");
+		CHECK_EQ(k.giveups, 1, "or spent the budget again");
+	}
+
+	printf("\n--- buffer: a dead or finished client ---\n");
+	{
+		sink_init(&k);
+		k.dead_at = 2;
+		k.chunk = 100;
+		sendbuf_init(&sb, storage, SEND_BUF_SIZE);
+		sendbuf_write(&sb, &k, &sink_ops, stream, 500);
+		rc = sendbuf_flush(&sb, &k, &sink_ops);
+		CHECK_EQ(rc, -1, "a socket that dies mid-flush fails it");
+		CHECK_EQ((int)sb.sent, 0, "the partial flush is not counted as sent");
+		CHECK_EQ(k.len, 100, "what went out before is not re-sent");
+
+		sink_init(&k);
+		k.aborted = 1;
+		sendbuf_init(&sb, storage, SEND_BUF_SIZE);
+		rc = sendbuf_write(&sb, &k, &sink_ops, stream, 500);
+		CHECK_EQ(rc, 0, "a write that only buffers does not see it");
+		rc = sendbuf_flush(&sb, &k, &sink_ops);
+		CHECK_EQ(rc, -1, "the flush does, at the entry guard");
+		CHECK_EQ(k.calls, 0, "without writing to the client");
+		CHECK_EQ(k.pauses, 0, "or waiting for it");
+	}
+
+	printf("\n--- buffer: randomized writes and short sends ---\n");
+	{
+		int round;
+		int whole = 1;
+		int failed = 0;
+
+		srand(298);
+		for (round = 0; round < 300; round++) {
+			int pos = 0;
+
+			sink_init(&k);
+			k.chunk = 1 + rand() % 20000;
+			sendbuf_init(&sb, storage, 64 + rand() % (SEND_BUF_SIZE - 64));
+			while (pos < SINK_MAX - 50000) {
+				int n = rand() % 4 == 0 ? rand() % 40000 : rand() % 200;
+
+				if (sendbuf_write(&sb, &k, &sink_ops, stream + pos, n) < 0) {
+					failed = 1;
+					break;
+				}
+				pos += n;
+				if (rand() % 50 == 0 && sendbuf_flush(&sb, &k, &sink_ops) < 0) {
+					failed = 1;
+					break;
+				}
+			}
+			if (sendbuf_flush(&sb, &k, &sink_ops) < 0) {
+				failed = 1;
+			}
+			if (!sink_matches(&k, pos) || (int)sb.sent != pos) {
+				whole = 0;
+			}
+		}
+		CHECK(!failed, "no write or flush failed");
+		CHECK(whole, "every stream arrived whole, in order, counted");
+	}
+
+	printf("\n--- benchmark: 10 000-record FB80 GET ---\n");
+	{
+		/* The text download: 80-byte records stripped to their text, each
+		   ending in LF -- say 72 bytes on average. The per-send cost on MVS
+		   is httpd's send path and a send() SVC; here it is a call and a
+		   copy, so the time understates the win and the call count is the
+		   number to carry over. */
+		const int records = 10000;
+		const int reclen = 72;
+		const int reps = 50;
+		unsigned long calls_direct;
+		unsigned long calls_buffered;
+		clock_t t0;
+		double t_direct;
+		double t_buffered;
+		int r;
+		int i;
+
+		t0 = clock();
+		for (r = 0; r < reps; r++) {
+			sink_init(&k);
+			for (i = 0; i < records; i++) {
+				send_bytes(&k, &sink_ops, stream + i * reclen, reclen);
+			}
+		}
+		t_direct = (double)(clock() - t0) / CLOCKS_PER_SEC / reps;
+		calls_direct = (unsigned long)k.calls;
+		CHECK(sink_matches(&k, records * reclen), "one send per record: whole");
+
+		t0 = clock();
+		for (r = 0; r < reps; r++) {
+			sink_init(&k);
+			sendbuf_init(&sb, storage, SEND_BUF_SIZE);
+			for (i = 0; i < records; i++) {
+				sendbuf_write(&sb, &k, &sink_ops, stream + i * reclen, reclen);
+			}
+			sendbuf_flush(&sb, &k, &sink_ops);
+		}
+		t_buffered = (double)(clock() - t0) / CLOCKS_PER_SEC / reps;
+		calls_buffered = (unsigned long)k.calls;
+		CHECK(sink_matches(&k, records * reclen), "coalesced: whole");
+
+		printf("  %d bytes: %lu sends unbuffered, %lu coalesced (%.0fx fewer)\n",
+			records * reclen, calls_direct, calls_buffered,
+			(double)calls_direct / calls_buffered);
+		printf("  host: %.1f us unbuffered, %.1f us coalesced, %.0f MB/s -> %.0f MB/s\n",
+			t_direct * 1e6, t_buffered * 1e6,
+			records * reclen / t_direct / 1e6,
+			records * reclen / t_buffered / 1e6);
+		CHECK_EQ(calls_buffered,
+			(unsigned long)(records * reclen + SEND_BUF_SIZE - 1) / SEND_BUF_SIZE,
+			"one send per 16K");
+	}
+
+	free(k.got);
+
 	return mbt_test_summary("TSTSEND");
 }
@@ -0,0 +1,353 @@
+/*
+ * tsttrace.c - per-request phase spans: the recorder and its two renderings.
+ *
+ * A span table that is wrong is quietly wrong: Server-Timing still parses
+ * and the WTO still reads well, they only send the operator to the wrong
+ * phase. So:
+ *
+ *   1. begin/end pairs add up per name, by content and not by pointer; a
+ *      begin nested in its own name is not counted twice, and every misuse
+ *      (TRC_NONE, a second end, a slot out of range) is a no-op.
+ *   2. A full table drops the begin, counts the drop, and records nothing
+ *      else -- it never writes past the array.
+ *   3. Server-Timing carries finished phases only, `total` always and last,
+ *      and cuts whole entries when the buffer is short.
+ *   4. The summary carries every phase, open ones up to `now` with a `+`,
+ *      counts where a phase ran more than once, and the drop count.
+ *   5. Randomized: the totals agree with an independent stack model over
+ *      many random nestings.
+ *
+ * ====================================================================
+ * This test drives the REAL implementation: src/trace.c is #included
+ * below, so a later refactor stays covered. router.c, which reads the TOD
+ * clock and writes the WTO, cannot compile on the host; the clock here is
+ * the test's own.
+ * ====================================================================
+ *
+ * Runs on host via `make test-host`.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <mbtcheck.h>
+
+#include "../../src/trace.c"
+
+/* one millisecond in TOD units: bit 51 is a microsecond */
+#define MS(x)   ((unsigned long long) (x) * 4096000ULL)
+#define US(x)   ((unsigned long long) (x) * 4096ULL)
+
+static char msg[200];
+static char buf[512];
+
+/* xorshift32, so the randomized run is the same on every host */
+static unsigned rng_state = 0x2545F491u;
+
+static unsigned
+rng(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+static TRC_TRACE tr;
+
+static int
+slot_of(const TRC_TRACE *t, const char *name)
+{
+	int i;
+
+	for (i = 0; i < t->nspans; i++) {
+		if (strcmp(t->span[i].name, name) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+int main(void)
+{
+	int a, b, c;
+	int i;
+	int n;
+
+	printf("\n--- init and the clock ---\n");
+	memset(&tr, 0xA5, sizeof(tr));
+	trace_init(&tr, MS(5));
+	CHECK_EQ(tr.nspans, 0, "an initialised table is empty");
+	CHECK_EQ(tr.dropped, 0, "and has dropped nothing");
+	CHECK(tr.t0 == MS(5), "t0 is the clock given");
+	CHECK_EQ(trace_usec(US(1)), 1UL, "4096 TOD units are one microsecond");
+	CHECK_EQ(trace_usec(4095), 0UL, "less is zero");
+	CHECK_EQ(trace_usec(MS(1)), 1000UL, "a millisecond is a thousand");
+	CHECK_EQ(trace_usec(0xFFFFFFFFFFFFFFFFULL), 0xFFFFFFFFUL, "and it saturates");
+
+	printf("\n--- begin and end ---\n");
+	trace_init(&tr, MS(0));
+	a = trace_begin(&tr, "access", MS(1));
+	CHECK(a >= 0, "a begin returns a slot");
+	trace_end(&tr, a, MS(3));
+	CHECK(tr.span[a].total == MS(2), "the pair's duration is recorded");
+	CHECK_EQ(tr.span[a].count, 1u, "and counted once");
+	CHECK(tr.span[a].start == 0, "the span is closed");
+
+	{
+		/* same content, another pointer: another TU's literal */
+		char other[8];
+		strcpy(other, "access");
+		b = trace_begin(&tr, other, MS(10));
+		CHECK_EQ(b, a, "a name is keyed by content, not pointer");
+		trace_end(&tr, b, MS(11));
+		CHECK(tr.span[a].total == MS(3), "the second pair adds to the first");
+		CHECK_EQ(tr.span[a].count, 2u, "and counts");
+		CHECK_EQ(tr.nspans, 1, "no second slot");
+	}
+
+	b = trace_begin(&tr, "records", MS(20));
+	c = trace_begin(&tr, "records", MS(21));
+	CHECK_EQ(c, TRC_NONE, "a begin inside its own open name is not recorded");
+	trace_end(&tr, c, MS(22));
+	CHECK(tr.span[b].start != 0, "ending that begin leaves the outer open");
+	trace_end(&tr, b, MS(25));
+	CHECK(tr.span[b].total == MS(5), "the outer pair covers it once");
+	CHECK_EQ(tr.span[b].count, 1u, "and counts once");
+	trace_end(&tr, b, MS(40));
+	CHECK(tr.span[b].total == MS(5), "a second end changes nothing");
+	CHECK_EQ(tr.span[b].count, 1u, "nor the count");
+	trace_end(&tr, 99, MS(40));
+	trace_end(&tr, -7, MS(40));
+	trace_end(NULL, 0, MS(40));
+	CHECK_EQ(tr.nspans, 2, "out-of-range ends touch nothing");
+
+	c = trace_begin(&tr, "send", MS(30));
+	trace_end(&tr, c, MS(29));
+	CHECK(tr.span[c].total == 0, "a clock that went backwards adds nothing");
+	CHECK_EQ(tr.span[c].count, 1u, "but the pair still counts");
+
+	CHECK_EQ(trace_begin(&tr, NULL, MS(1)), TRC_NONE, "a NULL name is refused");
+	CHECK_EQ(trace_begin(NULL, "x", MS(1)), TRC_NONE, "and a NULL table");
+
+	trace_init(&tr, 0);
+	a = trace_begin(&tr, "zero", 0);
+	CHECK(a >= 0 && tr.span[a].start != 0, "a begin at TOD 0 still reads as open");
+	trace_end(&tr, a, MS(1));
+	CHECK_EQ(tr.span[a].count, 1u, "and closes");
+
+	printf("\n--- a full table ---\n");
+	{
+		static const char *const names[TRC_SPANS + 3] = {
+			"p0", "p1", "p2", "p3", "p4", "p5", "p6", "p7",
+			"p8", "p9", "p10", "p11", "p12", "p13", "p14"
+		};
+		TRC_TRACE guard[2];
+
+		memset(guard, 0, sizeof(guard));
+		trace_init(&guard[0], 0);
+		for (i = 0; i < TRC_SPANS + 3; i++) {
+			a = trace_begin(&guard[0], names[i], MS(i));
+			trace_end(&guard[0], a, MS(i + 1));
+		}
+		CHECK_EQ(guard[0].nspans, TRC_SPANS, "the table fills to TRC_SPANS");
+		CHECK_EQ(guard[0].dropped, 3, "and counts the begins past it");
+		CHECK_EQ(slot_of(&guard[0], "p12"), -1, "a dropped name has no slot");
+		CHECK_EQ(guard[1].nspans, 0, "nothing is written past the array");
+		CHECK(guard[1].t0 == 0, "not even the next table's clock");
+		a = trace_begin(&guard[0], "p3", MS(50));
+		CHECK(a >= 0, "a name already in the table still records");
+		trace_end(&guard[0], a, MS(52));
+		CHECK(guard[0].span[a].total == MS(3), "and adds up");
+	}
+
+	printf("\n--- Server-Timing ---\n");
+	trace_init(&tr, MS(100));
+	a = trace_begin(&tr, "access", MS(100));
+	trace_end(&tr, a, US(100412));
+	a = trace_begin(&tr, "etag", MS(101));
+	trace_end(&tr, a, US(132870));
+	a = trace_begin(&tr, "records", MS(133));	/* still open */
+	n = trace_server_timing(&tr, US(135102), buf, sizeof(buf));
+	CHECK(strcmp(buf, "access;dur=0.412, etag;dur=31.870, total;dur=35.102") == 0,
+		"finished phases, then total");
+	CHECK_EQ(n, (int) strlen(buf), "the length returned is the length written");
+	CHECK(strstr(buf, "records") == NULL, "an open phase is left out");
+
+	trace_init(&tr, MS(7));
+	n = trace_server_timing(&tr, MS(9), buf, sizeof(buf));
+	CHECK(strcmp(buf, "total;dur=2.000") == 0, "no phases: total alone");
+
+	{
+		/* ten phases in a buffer for about three of them */
+		static const char *const names[10] = {
+			"alpha", "bravo", "charlie", "delta", "echo",
+			"foxtrot", "golf", "hotel", "india", "juliet"
+		};
+		char small[96];
+		int whole = 1;
+		const char *p;
+
+		trace_init(&tr, 0);
+		for (i = 0; i < 10; i++) {
+			a = trace_begin(&tr, names[i], MS(i + 1));
+			trace_end(&tr, a, MS(i + 1) + US(250));
+		}
+		n = trace_server_timing(&tr, MS(20), small, sizeof(small));
+		CHECK(n < (int) sizeof(small), "a short buffer is not overrun");
+		CHECK_EQ(n, (int) strlen(small), "and is terminated");
+		p = strstr(small, "total;dur=20.000");
+		CHECK(p != NULL && p[strlen("total;dur=20.000")] == '\0',
+			"total survives the cut, last");
+		CHECK(strstr(small, "juliet") == NULL, "the phases that do not fit go");
+		for (p = small; (p = strstr(p, ";dur=")) != NULL; p++) {
+			if (!(p[5] >= '0' && p[5] <= '9')) whole = 0;
+		}
+		CHECK(whole, "and go whole: every entry kept has its duration");
+		CHECK(strncmp(small, "alpha;dur=0.250, ", 17) == 0, "in the order they began");
+	}
+
+	n = trace_server_timing(&tr, MS(20), buf, 0);
+	CHECK_EQ(n, 0, "a zero-sized buffer takes nothing");
+	n = trace_server_timing(&tr, MS(20), buf, 4);
+	CHECK_EQ(n, 0, "one too small for total takes nothing");
+	CHECK(buf[0] == '\0', "but is terminated");
+
+	printf("\n--- the WTO summary ---\n");
+	trace_init(&tr, 0);
+	a = trace_begin(&tr, "access", 0);
+	trace_end(&tr, a, US(400));
+	for (i = 0; i < 4096; i++) {
+		b = trace_begin(&tr, "send", MS(1) + US(i * 10));
+		trace_end(&tr, b, MS(1) + US(i * 10 + 5));
+	}
+	c = trace_begin(&tr, "records", MS(1));		/* left open */
+	n = trace_summary(&tr, MS(51), buf, sizeof(buf));
+	CHECK(strcmp(buf, "access=0.4 send=20.5/4096 records=50.0+") == 0,
+		"counts after a slash, an open phase up to now with a +");
+	CHECK_EQ(n, (int) strlen(buf), "the length returned is the length written");
+	trace_end(&tr, c, MS(52));
+	n = trace_summary(&tr, MS(60), buf, sizeof(buf));
+	CHECK(strstr(buf, "records=51.0") != NULL && strchr(buf, '+') == NULL,
+		"closed, it is a plain phase");
+
+	{
+		char small[24];
+
+		tr.dropped = 2;
+		n = trace_summary(&tr, MS(60), buf, sizeof(buf));
+		CHECK(strcmp(buf + n - 3, " +2") == 0, "dropped begins are owned up to");
+		n = trace_summary(&tr, MS(60), small, sizeof(small));
+		CHECK(strcmp(small, "access=0.4 +2") == 0,
+			"a short buffer keeps whole entries, and the drop count");
+	}
+	trace_init(&tr, 0);
+	n = trace_summary(&tr, MS(1), buf, sizeof(buf));
+	CHECK(n == 0 && buf[0] == '\0', "no phases, no summary");
+
+	printf("\n--- randomized against a stack model ---\n");
+	{
+		static const char *const names[5] = {
+			"access", "count", "etag", "records", "send"
+		};
+		unsigned long long want[5];
+		unsigned want_count[5];
+		int stack[32];
+		int slot[32];
+		int open[5];
+		int depth;
+		int bad = 0;
+		int round;
+		unsigned long long now;
+
+		for (round = 0; round < 500; round++) {
+			memset(want, 0, sizeof(want));
+			memset(want_count, 0, sizeof(want_count));
+			memset(open, 0, sizeof(open));
+			depth = 0;
+			now = MS(1);
+			trace_init(&tr, now);
+
+			for (i = 0; i < 200; i++) {
+				now += rng() % 5000;
+				if (depth < 32 && (depth == 0 || rng() % 2)) {
+					int k = (int) (rng() % 5);
+					int s = trace_begin(&tr, names[k], now);
+					/* the model: only the outermost of a name times */
+					if (open[k]++ == 0) {
+						want[k] -= now;
+						if (s == TRC_NONE) bad++;
+					} else if (s != TRC_NONE) {
+						bad++;
+					}
+					stack[depth] = k;
+					slot[depth++] = s;
+				} else {
+					int k = stack[--depth];
+					trace_end(&tr, slot[depth], now);
+					if (--open[k] == 0) {
+						want[k] += now;
+						want_count[k]++;
+					}
+				}
+			}
+			while (depth > 0) {
+				int k = stack[--depth];
+				now += rng() % 5000;
+				trace_end(&tr, slot[depth], now);
+				if (--open[k] == 0) {
+					want[k] += now;
+					want_count[k]++;
+				}
+			}
+
+			for (i = 0; i < 5; i++) {
+				int s = slot_of(&tr, names[i]);
+				if (want_count[i] == 0) {
+					if (s >= 0 && tr.span[s].count != 0) bad++;
+					continue;
+				}
+				if (s < 0 || tr.span[s].total != want[i] ||
+						tr.span[s].count != want_count[i] ||
+						tr.span[s].start != 0) {
+					bad++;
+				}
+			}
+		}
+		snprintf(msg, sizeof(msg), "500 random nestings of 200 steps agree with the model (%d off)", bad);
+		CHECK_EQ(bad, 0, msg);
+	}
+
+	printf("\n--- overhead ---\n");
+	{
+		/* What a handler pays per phase, clock excluded: on MVS the two
+		   STCKs are a few dozen cycles more. The number is informational;
+		   the check is only that the loop ran. */
+		const int iters = 2000000;
+		clock_t t0;
+		clock_t t1;
+		double ns;
+
+		trace_init(&tr, 0);
+		for (i = 0; i < 6; i++) {
+			static const char *const names[6] = {
+				"access", "count", "etag", "open", "records", "send"
+			};
+			a = trace_begin(&tr, names[i], 1);
+			trace_end(&tr, a, 2);
+		}
+		t0 = clock();
+		for (i = 0; i < iters; i++) {
+			a = trace_begin(&tr, "send", (unsigned long long) i + 1);
+			trace_end(&tr, a, (unsigned long long) i + 2);
+		}
+		t1 = clock();
+		ns = (double) (t1 - t0) * 1e9 / CLOCKS_PER_SEC / iters;
+		printf("  begin/end pair on the last of 6 names: %.1f ns\n", ns);
+		CHECK_EQ(tr.span[slot_of(&tr, "send")].count, (unsigned) iters + 1,
+			"every pair was counted");
+	}
+
+	return mbt_test_summary("TSTTRACE");
+}
@@ -0,0 +1,324 @@
+/*
+ * tsttrec.c - fixed-length records to text lines: textrec_fixed() and
+ * textrec_block() against the four passes they replaced.
+ *
+ * A text download is the one thing a client diffs against the data set, so
+ * the kernel has to write what the old sequence wrote, byte for byte:
+ *
+ *   1. One record, over random lengths and contents: trailing padding of
+ *      every length (none, some, all of it), padding in the middle and at
+ *      the front kept, every byte through the table, the newline
+ *      translated the same way. The table is a random permutation, so a
+ *      byte copied instead of translated shows. textrec_line(), for V and
+ *      U records, strips nothing.
+ *   2. A block of packed records, at odd LRECLs so every record sits at a
+ *      different alignment: the lines back to back, and nothing written
+ *      past the returned length.
+ *   3. What dsread_next() in dsread.c relies on from fgets(): with
+ *      buffer[lrecl] cleared before each call, a '\n' there means a whole
+ *      record was read, and a shorter line never leaves one.
+ *   4. A benchmark of FB80 and FB133 records, MB/s both ways.
+ *
+ * ====================================================================
+ * This test drives the REAL implementation: src/textrec.c is #included
+ * below. The old sequence is transcribed from read_and_send_dataset() as
+ * it was; the handler itself cannot compile on the host.
+ * ====================================================================
+ *
+ * Runs on host via `make test-host`.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <mbtcheck.h>
+
+#include "../../src/textrec.c"
+
+#define LRECL_MAX   300
+#define BENCH_BYTES (8 * 1024 * 1024)
+
+static unsigned char xlate[256];
+
+/* The old text path for one F/FB record, from the line fgets() left in
+   `buffer`: strlen(), the '\n' off, the blanks off, the '\n' back, then
+   http_xlate() in place. Returns the length sent. */
+static size_t
+old_line(unsigned char *buffer)
+{
+	size_t len = strlen((char *) buffer);
+	size_t end = len;
+	size_t i;
+
+	if (len > 0) {
+		if (end > 0 && buffer[end - 1] == '\n') end--;
+		while (end > 0 && buffer[end - 1] == ' ') end--;
+		buffer[end] = '\n';
+		len = end + 1;
+	}
+	for (i = 0; i < len; i++) {
+		buffer[i] = xlate[buffer[i]];
+	}
+	return len;
+}
+
+/* A record as the data sets have them: text, then blank padding. Neither
+   NUL nor '\n' -- fgets() and strlen() would have cut the line there. */
+static void
+random_record(unsigned char *rec, size_t lrecl)
+{
+	size_t text = (size_t) rand() % (lrecl + 1);
+	size_t i;
+
+	switch (rand() % 6) {
+	case 0: text = 0;     break;    /* all padding */
+	case 1: text = lrecl; break;    /* no padding */
+	default:              break;
+	}
+	for (i = 0; i < text; i++) {
+		rec[i] = (unsigned char) (rand() % 4 == 0 ? ' ' : 32 + rand() % 223);
+		if (rec[i] == '\n') {
+			rec[i] = 'x';
+		}
+	}
+	for (; i < lrecl; i++) {
+		rec[i] = ' ';
+	}
+}
+
+/* The line fgets() leaves for a whole record. */
+static void
+as_line(unsigned char *line, const unsigned char *rec, size_t lrecl)
+{
+	memcpy(line, rec, lrecl);
+	line[lrecl] = '\n';
+	line[lrecl + 1] = 0;
+}
+
+int
+main(void)
+{
+	static unsigned char rec[LRECL_MAX];
+	static unsigned char line[LRECL_MAX + 2];
+	static unsigned char out[LRECL_MAX + 2];
+	size_t lrecl;
+	size_t n;
+	int i;
+	int bad;
+
+	srand(11);
+	for (i = 0; i < 256; i++) {
+		xlate[i] = (unsigned char) i;
+	}
+	for (i = 255; i > 0; i--) {
+		int j = rand() % (i + 1);
+		unsigned char t = xlate[i];
+
+		xlate[i] = xlate[j];
+		xlate[j] = t;
+	}
+
+	printf("\n--- one record ---\n");
+	{
+		bad = 0;
+		for (i = 0; i < 200000; i++) {
+			lrecl = 1 + (size_t) rand() % LRECL_MAX;
+			random_record(rec, lrecl);
+			as_line(line, rec, lrecl);
+			n = old_line(line);
+
+			memset(out, 0xEE, sizeof(out));
+			if (textrec_fixed(out, rec, lrecl, ' ', '\n', xlate) != n
+			    || memcmp(out, line, n) != 0
+			    || (n < sizeof(out) && out[n] != 0xEE)) {
+				bad++;
+			}
+		}
+		CHECK_EQ(bad, 0, "200 000 random records as the old path wrote them");
+
+		for (lrecl = 1; lrecl <= 64; lrecl++) {
+			size_t text;
+
+			for (text = 0; text <= lrecl; text++) {
+				memset(rec, ' ', lrecl);
+				memset(rec, 'A', text);
+				n = textrec_fixed(out, rec, lrecl, ' ', '\n', xlate);
+				if (n != text + 1 || out[text] != xlate['\n']) {
+					bad++;
+				}
+			}
+		}
+		CHECK_EQ(bad, 0, "every text length at every LRECL to 64 stops "
+			"at the last non-blank");
+
+		memcpy(rec, "  LEADING AND   INNER  ", 23);
+		n = textrec_fixed(out, rec, 23, ' ', '\n', xlate);
+		CHECK_EQ(n, 22, "leading and inner blanks are kept");
+		CHECK(out[0] == xlate[' '] && out[14] == xlate[' '],
+			"and translated like any byte");
+
+		memset(rec, 0x40, 80);
+		memcpy(rec, "\xC1\xC2\xC3", 3);
+		n = textrec_fixed(out, rec, 80, 0x40, 0x15, xlate);
+		CHECK(n == 4 && out[3] == xlate[0x15],
+			"the pad and newline are the caller's: EBCDIC X'40' and X'15'");
+
+		/* textrec_line(): V and U records keep their trailing blanks */
+		memcpy(rec, "VAR  ", 5);
+		n = textrec_line(out, rec, 5, '\n', xlate);
+		CHECK(n == 6 && out[4] == xlate[' '] && out[5] == xlate['\n'],
+			"a V record is translated whole, blanks and all");
+		CHECK_EQ(textrec_line(out, rec, 0, '\n', xlate), 1,
+			"a zero-length record is a newline");
+	}
+
+	printf("\n--- a block of records ---\n");
+	{
+		static unsigned char recs[64 * LRECL_MAX];
+		static unsigned char want[64 * (LRECL_MAX + 1)];
+		static unsigned char got[64 * (LRECL_MAX + 1) + 1];
+		size_t lrecls[] = { 1, 3, 7, 80, 81, 133, 255, 299 };
+		size_t k;
+
+		bad = 0;
+		for (k = 0; k < sizeof(lrecls) / sizeof(lrecls[0]); k++) {
+			size_t nrec = 1 + (size_t) rand() % 64;
+			size_t w = 0;
+			size_t r;
+
+			lrecl = lrecls[k];
+			for (r = 0; r < nrec; r++) {
+				random_record(recs + r * lrecl, lrecl);
+				as_line(line, recs + r * lrecl, lrecl);
+				n = old_line(line);
+				memcpy(want + w, line, n);
+				w += n;
+			}
+			memset(got, 0xEE, sizeof(got));
+			n = textrec_block(got, recs, nrec, lrecl, ' ', '\n', xlate);
+			if (n != w || memcmp(got, want, w) != 0 || got[w] != 0xEE) {
+				bad++;
+				printf("  LRECL %lu: %lu bytes, want %lu\n",
+					(unsigned long) lrecl, (unsigned long) n,
+					(unsigned long) w);
+			}
+		}
+		CHECK_EQ(bad, 0, "blocks at odd LRECLs are the records' lines back "
+			"to back, and nothing past them");
+		CHECK_EQ(textrec_block(got, recs, 0, 80, ' ', '\n', xlate), 0,
+			"an empty block writes nothing");
+	}
+
+	printf("\n--- fgets() and the '\\n' at buffer[lrecl] ---\n");
+	{
+		FILE *fp = tmpfile();
+		char buffer[80 + 2];
+		int whole = 0;
+		int shorter = 0;
+		int wrong = 0;
+
+		CHECK(fp != NULL, "tmpfile()");
+		if (fp) {
+			/* whole records, then a short one, then whole again */
+			for (i = 0; i < 10; i++) {
+				memset(buffer, 'A' + i, 80);
+				fwrite(buffer, 1, 80, fp);
+				fputc('\n', fp);
+				if (i == 4) {
+					fputs("SHORT\n", fp);
+				}
+			}
+			fputs("LAST WITHOUT NEWLINE", fp);
+			rewind(fp);
+
+			for (;;) {
+				buffer[80] = 0;
+				if (!fgets(buffer, 80 + 2, fp)) {
+					break;
+				}
+				if (buffer[80] == '\n') {
+					whole++;
+					wrong += buffer[0] < 'A' || buffer[0] > 'J';
+				} else {
+					shorter++;
+					wrong += strncmp(buffer, "SHORT", 5) != 0
+					      && strncmp(buffer, "LAST", 4) != 0;
+				}
+			}
+			fclose(fp);
+		}
+		CHECK_EQ(whole, 10, "every whole record is seen as whole");
+		CHECK_EQ(shorter, 2, "the short line and the unterminated last one "
+			"are not");
+		CHECK_EQ(wrong, 0, "and no line is taken for the other kind");
+	}
+
+	printf("\n--- benchmark: FB80 and FB133, %d MB ---\n",
+		BENCH_BYTES / (1024 * 1024));
+	{
+		size_t lrecls[] = { 80, 133 };
+		size_t k;
+
+		for (k = 0; k < 2; k++) {
+			static unsigned char lines[BENCH_BYTES + 2 * 100000];
+			static unsigned char work[LRECL_MAX + 2];
+			static unsigned char sent_a[BENCH_BYTES + 100000];
+			static unsigned char sent_b[BENCH_BYTES + 100000];
+			size_t stride;
+			size_t nrec;
+			size_t len_a = 0;
+			size_t len_b = 0;
+			size_t r;
+			const int reps = 5;
+			int rep;
+			clock_t t0;
+			double t_old;
+			double t_new;
+			double mb;
+
+			lrecl = lrecls[k];
+			stride = lrecl + 2;
+			nrec = BENCH_BYTES / lrecl;
+			for (r = 0; r < nrec; r++) {
+				random_record(rec, lrecl);
+				as_line(lines + r * stride, rec, lrecl);
+			}
+			mb = (double) (nrec * lrecl) / (1024.0 * 1024.0);
+
+			/* the old path, from the line fgets() left to the bytes in
+			   the send buffer: the four passes and send_all()'s copy */
+			t0 = clock();
+			for (rep = 0; rep < reps; rep++) {
+				len_a = 0;
+				for (r = 0; r < nrec; r++) {
+					memcpy(work, lines + r * stride, stride);
+					n = old_line(work);
+					memcpy(sent_a + len_a, work, n);
+					len_a += n;
+				}
+			}
+			t_old = (double) (clock() - t0) / CLOCKS_PER_SEC / reps;
+
+			/* the kernel, from the same line into the block */
+			t0 = clock();
+			for (rep = 0; rep < reps; rep++) {
+				len_b = 0;
+				for (r = 0; r < nrec; r++) {
+					len_b += textrec_fixed(sent_b + len_b, lines + r * stride,
+						lrecl, ' ', '\n', xlate);
+				}
+			}
+			t_new = (double) (clock() - t0) / CLOCKS_PER_SEC / reps;
+
+			CHECK(len_a == len_b && memcmp(sent_a, sent_b, len_a) == 0,
+				"the same bytes both ways");
+			printf("  FB%lu: old %.0f MB/s, kernel %.0f MB/s (%.1fx)\n",
+				(unsigned long) lrecl, mb / t_old, mb / t_new,
+				t_old / t_new);
+			CHECK(t_new < t_old, "the kernel is faster");
+		}
+	}
+
+	return mbt_test_summary("TSTTREC");
+}
@@ -0,0 +1,397 @@
+/*
+ * tstwbr.c - write-behind: the ring between a PUT's worker and the writer
+ * subtask that owns the DCB (src/wbring.c).
+ *
+ * dswrite.c runs the ring on two TCBs and hands it over through ECBs; here
+ * both sides run on one simulated clock, the worker taking as long per
+ * block as the body takes to arrive and the writer as long as the block
+ * takes to write, with stalls injected into either. So:
+ *
+ *   1. The hand-over by itself: slots go to the writer in the order put,
+ *      with their flush flag; the worker waits when every slot is full, the
+ *      writer when none is; the close is the end only once the ring is
+ *      drained.
+ *   2. A failed write: nothing after it is written, every slot is still
+ *      freed, and the worker's next put fails -- it never waits on a writer
+ *      that gave up. A put over the slot size fails too.
+ *   3. Through the simulation, every block is written once, in order, with
+ *      its flush, at any mix of latencies and stalls -- and neither side
+ *      ever waits with the other waiting too.
+ *   4. A stall on either side shorter than the ring is absorbed: the other
+ *      side keeps going. The time, in line against write-behind, receive-
+ *      and disk-bound, with stalls.
+ *
+ * ====================================================================
+ * This test drives the REAL implementation: src/wbring.c is #included
+ * below. The clock and the two actors are the test's own; dswrite.c, with
+ * its subtask and ECBs, cannot compile on the host.
+ * ====================================================================
+ *
+ * Runs on host via `make test-host`.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mbtcheck.h>
+
+#include "../../src/wbring.c"
+
+#define SLOTSZ      4096
+#define NSLOT       3
+#define NBLK_MAX    500
+
+static unsigned char store[WBRING_MAX][SLOTSZ];
+static unsigned char *bufs[WBRING_MAX];
+
+/* block i: its length, its bytes and its flush tell which block it is */
+static size_t
+block_len(int i)
+{
+	return SLOTSZ - (size_t) (i % 5) * 100;
+}
+
+static int
+block_flush(int i)
+{
+	return i % 4 == 3;
+}
+
+static void
+block_fill(unsigned char *p, int i)
+{
+	memset(p, (unsigned char) (i * 13 + 1), block_len(i));
+}
+
+static int
+block_ok(const unsigned char *p, size_t len, int flush, int i)
+{
+	return len == block_len(i) && flush == block_flush(i)
+		&& p[0] == (unsigned char) (i * 13 + 1)
+		&& p[len - 1] == (unsigned char) (i * 13 + 1);
+}
+
+static double
+dmax(double a, double b)
+{
+	return a > b ? a : b;
+}
+
+/* ---- the simulation ---- */
+
+struct sim {
+	int             nblk;
+	double          recv[NBLK_MAX];         /* ms for block i to arrive */
+	double          disk[NBLK_MAX];         /* ms to write block i */
+	int             fail_at;                /* write that fails, -1 none */
+
+	double          t_work;
+	double          t_write;
+	unsigned long   both_waiting;
+	unsigned long   turns;
+	int             put;                    /* blocks the worker put */
+	int             written;                /* blocks written */
+	int             freed;                  /* slots given back */
+	int             bad;
+	int             put_failed;             /* the worker's put was -1 */
+	int             closed_ok;              /* the writer saw the end */
+};
+
+static double
+simulate(struct sim *s, unsigned nslot)
+{
+	static unsigned char block[SLOTSZ];
+	WBRING wb;
+	const unsigned char *buf;
+	size_t len;
+	int flush;
+	int receiving = 0;      /* block `put` is arriving, done at t_work */
+	int work_wait = 0;
+	int work_done = 0;
+	int writing = 0;        /* a slot is being written, done at t_write */
+	int write_wait = 0;
+	int failed = 0;
+	int rc;
+
+	wbring_init(&wb, bufs, nslot, SLOTSZ);
+	s->t_work = 0;
+	s->t_write = 0;
+	s->both_waiting = 0;
+	s->turns = 0;
+	s->put = 0;
+	s->written = 0;
+	s->freed = 0;
+	s->bad = 0;
+	s->put_failed = 0;
+	s->closed_ok = 0;
+
+	while (!s->closed_ok && s->turns++ < 200000) {
+		int worker_turn;
+
+		if (work_wait && write_wait) {
+			s->both_waiting++;
+			break;
+		}
+		if (work_done || work_wait) {
+			worker_turn = 0;
+		} else if (write_wait) {
+			worker_turn = 1;
+		} else {
+			worker_turn = s->t_work <= s->t_write;
+		}
+
+		if (worker_turn) {
+			if (!receiving) {
+				if (s->put == s->nblk) {
+					wbring_close(&wb);
+					work_done = 1;
+				} else {
+					receiving = 1;
+					s->t_work += s->recv[s->put];
+					continue;
+				}
+			} else {
+				block_fill(block, s->put);
+				rc = wbring_put(&wb, block, block_len(s->put),
+					block_flush(s->put));
+				if (rc == WBR_WAIT) {
+					work_wait = 1;
+					continue;
+				}
+				receiving = 0;
+				if (rc < 0) {
+					/* the PUT fails here and closes the target */
+					s->put_failed = 1;
+					wbring_close(&wb);
+					work_done = 1;
+				} else {
+					s->put++;
+				}
+			}
+			/* the post */
+			if (write_wait) {
+				write_wait = 0;
+				s->t_write = dmax(s->t_write, s->t_work);
+			}
+			continue;
+		}
+
+		if (writing) {
+			if (!failed && s->written == s->fail_at) {
+				failed = 1;
+			}
+			if (!failed) {
+				s->written++;
+			}
+			s->freed += wbring_done(&wb, failed ? -1 : 0);
+			writing = 0;
+			if (work_wait) {
+				work_wait = 0;
+				s->t_work = dmax(s->t_work, s->t_write);
+			}
+			continue;
+		}
+		rc = wbring_take(&wb, &buf, &len, &flush);
+		if (rc == WBR_WAIT) {
+			write_wait = 1;
+		} else if (rc == 0) {
+			s->closed_ok = 1;
+		} else {
+			if (!block_ok(buf, len, flush, s->freed)) {
+				s->bad++;
+			}
+			writing = 1;
+			/* a failed writer only frees, which takes no time */
+			if (!failed) {
+				s->t_write += s->disk[s->freed];
+			}
+		}
+	}
+
+	return dmax(s->t_work, s->t_write);
+}
+
+static void
+latencies(struct sim *s, int nblk, double recv, double disk, double jitter)
+{
+	int i;
+
+	s->nblk = nblk;
+	s->fail_at = -1;
+	for (i = 0; i < nblk; i++) {
+		s->recv[i] = recv * (1.0 + jitter * ((double) rand() / RAND_MAX - 0.5));
+		s->disk[i] = disk * (1.0 + jitter * ((double) rand() / RAND_MAX - 0.5));
+	}
+}
+
+int
+main(void)
+{
+	static struct sim s;
+	static unsigned char block[SLOTSZ + 1];
+	WBRING wb;
+	const unsigned char *buf;
+	size_t len;
+	int flush;
+	int i;
+
+	for (i = 0; i < WBRING_MAX; i++) {
+		bufs[i] = store[i];
+	}
+	srand(29);
+
+	printf("\n--- the hand-over ---\n");
+	{
+		wbring_init(&wb, bufs, NSLOT, SLOTSZ);
+		CHECK_EQ(wbring_take(&wb, &buf, &len, &flush), WBR_WAIT,
+			"nothing put: the writer waits");
+		for (i = 0; i < NSLOT; i++) {
+			block_fill(block, i);
+			if (wbring_put(&wb, block, block_len(i), block_flush(i)) != 1) {
+				break;
+			}
+		}
+		CHECK_EQ(i, NSLOT, "the worker fills every slot");
+		CHECK_EQ(wbring_put(&wb, block, 10, 0), WBR_WAIT,
+			"and then waits");
+		CHECK(wbring_take(&wb, &buf, &len, &flush) == 1
+			&& block_ok(buf, len, flush, 0), "the writer gets the first put");
+		CHECK_EQ(wbring_put(&wb, block, 10, 0), WBR_WAIT,
+			"taken is not free: the worker still waits");
+		CHECK_EQ(wbring_done(&wb, 0), 1, "written: the slot goes back");
+		CHECK_EQ(wbring_done(&wb, 0), 0, "and only once");
+		block_fill(block, 3);
+		CHECK_EQ(wbring_put(&wb, block, block_len(3), block_flush(3)), 1,
+			"the worker has it");
+		wbring_close(&wb);
+		for (i = 1; i <= 3; i++) {
+			if (wbring_take(&wb, &buf, &len, &flush) != 1
+			    || !block_ok(buf, len, flush, i)) {
+				break;
+			}
+			wbring_done(&wb, 0);
+		}
+		CHECK_EQ(i, 4, "closed: the rest still comes, in order, flush and all");
+		CHECK_EQ(wbring_take(&wb, &buf, &len, &flush), 0,
+			"then the end");
+		CHECK_EQ(wb.blocks, 4, "four slots put");
+	}
+
+	printf("\n--- a failed write ---\n");
+	{
+		wbring_init(&wb, bufs, NSLOT, SLOTSZ);
+		wbring_put(&wb, block, 10, 0);
+		wbring_put(&wb, block, 10, 0);
+		wbring_take(&wb, &buf, &len, &flush);
+		wbring_done(&wb, -1);
+		CHECK_EQ(wbring_put(&wb, block, 10, 0), -1,
+			"the worker's next put fails");
+		CHECK(wbring_take(&wb, &buf, &len, &flush) == 1
+			&& wbring_done(&wb, 0) == 1,
+			"the slot put before it is still handed out and freed");
+		wbring_close(&wb);
+		CHECK_EQ(wbring_take(&wb, &buf, &len, &flush), 0,
+			"and the close ends the writer");
+
+		wbring_init(&wb, bufs, NSLOT, SLOTSZ);
+		CHECK_EQ(wbring_put(&wb, block, SLOTSZ + 1, 0), -1,
+			"more than a slot holds is refused");
+		CHECK_EQ(wbring_put(&wb, block, SLOTSZ, 0), 1, "a slot's worth is not");
+	}
+
+	printf("\n--- simulated ---\n");
+	{
+		int bad = 0;
+		int hang = 0;
+		int fail_bad = 0;
+		int k;
+
+		for (k = 0; k < 200; k++) {
+			latencies(&s, 1 + rand() % 80, 1.0 + rand() % 20,
+				1.0 + rand() % 20, 1.5);
+			if (k % 3 == 0) {
+				/* a stall on one side or the other */
+				int at = rand() % s.nblk;
+
+				if (k % 2) {
+					s.disk[at] += 200.0;
+				} else {
+					s.recv[at] += 200.0;
+				}
+			}
+			simulate(&s, 1 + (unsigned) rand() % WBRING_MAX);
+			bad += s.bad || s.written != s.nblk || s.put != s.nblk
+				|| !s.closed_ok || s.put_failed;
+			hang += s.both_waiting != 0;
+		}
+		CHECK_EQ(bad, 0, "200 random runs with stalls: every block written "
+			"once, in order, with its flush");
+		CHECK_EQ(hang, 0, "and never both sides waiting");
+
+		for (k = 0; k < 50; k++) {
+			latencies(&s, 60, 1.0 + rand() % 10, 1.0 + rand() % 10, 1.0);
+			s.fail_at = rand() % 60;
+			simulate(&s, NSLOT);
+			fail_bad += s.written != s.fail_at || !s.closed_ok
+				|| s.freed < s.put || s.bad
+				|| (s.put < s.nblk && !s.put_failed)
+				|| s.both_waiting;
+		}
+		CHECK_EQ(fail_bad, 0, "50 runs with a failing write: nothing written "
+			"after it, every slot freed, the worker's put fails, no hang");
+	}
+
+	printf("\n--- in line vs write-behind, %d blocks, %d slots ---\n",
+		NBLK_MAX, NSLOT);
+	{
+		static const struct {
+			const char *name;
+			double recv;
+			double disk;
+			double stall;       /* added to one block on each side */
+		} mix[] = {
+			{ "receive-bound", 12.0, 5.0, 0.0 },
+			{ "disk-bound", 4.0, 9.0, 0.0 },
+			{ "balanced", 8.0, 8.0, 0.0 },
+			{ "disk stall", 8.0, 6.0, 15.0 },
+			{ "long stalls", 8.0, 6.0, 400.0 },
+		};
+		size_t m;
+
+		for (m = 0; m < sizeof(mix) / sizeof(mix[0]); m++) {
+			double sum_r = 0;
+			double sum_d = 0;
+			double max_r = 0;
+			double max_d = 0;
+			double t;
+			char what[96];
+
+			latencies(&s, NBLK_MAX, mix[m].recv, mix[m].disk, 0.0);
+			s.disk[NBLK_MAX / 3] += mix[m].stall;
+			s.recv[2 * NBLK_MAX / 3] += mix[m].stall;
+			for (i = 0; i < NBLK_MAX; i++) {
+				sum_r += s.recv[i];
+				sum_d += s.disk[i];
+				max_r = dmax(max_r, s.recv[i]);
+				max_d = dmax(max_d, s.disk[i]);
+			}
+			t = simulate(&s, NSLOT);
+
+			printf("  %-14s in line %6.0f ms, write-behind %6.0f ms\n",
+				mix[m].name, sum_r + sum_d, t);
+			if (mix[m].stall < NSLOT * dmax(mix[m].recv, mix[m].disk)) {
+				sprintf(what, "%s: at most the slower side plus one block",
+					mix[m].name);
+				CHECK(s.written == NBLK_MAX && s.bad == 0
+					&& t <= dmax(sum_r, sum_d) + max_r + max_d + 1e-6, what);
+			} else {
+				sprintf(what, "%s: longer than the ring holds, still faster "
+					"than in line", mix[m].name);
+				CHECK(s.written == NBLK_MAX && s.bad == 0
+					&& t < sum_r + sum_d, what);
+			}
+		}
+	}
+
+	return mbt_test_summary("TSTWBR");
+}